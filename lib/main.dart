@@ -33,6 +33,7 @@ import 'package:cyrene_music/services/auth_service.dart';
 import 'package:cyrene_music/services/version_service.dart';
 import 'package:cyrene_music/services/mini_player_window_service.dart';
 import 'package:cyrene_music/services/local_library_service.dart';
+import 'package:cyrene_music/services/launch_arguments_service.dart';
 import 'package:cyrene_music/pages/mini_player_window_page.dart';
 import 'package:cyrene_music/utils/theme_manager.dart';
 import 'package:cyrene_music/services/startup_logger.dart';
@@ -283,13 +284,20 @@ Future<void> main() async {
       await NotificationService().initialize();
     });
   
-    if (Platform.isWindows) {
-      await timed('DesktopLyricService.initialize(Windows)', () async {
+    if (DesktopLyricService.isSupported) {
+      await timed('DesktopLyricService.initialize', () async {
         await DesktopLyricService().initialize();
       });
       log(' 桌面歌词服务已初始化');
     }
   
+    if (LaunchArgumentsService.isSupported) {
+      await timed('LaunchArgumentsService.initialize', () async {
+        await LaunchArgumentsService().initialize();
+      });
+      log(' 启动参数服务已初始化');
+    }
+  
     if (Platform.isAndroid) {
       await timed('AndroidFloatingLyricService.initialize(Android)', () async {
         await AndroidFloatingLyricService().initialize();
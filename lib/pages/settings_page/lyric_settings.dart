@@ -18,8 +18,8 @@ class LyricSettings extends StatelessWidget {
 
   @override
   Widget build(BuildContext context) {
-    // 仅在 Windows 和 Android 平台显示
-    if (!Platform.isWindows && !Platform.isAndroid) {
+    // 仅在 Windows、Linux 和 Android 平台显示
+    if (!DesktopLyricService.isSupported && !Platform.isAndroid) {
       return const SizedBox.shrink();
     }
     
@@ -85,7 +85,7 @@ class LyricSettings extends StatelessWidget {
   }
 
   String _getTitle() {
-    if (Platform.isWindows) {
+    if (DesktopLyricService.isSupported) {
       return '桌面歌词';
     } else if (Platform.isAndroid) {
       return '悬浮歌词';
@@ -94,7 +94,7 @@ class LyricSettings extends StatelessWidget {
   }
 
   String _getSubtitle() {
-    if (Platform.isWindows) {
+    if (DesktopLyricService.isSupported) {
       final isVisible = DesktopLyricService().isVisible;
       return isVisible ? '已启用' : '未启用';
     } else if (Platform.isAndroid) {
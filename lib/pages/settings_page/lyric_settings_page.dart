@@ -4,6 +4,7 @@ import 'package:flutter/material.dart';
 import 'package:fluent_ui/fluent_ui.dart' as fluent_ui;
 import '../../utils/theme_manager.dart';
 import '../../widgets/material/material_settings_widgets.dart';
+import '../../services/desktop_lyric_service.dart';
 import '../../widgets/desktop_lyric_settings.dart';
 
 import '../../widgets/android_floating_lyric_settings.dart';
@@ -81,7 +82,7 @@ class _LyricSettingsContentState extends State<LyricSettingsContent> {
       padding: const EdgeInsets.symmetric(vertical: 8),
       children: [
         // 平台特定的歌词设置
-        if (Platform.isWindows) ...[
+        if (DesktopLyricService.isSupported) ...[
           MD3SettingsSection(
             children: const [DesktopLyricSettings()],
           ),
@@ -132,8 +133,8 @@ class _LyricSettingsContentState extends State<LyricSettingsContent> {
     return fluent_ui.ListView(
       padding: const EdgeInsets.all(24),
       children: [
-        // 桌面歌词设置（Windows 平台）
-        if (Platform.isWindows) const DesktopLyricSettings(),
+        // 桌面歌词设置（Windows / Linux 平台）
+        if (DesktopLyricService.isSupported) const DesktopLyricSettings(),
       ],
     );
   }
@@ -4,6 +4,7 @@ import 'package:flutter/cupertino.dart';
 import 'package:fluent_ui/fluent_ui.dart' as fluent_ui;
 import 'package:file_picker/file_picker.dart';
 import '../../services/cache_service.dart';
+import '../../services/native_cache_index_service.dart';
 import '../../services/download_service.dart';
 import '../../widgets/fluent_settings_card.dart';
 import '../../widgets/cupertino/cupertino_settings_widgets.dart';
@@ -56,6 +57,22 @@ class _StorageSettingsState extends State<StorageSettings> {
             trailing: const Icon(Icons.chevron_right),
             onTap: () => _showCacheManagementFluent(),
           ),
+          if (CacheService().supportsEviction) ...[
+            FluentSettingsTile(
+              icon: Icons.data_usage,
+              title: '缓存上限',
+              subtitle: _getCacheLimitSubtitle(),
+              trailing: const Icon(Icons.chevron_right),
+              onTap: () => _showCacheLimitDialog(),
+            ),
+            FluentSettingsTile(
+              icon: Icons.auto_delete,
+              title: '自动清理',
+              subtitle: _getEvictionPolicySubtitle(),
+              trailing: const Icon(Icons.chevron_right),
+              onTap: () => _showEvictionPolicyDialog(),
+            ),
+          ],
           if (Platform.isWindows)
             FluentSettingsTile(
               icon: Icons.download,
@@ -101,6 +118,22 @@ class _StorageSettingsState extends State<StorageSettings> {
           trailing: const Icon(Icons.chevron_right),
           onTap: () => _showCacheManagement(),
         ),
+        if (CacheService().supportsEviction) ...[
+          MD3SettingsTile(
+            leading: const Icon(Icons.data_usage_outlined),
+            title: '缓存上限',
+            subtitle: _getCacheLimitSubtitle(),
+            trailing: const Icon(Icons.chevron_right),
+            onTap: () => _showCacheLimitDialog(),
+          ),
+          MD3SettingsTile(
+            leading: const Icon(Icons.auto_delete_outlined),
+            title: '自动清理',
+            subtitle: _getEvictionPolicySubtitle(),
+            trailing: const Icon(Icons.chevron_right),
+            onTap: () => _showEvictionPolicyDialog(),
+          ),
+        ],
         if (Platform.isWindows)
           MD3SettingsTile(
             leading: const Icon(Icons.download_outlined),
@@ -147,6 +180,7 @@ class _StorageSettingsState extends State<StorageSettings> {
   /// 显示 Cupertino 风格的缓存管理对话框
   Future<void> _showCacheManagementCupertino() async {
     final stats = await CacheService().getCacheStats();
+    final summary = _getEvictionSummary(stats);
     if (!mounted) return;
     
     showCupertinoModalPopup<void>(
@@ -155,7 +189,8 @@ class _StorageSettingsState extends State<StorageSettings> {
         title: const Text('缓存管理'),
         message: Text(
           '占用空间: ${stats.formattedSize}\n'
-          '已缓存 ${stats.totalFiles} 首歌曲',
+          '已缓存 ${stats.totalFiles} 首歌曲'
+          '${summary != null ? '\n$summary' : ''}',
         ),
         actions: [
           if (stats.totalFiles > 0)
@@ -243,6 +278,191 @@ class _StorageSettingsState extends State<StorageSettings> {
     return '已缓存 $count 首歌曲';
   }
 
+  String _getCacheLimitSubtitle() {
+    final limit = CacheService().cacheSizeLimit;
+    return limit == 0 ? '不限' : '最多 ${CacheStats.formatBytes(limit)}';
+  }
+
+  String _getEvictionPolicySubtitle() {
+    return CacheService().evictionPolicy == CacheEvictionPolicy.lfu
+        ? '超出上限时优先清理播放次数最少的歌曲'
+        : '超出上限时优先清理最久未播放的歌曲';
+  }
+
+  /// 命中率与自动清理统计，例如 "命中率 82% · 已自动清理 12 首 (480 MB)"
+  String? _getEvictionSummary(CacheStats stats) {
+    final metrics = stats.metrics;
+    if (metrics == null) return null;
+    final hitRate = metrics.hitRate;
+    final parts = <String>[
+      if (hitRate != null) '命中率 ${(hitRate * 100).round()}%',
+      if (metrics.evictions > 0)
+        '已自动清理 ${metrics.evictions} 首 '
+            '(${CacheStats.formatBytes(metrics.evictedBytes)})',
+    ];
+    return parts.isEmpty ? null : parts.join(' · ');
+  }
+
+  // 可选的缓存上限，0 表示不限
+  static const List<int> _cacheLimitOptions = [
+    1 << 30,
+    2 << 30,
+    4 << 30,
+    8 << 30,
+    16 << 30,
+    0,
+  ];
+
+  void _showCacheLimitDialog() {
+    final current = CacheService().cacheSizeLimit;
+    Future<void> select(int limit) async {
+      Navigator.pop(context);
+      await CacheService().setCacheSizeLimit(limit);
+      if (mounted) setState(() {});
+    }
+
+    String label(int limit) =>
+        limit == 0 ? '不限' : CacheStats.formatBytes(limit);
+
+    if (fluent_ui.FluentTheme.maybeOf(context) != null) {
+      fluent_ui.showDialog(
+        context: context,
+        builder: (context) => fluent_ui.ContentDialog(
+          title: const Text('缓存上限'),
+          content: Column(
+            mainAxisSize: MainAxisSize.min,
+            crossAxisAlignment: CrossAxisAlignment.start,
+            children: [
+              for (final limit in _cacheLimitOptions)
+                Padding(
+                  padding: const EdgeInsets.only(bottom: 8),
+                  child: fluent_ui.RadioButton(
+                    content: Text(label(limit)),
+                    checked: current == limit,
+                    onChanged: (_) => select(limit),
+                  ),
+                ),
+            ],
+          ),
+          actions: [
+            fluent_ui.Button(
+              onPressed: () => Navigator.pop(context),
+              child: const Text('关闭'),
+            ),
+          ],
+        ),
+      );
+      return;
+    }
+
+    showDialog(
+      context: context,
+      builder: (context) => AlertDialog(
+        title: const Text('缓存上限'),
+        content: Column(
+          mainAxisSize: MainAxisSize.min,
+          children: [
+            for (final limit in _cacheLimitOptions)
+              RadioListTile<int>(
+                title: Text(label(limit)),
+                value: limit,
+                groupValue: current,
+                onChanged: (value) => select(value!),
+              ),
+          ],
+        ),
+        actions: [
+          TextButton(
+            onPressed: () => Navigator.pop(context),
+            child: const Text('关闭'),
+          ),
+        ],
+      ),
+    );
+  }
+
+  void _showEvictionPolicyDialog() {
+    final current = CacheService().evictionPolicy;
+    Future<void> select(CacheEvictionPolicy policy) async {
+      Navigator.pop(context);
+      await CacheService().setEvictionPolicy(policy);
+      if (mounted) setState(() {});
+    }
+
+    const options = {
+      CacheEvictionPolicy.lru: ('最久未播放优先', '清理最长时间没有播放过的歌曲'),
+      CacheEvictionPolicy.lfu: ('最少播放优先', '清理播放次数最少的歌曲，常听的歌曲保留更久'),
+    };
+
+    if (fluent_ui.FluentTheme.maybeOf(context) != null) {
+      fluent_ui.showDialog(
+        context: context,
+        builder: (context) => fluent_ui.ContentDialog(
+          title: const Text('自动清理'),
+          content: Column(
+            mainAxisSize: MainAxisSize.min,
+            crossAxisAlignment: CrossAxisAlignment.start,
+            children: [
+              for (final entry in options.entries)
+                Padding(
+                  padding: const EdgeInsets.only(bottom: 8),
+                  child: fluent_ui.RadioButton(
+                    content: Column(
+                      crossAxisAlignment: CrossAxisAlignment.start,
+                      children: [
+                        Text(entry.value.$1),
+                        Text(
+                          entry.value.$2,
+                          style: fluent_ui.FluentTheme.of(context)
+                              .typography
+                              .caption,
+                        ),
+                      ],
+                    ),
+                    checked: current == entry.key,
+                    onChanged: (_) => select(entry.key),
+                  ),
+                ),
+            ],
+          ),
+          actions: [
+            fluent_ui.Button(
+              onPressed: () => Navigator.pop(context),
+              child: const Text('关闭'),
+            ),
+          ],
+        ),
+      );
+      return;
+    }
+
+    showDialog(
+      context: context,
+      builder: (context) => AlertDialog(
+        title: const Text('自动清理'),
+        content: Column(
+          mainAxisSize: MainAxisSize.min,
+          children: [
+            for (final entry in options.entries)
+              RadioListTile<CacheEvictionPolicy>(
+                title: Text(entry.value.$1),
+                subtitle: Text(entry.value.$2),
+                value: entry.key,
+                groupValue: current,
+                onChanged: (value) => select(value!),
+              ),
+          ],
+        ),
+        actions: [
+          TextButton(
+            onPressed: () => Navigator.pop(context),
+            child: const Text('关闭'),
+          ),
+        ],
+      ),
+    );
+  }
+
   String _getCacheDirSubtitle() {
     final customDir = CacheService().customCacheDir;
     if (customDir != null && customDir.isNotEmpty) {
@@ -261,6 +481,7 @@ class _StorageSettingsState extends State<StorageSettings> {
 
   Future<void> _showCacheManagement() async {
     final stats = await CacheService().getCacheStats();
+    final summary = _getEvictionSummary(stats);
 
     if (!mounted) return;
 
@@ -329,6 +550,23 @@ class _StorageSettingsState extends State<StorageSettings> {
                 ),
               ],
             ),
+            if (summary != null) ...[
+              const SizedBox(height: 8),
+              Row(
+                children: [
+                  Icon(
+                    Icons.auto_delete_outlined,
+                    size: 20,
+                    color: Theme.of(context).colorScheme.onSurfaceVariant,
+                  ),
+                  const SizedBox(width: 8),
+                  Text(
+                    summary,
+                    style: Theme.of(context).textTheme.bodyMedium,
+                  ),
+                ],
+              ),
+            ],
           ],
         ),
         actions: [
@@ -440,6 +678,7 @@ class _StorageSettingsState extends State<StorageSettings> {
 
   Future<void> _showCacheManagementFluent() async {
     final stats = await CacheService().getCacheStats();
+    final summary = _getEvictionSummary(stats);
     if (!mounted) return;
     fluent_ui.showDialog(
       context: context,
@@ -452,6 +691,10 @@ class _StorageSettingsState extends State<StorageSettings> {
             Text('占用空间: ${stats.formattedSize}'),
             const SizedBox(height: 8),
             Text('已缓存 ${stats.totalFiles} 首歌曲'),
+            if (summary != null) ...[
+              const SizedBox(height: 8),
+              Text(summary),
+            ],
           ],
         ),
         actions: [
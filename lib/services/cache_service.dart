@@ -10,6 +10,8 @@ import '../models/song_detail.dart';
 import 'package:http/http.dart' as http;
 import 'package:path/path.dart' as path;
 import 'audio_quality_service.dart';
+import 'native_cache_index_service.dart';
+import 'native_cache_stream_service.dart';
 
 /// 缓存元数据模型
 class CacheMetadata {
@@ -89,6 +91,10 @@ class CacheStats {
   final int qqCount;
   final int kugouCount;
   final int kuwoCount;
+  // 容量上限（字节），0 表示不限
+  final int sizeLimit;
+  // 命中与清理统计；不支持原生索引的平台为 null
+  final CacheEvictionMetrics? metrics;
 
   CacheStats({
     required this.totalFiles,
@@ -98,15 +104,19 @@ class CacheStats {
     required this.qqCount,
     required this.kugouCount,
     required this.kuwoCount,
+    this.sizeLimit = 0,
+    this.metrics,
   });
 
-  String get formattedSize {
-    if (totalSize < 1024) return '$totalSize B';
-    if (totalSize < 1024 * 1024) return '${(totalSize / 1024).toStringAsFixed(2)} KB';
-    if (totalSize < 1024 * 1024 * 1024) {
-      return '${(totalSize / (1024 * 1024)).toStringAsFixed(2)} MB';
+  String get formattedSize => formatBytes(totalSize);
+
+  static String formatBytes(int bytes) {
+    if (bytes < 1024) return '$bytes B';
+    if (bytes < 1024 * 1024) return '${(bytes / 1024).toStringAsFixed(2)} KB';
+    if (bytes < 1024 * 1024 * 1024) {
+      return '${(bytes / (1024 * 1024)).toStringAsFixed(2)} MB';
     }
-    return '${(totalSize / (1024 * 1024 * 1024)).toStringAsFixed(2)} GB';
+    return '${(bytes / (1024 * 1024 * 1024)).toStringAsFixed(2)} GB';
   }
 }
 
@@ -119,17 +129,37 @@ class CacheService extends ChangeNotifier {
   // 加密密钥（用于简单的异或加密）
   static const String _encryptionKey = 'CyreneMusicCacheKey2025';
 
+  // 流式写入：每次交给原生层的字节数，以及元数据预留空间的余量
+  // （文件大小位数、时间戳长度可能与占位元数据不同）
+  static const int _writeChunkSize = 256 * 1024;
+  static const int _metadataSlack = 64;
+
+  // 默认缓存容量上限
+  static const int defaultCacheSizeLimit = 4 * 1024 * 1024 * 1024;
+
   Directory? _cacheDir;
+  // 缓存键 -> 音频大小，所有平台都完整保存，供同步查询与统计
+  Map<String, int> _cachedSizes = {};
+  // 缓存键 -> 元数据。整文件 JSON 索引下为全部条目；
+  // 原生索引下只保存读取过的条目，其余按需从原生层读取
   Map<String, CacheMetadata> _cacheIndex = {};
+  bool _useNativeIndex = false;
   bool _isInitialized = false;
   bool _cacheEnabled = false;  // 缓存开关，默认关闭
   String? _customCacheDir;    // 自定义缓存目录
+  int _cacheSizeLimit = defaultCacheSizeLimit;  // 容量上限（字节），0 为不限
+  CacheEvictionPolicy _evictionPolicy = CacheEvictionPolicy.lru;
 
   bool get isInitialized => _isInitialized;
-  int get cachedCount => _cacheIndex.length;
+  int get cachedCount => _cachedSizes.length;
   bool get cacheEnabled => _cacheEnabled;
   String? get customCacheDir => _customCacheDir;
   String? get currentCacheDir => _cacheDir?.path;
+  int get cacheSizeLimit => _cacheSizeLimit;
+  CacheEvictionPolicy get evictionPolicy => _evictionPolicy;
+
+  /// 是否支持容量上限与自动清理（需要原生缓存索引）
+  bool get supportsEviction => _useNativeIndex;
 
   /// 初始化缓存服务
   Future<void> initialize() async {
@@ -192,7 +222,7 @@ class CacheService extends ChangeNotifier {
       notifyListeners();
 
       print('✅ [CacheService] 缓存服务初始化完成！');
-      print('📊 [CacheService] 已缓存歌曲数: ${_cacheIndex.length}');
+      print('📊 [CacheService] 已缓存歌曲数: ${_cachedSizes.length}');
       print('📁 [CacheService] 缓存位置: ${_cacheDir!.path}');
     } catch (e, stackTrace) {
       print('❌ [CacheService] 初始化失败: $e');
@@ -243,11 +273,11 @@ class CacheService extends ChangeNotifier {
       track.source,
     );
 
-    return _cacheIndex.containsKey(cacheKey);
+    return _cachedSizes.containsKey(cacheKey);
   }
 
   /// 获取缓存的元数据
-  CacheMetadata? getCachedMetadata(Track track) {
+  Future<CacheMetadata?> getCachedMetadata(Track track) async {
     if (!_isInitialized || !_cacheEnabled) return null;
 
     final cacheKey = _generateCacheKey(
@@ -255,7 +285,7 @@ class CacheService extends ChangeNotifier {
       track.source,
     );
 
-    return _cacheIndex[cacheKey];
+    return _metadataFor(cacheKey);
   }
 
   /// 获取缓存文件路径（用于播放）
@@ -272,15 +302,28 @@ class CacheService extends ChangeNotifier {
 
     final cacheFilePath = _getCacheFilePath(cacheKey);
     final cacheFile = File(cacheFilePath);
-    final metadata = _cacheIndex[cacheKey]!;
+    final metadata = await _metadataFor(cacheKey);
 
-    if (!await cacheFile.exists()) {
+    if (metadata == null || !await cacheFile.exists()) {
       print('⚠️ [CacheService] 缓存文件不存在: $cacheFilePath');
-      _cacheIndex.remove(cacheKey);
-      await _saveCacheIndex();
+      await _indexRemove(cacheKey);
       return null;
     }
 
+    // 记录使用时间（原生索引只追加一条记录）
+    await _indexTouch(cacheKey);
+
+    // 🔍 优化：根据音质选择正确的文件后缀
+    final extension = AudioQualityService.getExtensionFromLevel(metadata.quality);
+
+    // 桌面端由原生层边读边解密，无需生成临时文件
+    final streamUrl =
+        await NativeCacheStreamService().open(cacheFilePath, extension);
+    if (streamUrl != null) {
+      print('✅ [CacheService] 串流缓存文件: $streamUrl');
+      return streamUrl;
+    }
+
     // 读取并解析 .cyrene 文件
     try {
       final fileData = await cacheFile.readAsBytes();
@@ -308,9 +351,6 @@ class CacheService extends ChangeNotifier {
       // 解密音频数据
       final decryptedData = _decryptData(encryptedAudioData);
 
-      // 🔍 优化：根据音质选择正确的文件后缀
-      final extension = AudioQualityService.getExtensionFromLevel(metadata.quality);
-
       // 创建临时文件
       final tempDir = await getTemporaryDirectory();
       final tempFilePath = '${tempDir.path}/temp_${cacheKey}_${DateTime.now().millisecondsSinceEpoch}.$extension';
@@ -321,12 +361,23 @@ class CacheService extends ChangeNotifier {
       return tempFilePath;
     } catch (e) {
       print('❌ [CacheService] 解密缓存失败: $e');
-      _cacheIndex.remove(cacheKey);
-      await _saveCacheIndex();
+      await _indexRemove(cacheKey);
       return null;
     }
   }
 
+  /// 释放 [getCachedFilePath] 返回的路径：关闭串流地址或删除临时文件
+  Future<void> releaseCachedFilePath(String filePath) async {
+    if (NativeCacheStreamService.isStreamUrl(filePath)) {
+      await NativeCacheStreamService().close(filePath);
+      return;
+    }
+    final file = File(filePath);
+    if (await file.exists()) {
+      await file.delete();
+    }
+  }
+
   /// 缓存歌曲
   Future<bool> cacheSong(
     Track track,
@@ -357,78 +408,22 @@ class CacheService extends ChangeNotifier {
       }
 
       // 检查是否已缓存
-      if (_cacheIndex.containsKey(cacheKey)) {
+      if (_cachedSizes.containsKey(cacheKey)) {
         print('ℹ️ [CacheService] 歌曲已缓存: ${track.name}');
         return true;
       }
 
       print('💾 [CacheService] 开始缓存: ${track.name} (${track.getSourceName()})');
 
-      // 下载音频数据
-      final response = await http.get(Uri.parse(songDetail.url));
-      if (response.statusCode != 200) {
-        print('❌ [CacheService] 下载失败: ${response.statusCode}');
-        return false;
-      }
-
-      final audioData = response.bodyBytes;
-      print('📥 [CacheService] 下载完成: ${audioData.length} bytes');
-
-      // 计算校验和
-      final checksum = _calculateChecksum(audioData);
-
-      // 加密音频数据
-      final encryptedAudioData = _encryptData(audioData);
-
-      // 创建元数据
-      final metadata = CacheMetadata(
-        songId: track.id.toString(),
-        songName: track.name,
-        artists: track.artists,
-        album: track.album,
-        picUrl: track.picUrl,
-        source: track.source.name,
-        quality: quality,
-        originalUrl: songDetail.url,
-        fileSize: audioData.length,
-        cachedAt: DateTime.now(),
-        checksum: checksum,
-        lyric: songDetail.lyric,
-        tlyric: songDetail.tlyric,
-      );
-
-      // 将元数据转换为字节
-      final metadataJson = jsonEncode(metadata.toJson());
-      final metadataBytes = utf8.encode(metadataJson);
-      final metadataLength = metadataBytes.length;
-
-      // 构建 .cyrene 文件
-      // 格式: [4字节元数据长度] [元数据JSON] [加密的音频数据]
-      final cyreneFile = BytesBuilder();
-      
-      // 写入元数据长度（4字节，大端序）
-      cyreneFile.addByte((metadataLength >> 24) & 0xFF);
-      cyreneFile.addByte((metadataLength >> 16) & 0xFF);
-      cyreneFile.addByte((metadataLength >> 8) & 0xFF);
-      cyreneFile.addByte(metadataLength & 0xFF);
-      
-      // 写入元数据
-      cyreneFile.add(metadataBytes);
-      
-      // 写入加密的音频数据
-      cyreneFile.add(encryptedAudioData);
-
-      // 保存 .cyrene 文件
       final cacheFilePath = _getCacheFilePath(cacheKey);
-      final cacheFile = File(cacheFilePath);
-      await cacheFile.writeAsBytes(cyreneFile.toBytes());
-
-      print('🔒 [CacheService] 保存缓存文件: $cacheFilePath');
-      print('📊 [CacheService] 文件大小: ${cyreneFile.length} bytes (元数据: $metadataLength bytes)');
+      final metadata = NativeCacheStreamService.isSupported
+          ? await _writeCacheFileStreaming(
+              track, songDetail, quality, cacheFilePath)
+          : await _writeCacheFile(track, songDetail, quality, cacheFilePath);
+      if (metadata == null) return false;
 
       // 更新缓存索引
-      _cacheIndex[cacheKey] = metadata;
-      await _saveCacheIndex();
+      await _indexPut(cacheKey, metadata);
 
       print('✅ [CacheService] 缓存完成: ${track.name}');
       notifyListeners();
@@ -440,8 +435,186 @@ class CacheService extends ChangeNotifier {
     }
   }
 
+  CacheMetadata _buildMetadata(
+    Track track,
+    SongDetail songDetail,
+    String quality, {
+    required int fileSize,
+    required String checksum,
+  }) {
+    return CacheMetadata(
+      songId: track.id.toString(),
+      songName: track.name,
+      artists: track.artists,
+      album: track.album,
+      picUrl: track.picUrl,
+      source: track.source.name,
+      quality: quality,
+      originalUrl: songDetail.url,
+      fileSize: fileSize,
+      cachedAt: DateTime.now(),
+      checksum: checksum,
+      lyric: songDetail.lyric,
+      tlyric: songDetail.tlyric,
+    );
+  }
+
+  /// 下载并写入 .cyrene 文件（整体在内存中处理），成功时返回元数据
+  Future<CacheMetadata?> _writeCacheFile(
+    Track track,
+    SongDetail songDetail,
+    String quality,
+    String cacheFilePath,
+  ) async {
+    // 下载音频数据
+    final response = await http.get(Uri.parse(songDetail.url));
+    if (response.statusCode != 200) {
+      print('❌ [CacheService] 下载失败: ${response.statusCode}');
+      return null;
+    }
+
+    final audioData = response.bodyBytes;
+    print('📥 [CacheService] 下载完成: ${audioData.length} bytes');
+
+    // 计算校验和
+    final checksum = _calculateChecksum(audioData);
+
+    // 加密音频数据
+    final encryptedAudioData = _encryptData(audioData);
+
+    // 创建元数据
+    final metadata = _buildMetadata(
+      track,
+      songDetail,
+      quality,
+      fileSize: audioData.length,
+      checksum: checksum,
+    );
+
+    // 将元数据转换为字节
+    final metadataJson = jsonEncode(metadata.toJson());
+    final metadataBytes = utf8.encode(metadataJson);
+    final metadataLength = metadataBytes.length;
+
+    // 构建 .cyrene 文件
+    // 格式: [4字节元数据长度] [元数据JSON] [加密的音频数据]
+    final cyreneFile = BytesBuilder();
+
+    // 写入元数据长度（4字节，大端序）
+    cyreneFile.addByte((metadataLength >> 24) & 0xFF);
+    cyreneFile.addByte((metadataLength >> 16) & 0xFF);
+    cyreneFile.addByte((metadataLength >> 8) & 0xFF);
+    cyreneFile.addByte(metadataLength & 0xFF);
+
+    // 写入元数据
+    cyreneFile.add(metadataBytes);
+
+    // 写入加密的音频数据
+    cyreneFile.add(encryptedAudioData);
+
+    // 先写临时文件再改名：正在串流的旧文件不会被截断，中断时也不会留下残缺文件
+    final partialFile = File('$cacheFilePath.tmp');
+    await partialFile.writeAsBytes(cyreneFile.toBytes(), flush: true);
+    await partialFile.rename(cacheFilePath);
+
+    print('🔒 [CacheService] 保存缓存文件: $cacheFilePath');
+    print('📊 [CacheService] 文件大小: ${cyreneFile.length} bytes (元数据: $metadataLength bytes)');
+    return metadata;
+  }
+
+  /// 边下载边交给原生层加密、计算校验和并写入 .cyrene 文件，
+  /// 内存占用与歌曲大小无关；成功时返回元数据
+  Future<CacheMetadata?> _writeCacheFileStreaming(
+    Track track,
+    SongDetail songDetail,
+    String quality,
+    String cacheFilePath,
+  ) async {
+    final client = http.Client();
+    NativeCacheWriter? writer;
+    try {
+      final response =
+          await client.send(http.Request('GET', Uri.parse(songDetail.url)));
+      if (response.statusCode != 200) {
+        print('❌ [CacheService] 下载失败: ${response.statusCode}');
+        return null;
+      }
+
+      // 元数据写在音频之前，但大小与校验和要到下载结束才知道：
+      // 先按占位元数据预留空间，完成后原地写入
+      final placeholder = _buildMetadata(
+        track,
+        songDetail,
+        quality,
+        fileSize: response.contentLength ?? 0,
+        checksum: '0' * 32,
+      );
+      final reserve =
+          utf8.encode(jsonEncode(placeholder.toJson())).length +
+              _metadataSlack;
+      writer = await NativeCacheWriter.begin(cacheFilePath, reserve);
+      if (writer == null) return null;
+
+      // 攒够一块再过通道，减少调用次数
+      final pending = BytesBuilder(copy: false);
+      await for (final chunk in response.stream) {
+        pending.add(chunk);
+        if (pending.length >= _writeChunkSize) {
+          await writer.add(pending.takeBytes());
+        }
+      }
+      if (pending.isNotEmpty) {
+        await writer.add(pending.takeBytes());
+      }
+
+      final digest = await writer.digest();
+      print('📥 [CacheService] 下载完成: ${digest.size} bytes');
+      final metadata = _buildMetadata(
+        track,
+        songDetail,
+        quality,
+        fileSize: digest.size,
+        checksum: digest.checksum,
+      );
+      final metadataJson = jsonEncode(metadata.toJson());
+      final committing = writer;
+      writer = null;
+      await committing.commit(metadataJson);
+
+      print('🔒 [CacheService] 保存缓存文件: $cacheFilePath');
+      return metadata;
+    } finally {
+      client.close();
+      // 中途失败时删除未完成的文件
+      await writer?.abort();
+    }
+  }
+
   /// 加载缓存索引
   Future<void> _loadCacheIndex() async {
+    if (NativeCacheIndexService.isSupported) {
+      final sizes = await NativeCacheIndexService()
+          .open('${_cacheDir!.path}/cache_index.log');
+      if (sizes != null) {
+        _useNativeIndex = true;
+        _cacheIndex = {};
+        _cachedSizes = sizes;
+        await _migrateLegacyCacheIndex();
+        print('📑 [CacheService] 加载缓存索引: ${_cachedSizes.length} 条记录');
+        await _configureEviction();
+        return;
+      }
+      // 原生索引不可用时沿用整文件 JSON 索引
+    }
+
+    _cacheIndex = await _readLegacyCacheIndex() ?? {};
+    _cachedSizes = {
+      for (final entry in _cacheIndex.entries) entry.key: entry.value.fileSize,
+    };
+  }
+
+  /// 读取整文件 JSON 索引（cache_index.cyrene）；不存在或损坏时返回 null
+  Future<Map<String, CacheMetadata>?> _readLegacyCacheIndex() async {
     try {
       final indexFile = File('${_cacheDir!.path}/cache_index.cyrene');
 
@@ -456,24 +629,50 @@ class CacheService extends ChangeNotifier {
         final indexJson = utf8.decode(decryptedData);
         
         final indexData = jsonDecode(indexJson);
-        _cacheIndex = {};
+        final index = <String, CacheMetadata>{};
 
         for (final entry in (indexData as Map<String, dynamic>).entries) {
-          _cacheIndex[entry.key] = CacheMetadata.fromJson(entry.value);
+          index[entry.key] = CacheMetadata.fromJson(entry.value);
         }
 
-        print('📑 [CacheService] 加载缓存索引: ${_cacheIndex.length} 条记录');
+        print('📑 [CacheService] 加载缓存索引: ${index.length} 条记录');
+        return index;
       } else {
         print('📑 [CacheService] 缓存索引不存在，创建新索引');
-        _cacheIndex = {};
+        return null;
       }
     } catch (e) {
       print('❌ [CacheService] 加载缓存索引失败: $e');
-      _cacheIndex = {};
+      return null;
+    }
+  }
+
+  /// 把旧的整文件索引导入原生索引，成功后删除旧文件
+  Future<void> _migrateLegacyCacheIndex() async {
+    final legacyFile = File('${_cacheDir!.path}/cache_index.cyrene');
+    if (!await legacyFile.exists()) return;
+
+    final legacy = await _readLegacyCacheIndex();
+    if (legacy == null) return;
+    try {
+      final entries =
+          legacy.entries.where((e) => !_cachedSizes.containsKey(e.key)).toList();
+      await NativeCacheIndexService().putAll(
+        [for (final e in entries) e.key],
+        [for (final e in entries) e.value.fileSize],
+        [for (final e in entries) jsonEncode(e.value.toJson())],
+      );
+      for (final e in entries) {
+        _cachedSizes[e.key] = e.value.fileSize;
+      }
+      await legacyFile.delete();
+      print('📑 [CacheService] 已迁移旧缓存索引: ${entries.length} 条记录');
+    } catch (e) {
+      print('❌ [CacheService] 迁移旧缓存索引失败: $e');
     }
   }
 
-  /// 保存缓存索引
+  /// 保存缓存索引（整文件 JSON，仅在未使用原生索引时）
   Future<void> _saveCacheIndex() async {
     try {
       final indexFile = File('${_cacheDir!.path}/cache_index.cyrene');
@@ -498,6 +697,85 @@ class CacheService extends ChangeNotifier {
     }
   }
 
+  /// 读取元数据：先查内存，原生索引下再向原生层读取
+  Future<CacheMetadata?> _metadataFor(String cacheKey) async {
+    final cached = _cacheIndex[cacheKey];
+    if (cached != null || !_useNativeIndex) return cached;
+    if (!_cachedSizes.containsKey(cacheKey)) return null;
+    try {
+      final json = await NativeCacheIndexService().get(cacheKey);
+      if (json == null) return null;
+      return _cacheIndex[cacheKey] = CacheMetadata.fromJson(jsonDecode(json));
+    } catch (e) {
+      print('❌ [CacheService] 读取缓存元数据失败: $e');
+      return null;
+    }
+  }
+
+  Future<void> _indexPut(String cacheKey, CacheMetadata metadata) async {
+    _cachedSizes[cacheKey] = metadata.fileSize;
+    _cacheIndex[cacheKey] = metadata;
+    if (_useNativeIndex) {
+      _dropEvicted(await NativeCacheIndexService()
+          .put(cacheKey, metadata.fileSize, jsonEncode(metadata.toJson())));
+    } else {
+      await _saveCacheIndex();
+    }
+  }
+
+  Future<void> _indexRemove(String cacheKey) async {
+    _cachedSizes.remove(cacheKey);
+    _cacheIndex.remove(cacheKey);
+    if (_useNativeIndex) {
+      await NativeCacheIndexService().remove(cacheKey);
+    } else {
+      await _saveCacheIndex();
+    }
+  }
+
+  Future<void> _indexTouch(String cacheKey) async {
+    if (!_useNativeIndex) return;
+    try {
+      await NativeCacheIndexService().touch(cacheKey);
+    } catch (e) {
+      print('⚠️ [CacheService] 更新缓存使用时间失败: $e');
+    }
+  }
+
+  /// 把原生层清理掉的歌曲从内存索引中移除（文件由原生层删除）
+  void _dropEvicted(List<String> evicted) {
+    if (evicted.isEmpty) return;
+    for (final cacheKey in evicted) {
+      _cachedSizes.remove(cacheKey);
+      _cacheIndex.remove(cacheKey);
+    }
+    print('🧹 [CacheService] 超出容量上限，已自动清理 ${evicted.length} 首歌曲');
+  }
+
+  /// 把容量上限与淘汰策略交给原生层，并按新上限清理
+  Future<void> _configureEviction() async {
+    if (!_useNativeIndex) return;
+    try {
+      _dropEvicted(await NativeCacheIndexService().configure(
+        _cacheDir!.path,
+        _cacheSizeLimit,
+        _evictionPolicy,
+      ));
+    } catch (e) {
+      print('❌ [CacheService] 设置缓存容量上限失败: $e');
+    }
+  }
+
+  Future<void> _indexClear() async {
+    _cachedSizes.clear();
+    _cacheIndex.clear();
+    if (_useNativeIndex) {
+      await NativeCacheIndexService().clear();
+    } else {
+      await _saveCacheIndex();
+    }
+  }
+
   /// 获取缓存统计信息
   Future<CacheStats> getCacheStats() async {
     int totalSize = 0;
@@ -507,10 +785,12 @@ class CacheService extends ChangeNotifier {
     int kugouCount = 0;
     int kuwoCount = 0;
 
-    for (final metadata in _cacheIndex.values) {
-      totalSize += metadata.fileSize;
+    for (final entry in _cachedSizes.entries) {
+      totalSize += entry.value;
 
-      switch (metadata.source) {
+      // 缓存键为 "<来源>_<歌曲ID>"
+      final source = entry.key.split('_').first;
+      switch (source) {
         case 'netease':
           neteaseCount++;
           break;
@@ -530,40 +810,78 @@ class CacheService extends ChangeNotifier {
     }
 
     return CacheStats(
-      totalFiles: _cacheIndex.length,
+      totalFiles: _cachedSizes.length,
       totalSize: totalSize,
       neteaseCount: neteaseCount,
       appleCount: appleCount,
       qqCount: qqCount,
       kugouCount: kugouCount,
       kuwoCount: kuwoCount,
+      sizeLimit: _useNativeIndex ? _cacheSizeLimit : 0,
+      metrics:
+          _useNativeIndex ? await NativeCacheIndexService().metrics() : null,
     );
   }
 
+  /// 记录一次缓存未命中（缓存已启用但歌曲未缓存）
+  void recordMiss() {
+    if (!_isInitialized || !_cacheEnabled || !_useNativeIndex) return;
+    NativeCacheIndexService().miss().catchError((e) {
+      print('⚠️ [CacheService] 记录缓存未命中失败: $e');
+    });
+  }
+
   /// 清除所有缓存
   Future<void> clearAllCache() async {
     if (!_isInitialized) return;
 
-    try {
-      print('🗑️ [CacheService] 清除所有缓存...');
+    print('🗑️ [CacheService] 清除所有缓存...');
 
-      // 删除所有缓存文件
+    // 删除所有缓存文件（原生索引日志由原生层清空）。逐个处理：正在播放的
+    // 歌曲由原生层映射并提供给播放器，Windows 下删除会失败，这类文件保留
+    // 在索引中，其余文件照常删除
+    final kept = <String, CacheMetadata>{};
+    var failed = 0;
+    try {
       final files = await _cacheDir!.list().toList();
       for (final file in files) {
-        if (file is File) {
+        if (file is! File ||
+            (_useNativeIndex &&
+                path.basename(file.path).startsWith('cache_index.log'))) {
+          continue;
+        }
+        try {
           await file.delete();
+        } catch (e) {
+          failed++;
+          print('⚠️ [CacheService] 无法删除 ${file.path}: $e');
+          final name = path.basename(file.path);
+          if (!name.endsWith('.cyrene')) continue;
+          final cacheKey = name.substring(0, name.length - '.cyrene'.length);
+          final metadata = await _metadataFor(cacheKey);
+          if (metadata != null) kept[cacheKey] = metadata;
         }
       }
+    } catch (e) {
+      print('❌ [CacheService] 列出缓存文件失败: $e');
+    }
 
-      // 清空索引
-      _cacheIndex.clear();
-      await _saveCacheIndex();
+    // 无论删除是否全部成功都清空索引，再记回仍在磁盘上的文件
+    try {
+      await _indexClear();
+      for (final entry in kept.entries) {
+        await _indexPut(entry.key, entry.value);
+      }
+    } catch (e) {
+      print('❌ [CacheService] 清空缓存索引失败: $e');
+    }
 
+    if (failed == 0) {
       print('✅ [CacheService] 缓存已清除');
-      notifyListeners();
-    } catch (e) {
-      print('❌ [CacheService] 清除缓存失败: $e');
+    } else {
+      print('⚠️ [CacheService] 缓存已清除，$failed 个文件正在使用未能删除');
     }
+    notifyListeners();
   }
 
   /// 删除单个缓存
@@ -576,7 +894,7 @@ class CacheService extends ChangeNotifier {
         track.source,
       );
 
-      if (!_cacheIndex.containsKey(cacheKey)) {
+      if (!_cachedSizes.containsKey(cacheKey)) {
         return;
       }
 
@@ -588,8 +906,7 @@ class CacheService extends ChangeNotifier {
       }
 
       // 从索引中移除
-      _cacheIndex.remove(cacheKey);
-      await _saveCacheIndex();
+      await _indexRemove(cacheKey);
 
       print('🗑️ [CacheService] 删除缓存: ${track.name}');
       notifyListeners();
@@ -599,9 +916,13 @@ class CacheService extends ChangeNotifier {
   }
 
   /// 获取缓存列表
-  List<CacheMetadata> getCachedList() {
-    return _cacheIndex.values.toList()
-      ..sort((a, b) => b.cachedAt.compareTo(a.cachedAt));
+  Future<List<CacheMetadata>> getCachedList() async {
+    final list = <CacheMetadata>[];
+    for (final cacheKey in _cachedSizes.keys.toList()) {
+      final metadata = await _metadataFor(cacheKey);
+      if (metadata != null) list.add(metadata);
+    }
+    return list..sort((a, b) => b.cachedAt.compareTo(a.cachedAt));
   }
 
   /// 清理临时文件
@@ -639,6 +960,24 @@ class CacheService extends ChangeNotifier {
       
       // 加载自定义缓存目录
       _customCacheDir = prefs.getString('custom_cache_dir');
+
+      // 加载容量上限与淘汰策略
+      final savedLimit = prefs.getInt('cache_size_limit');
+      if (savedLimit != null) {
+        _cacheSizeLimit = savedLimit;
+      } else if (prefs.containsKey('cache_enabled')) {
+        // 升级前已在使用缓存的安装：保持原来的不限容量，避免首次启动就
+        // 把超出默认上限的歌曲淘汰掉；用户可在设置里自行设定上限
+        _cacheSizeLimit = 0;
+        await prefs.setInt('cache_size_limit', 0);
+        print('⚙️ [CacheService] 已有缓存沿用不限容量');
+      } else {
+        _cacheSizeLimit = defaultCacheSizeLimit;
+      }
+      _evictionPolicy = CacheEvictionPolicy.values.firstWhere(
+        (p) => p.name == prefs.getString('cache_eviction_policy'),
+        orElse: () => CacheEvictionPolicy.lru,
+      );
       
       print('⚙️ [CacheService] 加载设置 - 缓存开关: $_cacheEnabled, 自定义目录: ${_customCacheDir ?? "无"}');
     } catch (e) {
@@ -685,6 +1024,35 @@ class CacheService extends ChangeNotifier {
     }
   }
 
+  /// 设置缓存容量上限（字节，0 为不限），超出部分立即清理
+  Future<void> setCacheSizeLimit(int bytes) async {
+    if (_cacheSizeLimit == bytes) return;
+    _cacheSizeLimit = bytes;
+    try {
+      final prefs = await SharedPreferences.getInstance();
+      await prefs.setInt('cache_size_limit', bytes);
+    } catch (e) {
+      print('❌ [CacheService] 保存缓存容量上限失败: $e');
+    }
+    await _configureEviction();
+    print('🔧 [CacheService] 缓存容量上限: ${bytes == 0 ? "不限" : CacheStats.formatBytes(bytes)}');
+    notifyListeners();
+  }
+
+  /// 设置缓存淘汰策略
+  Future<void> setEvictionPolicy(CacheEvictionPolicy policy) async {
+    if (_evictionPolicy == policy) return;
+    _evictionPolicy = policy;
+    try {
+      final prefs = await SharedPreferences.getInstance();
+      await prefs.setString('cache_eviction_policy', policy.name);
+    } catch (e) {
+      print('❌ [CacheService] 保存缓存淘汰策略失败: $e');
+    }
+    await _configureEviction();
+    notifyListeners();
+  }
+
   /// 设置自定义缓存目录
   Future<bool> setCustomCacheDir(String? dirPath) async {
     try {
@@ -7,6 +7,8 @@ import 'package:http/http.dart' as http;
 import 'package:image/image.dart' as img;
 import 'package:cached_network_image/cached_network_image.dart';
 
+import 'native_palette_extractor.dart';
+
 /// 颜色提取结果
 class ColorExtractionResult {
   final Color? vibrantColor;
@@ -55,7 +57,7 @@ class ColorExtractionResult {
   }
 }
 
-/// 颜色提取服务 - 使用 isolate 避免阻塞主线程
+/// 颜色提取服务 - 桌面端使用原生取色线程，其它平台使用 isolate，避免阻塞主线程
 class ColorExtractionService {
   static final ColorExtractionService _instance = ColorExtractionService._internal();
   factory ColorExtractionService() => _instance;
@@ -124,9 +126,8 @@ class ColorExtractionService {
         imageBytes = await file.readAsBytes();
       }
 
-      // 2. 在 isolate 中解码图片并提取颜色（使用纯 Dart 的 image 包）
-      final result = await compute(
-        _extractColorsInIsolate,
+      // 2. 解码图片并提取颜色（桌面端交给原生取色线程，其它平台在 isolate 中处理）
+      final result = await _extractColors(
         _ColorExtractionParams(
           imageBytes: imageBytes,
           sampleSize: sampleSize,
@@ -194,9 +195,8 @@ class ColorExtractionService {
         imageBytes = await file.readAsBytes();
       }
 
-      // 在 isolate 中处理（裁剪 + 缩放 + 提取）
-      final result = await compute(
-        _extractColorsInIsolate,
+      // 解码后裁剪 + 缩放 + 提取
+      final result = await _extractColors(
         _ColorExtractionParams(
           imageBytes: imageBytes,
           sampleSize: sampleSize,
@@ -269,6 +269,18 @@ class ColorExtractionService {
       final imageInfo = await _loadImageFromProvider(provider, timeout);
       
       if (imageInfo != null) {
+        // 原生取色直接读取已解码的像素，省去 PNG 编码再解码
+        if (NativePaletteExtractor().isAvailable) {
+          final pixels = await _readRgba(imageInfo.image);
+          if (pixels != null) {
+            final result = await _extractNative(pixels, sampleSize, region);
+            if (result != null) {
+              _cacheResult(cacheKey, result);
+            }
+            return result;
+          }
+        }
+
         // 将图片转换为字节数据
         final byteData = await imageInfo.image.toByteData(format: ui.ImageByteFormat.png);
         if (byteData == null) {
@@ -279,8 +291,7 @@ class ColorExtractionService {
         final imageBytes = byteData.buffer.asUint8List();
         debugPrint('🎨 [ColorExtraction] 从 ImageProvider 提取颜色 (${imageBytes.length} bytes)');
         
-        final result = await compute(
-          _extractColorsInIsolate,
+        final result = await _extractColors(
           _ColorExtractionParams(
             imageBytes: imageBytes,
             sampleSize: sampleSize,
@@ -305,6 +316,84 @@ class ColorExtractionService {
     }
   }
 
+  /// 解码图片并提取颜色：桌面端用引擎解码后交给原生取色线程，
+  /// 其它平台（或原生不可用、解码失败时）在 isolate 中用 image 包处理
+  Future<ColorExtractionResult?> _extractColors(
+    _ColorExtractionParams params,
+  ) async {
+    if (NativePaletteExtractor().isAvailable) {
+      final pixels = await _decodeRgba(params.imageBytes);
+      if (pixels != null) {
+        return _extractNative(pixels, params.sampleSize, params.region);
+      }
+    }
+    return compute(_extractColorsInIsolate, params);
+  }
+
+  /// 用引擎解码图片为直通 alpha 的 RGBA 像素
+  Future<_RgbaImage?> _decodeRgba(Uint8List imageBytes) async {
+    try {
+      final codec = await ui.instantiateImageCodec(imageBytes);
+      try {
+        final frame = await codec.getNextFrame();
+        try {
+          return await _readRgba(frame.image);
+        } finally {
+          frame.image.dispose();
+        }
+      } finally {
+        codec.dispose();
+      }
+    } catch (e) {
+      debugPrint('⚠️ [ColorExtraction] 引擎解码失败，改用 image 包: $e');
+      return null;
+    }
+  }
+
+  Future<_RgbaImage?> _readRgba(ui.Image image) async {
+    final byteData =
+        await image.toByteData(format: ui.ImageByteFormat.rawStraightRgba);
+    if (byteData == null) return null;
+    return _RgbaImage(
+      byteData.buffer.asUint8List(byteData.offsetInBytes, byteData.lengthInBytes),
+      image.width,
+      image.height,
+    );
+  }
+
+  Future<ColorExtractionResult?> _extractNative(
+    _RgbaImage pixels,
+    int sampleSize,
+    Rect? region,
+  ) async {
+    final colors = await NativePaletteExtractor().extract(
+      pixels.bytes,
+      pixels.width,
+      pixels.height,
+      region: region == null
+          ? null
+          : [
+              region.left.toInt(),
+              region.top.toInt(),
+              region.width.toInt(),
+              region.height.toInt(),
+            ],
+      sampleSize: sampleSize,
+    );
+    if (colors == null) return null;
+
+    Color? color(int index) => colors[index] != 0 ? Color(colors[index]) : null;
+    return ColorExtractionResult(
+      vibrantColor: color(0),
+      mutedColor: color(1),
+      dominantColor: color(2),
+      lightVibrantColor: color(3),
+      darkVibrantColor: color(4),
+      lightMutedColor: color(5),
+      darkMutedColor: color(6),
+    );
+  }
+
   /// 从 ImageProvider 加载图片
   Future<ImageInfo?> _loadImageFromProvider(ImageProvider provider, Duration timeout) async {
     final completer = Completer<ImageInfo?>();
@@ -340,6 +429,15 @@ class ColorExtractionService {
   }
 }
 
+/// 已解码的 RGBA 像素
+class _RgbaImage {
+  final Uint8List bytes;
+  final int width;
+  final int height;
+
+  const _RgbaImage(this.bytes, this.width, this.height);
+}
+
 /// isolate 参数
 class _ColorExtractionParams {
   final Uint8List imageBytes;
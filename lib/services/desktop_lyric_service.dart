@@ -2,8 +2,9 @@ import 'dart:io';
 import 'package:flutter/services.dart';
 import 'package:shared_preferences/shared_preferences.dart';
 import 'dart:async';
+import '../models/lyric_line.dart';
 
-/// 桌面歌词服务（仅Windows平台）
+/// 桌面歌词服务（Windows / Linux 平台）
 /// 
 /// 提供系统级桌面歌词功能，包括：
 /// - 创建/销毁桌面歌词窗口
@@ -15,6 +16,9 @@ class DesktopLyricService {
   factory DesktopLyricService() => _instance;
   DesktopLyricService._internal();
 
+  /// 当前平台是否有原生桌面歌词窗口
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
   static const MethodChannel _channel = MethodChannel('desktop_lyric');
   
   // Playback control callback
@@ -35,12 +39,27 @@ class DesktopLyricService {
   static const String _keyMouseTransparent = 'desktop_lyric_mouse_transparent';
   static const String _keyShowTranslation = 'desktop_lyric_show_translation';
   static const String _keyIsVertical = 'desktop_lyric_is_vertical';
+  static const String _keyShowSpectrum = 'desktop_lyric_show_spectrum';
 
   bool _isCreated = false;
   bool _isVisible = false;
   String _currentLyric = '';
   String _currentTranslation = '';
 
+  // 当前歌曲的整首歌词（上传一次，换行只发送行号）
+  List<String> _sheetLyrics = const [];
+  List<String> _sheetTranslations = const [];
+  List<int> _sheetStartTimes = const [];
+  // 当前歌词表的上传（进行中或已成功），并发换行共用同一次上传；
+  // 换歌或窗口销毁后置空
+  Future<bool>? _sheetUpload;
+
+  // 当前歌曲信息和播放状态（窗口重新创建时恢复）
+  String? _songTitle;
+  String? _songArtist;
+  String? _songCover;
+  bool _isPlaying = false;
+
   // 默认配置
   int _fontSize = 32;
   int _textColor = 0xFFFFFFFF; // 白色
@@ -50,10 +69,11 @@ class DesktopLyricService {
   bool _isMouseTransparent = false;
   bool _showTranslation = true;
   bool _isVertical = false; // 纵向排列
+  bool _showSpectrum = false; // 歌词背后的频谱条
 
   /// 初始化服务（加载配置）
   Future<void> initialize() async {
-    if (!Platform.isWindows) return;
+    if (!isSupported) return;
 
     try {
       // Set up method call handler for callbacks from native
@@ -70,31 +90,12 @@ class DesktopLyricService {
       _isMouseTransparent = prefs.getBool(_keyMouseTransparent) ?? false;
       _showTranslation = prefs.getBool(_keyShowTranslation) ?? true;
       _isVertical = prefs.getBool(_keyIsVertical) ?? false;
+      _showSpectrum = prefs.getBool(_keyShowSpectrum) ?? false;
 
-      // 延迟创建窗口，确保不阻塞主窗口启动
+      // 只在启用时创建窗口（延迟到主窗口启动之后）；
+      // 未启用时原生插件保持为通道桩，不创建窗口和 GDI+ 资源
       Future.delayed(Duration(milliseconds: 500), () async {
         try {
-          // 创建窗口
-          await _createWindow();
-
-          // 应用配置
-          await setFontSize(_fontSize, saveToPrefs: false);
-          await setTextColor(_textColor, saveToPrefs: false);
-          await setStrokeColor(_strokeColor, saveToPrefs: false);
-          await setStrokeWidth(_strokeWidth, saveToPrefs: false);
-          await setDraggable(_isDraggable, saveToPrefs: false);
-          await setMouseTransparent(_isMouseTransparent, saveToPrefs: false);
-          await setShowTranslation(_showTranslation, saveToPrefs: false);
-          await setVertical(_isVertical, saveToPrefs: false);
-
-          // 恢复位置
-          final x = prefs.getInt(_keyPositionX);
-          final y = prefs.getInt(_keyPositionY);
-          if (x != null && y != null) {
-            await setPosition(x, y);
-          }
-
-          // 如果之前是启用状态，则显示窗口
           if (enabled) {
             await show();
           }
@@ -111,11 +112,12 @@ class DesktopLyricService {
 
   /// 创建桌面歌词窗口
   Future<bool> _createWindow() async {
-    if (!Platform.isWindows || _isCreated) return true;
+    if (!isSupported || _isCreated) return true;
 
     try {
       final result = await _channel.invokeMethod('create');
       _isCreated = result == true;
+      if (_isCreated) await _restoreWindowState();
       return _isCreated;
     } catch (e) {
       print('❌ [DesktopLyric] 创建窗口失败: $e');
@@ -123,9 +125,43 @@ class DesktopLyricService {
     }
   }
 
+  /// 窗口（重新）创建后应用配置、位置和当前歌曲状态
+  Future<void> _restoreWindowState() async {
+    await setFontSize(_fontSize, saveToPrefs: false);
+    await setTextColor(_textColor, saveToPrefs: false);
+    await setStrokeColor(_strokeColor, saveToPrefs: false);
+    await setStrokeWidth(_strokeWidth, saveToPrefs: false);
+    await setDraggable(_isDraggable, saveToPrefs: false);
+    await setMouseTransparent(_isMouseTransparent, saveToPrefs: false);
+    await setShowTranslation(_showTranslation, saveToPrefs: false);
+    await setVertical(_isVertical, saveToPrefs: false);
+    await setShowSpectrum(_showSpectrum, saveToPrefs: false);
+
+    final prefs = await SharedPreferences.getInstance();
+    final x = prefs.getInt(_keyPositionX);
+    final y = prefs.getInt(_keyPositionY);
+    if (x != null && y != null) {
+      await setPosition(x, y);
+    }
+
+    if (_songTitle != null) {
+      await setSongInfo(
+        title: _songTitle!,
+        artist: _songArtist ?? '',
+        albumCover: _songCover,
+      );
+    }
+    await setPlayingState(_isPlaying);
+
+    if (_currentLyric.isNotEmpty) await setLyricText(_currentLyric);
+    if (_currentTranslation.isNotEmpty) {
+      await setTranslationText(_currentTranslation);
+    }
+  }
+
   /// 显示桌面歌词
   Future<void> show() async {
-    if (!Platform.isWindows) return;
+    if (!isSupported) return;
     
     // 如果窗口还未创建，先创建
     if (!_isCreated) {
@@ -150,7 +186,7 @@ class DesktopLyricService {
 
   /// 隐藏桌面歌词
   Future<void> hide() async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported || !_isCreated) return;
 
     try {
       await _channel.invokeMethod('hide');
@@ -159,6 +195,18 @@ class DesktopLyricService {
       // 保存启用状态
       final prefs = await SharedPreferences.getInstance();
       await prefs.setBool(_keyEnabled, false);
+
+      // 关闭后销毁窗口，原生插件空闲一段时间后随之释放；
+      // 再次显示时重新创建并恢复配置和位置
+      final position = await getPosition();
+      if (position != null) {
+        await prefs.setInt(_keyPositionX, position['x']!);
+        await prefs.setInt(_keyPositionY, position['y']!);
+      }
+      await _channel.invokeMethod('destroy');
+      _isCreated = false;
+      // 新窗口没有歌词表，下次换行时重新上传
+      _sheetUpload = null;
     } catch (e) {
       print('❌ [DesktopLyric] 隐藏窗口失败: $e');
     }
@@ -175,7 +223,7 @@ class DesktopLyricService {
 
   /// 设置歌词文本
   Future<void> setLyricText(String text, {int? durationMs}) async {
-    if (!Platform.isWindows) return;
+    if (!isSupported) return;
     
     _currentLyric = text;
     
@@ -193,9 +241,76 @@ class DesktopLyricService {
     }
   }
   
+  /// 上传整首歌词（每首歌一次），之后用 [showLyricLine] 按行号切换
+  ///
+  /// 原生侧保留 UTF-8 文本并合并重复行，换行时不再传输字符串，
+  /// 每行时长也由原生侧按下一行的起始时间计算。
+  Future<void> setLyricSheet(List<LyricLine> lines) async {
+    if (!isSupported) return;
+
+    _sheetLyrics = lines.map((line) => line.text).toList(growable: false);
+    _sheetTranslations =
+        lines.map((line) => line.translation ?? '').toList(growable: false);
+    _sheetStartTimes = lines
+        .map((line) => line.startTime.inMilliseconds)
+        .toList(growable: false);
+    _sheetUpload = null;
+
+    // 如果窗口未创建，只保存歌词表，首次换行时再上传
+    if (!_isCreated) return;
+    await _ensureLyricSheet();
+  }
+
+  /// 上传当前歌词表，已在上传或已上传时等待那一次；失败后下次换行重试
+  Future<bool> _ensureLyricSheet() {
+    final pending = _sheetUpload;
+    if (pending != null) return pending;
+
+    late final Future<bool> upload;
+    upload = _uploadLyricSheet().then((ok) {
+      if (!ok && identical(_sheetUpload, upload)) _sheetUpload = null;
+      return ok;
+    });
+    _sheetUpload = upload;
+    return upload;
+  }
+
+  Future<bool> _uploadLyricSheet() async {
+    try {
+      await _channel.invokeMethod('setLyricSheet', {
+        'lyrics': _sheetLyrics,
+        'translations': _sheetTranslations,
+        'startTimes': _sheetStartTimes,
+      });
+      return true;
+    } catch (e) {
+      print('❌ [DesktopLyric] 上传歌词表失败: $e');
+      return false;
+    }
+  }
+
+  /// 显示歌词表中的第 [index] 行（歌词、翻译和滚动时长一次设置）
+  Future<void> showLyricLine(int index) async {
+    if (!isSupported) return;
+    if (index < 0 || index >= _sheetLyrics.length) return;
+
+    _currentLyric = _sheetLyrics[index];
+    _currentTranslation = _sheetTranslations[index];
+
+    // 如果窗口未创建，只保存歌词，不实际设置
+    if (!_isCreated) return;
+
+    try {
+      if (!await _ensureLyricSheet()) return;
+      await _channel.invokeMethod('showLyricLine', {'index': index});
+    } catch (e) {
+      print('❌ [DesktopLyric] 切换歌词行失败: $e');
+    }
+  }
+
   /// 设置歌词持续时间（用于计算滚动速度）
   Future<void> setLyricDuration(int durationMs) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported || !_isCreated) return;
     
     try {
       await _channel.invokeMethod('setLyricDuration', {'duration': durationMs});
@@ -210,7 +325,12 @@ class DesktopLyricService {
     required String artist,
     String? albumCover,
   }) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
+
+    _songTitle = title;
+    _songArtist = artist;
+    _songCover = albumCover;
+    if (!_isCreated) return;
 
     try {
       await _channel.invokeMethod('setSongInfo', {
@@ -225,7 +345,7 @@ class DesktopLyricService {
 
   /// 设置窗口位置
   Future<void> setPosition(int x, int y) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported || !_isCreated) return;
 
     try {
       await _channel.invokeMethod('setPosition', {'x': x, 'y': y});
@@ -241,7 +361,7 @@ class DesktopLyricService {
 
   /// 获取窗口位置
   Future<Map<String, int>?> getPosition() async {
-    if (!Platform.isWindows || !_isCreated) return null;
+    if (!isSupported || !_isCreated) return null;
 
     try {
       final result = await _channel.invokeMethod('getPosition');
@@ -257,17 +377,19 @@ class DesktopLyricService {
 
   /// 设置字体大小
   Future<void> setFontSize(int size, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _fontSize = size;
 
     try {
-      await _channel.invokeMethod('setFontSize', {'size': size});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setInt(_keyFontSize, size);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setFontSize', {'size': size});
     } catch (e) {
       print('❌ [DesktopLyric] 设置字体大小失败: $e');
     }
@@ -275,17 +397,19 @@ class DesktopLyricService {
 
   /// 设置文字颜色（ARGB格式）
   Future<void> setTextColor(int color, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _textColor = color;
 
     try {
-      await _channel.invokeMethod('setTextColor', {'color': color});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setInt(_keyTextColor, color);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setTextColor', {'color': color});
     } catch (e) {
       print('❌ [DesktopLyric] 设置文字颜色失败: $e');
     }
@@ -293,17 +417,19 @@ class DesktopLyricService {
 
   /// 设置描边颜色（ARGB格式）
   Future<void> setStrokeColor(int color, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _strokeColor = color;
 
     try {
-      await _channel.invokeMethod('setStrokeColor', {'color': color});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setInt(_keyStrokeColor, color);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setStrokeColor', {'color': color});
     } catch (e) {
       print('❌ [DesktopLyric] 设置描边颜色失败: $e');
     }
@@ -311,17 +437,19 @@ class DesktopLyricService {
 
   /// 设置描边宽度
   Future<void> setStrokeWidth(int width, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _strokeWidth = width;
 
     try {
-      await _channel.invokeMethod('setStrokeWidth', {'width': width});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setInt(_keyStrokeWidth, width);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setStrokeWidth', {'width': width});
     } catch (e) {
       print('❌ [DesktopLyric] 设置描边宽度失败: $e');
     }
@@ -329,17 +457,19 @@ class DesktopLyricService {
 
   /// 设置是否可拖动
   Future<void> setDraggable(bool draggable, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _isDraggable = draggable;
 
     try {
-      await _channel.invokeMethod('setDraggable', {'draggable': draggable});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setBool(_keyDraggable, draggable);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setDraggable', {'draggable': draggable});
     } catch (e) {
       print('❌ [DesktopLyric] 设置拖动状态失败: $e');
     }
@@ -347,17 +477,19 @@ class DesktopLyricService {
 
   /// 设置鼠标穿透
   Future<void> setMouseTransparent(bool transparent, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _isMouseTransparent = transparent;
 
     try {
-      await _channel.invokeMethod('setMouseTransparent', {'transparent': transparent});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setBool(_keyMouseTransparent, transparent);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setMouseTransparent', {'transparent': transparent});
     } catch (e) {
       print('❌ [DesktopLyric] 设置鼠标穿透失败: $e');
     }
@@ -365,7 +497,10 @@ class DesktopLyricService {
 
   /// 设置播放状态（用于更新播放/暂停按钮图标）
   Future<void> setPlayingState(bool isPlaying) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
+
+    _isPlaying = isPlaying;
+    if (!_isCreated) return;
 
     try {
       await _channel.invokeMethod('setPlayingState', {'isPlaying': isPlaying});
@@ -374,6 +509,24 @@ class DesktopLyricService {
     }
   }
 
+  /// 获取渲染耗时统计（布局/光栅化/呈现直方图、帧数、跳帧、缓存命中）
+  ///
+  /// [reset] 为 true 时在读取后清零统计，便于对比不同改动
+  Future<Map<String, dynamic>?> getRenderStats({bool reset = false}) async {
+    if (!isSupported || !_isCreated) return null;
+
+    try {
+      final result = await _channel.invokeMethod('getRenderStats', {'reset': reset});
+      if (result is Map) {
+        return Map<String, dynamic>.from(result);
+      }
+      return null;
+    } catch (e) {
+      print('❌ [DesktopLyric] 获取渲染统计失败: $e');
+      return null;
+    }
+  }
+
   /// 检查是否可见
   bool get isVisible => _isVisible;
 
@@ -390,6 +543,7 @@ class DesktopLyricService {
     'isMouseTransparent': _isMouseTransparent,
     'showTranslation': _showTranslation,
     'isVertical': _isVertical,
+    'showSpectrum': _showSpectrum,
   };
 
   /// 获取字体大小
@@ -407,9 +561,12 @@ class DesktopLyricService {
   /// 获取是否纵向排列
   bool get isVertical => _isVertical;
 
+  /// 获取是否显示频谱条
+  bool get showSpectrum => _showSpectrum;
+
   /// 设置翻译文本
   Future<void> setTranslationText(String text) async {
-    if (!Platform.isWindows) return;
+    if (!isSupported) return;
     
     _currentTranslation = text;
     
@@ -425,17 +582,19 @@ class DesktopLyricService {
 
   /// 设置是否显示翻译
   Future<void> setShowTranslation(bool show, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _showTranslation = show;
 
     try {
-      await _channel.invokeMethod('setShowTranslation', {'show': show});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setBool(_keyShowTranslation, show);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setShowTranslation', {'show': show});
     } catch (e) {
       print('❌ [DesktopLyric] 设置显示翻译失败: $e');
     }
@@ -448,17 +607,19 @@ class DesktopLyricService {
 
   /// 设置是否纵向排列
   Future<void> setVertical(bool vertical, {bool saveToPrefs = true}) async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported) return;
 
     _isVertical = vertical;
 
     try {
-      await _channel.invokeMethod('setVertical', {'vertical': vertical});
-      
       if (saveToPrefs) {
         final prefs = await SharedPreferences.getInstance();
         await prefs.setBool(_keyIsVertical, vertical);
       }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setVertical', {'vertical': vertical});
     } catch (e) {
       print('❌ [DesktopLyric] 设置纵向排列失败: $e');
     }
@@ -469,6 +630,28 @@ class DesktopLyricService {
     await setVertical(!_isVertical);
   }
 
+  /// 设置是否在歌词背后显示频谱条
+  ///
+  /// 频段数据由原生音频分析直接送到歌词窗口，不经过 Dart
+  Future<void> setShowSpectrum(bool show, {bool saveToPrefs = true}) async {
+    if (!isSupported) return;
+
+    _showSpectrum = show;
+
+    try {
+      if (saveToPrefs) {
+        final prefs = await SharedPreferences.getInstance();
+        await prefs.setBool(_keyShowSpectrum, show);
+      }
+
+      // 窗口未创建时只保存配置，创建时统一应用
+      if (!_isCreated) return;
+      await _channel.invokeMethod('setShowSpectrum', {'show': show});
+    } catch (e) {
+      print('❌ [DesktopLyric] 设置频谱条失败: $e');
+    }
+  }
+
   // 预设颜色列表
   static const List<int> _presetColors = [
     0xFFFFFFFF, // 白色
@@ -563,7 +746,7 @@ class DesktopLyricService {
 
   /// 销毁窗口（应用退出时调用）
   Future<void> dispose() async {
-    if (!Platform.isWindows || !_isCreated) return;
+    if (!isSupported || !_isCreated) return;
 
     try {
       // 保存当前位置
@@ -576,6 +759,8 @@ class DesktopLyricService {
 
       await _channel.invokeMethod('destroy');
       _isCreated = false;
+      // 新窗口没有歌词表，下次换行时重新上传
+      _sheetUpload = null;
       _isVisible = false;
     } catch (e) {
       print('❌ [DesktopLyric] 销毁窗口失败: $e');
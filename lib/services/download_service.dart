@@ -11,6 +11,7 @@ import '../models/song_detail.dart';
 import 'cache_service.dart';
 import 'notification_service.dart';
 import 'audio_quality_service.dart';
+import 'native_downloader_service.dart';
 
 /// 下载进度回调
 typedef DownloadProgressCallback = void Function(double progress);
@@ -225,11 +226,36 @@ class DownloadService extends ChangeNotifier {
   }
 
   /// 直接下载音频文件
+  ///
+  /// Windows / Linux 优先交给原生分段下载（多连接并发、可断点续传），
+  /// 原生下载不可用或失败时退回单连接的 http 下载
   Future<bool> _downloadFromUrl(
     String url,
     String outputPath,
     DownloadProgressCallback? onProgress,
   ) async {
+    if (NativeDownloaderService.isSupported) {
+      final result = await NativeDownloaderService().download(
+        url: url,
+        path: outputPath,
+        onProgress: (received, total) {
+          if (total > 0) onProgress?.call(received / total);
+        },
+      );
+      if (result != null && result.ok) {
+        print('✅ [DownloadService] 原生下载成功: $outputPath '
+            '(${result.connections} 个连接, 续传 ${result.resumed} 字节)');
+        return true;
+      }
+      if (result != null) {
+        if (!result.retryOverHttp) {
+          print('❌ [DownloadService] 原生下载失败: ${result.error}，已保留断点');
+          return false;
+        }
+        print('⚠️ [DownloadService] 原生下载失败: ${result.error}，改用 http 下载');
+      }
+    }
+
     try {
       print('🌐 [DownloadService] 从网络下载: $url');
 
@@ -258,6 +284,9 @@ class DownloadService extends ChangeNotifier {
 
       await sink.close();
 
+      // 原生下载中断留下的断点已无用
+      await NativeDownloaderService().discard(outputPath);
+
       print('✅ [DownloadService] 从网络下载成功: $outputPath');
       return true;
     } catch (e) {
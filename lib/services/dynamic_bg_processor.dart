@@ -1,7 +1,10 @@
 
 import 'dart:async';
+import 'dart:ffi';
+import 'dart:io';
 import 'dart:typed_data';
 import 'dart:ui' as ui;
+import 'package:ffi/ffi.dart';
 import 'package:flutter/material.dart';
 import 'dart:math' as math;
 
@@ -14,7 +17,49 @@ import 'dart:math' as math;
 /// 4. Mesh Warping again
 /// 5. Blurring again
 /// 6. Color Corrections (Saturation/Brightness)
+///
+/// On Windows and Linux the whole chain runs natively on a worker thread
+/// (native/cover/fluid_background.h) over small RGBA buffers, and only the
+/// finished texture is uploaded; elsewhere it is drawn step by step through
+/// ui.Image. Either way results are cached per cover, see [processCached].
 class DynamicBgProcessor {
+  // Results per (cover, desktop), oldest first.
+  static const int _maxCachedResults = 8;
+  static final Map<(Object, bool), ui.Image> _cache = {};
+
+  /// The background already generated for [key] (usually the cover's
+  /// ImageProvider), if any.
+  static ui.Image? cachedResult(Object key, {required bool desktop}) {
+    final cacheKey = (key, desktop);
+    final image = _cache.remove(cacheKey);
+    if (image != null) _cache[cacheKey] = image;
+    return image;
+  }
+
+  /// Generates the background for [inputImage] (natively where possible)
+  /// and remembers it under [key] for [cachedResult].
+  static Future<ui.Image> processCached(
+    Object key,
+    ui.Image inputImage, {
+    required bool desktop,
+  }) async {
+    final cached = cachedResult(key, desktop: desktop);
+    if (cached != null) return cached;
+
+    final image = await _NativeFluidBackground.instance?.render(
+          inputImage,
+          desktop: desktop,
+        ) ??
+        (desktop
+            ? await processImageDesktop(inputImage)
+            : await processImage(inputImage));
+
+    _cache[(key, desktop)] = image;
+    while (_cache.length > _maxCachedResults) {
+      _cache.remove(_cache.keys.first);
+    }
+    return image;
+  }
   
   // The mesh configuration from the provided reference (Apple Music parameters)
   static const List<double> _meshFloats = [
@@ -371,3 +416,131 @@ class DynamicBgProcessor {
     ];
   }
 }
+
+typedef _SizeNative = Void Function(Int32, Pointer<Int32>, Pointer<Int32>);
+typedef _SizeDart = void Function(int, Pointer<Int32>, Pointer<Int32>);
+typedef _DoneNative = Void Function(Int64, Int32, Float);
+typedef _SubmitNative = Void Function(Pointer<Uint8>, Int32, Int32, Int32,
+    Int32, Pointer<Uint8>, Int64, Pointer<NativeFunction<_DoneNative>>);
+typedef _SubmitDart = void Function(Pointer<Uint8>, int, int, int, int,
+    Pointer<Uint8>, int, Pointer<NativeFunction<_DoneNative>>);
+
+/// A render submitted to the native worker; its buffers are freed when it
+/// completes.
+class _PendingBackground {
+  final Pointer<Uint8> pixels;
+  final Pointer<Uint8> output;
+  final int width;
+  final int height;
+  final Completer<ui.Image?> completer;
+
+  _PendingBackground(
+      this.pixels, this.output, this.width, this.height, this.completer);
+}
+
+/// FFI binding of the native fluid background pipeline (Windows / Linux).
+class _NativeFluidBackground {
+  static final _NativeFluidBackground? instance = _load();
+
+  final _SizeDart _size;
+  final _SubmitDart _submit;
+  late final NativeCallable<_DoneNative> _done =
+      NativeCallable<_DoneNative>.listener(_onDone);
+  final Map<int, _PendingBackground> _pending = {};
+  int _nextId = 0;
+
+  _NativeFluidBackground(this._size, this._submit);
+
+  static _NativeFluidBackground? _load() {
+    if (!Platform.isWindows && !Platform.isLinux) return null;
+    try {
+      // Exported by the runner executable itself.
+      final library = Platform.isWindows
+          ? DynamicLibrary.executable()
+          : DynamicLibrary.process();
+      return _NativeFluidBackground(
+        library.lookupFunction<_SizeNative, _SizeDart>(
+          'cyrene_fluid_background_size',
+          isLeaf: true,
+        ),
+        library.lookupFunction<_SubmitNative, _SubmitDart>(
+          'cyrene_fluid_background_submit',
+          isLeaf: true,
+        ),
+      );
+    } catch (e) {
+      debugPrint('Native fluid background unavailable: $e');
+      return null;
+    }
+  }
+
+  /// Renders [input] on the native worker; null if its pixels cannot be
+  /// read, so the caller falls back to the ui.Image pipeline.
+  Future<ui.Image?> render(ui.Image input, {required bool desktop}) async {
+    final byteData =
+        await input.toByteData(format: ui.ImageByteFormat.rawStraightRgba);
+    if (byteData == null) return null;
+
+    final size = calloc<Int32>(2);
+    _size(desktop ? 1 : 0, size, size + 1);
+    final width = size[0];
+    final height = size[1];
+    calloc.free(size);
+
+    final pixels = malloc<Uint8>(byteData.lengthInBytes);
+    pixels
+        .asTypedList(byteData.lengthInBytes)
+        .setAll(0, byteData.buffer.asUint8List(
+            byteData.offsetInBytes, byteData.lengthInBytes));
+    final output = malloc<Uint8>(width * height * 4);
+    final id = _nextId++;
+    final completer = Completer<ui.Image?>();
+    _pending[id] =
+        _PendingBackground(pixels, output, width, height, completer);
+
+    _submit(pixels, input.width, input.height, input.width * 4,
+        desktop ? 1 : 0, output, id, _done.nativeFunction);
+    return completer.future;
+  }
+
+  void _onDone(int id, int ok, double brightness) {
+    final pending = _pending.remove(id);
+    if (pending == null) return;
+    malloc.free(pending.pixels);
+    if (ok == 0) {
+      malloc.free(pending.output);
+      pending.completer.complete(null);
+      return;
+    }
+    _upload(pending);
+  }
+
+  Future<void> _upload(_PendingBackground pending) async {
+    try {
+      // fromUint8List copies, so the native buffer can go right away.
+      final ui.ImmutableBuffer buffer;
+      try {
+        buffer = await ui.ImmutableBuffer.fromUint8List(
+            pending.output.asTypedList(pending.width * pending.height * 4));
+      } finally {
+        malloc.free(pending.output);
+      }
+      // Premultiplied RGBA, as the renderer writes it.
+      final descriptor = ui.ImageDescriptor.raw(
+        buffer,
+        width: pending.width,
+        height: pending.height,
+        pixelFormat: ui.PixelFormat.rgba8888,
+      );
+      final codec = await descriptor.instantiateCodec();
+      final frame = await codec.getNextFrame();
+      codec.dispose();
+      descriptor.dispose();
+      buffer.dispose();
+      pending.completer.complete(frame.image);
+    } catch (e) {
+      debugPrint('Native fluid background upload failed: $e');
+      pending.completer.complete(null);
+    }
+  }
+}
@@ -0,0 +1,73 @@
+import 'dart:async';
+import 'dart:io';
+import 'package:flutter/services.dart';
+
+import 'local_library_service.dart';
+import 'player_service.dart';
+
+/// 启动参数服务（Windows / Linux 平台）
+///
+/// 应用只保留一个实例：再次启动时（例如从文件管理器打开音乐文件），
+/// 新进程把命令行参数交给已运行的实例后立即退出，原生层随即把窗口带到前台，
+/// 参数经由 `onArguments` 到达这里。本进程自身的启动参数在 `ready` 中一并返回。
+class LaunchArgumentsService {
+  static final LaunchArgumentsService _instance =
+      LaunchArgumentsService._internal();
+  factory LaunchArgumentsService() => _instance;
+  LaunchArgumentsService._internal();
+
+  /// 当前平台是否支持单实例参数转交
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/instance');
+
+  bool _initialized = false;
+
+  /// 开始接收参数；应在播放器与本地音乐库初始化之后调用
+  Future<void> initialize() async {
+    if (!isSupported || _initialized) return;
+    _initialized = true;
+
+    _channel.setMethodCallHandler(_handleMethodCall);
+    try {
+      final pending = await _channel.invokeMethod<List<dynamic>>('ready');
+      // 不阻塞启动流程
+      for (final arguments in pending ?? const []) {
+        unawaited(_handleArguments(List<String>.from(arguments as List)));
+      }
+    } catch (e) {
+      print('❌ [LaunchArguments] 初始化失败: $e');
+    }
+  }
+
+  Future<dynamic> _handleMethodCall(MethodCall call) async {
+    if (call.method == 'onArguments') {
+      await _handleArguments(List<String>.from(call.arguments as List));
+    }
+  }
+
+  /// 打开参数中的音频文件，并播放第一首
+  /// 后启动的实例转交的路径已由原生层展开为绝对路径
+  Future<void> _handleArguments(List<String> arguments) async {
+    final paths = <String>[];
+    for (final argument in arguments) {
+      if (argument.startsWith('-')) continue;
+      if (File(argument).existsSync()) {
+        paths.add(argument);
+      } else {
+        print('⚠️ [LaunchArguments] 文件不存在，已忽略: $argument');
+      }
+    }
+    if (paths.isEmpty) return;
+
+    print('📂 [LaunchArguments] 打开文件: $paths');
+    try {
+      final tracks = await LocalLibraryService().openFiles(paths);
+      if (tracks.isEmpty) return;
+      await PlayerService().playTrack(tracks.first);
+    } catch (e) {
+      print('❌ [LaunchArguments] 打开文件失败: $e');
+    }
+  }
+}
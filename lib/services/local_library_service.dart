@@ -10,6 +10,8 @@ import 'package:crypto/crypto.dart';
 import 'dart:convert';
 import '../models/track.dart';
 import '../utils/metadata_reader.dart';
+import 'native_library_scanner_service.dart';
+import 'native_tag_reader.dart';
 
 /// 本地音乐库服务：负责扫描目录、管理本地歌曲与歌词
 /// 支持读取音频文件元数据（标题、艺术家、专辑封面等）
@@ -26,6 +28,9 @@ class LocalLibraryService extends ChangeNotifier {
   /// 歌词扩展名
   static const String lyricExt = 'lrc';
 
+  /// 原生扫描索引文件名（记录文件大小与修改时间）
+  static const String _scanIndexFileName = 'local_library_index.bin';
+
   /// 路径 -> 歌词内容缓存
   final Map<String, String> _pathToLyric = {};
 
@@ -120,7 +125,7 @@ class LocalLibraryService extends ChangeNotifier {
   }
 
   /// 保存本地音乐库到文件
-  Future<void> _saveLibrary() async {
+  Future<bool> _saveLibrary() async {
     try {
       final file = await _getLibraryFile();
       
@@ -133,8 +138,10 @@ class LocalLibraryService extends ChangeNotifier {
       
       await file.writeAsString(json.encode(data));
       debugPrint('📀 [LocalLibrary] 保存了 ${_tracks.length} 首本地歌曲');
+      return true;
     } catch (e) {
       debugPrint('📀 [LocalLibrary] 保存本地音乐库失败: $e');
+      return false;
     }
   }
 
@@ -224,11 +231,37 @@ class LocalLibraryService extends ChangeNotifier {
     }
   }
 
+  /// 打开外部传入的音频文件（例如从文件管理器打开），返回对应的曲目
+  /// 已在库中的文件不会重复读取元数据
+  Future<List<Track>> openFiles(List<String> paths) async {
+    final audioPaths = paths.where((path) {
+      final ext = p.extension(path).toLowerCase().replaceFirst('.', '');
+      return supportedAudioExts.contains(ext);
+    }).toList();
+    if (audioPaths.isEmpty) return const [];
+
+    await Future.wait(audioPaths.map(_addAudioFile));
+    await _saveLibrary();
+    notifyListeners();
+
+    final byId = {for (final track in _tracks) track.id: track};
+    return [
+      for (final path in audioPaths)
+        if (byId[path] != null) byId[path]!,
+    ];
+  }
+
   /// 扫描指定文件夹（递归）
   Future<void> scanFolder(String folderPath) async {
     final dir = Directory(folderPath);
     if (!await dir.exists()) return;
 
+    // 桌面端由原生层并行、增量扫描
+    if (NativeLibraryScannerService.isSupported &&
+        await _scanFolderNative(folderPath)) {
+      return;
+    }
+
     final List<Future<void>> futures = [];
     await for (final entity in dir.list(recursive: true, followLinks: false)) {
       if (entity is File) {
@@ -245,10 +278,101 @@ class LocalLibraryService extends ChangeNotifier {
     }
   }
 
+  /// 原生扫描结束后即为磁盘上的最新状态：只有新增或修改过的文件会被报告，
+  /// 未变化的文件沿用库中已有的曲目；原生层读不了标签的格式交给 [_addAudioFile]。
+  /// 原生扫描不可用时返回 false；已有扫描在进行时不再重复扫描，返回 true
+  ///
+  /// 原生层把更新后的索引写到旁边的临时文件，库文件保存成功后才替换正式
+  /// 索引：中途退出时下次扫描会重新报告这些文件，而不会因索引已更新而漏掉
+  Future<bool> _scanFolderNative(String folderPath) async {
+    final appDir = await getApplicationSupportDirectory();
+    final coverDir = await _getCoverCacheDir();
+    final indexPath = p.join(appDir.path, _scanIndexFileName);
+    final pendingIndexPath = '$indexPath.pending';
+
+    final positions = <dynamic, int>{
+      for (var i = 0; i < _tracks.length; i++) _tracks[i].id: i,
+    };
+    final fallbackPaths = <String>[];
+
+    final result = await NativeLibraryScannerService().scan(
+      roots: [folderPath],
+      extensions: supportedAudioExts.toList(),
+      indexPath: indexPath,
+      saveIndexPath: pendingIndexPath,
+      coverDirectory: coverDir.path,
+      // 库为空（首次扫描或库文件丢失）时不依赖索引
+      full: _tracks.isEmpty,
+      onTracks: (tracks) {
+        for (final scanned in tracks) {
+          if (scanned.format == NativeTagFormat.unknown) {
+            fallbackPaths.add(scanned.path);
+            continue;
+          }
+          _pathToLyric[scanned.path] = scanned.lyric;
+          final track = Track(
+            id: scanned.path,
+            name: scanned.title.isNotEmpty
+                ? scanned.title
+                : p.basenameWithoutExtension(scanned.path),
+            artists: scanned.artist.isNotEmpty ? scanned.artist : '本地文件',
+            album: scanned.album,
+            picUrl: scanned.coverPath,
+            source: MusicSource.local,
+          );
+          final position = positions[scanned.path];
+          if (position != null) {
+            _tracks[position] = track;
+          } else {
+            positions[scanned.path] = _tracks.length;
+            _tracks.add(track);
+          }
+        }
+        notifyListeners();
+      },
+    );
+    if (result == null) return false;
+    if (result.busy) {
+      debugPrint('📀 [LocalLibrary] 已有扫描在进行，跳过: $folderPath');
+      return true;
+    }
+
+    if (result.removed.isNotEmpty) {
+      final removed = result.removed.toSet();
+      _tracks.removeWhere((t) => removed.contains(t.id));
+      removed.forEach(_pathToLyric.remove);
+    }
+    if (fallbackPaths.isNotEmpty) {
+      // 修改过的文件需要重新读取
+      final fallback = fallbackPaths.toSet();
+      _tracks.removeWhere((t) => fallback.contains(t.id));
+      await Future.wait(fallback.map(_addAudioFile));
+    }
+
+    debugPrint('📀 [LocalLibrary] 原生扫描完成: ${result.files} 个文件，'
+        '${result.changed} 个新增或修改，${result.unchanged} 个未变化，'
+        '${result.removed.length} 个已删除，'
+        '耗时 ${result.elapsedMs.toStringAsFixed(0)}ms');
+    if (await _saveLibrary()) {
+      try {
+        await File(pendingIndexPath).rename(indexPath);
+      } catch (e) {
+        debugPrint('📀 [LocalLibrary] 更新扫描索引失败: $e');
+      }
+    }
+    notifyListeners();
+    return true;
+  }
+
   /// 清空已扫描结果
   Future<void> clear() async {
     _tracks.clear();
     _pathToLyric.clear();
+    if (NativeLibraryScannerService.isSupported) {
+      final appDir = await getApplicationSupportDirectory();
+      await NativeLibraryScannerService()
+          .resetIndex(p.join(appDir.path, _scanIndexFileName));
+    }
     await _saveLibrary();
     notifyListeners();
   }
@@ -348,8 +472,17 @@ class LocalLibraryService extends ChangeNotifier {
         }
       }
 
+      // 桌面端一次原生调用读出标签、内嵌歌词与封面，只访问标签区域
+      final nativeTags = NativeTagReader().read(filePath, includeCover: true);
+
       // 如果外部歌词为空，尝试读取文件内嵌歌词
-      if (lyricText.isEmpty) {
+      if (lyricText.isEmpty && nativeTags != null) {
+        final embeddedLyric = nativeTags.lyrics;
+        if (embeddedLyric != null && embeddedLyric.isNotEmpty) {
+          lyricText = embeddedLyric;
+          debugPrint('📀 [LocalLibrary] 成功提取内嵌歌词: ${p.basename(filePath)}');
+        }
+      } else if (lyricText.isEmpty) {
         final embeddedLyric = await MetadataReader.extractLyrics(filePath);
         if (embeddedLyric != null && embeddedLyric.isNotEmpty) {
           lyricText = embeddedLyric;
@@ -366,45 +499,64 @@ class LocalLibraryService extends ChangeNotifier {
       String trackPicUrl = '';
 
       // 尝试读取音频元数据
-      try {
-        final metadata = readMetadata(file, getImage: true);
-        
-        // 读取标题
-        if (metadata.title != null && metadata.title!.isNotEmpty) {
-          trackName = metadata.title!;
+      if (nativeTags != null) {
+        if (nativeTags.title?.isNotEmpty ?? false) trackName = nativeTags.title!;
+        if (nativeTags.artist?.isNotEmpty ?? false) {
+          trackArtists = nativeTags.artist!;
         }
-        
-        // 读取艺术家
-        if (metadata.artist != null && metadata.artist!.isNotEmpty) {
-          trackArtists = metadata.artist!;
-        }
-        
-        // 读取专辑
-        if (metadata.album != null && metadata.album!.isNotEmpty) {
-          trackAlbum = metadata.album!;
-        }
-        
-        // 读取封面图片
-        if (metadata.pictures.isNotEmpty) {
-          final picture = metadata.pictures.first;
+        if (nativeTags.album?.isNotEmpty ?? false) trackAlbum = nativeTags.album!;
+        if (nativeTags.cover != null) {
           final coverPath = await _saveCoverImage(
             filePath,
-            picture.bytes,
-            picture.mimetype ?? 'image/jpeg',
+            nativeTags.cover!,
+            nativeTags.coverMimeType ?? 'image/jpeg',
           );
           if (coverPath != null) {
             trackPicUrl = coverPath;
           }
         }
-        
         debugPrint('📀 [LocalLibrary] 读取元数据成功: $trackName - $trackArtists');
-      } catch (e) {
-        // 元数据读取失败，尝试从文件名解析
-        debugPrint('📀 [LocalLibrary] 元数据读取失败 ($filename): $e');
-        final (parsedName, parsedArtist) = _parseFilename(nameNoExt);
-        trackName = parsedName;
-        if (parsedArtist != null) {
-          trackArtists = parsedArtist;
+      } else {
+        try {
+          final metadata = readMetadata(file, getImage: true);
+        
+          // 读取标题
+          if (metadata.title != null && metadata.title!.isNotEmpty) {
+            trackName = metadata.title!;
+          }
+
+          // 读取艺术家
+          if (metadata.artist != null && metadata.artist!.isNotEmpty) {
+            trackArtists = metadata.artist!;
+          }
+
+          // 读取专辑
+          if (metadata.album != null && metadata.album!.isNotEmpty) {
+            trackAlbum = metadata.album!;
+          }
+
+          // 读取封面图片
+          if (metadata.pictures.isNotEmpty) {
+            final picture = metadata.pictures.first;
+            final coverPath = await _saveCoverImage(
+              filePath,
+              picture.bytes,
+              picture.mimetype ?? 'image/jpeg',
+            );
+            if (coverPath != null) {
+              trackPicUrl = coverPath;
+            }
+          }
+
+          debugPrint('📀 [LocalLibrary] 读取元数据成功: $trackName - $trackArtists');
+        } catch (e) {
+          // 元数据读取失败，尝试从文件名解析
+          debugPrint('📀 [LocalLibrary] 元数据读取失败 ($filename): $e');
+          final (parsedName, parsedArtist) = _parseFilename(nameNoExt);
+          trackName = parsedName;
+          if (parsedArtist != null) {
+            trackArtists = parsedArtist;
+          }
         }
       }
 
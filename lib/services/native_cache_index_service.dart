@@ -0,0 +1,152 @@
+import 'dart:io';
+import 'package:flutter/services.dart';
+
+/// 原生缓存索引服务（Windows / Linux 平台）
+///
+/// 缓存索引以追加写日志的形式由原生层维护：添加、删除、播放一首缓存歌曲
+/// 只追加一条小记录，不再整体序列化并重写索引文件；启动时原生层扫描日志
+/// 建立哈希表，只把缓存键与文件大小交给 Dart，元数据按需读取。
+///
+/// 原生层同时按 [configure] 设置的容量上限与淘汰策略自动清理缓存：
+/// 超出上限时按最近使用时间（LRU）或播放次数（LFU）选出歌曲，一次性从
+/// 索引移除并在后台线程批量删除文件，返回被清理的缓存键。
+class NativeCacheIndexService {
+  static final NativeCacheIndexService _instance =
+      NativeCacheIndexService._internal();
+  factory NativeCacheIndexService() => _instance;
+  NativeCacheIndexService._internal();
+
+  /// 当前平台是否支持原生缓存索引
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/cache_index');
+
+  /// 打开（或创建）索引日志，返回缓存键到音频大小的映射；失败时返回 null
+  Future<Map<String, int>?> open(String indexPath) async {
+    if (!isSupported) return null;
+    try {
+      final result = await _channel.invokeMapMethod<String, dynamic>(
+        'open',
+        {'path': indexPath},
+      );
+      final keys = List<String>.from(result!['keys'] as List);
+      final sizes = result['sizes'] as List<int>;
+      return {
+        for (var i = 0; i < keys.length; i++) keys[i]: sizes[i],
+      };
+    } catch (e) {
+      print('❌ [NativeCacheIndex] 打开缓存索引失败: $e');
+      return null;
+    }
+  }
+
+  /// 读取元数据 JSON；不存在时返回 null
+  Future<String?> get(String key) {
+    return _channel.invokeMethod<String>('get', {'key': key});
+  }
+
+  /// 添加或替换一条记录，返回因超出容量上限而被清理的缓存键
+  Future<List<String>> put(String key, int size, String metadataJson) async {
+    final evicted = await _channel.invokeListMethod<String>('put', {
+      'key': key,
+      'size': size,
+      'metadata': metadataJson,
+    });
+    return evicted ?? const [];
+  }
+
+  /// 批量添加（用于迁移旧索引）
+  Future<void> putAll(
+    List<String> keys,
+    List<int> sizes,
+    List<String> metadataJson,
+  ) async {
+    await _channel.invokeMethod('putAll', {
+      'keys': keys,
+      'sizes': sizes,
+      'metadata': metadataJson,
+    });
+  }
+
+  Future<void> remove(String key) async {
+    await _channel.invokeMethod('remove', {'key': key});
+  }
+
+  /// 记录一次使用（最近访问时间与播放次数），计为一次缓存命中
+  Future<void> touch(String key) async {
+    await _channel.invokeMethod('touch', {'key': key});
+  }
+
+  Future<void> clear() async {
+    await _channel.invokeMethod('clear');
+  }
+
+  /// 设置缓存目录、容量上限（字节，0 为不限）与淘汰策略，
+  /// 立即按新上限清理并返回被清理的缓存键
+  Future<List<String>> configure(
+    String directory,
+    int budget,
+    CacheEvictionPolicy policy,
+  ) async {
+    final evicted = await _channel.invokeListMethod<String>('configure', {
+      'directory': directory,
+      'budget': budget,
+      'policy': policy.name,
+    });
+    return evicted ?? const [];
+  }
+
+  /// 记录一次缓存未命中（歌曲未缓存，从网络播放）
+  Future<void> miss() async {
+    await _channel.invokeMethod('miss');
+  }
+
+  /// 本次运行的命中、未命中与清理统计
+  Future<CacheEvictionMetrics?> metrics() async {
+    if (!isSupported) return null;
+    try {
+      final result =
+          await _channel.invokeMapMethod<String, dynamic>('metrics');
+      return CacheEvictionMetrics(
+        hits: result!['hits'] as int,
+        misses: result['misses'] as int,
+        evictions: result['evictions'] as int,
+        evictedBytes: result['evictedBytes'] as int,
+      );
+    } catch (e) {
+      print('⚠️ [NativeCacheIndex] 读取缓存统计失败: $e');
+      return null;
+    }
+  }
+}
+
+/// 缓存淘汰策略
+enum CacheEvictionPolicy {
+  /// 优先清理最久未播放的歌曲
+  lru,
+
+  /// 优先清理播放次数最少的歌曲
+  lfu,
+}
+
+/// 缓存命中与清理统计（自启动以来）
+class CacheEvictionMetrics {
+  final int hits;
+  final int misses;
+  final int evictions;
+  final int evictedBytes;
+
+  const CacheEvictionMetrics({
+    required this.hits,
+    required this.misses,
+    required this.evictions,
+    required this.evictedBytes,
+  });
+
+  /// 命中率（0~1）；尚无播放记录时为 null
+  double? get hitRate {
+    final total = hits + misses;
+    return total == 0 ? null : hits / total;
+  }
+}
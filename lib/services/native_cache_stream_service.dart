@@ -0,0 +1,114 @@
+import 'dart:io';
+import 'dart:typed_data';
+import 'package:flutter/services.dart';
+
+/// 原生缓存串流服务（Windows / Linux 平台）
+///
+/// .cyrene 缓存文件由原生层映射到内存，通过 127.0.0.1 上的 HTTP 地址
+/// 按播放器请求的范围逐块解密后输出，播放器拿到第一块数据即可开始播放，
+/// 不再需要先整体解密写出临时文件。写入缓存见 [NativeCacheWriter]。
+class NativeCacheStreamService {
+  static final NativeCacheStreamService _instance =
+      NativeCacheStreamService._internal();
+  factory NativeCacheStreamService() => _instance;
+  NativeCacheStreamService._internal();
+
+  /// 当前平台是否支持原生缓存串流
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/cache_stream');
+
+  /// 是否为本服务返回的串流地址
+  static bool isStreamUrl(String path) =>
+      path.startsWith('http://127.0.0.1:');
+
+  /// 为缓存文件打开串流地址；[extension] 决定地址后缀与 Content-Type。
+  /// 失败时返回 null，调用方应回退到临时文件。
+  Future<String?> open(String cacheFilePath, String extension) async {
+    if (!isSupported) return null;
+    try {
+      return await _channel.invokeMethod<String>('open', {
+        'path': cacheFilePath,
+        'extension': extension,
+      });
+    } catch (e) {
+      print('⚠️ [NativeCacheStream] 打开串流失败: $e');
+      return null;
+    }
+  }
+
+  /// 释放串流地址；正在进行的请求会先完成
+  Future<void> close(String url) async {
+    if (!isSupported) return;
+    try {
+      await _channel.invokeMethod('close', {'url': url});
+    } catch (e) {
+      print('⚠️ [NativeCacheStream] 关闭串流失败: $e');
+    }
+  }
+}
+
+/// 原生缓存写入器：音频边下载边加密、计算校验和，写入 `<路径>.tmp`，
+/// [commit] 时补写元数据并原子替换目标文件；[abort] 删除未完成的文件。
+class NativeCacheWriter {
+  NativeCacheWriter._(this._id);
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/cache_stream');
+
+  final int _id;
+
+  /// 开始写入 [cacheFilePath]；[metadataReserve] 为元数据 JSON 的最大字节数。
+  /// 平台不支持或无法创建文件时返回 null。
+  static Future<NativeCacheWriter?> begin(
+    String cacheFilePath,
+    int metadataReserve,
+  ) async {
+    if (!NativeCacheStreamService.isSupported) return null;
+    try {
+      final id = await _channel.invokeMethod<int>('beginWrite', {
+        'path': cacheFilePath,
+        'reserve': metadataReserve,
+      });
+      return id == null ? null : NativeCacheWriter._(id);
+    } catch (e) {
+      print('⚠️ [NativeCacheStream] 创建缓存文件失败: $e');
+      return null;
+    }
+  }
+
+  /// 追加一段未加密的音频数据
+  Future<void> add(Uint8List bytes) async {
+    await _channel.invokeMethod('write', {'id': _id, 'bytes': bytes});
+  }
+
+  /// 结束音频数据，返回其大小与 MD5 校验和
+  Future<({int size, String checksum})> digest() async {
+    final result = await _channel.invokeMapMethod<String, dynamic>(
+      'digest',
+      {'id': _id},
+    );
+    return (
+      size: result!['size'] as int,
+      checksum: result['checksum'] as String,
+    );
+  }
+
+  /// 写入元数据并把文件移动到位；失败时抛出异常且不留下任何文件
+  Future<void> commit(String metadataJson) async {
+    await _channel.invokeMethod('commit', {
+      'id': _id,
+      'metadata': metadataJson,
+    });
+  }
+
+  /// 放弃写入并删除未完成的文件
+  Future<void> abort() async {
+    try {
+      await _channel.invokeMethod('abort', {'id': _id});
+    } catch (e) {
+      print('⚠️ [NativeCacheStream] 放弃写入失败: $e');
+    }
+  }
+}
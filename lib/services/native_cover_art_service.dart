@@ -0,0 +1,84 @@
+import 'dart:async';
+import 'dart:io';
+import 'dart:typed_data';
+import 'package:flutter/services.dart';
+import 'package:http/http.dart' as http;
+import 'package:path_provider/path_provider.dart';
+
+/// 原生封面缓存服务（Windows / Linux 平台）
+///
+/// 封面由 Dart 下载一次，字节交给原生层解码一次，
+/// 缩略图与控制面板尺寸的位图在内存和磁盘中按 LRU 缓存。
+/// SMTC / MPRIS 与桌面歌词控制面板直接读取解码后的位图，不再各自下载。
+class NativeCoverArtService {
+  static final NativeCoverArtService _instance =
+      NativeCoverArtService._internal();
+  factory NativeCoverArtService() => _instance;
+  NativeCoverArtService._internal();
+
+  /// 当前平台是否有原生封面缓存
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/cover_art');
+
+  static const Duration _downloadTimeout = Duration(seconds: 10);
+
+  Future<void>? _configured;
+
+  // 同一封面的并发请求共用一次下载
+  final Map<String, Future<void>> _pending = {};
+
+  /// 缓存键：系统媒体控件要求 HTTPS，各调用方需使用同一个键
+  static String keyFor(String url) {
+    if (url.startsWith('http://')) {
+      return url.replaceFirst('http://', 'https://');
+    }
+    return url;
+  }
+
+  /// 确保封面已交给原生缓存；已缓存时只做一次查询
+  Future<void> ensureCached(String? url) {
+    if (!isSupported || url == null || url.isEmpty) return Future.value();
+    final key = keyFor(url);
+    return _pending[key] ??=
+        _ensureCached(key).whenComplete(() => _pending.remove(key));
+  }
+
+  Future<void> _configure() async {
+    try {
+      final appDir = await getApplicationSupportDirectory();
+      await _channel.invokeMethod('configure', {
+        'directory': '${appDir.path}${Platform.pathSeparator}cover_cache',
+      });
+    } catch (e) {
+      // 没有磁盘缓存时仍可使用内存缓存
+      print('⚠️ [NativeCoverArt] 配置磁盘缓存失败: $e');
+    }
+  }
+
+  Future<void> _ensureCached(String key) async {
+    try {
+      await (_configured ??= _configure());
+      final cached =
+          await _channel.invokeMethod<bool>('contains', {'url': key});
+      if (cached == true) return;
+
+      final Uint8List bytes;
+      if (key.startsWith('https://')) {
+        final response =
+            await http.get(Uri.parse(key)).timeout(_downloadTimeout);
+        if (response.statusCode != 200) return;
+        bytes = response.bodyBytes;
+      } else {
+        // 本地音乐的封面路径
+        final file = File(key);
+        if (!await file.exists()) return;
+        bytes = await file.readAsBytes();
+      }
+      await _channel.invokeMethod('put', {'url': key, 'bytes': bytes});
+    } catch (e) {
+      print('⚠️ [NativeCoverArt] 缓存封面失败: $e');
+    }
+  }
+}
@@ -0,0 +1,139 @@
+import 'dart:async';
+import 'dart:io';
+import 'package:flutter/services.dart';
+
+/// 一次原生下载的结果
+class NativeDownloadResult {
+  final bool ok;
+
+  /// 失败原因（如 "HTTP 404"、"Cancelled"），成功时为空
+  final String error;
+  final int total;
+
+  /// 本次启动时已从上次中断处保留的字节数
+  final int resumed;
+
+  /// 文件被拆分到的连接数（服务器不支持 Range 时为 1）
+  final int connections;
+
+  const NativeDownloadResult({
+    required this.ok,
+    required this.error,
+    required this.total,
+    required this.resumed,
+    required this.connections,
+  });
+
+  /// 服务器的响应原生层处理不了（状态码、Range 不可用、协议或 TLS 问题），
+  /// 换成 http 整体下载可能成功。网络中断、磁盘错误与取消不在此列：
+  /// 这时保留断点，下次下载同一路径从中断处继续
+  bool get retryOverHttp {
+    const prefixes = [
+      'HTTP ',
+      'Range not honoured',
+      'Malformed',
+      'Unsupported URL',
+      'No TLS support',
+      'Redirect limit',
+    ];
+    return !ok && prefixes.any(error.startsWith);
+  }
+}
+
+/// 原生分段下载服务（Windows / Linux 平台）
+///
+/// 原生层用多个 Range 连接并发下载同一文件，直接写入预分配的
+/// "<path>.part"；先完成的连接会拆分剩余最多的分段继续下载。分段进度定期
+/// 写入 "<path>.part.state"，中断或取消后再次下载同一路径会从断点继续
+/// （服务器报告的大小或 ETag 变化时重新开始）。进度按固定间隔通过
+/// "onProgress" 回调送回 Dart，结束时回调一次 "onDone"。
+class NativeDownloaderService {
+  static final NativeDownloaderService _instance =
+      NativeDownloaderService._internal();
+  factory NativeDownloaderService() => _instance;
+  NativeDownloaderService._internal();
+
+  /// 当前平台是否支持原生下载
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/downloader');
+
+  bool _handlerInstalled = false;
+  int _nextId = 1;
+  final Map<int, Completer<NativeDownloadResult>> _completers = {};
+  final Map<int, void Function(int received, int total)> _onProgress = {};
+
+  /// 把 [url] 下载到 [path]，进度交给 [onProgress]；下载结束后返回结果。
+  /// 不支持或启动失败时返回 null
+  Future<NativeDownloadResult?> download({
+    required String url,
+    required String path,
+    int? connections,
+    void Function(int received, int total)? onProgress,
+  }) async {
+    if (!isSupported) return null;
+    if (!_handlerInstalled) {
+      _channel.setMethodCallHandler(_handleMethodCall);
+      _handlerInstalled = true;
+    }
+
+    final id = _nextId++;
+    final completer = Completer<NativeDownloadResult>();
+    _completers[id] = completer;
+    if (onProgress != null) _onProgress[id] = onProgress;
+    try {
+      final started = await _channel.invokeMethod<bool>('start', {
+        'id': id,
+        'url': url,
+        'path': path,
+        if (connections != null) 'connections': connections,
+      });
+      if (started != true) {
+        _finish(id);
+        return null;
+      }
+    } catch (e) {
+      print('❌ [NativeDownloader] 启动下载失败: $e');
+      _finish(id);
+      return null;
+    }
+    return completer.future;
+  }
+
+  /// 删除 [path] 未完成下载留下的 .part 与进度文件
+  Future<void> discard(String path) async {
+    if (!isSupported) return;
+    try {
+      await _channel.invokeMethod('discard', {'path': path});
+    } catch (e) {
+      print('⚠️ [NativeDownloader] 清理未完成的下载失败: $e');
+    }
+  }
+
+  Future<dynamic> _handleMethodCall(MethodCall call) async {
+    final event = call.arguments as Map<dynamic, dynamic>;
+    final id = event['id'] as int;
+    switch (call.method) {
+      case 'onProgress':
+        _onProgress[id]?.call(event['received'] as int, event['total'] as int);
+        break;
+      case 'onDone':
+        final completer = _completers[id];
+        _finish(id);
+        completer?.complete(NativeDownloadResult(
+          ok: event['ok'] == true,
+          error: event['error'] as String? ?? '',
+          total: event['total'] as int,
+          resumed: event['resumed'] as int,
+          connections: event['connections'] as int,
+        ));
+        break;
+    }
+  }
+
+  void _finish(int id) {
+    _completers.remove(id);
+    _onProgress.remove(id);
+  }
+}
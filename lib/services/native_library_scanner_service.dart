@@ -0,0 +1,197 @@
+import 'dart:async';
+import 'dart:io';
+import 'package:flutter/services.dart';
+
+import 'native_tag_reader.dart';
+
+/// 原生扫描到的一首本地歌曲
+class NativeLibraryTrack {
+  final String path;
+
+  /// 原生标签读取支持的容器格式；unknown 表示原生层读不了标签（如 WAV、APE），
+  /// 需要由 Dart 自行读取元数据
+  final NativeTagFormat format;
+  final String title;
+  final String artist;
+  final String album;
+
+  /// 同名 .lrc（同目录或 Lyrics 子目录），没有时为内嵌歌词
+  final String lyric;
+
+  /// 已写入封面缓存目录的封面路径，没有封面时为空
+  final String coverPath;
+
+  const NativeLibraryTrack({
+    required this.path,
+    required this.format,
+    required this.title,
+    required this.artist,
+    required this.album,
+    required this.lyric,
+    required this.coverPath,
+  });
+
+  factory NativeLibraryTrack.fromMap(Map<dynamic, dynamic> map) {
+    final format = map['format'] as int? ?? 0;
+    return NativeLibraryTrack(
+      path: map['path'] as String,
+      format: format >= 0 && format < NativeTagFormat.values.length
+          ? NativeTagFormat.values[format]
+          : NativeTagFormat.unknown,
+      title: map['title'] as String? ?? '',
+      artist: map['artist'] as String? ?? '',
+      album: map['album'] as String? ?? '',
+      lyric: map['lyric'] as String? ?? '',
+      coverPath: map['cover'] as String? ?? '',
+    );
+  }
+}
+
+/// 一次扫描的结果
+class NativeLibraryScanResult {
+  /// 索引中记录过、但已从磁盘消失的文件
+  final List<String> removed;
+  final bool cancelled;
+
+  final int directories;
+  final int files;
+  final int changed;
+  final int unchanged;
+  final double elapsedMs;
+
+  /// 已有扫描在进行，本次没有启动；此时其余字段均为空
+  final bool busy;
+
+  const NativeLibraryScanResult({
+    required this.removed,
+    required this.cancelled,
+    required this.directories,
+    required this.files,
+    required this.changed,
+    required this.unchanged,
+    required this.elapsedMs,
+    this.busy = false,
+  });
+
+  const NativeLibraryScanResult.busy()
+      : removed = const [],
+        cancelled = false,
+        directories = 0,
+        files = 0,
+        changed = 0,
+        unchanged = 0,
+        elapsedMs = 0,
+        busy = true;
+}
+
+/// 原生本地音乐库扫描服务（Windows / Linux 平台）
+///
+/// 原生层用工作窃取线程池并行遍历目录，读取标签、同名歌词与封面（直接从
+/// 标签区域写入封面缓存目录），并维护一份 文件路径 → 大小/修改时间 的索引：
+/// 重新扫描时未变化的文件不会被打开，只报告新增、修改与删除的文件。
+/// 结果分批（按数量或时间间隔）通过 "onBatch" 回调送回 Dart。
+class NativeLibraryScannerService {
+  static final NativeLibraryScannerService _instance =
+      NativeLibraryScannerService._internal();
+  factory NativeLibraryScannerService() => _instance;
+  NativeLibraryScannerService._internal();
+
+  /// 当前平台是否支持原生扫描
+  static bool get isSupported => Platform.isWindows || Platform.isLinux;
+
+  static const MethodChannel _channel =
+      MethodChannel('com.cyrene.music/library_scanner');
+
+  bool _handlerInstalled = false;
+  void Function(List<NativeLibraryTrack> tracks)? _onTracks;
+  Completer<NativeLibraryScanResult>? _completer;
+
+  /// 扫描 [roots]，每批结果交给 [onTracks]；扫描结束后返回汇总。
+  /// 给出 [saveIndexPath] 时更新后的索引写到该处，由调用方在保存好结果后
+  /// 再替换 [indexPath]。已有扫描在进行时返回 [NativeLibraryScanResult.busy]，
+  /// 不支持或启动失败时返回 null
+  Future<NativeLibraryScanResult?> scan({
+    required List<String> roots,
+    required List<String> extensions,
+    required String indexPath,
+    String? saveIndexPath,
+    required String coverDirectory,
+    bool full = false,
+    required void Function(List<NativeLibraryTrack> tracks) onTracks,
+  }) async {
+    if (!isSupported) return null;
+    if (_completer != null) return const NativeLibraryScanResult.busy();
+    if (!_handlerInstalled) {
+      _channel.setMethodCallHandler(_handleMethodCall);
+      _handlerInstalled = true;
+    }
+
+    final completer = Completer<NativeLibraryScanResult>();
+    _completer = completer;
+    _onTracks = onTracks;
+    try {
+      final started = await _channel.invokeMethod<bool>('scan', {
+        'roots': roots,
+        'extensions': extensions,
+        'indexPath': indexPath,
+        if (saveIndexPath != null) 'saveIndexPath': saveIndexPath,
+        'coverDirectory': coverDirectory,
+        'full': full,
+      });
+      // 原生层只在上一次扫描尚未结束时拒绝启动
+      if (started != true) {
+        _finish();
+        return const NativeLibraryScanResult.busy();
+      }
+    } catch (e) {
+      print('❌ [NativeLibraryScanner] 启动扫描失败: $e');
+      _finish();
+      return null;
+    }
+    return completer.future;
+  }
+
+  /// 停止正在进行的扫描；已报告的结果仍然有效
+  Future<void> cancel() async {
+    if (!isSupported) return;
+    await _channel.invokeMethod('cancel');
+  }
+
+  /// 删除索引文件，下次扫描会重新读取所有文件
+  Future<void> resetIndex(String indexPath) async {
+    if (!isSupported) return;
+    try {
+      await _channel.invokeMethod('resetIndex', {'indexPath': indexPath});
+    } catch (e) {
+      print('⚠️ [NativeLibraryScanner] 重置索引失败: $e');
+    }
+  }
+
+  Future<dynamic> _handleMethodCall(MethodCall call) async {
+    if (call.method != 'onBatch') return;
+    final batch = call.arguments as Map<dynamic, dynamic>;
+    final tracks = (batch['tracks'] as List)
+        .map((track) => NativeLibraryTrack.fromMap(track as Map))
+        .toList();
+    if (tracks.isNotEmpty) _onTracks?.call(tracks);
+    if (batch['done'] != true) return;
+
+    final stats = batch['stats'] as Map<dynamic, dynamic>;
+    final completer = _completer;
+    _finish();
+    completer?.complete(NativeLibraryScanResult(
+      removed: List<String>.from(batch['removed'] as List),
+      cancelled: batch['cancelled'] == true,
+      directories: stats['directories'] as int,
+      files: stats['files'] as int,
+      changed: stats['changed'] as int,
+      unchanged: stats['unchanged'] as int,
+      elapsedMs: (stats['elapsedMs'] as num).toDouble(),
+    ));
+  }
+
+  void _finish() {
+    _completer = null;
+    _onTracks = null;
+  }
+}
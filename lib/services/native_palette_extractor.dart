@@ -0,0 +1,127 @@
+import 'dart:async';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+
+// 色板数量与顺序（与原生 Palette::Swatch 一致）：
+// vibrant, muted, dominant, lightVibrant, darkVibrant, lightMuted, darkMuted
+const int nativePaletteSwatchCount = 7;
+
+typedef _SubmitNative = Void Function(
+    Pointer<Uint8>,
+    Int32,
+    Int32,
+    Int32,
+    Pointer<Int32>,
+    Int32,
+    Pointer<Uint32>,
+    Int64,
+    Pointer<NativeFunction<_DoneNative>>);
+typedef _SubmitDart = void Function(
+    Pointer<Uint8>,
+    int,
+    int,
+    int,
+    Pointer<Int32>,
+    int,
+    Pointer<Uint32>,
+    int,
+    Pointer<NativeFunction<_DoneNative>>);
+typedef _DoneNative = Void Function(Int64, Int32);
+
+/// 一次提交到原生线程、尚未完成的提取；原生内存在完成后释放
+class _PendingPalette {
+  final Pointer<Uint8> pixels;
+  final Pointer<Int32> region;
+  final Pointer<Uint32> colors;
+  final Completer<List<int>?> completer;
+
+  _PendingPalette(this.pixels, this.region, this.colors, this.completer);
+}
+
+/// 原生封面取色（FFI）
+///
+/// 对已解码的 RGBA 像素做区域裁剪、SIMD 盒式降采样、5 位量化直方图与
+/// 鲜艳 / 柔和分类，算法与 ColorExtractionService 原先在 isolate 中用
+/// image 包的实现一致。提取在一个常驻的原生线程上进行，每张封面只是一次
+/// 入队，不再为每张封面启动一个 isolate；完成后通过 NativeCallable 回到
+/// 当前 isolate。
+class NativePaletteExtractor {
+  static final NativePaletteExtractor _instance =
+      NativePaletteExtractor._internal();
+  factory NativePaletteExtractor() => _instance;
+
+  _SubmitDart? _submit;
+  NativeCallable<_DoneNative>? _done;
+  final Map<int, _PendingPalette> _pending = {};
+  int _nextId = 0;
+
+  NativePaletteExtractor._internal() {
+    if (!Platform.isWindows && !Platform.isLinux) return;
+
+    try {
+      // 符号由 runner 可执行文件本身导出
+      final library = Platform.isWindows
+          ? DynamicLibrary.executable()
+          : DynamicLibrary.process();
+      _submit = library.lookupFunction<_SubmitNative, _SubmitDart>(
+        'cyrene_palette_submit',
+        isLeaf: true,
+      );
+      _done = NativeCallable<_DoneNative>.listener(_onDone);
+    } catch (e) {
+      print('⚠️ [NativePaletteExtractor] 原生取色不可用: $e');
+      _submit = null;
+    }
+  }
+
+  /// 当前平台是否有原生取色
+  bool get isAvailable => _submit != null;
+
+  /// 从 [width] x [height] 的直通 alpha RGBA 像素中提取色板，可只取
+  /// [region]（x, y, width, height，像素）。返回 [nativePaletteSwatchCount]
+  /// 个 0xAARRGGBB 颜色（没有该类颜色时为 0）；区域为空或原生不可用时
+  /// 返回 null
+  Future<List<int>?> extract(
+    Uint8List rgba,
+    int width,
+    int height, {
+    List<int>? region,
+    int sampleSize = 32,
+  }) {
+    final submit = _submit;
+    if (submit == null || rgba.length < width * height * 4) {
+      return Future.value(null);
+    }
+
+    final pixels = malloc<Uint8>(rgba.length);
+    pixels.asTypedList(rgba.length).setAll(0, rgba);
+    Pointer<Int32> nativeRegion = nullptr;
+    if (region != null) {
+      nativeRegion = malloc<Int32>(4);
+      nativeRegion.asTypedList(4).setAll(0, region);
+    }
+    final colors = calloc<Uint32>(nativePaletteSwatchCount);
+    final id = _nextId++;
+    final completer = Completer<List<int>?>();
+    _pending[id] = _PendingPalette(pixels, nativeRegion, colors, completer);
+
+    submit(pixels, width, height, width * 4, nativeRegion, sampleSize, colors,
+        id, _done!.nativeFunction);
+    return completer.future;
+  }
+
+  void _onDone(int id, int ok) {
+    final pending = _pending.remove(id);
+    if (pending == null) return;
+    final colors = ok != 0
+        ? List<int>.from(pending.colors.asTypedList(nativePaletteSwatchCount))
+        : null;
+    malloc.free(pending.pixels);
+    if (pending.region != nullptr) malloc.free(pending.region);
+    calloc.free(pending.colors);
+    pending.completer.complete(colors);
+  }
+}
@@ -0,0 +1,53 @@
+import 'dart:ffi';
+import 'dart:io';
+
+/// 播放状态（顺序与原生 PlaybackState 一致）
+enum NativePlaybackState { stopped, playing, paused }
+
+typedef _ClockUpdateNative = Void Function(Int64, Int64, Double, Int32);
+typedef _ClockUpdateDart = void Function(int, int, double, int);
+
+/// 原生共享播放时钟（FFI）
+///
+/// 播放器在进度、状态变化时写入位置/时长/速率/状态，原生侧以单调时钟打点。
+/// SMTC、桌面歌词、节奏分析直接读取并在本地推算当前位置，不再依赖通道消息。
+/// 写入是同步的叶子调用，开销远低于一次 MethodChannel 往返。
+class NativePlaybackClock {
+  static final NativePlaybackClock _instance = NativePlaybackClock._internal();
+  factory NativePlaybackClock() => _instance;
+
+  _ClockUpdateDart? _update;
+
+  NativePlaybackClock._internal() {
+    if (!Platform.isWindows && !Platform.isLinux) return;
+
+    try {
+      // 符号由 runner 可执行文件本身导出
+      final library = Platform.isWindows
+          ? DynamicLibrary.executable()
+          : DynamicLibrary.process();
+      _update = library.lookupFunction<_ClockUpdateNative, _ClockUpdateDart>(
+        'cyrene_playback_clock_update',
+        isLeaf: true,
+      );
+    } catch (e) {
+      print('⚠️ [PlaybackClock] 原生播放时钟不可用: $e');
+      _update = null;
+    }
+  }
+
+  /// 当前平台是否有原生播放时钟
+  bool get isAvailable => _update != null;
+
+  /// 写入一次采样（位置为采样时刻的位置）
+  void update({
+    required Duration position,
+    required Duration duration,
+    required NativePlaybackState state,
+    double rate = 1.0,
+  }) {
+    final update = _update;
+    if (update == null) return;
+    update(position.inMilliseconds, duration.inMilliseconds, rate, state.index);
+  }
+}
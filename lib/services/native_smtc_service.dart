@@ -1,8 +1,9 @@
 import 'dart:async';
 import 'package:flutter/services.dart';
 
-/// 原生SMTC服务（Windows平台）
-/// 通过C++层的Windows Runtime API实现系统媒体控件
+/// 原生SMTC服务（Windows / Linux 平台）
+/// Windows 通过C++层的Windows Runtime API实现系统媒体控件，
+/// Linux 由同一通道上的 MPRIS2 (D-Bus) 后端实现
 class NativeSmtcService {
   static final NativeSmtcService _instance = NativeSmtcService._internal();
   factory NativeSmtcService() => _instance;
@@ -0,0 +1,145 @@
+import 'dart:convert';
+import 'dart:ffi';
+import 'dart:io';
+import 'dart:typed_data';
+
+import 'package:ffi/ffi.dart';
+
+/// 音频容器格式（顺序与原生 AudioTags::Format 一致）
+enum NativeTagFormat { unknown, flac, mp3, m4a, ogg }
+
+/// 原生读取到的音频标签
+class NativeAudioTags {
+  final NativeTagFormat format;
+  final String? title;
+  final String? artist;
+  final String? album;
+  final String? lyrics;
+
+  /// 封面图片（仅在 [NativeTagReader.read] 传入 includeCover 时读取）
+  final Uint8List? cover;
+  final String? coverMimeType;
+
+  const NativeAudioTags({
+    required this.format,
+    this.title,
+    this.artist,
+    this.album,
+    this.lyrics,
+    this.cover,
+    this.coverMimeType,
+  });
+}
+
+typedef _OpenNative = Pointer<Void> Function(Pointer<Utf8>);
+typedef _FormatNative = Int32 Function(Pointer<Void>);
+typedef _FormatDart = int Function(Pointer<Void>);
+typedef _FieldNative = Pointer<Uint8> Function(
+    Pointer<Void>, Int32, Pointer<Int64>);
+typedef _FieldDart = Pointer<Uint8> Function(Pointer<Void>, int, Pointer<Int64>);
+typedef _CoverNative = Pointer<Uint8> Function(
+    Pointer<Void>, Pointer<Int64>, Pointer<Int64>);
+typedef _CloseNative = Void Function(Pointer<Void>);
+typedef _CloseDart = void Function(Pointer<Void>);
+
+// 字段序号（与原生 AudioTags::Field 一致）
+const int _fieldTitle = 0;
+const int _fieldArtist = 1;
+const int _fieldAlbum = 2;
+const int _fieldLyrics = 3;
+const int _fieldCoverMime = 4;
+
+/// 原生音频标签读取（FFI）
+///
+/// 原生层把文件映射到内存，只访问标签所在区域（FLAC 元数据块、ID3v2 帧、
+/// MP4 的 moov/ilst、Ogg 注释包），不再为了几 KB 的标签把整个音频文件
+/// 读进 Dart。文本字段直接指向映射中的 UTF-8 字节，封面只在需要时复制。
+class NativeTagReader {
+  static final NativeTagReader _instance = NativeTagReader._internal();
+  factory NativeTagReader() => _instance;
+
+  _OpenNative? _open;
+  _FormatDart? _format;
+  _FieldDart? _field;
+  _CoverNative? _cover;
+  _CloseDart? _close;
+
+  NativeTagReader._internal() {
+    if (!Platform.isWindows && !Platform.isLinux) return;
+
+    try {
+      // 符号由 runner 可执行文件本身导出
+      final library = Platform.isWindows
+          ? DynamicLibrary.executable()
+          : DynamicLibrary.process();
+      _open = library.lookupFunction<_OpenNative, _OpenNative>(
+        'cyrene_tags_open',
+      );
+      _format = library.lookupFunction<_FormatNative, _FormatDart>(
+        'cyrene_tags_format',
+        isLeaf: true,
+      );
+      _field = library.lookupFunction<_FieldNative, _FieldDart>(
+        'cyrene_tags_field',
+        isLeaf: true,
+      );
+      _cover = library.lookupFunction<_CoverNative, _CoverNative>(
+        'cyrene_tags_cover',
+        isLeaf: true,
+      );
+      _close = library.lookupFunction<_CloseNative, _CloseDart>(
+        'cyrene_tags_close',
+      );
+    } catch (e) {
+      print('⚠️ [NativeTagReader] 原生标签读取不可用: $e');
+      _open = null;
+    }
+  }
+
+  /// 当前平台是否有原生标签读取
+  bool get isAvailable => _open != null;
+
+  /// 读取 [filePath] 的标签；不支持的格式或无法打开时返回 null
+  NativeAudioTags? read(String filePath, {bool includeCover = false}) {
+    final open = _open;
+    if (open == null) return null;
+
+    final path = filePath.toNativeUtf8();
+    final size = calloc<Int64>(2);
+    final handle = open(path);
+    try {
+      if (handle == nullptr) return null;
+
+      String? field(int index) {
+        final data = _field!(handle, index, size);
+        if (data == nullptr) return null;
+        return utf8.decode(data.asTypedList(size.value), allowMalformed: true);
+      }
+
+      Uint8List? cover;
+      String? coverMimeType;
+      if (includeCover) {
+        final data = _cover!(handle, size, size + 1);
+        if (data != nullptr) {
+          // 映射在 close 后失效，复制一份
+          cover = Uint8List.fromList(data.asTypedList(size.value));
+          coverMimeType = field(_fieldCoverMime);
+        }
+      }
+
+      return NativeAudioTags(
+        format: NativeTagFormat.values[_format!(handle)],
+        title: field(_fieldTitle),
+        artist: field(_fieldArtist),
+        album: field(_fieldAlbum),
+        lyrics: field(_fieldLyrics),
+        cover: cover,
+        coverMimeType: coverMimeType,
+      );
+    } finally {
+      if (handle != nullptr) _close!(handle);
+      calloc.free(size);
+      malloc.free(path);
+    }
+  }
+}
@@ -26,6 +26,8 @@ import 'audio_quality_service.dart';
 import 'listening_stats_service.dart';
 import 'desktop_lyric_service.dart';
 import 'android_floating_lyric_service.dart';
+import 'native_playback_clock.dart';
+import 'native_cover_art_service.dart';
 import 'player_background_service.dart';
 import 'local_library_service.dart';
 import 'playback_state_service.dart';
@@ -189,8 +191,8 @@ class PlayerService extends ChangeNotifier {
       _equalizerEnabled = savedEqEnabled;
     }
 
-    // 设置桌面歌词播放控制回调（Windows）
-    if (Platform.isWindows) {
+    // 设置桌面歌词播放控制回调（Windows / Linux）
+    if (DesktopLyricService.isSupported) {
       DesktopLyricService().setPlaybackControlCallback((action) {
         print('🎮 [PlayerService] 桌面歌词控制: $action');
         switch (action) {
@@ -267,18 +269,20 @@ class PlayerService extends ChangeNotifier {
       switch (state) {
         case ap.PlayerState.playing:
           _state = PlayerState.playing;
+          _syncPlaybackClock();
           _startListeningTimeTracking(); // 开始听歌时长追踪
           _startStateSaveTimer(); // 开始定期保存播放状态
           // 🔥 通知原生层播放状态（后台歌词更新关键）
           if (Platform.isAndroid) {
             AndroidFloatingLyricService().setPlayingState(true);
           }
-          if (Platform.isWindows) {
+          if (DesktopLyricService.isSupported) {
             DesktopLyricService().setPlayingState(true);
           }
           break;
         case ap.PlayerState.paused:
           _state = PlayerState.paused;
+          _syncPlaybackClock();
           _pauseListeningTimeTracking(); // 暂停听歌时长追踪
           _saveCurrentPlaybackState(); // 暂停时保存状态
           _stopStateSaveTimer(); // 停止定期保存
@@ -286,32 +290,34 @@ class PlayerService extends ChangeNotifier {
           if (Platform.isAndroid) {
             AndroidFloatingLyricService().setPlayingState(false);
           }
-          if (Platform.isWindows) {
+          if (DesktopLyricService.isSupported) {
             DesktopLyricService().setPlayingState(false);
           }
           break;
         case ap.PlayerState.stopped:
           _state = PlayerState.idle;
+          _syncPlaybackClock();
           _pauseListeningTimeTracking(); // 暂停听歌时长追踪
           _stopStateSaveTimer(); // 停止定期保存
           // 🔥 通知原生层播放状态（后台歌词更新关键）
           if (Platform.isAndroid) {
             AndroidFloatingLyricService().setPlayingState(false);
           }
-          if (Platform.isWindows) {
+          if (DesktopLyricService.isSupported) {
             DesktopLyricService().setPlayingState(false);
           }
           break;
         case ap.PlayerState.completed:
           _state = PlayerState.idle;
           _position = Duration.zero;
+          _syncPlaybackClock();
           _pauseListeningTimeTracking(); // 暂停听歌时长追踪
           _stopStateSaveTimer(); // 停止定期保存
           // 🔥 通知原生层播放状态（后台歌词更新关键）
           if (Platform.isAndroid) {
             AndroidFloatingLyricService().setPlayingState(false);
           }
-          if (Platform.isWindows) {
+          if (DesktopLyricService.isSupported) {
             DesktopLyricService().setPlayingState(false);
           }
           // 歌曲播放完毕，自动播放下一首
@@ -327,6 +333,7 @@ class PlayerService extends ChangeNotifier {
     _audioPlayer!.onPositionChanged.listen((position) {
       _position = position;
       positionNotifier.value = position; // 更新独立的进度通知器
+      _syncPlaybackClock();
       _updateFloatingLyric(); // 更新桌面/悬浮歌词
       // 🔥 性能优化：使用节流同步到 Android 原生层（不再每帧同步）
       _syncPositionToNative(position);
@@ -337,6 +344,7 @@ class PlayerService extends ChangeNotifier {
     // 监听总时长
     _audioPlayer!.onDurationChanged.listen((duration) {
       _duration = duration;
+      _syncPlaybackClock();
       notifyListeners();
     });
 
@@ -445,16 +453,17 @@ class PlayerService extends ChangeNotifier {
       // 1. 检查缓存
       final qualityStr = selectedQuality.toString().split('.').last;
       final isCached = CacheService().isCached(track);
+      if (!isCached) CacheService().recordMiss();
 
       if (isCached) {
         print('💾 [PlayerService] 使用缓存播放');
         
         // 获取缓存的元数据
-        final metadata = CacheService().getCachedMetadata(track);
+        final metadata = await CacheService().getCachedMetadata(track);
         final cachedFilePath = await CacheService().getCachedFilePath(track);
 
         if (cachedFilePath != null && metadata != null) {
-          // 记录临时文件路径（用于后续清理）
+          // 记录临时文件路径或串流地址（用于后续清理）
           _currentTempFilePath = cachedFilePath;
           
           _currentSong = SongDetail(
@@ -489,7 +498,10 @@ class PlayerService extends ChangeNotifier {
              await _mediaKitPlayer!.open(mk.Media(cachedFilePath));
              await _mediaKitPlayer!.play();
           } else {
-             await _audioPlayer!.play(ap.DeviceFileSource(cachedFilePath));
+             // 桌面端返回的是本地串流地址
+             await _audioPlayer!.play(cachedFilePath.startsWith('http')
+                 ? ap.UrlSource(cachedFilePath)
+                 : ap.DeviceFileSource(cachedFilePath));
              print('✅ [PlayerService/AudioPlayer] 从缓存播放: $cachedFilePath');
           }
           print('📝 [PlayerService] 歌词已从缓存恢复 (长度: ${_currentSong!.lyric.length})');
@@ -1551,6 +1563,7 @@ class PlayerService extends ChangeNotifier {
       _position = position;
       positionNotifier.value = position;
       // 强制立即同步到原生层
+      _syncPlaybackClock();
       _syncPositionToNative(position, force: true);
       print('⏩ [PlayerService] 跳转到: ${position.inSeconds}s');
     } catch (e) {
@@ -1558,6 +1571,28 @@ class PlayerService extends ChangeNotifier {
     }
   }
 
+  /// 将位置/时长/状态写入原生共享播放时钟（Windows / Linux）
+  ///
+  /// 同步 FFI 调用，无通道开销，可在每次进度回调中调用
+  void _syncPlaybackClock() {
+    final NativePlaybackState state;
+    switch (_state) {
+      case PlayerState.playing:
+        state = NativePlaybackState.playing;
+        break;
+      case PlayerState.paused:
+        state = NativePlaybackState.paused;
+        break;
+      default:
+        state = NativePlaybackState.stopped;
+    }
+    NativePlaybackClock().update(
+      position: _position,
+      duration: _duration,
+      state: state,
+    );
+  }
+
   /// 节流同步位置到 Android 原生层
   void _syncPositionToNative(Duration position, {bool force = false}) {
     if (!Platform.isAndroid) return;
@@ -1647,9 +1682,10 @@ class PlayerService extends ChangeNotifier {
     _mediaKitPlayingSub = _mediaKitPlayer!.stream.playing.listen((playing) {
       if (playing) {
         _state = PlayerState.playing;
+        _syncPlaybackClock();
         _startListeningTimeTracking();
         _startStateSaveTimer();
-        if (Platform.isWindows) {
+        if (DesktopLyricService.isSupported) {
           DesktopLyricService().setPlayingState(true);
         }
         if (Platform.isAndroid) {
@@ -1658,10 +1694,11 @@ class PlayerService extends ChangeNotifier {
       } else {
         if (_state == PlayerState.playing) {
           _state = PlayerState.paused;
+          _syncPlaybackClock();
           _pauseListeningTimeTracking();
           _saveCurrentPlaybackState();
           _stopStateSaveTimer();
-          if (Platform.isWindows) {
+          if (DesktopLyricService.isSupported) {
             DesktopLyricService().setPlayingState(false);
           }
           if (Platform.isAndroid) {
@@ -1675,6 +1712,7 @@ class PlayerService extends ChangeNotifier {
     _mediaKitPositionSub = _mediaKitPlayer!.stream.position.listen((position) {
       _position = position;
       positionNotifier.value = position; // 更新独立的进度通知器
+      _syncPlaybackClock();
       _updateFloatingLyric();
       // 🔧 性能优化：不再在进度更新时调用 notifyListeners()，避免全国范围的 UI 重建
       // notifyListeners(); 
@@ -1682,6 +1720,7 @@ class PlayerService extends ChangeNotifier {
 
     _mediaKitDurationSub = _mediaKitPlayer!.stream.duration.listen((duration) {
       _duration = duration ?? Duration.zero;
+      _syncPlaybackClock();
       notifyListeners();
     });
 
@@ -1689,9 +1728,10 @@ class PlayerService extends ChangeNotifier {
       if (completed) {
         _state = PlayerState.idle;
         _position = Duration.zero;
+        _syncPlaybackClock();
         _pauseListeningTimeTracking();
         _stopStateSaveTimer();
-        if (Platform.isWindows) {
+        if (DesktopLyricService.isSupported) {
           DesktopLyricService().setPlayingState(false);
         }
         if (Platform.isAndroid) {
@@ -1739,11 +1779,9 @@ class PlayerService extends ChangeNotifier {
   Future<void> _cleanupCurrentTempFile() async {
     if (_currentTempFilePath != null) {
       try {
-        final tempFile = File(_currentTempFilePath!);
-        if (await tempFile.exists()) {
-          await tempFile.delete();
-          print('🧹 [PlayerService] 已删除临时文件: $_currentTempFilePath');
-        }
+        // 临时文件会被删除，缓存串流地址会被关闭
+        await CacheService().releaseCachedFilePath(_currentTempFilePath!);
+        print('🧹 [PlayerService] 已释放临时文件: $_currentTempFilePath');
       } catch (e) {
         print('⚠️ [PlayerService] 删除临时文件失败: $e');
       } finally {
@@ -2159,11 +2197,13 @@ class PlayerService extends ChangeNotifier {
     final currentTrack = _currentTrack;
     
     // 更新桌面歌词的歌曲信息（Windows）
-    if (Platform.isWindows && DesktopLyricService().isVisible && currentTrack != null) {
+    if (DesktopLyricService.isSupported && DesktopLyricService().isVisible && currentTrack != null) {
+      // 控制面板从原生封面缓存读取，与 SMTC 共用同一份解码结果
+      NativeCoverArtService().ensureCached(currentTrack.picUrl);
       DesktopLyricService().setSongInfo(
         title: currentTrack.name,
         artist: currentTrack.artists,
-        albumCover: currentTrack.picUrl,
+        albumCover: NativeCoverArtService.keyFor(currentTrack.picUrl),
       );
     }
     
@@ -2173,7 +2213,10 @@ class PlayerService extends ChangeNotifier {
       _currentLyricIndex = -1;
       
       // 清空歌词显示
-      if (Platform.isWindows && DesktopLyricService().isVisible) {
+      if (DesktopLyricService.isSupported) {
+        DesktopLyricService().setLyricSheet(const []);
+      }
+      if (DesktopLyricService.isSupported && DesktopLyricService().isVisible) {
         DesktopLyricService().setLyricText('');
       }
       if (Platform.isAndroid && AndroidFloatingLyricService().isVisible) {
@@ -2219,6 +2262,11 @@ class PlayerService extends ChangeNotifier {
 
       _currentLyricIndex = -1;
       print('🎵 [PlayerService] 悬浮歌词已加载: ${_lyrics.length} 行');
+
+      // 整首歌词一次性交给桌面歌词，换行时只发送行号
+      if (DesktopLyricService.isSupported) {
+        DesktopLyricService().setLyricSheet(_lyrics);
+      }
       
       // 🔥 关键优化：异步分发歌词数据到 Android 原生层
       // 避免在播放启动的关键帧进行大规模对象序列化，造成卡顿
@@ -2249,10 +2297,10 @@ class PlayerService extends ChangeNotifier {
     if (_lyrics.isEmpty) return;
     
     // 检查是否有可见的歌词服务
-    final isWindowsVisible = Platform.isWindows && DesktopLyricService().isVisible;
+    final isDesktopLyricVisible = DesktopLyricService.isSupported && DesktopLyricService().isVisible;
     final isAndroidVisible = Platform.isAndroid && AndroidFloatingLyricService().isVisible;
     
-    if (!isWindowsVisible && !isAndroidVisible) return;
+    if (!isDesktopLyricVisible && !isAndroidVisible) return;
 
     try {
       final newIndex = LyricParser.findCurrentLineIndex(_lyrics, _position);
@@ -2261,25 +2309,9 @@ class PlayerService extends ChangeNotifier {
         _currentLyricIndex = newIndex;
         final currentLine = _lyrics[newIndex];
         
-        // 计算当前歌词行的持续时间（毫秒）
-        int? durationMs;
-        if (newIndex + 1 < _lyrics.length) {
-          // 下一行歌词的时间减去当前行的时间
-          durationMs = _lyrics[newIndex + 1].startTime.inMilliseconds - currentLine.startTime.inMilliseconds;
-        } else {
-          // 最后一行歌词，使用默认3秒
-          durationMs = 3000;
-        }
-        
-        // 更新Windows桌面歌词（分别发送歌词和翻译）
-        if (isWindowsVisible) {
-          DesktopLyricService().setLyricText(currentLine.text, durationMs: durationMs);
-          // 发送翻译文本（如果有）
-          if (currentLine.translation != null && currentLine.translation!.isNotEmpty) {
-            DesktopLyricService().setTranslationText(currentLine.translation!);
-          } else {
-            DesktopLyricService().setTranslationText('');
-          }
+        // 更新桌面歌词（歌词表已上传，只发送行号；时长由原生侧计算）
+        if (isDesktopLyricVisible) {
+          DesktopLyricService().showLyricLine(newIndex);
         }
         
         // 更新Android悬浮歌词（保持原有逻辑，合并显示）
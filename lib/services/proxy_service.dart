@@ -1,6 +1,7 @@
 import 'dart:async';
 import 'dart:io';
 import 'dart:convert';
+import 'package:flutter/services.dart';
 import 'package:shelf/shelf.dart' as shelf;
 import 'package:shelf/shelf_io.dart' as shelf_io;
 import 'package:http/http.dart' as http;
@@ -8,14 +9,24 @@ import 'developer_mode_service.dart';
 
 /// 本地 HTTP 代理服务
 /// 用于处理 QQ 音乐等需要特殊请求头的音频流
+///
+/// Windows / Linux 上由原生 StreamProxy 提供（事件循环转发，音频数据不经过
+/// Dart isolate），URL 约定与请求头改写规则与下方 shelf 实现一致；
+/// 原生代理不可用时回退到 shelf。
 class ProxyService {
   static final ProxyService _instance = ProxyService._internal();
   factory ProxyService() => _instance;
   ProxyService._internal();
 
+  static const MethodChannel _nativeChannel =
+      MethodChannel('com.cyrene.music/stream_proxy');
+
   HttpServer? _server;
   int _port = 8888;
   bool _isRunning = false;
+  bool _isNative = false;
+
+  static bool get _nativeSupported => Platform.isWindows || Platform.isLinux;
 
   bool get isRunning => _isRunning;
   int get port => _port;
@@ -28,6 +39,8 @@ class ProxyService {
       return true;
     }
 
+    if (_nativeSupported && await _startNative()) return true;
+
     try {
       // 尝试多个端口，避免端口冲突
       for (int port = 8888; port < 8898; port++) {
@@ -65,8 +78,38 @@ class ProxyService {
     }
   }
 
+  /// 启动原生代理，失败时返回 false 以回退到 shelf
+  Future<bool> _startNative() async {
+    try {
+      final port = await _nativeChannel.invokeMethod<int>('start');
+      if (port == null) return false;
+      _port = port;
+      _isRunning = true;
+      _isNative = true;
+      print('✅ [ProxyService] 原生代理服务器已启动: http://localhost:$_port');
+      DeveloperModeService().addLog('✅ [ProxyService] 原生代理服务器已启动: http://localhost:$_port');
+      return true;
+    } catch (e) {
+      print('⚠️ [ProxyService] 原生代理不可用，回退到 Dart 实现: $e');
+      DeveloperModeService().addLog('⚠️ [ProxyService] 原生代理不可用，回退到 Dart 实现: $e');
+      return false;
+    }
+  }
+
   /// 停止代理服务器
   Future<void> stop() async {
+    if (_isNative) {
+      _isNative = false;
+      _isRunning = false;
+      try {
+        await _nativeChannel.invokeMethod('stop');
+      } catch (e) {
+        print('⚠️ [ProxyService] 停止原生代理失败: $e');
+      }
+      print('⏹️ [ProxyService] 代理服务器已停止');
+      DeveloperModeService().addLog('⏹️ [ProxyService] 代理服务器已停止');
+      return;
+    }
     if (_server != null) {
       await _server!.close();
       _server = null;
@@ -4,9 +4,10 @@ import 'player_service.dart';
 import 'tray_service.dart';
 import 'audio_handler_service.dart';
 import 'native_smtc_service.dart';
+import 'native_cover_art_service.dart';
 
 /// 系统媒体控件服务
-/// 用于在 Windows 和 Android 平台上集成原生媒体控件
+/// 用于在 Windows、Linux 和 Android 平台上集成原生媒体控件
 class SystemMediaService {
   static final SystemMediaService _instance = SystemMediaService._internal();
   factory SystemMediaService() => _instance;
@@ -22,13 +23,19 @@ class SystemMediaService {
   int? _lastSongId;  // 使用 hashCode 作为唯一标识
   PlayerState? _lastPlayerState;
 
+  // 每次元数据更新递增，等待封面缓存期间切歌时丢弃旧的更新
+  int _metadataGeneration = 0;
+
+  // 封面下载较慢时不再等待，SMTC 退回到从 URL 加载
+  static const Duration _coverCacheWait = Duration(seconds: 2);
+
   /// 初始化系统媒体控件
   Future<void> initialize() async {
     if (_initialized) return;
 
     try {
-      if (Platform.isWindows) {
-        await _initializeWindows();
+      if (Platform.isWindows || Platform.isLinux) {
+        await _initializeNativeSmtc();
       } else if (Platform.isAndroid || Platform.isIOS) {
         // 🔧 关键修复：移动端不在启动时初始化 audio_service，避免音频系统初始化导致的杂音
         // audio_service 将在第一次播放时才初始化（见 _ensureMobileInitialized 方法）
@@ -53,8 +60,8 @@ class SystemMediaService {
     _mobileInitialized = true;
   }
 
-  /// 初始化 Windows 媒体控件 (SMTC)
-  Future<void> _initializeWindows() async {
+  /// 初始化桌面端媒体控件（Windows SMTC / Linux MPRIS）
+  Future<void> _initializeNativeSmtc() async {
     try {
       _nativeSmtc = NativeSmtcService();
       await _nativeSmtc!.initialize();
@@ -67,9 +74,9 @@ class SystemMediaService {
       // 初始状态设置为停止
       await _nativeSmtc!.updatePlaybackStatus(SmtcPlaybackStatus.stopped);
       
-      print('✅ [SystemMediaService] Windows SMTC 初始化成功');
+      print('✅ [SystemMediaService] 原生媒体控件初始化成功');
     } catch (e) {
-      print('❌ [SystemMediaService] Windows SMTC 初始化失败: $e');
+      print('❌ [SystemMediaService] 原生媒体控件初始化失败: $e');
     }
   }
 
@@ -192,8 +199,8 @@ class SystemMediaService {
       }
     }
 
-    if (Platform.isWindows && _nativeSmtc != null) {
-      _updateWindowsMedia(player, song, track);
+    if (_nativeSmtc != null) {
+      _updateNativeMedia(player, song, track);
     }
     // Android 平台的媒体通知由 AudioHandler 自动处理，无需在此手动更新
 
@@ -215,8 +222,8 @@ class SystemMediaService {
     return null;
   }
 
-  /// 更新 Windows 媒体信息（智能更新，避免频繁刷新）
-  void _updateWindowsMedia(PlayerService player, dynamic song, dynamic track) {
+  /// 更新桌面端媒体信息（智能更新，避免频繁刷新）
+  void _updateNativeMedia(PlayerService player, dynamic song, dynamic track) {
     try {
       final currentSongId = _getCurrentSongId(song, track);
       final currentState = player.state;
@@ -273,7 +280,7 @@ class SystemMediaService {
         );
       }
     } catch (e) {
-      print('❌ [SystemMediaService] 更新 Windows 媒体信息失败: $e');
+      print('❌ [SystemMediaService] 更新原生媒体信息失败: $e');
     }
   }
   
@@ -300,14 +307,21 @@ class SystemMediaService {
     print('   💿 专辑: $album');
     print('   🖼️ 封面: ${thumbnail.isNotEmpty ? "已设置" : "无"}');
     
-    _nativeSmtc!.updateMetadata(
-      title: title,
-      artist: artist,
-      album: album,
-      thumbnail: thumbnail.isNotEmpty ? thumbnail : null,
-    );
-    
-    print('✅ [SystemMediaService] 元数据已更新到 SMTC');
+    // 先把封面交给原生缓存，SMTC 直接使用解码好的缩略图
+    final generation = ++_metadataGeneration;
+    NativeCoverArtService()
+        .ensureCached(thumbnail)
+        .timeout(_coverCacheWait, onTimeout: () {})
+        .whenComplete(() {
+      if (generation != _metadataGeneration || _nativeSmtc == null) return;
+      _nativeSmtc!.updateMetadata(
+        title: title,
+        artist: artist,
+        album: album,
+        thumbnail: thumbnail.isNotEmpty ? thumbnail : null,
+      );
+      print('✅ [SystemMediaService] 元数据已更新到 SMTC');
+    });
   }
 
   /// 将播放状态转换为 SMTC 播放状态
@@ -1,6 +1,7 @@
 import 'dart:io';
 import 'dart:convert';
 import 'dart:typed_data';
+import '../services/native_tag_reader.dart';
 
 /// 专门用于解析音频文件（MP3/FLAC）内嵌元数据的实用工具
 class MetadataReader {
@@ -10,6 +11,13 @@ class MetadataReader {
       final file = File(filePath);
       if (!await file.exists()) return null;
 
+      // 桌面端由原生层只读取标签区域（另支持 M4A / Ogg）；
+      // 原生层读取失败时仍走下面的 Dart 解析
+      if (NativeTagReader().isAvailable) {
+        final tags = NativeTagReader().read(filePath);
+        if (tags != null) return tags.lyrics;
+      }
+
       final extension = filePath.toLowerCase().split('.').last;
       if (extension == 'flac') {
         return await _extractFlacLyrics(file);
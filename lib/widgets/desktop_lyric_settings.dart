@@ -1,4 +1,3 @@
-import 'dart:io';
 import 'package:flutter/material.dart';
 import 'package:fluent_ui/fluent_ui.dart' as fluent_ui;
 import 'package:flutter_colorpicker/flutter_colorpicker.dart';
@@ -23,6 +22,7 @@ class _DesktopLyricSettingsState extends State<DesktopLyricSettings> {
   late bool _isDraggable;
   late bool _isMouseTransparent;
   late bool _isVertical;
+  late bool _showSpectrum;
 
   @override
   void initState() {
@@ -40,6 +40,7 @@ class _DesktopLyricSettingsState extends State<DesktopLyricSettings> {
       _isDraggable = config['isDraggable'] as bool;
       _isMouseTransparent = config['isMouseTransparent'] as bool;
       _isVertical = config['isVertical'] as bool;
+      _showSpectrum = config['showSpectrum'] as bool;
     });
   }
 
@@ -121,11 +122,11 @@ class _DesktopLyricSettingsState extends State<DesktopLyricSettings> {
 
   @override
   Widget build(BuildContext context) {
-    if (!Platform.isWindows) {
+    if (!DesktopLyricService.isSupported) {
       return const Card(
         child: Padding(
           padding: EdgeInsets.all(16.0),
-          child: Text('桌面歌词功能仅支持Windows平台'),
+          child: Text('桌面歌词功能仅支持Windows和Linux平台'),
         ),
       );
     }
@@ -251,6 +252,19 @@ class _DesktopLyricSettingsState extends State<DesktopLyricSettings> {
               _desktopLyricService.setVertical(value);
             },
           ),
+          // 频谱条
+          FluentSwitchTile(
+            icon: fluent_ui.FluentIcons.music_note,
+            title: '频谱条',
+            subtitle: '在歌词背后显示随音乐跳动的频谱',
+            value: _showSpectrum,
+            onChanged: (value) {
+              setState(() {
+                _showSpectrum = value;
+              });
+              _desktopLyricService.setShowSpectrum(value);
+            },
+          ),
           // 测试按钮
           FluentSettingsTile(
             icon: fluent_ui.FluentIcons.play,
@@ -405,6 +419,20 @@ class _DesktopLyricSettingsState extends State<DesktopLyricSettings> {
               },
             ),
 
+            // 频谱条
+            SwitchListTile(
+              secondary: const Icon(Icons.equalizer),
+              title: const Text('频谱条'),
+              subtitle: const Text('在歌词背后显示随音乐跳动的频谱'),
+              value: _showSpectrum,
+              onChanged: (value) {
+                setState(() {
+                  _showSpectrum = value;
+                });
+                _desktopLyricService.setShowSpectrum(value);
+              },
+            ),
+
             const SizedBox(height: 16),
             
             // 测试按钮
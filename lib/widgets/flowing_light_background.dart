@@ -106,8 +106,18 @@ class _FlowingLightBackgroundState extends State<FlowingLightBackground> with Si
       return;
     }
 
+    final provider = widget.imageProvider!;
+    final cached = DynamicBgProcessor.cachedResult(
+      provider,
+      desktop: widget.useDesktopProcessing,
+    );
+    if (cached != null) {
+      if (mounted) setState(() => _processedImage = cached);
+      return;
+    }
+
     try {
-      final stream = widget.imageProvider!.resolve(const ImageConfiguration());
+      final stream = provider.resolve(const ImageConfiguration());
       final completer = Completer<ui.Image>();
       
       final listener = ImageStreamListener((info, _) {
@@ -118,15 +128,14 @@ class _FlowingLightBackgroundState extends State<FlowingLightBackground> with Si
       final rawImage = await completer.future;
       stream.removeListener(listener);
 
-      // Process in a microtask or isolate ideally, but here we do async gaps
-      // Since DynamicBgProcessor uses GPU/Canvas, it must be on main thread (mostly).
-      // If it's too slow, we might see a frame drop. The operations are relatively cheap on GPU though.
-      // But readPixels (calculateBrightness) is slow.
-      
-      
-      final processed = widget.useDesktopProcessing 
-          ? await DynamicBgProcessor.processImageDesktop(rawImage)
-          : await DynamicBgProcessor.processImage(rawImage);
+      // On desktop the pipeline runs on a native worker thread and only the
+      // finished texture comes back; elsewhere it is drawn through ui.Image
+      // in async gaps on this thread. Results are cached per cover.
+      final processed = await DynamicBgProcessor.processCached(
+        provider,
+        rawImage,
+        desktop: widget.useDesktopProcessing,
+      );
 
       if (mounted && widget.imageProvider == _lastProvider) {
         setState(() {
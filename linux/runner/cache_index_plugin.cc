@@ -0,0 +1,208 @@
+#include "cache_index_plugin.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fl_method_args.h"
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/cache_index";
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+FlMethodResponse* WriteFailed(const char* message) {
+  return FL_METHOD_RESPONSE(
+      fl_method_error_response_new("WRITE_FAILED", message, nullptr));
+}
+
+FlValue* ToList(const std::vector<std::string>& keys) {
+  FlValue* list = fl_value_new_list();
+  for (const std::string& key : keys) {
+    fl_value_append_take(list, fl_value_new_string(key.c_str()));
+  }
+  return list;
+}
+
+FlValue* Int64(uint64_t n) { return fl_value_new_int(static_cast<int64_t>(n)); }
+
+}  // namespace
+
+// static
+void CacheIndexPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new CacheIndexPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "cache_index_plugin",
+      plugin,
+      [](gpointer data) { delete static_cast<CacheIndexPlugin*>(data); });
+}
+
+CacheIndexPlugin::CacheIndexPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+}
+
+CacheIndexPlugin::~CacheIndexPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  g_object_unref(method_channel_);
+}
+
+// static
+void CacheIndexPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                          FlMethodCall* method_call,
+                                          gpointer user_data) {
+  auto* plugin = static_cast<CacheIndexPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* CacheIndexPlugin::HandleMethodCall(
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "open") == 0) {
+    std::string path;
+    if (!GetStringArg(args, "path", &path)) {
+      return InvalidArgument("Missing 'path' argument");
+    }
+    if (!index_.Open(path)) {
+      const std::string message = "Cannot open " + path;
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "OPEN_FAILED", message.c_str(), nullptr));
+    }
+    FlValue* keys = fl_value_new_list();
+    std::vector<int64_t> sizes;
+    sizes.reserve(index_.entries().size());
+    for (const auto& [key, entry] : index_.entries()) {
+      fl_value_append_take(keys, fl_value_new_string(key.c_str()));
+      sizes.push_back(static_cast<int64_t>(entry.file_size));
+    }
+    FlValue* loaded = fl_value_new_map();
+    fl_value_set_string_take(loaded, "keys", keys);
+    fl_value_set_string_take(loaded, "sizes",
+                             fl_value_new_int64_list(sizes.data(), sizes.size()));
+    return SuccessResponse(loaded);
+
+  } else if (strcmp(method, "get") == 0) {
+    std::string key;
+    if (!GetStringArg(args, "key", &key)) {
+      return InvalidArgument("Missing 'key' argument");
+    }
+    std::string metadata;
+    if (!index_.ReadMetadata(key, &metadata)) {
+      return SuccessResponse(fl_value_new_null());
+    }
+    return SuccessResponse(
+        fl_value_new_string_sized(metadata.data(), metadata.size()));
+
+  } else if (strcmp(method, "put") == 0) {
+    std::string key;
+    int64_t size = 0;
+    std::string metadata;
+    if (!GetStringArg(args, "key", &key)) {
+      return InvalidArgument("Missing 'key' argument");
+    }
+    if (!GetIntArg(args, "size", &size)) {
+      return InvalidArgument("Missing 'size' argument");
+    }
+    if (!GetStringArg(args, "metadata", &metadata)) {
+      return InvalidArgument("Missing 'metadata' argument");
+    }
+    const int64_t now = NowMs();
+    if (!index_.Put(key, static_cast<uint64_t>(size), metadata, now)) {
+      return WriteFailed("Cannot update the cache index");
+    }
+    // The new song may push the cache over its budget.
+    return SuccessResponse(ToList(evictor_.Enforce(&index_, now)));
+
+  } else if (strcmp(method, "putAll") == 0) {
+    std::vector<std::string> keys;
+    std::vector<int64_t> sizes;
+    std::vector<std::string> metadata;
+    if (!GetStringListArg(args, "keys", &keys) ||
+        !GetIntListArg(args, "sizes", &sizes) ||
+        !GetStringListArg(args, "metadata", &metadata) ||
+        sizes.size() != keys.size() || metadata.size() != keys.size()) {
+      return InvalidArgument("Invalid 'keys', 'sizes' or 'metadata' argument");
+    }
+    const int64_t now = NowMs();
+    for (size_t i = 0; i < keys.size(); ++i) {
+      if (!index_.Put(keys[i], static_cast<uint64_t>(sizes[i]), metadata[i],
+                      now)) {
+        return WriteFailed("Cannot update the cache index");
+      }
+    }
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "remove") == 0) {
+    std::string key;
+    if (!GetStringArg(args, "key", &key)) {
+      return InvalidArgument("Missing 'key' argument");
+    }
+    if (!index_.Remove(key)) {
+      return WriteFailed("Cannot update the cache index");
+    }
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "touch") == 0) {
+    std::string key;
+    if (!GetStringArg(args, "key", &key)) {
+      return InvalidArgument("Missing 'key' argument");
+    }
+    const bool hit = index_.Touch(key, NowMs());
+    if (hit) evictor_.RecordHit();
+    return SuccessResponse(fl_value_new_bool(hit));
+
+  } else if (strcmp(method, "clear") == 0) {
+    if (!index_.Clear()) {
+      return WriteFailed("Cannot clear the cache index");
+    }
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "configure") == 0) {
+    std::string directory;
+    int64_t budget = 0;
+    std::string policy;
+    if (!GetStringArg(args, "directory", &directory) ||
+        !GetIntArg(args, "budget", &budget) ||
+        !GetStringArg(args, "policy", &policy) || budget < 0 ||
+        (policy != "lru" && policy != "lfu")) {
+      return InvalidArgument("Invalid 'directory', 'budget' or 'policy'");
+    }
+    using Policy = cyrene_music::CacheEvictor::Policy;
+    evictor_.Configure(directory, static_cast<uint64_t>(budget),
+                       policy == "lfu" ? Policy::kLfu : Policy::kLru);
+    return SuccessResponse(ToList(evictor_.Enforce(&index_, NowMs())));
+
+  } else if (strcmp(method, "miss") == 0) {
+    evictor_.RecordMiss();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "metrics") == 0) {
+    const cyrene_music::CacheEvictor::Metrics& metrics = evictor_.metrics();
+    FlValue* value = fl_value_new_map();
+    fl_value_set_string_take(value, "hits", Int64(metrics.hits));
+    fl_value_set_string_take(value, "misses", Int64(metrics.misses));
+    fl_value_set_string_take(value, "evictions", Int64(metrics.evictions));
+    fl_value_set_string_take(value, "evictedBytes",
+                             Int64(metrics.evicted_bytes));
+    fl_value_set_string_take(value, "budget", Int64(evictor_.budget_bytes()));
+    return SuccessResponse(value);
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
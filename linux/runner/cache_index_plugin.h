@@ -0,0 +1,33 @@
+#ifndef RUNNER_CACHE_INDEX_PLUGIN_H_
+#define RUNNER_CACHE_INDEX_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "cache/cache_evictor.h"
+#include "cache/cache_index.h"
+
+// Serves CacheService's song index from a native CacheIndex, with the same
+// "cache_index" method set as the Windows runner, budget enforcement and
+// hit/miss metrics included.
+class CacheIndexPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit CacheIndexPlugin(FlMethodChannel* channel);
+  ~CacheIndexPlugin();
+
+  CacheIndexPlugin(const CacheIndexPlugin&) = delete;
+  CacheIndexPlugin& operator=(const CacheIndexPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  FlMethodChannel* method_channel_;
+  cyrene_music::CacheIndex index_;
+  cyrene_music::CacheEvictor evictor_;
+};
+
+#endif  // RUNNER_CACHE_INDEX_PLUGIN_H_
@@ -0,0 +1,177 @@
+#include "cache_stream_plugin.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "cache/cache_stream_server.h"
+#include "fl_method_args.h"
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/cache_stream";
+
+}  // namespace
+
+// static
+void CacheStreamPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new CacheStreamPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "cache_stream_plugin",
+      plugin,
+      [](gpointer data) { delete static_cast<CacheStreamPlugin*>(data); });
+}
+
+CacheStreamPlugin::CacheStreamPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+}
+
+CacheStreamPlugin::~CacheStreamPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  // Streams still being read by the player end with the view, not with
+  // static destruction. Unfinished writers delete their partial files.
+  cyrene_music::CacheStreamServer::Shared().Stop();
+  g_object_unref(method_channel_);
+}
+
+// static
+void CacheStreamPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                           FlMethodCall* method_call,
+                                           gpointer user_data) {
+  auto* plugin = static_cast<CacheStreamPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* CacheStreamPlugin::HandleMethodCall(
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "open") == 0) {
+    std::string path;
+    std::string extension;
+    if (!GetStringArg(args, "path", &path)) {
+      return InvalidArgument("Missing 'path' argument");
+    }
+    if (!GetStringArg(args, "extension", &extension)) {
+      return InvalidArgument("Missing 'extension' argument");
+    }
+    const std::string url =
+        cyrene_music::CacheStreamServer::Shared().Open(path, extension);
+    if (url.empty()) {
+      const std::string message = "Cannot stream " + path;
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "OPEN_FAILED", message.c_str(), nullptr));
+    }
+    return SuccessResponse(fl_value_new_string(url.c_str()));
+
+  } else if (strcmp(method, "close") == 0) {
+    std::string url;
+    if (!GetStringArg(args, "url", &url)) {
+      return InvalidArgument("Missing 'url' argument");
+    }
+    cyrene_music::CacheStreamServer::Shared().Close(url);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "beginWrite") == 0) {
+    std::string path;
+    int64_t reserve = 0;
+    if (!GetStringArg(args, "path", &path)) {
+      return InvalidArgument("Missing 'path' argument");
+    }
+    if (!GetIntArg(args, "reserve", &reserve) || reserve < 0) {
+      return InvalidArgument("Invalid 'reserve' argument");
+    }
+    auto writer = std::make_unique<cyrene_music::CyreneCacheWriter>();
+    if (!writer->Begin(path, static_cast<size_t>(reserve))) {
+      const std::string message = "Cannot create " + path;
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_FAILED", message.c_str(), nullptr));
+    }
+    const int64_t id = next_writer_id_++;
+    writers_.emplace(id, std::move(writer));
+    return SuccessResponse(fl_value_new_int(id));
+
+  } else if (strcmp(method, "write") == 0) {
+    int64_t id = 0;
+    FlMethodResponse* error = nullptr;
+    cyrene_music::CyreneCacheWriter* writer = FindWriter(args, &id, &error);
+    if (writer == nullptr) return error;
+    FlValue* bytes = LookupArg(args, "bytes");
+    if (bytes == nullptr ||
+        fl_value_get_type(bytes) != FL_VALUE_TYPE_UINT8_LIST) {
+      return InvalidArgument("Invalid 'bytes' argument");
+    }
+    // Straight from the message buffer, without a copy.
+    if (!writer->Write(fl_value_get_uint8_list(bytes),
+                       fl_value_get_length(bytes))) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_FAILED", "Cache write failed", nullptr));
+    }
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "digest") == 0) {
+    int64_t id = 0;
+    FlMethodResponse* error = nullptr;
+    cyrene_music::CyreneCacheWriter* writer = FindWriter(args, &id, &error);
+    if (writer == nullptr) return error;
+    FlValue* digest = fl_value_new_map();
+    fl_value_set_string_take(
+        digest, "size",
+        fl_value_new_int(static_cast<int64_t>(writer->audio_size())));
+    fl_value_set_string_take(digest, "checksum",
+                             fl_value_new_string(writer->Digest().c_str()));
+    return SuccessResponse(digest);
+
+  } else if (strcmp(method, "commit") == 0) {
+    int64_t id = 0;
+    FlMethodResponse* error = nullptr;
+    cyrene_music::CyreneCacheWriter* writer = FindWriter(args, &id, &error);
+    if (writer == nullptr) return error;
+    std::string metadata;
+    if (!GetStringArg(args, "metadata", &metadata)) {
+      return InvalidArgument("Missing 'metadata' argument");
+    }
+    const bool committed = writer->Commit(metadata);
+    writers_.erase(id);
+    if (!committed) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "WRITE_FAILED", "Cache commit failed", nullptr));
+    }
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "abort") == 0) {
+    int64_t id = 0;
+    if (!GetIntArg(args, "id", &id)) {
+      return InvalidArgument("Missing 'id' argument");
+    }
+    // Destroying the writer deletes its partial file.
+    writers_.erase(id);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+cyrene_music::CyreneCacheWriter* CacheStreamPlugin::FindWriter(
+    FlValue* args, int64_t* id, FlMethodResponse** error) {
+  if (!GetIntArg(args, "id", id)) {
+    *error = InvalidArgument("Missing 'id' argument");
+    return nullptr;
+  }
+  const auto it = writers_.find(*id);
+  if (it == writers_.end()) {
+    *error = InvalidArgument("Unknown writer");
+    return nullptr;
+  }
+  return it->second.get();
+}
@@ -0,0 +1,42 @@
+#ifndef RUNNER_CACHE_STREAM_PLUGIN_H_
+#define RUNNER_CACHE_STREAM_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "cache/cyrene_cache_writer.h"
+
+// Streams cached .cyrene songs to the player and writes downloads into the
+// cache, serving the same "cache_stream" method set as the Windows runner.
+class CacheStreamPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit CacheStreamPlugin(FlMethodChannel* channel);
+  ~CacheStreamPlugin();
+
+  CacheStreamPlugin(const CacheStreamPlugin&) = delete;
+  CacheStreamPlugin& operator=(const CacheStreamPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // nullptr, with *error set, if |args| names no open writer.
+  cyrene_music::CyreneCacheWriter* FindWriter(FlValue* args,
+                                              int64_t* id,
+                                              FlMethodResponse** error);
+
+  FlMethodChannel* method_channel_;
+
+  std::unordered_map<int64_t, std::unique_ptr<cyrene_music::CyreneCacheWriter>>
+      writers_;
+  int64_t next_writer_id_ = 1;
+};
+
+#endif  // RUNNER_CACHE_STREAM_PLUGIN_H_
@@ -0,0 +1,112 @@
+#include "cover_art_plugin.h"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fl_method_args.h"
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/cover_art";
+
+}  // namespace
+
+// static
+void CoverArtPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new CoverArtPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "cover_art_plugin",
+      plugin, [](gpointer data) { delete static_cast<CoverArtPlugin*>(data); });
+}
+
+CoverArtPlugin::CoverArtPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+
+  // Covers are decoded in arrival order as soon as they come in; the
+  // worker exists to keep decoding off the GTK thread, not to rate-limit.
+  cyrene_music::CoverArtCache::Shared().Configure(&decoder_, options_);
+  worker_ = std::make_unique<
+      cyrene_music::CoalescingWorker<cyrene_music::CoverArtJobs>>(
+      std::chrono::milliseconds(0),
+      [this](cyrene_music::CoverArtJobs& jobs) { Apply(jobs); });
+}
+
+CoverArtPlugin::~CoverArtPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  worker_.reset();
+  // Detach the decoder before it goes away with the plugin.
+  cyrene_music::CoverArtCache::Shared().Configure(
+      nullptr, cyrene_music::CoverArtCacheOptions());
+  g_object_unref(method_channel_);
+}
+
+// static
+void CoverArtPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                        FlMethodCall* method_call,
+                                        gpointer user_data) {
+  auto* plugin = static_cast<CoverArtPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* CoverArtPlugin::HandleMethodCall(FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "configure") == 0) {
+    std::string directory;
+    if (!GetStringArg(args, "directory", &directory)) {
+      return InvalidArgument("Missing 'directory' argument");
+    }
+    cyrene_music::CoverArtJobs jobs;
+    jobs.disk_directory = std::move(directory);
+    worker_->Post(std::move(jobs));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "contains") == 0) {
+    std::string url;
+    if (!GetStringArg(args, "url", &url)) {
+      return InvalidArgument("Missing 'url' argument");
+    }
+    // A disk hit also warms the memory cache for the consumers.
+    return SuccessResponse(fl_value_new_bool(
+        cyrene_music::CoverArtCache::Shared().Find(url) != nullptr));
+
+  } else if (strcmp(method, "put") == 0) {
+    cyrene_music::CoverArtJobs::Cover cover;
+    if (!GetStringArg(args, "url", &cover.key)) {
+      return InvalidArgument("Missing 'url' argument");
+    }
+    if (!GetBytesArg(args, "bytes", &cover.data)) {
+      return InvalidArgument("Invalid 'bytes' argument");
+    }
+    cyrene_music::CoverArtJobs jobs;
+    jobs.covers.push_back(std::move(cover));
+    worker_->Post(std::move(jobs));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+void CoverArtPlugin::Apply(cyrene_music::CoverArtJobs& jobs) {
+  cyrene_music::CoverArtCache& cache = cyrene_music::CoverArtCache::Shared();
+  if (jobs.disk_directory) {
+    options_.disk_directory = std::move(*jobs.disk_directory);
+    cache.Configure(&decoder_, options_);
+  }
+  for (const cyrene_music::CoverArtJobs::Cover& cover : jobs.covers) {
+    cache.Put(cover.key, cover.data.data(), cover.data.size());
+  }
+}
@@ -0,0 +1,44 @@
+#ifndef RUNNER_COVER_ART_PLUGIN_H_
+#define RUNNER_COVER_ART_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <memory>
+
+#include "channel/coalescing_worker.h"
+#include "cover/cover_art_cache.h"
+#include "pixbuf_image_decoder.h"
+
+// Feeds the process-wide CoverArtCache, serving the same "cover_art" method
+// set as the Windows runner. Dart downloads a cover once and hands over the
+// bytes; a worker thread decodes them so the media controls read
+// ready-made bitmaps.
+class CoverArtPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit CoverArtPlugin(FlMethodChannel* channel);
+  ~CoverArtPlugin();
+
+  CoverArtPlugin(const CoverArtPlugin&) = delete;
+  CoverArtPlugin& operator=(const CoverArtPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // Worker thread only.
+  void Apply(cyrene_music::CoverArtJobs& jobs);
+
+  FlMethodChannel* method_channel_;
+  PixbufImageDecoder decoder_;
+  cyrene_music::CoverArtCacheOptions options_;
+
+  // Last, so it stops before the decoder goes away.
+  std::unique_ptr<cyrene_music::CoalescingWorker<cyrene_music::CoverArtJobs>>
+      worker_;
+};
+
+#endif  // RUNNER_COVER_ART_PLUGIN_H_
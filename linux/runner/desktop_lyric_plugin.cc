@@ -0,0 +1,323 @@
+#include "desktop_lyric_plugin.h"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fl_method_args.h"
+
+namespace {
+
+const char kChannelName[] = "desktop_lyric";
+
+FlValue* HistogramToFlValue(const cyrene_music::DurationHistogram& histogram) {
+  using cyrene_music::DurationHistogram;
+  FlValue* buckets = fl_value_new_list();
+  FlValue* bounds = fl_value_new_list();
+  for (int i = 0; i < DurationHistogram::kBucketCount; ++i) {
+    fl_value_append_take(
+        buckets, fl_value_new_int(static_cast<int64_t>(histogram.buckets()[i])));
+    fl_value_append_take(
+        bounds, fl_value_new_int(DurationHistogram::BucketUpperBoundUs(i)));
+  }
+
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "count",
+                           fl_value_new_int(static_cast<int64_t>(histogram.count())));
+  fl_value_set_string_take(map, "meanUs", fl_value_new_float(histogram.mean_us()));
+  fl_value_set_string_take(map, "maxUs", fl_value_new_int(histogram.max_us()));
+  fl_value_set_string_take(map, "p50Us",
+                           fl_value_new_int(histogram.PercentileUs(50.0)));
+  fl_value_set_string_take(map, "p95Us",
+                           fl_value_new_int(histogram.PercentileUs(95.0)));
+  fl_value_set_string_take(map, "p99Us",
+                           fl_value_new_int(histogram.PercentileUs(99.0)));
+  fl_value_set_string_take(map, "buckets", buckets);
+  fl_value_set_string_take(map, "bucketUpperBoundsUs", bounds);
+  return map;
+}
+
+FlValue* RenderStatsToFlValue(const cyrene_music::RenderStats& stats) {
+  using Phase = cyrene_music::RenderStats::Phase;
+  FlValue* map = fl_value_new_map();
+  fl_value_set_string_take(map, "frames",
+                           fl_value_new_int(static_cast<int64_t>(stats.frames())));
+  fl_value_set_string_take(
+      map, "skippedFrames",
+      fl_value_new_int(static_cast<int64_t>(stats.skipped_frames())));
+  fl_value_set_string_take(
+      map, "cacheHits", fl_value_new_int(static_cast<int64_t>(stats.cache_hits())));
+  fl_value_set_string_take(
+      map, "cacheMisses",
+      fl_value_new_int(static_cast<int64_t>(stats.cache_misses())));
+  fl_value_set_string_take(map, "lines",
+                           fl_value_new_int(static_cast<int64_t>(stats.lines())));
+  fl_value_set_string_take(map, "meanFramesPerLine",
+                           fl_value_new_float(stats.mean_frames_per_line()));
+  fl_value_set_string_take(
+      map, "maxFramesPerLine",
+      fl_value_new_int(static_cast<int64_t>(stats.max_frames_per_line())));
+  fl_value_set_string_take(map, "layout",
+                           HistogramToFlValue(stats.phase(Phase::kLayout)));
+  fl_value_set_string_take(map, "rasterise",
+                           HistogramToFlValue(stats.phase(Phase::kRasterise)));
+  fl_value_set_string_take(map, "present",
+                           HistogramToFlValue(stats.phase(Phase::kPresent)));
+  fl_value_set_string_take(map, "frame", HistogramToFlValue(stats.frame_total()));
+  return map;
+}
+
+}  // namespace
+
+// static
+void DesktopLyricPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  // The plugin lives as long as the Flutter view, so the overlay is torn
+  // down while GTK is still running.
+  auto* plugin = new DesktopLyricPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "desktop_lyric_plugin",
+      plugin, [](gpointer data) { delete static_cast<DesktopLyricPlugin*>(data); });
+}
+
+DesktopLyricPlugin::DesktopLyricPlugin(FlMethodChannel* channel)
+    : lyric_window_(std::make_unique<DesktopLyricWindow>()),
+      method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+
+  // Set playback control callback
+  lyric_window_->SetPlaybackControlCallback(
+      [this](const std::string& action) { this->OnPlaybackControl(action); });
+}
+
+DesktopLyricPlugin::~DesktopLyricPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  lyric_window_.reset();
+  g_object_unref(method_channel_);
+}
+
+// static
+void DesktopLyricPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                            FlMethodCall* method_call,
+                                            gpointer user_data) {
+  auto* plugin = static_cast<DesktopLyricPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* DesktopLyricPlugin::HandleMethodCall(FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "create") == 0) {
+    // Create desktop lyric window
+    return SuccessResponse(fl_value_new_bool(lyric_window_->Create()));
+
+  } else if (strcmp(method, "destroy") == 0) {
+    lyric_window_->Destroy();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "show") == 0) {
+    lyric_window_->Show();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "hide") == 0) {
+    lyric_window_->Hide();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "isVisible") == 0) {
+    return SuccessResponse(fl_value_new_bool(lyric_window_->IsVisible()));
+
+  } else if (strcmp(method, "setLyricText") == 0) {
+    std::string text;
+    if (!GetStringArg(args, "text", &text)) {
+      return InvalidArgument("Missing 'text' argument");
+    }
+    lyric_window_->SetLyricText(std::move(text));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setLyricSheet") == 0) {
+    // Whole sheet once per track; lines are then shown by index
+    std::vector<std::string> lyrics, translations;
+    std::vector<int64_t> start_times;
+    if (!GetStringListArg(args, "lyrics", &lyrics)) {
+      return InvalidArgument("Missing 'lyrics' argument");
+    }
+    GetStringListArg(args, "translations", &translations);
+    GetIntListArg(args, "startTimes", &start_times);
+    lyric_window_->SetLyricSheet(std::move(lyrics), std::move(translations),
+                                 start_times);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "showLyricLine") == 0) {
+    int64_t index = -1;
+    if (!GetIntArg(args, "index", &index)) {
+      return InvalidArgument("Missing 'index' argument");
+    }
+    return SuccessResponse(fl_value_new_bool(
+        index >= 0 && lyric_window_->ShowLyricLine(static_cast<size_t>(index))));
+
+  } else if (strcmp(method, "setPosition") == 0) {
+    int64_t x = 0;
+    int64_t y = 0;
+    if (!GetIntArg(args, "x", &x) || !GetIntArg(args, "y", &y)) {
+      return InvalidArgument("Missing 'x' or 'y' argument");
+    }
+    lyric_window_->SetPosition(static_cast<int>(x), static_cast<int>(y));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "getPosition") == 0) {
+    int x = 0;
+    int y = 0;
+    lyric_window_->GetPosition(&x, &y);
+    FlValue* position = fl_value_new_map();
+    fl_value_set_string_take(position, "x", fl_value_new_int(x));
+    fl_value_set_string_take(position, "y", fl_value_new_int(y));
+    return SuccessResponse(position);
+
+  } else if (strcmp(method, "setFontSize") == 0) {
+    int64_t size = 0;
+    if (!GetIntArg(args, "size", &size)) {
+      return InvalidArgument("Missing 'size' argument");
+    }
+    lyric_window_->SetFontSize(static_cast<int>(size));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setLyricDuration") == 0) {
+    int64_t duration = 0;
+    if (!GetIntArg(args, "duration", &duration)) {
+      return InvalidArgument("Missing 'duration' argument");
+    }
+    lyric_window_->SetLyricDuration(static_cast<uint32_t>(duration));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setTextColor") == 0) {
+    int64_t color = 0;
+    if (!GetIntArg(args, "color", &color)) {
+      return InvalidArgument("Missing 'color' argument");
+    }
+    lyric_window_->SetTextColor(static_cast<uint32_t>(color));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setStrokeColor") == 0) {
+    int64_t color = 0;
+    if (!GetIntArg(args, "color", &color)) {
+      return InvalidArgument("Missing 'color' argument");
+    }
+    lyric_window_->SetStrokeColor(static_cast<uint32_t>(color));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setStrokeWidth") == 0) {
+    int64_t width = 0;
+    if (!GetIntArg(args, "width", &width)) {
+      return InvalidArgument("Missing 'width' argument");
+    }
+    lyric_window_->SetStrokeWidth(static_cast<int>(width));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setDraggable") == 0) {
+    bool draggable = false;
+    if (!GetBoolArg(args, "draggable", &draggable)) {
+      return InvalidArgument("Missing 'draggable' argument");
+    }
+    lyric_window_->SetDraggable(draggable);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setMouseTransparent") == 0) {
+    bool transparent = false;
+    if (!GetBoolArg(args, "transparent", &transparent)) {
+      return InvalidArgument("Missing 'transparent' argument");
+    }
+    lyric_window_->SetMouseTransparent(transparent);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setSongInfo") == 0) {
+    if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+      return InvalidArgument("Missing song info arguments");
+    }
+    std::string title, artist, album_cover;
+    GetStringArg(args, "title", &title);
+    GetStringArg(args, "artist", &artist);
+    GetStringArg(args, "albumCover", &album_cover);
+    lyric_window_->SetSongInfo(std::move(title), std::move(artist),
+                               std::move(album_cover));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setPlayingState") == 0) {
+    bool is_playing = false;
+    if (!GetBoolArg(args, "isPlaying", &is_playing)) {
+      return InvalidArgument("Missing 'isPlaying' argument");
+    }
+    lyric_window_->SetPlayingState(is_playing);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setTranslationText") == 0) {
+    std::string text;
+    if (!GetStringArg(args, "text", &text)) {
+      return InvalidArgument("Missing 'text' argument");
+    }
+    lyric_window_->SetTranslationText(std::move(text));
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "setShowTranslation") == 0) {
+    bool show = false;
+    if (!GetBoolArg(args, "show", &show)) {
+      return InvalidArgument("Missing 'show' argument");
+    }
+    lyric_window_->SetShowTranslation(show);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "getShowTranslation") == 0) {
+    return SuccessResponse(fl_value_new_bool(lyric_window_->GetShowTranslation()));
+
+  } else if (strcmp(method, "setVertical") == 0) {
+    bool vertical = false;
+    if (!GetBoolArg(args, "vertical", &vertical)) {
+      return InvalidArgument("Missing 'vertical' argument");
+    }
+    lyric_window_->SetVertical(vertical);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "getVertical") == 0) {
+    return SuccessResponse(fl_value_new_bool(lyric_window_->GetVertical()));
+
+  } else if (strcmp(method, "setShowSpectrum") == 0) {
+    bool show = false;
+    if (!GetBoolArg(args, "show", &show)) {
+      return InvalidArgument("Missing 'show' argument");
+    }
+    lyric_window_->SetShowSpectrum(show);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "getShowSpectrum") == 0) {
+    return SuccessResponse(fl_value_new_bool(lyric_window_->GetShowSpectrum()));
+
+  } else if (strcmp(method, "getRenderStats") == 0) {
+    // Get render timing statistics, optionally resetting them afterwards
+    FlMethodResponse* response =
+        SuccessResponse(RenderStatsToFlValue(lyric_window_->GetRenderStats()));
+    bool reset = false;
+    if (GetBoolArg(args, "reset", &reset) && reset) {
+      lyric_window_->ResetRenderStats();
+    }
+    return response;
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+void DesktopLyricPlugin::OnPlaybackControl(const std::string& action) {
+  // Invoke method on Flutter side
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "action", fl_value_new_string(action.c_str()));
+  fl_method_channel_invoke_method(method_channel_, "onPlaybackControl", args,
+                                  nullptr, nullptr, nullptr);
+}
@@ -0,0 +1,37 @@
+#ifndef RUNNER_DESKTOP_LYRIC_PLUGIN_H_
+#define RUNNER_DESKTOP_LYRIC_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <memory>
+#include <string>
+
+#include "desktop_lyric_window.h"
+
+// Desktop lyric plugin for Flutter, serving the same "desktop_lyric" method
+// set as the Windows runner.
+class DesktopLyricPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit DesktopLyricPlugin(FlMethodChannel* channel);
+  ~DesktopLyricPlugin();
+
+  DesktopLyricPlugin(const DesktopLyricPlugin&) = delete;
+  DesktopLyricPlugin& operator=(const DesktopLyricPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  // Handle method calls from Dart
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // Playback control callback
+  void OnPlaybackControl(const std::string& action);
+
+  std::unique_ptr<DesktopLyricWindow> lyric_window_;
+  FlMethodChannel* method_channel_;
+};
+
+#endif  // RUNNER_DESKTOP_LYRIC_PLUGIN_H_
@@ -0,0 +1,424 @@
+#include "desktop_lyric_window.h"
+
+#include <utility>
+
+#include "lyric/lyric_layout.h"
+#include "pango_text_rasterizer.h"
+
+namespace {
+
+const int kScrollFrameIntervalMs = 30;  // ~33fps refresh for smooth scrolling
+const int kBottomMargin = 100;  // default distance from the bottom of the work area
+
+using cyrene_music::ArgbSurface;
+using cyrene_music::LyricStyle;
+using cyrene_music::RenderStats;
+namespace lyric_layout = cyrene_music::lyric_layout;
+
+uint64_t NowMs() {
+  return static_cast<uint64_t>(g_get_monotonic_time() / 1000);
+}
+
+}  // namespace
+
+DesktopLyricWindow::DesktopLyricWindow()
+    : window_(nullptr),
+      rasterizer_(std::make_unique<cyrene_music::PangoTextRasterizer>()),
+      glyph_atlas_(std::make_unique<cyrene_music::GlyphAtlasRasterizer>(
+          rasterizer_.get())),
+      renderer_(std::make_unique<cyrene_music::LyricRenderer>(glyph_atlas_.get())),
+      frame_surface_(nullptr),
+      is_draggable_(true),
+      is_mouse_transparent_(false),
+      is_dragging_(false),
+      drag_offset_x_(0.0),
+      drag_offset_y_(0.0),
+      is_playing_(false),
+      scroll_timer_id_(0),
+      playback_callback_(nullptr) {
+  renderer_->SetPlaybackClock(&cyrene_music::PlaybackClock::Shared());
+}
+
+DesktopLyricWindow::~DesktopLyricWindow() {
+  if (renderer_->show_spectrum()) {
+    cyrene_music::SpectrumSlot::Shared().RemoveReader();
+  }
+  Destroy();
+  if (frame_surface_ != nullptr) {
+    cairo_surface_destroy(frame_surface_);
+    frame_surface_ = nullptr;
+  }
+}
+
+bool DesktopLyricWindow::Create() {
+  if (window_ != nullptr) {
+    return true;  // Window already exists
+  }
+
+  // A popup is override-redirect on X11: no decorations, no focus, and the
+  // window manager does not place or stack it.
+  window_ = gtk_window_new(GTK_WINDOW_POPUP);
+  GtkWindow* window = GTK_WINDOW(window_);
+  gtk_window_set_title(window, "Desktop Lyric");
+  gtk_window_set_keep_above(window, TRUE);
+  gtk_window_set_skip_taskbar_hint(window, TRUE);
+  gtk_window_set_skip_pager_hint(window, TRUE);
+  gtk_window_set_accept_focus(window, FALSE);
+  gtk_widget_set_app_paintable(window_, TRUE);
+
+  // Per-pixel alpha needs an ARGB visual (i.e. a running compositor).
+  GdkScreen* screen = gtk_widget_get_screen(window_);
+  GdkVisual* visual = gdk_screen_get_rgba_visual(screen);
+  if (visual != nullptr) {
+    gtk_widget_set_visual(window_, visual);
+  } else {
+    g_warning("[DesktopLyric] No RGBA visual; the overlay will not be transparent");
+  }
+
+  gtk_widget_add_events(window_, GDK_BUTTON_PRESS_MASK | GDK_BUTTON_RELEASE_MASK |
+                                     GDK_POINTER_MOTION_MASK);
+  g_signal_connect(window_, "draw", G_CALLBACK(OnDraw), this);
+  g_signal_connect(window_, "button-press-event", G_CALLBACK(OnButtonPress), this);
+  g_signal_connect(window_, "button-release-event", G_CALLBACK(OnButtonRelease), this);
+  g_signal_connect(window_, "motion-notify-event", G_CALLBACK(OnMotionNotify), this);
+
+  ResizeToFrame();
+  const lyric_layout::WindowSize size = renderer_->FrameSize();
+  gtk_window_resize(window, size.width, size.height);
+
+  // Default position: center bottom of the primary monitor's work area
+  GdkDisplay* display = gtk_widget_get_display(window_);
+  GdkMonitor* monitor = gdk_display_get_primary_monitor(display);
+  if (monitor == nullptr) {
+    monitor = gdk_display_get_monitor(display, 0);
+  }
+  if (monitor != nullptr) {
+    GdkRectangle area;
+    gdk_monitor_get_workarea(monitor, &area);
+    gtk_window_move(window, area.x + (area.width - size.width) / 2,
+                    area.y + area.height - size.height - kBottomMargin);
+  }
+
+  gtk_widget_realize(window_);
+  ApplyInputShape();
+  return true;
+}
+
+void DesktopLyricWindow::Destroy() {
+  StopScrollTimer();
+  if (window_ != nullptr) {
+    gtk_widget_destroy(window_);
+    window_ = nullptr;
+  }
+  is_dragging_ = false;
+}
+
+void DesktopLyricWindow::Show() {
+  if (window_ != nullptr) {
+    UpdateWindow();
+    gtk_widget_show(window_);
+  }
+}
+
+void DesktopLyricWindow::Hide() {
+  if (window_ != nullptr) {
+    StopScrollTimer();
+    gtk_widget_hide(window_);
+  }
+}
+
+bool DesktopLyricWindow::IsVisible() const {
+  return window_ != nullptr && gtk_widget_get_visible(window_);
+}
+
+void DesktopLyricWindow::SetLyricText(std::string text) {
+  if (renderer_->SetLyric(std::move(text), NowMs())) {
+    render_stats_.BeginLine();
+  }
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetTranslationText(std::string text) {
+  renderer_->SetTranslation(std::move(text), NowMs());
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetLyricSheet(std::vector<std::string> lyrics,
+                                       std::vector<std::string> translations,
+                                       const std::vector<int64_t>& start_times_ms) {
+  lyric_sheet_.Load(std::move(lyrics), std::move(translations), start_times_ms);
+}
+
+bool DesktopLyricWindow::ShowLyricLine(size_t index) {
+  cyrene_music::LyricSheet::Line line;
+  if (!lyric_sheet_.GetLine(index, &line)) return false;
+  // Translation first so both rows land in a single redraw
+  renderer_->SetTranslation(*line.translation, NowMs());
+  SetLyricDuration(line.duration_ms);
+  SetLyricText(*line.text);
+  return true;
+}
+
+void DesktopLyricWindow::SetLyricDuration(uint32_t duration_ms) {
+  renderer_->SetLineDuration(duration_ms);
+}
+
+void DesktopLyricWindow::SetPosition(int x, int y) {
+  if (window_ != nullptr) {
+    gtk_window_move(GTK_WINDOW(window_), x, y);
+  }
+}
+
+void DesktopLyricWindow::GetPosition(int* x, int* y) {
+  if (window_ != nullptr) {
+    gtk_window_get_position(GTK_WINDOW(window_), x, y);
+  }
+}
+
+void DesktopLyricWindow::SetFontSize(int size) {
+  LyricStyle style = renderer_->style();
+  style.font_size = size;
+  renderer_->SetStyle(style);
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetTextColor(uint32_t color) {
+  LyricStyle style = renderer_->style();
+  style.text_color = color;
+  renderer_->SetStyle(style);
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetStrokeColor(uint32_t color) {
+  LyricStyle style = renderer_->style();
+  style.stroke_color = color;
+  renderer_->SetStyle(style);
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetStrokeWidth(int width) {
+  LyricStyle style = renderer_->style();
+  style.stroke_width = width;
+  renderer_->SetStyle(style);
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetDraggable(bool draggable) {
+  is_draggable_ = draggable;
+  if (!draggable) {
+    is_dragging_ = false;
+  }
+}
+
+void DesktopLyricWindow::SetMouseTransparent(bool transparent) {
+  is_mouse_transparent_ = transparent;
+  ApplyInputShape();
+}
+
+void DesktopLyricWindow::SetSongInfo(std::string title, std::string artist,
+                                     std::string album_cover) {
+  song_title_ = std::move(title);
+  song_artist_ = std::move(artist);
+  album_cover_url_ = std::move(album_cover);
+}
+
+void DesktopLyricWindow::SetPlayingState(bool is_playing) {
+  is_playing_ = is_playing;
+  // The renderer holds the marquee while the playback clock says paused;
+  // redraw so the scroll timer restarts on resume.
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetShowTranslation(bool show) {
+  renderer_->SetShowTranslation(show);
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetVertical(bool vertical) {
+  if (renderer_->vertical() == vertical) return;
+  renderer_->SetVertical(vertical);
+  if (IsVisible()) {
+    UpdateWindow();  // resizes to the swapped dimensions
+  }
+}
+
+void DesktopLyricWindow::SetShowSpectrum(bool show) {
+  if (renderer_->show_spectrum() == show) return;
+  // Nothing publishes into the slot on Linux yet, so the strip stays empty
+  // until an audio analyser does.
+  auto& slot = cyrene_music::SpectrumSlot::Shared();
+  if (show) {
+    slot.AddReader();
+    renderer_->SetSpectrumSource(&slot);
+  } else {
+    renderer_->SetSpectrumSource(nullptr);
+    slot.RemoveReader();
+  }
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
+void DesktopLyricWindow::SetPlaybackControlCallback(
+    PlaybackControlCallback callback) {
+  playback_callback_ = callback;
+}
+
+void DesktopLyricWindow::ResizeToFrame() {
+  const lyric_layout::WindowSize size = renderer_->FrameSize();
+  if (frame_surface_ != nullptr && frame_.width() == size.width &&
+      frame_.height() == size.height) {
+    return;
+  }
+
+  if (frame_surface_ != nullptr) {
+    cairo_surface_destroy(frame_surface_);
+  }
+  frame_ = ArgbSurface(size.width, size.height);
+  frame_surface_ = cairo_image_surface_create_for_data(
+      reinterpret_cast<unsigned char*>(frame_.data()), CAIRO_FORMAT_ARGB32,
+      frame_.width(), frame_.height(), frame_.stride_bytes());
+  if (window_ != nullptr) {
+    gtk_window_resize(GTK_WINDOW(window_), size.width, size.height);
+  }
+}
+
+void DesktopLyricWindow::UpdateWindow(int expected_interval_ms) {
+  if (window_ == nullptr) return;
+
+  render_stats_.BeginFrame(expected_interval_ms);
+
+  ResizeToFrame();
+  const bool animating = renderer_->RenderFrame(NowMs(), &frame_, &render_stats_);
+  cairo_surface_mark_dirty(frame_surface_);
+  gtk_widget_queue_draw(window_);
+
+  render_stats_.EndFrame();
+
+  // If scrolling is in progress, keep a timer running to refresh
+  if (animating) {
+    if (scroll_timer_id_ == 0) {
+      scroll_timer_id_ = g_timeout_add(kScrollFrameIntervalMs, OnScrollTimer, this);
+      // The marquee is the only steady frame source; the main thread gets
+      // the render role only while it runs.
+      render_role_ = std::make_unique<cyrene_music::ScopedThreadRole>(
+          cyrene_music::ThreadRole::kRender);
+    }
+  } else {
+    StopScrollTimer();
+  }
+}
+
+void DesktopLyricWindow::ApplyInputShape() {
+  if (window_ == nullptr) return;
+  if (is_mouse_transparent_) {
+    // An empty input region lets every pointer event reach the windows below
+    cairo_region_t* empty = cairo_region_create();
+    gtk_widget_input_shape_combine_region(window_, empty);
+    cairo_region_destroy(empty);
+    is_dragging_ = false;
+  } else {
+    gtk_widget_input_shape_combine_region(window_, nullptr);
+  }
+}
+
+void DesktopLyricWindow::StopScrollTimer() {
+  if (scroll_timer_id_ != 0) {
+    g_source_remove(scroll_timer_id_);
+    scroll_timer_id_ = 0;
+  }
+  render_role_.reset();
+}
+
+// static
+gboolean DesktopLyricWindow::OnDraw(GtkWidget* widget, cairo_t* cr,
+                                    gpointer user_data) {
+  auto* self = static_cast<DesktopLyricWindow*>(user_data);
+  // GTK paints after UpdateWindow has returned, so present time is folded
+  // into whichever frame is recorded next.
+  RenderStats::ScopedPhase phase(&self->render_stats_, RenderStats::Phase::kPresent);
+
+  // Replace, don't blend: the frame already carries its own alpha
+  cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+  if (self->frame_surface_ != nullptr) {
+    cairo_set_source_surface(cr, self->frame_surface_, 0, 0);
+  } else {
+    cairo_set_source_rgba(cr, 0, 0, 0, 0);
+  }
+  cairo_paint(cr);
+  return TRUE;
+}
+
+// static
+gboolean DesktopLyricWindow::OnButtonPress(GtkWidget* widget,
+                                           GdkEventButton* event,
+                                           gpointer user_data) {
+  auto* self = static_cast<DesktopLyricWindow*>(user_data);
+  if (event->button != GDK_BUTTON_PRIMARY) return FALSE;
+
+  if (event->type == GDK_2BUTTON_PRESS) {
+    // Double-click toggles vertical mode, as on Windows
+    self->is_dragging_ = false;
+    if (self->playback_callback_) {
+      self->playback_callback_("toggle_vertical");
+    }
+    return TRUE;
+  }
+
+  if (event->type == GDK_BUTTON_PRESS && self->is_draggable_) {
+    self->is_dragging_ = true;
+    self->drag_offset_x_ = event->x;
+    self->drag_offset_y_ = event->y;
+  }
+  return TRUE;
+}
+
+// static
+gboolean DesktopLyricWindow::OnButtonRelease(GtkWidget* widget,
+                                             GdkEventButton* event,
+                                             gpointer user_data) {
+  auto* self = static_cast<DesktopLyricWindow*>(user_data);
+  if (event->button == GDK_BUTTON_PRIMARY) {
+    self->is_dragging_ = false;
+  }
+  return TRUE;
+}
+
+// static
+gboolean DesktopLyricWindow::OnMotionNotify(GtkWidget* widget,
+                                            GdkEventMotion* event,
+                                            gpointer user_data) {
+  auto* self = static_cast<DesktopLyricWindow*>(user_data);
+  if (!self->is_dragging_) return FALSE;
+
+  // Override-redirect windows are not moved by the window manager, so the
+  // drag is done by hand from root coordinates.
+  gtk_window_move(GTK_WINDOW(widget),
+                  static_cast<int>(event->x_root - self->drag_offset_x_),
+                  static_cast<int>(event->y_root - self->drag_offset_y_));
+  return TRUE;
+}
+
+// static
+gboolean DesktopLyricWindow::OnScrollTimer(gpointer user_data) {
+  auto* self = static_cast<DesktopLyricWindow*>(user_data);
+  // UpdateWindow clears scroll_timer_id_ once the marquee settles
+  self->UpdateWindow(kScrollFrameIntervalMs);
+  return self->scroll_timer_id_ != 0 ? G_SOURCE_CONTINUE : G_SOURCE_REMOVE;
+}
@@ -0,0 +1,144 @@
+#ifndef RUNNER_DESKTOP_LYRIC_WINDOW_H_
+#define RUNNER_DESKTOP_LYRIC_WINDOW_H_
+
+#include <gtk/gtk.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "lyric/argb_surface.h"
+#include "lyric/glyph_atlas.h"
+#include "lyric/lyric_renderer.h"
+#include "lyric/lyric_sheet.h"
+#include "lyric/render_stats.h"
+#include "lyric/text_rasterizer.h"
+#include "thread/thread_role.h"
+
+// Desktop lyric overlay for Linux: an override-redirect, always-on-top,
+// per-pixel-alpha GTK popup. Frames come from the shared LyricRenderer, so
+// scrolling only re-composites cached line bitmaps. When mouse transparent
+// the window has an empty input shape and every click falls through.
+class DesktopLyricWindow {
+ public:
+  DesktopLyricWindow();
+  ~DesktopLyricWindow();
+
+  DesktopLyricWindow(const DesktopLyricWindow&) = delete;
+  DesktopLyricWindow& operator=(const DesktopLyricWindow&) = delete;
+
+  // Create desktop lyric window
+  bool Create();
+
+  // Destroy window
+  void Destroy();
+
+  // Show/Hide window
+  void Show();
+  void Hide();
+  bool IsVisible() const;
+
+  // Lyric and translation text (UTF-8, moved into the renderer)
+  void SetLyricText(std::string text);
+  void SetTranslationText(std::string text);
+
+  // Upload the whole lyric sheet once per track, then switch lines by index
+  void SetLyricSheet(std::vector<std::string> lyrics,
+                     std::vector<std::string> translations,
+                     const std::vector<int64_t>& start_times_ms);
+  bool ShowLyricLine(size_t index);
+
+  // Set lyric duration (for calculating scroll speed)
+  void SetLyricDuration(uint32_t duration_ms);
+
+  // Window position in root window coordinates
+  void SetPosition(int x, int y);
+  void GetPosition(int* x, int* y);
+
+  // Style (colours are ARGB)
+  void SetFontSize(int size);
+  void SetTextColor(uint32_t color);
+  void SetStrokeColor(uint32_t color);
+  void SetStrokeWidth(int width);
+
+  void SetDraggable(bool draggable);
+  void SetMouseTransparent(bool transparent);
+
+  // Song info and playing state. The overlay has no control panel; the
+  // playing state only restarts the marquee on resume.
+  void SetSongInfo(std::string title, std::string artist,
+                   std::string album_cover);
+  void SetPlayingState(bool is_playing);
+
+  void SetShowTranslation(bool show);
+  bool GetShowTranslation() const { return renderer_->show_translation(); }
+
+  void SetVertical(bool vertical);
+  bool GetVertical() const { return renderer_->vertical(); }
+
+  // Spectrum strip behind the lyric, read in-process from SpectrumSlot
+  void SetShowSpectrum(bool show);
+  bool GetShowSpectrum() const { return renderer_->show_spectrum(); }
+
+  // Set playback control callback
+  using PlaybackControlCallback = std::function<void(const std::string& action)>;
+  void SetPlaybackControlCallback(PlaybackControlCallback callback);
+
+  // Render timing statistics
+  const cyrene_music::RenderStats& GetRenderStats() const { return render_stats_; }
+  void ResetRenderStats() { render_stats_.Reset(); }
+
+ private:
+  static gboolean OnDraw(GtkWidget* widget, cairo_t* cr, gpointer user_data);
+  static gboolean OnButtonPress(GtkWidget* widget, GdkEventButton* event,
+                                gpointer user_data);
+  static gboolean OnButtonRelease(GtkWidget* widget, GdkEventButton* event,
+                                  gpointer user_data);
+  static gboolean OnMotionNotify(GtkWidget* widget, GdkEventMotion* event,
+                                 gpointer user_data);
+  static gboolean OnScrollTimer(gpointer user_data);
+
+  // Re-renders the frame and queues a redraw. |expected_interval_ms| is the
+  // refresh interval of the timer driving this frame, or 0 for on-demand
+  // redraws.
+  void UpdateWindow(int expected_interval_ms = 0);
+
+  // Resizes the backing surface and window to the renderer's frame size.
+  void ResizeToFrame();
+
+  void ApplyInputShape();
+  void StopScrollTimer();
+
+  GtkWidget* window_;
+  std::unique_ptr<cyrene_music::TextRasterizer> rasterizer_;
+  // CJK glyphs are drawn once here and new lines composed from them
+  std::unique_ptr<cyrene_music::GlyphAtlasRasterizer> glyph_atlas_;
+  std::unique_ptr<cyrene_music::LyricRenderer> renderer_;
+  cyrene_music::ArgbSurface frame_;
+  cairo_surface_t* frame_surface_;  // wraps frame_'s pixels
+
+  // Lines of the current track; the text shown lives in the renderer
+  cyrene_music::LyricSheet lyric_sheet_;
+
+  bool is_draggable_;
+  bool is_mouse_transparent_;
+  bool is_dragging_;
+  double drag_offset_x_;
+  double drag_offset_y_;
+  bool is_playing_;
+  std::string song_title_;
+  std::string song_artist_;
+  std::string album_cover_url_;
+
+  guint scroll_timer_id_;
+  // Held on the main thread while the scroll timer runs
+  std::unique_ptr<cyrene_music::ScopedThreadRole> render_role_;
+  PlaybackControlCallback playback_callback_;
+
+  // Per-frame timing and counters, queried via getRenderStats
+  cyrene_music::RenderStats render_stats_;
+};
+
+#endif  // RUNNER_DESKTOP_LYRIC_WINDOW_H_
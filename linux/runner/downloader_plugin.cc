@@ -0,0 +1,145 @@
+#include "downloader_plugin.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <utility>
+
+#include "fl_method_args.h"
+
+using cyrene_music::DownloadEvent;
+using cyrene_music::DownloadOptions;
+using cyrene_music::SegmentedDownloader;
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/downloader";
+
+// Connections one download may open; a larger request is cut down to it.
+constexpr int64_t kMaxConnections = 16;
+
+// The plugin a queued wake-up is for. Only touched on the GTK thread, so a
+// wake-up that runs after the plugin is gone finds nullptr.
+DownloaderPlugin* g_downloader_plugin = nullptr;
+
+FlValue* Int64(uint64_t n) { return fl_value_new_int(static_cast<int64_t>(n)); }
+
+FlValue* EventValue(const DownloadEvent& event) {
+  FlValue* result = fl_value_new_map();
+  fl_value_set_string_take(result, "id", fl_value_new_int(event.id));
+  fl_value_set_string_take(result, "received", Int64(event.received));
+  fl_value_set_string_take(result, "total", Int64(event.total));
+  if (event.done) {
+    fl_value_set_string_take(result, "ok",
+                             fl_value_new_bool(event.error.empty()));
+    fl_value_set_string_take(result, "error",
+                             fl_value_new_string(event.error.c_str()));
+    fl_value_set_string_take(result, "resumed", Int64(event.resumed));
+    fl_value_set_string_take(result, "connections",
+                             fl_value_new_int(event.connections));
+  }
+  return result;
+}
+
+}  // namespace
+
+// static
+void DownloaderPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new DownloaderPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "downloader_plugin",
+      plugin,
+      [](gpointer data) { delete static_cast<DownloaderPlugin*>(data); });
+}
+
+DownloaderPlugin::DownloaderPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+  g_downloader_plugin = this;
+  downloader_.SetNotify(
+      [] { g_main_context_invoke(nullptr, OnWake, nullptr); });
+}
+
+DownloaderPlugin::~DownloaderPlugin() {
+  downloader_.SetNotify(nullptr);
+  g_downloader_plugin = nullptr;
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  g_object_unref(method_channel_);
+}
+
+// static
+void DownloaderPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                          FlMethodCall* method_call,
+                                          gpointer user_data) {
+  auto* plugin = static_cast<DownloaderPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* DownloaderPlugin::HandleMethodCall(
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "start") == 0) {
+    int64_t id = 0;
+    DownloadOptions options;
+    if (!GetIntArg(args, "id", &id) ||
+        !GetStringArg(args, "url", &options.url) ||
+        !GetStringArg(args, "path", &options.path)) {
+      return InvalidArgument("Missing 'id', 'url' or 'path' argument");
+    }
+    int64_t connections = 0;
+    if (GetIntArg(args, "connections", &connections)) {
+      if (connections < 1) {
+        return InvalidArgument("Invalid 'connections' argument");
+      }
+      options.connections =
+          static_cast<size_t>(std::min(connections, kMaxConnections));
+    }
+    return SuccessResponse(
+        fl_value_new_bool(downloader_.Start(id, std::move(options))));
+  }
+
+  if (strcmp(method, "cancel") == 0) {
+    int64_t id = 0;
+    if (!GetIntArg(args, "id", &id)) {
+      return InvalidArgument("Missing 'id' argument");
+    }
+    downloader_.Cancel(id);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  if (strcmp(method, "discard") == 0) {
+    std::string path;
+    if (!GetStringArg(args, "path", &path)) {
+      return InvalidArgument("Missing 'path' argument");
+    }
+    SegmentedDownloader::Discard(path);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+// static
+gboolean DownloaderPlugin::OnWake(gpointer user_data) {
+  if (g_downloader_plugin != nullptr) g_downloader_plugin->DeliverEvents();
+  return G_SOURCE_REMOVE;
+}
+
+void DownloaderPlugin::DeliverEvents() {
+  for (const DownloadEvent& event : downloader_.TakeEvents()) {
+    g_autoptr(FlValue) value = EventValue(event);
+    fl_method_channel_invoke_method(method_channel_,
+                                    event.done ? "onDone" : "onProgress",
+                                    value, nullptr, nullptr, nullptr);
+  }
+}
@@ -0,0 +1,37 @@
+#ifndef RUNNER_DOWNLOADER_PLUGIN_H_
+#define RUNNER_DOWNLOADER_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "net/segmented_downloader.h"
+
+// Downloads songs for DownloadService on a native SegmentedDownloader, with
+// the same "downloader" method set as the Windows runner: "start" begins a
+// download that reports back through "onProgress" calls and one "onDone".
+class DownloaderPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit DownloaderPlugin(FlMethodChannel* channel);
+  ~DownloaderPlugin();
+
+  DownloaderPlugin(const DownloaderPlugin&) = delete;
+  DownloaderPlugin& operator=(const DownloaderPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // GTK thread; download threads schedule it through the main context.
+  static gboolean OnWake(gpointer user_data);
+  void DeliverEvents();
+
+  FlMethodChannel* method_channel_;
+  // Last, so downloads still running are cancelled and joined before the
+  // channel goes away.
+  cyrene_music::SegmentedDownloader downloader_;
+};
+
+#endif  // RUNNER_DOWNLOADER_PLUGIN_H_
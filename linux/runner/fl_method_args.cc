@@ -0,0 +1,96 @@
+#include "fl_method_args.h"
+
+FlValue* LookupArg(FlValue* args, const char* key) {
+  if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  return fl_value_lookup_string(args, key);
+}
+
+bool GetStringArg(FlValue* args, const char* key, std::string* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_STRING) {
+    return false;
+  }
+  *out = fl_value_get_string(value);
+  return true;
+}
+
+bool GetIntArg(FlValue* args, const char* key, int64_t* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_INT) {
+    return false;
+  }
+  *out = fl_value_get_int(value);
+  return true;
+}
+
+bool GetStringListArg(FlValue* args, const char* key,
+                      std::vector<std::string>* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_LIST) {
+    return false;
+  }
+  const size_t length = fl_value_get_length(value);
+  out->clear();
+  out->reserve(length);
+  for (size_t i = 0; i < length; ++i) {
+    FlValue* element = fl_value_get_list_value(value, i);
+    if (fl_value_get_type(element) != FL_VALUE_TYPE_STRING) return false;
+    out->emplace_back(fl_value_get_string(element));
+  }
+  return true;
+}
+
+bool GetIntListArg(FlValue* args, const char* key, std::vector<int64_t>* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr) return false;
+  const FlValueType type = fl_value_get_type(value);
+  if (type != FL_VALUE_TYPE_INT64_LIST && type != FL_VALUE_TYPE_LIST) {
+    return false;
+  }
+  const size_t length = fl_value_get_length(value);
+  if (type == FL_VALUE_TYPE_INT64_LIST) {
+    const int64_t* data = fl_value_get_int64_list(value);
+    out->assign(data, data + length);
+    return true;
+  }
+  out->clear();
+  out->reserve(length);
+  for (size_t i = 0; i < length; ++i) {
+    FlValue* element = fl_value_get_list_value(value, i);
+    if (fl_value_get_type(element) != FL_VALUE_TYPE_INT) return false;
+    out->push_back(fl_value_get_int(element));
+  }
+  return true;
+}
+
+bool GetBoolArg(FlValue* args, const char* key, bool* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr || fl_value_get_type(value) != FL_VALUE_TYPE_BOOL) {
+    return false;
+  }
+  *out = fl_value_get_bool(value);
+  return true;
+}
+
+bool GetBytesArg(FlValue* args, const char* key, std::vector<uint8_t>* out) {
+  FlValue* value = LookupArg(args, key);
+  if (value == nullptr ||
+      fl_value_get_type(value) != FL_VALUE_TYPE_UINT8_LIST) {
+    return false;
+  }
+  const uint8_t* data = fl_value_get_uint8_list(value);
+  out->assign(data, data + fl_value_get_length(value));
+  return true;
+}
+
+FlMethodResponse* SuccessResponse(FlValue* value) {
+  g_autoptr(FlValue) owned = value;
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(owned));
+}
+
+FlMethodResponse* InvalidArgument(const char* message) {
+  return FL_METHOD_RESPONSE(
+      fl_method_error_response_new("INVALID_ARGUMENT", message, nullptr));
+}
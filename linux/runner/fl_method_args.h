@@ -0,0 +1,36 @@
+#ifndef RUNNER_FL_METHOD_ARGS_H_
+#define RUNNER_FL_METHOD_ARGS_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Typed reads from a method call's map argument, shared by the runner-local
+// plugins. Each returns false when |args| is not a map, |key| is absent or
+// the value has the wrong type.
+
+// Looks up |key| in a map argument; nullptr if absent or not a map.
+FlValue* LookupArg(FlValue* args, const char* key);
+
+bool GetStringArg(FlValue* args, const char* key, std::string* out);
+bool GetIntArg(FlValue* args, const char* key, int64_t* out);
+bool GetBoolArg(FlValue* args, const char* key, bool* out);
+
+// Reads a list of strings; every element must be a string.
+bool GetStringListArg(FlValue* args, const char* key,
+                      std::vector<std::string>* out);
+
+// Reads a list of integers, sent either as a plain list or an Int64List.
+bool GetIntListArg(FlValue* args, const char* key, std::vector<int64_t>* out);
+
+// Reads a Uint8List.
+bool GetBytesArg(FlValue* args, const char* key, std::vector<uint8_t>* out);
+
+// Wraps |value| (ownership taken) in a success response.
+FlMethodResponse* SuccessResponse(FlValue* value);
+
+FlMethodResponse* InvalidArgument(const char* message);
+
+#endif  // RUNNER_FL_METHOD_ARGS_H_
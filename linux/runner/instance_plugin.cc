@@ -0,0 +1,116 @@
+#include "instance_plugin.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "fl_method_args.h"
+#include "instance/instance_handoff.h"
+
+using cyrene_music::InstanceHandoff;
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/instance";
+
+// The plugin a queued wake-up is for. Only touched on the GTK thread, so a
+// wake-up that runs after the plugin is gone finds nullptr.
+InstancePlugin* g_instance_plugin = nullptr;
+
+// Arguments are file names in whatever encoding the file system uses; the
+// channel wants UTF-8.
+FlValue* ArgumentListValue(const InstanceHandoff::ArgumentList& arguments) {
+  FlValue* list = fl_value_new_list();
+  for (const std::string& argument : arguments) {
+    g_autofree gchar* utf8 =
+        g_utf8_make_valid(argument.data(), static_cast<gssize>(argument.size()));
+    fl_value_append_take(list, fl_value_new_string(utf8));
+  }
+  return list;
+}
+
+}  // namespace
+
+// static
+void InstancePlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  FlView* view = fl_plugin_registrar_get_view(registrar);
+  auto* plugin = new InstancePlugin(channel, view);
+  g_object_set_data_full(
+      G_OBJECT(view), "instance_plugin", plugin,
+      [](gpointer data) { delete static_cast<InstancePlugin*>(data); });
+}
+
+InstancePlugin::InstancePlugin(FlMethodChannel* channel, FlView* view)
+    : method_channel_(channel), view_(view) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+  g_instance_plugin = this;
+  // Lists may already be queued: the handoff listens from main() on.
+  InstanceHandoff::Shared().SetNotify(
+      [] { g_main_context_invoke(nullptr, OnWake, nullptr); });
+}
+
+InstancePlugin::~InstancePlugin() {
+  InstanceHandoff::Shared().SetNotify(nullptr);
+  g_instance_plugin = nullptr;
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  g_object_unref(method_channel_);
+}
+
+// static
+void InstancePlugin::MethodCallCallback(FlMethodChannel* channel,
+                                        FlMethodCall* method_call,
+                                        gpointer user_data) {
+  auto* plugin = static_cast<InstancePlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* InstancePlugin::HandleMethodCall(FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+
+  if (strcmp(method, "ready") == 0) {
+    // Everything queued so far, launch arguments first; later lists come
+    // as "onArguments".
+    dart_ready_ = true;
+    FlValue* lists = fl_value_new_list();
+    for (const auto& arguments : InstanceHandoff::Shared().TakePending()) {
+      fl_value_append_take(lists, ArgumentListValue(arguments));
+    }
+    return SuccessResponse(lists);
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+// static
+gboolean InstancePlugin::OnWake(gpointer user_data) {
+  if (g_instance_plugin != nullptr) {
+    g_instance_plugin->PresentWindow();
+    g_instance_plugin->DeliverPending();
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void InstancePlugin::DeliverPending() {
+  if (!dart_ready_) return;
+  for (const auto& arguments : InstanceHandoff::Shared().TakePending()) {
+    g_autoptr(FlValue) list = ArgumentListValue(arguments);
+    fl_method_channel_invoke_method(method_channel_, "onArguments", list,
+                                    nullptr, nullptr, nullptr);
+  }
+}
+
+void InstancePlugin::PresentWindow() {
+  GtkWidget* toplevel = gtk_widget_get_toplevel(GTK_WIDGET(view_));
+  if (GTK_IS_WINDOW(toplevel)) {
+    // Also shows the window when it was hidden to the tray.
+    gtk_window_present(GTK_WINDOW(toplevel));
+  }
+}
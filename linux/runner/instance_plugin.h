@@ -0,0 +1,39 @@
+#ifndef RUNNER_INSTANCE_PLUGIN_H_
+#define RUNNER_INSTANCE_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+#include <gtk/gtk.h>
+
+// Receives the command lines that later launches hand to this process
+// through InstanceHandoff, with the same "com.cyrene.music/instance" method
+// set as the Windows runner. Each one presents the main window and reaches
+// Dart as an "onArguments" call; lists that arrive before Dart has called
+// "ready" (including this process's own launch arguments) are returned from
+// that call instead.
+class InstancePlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  InstancePlugin(FlMethodChannel* channel, FlView* view);
+  ~InstancePlugin();
+
+  InstancePlugin(const InstancePlugin&) = delete;
+  InstancePlugin& operator=(const InstancePlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // GTK thread; the listener thread schedules it through the main context.
+  static gboolean OnWake(gpointer user_data);
+  void DeliverPending();
+  void PresentWindow();
+
+  FlMethodChannel* method_channel_;
+  FlView* view_;
+  bool dart_ready_ = false;
+};
+
+#endif  // RUNNER_INSTANCE_PLUGIN_H_
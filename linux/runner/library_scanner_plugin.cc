@@ -0,0 +1,164 @@
+#include "library_scanner_plugin.h"
+
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "fl_method_args.h"
+
+using cyrene_music::LibraryScanBatch;
+using cyrene_music::LibraryScanner;
+using cyrene_music::LibraryScanOptions;
+using cyrene_music::LibraryTrack;
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/library_scanner";
+
+// The plugin a queued wake-up is for. Only touched on the GTK thread, so a
+// wake-up that runs after the plugin is gone finds nullptr.
+LibraryScannerPlugin* g_library_scanner_plugin = nullptr;
+
+FlValue* Int64(uint64_t n) { return fl_value_new_int(static_cast<int64_t>(n)); }
+
+// The scanner only hands out UTF-8.
+FlValue* String(const std::string& text) {
+  return fl_value_new_string(text.c_str());
+}
+
+FlValue* BatchValue(const LibraryScanBatch& batch) {
+  FlValue* tracks = fl_value_new_list();
+  for (const LibraryTrack& track : batch.tracks) {
+    FlValue* value = fl_value_new_map();
+    fl_value_set_string_take(value, "path", String(track.path));
+    fl_value_set_string_take(value, "format", fl_value_new_int(track.format));
+    fl_value_set_string_take(value, "title", String(track.title));
+    fl_value_set_string_take(value, "artist", String(track.artist));
+    fl_value_set_string_take(value, "album", String(track.album));
+    fl_value_set_string_take(value, "lyric", String(track.lyric));
+    fl_value_set_string_take(value, "cover", String(track.cover_path));
+    fl_value_append_take(tracks, value);
+  }
+
+  FlValue* result = fl_value_new_map();
+  fl_value_set_string_take(result, "tracks", tracks);
+  fl_value_set_string_take(result, "done", fl_value_new_bool(batch.done));
+  if (batch.done) {
+    FlValue* removed = fl_value_new_list();
+    for (const std::string& path : batch.removed) {
+      fl_value_append_take(removed, String(path));
+    }
+    fl_value_set_string_take(result, "removed", removed);
+    fl_value_set_string_take(result, "cancelled",
+                             fl_value_new_bool(batch.cancelled));
+    FlValue* stats = fl_value_new_map();
+    fl_value_set_string_take(stats, "directories",
+                             Int64(batch.stats.directories));
+    fl_value_set_string_take(stats, "files", Int64(batch.stats.files));
+    fl_value_set_string_take(stats, "changed", Int64(batch.stats.changed));
+    fl_value_set_string_take(stats, "unchanged", Int64(batch.stats.unchanged));
+    fl_value_set_string_take(stats, "removed", Int64(batch.stats.removed));
+    fl_value_set_string_take(stats, "elapsedMs",
+                             fl_value_new_float(batch.stats.elapsed_ms));
+    fl_value_set_string_take(result, "stats", stats);
+  }
+  return result;
+}
+
+}  // namespace
+
+// static
+void LibraryScannerPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new LibraryScannerPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)),
+      "library_scanner_plugin", plugin,
+      [](gpointer data) { delete static_cast<LibraryScannerPlugin*>(data); });
+}
+
+LibraryScannerPlugin::LibraryScannerPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+  g_library_scanner_plugin = this;
+  scanner_.SetNotify([] { g_main_context_invoke(nullptr, OnWake, nullptr); });
+}
+
+LibraryScannerPlugin::~LibraryScannerPlugin() {
+  scanner_.SetNotify(nullptr);
+  g_library_scanner_plugin = nullptr;
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  g_object_unref(method_channel_);
+}
+
+// static
+void LibraryScannerPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                              FlMethodCall* method_call,
+                                              gpointer user_data) {
+  auto* plugin = static_cast<LibraryScannerPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* LibraryScannerPlugin::HandleMethodCall(
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "scan") == 0) {
+    LibraryScanOptions options;
+    if (!GetStringListArg(args, "roots", &options.roots) ||
+        !GetStringListArg(args, "extensions", &options.extensions)) {
+      return InvalidArgument("Missing 'roots' or 'extensions' argument");
+    }
+    GetStringArg(args, "indexPath", &options.index_path);
+    GetStringArg(args, "saveIndexPath", &options.save_path);
+    GetStringArg(args, "coverDirectory", &options.cover_directory);
+    GetBoolArg(args, "full", &options.full);
+    return SuccessResponse(
+        fl_value_new_bool(scanner_.Start(std::move(options))));
+  }
+
+  if (strcmp(method, "cancel") == 0) {
+    scanner_.Cancel();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  if (strcmp(method, "resetIndex") == 0) {
+    std::string index_path;
+    if (!GetStringArg(args, "indexPath", &index_path)) {
+      return InvalidArgument("Missing 'indexPath' argument");
+    }
+    if (scanner_.running()) {
+      return FL_METHOD_RESPONSE(
+          fl_method_error_response_new("BUSY", "A scan is running", nullptr));
+    }
+    LibraryScanner::ResetIndex(index_path);
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+// static
+gboolean LibraryScannerPlugin::OnWake(gpointer user_data) {
+  if (g_library_scanner_plugin != nullptr) {
+    g_library_scanner_plugin->DeliverBatches();
+  }
+  return G_SOURCE_REMOVE;
+}
+
+void LibraryScannerPlugin::DeliverBatches() {
+  for (const LibraryScanBatch& batch : scanner_.TakeBatches()) {
+    g_autoptr(FlValue) value = BatchValue(batch);
+    fl_method_channel_invoke_method(method_channel_, "onBatch", value, nullptr,
+                                    nullptr, nullptr);
+  }
+}
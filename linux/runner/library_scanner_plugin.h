@@ -0,0 +1,38 @@
+#ifndef RUNNER_LIBRARY_SCANNER_PLUGIN_H_
+#define RUNNER_LIBRARY_SCANNER_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include "library/library_scanner.h"
+
+// Scans local music folders for LocalLibraryService on a native
+// LibraryScanner, with the same "library_scanner" method set as the Windows
+// runner: "scan" starts a scan whose tracks come back as "onBatch" calls,
+// the last one with "done" set.
+class LibraryScannerPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit LibraryScannerPlugin(FlMethodChannel* channel);
+  ~LibraryScannerPlugin();
+
+  LibraryScannerPlugin(const LibraryScannerPlugin&) = delete;
+  LibraryScannerPlugin& operator=(const LibraryScannerPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  // GTK thread; scanning threads schedule it through the main context.
+  static gboolean OnWake(gpointer user_data);
+  void DeliverBatches();
+
+  FlMethodChannel* method_channel_;
+  // Last, so a scan still running is cancelled and joined before the
+  // channel goes away.
+  cyrene_music::LibraryScanner scanner_;
+};
+
+#endif  // RUNNER_LIBRARY_SCANNER_PLUGIN_H_
@@ -1,6 +1,51 @@
 #include "my_application.h"
 
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "instance/instance_handoff.h"
+#include "thread/thread_role.h"
+#include "trace/startup_trace.h"
+
 int main(int argc, char** argv) {
+  // --trace-startup[=<file>] records where time goes up to the first frame
+  // as Chrome trace JSON. The flag is not passed on to Dart.
+  std::string trace_path;
+  for (int i = 1; i < argc; ++i) {
+    if (cyrene_music::StartupTrace::ParseFlag(argv[i], &trace_path)) {
+      cyrene_music::StartupTrace::Shared().Enable(trace_path);
+      for (int j = i; j < argc; ++j) argv[j] = argv[j + 1];
+      --argc;
+      break;
+    }
+  }
+
+  // One instance per user: a later launch hands its arguments (e.g. a file
+  // opened from the file manager) to the running one and exits before GTK
+  // or the engine come up.
+  auto& handoff = cyrene_music::InstanceHandoff::Shared();
+  cyrene_music::InstanceHandoff::ArgumentList arguments(argv + 1, argv + argc);
+  if (!handoff.ClaimPrimary(APPLICATION_ID)) {
+    // Relative paths mean this process's working directory, not the
+    // primary's.
+    if (handoff.Forward(
+            cyrene_music::InstanceHandoff::WithAbsolutePaths(arguments),
+            std::chrono::seconds(3))) {
+      return 0;
+    }
+    std::fprintf(stderr, "cyrene_music is already running but not answering\n");
+    return 1;
+  }
+  // Listen right away so launches during this cold start are queued too.
+  handoff.Listen();
+  if (!arguments.empty()) handoff.Post(std::move(arguments));
+
+  // The main thread runs GTK and the platform channels at normal priority;
+  // the lyric marquee raises it to the render role only while it scrolls.
+  cyrene_music::ScopedThreadRole ui_role(cyrene_music::ThreadRole::kUi);
+
   g_autoptr(MyApplication) app = my_application_new();
   return g_application_run(G_APPLICATION(app), argc, argv);
 }
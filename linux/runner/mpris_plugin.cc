@@ -0,0 +1,139 @@
+#include "mpris_plugin.h"
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <glib/gstdio.h>
+
+#include "cover/cover_art_cache.h"
+#include "fl_method_args.h"
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/smtc";
+
+}  // namespace
+
+// static
+void MprisPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new MprisPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "mpris_plugin",
+      plugin, [](gpointer data) { delete static_cast<MprisPlugin*>(data); });
+}
+
+MprisPlugin::MprisPlugin(FlMethodChannel* channel)
+    : method_channel_(channel),
+      service_(APPLICATION_ID,
+               [this](const char* button) { SendButton(button); }) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+}
+
+MprisPlugin::~MprisPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  service_.Disable();
+  RemoveCoverFile();
+  g_object_unref(method_channel_);
+}
+
+// static
+void MprisPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                     FlMethodCall* method_call,
+                                     gpointer user_data) {
+  auto* plugin = static_cast<MprisPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* MprisPlugin::HandleMethodCall(FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+  FlValue* args = fl_method_call_get_args(method_call);
+
+  if (strcmp(method, "initialize") == 0) {
+    // Nothing to set up until "enable" puts the player on the bus.
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "enable") == 0) {
+    service_.Enable();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "disable") == 0) {
+    service_.Disable();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "updateMetadata") == 0) {
+    cyrene_music::MprisState::Metadata metadata;
+    std::string thumbnail;
+    GetStringArg(args, "title", &metadata.title);
+    GetStringArg(args, "artist", &metadata.artist);
+    GetStringArg(args, "album", &metadata.album);
+    GetStringArg(args, "thumbnail", &thumbnail);
+    if (!thumbnail.empty()) metadata.art_url = CoverArtUrl(thumbnail);
+    service_.state().SetMetadata(std::move(metadata));
+    service_.Changed();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "updatePlaybackStatus") == 0) {
+    if (args == nullptr || fl_value_get_type(args) != FL_VALUE_TYPE_STRING) {
+      return InvalidArgument("Expected string argument");
+    }
+    service_.state().SetPlaybackStatus(fl_value_get_string(args));
+    service_.Changed();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+
+  } else if (strcmp(method, "updateTimeline") == 0) {
+    // The position itself is already in the shared playback clock.
+    int64_t duration_ms = 0;
+    if (GetIntArg(args, "endTimeMs", &duration_ms)) {
+      service_.state().SetLength(duration_ms * 1000);
+    }
+    service_.CheckSeeked();
+    service_.Changed();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
+
+void MprisPlugin::SendButton(const char* button) {
+  g_autoptr(FlValue) args = fl_value_new_map();
+  fl_value_set_string_take(args, "button", fl_value_new_string(button));
+  fl_method_channel_invoke_method(method_channel_, "onButtonPressed", args,
+                                  nullptr, nullptr, nullptr);
+}
+
+std::string MprisPlugin::CoverArtUrl(const std::string& thumbnail) {
+  std::shared_ptr<const cyrene_music::CoverArt> cover =
+      cyrene_music::CoverArtCache::Shared().Find(thumbnail);
+  if (!cover || cover->thumbnail.empty()) return thumbnail;
+
+  g_autofree gchar* file_name = g_strdup_printf(
+      "cyrene_music-cover-%08x.bmp", g_str_hash(thumbnail.c_str()));
+  g_autofree gchar* path =
+      g_build_filename(g_get_user_runtime_dir(), file_name, nullptr);
+  if (cover_file_ != path) {
+    const std::vector<uint8_t> bmp = cyrene_music::EncodeBmp(cover->thumbnail);
+    if (!g_file_set_contents(path, reinterpret_cast<const gchar*>(bmp.data()),
+                             static_cast<gssize>(bmp.size()), nullptr)) {
+      return thumbnail;
+    }
+    RemoveCoverFile();
+    cover_file_ = path;
+  }
+  g_autofree gchar* uri = g_filename_to_uri(path, nullptr, nullptr);
+  return uri != nullptr ? std::string(uri) : thumbnail;
+}
+
+void MprisPlugin::RemoveCoverFile() {
+  if (cover_file_.empty()) return;
+  g_remove(cover_file_.c_str());
+  cover_file_.clear();
+}
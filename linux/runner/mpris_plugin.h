@@ -0,0 +1,47 @@
+#ifndef RUNNER_MPRIS_PLUGIN_H_
+#define RUNNER_MPRIS_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+#include <string>
+
+#include "mpris_service.h"
+
+// MPRIS2 media controls on the session bus, serving the same
+// "com.cyrene.music/smtc" method set as the Windows SMTC plugin so the Dart
+// side is shared. Buttons come back as "onButtonPressed" calls. The bus side
+// is MprisService; this only maps the channel onto it.
+//
+// To watch it in isolation, run the app under a private bus:
+//   dbus-run-session -- sh -c 'cyrene_music & gdbus monitor --session \
+//       --dest org.mpris.MediaPlayer2.cyrene_music'
+class MprisPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit MprisPlugin(FlMethodChannel* channel);
+  ~MprisPlugin();
+
+  MprisPlugin(const MprisPlugin&) = delete;
+  MprisPlugin& operator=(const MprisPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  void SendButton(const char* button);
+
+  // A file:// URL for the cached cover, so clients need not download it
+  // again; |thumbnail| itself when the cover is not cached yet.
+  std::string CoverArtUrl(const std::string& thumbnail);
+  void RemoveCoverFile();
+
+  FlMethodChannel* method_channel_;
+  MprisService service_;
+
+  std::string cover_file_;
+};
+
+#endif  // RUNNER_MPRIS_PLUGIN_H_
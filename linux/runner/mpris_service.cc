@@ -0,0 +1,381 @@
+#include "mpris_service.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "playback/playback_clock.h"
+
+namespace {
+
+const char kBusName[] = "org.mpris.MediaPlayer2.cyrene_music";
+const char kObjectPath[] = "/org/mpris/MediaPlayer2";
+const char kRootInterface[] = "org.mpris.MediaPlayer2";
+const char kPlayerInterface[] = "org.mpris.MediaPlayer2.Player";
+
+// One tick: every change made within it goes out in one signal.
+constexpr guint kFlushIntervalMs = 50;
+
+const char kIntrospectionXml[] =
+    "<node>"
+    "  <interface name='org.mpris.MediaPlayer2'>"
+    "    <method name='Raise'/>"
+    "    <method name='Quit'/>"
+    "    <property name='CanQuit' type='b' access='read'/>"
+    "    <property name='CanRaise' type='b' access='read'/>"
+    "    <property name='HasTrackList' type='b' access='read'/>"
+    "    <property name='Identity' type='s' access='read'/>"
+    "    <property name='DesktopEntry' type='s' access='read'/>"
+    "    <property name='SupportedUriSchemes' type='as' access='read'/>"
+    "    <property name='SupportedMimeTypes' type='as' access='read'/>"
+    "  </interface>"
+    "  <interface name='org.mpris.MediaPlayer2.Player'>"
+    "    <method name='Next'/>"
+    "    <method name='Previous'/>"
+    "    <method name='Pause'/>"
+    "    <method name='PlayPause'/>"
+    "    <method name='Stop'/>"
+    "    <method name='Play'/>"
+    "    <method name='Seek'>"
+    "      <arg direction='in' name='Offset' type='x'/>"
+    "    </method>"
+    "    <method name='SetPosition'>"
+    "      <arg direction='in' name='TrackId' type='o'/>"
+    "      <arg direction='in' name='Position' type='x'/>"
+    "    </method>"
+    "    <method name='OpenUri'>"
+    "      <arg direction='in' name='Uri' type='s'/>"
+    "    </method>"
+    "    <signal name='Seeked'>"
+    "      <arg name='Position' type='x'/>"
+    "    </signal>"
+    "    <property name='PlaybackStatus' type='s' access='read'/>"
+    "    <property name='Rate' type='d' access='read'/>"
+    "    <property name='Metadata' type='a{sv}' access='read'/>"
+    "    <property name='Volume' type='d' access='read'/>"
+    "    <property name='Position' type='x' access='read'>"
+    "      <annotation name='org.freedesktop.DBus.Property.EmitsChangedSignal'"
+    "                  value='false'/>"
+    "    </property>"
+    "    <property name='MinimumRate' type='d' access='read'/>"
+    "    <property name='MaximumRate' type='d' access='read'/>"
+    "    <property name='CanGoNext' type='b' access='read'/>"
+    "    <property name='CanGoPrevious' type='b' access='read'/>"
+    "    <property name='CanPlay' type='b' access='read'/>"
+    "    <property name='CanPause' type='b' access='read'/>"
+    "    <property name='CanSeek' type='b' access='read'/>"
+    "    <property name='CanControl' type='b' access='read'/>"
+    "  </interface>"
+    "</node>";
+
+GDBusNodeInfo* IntrospectionData() {
+  static GDBusNodeInfo* info =
+      g_dbus_node_info_new_for_xml(kIntrospectionXml, nullptr);
+  return info;
+}
+
+GVariant* EmptyStrv() { return g_variant_new_strv(nullptr, 0); }
+
+}  // namespace
+
+MprisService::MprisService(std::string desktop_entry, ButtonHandler on_button)
+    : desktop_entry_(std::move(desktop_entry)),
+      on_button_(std::move(on_button)) {}
+
+MprisService::~MprisService() { Disable(); }
+
+void MprisService::Enable() {
+  if (owner_id_ != 0 || own_retry_source_ != 0) return;
+  own_attempts_ = 0;
+  OwnName();
+}
+
+void MprisService::Disable() {
+  if (own_retry_source_ != 0) {
+    g_source_remove(own_retry_source_);
+    own_retry_source_ = 0;
+  }
+  DropConnection();
+  if (owner_id_ != 0) {
+    g_bus_unown_name(owner_id_);
+    owner_id_ = 0;
+  }
+  own_attempts_ = 0;
+}
+
+void MprisService::Changed() {
+  if (connection_ == nullptr || flush_source_ != 0) return;
+  flush_source_ = g_timeout_add(kFlushIntervalMs, OnFlush, this);
+}
+
+void MprisService::OwnName() {
+  // Not queued behind another owner: a refusal comes back as name-lost and
+  // is retried on our own schedule.
+  owner_id_ = g_bus_own_name(G_BUS_TYPE_SESSION, kBusName,
+                             G_BUS_NAME_OWNER_FLAGS_DO_NOT_QUEUE,
+                             OnBusAcquired, OnNameAcquired, OnNameLost, this,
+                             nullptr);
+}
+
+void MprisService::DropConnection() {
+  name_owned_ = false;
+  if (flush_source_ != 0) {
+    g_source_remove(flush_source_);
+    flush_source_ = 0;
+  }
+  if (seek_check_source_ != 0) {
+    g_source_remove(seek_check_source_);
+    seek_check_source_ = 0;
+  }
+  if (connection_ != nullptr) {
+    if (root_registration_ != 0) {
+      g_dbus_connection_unregister_object(connection_, root_registration_);
+    }
+    if (player_registration_ != 0) {
+      g_dbus_connection_unregister_object(connection_, player_registration_);
+    }
+    g_clear_object(&connection_);
+  }
+  root_registration_ = 0;
+  player_registration_ = 0;
+}
+
+// static
+void MprisService::OnBusAcquired(GDBusConnection* connection,
+                                 const gchar* name, gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  static const GDBusInterfaceVTable vtable = {OnMethodCall, OnGetProperty,
+                                              nullptr};
+  GDBusNodeInfo* info = IntrospectionData();
+  service->DropConnection();
+  service->connection_ = G_DBUS_CONNECTION(g_object_ref(connection));
+  service->root_registration_ = g_dbus_connection_register_object(
+      connection, kObjectPath, info->interfaces[0], &vtable, service, nullptr,
+      nullptr);
+  service->player_registration_ = g_dbus_connection_register_object(
+      connection, kObjectPath, info->interfaces[1], &vtable, service, nullptr,
+      nullptr);
+
+  // Clients read everything on connect; start the seek check from here.
+  service->state_.TakeChanged();
+  service->seek_check_source_ =
+      g_timeout_add_seconds(1, OnSeekCheck, service);
+}
+
+// static
+void MprisService::OnNameAcquired(GDBusConnection* connection,
+                                  const gchar* name, gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  service->name_owned_ = true;
+  service->own_attempts_ = 0;
+}
+
+// static
+void MprisService::OnNameLost(GDBusConnection* connection, const gchar* name,
+                              gpointer user_data) {
+  // Another player holds the name, or there is no session bus (|connection|
+  // is null). Either way nothing may stay registered under a name we do not
+  // own; start over with a fresh request.
+  auto* service = static_cast<MprisService*>(user_data);
+  service->DropConnection();
+  if (service->owner_id_ != 0) {
+    g_bus_unown_name(service->owner_id_);
+    service->owner_id_ = 0;
+  }
+  if (++service->own_attempts_ >= kMaxOwnAttempts) {
+    g_warning("MPRIS: could not own %s after %d attempts, giving up", name,
+              service->own_attempts_);
+    return;
+  }
+  const guint delay_ms = kOwnRetryBaseMs << (service->own_attempts_ - 1);
+  g_warning("MPRIS: lost %s, asking for it again in %u ms", name, delay_ms);
+  service->own_retry_source_ = g_timeout_add(delay_ms, OnOwnRetry, service);
+}
+
+// static
+gboolean MprisService::OnOwnRetry(gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  service->own_retry_source_ = 0;
+  service->OwnName();
+  return G_SOURCE_REMOVE;
+}
+
+// static
+void MprisService::OnMethodCall(GDBusConnection* connection,
+                               const gchar* sender, const gchar* object_path,
+                               const gchar* interface_name,
+                               const gchar* method_name, GVariant* parameters,
+                               GDBusMethodInvocation* invocation,
+                               gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  if (g_strcmp0(interface_name, kPlayerInterface) == 0) {
+    if (g_strcmp0(method_name, "Next") == 0) {
+      service->on_button_("next");
+    } else if (g_strcmp0(method_name, "Previous") == 0) {
+      service->on_button_("previous");
+    } else if (g_strcmp0(method_name, "Pause") == 0) {
+      service->on_button_("pause");
+    } else if (g_strcmp0(method_name, "Play") == 0) {
+      service->on_button_("play");
+    } else if (g_strcmp0(method_name, "Stop") == 0) {
+      service->on_button_("stop");
+    } else if (g_strcmp0(method_name, "PlayPause") == 0) {
+      const bool playing =
+          strcmp(service->state_.playback_status(), "Playing") == 0;
+      service->on_button_(playing ? "pause" : "play");
+    } else if (g_strcmp0(method_name, "OpenUri") == 0) {
+      g_dbus_method_invocation_return_error(invocation, G_DBUS_ERROR,
+                                            G_DBUS_ERROR_NOT_SUPPORTED,
+                                            "OpenUri is not supported");
+      return;
+    }
+    // Seek and SetPosition have no effect while CanSeek is false.
+  }
+  // Raise and Quit have no effect while CanRaise and CanQuit are false.
+  g_dbus_method_invocation_return_value(invocation, nullptr);
+}
+
+// static
+GVariant* MprisService::OnGetProperty(GDBusConnection* connection,
+                                     const gchar* sender,
+                                     const gchar* object_path,
+                                     const gchar* interface_name,
+                                     const gchar* property_name,
+                                     GError** error, gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  GVariant* value = g_strcmp0(interface_name, kRootInterface) == 0
+                        ? service->RootProperty(property_name)
+                        : service->PlayerProperty(property_name);
+  if (value == nullptr) {
+    g_set_error(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_PROPERTY,
+                "Unknown property %s", property_name);
+  }
+  return value;
+}
+
+GVariant* MprisService::RootProperty(const gchar* name) {
+  if (g_strcmp0(name, "CanQuit") == 0 || g_strcmp0(name, "CanRaise") == 0 ||
+      g_strcmp0(name, "HasTrackList") == 0) {
+    return g_variant_new_boolean(FALSE);
+  }
+  if (g_strcmp0(name, "Identity") == 0) {
+    return g_variant_new_string("Cyrene Music");
+  }
+  if (g_strcmp0(name, "DesktopEntry") == 0) {
+    return g_variant_new_string(desktop_entry_.c_str());
+  }
+  if (g_strcmp0(name, "SupportedUriSchemes") == 0 ||
+      g_strcmp0(name, "SupportedMimeTypes") == 0) {
+    return EmptyStrv();
+  }
+  return nullptr;
+}
+
+GVariant* MprisService::PlayerProperty(const gchar* name) {
+  if (g_strcmp0(name, "PlaybackStatus") == 0) {
+    return g_variant_new_string(state_.playback_status());
+  }
+  if (g_strcmp0(name, "Metadata") == 0) return MetadataVariant();
+  if (g_strcmp0(name, "Position") == 0) {
+    return g_variant_new_int64(
+        state_.PositionUs(cyrene_music::PlaybackClock::NowUs()));
+  }
+  if (g_strcmp0(name, "Rate") == 0) return g_variant_new_double(state_.rate());
+  // The player sets the rate; report the current one as within range.
+  if (g_strcmp0(name, "MinimumRate") == 0) {
+    return g_variant_new_double(std::min(1.0, state_.rate()));
+  }
+  if (g_strcmp0(name, "MaximumRate") == 0) {
+    return g_variant_new_double(std::max(1.0, state_.rate()));
+  }
+  if (g_strcmp0(name, "Volume") == 0) return g_variant_new_double(1.0);
+  if (g_strcmp0(name, "CanSeek") == 0) return g_variant_new_boolean(FALSE);
+  if (g_strcmp0(name, "CanGoNext") == 0 ||
+      g_strcmp0(name, "CanGoPrevious") == 0 ||
+      g_strcmp0(name, "CanPlay") == 0 || g_strcmp0(name, "CanPause") == 0 ||
+      g_strcmp0(name, "CanControl") == 0) {
+    return g_variant_new_boolean(TRUE);
+  }
+  return nullptr;
+}
+
+GVariant* MprisService::MetadataVariant() {
+  const cyrene_music::MprisState::Metadata& metadata = state_.metadata();
+  const std::string track_id = state_.track_id();
+  GVariantBuilder builder;
+  g_variant_builder_init(&builder, G_VARIANT_TYPE("a{sv}"));
+  g_variant_builder_add(&builder, "{sv}", "mpris:trackid",
+                        g_variant_new_object_path(track_id.c_str()));
+  if (metadata.length_us > 0) {
+    g_variant_builder_add(&builder, "{sv}", "mpris:length",
+                          g_variant_new_int64(metadata.length_us));
+  }
+  if (!metadata.art_url.empty()) {
+    g_variant_builder_add(&builder, "{sv}", "mpris:artUrl",
+                          g_variant_new_string(metadata.art_url.c_str()));
+  }
+  if (!metadata.title.empty()) {
+    g_variant_builder_add(&builder, "{sv}", "xesam:title",
+                          g_variant_new_string(metadata.title.c_str()));
+  }
+  if (!metadata.artist.empty()) {
+    const gchar* artists[] = {metadata.artist.c_str(), nullptr};
+    g_variant_builder_add(&builder, "{sv}", "xesam:artist",
+                          g_variant_new_strv(artists, 1));
+  }
+  if (!metadata.album.empty()) {
+    g_variant_builder_add(&builder, "{sv}", "xesam:album",
+                          g_variant_new_string(metadata.album.c_str()));
+  }
+  return g_variant_builder_end(&builder);
+}
+
+// static
+gboolean MprisService::OnFlush(gpointer user_data) {
+  using cyrene_music::MprisState;
+  auto* service = static_cast<MprisService*>(user_data);
+  service->flush_source_ = 0;
+  const uint32_t changed = service->state_.TakeChanged();
+  if (changed == 0 || service->connection_ == nullptr) return G_SOURCE_REMOVE;
+
+  GVariantBuilder properties;
+  g_variant_builder_init(&properties, G_VARIANT_TYPE("a{sv}"));
+  if (changed & MprisState::kPlaybackStatus) {
+    g_variant_builder_add(&properties, "{sv}", "PlaybackStatus",
+                          service->PlayerProperty("PlaybackStatus"));
+  }
+  if (changed & MprisState::kMetadata) {
+    g_variant_builder_add(&properties, "{sv}", "Metadata",
+                          service->MetadataVariant());
+  }
+  if (changed & MprisState::kRate) {
+    g_variant_builder_add(&properties, "{sv}", "Rate",
+                          service->PlayerProperty("Rate"));
+  }
+  g_dbus_connection_emit_signal(
+      service->connection_, nullptr, kObjectPath,
+      "org.freedesktop.DBus.Properties", "PropertiesChanged",
+      g_variant_new("(sa{sv}as)", kPlayerInterface, &properties, nullptr),
+      nullptr);
+  return G_SOURCE_REMOVE;
+}
+
+// static
+gboolean MprisService::OnSeekCheck(gpointer user_data) {
+  auto* service = static_cast<MprisService*>(user_data);
+  service->CheckSeeked();
+  service->Changed();  // a rate change is a property change
+  return G_SOURCE_CONTINUE;
+}
+
+void MprisService::CheckSeeked() {
+  int64_t position_us = 0;
+  if (connection_ == nullptr ||
+      !state_.CheckSeeked(cyrene_music::PlaybackClock::NowUs(), &position_us)) {
+    return;
+  }
+  g_dbus_connection_emit_signal(connection_, nullptr, kObjectPath,
+                                kPlayerInterface, "Seeked",
+                                g_variant_new("(x)", position_us), nullptr);
+}
+
@@ -0,0 +1,97 @@
+#ifndef RUNNER_MPRIS_SERVICE_H_
+#define RUNNER_MPRIS_SERVICE_H_
+
+#include <gio/gio.h>
+
+#include <functional>
+#include <string>
+
+#include "media/mpris_state.h"
+
+// The MPRIS2 player on the session bus: org.mpris.MediaPlayer2 and
+// org.mpris.MediaPlayer2.Player at /org/mpris/MediaPlayer2. Only GIO is
+// needed, so it is driven by MprisPlugin in the app and by mpris_bus_bench
+// against a private bus.
+//
+// Property changes are collected for one short tick and announced in a
+// single PropertiesChanged signal. Position is answered from the shared
+// playback clock when asked; a once-a-second in-process check only emits
+// Seeked when playback jumps.
+//
+// When the name is lost (another player took it, or the bus went away) the
+// objects come off the connection and the name is requested again after a
+// growing delay; after kMaxOwnAttempts in a row it gives up until the next
+// Enable().
+class MprisService {
+ public:
+  // Called with "play", "pause", "next", "previous" or "stop".
+  using ButtonHandler = std::function<void(const char* button)>;
+
+  static constexpr int kMaxOwnAttempts = 5;
+  static constexpr guint kOwnRetryBaseMs = 1000;
+
+  MprisService(std::string desktop_entry, ButtonHandler on_button);
+  ~MprisService();
+
+  MprisService(const MprisService&) = delete;
+  MprisService& operator=(const MprisService&) = delete;
+
+  // Puts the player on the bus, or takes it off again.
+  void Enable();
+  void Disable();
+
+  // True while the name is owned and the objects are registered.
+  bool on_bus() const { return name_owned_; }
+
+  // Change the state, then call Changed() to announce it this tick.
+  cyrene_music::MprisState& state() { return state_; }
+  void Changed();
+  // Emits Seeked now if playback jumped.
+  void CheckSeeked();
+
+ private:
+  void OwnName();
+  // Unregisters the objects and drops the connection and its timers.
+  void DropConnection();
+  static void OnBusAcquired(GDBusConnection* connection, const gchar* name,
+                            gpointer user_data);
+  static void OnNameAcquired(GDBusConnection* connection, const gchar* name,
+                             gpointer user_data);
+  static void OnNameLost(GDBusConnection* connection, const gchar* name,
+                         gpointer user_data);
+  static gboolean OnOwnRetry(gpointer user_data);
+
+  static void OnMethodCall(GDBusConnection* connection, const gchar* sender,
+                           const gchar* object_path,
+                           const gchar* interface_name,
+                           const gchar* method_name, GVariant* parameters,
+                           GDBusMethodInvocation* invocation,
+                           gpointer user_data);
+  static GVariant* OnGetProperty(GDBusConnection* connection,
+                                 const gchar* sender, const gchar* object_path,
+                                 const gchar* interface_name,
+                                 const gchar* property_name, GError** error,
+                                 gpointer user_data);
+  GVariant* RootProperty(const gchar* name);
+  GVariant* PlayerProperty(const gchar* name);
+  GVariant* MetadataVariant();
+
+  static gboolean OnFlush(gpointer user_data);
+  static gboolean OnSeekCheck(gpointer user_data);
+
+  const std::string desktop_entry_;
+  const ButtonHandler on_button_;
+  cyrene_music::MprisState state_;
+
+  guint owner_id_ = 0;
+  bool name_owned_ = false;
+  int own_attempts_ = 0;
+  guint own_retry_source_ = 0;
+  GDBusConnection* connection_ = nullptr;
+  guint root_registration_ = 0;
+  guint player_registration_ = 0;
+  guint flush_source_ = 0;
+  guint seek_check_source_ = 0;
+};
+
+#endif  // RUNNER_MPRIS_SERVICE_H_
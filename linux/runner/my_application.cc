@@ -6,6 +6,17 @@
 #endif
 
 #include "flutter/generated_plugin_registrant.h"
+#include "cache_index_plugin.h"
+#include "cache_stream_plugin.h"
+#include "cover_art_plugin.h"
+#include "desktop_lyric_plugin.h"
+#include "downloader_plugin.h"
+#include "instance_plugin.h"
+#include "library_scanner_plugin.h"
+#include "mpris_plugin.h"
+#include "openssl_tls_connector.h"
+#include "stream_proxy_plugin.h"
+#include "trace/startup_trace.h"
 
 struct _MyApplication {
   GtkApplication parent_instance;
@@ -14,9 +25,18 @@ struct _MyApplication {
 
 G_DEFINE_TYPE(MyApplication, my_application, GTK_TYPE_APPLICATION)
 
+using cyrene_music::StartupTrace;
+
+// Called when the first Flutter frame has been rendered.
+static void first_frame_cb(MyApplication* self, FlView* view) {
+  StartupTrace::Shared().Instant("first frame");
+  StartupTrace::Shared().Finish();
+}
+
 // Implements GApplication::activate.
 static void my_application_activate(GApplication* application) {
   MyApplication* self = MY_APPLICATION(application);
+  StartupTrace::Scope activate_trace("my_application_activate");
   GtkWindow* window =
       GTK_WINDOW(gtk_application_window_new(GTK_APPLICATION(application)));
 
@@ -53,11 +73,99 @@ static void my_application_activate(GApplication* application) {
   g_autoptr(FlDartProject) project = fl_dart_project_new();
   fl_dart_project_set_dart_entrypoint_arguments(project, self->dart_entrypoint_arguments);
 
-  FlView* view = fl_view_new(project);
+  FlView* view;
+  {
+    StartupTrace::Scope trace("fl_view_new");
+    view = fl_view_new(project);
+  }
+  if (StartupTrace::Shared().enabled()) {
+    g_signal_connect_swapped(view, "first-frame", G_CALLBACK(first_frame_cb),
+                             self);
+  }
   gtk_widget_show(GTK_WIDGET(view));
   gtk_container_add(GTK_CONTAINER(window), GTK_WIDGET(view));
 
-  fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  {
+    StartupTrace::Scope trace("fl_register_plugins");
+    fl_register_plugins(FL_PLUGIN_REGISTRY(view));
+  }
+
+  // Runner-local plugins
+  {
+    StartupTrace::Scope trace("CoverArtPlugin");
+    g_autoptr(FlPluginRegistrar) cover_art_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "CoverArtPlugin");
+    CoverArtPlugin::RegisterWithRegistrar(cover_art_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("CacheIndexPlugin");
+    g_autoptr(FlPluginRegistrar) cache_index_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "CacheIndexPlugin");
+    CacheIndexPlugin::RegisterWithRegistrar(cache_index_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("CacheStreamPlugin");
+    g_autoptr(FlPluginRegistrar) cache_stream_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "CacheStreamPlugin");
+    CacheStreamPlugin::RegisterWithRegistrar(cache_stream_registrar);
+  }
+
+  // https:// for the stream proxy; the OpenSSL context is only created
+  // with the first connection.
+  OpenSslTlsConnector::Install();
+
+  {
+    StartupTrace::Scope trace("StreamProxyPlugin");
+    g_autoptr(FlPluginRegistrar) stream_proxy_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "StreamProxyPlugin");
+    StreamProxyPlugin::RegisterWithRegistrar(stream_proxy_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("DownloaderPlugin");
+    g_autoptr(FlPluginRegistrar) downloader_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "DownloaderPlugin");
+    DownloaderPlugin::RegisterWithRegistrar(downloader_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("LibraryScannerPlugin");
+    g_autoptr(FlPluginRegistrar) library_scanner_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "LibraryScannerPlugin");
+    LibraryScannerPlugin::RegisterWithRegistrar(library_scanner_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("InstancePlugin");
+    g_autoptr(FlPluginRegistrar) instance_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "InstancePlugin");
+    InstancePlugin::RegisterWithRegistrar(instance_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("DesktopLyricPlugin");
+    g_autoptr(FlPluginRegistrar) desktop_lyric_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "DesktopLyricPlugin");
+    DesktopLyricPlugin::RegisterWithRegistrar(desktop_lyric_registrar);
+  }
+
+  {
+    StartupTrace::Scope trace("MprisPlugin");
+    g_autoptr(FlPluginRegistrar) mpris_registrar =
+        fl_plugin_registry_get_registrar_for_plugin(FL_PLUGIN_REGISTRY(view),
+                                                    "MprisPlugin");
+    MprisPlugin::RegisterWithRegistrar(mpris_registrar);
+  }
 
   gtk_widget_grab_focus(GTK_WIDGET(view));
 }
@@ -0,0 +1,41 @@
+#ifndef RUNNER_OPENSSL_TLS_CONNECTOR_H_
+#define RUNNER_OPENSSL_TLS_CONNECTOR_H_
+
+#include <openssl/ssl.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "net/transport.h"
+
+// https:// for the native HTTP client (stream proxy, downloads) through
+// OpenSSL, verifying servers against the system trust store. One context,
+// created with the first connection so startup never loads the store, is
+// shared by every connection; Connect() is safe from any thread.
+class OpenSslTlsConnector : public cyrene_music::TlsConnector {
+ public:
+  // Installs a process-lifetime connector with SetTlsConnector(). Upstream
+  // threads may still be finishing a handshake at exit, so it is never
+  // destroyed.
+  static void Install();
+
+  OpenSslTlsConnector() = default;
+  ~OpenSslTlsConnector() override;
+
+  OpenSslTlsConnector(const OpenSslTlsConnector&) = delete;
+  OpenSslTlsConnector& operator=(const OpenSslTlsConnector&) = delete;
+
+  std::unique_ptr<cyrene_music::Transport> Connect(intptr_t socket,
+                                                   const std::string& host,
+                                                   std::string* error) override;
+
+ private:
+  // nullptr if OpenSSL could not create one.
+  SSL_CTX* Context();
+
+  std::once_flag context_once_;
+  SSL_CTX* context_ = nullptr;
+};
+
+#endif  // RUNNER_OPENSSL_TLS_CONNECTOR_H_
@@ -0,0 +1,150 @@
+#include "pango_text_rasterizer.h"
+
+#include <cmath>
+
+#include "lyric/lyric_layout.h"
+
+namespace cyrene_music {
+
+namespace {
+
+// Same face as the Windows overlay when it is installed, then the common
+// Linux CJK families.
+const char kFontFamilies[] =
+    "Microsoft YaHei,Noto Sans CJK SC,Source Han Sans SC,"
+    "WenQuanYi Micro Hei,sans-serif";
+
+void SetSourceArgb(cairo_t* cr, uint32_t argb) {
+  cairo_set_source_rgba(cr, ((argb >> 16) & 0xFF) / 255.0,
+                        ((argb >> 8) & 0xFF) / 255.0, (argb & 0xFF) / 255.0,
+                        ((argb >> 24) & 0xFF) / 255.0);
+}
+
+// Strokes and fills |layout| with its top-left at the current point, or
+// fills it plainly when there is no stroke.
+void DrawStyledLayout(cairo_t* cr, PangoLayout* layout,
+                      const TextStyle& style) {
+  if (style.stroke_width > 0.0f) {
+    pango_cairo_layout_path(cr, layout);
+    SetSourceArgb(cr, style.stroke_color);
+    cairo_set_line_width(cr, style.stroke_width);
+    cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+    cairo_stroke_preserve(cr);
+    SetSourceArgb(cr, style.fill_color);
+    cairo_fill(cr);
+  } else {
+    SetSourceArgb(cr, style.fill_color);
+    pango_cairo_show_layout(cr, layout);
+  }
+}
+
+}  // namespace
+
+PangoTextRasterizer::PangoTextRasterizer()
+    : measure_surface_(cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 1, 1)),
+      measure_cr_(cairo_create(measure_surface_)),
+      measure_layout_(pango_cairo_create_layout(measure_cr_)) {}
+
+PangoTextRasterizer::~PangoTextRasterizer() {
+  g_object_unref(measure_layout_);
+  cairo_destroy(measure_cr_);
+  cairo_surface_destroy(measure_surface_);
+}
+
+float PangoTextRasterizer::PrepareLayout(PangoLayout* layout, const char* text,
+                                         int length, const TextStyle& style) {
+  PangoFontDescription* font = pango_font_description_from_string(kFontFamilies);
+  pango_font_description_set_weight(
+      font, style.bold ? PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
+  pango_font_description_set_absolute_size(
+      font, static_cast<double>(style.font_size) * PANGO_SCALE);
+  pango_layout_set_font_description(layout, font);
+  pango_font_description_free(font);
+
+  pango_layout_set_text(layout, text, length);
+  PangoRectangle logical;
+  pango_layout_get_extents(layout, nullptr, &logical);
+  return static_cast<float>(logical.width) / PANGO_SCALE;
+}
+
+float PangoTextRasterizer::MeasureText(const std::string& utf8,
+                                       const TextStyle& style) {
+  if (!style.upright_cjk) {
+    return PrepareLayout(measure_layout_, utf8.data(),
+                         static_cast<int>(utf8.size()), style);
+  }
+  // Vertical mode advances run by run, so measure the same way it draws.
+  float width = 0.0f;
+  for (const TextRun& run : SegmentForVertical(utf8)) {
+    const float run_width =
+        PrepareLayout(measure_layout_, utf8.data() + run.begin,
+                      static_cast<int>(run.length), style);
+    width += run.rotate && run_width <= 0.0f ? style.font_size : run_width;
+  }
+  return width;
+}
+
+void PangoTextRasterizer::DrawText(ArgbSurface* target,
+                                   const std::string& utf8,
+                                   const TextStyle& style, float x, float y,
+                                   float height) {
+  if (utf8.empty() || target->empty()) return;
+
+  // Draw straight into the surface's memory; both sides are premultiplied
+  // native-endian ARGB32.
+  cairo_surface_t* surface = cairo_image_surface_create_for_data(
+      reinterpret_cast<unsigned char*>(target->data()), CAIRO_FORMAT_ARGB32,
+      target->width(), target->height(), target->stride_bytes());
+  cairo_t* cr = cairo_create(surface);
+  PangoLayout* layout = pango_cairo_create_layout(cr);
+
+  auto draw_run = [&](const char* text, int length, float left,
+                      float box_width, bool rotate) {
+    PrepareLayout(layout, text, length, style);
+    PangoRectangle logical;
+    pango_layout_get_extents(layout, nullptr, &logical);
+    const double text_width = static_cast<double>(logical.width) / PANGO_SCALE;
+    const double text_height =
+        static_cast<double>(logical.height) / PANGO_SCALE;
+
+    cairo_save(cr);
+    if (rotate) {
+      // Rotate -90 degrees about the character's centre so it reads upright
+      // once the whole frame is rotated clockwise.
+      const double center_x = left + box_width / 2.0;
+      const double center_y = y + height / 2.0;
+      cairo_translate(cr, center_x, center_y);
+      cairo_rotate(cr, -M_PI / 2.0);
+      cairo_translate(cr, -center_x, -center_y);
+      cairo_move_to(cr, left + (box_width - text_width) / 2.0,
+                    y + (height - text_height) / 2.0);
+    } else {
+      cairo_move_to(cr, left, y + (height - text_height) / 2.0);
+    }
+    DrawStyledLayout(cr, layout, style);
+    cairo_restore(cr);
+    return static_cast<float>(text_width);
+  };
+
+  if (!style.upright_cjk) {
+    draw_run(utf8.data(), static_cast<int>(utf8.size()), x, 0.0f, false);
+  } else {
+    // CJK characters are drawn one at a time, other runs as continuous
+    // strings to keep their spacing.
+    for (const TextRun& run : SegmentForVertical(utf8)) {
+      const char* text = utf8.data() + run.begin;
+      const int length = static_cast<int>(run.length);
+      float run_width = PrepareLayout(layout, text, length, style);
+      if (run.rotate && run_width <= 0.0f) run_width = style.font_size;
+      draw_run(text, length, x, run_width, run.rotate);
+      x += run_width;
+    }
+  }
+
+  g_object_unref(layout);
+  cairo_destroy(cr);
+  cairo_surface_flush(surface);
+  cairo_surface_destroy(surface);
+}
+
+}  // namespace cyrene_music
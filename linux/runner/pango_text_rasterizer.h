@@ -0,0 +1,40 @@
+#ifndef RUNNER_PANGO_TEXT_RASTERIZER_H_
+#define RUNNER_PANGO_TEXT_RASTERIZER_H_
+
+#include <cairo.h>
+#include <pango/pangocairo.h>
+
+#include <string>
+
+#include "lyric/text_rasterizer.h"
+
+namespace cyrene_music {
+
+// TextRasterizer backed by Pango layouts stroked and filled through cairo.
+class PangoTextRasterizer : public TextRasterizer {
+ public:
+  PangoTextRasterizer();
+  ~PangoTextRasterizer() override;
+
+  PangoTextRasterizer(const PangoTextRasterizer&) = delete;
+  PangoTextRasterizer& operator=(const PangoTextRasterizer&) = delete;
+
+  float MeasureText(const std::string& utf8, const TextStyle& style) override;
+  void DrawText(ArgbSurface* target, const std::string& utf8,
+                const TextStyle& style, float x, float y,
+                float height) override;
+
+ private:
+  // Sets |layout|'s text and font for |style|; returns the logical width.
+  float PrepareLayout(PangoLayout* layout, const char* text, int length,
+                      const TextStyle& style);
+
+  // 1x1 context used only to measure text.
+  cairo_surface_t* measure_surface_;
+  cairo_t* measure_cr_;
+  PangoLayout* measure_layout_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_PANGO_TEXT_RASTERIZER_H_
@@ -0,0 +1,55 @@
+#include "pixbuf_image_decoder.h"
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+
+#include <utility>
+
+namespace {
+
+// Larger images are refused rather than allocated; covers are far smaller.
+constexpr int kMaxDimension = 8192;
+
+}  // namespace
+
+bool PixbufImageDecoder::Decode(const uint8_t* data, size_t size,
+                                cyrene_music::ArgbSurface* out) {
+  g_autoptr(GdkPixbufLoader) loader = gdk_pixbuf_loader_new();
+  if (!gdk_pixbuf_loader_write(loader, data, size, nullptr)) {
+    gdk_pixbuf_loader_close(loader, nullptr);
+    return false;
+  }
+  if (!gdk_pixbuf_loader_close(loader, nullptr)) return false;
+  GdkPixbuf* pixbuf = gdk_pixbuf_loader_get_pixbuf(loader);
+  if (pixbuf == nullptr ||
+      gdk_pixbuf_get_colorspace(pixbuf) != GDK_COLORSPACE_RGB ||
+      gdk_pixbuf_get_bits_per_sample(pixbuf) != 8) {
+    return false;
+  }
+
+  const int width = gdk_pixbuf_get_width(pixbuf);
+  const int height = gdk_pixbuf_get_height(pixbuf);
+  if (width <= 0 || height <= 0 || width > kMaxDimension ||
+      height > kMaxDimension) {
+    return false;
+  }
+  const int channels = gdk_pixbuf_get_n_channels(pixbuf);
+  const bool has_alpha = gdk_pixbuf_get_has_alpha(pixbuf);
+  const int rowstride = gdk_pixbuf_get_rowstride(pixbuf);
+  const guchar* pixels = gdk_pixbuf_read_pixels(pixbuf);
+
+  // gdk-pixbuf rows are straight-alpha R, G, B[, A] bytes.
+  cyrene_music::ArgbSurface surface(width, height);
+  for (int y = 0; y < height; ++y) {
+    const guchar* src = pixels + static_cast<size_t>(y) * rowstride;
+    uint32_t* dst = surface.row(y);
+    for (int x = 0; x < width; ++x, src += channels) {
+      const uint32_t a = has_alpha ? src[3] : 255;
+      const uint32_t r = src[0] * a / 255;
+      const uint32_t g = src[1] * a / 255;
+      const uint32_t b = src[2] * a / 255;
+      dst[x] = (a << 24) | (r << 16) | (g << 8) | b;
+    }
+  }
+  *out = std::move(surface);
+  return true;
+}
@@ -0,0 +1,14 @@
+#ifndef RUNNER_PIXBUF_IMAGE_DECODER_H_
+#define RUNNER_PIXBUF_IMAGE_DECODER_H_
+
+#include "cover/cover_art_cache.h"
+
+// Decodes cover art with gdk-pixbuf and premultiplies it into ArgbSurface's
+// layout (the one cairo's ARGB32 uses). Safe to use off the GTK thread.
+class PixbufImageDecoder : public cyrene_music::ImageDecoder {
+ public:
+  bool Decode(const uint8_t* data, size_t size,
+              cyrene_music::ArgbSurface* out) override;
+};
+
+#endif  // RUNNER_PIXBUF_IMAGE_DECODER_H_
@@ -0,0 +1,70 @@
+#include "stream_proxy_plugin.h"
+
+#include <cstring>
+
+#include "fl_method_args.h"
+#include "net/stream_proxy.h"
+
+namespace {
+
+const char kChannelName[] = "com.cyrene.music/stream_proxy";
+
+}  // namespace
+
+// static
+void StreamProxyPlugin::RegisterWithRegistrar(FlPluginRegistrar* registrar) {
+  g_autoptr(FlStandardMethodCodec) codec = fl_standard_method_codec_new();
+  FlMethodChannel* channel =
+      fl_method_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                            kChannelName, FL_METHOD_CODEC(codec));
+
+  auto* plugin = new StreamProxyPlugin(channel);
+  g_object_set_data_full(
+      G_OBJECT(fl_plugin_registrar_get_view(registrar)), "stream_proxy_plugin",
+      plugin,
+      [](gpointer data) { delete static_cast<StreamProxyPlugin*>(data); });
+}
+
+StreamProxyPlugin::StreamProxyPlugin(FlMethodChannel* channel)
+    : method_channel_(channel) {
+  fl_method_channel_set_method_call_handler(method_channel_, MethodCallCallback,
+                                            this, nullptr);
+}
+
+StreamProxyPlugin::~StreamProxyPlugin() {
+  fl_method_channel_set_method_call_handler(method_channel_, nullptr, nullptr,
+                                            nullptr);
+  // Streams still being relayed end with the view, not with static
+  // destruction.
+  cyrene_music::StreamProxy::Shared().Stop();
+  g_object_unref(method_channel_);
+}
+
+// static
+void StreamProxyPlugin::MethodCallCallback(FlMethodChannel* channel,
+                                           FlMethodCall* method_call,
+                                           gpointer user_data) {
+  auto* plugin = static_cast<StreamProxyPlugin*>(user_data);
+  g_autoptr(FlMethodResponse) response = plugin->HandleMethodCall(method_call);
+  fl_method_call_respond(method_call, response, nullptr);
+}
+
+FlMethodResponse* StreamProxyPlugin::HandleMethodCall(
+    FlMethodCall* method_call) {
+  const gchar* method = fl_method_call_get_name(method_call);
+
+  if (strcmp(method, "start") == 0) {
+    const uint16_t port = cyrene_music::StreamProxy::Shared().Start();
+    if (port == 0) {
+      return FL_METHOD_RESPONSE(fl_method_error_response_new(
+          "START_FAILED", "No free proxy port", nullptr));
+    }
+    return SuccessResponse(fl_value_new_int(port));
+
+  } else if (strcmp(method, "stop") == 0) {
+    cyrene_music::StreamProxy::Shared().Stop();
+    return SuccessResponse(fl_value_new_bool(TRUE));
+  }
+
+  return FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
+}
@@ -0,0 +1,27 @@
+#ifndef RUNNER_STREAM_PROXY_PLUGIN_H_
+#define RUNNER_STREAM_PROXY_PLUGIN_H_
+
+#include <flutter_linux/flutter_linux.h>
+
+// Starts and stops the native StreamProxy for ProxyService, serving the same
+// "stream_proxy" method set as the Windows runner.
+class StreamProxyPlugin {
+ public:
+  static void RegisterWithRegistrar(FlPluginRegistrar* registrar);
+
+  explicit StreamProxyPlugin(FlMethodChannel* channel);
+  ~StreamProxyPlugin();
+
+  StreamProxyPlugin(const StreamProxyPlugin&) = delete;
+  StreamProxyPlugin& operator=(const StreamProxyPlugin&) = delete;
+
+ private:
+  static void MethodCallCallback(FlMethodChannel* channel,
+                                 FlMethodCall* method_call, gpointer user_data);
+
+  FlMethodResponse* HandleMethodCall(FlMethodCall* method_call);
+
+  FlMethodChannel* method_channel_;
+};
+
+#endif  // RUNNER_STREAM_PROXY_PLUGIN_H_
@@ -0,0 +1,74 @@
+#include "audio/spectrum_slot.h"
+
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+// A reader gives up after this many torn reads; the writer only updates at
+// ~60 Hz, so more than one retry is already rare.
+constexpr int kMaxReadAttempts = 4;
+
+}  // namespace
+
+// static
+SpectrumSlot& SpectrumSlot::Shared() {
+  static SpectrumSlot slot;
+  return slot;
+}
+
+SpectrumSlot::SpectrumSlot() : sequence_(0), publishing_(false) {
+  for (auto& band : bands_) band.store(0.0f, std::memory_order_relaxed);
+}
+
+void SpectrumSlot::Publish(const float* bands, int count) {
+  const uint64_t start = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(start + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for (int i = 0; i < kSpectrumBands; ++i) {
+    bands_[i].store(i < count ? bands[i] : 0.0f, std::memory_order_relaxed);
+  }
+  sequence_.store(start + 2, std::memory_order_release);
+}
+
+void SpectrumSlot::SetPublishing(bool publishing) {
+  publishing_.store(publishing, std::memory_order_release);
+}
+
+bool SpectrumSlot::Read(SpectrumFrame* out) const {
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    const uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before == 0) return false;
+    if (before & 1) continue;
+    for (int i = 0; i < kSpectrumBands; ++i) {
+      out->bands[i] = bands_[i].load(std::memory_order_relaxed);
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == before) {
+      out->sequence = before / 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+uint64_t SpectrumSlot::sequence() const {
+  return sequence_.load(std::memory_order_acquire) / 2;
+}
+
+void SpectrumSlot::AddReader() {
+  ++readers_;
+  if (demand_callback_) demand_callback_();
+}
+
+void SpectrumSlot::RemoveReader() {
+  if (readers_ > 0) --readers_;
+  if (demand_callback_) demand_callback_();
+}
+
+void SpectrumSlot::SetDemandCallback(DemandCallback callback) {
+  demand_callback_ = std::move(callback);
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,76 @@
+#ifndef NATIVE_AUDIO_SPECTRUM_SLOT_H_
+#define NATIVE_AUDIO_SPECTRUM_SLOT_H_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+
+namespace cyrene_music {
+
+// Number of bands the rhythm analyser produces per frame.
+constexpr int kSpectrumBands = 16;
+
+// One analysed frame, band levels normalised to [0, 1].
+struct SpectrumFrame {
+  uint64_t sequence = 0;
+  std::array<float, kSpectrumBands> bands{};
+};
+
+// Latest-frame mailbox between the audio analyser and in-process consumers
+// such as the desktop lyric overlay, so band data never has to round-trip
+// through Dart.
+//
+// There is a single writer (the capture thread) and any number of readers.
+// It is a seqlock: Publish() never blocks or allocates, and Read() never
+// blocks the reader's thread; a read that races a write simply retries a
+// few times and then reports failure, keeping the previous frame.
+class SpectrumSlot {
+ public:
+  // The process-wide slot the rhythm analyser publishes into.
+  static SpectrumSlot& Shared();
+
+  SpectrumSlot();
+
+  SpectrumSlot(const SpectrumSlot&) = delete;
+  SpectrumSlot& operator=(const SpectrumSlot&) = delete;
+
+  // Writer side. Bands past kSpectrumBands are ignored, missing ones are 0.
+  void Publish(const float* bands, int count);
+
+  // Whether a writer is currently running. Readers use this to decide if it
+  // is worth polling for further frames.
+  void SetPublishing(bool publishing);
+  bool publishing() const { return publishing_.load(std::memory_order_acquire); }
+
+  // Reader side. Copies the latest frame into |out|; false if nothing has
+  // been published yet or every attempt raced a write.
+  bool Read(SpectrumFrame* out) const;
+
+  uint64_t sequence() const;
+
+  // Reader registration, so the analyser can run for in-process consumers
+  // even when Dart has not asked for it. These and the demand callback are
+  // platform-thread only.
+  void AddReader();
+  void RemoveReader();
+  int readers() const { return readers_; }
+
+  // Called whenever the reader count changes.
+  using DemandCallback = std::function<void()>;
+  void SetDemandCallback(DemandCallback callback);
+
+ private:
+  // Even when stable, odd while a write is in progress. Frame N is complete
+  // once the counter reads 2 * N.
+  std::atomic<uint64_t> sequence_;
+  std::array<std::atomic<float>, kSpectrumBands> bands_;
+  std::atomic<bool> publishing_;
+
+  int readers_ = 0;
+  DemandCallback demand_callback_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_AUDIO_SPECTRUM_SLOT_H_
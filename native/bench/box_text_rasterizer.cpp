@@ -0,0 +1,59 @@
+#include "box_text_rasterizer.h"
+
+#include <cmath>
+
+#include "lyric/lyric_layout.h"
+
+namespace cyrene_music {
+
+// static
+float BoxTextRasterizer::Advance(char32_t cp, float font_size) {
+  if (cp == U' ') return font_size * 0.3f;
+  if (IsCJKCodepoint(cp)) return font_size;
+  return font_size * 0.55f;
+}
+
+float BoxTextRasterizer::MeasureText(const std::string& utf8,
+                                     const TextStyle& style) {
+  float width = 0.0f;
+  size_t pos = 0;
+  while (pos < utf8.size()) {
+    width += Advance(DecodeUtf8(utf8, &pos), style.font_size);
+  }
+  return width;
+}
+
+void BoxTextRasterizer::DrawText(ArgbSurface* target, const std::string& utf8,
+                                 const TextStyle& style, float x, float y,
+                                 float height) {
+  const int stroke = static_cast<int>(std::lround(style.stroke_width));
+  float pen_x = x;
+  size_t pos = 0;
+  while (pos < utf8.size()) {
+    const char32_t cp = DecodeUtf8(utf8, &pos);
+    const float advance = Advance(cp, style.font_size);
+    if (cp != U' ') {
+      // Glyph body: 80% of the advance wide, 70% of the em tall. Upright
+      // CJK in vertical mode swaps the proportions, like a rotated glyph.
+      float glyph_w = advance * 0.8f;
+      float glyph_h = style.font_size * 0.7f;
+      if (style.upright_cjk && IsCJKCodepoint(cp)) {
+        glyph_w = style.font_size * 0.7f;
+        glyph_h = advance * 0.8f;
+      }
+      const int left = static_cast<int>(pen_x + (advance - glyph_w) / 2);
+      const int top = static_cast<int>(y + (height - glyph_h) / 2);
+      const PixelRect body{left, top, left + static_cast<int>(glyph_w),
+                           top + static_cast<int>(glyph_h)};
+      if (stroke > 0) {
+        target->FillRect({body.left - stroke, body.top - stroke,
+                          body.right + stroke, body.bottom + stroke},
+                         style.stroke_color);
+      }
+      target->FillRect(body, style.fill_color);
+    }
+    pen_x += advance;
+  }
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,25 @@
+#ifndef NATIVE_BENCH_BOX_TEXT_RASTERIZER_H_
+#define NATIVE_BENCH_BOX_TEXT_RASTERIZER_H_
+
+#include "lyric/text_rasterizer.h"
+
+namespace cyrene_music {
+
+// Font-free TextRasterizer for headless runs. Every glyph is a stroked box
+// with a deterministic advance (full em for CJK, narrower for everything
+// else), so layout, caching and compositing costs can be measured without
+// a font stack.
+class BoxTextRasterizer : public TextRasterizer {
+ public:
+  float MeasureText(const std::string& utf8, const TextStyle& style) override;
+  void DrawText(ArgbSurface* target, const std::string& utf8,
+                const TextStyle& style, float x, float y,
+                float height) override;
+
+ private:
+  static float Advance(char32_t cp, float font_size);
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_BENCH_BOX_TEXT_RASTERIZER_H_
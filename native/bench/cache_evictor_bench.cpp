@@ -0,0 +1,278 @@
+// Measures cache eviction against a byte budget.
+//
+// Fills a cache directory and CacheIndex with synthetic songs, then
+// compares what shrinking it costs the caller: removing victims one index
+// append and one unlink at a time on the calling thread, against
+// CacheEvictor, which drops them from the index in one append and unlinks
+// the batch in the background. Checks that LRU and LFU pick the expected
+// victims, that recently used songs survive, that the evicted files are
+// gone, that a song cached again before the background unlink ran is
+// kept, that a file which cannot be moved aside keeps its index entry, and
+// that hit counts survive a reopen and compaction.
+//
+// Usage: cache_evictor_bench [songs]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cache/cache_evictor.h"
+#include "cache/cache_index.h"
+
+namespace {
+
+using cyrene_music::CacheEvictor;
+using cyrene_music::CacheIndex;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+constexpr uint64_t kSongBytes = 8 * 1024 * 1024;
+constexpr int64_t kHourMs = 60 * 60 * 1000;
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+std::string Key(size_t i) { return "netease_" + std::to_string(100000 + i); }
+
+// Song i was last played i hours after the epoch and i % 7 times, so LRU
+// and LFU rank the songs differently. The files themselves are small; the
+// index carries the claimed size.
+bool Fill(const fs::path& directory, const fs::path& log, size_t songs,
+          CacheIndex* index) {
+  std::error_code error;
+  fs::remove_all(directory, error);
+  fs::create_directories(directory, error);
+  if (!index->Open(log.string())) return false;
+  for (size_t i = 0; i < songs; ++i) {
+    std::ofstream(directory / (Key(i) + ".cyrene"), std::ios::binary)
+        << std::string(4096, 'a');
+    const int64_t played = static_cast<int64_t>(i) * kHourMs;
+    if (!index->Put(Key(i), kSongBytes, "{\"songId\":\"1\"}", played)) {
+      return false;
+    }
+    for (size_t hit = 0; hit < i % 7; ++hit) index->Touch(Key(i), played);
+  }
+  return true;
+}
+
+size_t CountFiles(const fs::path& directory) {
+  std::error_code error;
+  size_t count = 0;
+  for (const auto& entry : fs::directory_iterator(directory, error)) {
+    if (entry.path().extension() == ".cyrene") ++count;
+  }
+  return count;
+}
+
+uint64_t TotalBytes(const CacheIndex& index) {
+  uint64_t total = 0;
+  for (const auto& [key, entry] : index.entries()) total += entry.file_size;
+  return total;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t songs =
+      argc > 1 ? static_cast<size_t>(std::max(10, std::atoi(argv[1]))) : 4000;
+  bool ok = true;
+
+  std::error_code error;
+  const fs::path directory =
+      fs::temp_directory_path(error) / "cache_evictor_bench";
+  const fs::path log = directory / "cache_index.log";
+  // Half the songs fit; the low watermark takes a little more.
+  const uint64_t budget = songs / 2 * kSongBytes;
+  const int64_t now = static_cast<int64_t>(songs) * kHourMs;
+
+  // Baseline: one Remove and one unlink per victim, all on this thread.
+  {
+    CacheIndex index;
+    if (!Fill(directory, log, songs, &index)) {
+      std::printf("FAIL: fill\n");
+      return 1;
+    }
+    const Clock::time_point start = Clock::now();
+    const std::vector<std::string> victims = CacheEvictor::SelectVictims(
+        index.entries(), TotalBytes(index),
+        budget / 100 * CacheEvictor::kLowWatermarkPercent,
+        CacheEvictor::Policy::kLru, now);
+    for (const std::string& key : victims) {
+      index.Remove(key);
+      fs::remove(directory / (key + ".cyrene"), error);
+    }
+    std::printf("one by one: %zu victims, caller blocked %.2f ms\n",
+                victims.size(), Milliseconds(Clock::now() - start));
+  }
+
+  // CacheEvictor, LRU.
+  {
+    CacheIndex index;
+    if (!Fill(directory, log, songs, &index)) {
+      std::printf("FAIL: fill\n");
+      return 1;
+    }
+    CacheEvictor evictor;
+    evictor.Configure(directory.string(), budget, CacheEvictor::Policy::kLru);
+    const Clock::time_point start = Clock::now();
+    const std::vector<std::string> victims = evictor.Enforce(&index, now);
+    const double enforce_ms = Milliseconds(Clock::now() - start);
+    // The first victim is played again and re-cached straight away.
+    const fs::path recached = directory / (Key(0) + ".cyrene");
+    std::ofstream(recached, std::ios::binary) << std::string(4096, 'b');
+    evictor.Flush();
+    const double flush_ms = Milliseconds(Clock::now() - start);
+    std::printf("evictor: %zu victims, caller blocked %.2f ms, "
+                "unlinked after %.2f ms\n",
+                victims.size(), enforce_ms, flush_ms);
+    if (!fs::exists(recached, error)) {
+      std::printf("FAIL: the background unlink deleted a re-cached song\n");
+      ok = false;
+    }
+    fs::remove(recached, error);
+    for (const auto& entry : fs::directory_iterator(directory, error)) {
+      if (entry.path().extension() == ".evicted") {
+        std::printf("FAIL: tombstone %s left behind\n",
+                    entry.path().filename().string().c_str());
+        ok = false;
+        break;
+      }
+    }
+
+    const uint64_t low = budget / 100 * CacheEvictor::kLowWatermarkPercent;
+    if (TotalBytes(index) > low || TotalBytes(index) + kSongBytes <= low) {
+      std::printf("FAIL: lru left %llu bytes for a watermark of %llu\n",
+                  static_cast<unsigned long long>(TotalBytes(index)),
+                  static_cast<unsigned long long>(low));
+      ok = false;
+    }
+    // The oldest songs go first.
+    for (size_t i = 0; i < victims.size(); ++i) {
+      if (victims[i] != Key(i)) {
+        std::printf("FAIL: lru victim %zu is %s\n", i, victims[i].c_str());
+        ok = false;
+        break;
+      }
+    }
+    if (CountFiles(directory) != index.entries().size()) {
+      std::printf("FAIL: %zu files left for %zu entries\n",
+                  CountFiles(directory), index.entries().size());
+      ok = false;
+    }
+    const CacheEvictor::Metrics& metrics = evictor.metrics();
+    if (metrics.evictions != victims.size() ||
+        metrics.evicted_bytes != victims.size() * kSongBytes) {
+      std::printf("FAIL: metrics %llu evictions, %llu bytes\n",
+                  static_cast<unsigned long long>(metrics.evictions),
+                  static_cast<unsigned long long>(metrics.evicted_bytes));
+      ok = false;
+    }
+    // Within budget now: nothing more to do.
+    if (!evictor.Enforce(&index, now).empty()) {
+      std::printf("FAIL: second enforce evicted again\n");
+      ok = false;
+    }
+
+    // The removals and hit counts survive a reopen and a compaction.
+    const size_t kept = index.entries().size();
+    index.Close();
+    if (!index.Open(log.string()) || index.entries().size() != kept ||
+        !index.Compact() || index.entries().size() != kept) {
+      std::printf("FAIL: reopen after eviction\n");
+      ok = false;
+    }
+    index.Close();
+    index.Open(log.string());
+    for (size_t i = songs - kept; i < songs; ++i) {
+      const CacheIndex::Entry* entry = index.Find(Key(i));
+      if (entry == nullptr || entry->hits != i % 7) {
+        std::printf("FAIL: %s hits %u after reopen, expected %zu\n",
+                    Key(i).c_str(), entry != nullptr ? entry->hits : 0,
+                    i % 7);
+        ok = false;
+        break;
+      }
+    }
+  }
+
+  // LFU: the least played go first, older first among equals.
+  {
+    CacheIndex index;
+    if (!Fill(directory, log, songs, &index)) {
+      std::printf("FAIL: fill\n");
+      return 1;
+    }
+    const std::vector<std::string> victims = CacheEvictor::SelectVictims(
+        index.entries(), TotalBytes(index), budget, CacheEvictor::Policy::kLfu,
+        now);
+    for (size_t i = 1; i < victims.size(); ++i) {
+      const CacheIndex::Entry* a = index.Find(victims[i - 1]);
+      const CacheIndex::Entry* b = index.Find(victims[i]);
+      if (a->hits > b->hits ||
+          (a->hits == b->hits && a->last_access_ms > b->last_access_ms)) {
+        std::printf("FAIL: lfu order at %zu\n", i);
+        ok = false;
+        break;
+      }
+    }
+
+    // A song just played is kept even if it is the least used and the
+    // budget cannot be met otherwise.
+    index.Put(Key(songs), kSongBytes, "{}", now);
+    const std::vector<std::string> everything = CacheEvictor::SelectVictims(
+        index.entries(), TotalBytes(index), 0, CacheEvictor::Policy::kLfu,
+        now);
+    if (everything.size() != index.entries().size() ||
+        everything.back() != Key(songs)) {
+      std::printf("FAIL: recent song not evicted last\n");
+      ok = false;
+    }
+    index.Close();
+  }
+
+  // A victim whose file cannot be moved aside (an open file on Windows;
+  // here a non-empty directory where its first tombstone would go) stays
+  // indexed and on disk, and one whose file is already gone is dropped.
+  {
+    CacheIndex index;
+    if (!Fill(directory, log, songs, &index)) {
+      std::printf("FAIL: fill\n");
+      return 1;
+    }
+    const fs::path stuck = directory / (Key(0) + ".cyrene");
+    fs::create_directories(directory / (Key(0) + ".cyrene.1.evicted/x"),
+                           error);
+    fs::remove(directory / (Key(1) + ".cyrene"), error);
+    CacheEvictor evictor;
+    evictor.Configure(directory.string(), budget, CacheEvictor::Policy::kLru);
+    const std::vector<std::string> victims = evictor.Enforce(&index, now);
+    evictor.Flush();
+    if (std::find(victims.begin(), victims.end(), Key(0)) != victims.end() ||
+        index.Find(Key(0)) == nullptr || !fs::exists(stuck, error)) {
+      std::printf("FAIL: an unmovable victim left the index\n");
+      ok = false;
+    }
+    if (std::find(victims.begin(), victims.end(), Key(1)) == victims.end() ||
+        index.Find(Key(1)) != nullptr) {
+      std::printf("FAIL: a victim without a file stayed indexed\n");
+      ok = false;
+    }
+    if (CountFiles(directory) != index.entries().size()) {
+      std::printf("FAIL: %zu files for %zu entries after a stuck rename\n",
+                  CountFiles(directory), index.entries().size());
+      ok = false;
+    }
+    index.Close();
+  }
+
+  fs::remove_all(directory, error);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
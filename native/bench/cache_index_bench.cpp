@@ -0,0 +1,181 @@
+// Measures the cache index against rewriting the whole index per change.
+//
+// Fills a CacheIndex with synthetic song metadata and compares one change
+// (an append) with what CacheService used to do for every change at the
+// same size: serialise all entries, encrypt and rewrite the file. Then
+// checks the index against a reference map across reopen, a torn final
+// record, removals and touches, and compaction.
+//
+// Usage: cache_index_bench [entries]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cache/cache_index.h"
+#include "cache/cyrene_cache_file.h"
+
+namespace {
+
+using cyrene_music::CacheIndex;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+double Microseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+struct Expected {
+  uint64_t file_size;
+  int64_t last_access_ms;
+  std::string metadata;
+};
+
+std::string Key(size_t i) { return "netease_" + std::to_string(100000 + i); }
+
+// Roughly what CacheMetadata.toJson produces, lyrics included.
+std::string Metadata(size_t i) {
+  return "{\"songId\":\"" + std::to_string(100000 + i) +
+         "\",\"songName\":\"Song " + std::to_string(i) +
+         "\",\"lyric\":\"" + std::string(600 + i % 900, 'x') + "\"}";
+}
+
+bool Matches(const CacheIndex& index,
+             const std::map<std::string, Expected>& expected,
+             const char* stage) {
+  if (index.entries().size() != expected.size()) {
+    std::printf("FAIL: %s: %zu entries, expected %zu\n", stage,
+                index.entries().size(), expected.size());
+    return false;
+  }
+  std::string metadata;
+  for (const auto& [key, want] : expected) {
+    const CacheIndex::Entry* entry = index.Find(key);
+    if (entry == nullptr || entry->file_size != want.file_size ||
+        entry->last_access_ms != want.last_access_ms ||
+        !index.ReadMetadata(key, &metadata) || metadata != want.metadata) {
+      std::printf("FAIL: %s: entry %s differs\n", stage, key.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t count =
+      argc > 1 ? static_cast<size_t>(std::max(10, std::atoi(argv[1]))) : 20000;
+  bool ok = true;
+
+  std::error_code error;
+  const fs::path directory = fs::temp_directory_path(error);
+  const std::string path = (directory / "cache_index_bench.log").string();
+  const std::string whole_path = (directory / "cache_index_bench.json").string();
+  fs::remove(path, error);
+
+  std::map<std::string, Expected> expected;
+  CacheIndex index;
+  if (!index.Open(path)) {
+    std::printf("FAIL: open\n");
+    return 1;
+  }
+  const Clock::time_point fill_start = Clock::now();
+  for (size_t i = 0; i < count; ++i) {
+    const Expected entry{1000000 + i, static_cast<int64_t>(i), Metadata(i)};
+    if (!index.Put(Key(i), entry.file_size, entry.metadata,
+                   entry.last_access_ms)) {
+      std::printf("FAIL: put %zu\n", i);
+      return 1;
+    }
+    expected[Key(i)] = entry;
+  }
+  const double append_us = Microseconds(Clock::now() - fill_start) / count;
+
+  // The old save: every entry serialised and the file rewritten.
+  const Clock::time_point rewrite_start = Clock::now();
+  const int kRewrites = 5;
+  for (int r = 0; r < kRewrites; ++r) {
+    std::string json = "{";
+    for (const auto& [key, entry] : expected) {
+      json += "\"" + key + "\":" + entry.metadata + ",";
+    }
+    json.back() = '}';
+    std::vector<uint8_t> bytes(json.begin(), json.end());
+    cyrene_music::CyreneXor(bytes.data(), bytes.data(), bytes.size(), 0);
+    std::ofstream out(whole_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()),
+              static_cast<std::streamsize>(bytes.size()));
+  }
+  const double rewrite_us = Microseconds(Clock::now() - rewrite_start) / kRewrites;
+  std::printf("%zu entries: append %.1f us per change, whole rewrite %.0f us\n",
+              count, append_us, rewrite_us);
+
+  index.Close();
+  const Clock::time_point open_start = Clock::now();
+  index.Open(path);
+  std::printf("reopen: %.1f ms for a %.1f MB log\n",
+              Microseconds(Clock::now() - open_start) / 1000.0,
+              index.log_size() / (1024.0 * 1024.0));
+  ok &= Matches(index, expected, "reopen");
+
+  // A record cut short by a crash is dropped, and appends continue after
+  // the last good one.
+  const uint64_t good_size = index.log_size();
+  index.Put("torn", 1, Metadata(1), 1);
+  index.Close();
+  fs::resize_file(path, good_size + 20, error);
+  index.Open(path);
+  ok &= Matches(index, expected, "torn tail");
+  if (index.log_size() != good_size) {
+    std::printf("FAIL: torn tail not truncated\n");
+    ok = false;
+  }
+
+  // Churn: remove every other entry, touch the rest.
+  for (size_t i = 0; i < count; ++i) {
+    if (i % 2 == 0) {
+      index.Remove(Key(i));
+      expected.erase(Key(i));
+    } else {
+      index.Touch(Key(i), static_cast<int64_t>(count + i));
+      expected[Key(i)].last_access_ms = static_cast<int64_t>(count + i);
+    }
+  }
+  if (index.Touch("missing", 0)) {
+    std::printf("FAIL: touch of a missing key\n");
+    ok = false;
+  }
+  ok &= Matches(index, expected, "churn");
+  // Half the puts are dead now, so the log has been compacted.
+  if (index.log_size() > 2 * index.live_bytes() + 4096) {
+    std::printf("FAIL: not compacted (%llu of %llu bytes live)\n",
+                static_cast<unsigned long long>(index.live_bytes()),
+                static_cast<unsigned long long>(index.log_size()));
+    ok = false;
+  }
+  index.Close();
+  index.Open(path);
+  ok &= Matches(index, expected, "after compaction");
+
+  index.Clear();
+  index.Close();
+  index.Open(path);
+  if (!index.entries().empty()) {
+    std::printf("FAIL: clear\n");
+    ok = false;
+  }
+  index.Close();
+
+  fs::remove(path, error);
+  fs::remove(whole_path, error);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
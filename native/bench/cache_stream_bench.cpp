@@ -0,0 +1,253 @@
+// Measures playback start from a .cyrene cache file.
+//
+// Writes a synthetic cached song (metadata header + XOR-encrypted audio)
+// to the temp directory, then compares the old path, where the whole file
+// is read, decrypted a byte at a time and written to a plaintext temp copy
+// before the player can open it, with CacheStreamServer, where the player
+// issues a range request and gets its first block straight away. Also
+// checks full, ranged, suffix, HEAD and out-of-range requests against the
+// plaintext and reports XOR throughput.
+//
+// Usage: cache_stream_bench [megabytes]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cache/cache_stream_server.h"
+#include "cache/cyrene_cache_file.h"
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using cyrene_music::CacheStreamServer;
+using cyrene_music::kCyreneCacheKey;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+void CloseSocket(SocketHandle s) { closesocket(s); }
+#else
+using SocketHandle = int;
+void CloseSocket(SocketHandle s) { close(s); }
+#endif
+
+struct Response {
+  int status = 0;
+  std::string head;
+  std::vector<uint8_t> body;
+  double first_body_ms = 0;  // from connect to the first body byte
+};
+
+// One request on a fresh connection, read until the server closes it.
+bool Fetch(uint16_t port, const std::string& url, const char* method,
+           const std::string& range, Response* response) {
+  const std::string target = url.substr(url.find('/', 7));
+  const Clock::time_point start = Clock::now();
+  const SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(s, reinterpret_cast<const sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    CloseSocket(s);
+    return false;
+  }
+  std::string request = std::string(method) + " " + target +
+                        " HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n";
+  if (!range.empty()) request += "Range: " + range + "\r\n";
+  request += "\r\n";
+  send(s, request.data(), static_cast<int>(request.size()), 0);
+
+  std::vector<char> received;
+  size_t head_end = std::string::npos;
+  char chunk[64 * 1024];
+  for (;;) {
+    const auto n = recv(s, chunk, sizeof(chunk), 0);
+    if (n <= 0) break;
+    received.insert(received.end(), chunk, chunk + n);
+    if (head_end == std::string::npos) {
+      const std::string so_far(received.begin(), received.end());
+      head_end = so_far.find("\r\n\r\n");
+      if (head_end != std::string::npos && received.size() > head_end + 4) {
+        response->first_body_ms = Milliseconds(Clock::now() - start);
+      }
+    } else if (response->first_body_ms == 0) {
+      response->first_body_ms = Milliseconds(Clock::now() - start);
+    }
+  }
+  CloseSocket(s);
+  if (head_end == std::string::npos) return false;
+  response->head.assign(received.begin(), received.begin() + head_end);
+  response->body.assign(received.begin() + head_end + 4, received.end());
+  response->status = std::atoi(response->head.c_str() + 9);
+  return true;
+}
+
+// The old player path in native form: read everything, XOR byte by byte,
+// write a plaintext copy.
+double DecryptToTempFile(const fs::path& cache_file, const fs::path& temp) {
+  const Clock::time_point start = Clock::now();
+  std::ifstream in(cache_file, std::ios::binary);
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+  const size_t metadata_length = (size_t{data[0]} << 24) |
+                                 (size_t{data[1]} << 16) |
+                                 (size_t{data[2]} << 8) | size_t{data[3]};
+  std::vector<uint8_t> audio(data.begin() + 4 + metadata_length, data.end());
+  for (size_t i = 0; i < audio.size(); ++i) {
+    audio[i] ^= static_cast<uint8_t>(kCyreneCacheKey[i % kCyreneCacheKey.size()]);
+  }
+  std::ofstream out(temp, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(audio.data()),
+            static_cast<std::streamsize>(audio.size()));
+  out.close();
+  return Milliseconds(Clock::now() - start);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t megabytes =
+      argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 40;
+  bool ok = true;
+
+  // Lossless-sized audio that does not compress in the page cache.
+  std::vector<uint8_t> plain(megabytes * 1024 * 1024 + 12345);
+  std::mt19937 random(7);
+  for (uint8_t& byte : plain) byte = static_cast<uint8_t>(random());
+
+  // XOR: vectorised path against the byte loop, at every key phase.
+  for (uint64_t phase = 0; phase < kCyreneCacheKey.size() * 2; ++phase) {
+    std::vector<uint8_t> fast(1000);
+    cyrene_music::CyreneXor(plain.data(), fast.data(), fast.size(), phase);
+    for (size_t i = 0; i < fast.size(); ++i) {
+      const uint8_t expected = plain[i] ^ static_cast<uint8_t>(
+          kCyreneCacheKey[(phase + i) % kCyreneCacheKey.size()]);
+      if (fast[i] != expected) {
+        std::printf("FAIL: xor mismatch at phase %llu byte %zu\n",
+                    static_cast<unsigned long long>(phase), i);
+        ok = false;
+        break;
+      }
+    }
+  }
+  std::vector<uint8_t> encrypted(plain.size());
+  const Clock::time_point xor_start = Clock::now();
+  cyrene_music::CyreneXor(plain.data(), encrypted.data(), plain.size(), 0);
+  const double xor_ms = Milliseconds(Clock::now() - xor_start);
+  std::printf("xor: %.0f MB/s\n",
+              plain.size() / (1024.0 * 1024.0) / (xor_ms / 1000.0));
+
+  std::error_code error;
+  const fs::path directory = fs::temp_directory_path(error);
+  const fs::path cache_file = directory / "cache_stream_bench.cyrene";
+  const fs::path temp_file = directory / "cache_stream_bench.flac";
+  {
+    const std::string metadata = R"({"songId":"1","quality":"lossless"})";
+    const uint32_t length = static_cast<uint32_t>(metadata.size());
+    const uint8_t header[4] = {
+        static_cast<uint8_t>(length >> 24), static_cast<uint8_t>(length >> 16),
+        static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length)};
+    std::ofstream out(cache_file, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(header), sizeof(header));
+    out.write(metadata.data(), static_cast<std::streamsize>(metadata.size()));
+    out.write(reinterpret_cast<const char*>(encrypted.data()),
+              static_cast<std::streamsize>(encrypted.size()));
+  }
+
+  const double temp_ms = DecryptToTempFile(cache_file, temp_file);
+  std::printf("temp copy: playable after %.1f ms (%zu MB)\n", temp_ms,
+              megabytes);
+
+  CacheStreamServer& server = CacheStreamServer::Shared();
+  const Clock::time_point open_start = Clock::now();
+  const std::string url = server.Open(cache_file.string(), "flac");
+  const double open_ms = Milliseconds(Clock::now() - open_start);
+  if (url.empty()) {
+    std::printf("FAIL: open\n");
+    return 1;
+  }
+
+  Response full;
+  if (!Fetch(server.port(), url, "GET", "", &full) || full.status != 200 ||
+      full.body != plain) {
+    std::printf("FAIL: full body (status %d, %zu bytes)\n", full.status,
+                full.body.size());
+    ok = false;
+  }
+  Response first;
+  Fetch(server.port(), url, "GET", "bytes=0-", &first);
+  std::printf("stream: open %.2f ms, first block after %.2f ms\n", open_ms,
+              open_ms + first.first_body_ms);
+
+  struct RangeCase {
+    const char* method;
+    std::string range;
+    int status;
+    size_t begin;
+    size_t end;  // exclusive
+  };
+  const size_t size = plain.size();
+  const RangeCase cases[] = {
+      {"GET", "bytes=1000-1999", 206, 1000, 2000},
+      {"GET", "bytes=" + std::to_string(size - 10) + "-", 206, size - 10, size},
+      {"GET", "bytes=-77", 206, size - 77, size},
+      {"GET", "bytes=5-" + std::to_string(size * 2), 206, 5, size},
+      {"GET", "bytes=" + std::to_string(size) + "-", 416, 0, 0},
+      {"HEAD", "", 200, 0, 0},
+  };
+  for (const RangeCase& c : cases) {
+    Response response;
+    const bool fetched = Fetch(server.port(), url, c.method, c.range, &response);
+    const std::vector<uint8_t> expected(plain.begin() + c.begin,
+                                        plain.begin() + c.end);
+    if (!fetched || response.status != c.status || response.body != expected) {
+      std::printf("FAIL: %s %s -> %d, %zu bytes\n", c.method, c.range.c_str(),
+                  response.status, response.body.size());
+      ok = false;
+    }
+  }
+  Response missing;
+  if (!Fetch(server.port(), url.substr(0, url.rfind('/')) + "/nope.flac",
+             "GET", "", &missing) ||
+      missing.status != 404) {
+    std::printf("FAIL: unknown token -> %d\n", missing.status);
+    ok = false;
+  }
+  server.Close(url);
+  Response closed;
+  if (!Fetch(server.port(), url, "GET", "", &closed) || closed.status != 404) {
+    std::printf("FAIL: closed url -> %d\n", closed.status);
+    ok = false;
+  }
+  server.Stop();
+
+  fs::remove(cache_file, error);
+  fs::remove(temp_file, error);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
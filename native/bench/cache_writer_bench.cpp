@@ -0,0 +1,187 @@
+// Measures writing a downloaded song into the .cyrene cache.
+//
+// Compares the old ingestion, which holds the whole download, makes an
+// encrypted copy and a header-prefixed third copy before one big write,
+// with CyreneCacheWriter fed 64 KiB chunks as they would arrive from the
+// network. Checks the MD5 against known vectors and against a one-shot
+// hash, reads the committed file back through CyreneCacheFile, and checks
+// that a failed commit leaves neither the target nor the partial file.
+//
+// Usage: cache_writer_bench [megabytes]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "cache/cyrene_cache_file.h"
+#include "cache/cyrene_cache_writer.h"
+#include "cache/md5.h"
+
+namespace {
+
+using cyrene_music::CyreneCacheFile;
+using cyrene_music::CyreneCacheWriter;
+using cyrene_music::Md5;
+using Clock = std::chrono::steady_clock;
+namespace fs = std::filesystem;
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+std::string HashOf(const std::string& text) {
+  Md5 md5;
+  md5.Update(reinterpret_cast<const uint8_t*>(text.data()), text.size());
+  return md5.FinishHex();
+}
+
+// The old path in native form: three full-size buffers, one write.
+double WriteWholeFile(const std::vector<uint8_t>& audio, const fs::path& path) {
+  const Clock::time_point start = Clock::now();
+  Md5 md5;
+  md5.Update(audio.data(), audio.size());
+  const std::string metadata = "{\"checksum\":\"" + md5.FinishHex() + "\"}";
+  std::vector<uint8_t> encrypted(audio.size());
+  for (size_t i = 0; i < audio.size(); ++i) {
+    encrypted[i] = audio[i] ^ static_cast<uint8_t>(
+        cyrene_music::kCyreneCacheKey[i % cyrene_music::kCyreneCacheKey.size()]);
+  }
+  std::vector<uint8_t> file;
+  const uint32_t length = static_cast<uint32_t>(metadata.size());
+  file.push_back(static_cast<uint8_t>(length >> 24));
+  file.push_back(static_cast<uint8_t>(length >> 16));
+  file.push_back(static_cast<uint8_t>(length >> 8));
+  file.push_back(static_cast<uint8_t>(length));
+  file.insert(file.end(), metadata.begin(), metadata.end());
+  file.insert(file.end(), encrypted.begin(), encrypted.end());
+  std::ofstream out(path, std::ios::binary);
+  out.write(reinterpret_cast<const char*>(file.data()),
+            static_cast<std::streamsize>(file.size()));
+  out.close();
+  return Milliseconds(Clock::now() - start);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t megabytes =
+      argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 40;
+  bool ok = true;
+
+  // RFC 1321 test suite.
+  const std::pair<const char*, const char*> vectors[] = {
+      {"", "d41d8cd98f00b204e9800998ecf8427e"},
+      {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+      {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+      {"12345678901234567890123456789012345678901234567890123456789012345678"
+       "901234567890",
+       "57edf4a22be3c955ac49da2e2107b67a"},
+  };
+  for (const auto& vector : vectors) {
+    if (HashOf(vector.first) != vector.second) {
+      std::printf("FAIL: md5(\"%s\")\n", vector.first);
+      ok = false;
+    }
+  }
+
+  std::vector<uint8_t> audio(megabytes * 1024 * 1024 + 4321);
+  std::mt19937 random(11);
+  for (uint8_t& byte : audio) byte = static_cast<uint8_t>(random());
+  Md5 one_shot;
+  one_shot.Update(audio.data(), audio.size());
+  const std::string expected_checksum = one_shot.FinishHex();
+
+  std::error_code error;
+  const fs::path directory = fs::temp_directory_path(error);
+  const fs::path whole_path = directory / "cache_writer_bench_whole.cyrene";
+  const fs::path path = directory / "cache_writer_bench.cyrene";
+
+  const double whole_ms = WriteWholeFile(audio, whole_path);
+  std::printf("whole file: %.1f ms, %zu MB held as 3 copies\n", whole_ms,
+              megabytes);
+
+  // Chunk sizes that do not line up with the key, the hash block or the
+  // write buffer.
+  const size_t kChunk = 64 * 1024 + 7;
+  const Clock::time_point start = Clock::now();
+  CyreneCacheWriter writer;
+  const std::string provisional =
+      R"({"checksum":"00000000000000000000000000000000","fileSize":0})";
+  if (!writer.Begin(path.string(), provisional.size() + 64)) {
+    std::printf("FAIL: begin\n");
+    return 1;
+  }
+  for (size_t offset = 0; offset < audio.size(); offset += kChunk) {
+    const size_t n = std::min(kChunk, audio.size() - offset);
+    if (!writer.Write(audio.data() + offset, n)) {
+      std::printf("FAIL: write at %zu\n", offset);
+      ok = false;
+      break;
+    }
+  }
+  const std::string checksum = writer.Digest();
+  const std::string metadata = "{\"checksum\":\"" + checksum +
+                               "\",\"fileSize\":" +
+                               std::to_string(writer.audio_size()) + "}";
+  if (!writer.Commit(metadata)) {
+    std::printf("FAIL: commit\n");
+    ok = false;
+  }
+  const double stream_ms = Milliseconds(Clock::now() - start);
+  std::printf("streamed: %.1f ms, %zu KiB buffer\n", stream_ms,
+              CyreneCacheWriter::kBufferSize / 1024);
+
+  if (checksum != expected_checksum) {
+    std::printf("FAIL: checksum %s, expected %s\n", checksum.c_str(),
+                expected_checksum.c_str());
+    ok = false;
+  }
+  if (fs::exists(path.string() + ".tmp", error)) {
+    std::printf("FAIL: partial file left after commit\n");
+    ok = false;
+  }
+
+  CyreneCacheFile file;
+  if (!file.Open(path.string()) || file.audio_size() != audio.size()) {
+    std::printf("FAIL: committed file does not open\n");
+    ok = false;
+  } else {
+    const std::string_view stored = file.metadata();
+    if (stored.substr(0, metadata.size()) != metadata ||
+        stored.find_first_not_of(' ', metadata.size()) !=
+            std::string_view::npos) {
+      std::printf("FAIL: metadata not padded in place\n");
+      ok = false;
+    }
+    std::vector<uint8_t> read_back(audio.size());
+    file.Read(0, read_back.data(), read_back.size());
+    if (read_back != audio) {
+      std::printf("FAIL: audio differs after read-back\n");
+      ok = false;
+    }
+  }
+
+  // Metadata over the reserve: nothing is left behind, and the committed
+  // file is untouched.
+  CyreneCacheWriter overflow;
+  overflow.Begin(path.string(), 8);
+  overflow.Write(audio.data(), 1000);
+  if (overflow.Commit(metadata) ||
+      fs::exists(path.string() + ".tmp", error) ||
+      fs::file_size(path, error) != 4 + provisional.size() + 64 + audio.size()) {
+    std::printf("FAIL: oversized metadata\n");
+    ok = false;
+  }
+
+  fs::remove(path, error);
+  fs::remove(whole_path, error);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
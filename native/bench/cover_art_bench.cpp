@@ -0,0 +1,283 @@
+// Benchmark for the cover-art cache.
+//
+// Puts a set of synthetic covers (a stand-in decoder renders a 1000x1000
+// gradient, roughly the size of a streaming service's album art) and then
+// looks them up from memory and, after dropping the memory cache, from the
+// disk cache. Reloaded covers are compared against the originals and the
+// budgets are checked, so a broken cache fails the run rather than just
+// looking fast. Before that, DownscaleSquare and EncodeBmp are checked on
+// small images whose output is known: crop, size, box averaging of
+// premultiplied pixels, and the BMP header and unpremultiplied pixels.
+//
+// Usage: cover_art_bench [covers]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "cover/cover_art_cache.h"
+
+namespace {
+
+using cyrene_music::ArgbSurface;
+using cyrene_music::CoverArt;
+using cyrene_music::CoverArtCache;
+using cyrene_music::CoverArtCacheOptions;
+
+constexpr int kSourceSize = 1000;
+
+// "Encoded" data is just a seed; decoding renders a gradient from it.
+class GradientDecoder : public cyrene_music::ImageDecoder {
+ public:
+  bool Decode(const uint8_t* data, size_t size, ArgbSurface* out) override {
+    if (size < sizeof(uint32_t)) return false;
+    uint32_t seed = 0;
+    std::memcpy(&seed, data, sizeof(seed));
+    ArgbSurface surface(kSourceSize, kSourceSize);
+    for (int y = 0; y < kSourceSize; ++y) {
+      uint32_t* row = surface.row(y);
+      for (int x = 0; x < kSourceSize; ++x) {
+        const uint32_t r = (x + seed) & 0xFF;
+        const uint32_t g = (y + seed * 3) & 0xFF;
+        const uint32_t b = (x + y + seed * 7) & 0xFF;
+        row[x] = 0xFF000000u | (r << 16) | (g << 8) | b;
+      }
+    }
+    *out = std::move(surface);
+    return true;
+  }
+};
+
+std::string KeyFor(int i) {
+  return "https://example.invalid/album/" + std::to_string(i) + ".jpg";
+}
+
+bool SameSurface(const ArgbSurface& a, const ArgbSurface& b) {
+  if (a.width() != b.width() || a.height() != b.height()) return false;
+  for (int y = 0; y < a.height(); ++y) {
+    if (std::memcmp(a.row(y), b.row(y), static_cast<size_t>(a.width()) * 4)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int g_failures = 0;
+
+void Check(bool condition, const char* what) {
+  if (!condition) {
+    std::fprintf(stderr, "FAIL: %s\n", what);
+    ++g_failures;
+  }
+}
+
+ArgbSurface Solid(int width, int height, uint32_t pixel) {
+  ArgbSurface surface(width, height);
+  surface.Clear(pixel);
+  return surface;
+}
+
+bool AllPixels(const ArgbSurface& surface, uint32_t pixel) {
+  for (int y = 0; y < surface.height(); ++y) {
+    for (int x = 0; x < surface.width(); ++x) {
+      if (surface.row(y)[x] != pixel) return false;
+    }
+  }
+  return true;
+}
+
+uint32_t ReadLe32(const std::vector<uint8_t>& bytes, size_t offset) {
+  return bytes[offset] | (bytes[offset + 1] << 8) |
+         (bytes[offset + 2] << 16) | (static_cast<uint32_t>(bytes[offset + 3])
+                                      << 24);
+}
+
+void CheckDownscale() {
+  using cyrene_music::DownscaleSquare;
+
+  const ArgbSurface solid =
+      DownscaleSquare(Solid(300, 200, 0xFF336699), 50);
+  Check(solid.width() == 50 && solid.height() == 50 &&
+            AllPixels(solid, 0xFF336699),
+        "downscale keeps a solid colour");
+
+  // Red | blue | red thirds: the centre crop is all blue.
+  ArgbSurface thirds = Solid(300, 100, 0xFFFF0000);
+  for (int y = 0; y < 100; ++y) {
+    for (int x = 100; x < 200; ++x) thirds.row(y)[x] = 0xFF0000FF;
+  }
+  const ArgbSurface cropped = DownscaleSquare(thirds, 10);
+  Check(cropped.width() == 10 && AllPixels(cropped, 0xFF0000FF),
+        "downscale crops to the centre square");
+
+  const ArgbSurface small = DownscaleSquare(Solid(40, 30, 0xFF000000), 50);
+  Check(small.width() == 30 && small.height() == 30,
+        "downscale never upscales");
+
+  // Opaque black, opaque white and two transparent pixels average to a
+  // quarter-white at half alpha, premultiplied.
+  ArgbSurface quad(2, 2);
+  quad.row(0)[0] = 0xFF000000;
+  quad.row(0)[1] = 0xFFFFFFFF;
+  const ArgbSurface averaged = DownscaleSquare(quad, 1);
+  Check(averaged.width() == 1 && averaged.row(0)[0] == 0x7F3F3F3F,
+        "downscale box-averages premultiplied pixels");
+
+  Check(DownscaleSquare(ArgbSurface(), 50).empty() &&
+            DownscaleSquare(quad, 0).empty(),
+        "downscale of nothing");
+}
+
+void CheckBmp() {
+  ArgbSurface surface(2, 1);
+  surface.row(0)[0] = 0xFF102030;
+  surface.row(0)[1] = 0x80402010;  // half alpha, premultiplied
+  const std::vector<uint8_t> bmp = cyrene_music::EncodeBmp(surface);
+  Check(bmp.size() == 54 + 8 && bmp[0] == 'B' && bmp[1] == 'M' &&
+            ReadLe32(bmp, 2) == bmp.size() && ReadLe32(bmp, 10) == 54,
+        "bmp file header");
+  Check(ReadLe32(bmp, 18) == 2 && ReadLe32(bmp, 22) == 0xFFFFFFFFu &&
+            bmp[28] == 32,
+        "bmp top-down 32-bit info header");
+  const uint8_t pixels[] = {0x30, 0x20, 0x10, 0xFF, 0x1F, 0x3F, 0x7F, 0x80};
+  Check(bmp.size() >= 62 && std::memcmp(&bmp[54], pixels, 8) == 0,
+        "bmp pixels are BGRA with straight alpha");
+  Check(cyrene_music::EncodeBmp(ArgbSurface()).empty(), "bmp of nothing");
+}
+
+double Ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int covers = 32;
+  if (argc > 1) {
+    covers = std::atoi(argv[1]);
+    if (covers <= 0) {
+      std::fprintf(stderr, "usage: %s [covers]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  CheckDownscale();
+  CheckBmp();
+
+  std::error_code error;
+  const std::filesystem::path directory =
+      std::filesystem::temp_directory_path(error) / "cyrene_cover_art_bench";
+  std::filesystem::remove_all(directory, error);
+
+  GradientDecoder decoder;
+  CoverArtCacheOptions options;
+  options.disk_directory = directory.u8string();
+  CoverArtCache cache;
+  cache.Configure(&decoder, options);
+
+  std::vector<std::shared_ptr<const CoverArt>> originals;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < covers; ++i) {
+    const uint32_t seed = static_cast<uint32_t>(i);
+    originals.push_back(cache.Put(KeyFor(i),
+                                  reinterpret_cast<const uint8_t*>(&seed),
+                                  sizeof(seed)));
+    if (!originals.back()) {
+      std::fprintf(stderr, "put %d failed\n", i);
+      return 1;
+    }
+  }
+  const double put_ms = Ms(start);
+
+  // The stored variants are the decoded cover, downscaled.
+  {
+    GradientDecoder check_decoder;
+    const uint32_t seed = 0;
+    ArgbSurface decoded;
+    check_decoder.Decode(reinterpret_cast<const uint8_t*>(&seed),
+                         sizeof(seed), &decoded);
+    const CoverArt& art = *originals.front();
+    Check(art.thumbnail.width() == options.thumbnail_size &&
+              art.panel.width() == 50 && art.panel.height() == 50,
+          "put variant sizes");
+    Check(SameSurface(art.thumbnail, cyrene_music::DownscaleSquare(
+                                         decoded, options.thumbnail_size)) &&
+              SameSurface(art.panel,
+                          cyrene_music::DownscaleSquare(decoded, 50)),
+          "put variants match the decoded cover");
+    const uint8_t truncated[2] = {1, 2};
+    const uint64_t decodes = cache.decodes();
+    Check(!cache.Put("https://example.invalid/broken.jpg", truncated,
+                     sizeof(truncated)) &&
+              cache.decodes() == decodes,
+          "undecodable data is not stored");
+  }
+
+  // The last few covers fit the memory budget; time those.
+  const int hot = std::min(covers, 8);
+  constexpr int kHotRounds = 10000;
+  start = std::chrono::steady_clock::now();
+  for (int round = 0; round < kHotRounds; ++round) {
+    if (!cache.Find(KeyFor(covers - 1 - round % hot))) {
+      std::fprintf(stderr, "memory lookup missed\n");
+      return 1;
+    }
+  }
+  const double memory_ns = Ms(start) * 1e6 / kHotRounds;
+
+  cache.Clear();
+  int reloaded = 0;
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < covers; ++i) {
+    std::shared_ptr<const CoverArt> art = cache.Find(KeyFor(i));
+    if (!art) continue;
+    ++reloaded;
+    if (!SameSurface(art->thumbnail, originals[i]->thumbnail) ||
+        !SameSurface(art->panel, originals[i]->panel)) {
+      std::fprintf(stderr, "cover %d changed on disk\n", i);
+      return 1;
+    }
+  }
+  const double disk_ms = Ms(start);
+
+  start = std::chrono::steady_clock::now();
+  const std::vector<uint8_t> bmp =
+      cyrene_music::EncodeBmp(originals.back()->thumbnail);
+  const double bmp_us = Ms(start) * 1e3;
+
+  const bool within_budget =
+      cache.memory_bytes() <= options.memory_budget_bytes &&
+      cache.disk_bytes() <= options.disk_budget_bytes;
+
+  std::printf("covers                     %d (%dx%d source)\n", covers,
+              kSourceSize, kSourceSize);
+  std::printf("put (decode+scale+store)   %8.2f ms/cover\n", put_ms / covers);
+  std::printf("find, memory hit           %8.1f ns\n", memory_ns);
+  std::printf("find, disk hit             %8.2f ms/cover (%d of %d on disk)\n",
+              reloaded ? disk_ms / reloaded : 0.0, reloaded, covers);
+  std::printf("encode thumbnail bmp       %8.1f us (%zu bytes)\n", bmp_us,
+              bmp.size());
+  std::printf("memory                     %8zu KiB\n",
+              cache.memory_bytes() / 1024);
+  std::printf("disk                       %8zu KiB\n", cache.disk_bytes() / 1024);
+  std::printf("hits / misses / decodes    %llu / %llu / %llu\n",
+              static_cast<unsigned long long>(cache.hits()),
+              static_cast<unsigned long long>(cache.misses()),
+              static_cast<unsigned long long>(cache.decodes()));
+
+  std::filesystem::remove_all(directory, error);
+  if (!within_budget) {
+    std::fprintf(stderr, "cache exceeded its budget\n");
+    return 1;
+  }
+  return g_failures == 0 ? 0 : 1;
+}
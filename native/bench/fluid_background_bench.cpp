@@ -0,0 +1,392 @@
+// Benchmark for the fluid background renderer.
+//
+// Renders synthetic 1000x1000 covers with both profiles and compares each
+// against a reference. The reference runs the GPU pipeline's steps at its
+// full sizes (1000x1000 / 1280x720) with exact Gaussian kernels. It is box
+// filtered down to the profile's output size and must stay within a few
+// levels of FluidBackgroundRenderer's output, which renders small with
+// box-approximated blurs. Flat covers check the saturation and the veil
+// against values computed by hand. The worker round trip is timed through
+// the FFI entry point Dart uses.
+//
+// Usage: fluid_background_bench [covers]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#include "cover/fluid_background.h"
+#include "cover/palette_extractor.h"
+
+namespace {
+
+using cyrene_music::FluidBackgroundProfile;
+using cyrene_music::FluidBackgroundRenderer;
+
+constexpr int kSourceSize = 1000;
+
+uint32_t Next(uint32_t* state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+// Soft diagonal bands of a few colours, opaque.
+std::vector<uint8_t> RenderCover(uint32_t seed) {
+  std::vector<uint8_t> rgba(static_cast<size_t>(kSourceSize) * kSourceSize *
+                            4);
+  uint32_t state = seed * 2654435761u + 7;
+  int colors[3][3];
+  for (auto& color : colors) {
+    for (int& channel : color) channel = static_cast<int>(Next(&state) & 0xFF);
+  }
+  for (int y = 0; y < kSourceSize; ++y) {
+    for (int x = 0; x < kSourceSize; ++x) {
+      const int band = ((x + y) / 240 + static_cast<int>(seed)) % 3;
+      uint8_t* pixel = &rgba[(static_cast<size_t>(y) * kSourceSize + x) * 4];
+      for (int c = 0; c < 3; ++c) {
+        pixel[c] = static_cast<uint8_t>(colors[band][c]);
+      }
+      pixel[3] = 255;
+    }
+  }
+  return rgba;
+}
+
+std::vector<uint8_t> FlatCover(uint8_t r, uint8_t g, uint8_t b) {
+  std::vector<uint8_t> rgba(static_cast<size_t>(kSourceSize) * kSourceSize *
+                            4);
+  for (size_t i = 0; i < rgba.size(); i += 4) {
+    rgba[i] = r;
+    rgba[i + 1] = g;
+    rgba[i + 2] = b;
+    rgba[i + 3] = 255;
+  }
+  return rgba;
+}
+
+// ---- Reference: the GPU pipeline's steps at its own sizes. ----
+
+struct Buffer {
+  int width = 0;
+  int height = 0;
+  std::vector<float> pixels;  // premultiplied RGBA
+
+  float* at(int x, int y) {
+    return &pixels[(static_cast<size_t>(y) * width + x) * 4];
+  }
+  const float* at(int x, int y) const {
+    return &pixels[(static_cast<size_t>(y) * width + x) * 4];
+  }
+};
+
+void ExactBlur(Buffer* image, float sigma) {
+  const int radius = static_cast<int>(std::ceil(sigma * 3));
+  std::vector<float> kernel(2 * radius + 1);
+  float total = 0;
+  for (int i = -radius; i <= radius; ++i) {
+    kernel[i + radius] = std::exp(-0.5f * i * i / (sigma * sigma));
+    total += kernel[i + radius];
+  }
+  for (float& weight : kernel) weight /= total;
+  Buffer temp = *image;
+  for (int pass = 0; pass < 2; ++pass) {
+    const Buffer& in = pass == 0 ? *image : temp;
+    Buffer& out = pass == 0 ? temp : *image;
+    for (int y = 0; y < in.height; ++y) {
+      for (int x = 0; x < in.width; ++x) {
+        float sum[4] = {};
+        for (int i = -radius; i <= radius; ++i) {
+          const float* pixel =
+              pass == 0 ? in.at(std::clamp(x + i, 0, in.width - 1), y)
+                        : in.at(x, std::clamp(y + i, 0, in.height - 1));
+          for (int c = 0; c < 4; ++c) sum[c] += kernel[i + radius] * pixel[c];
+        }
+        std::copy(sum, sum + 4, out.at(x, y));
+      }
+    }
+  }
+}
+
+void Bilinear(const Buffer& image, float u, float v, float out[4]) {
+  const float x = std::clamp(u - 0.5f, 0.0f, image.width - 1.0f);
+  const float y = std::clamp(v - 0.5f, 0.0f, image.height - 1.0f);
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int x1 = std::min(x0 + 1, image.width - 1);
+  const int y1 = std::min(y0 + 1, image.height - 1);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  for (int c = 0; c < 4; ++c) {
+    out[c] = (image.at(x0, y0)[c] * (1 - fx) + image.at(x1, y0)[c] * fx) *
+                 (1 - fy) +
+             (image.at(x0, y1)[c] * (1 - fx) + image.at(x1, y1)[c] * fx) * fy;
+  }
+}
+
+Buffer Resized(const Buffer& image, int width, int height) {
+  Buffer out{width, height,
+             std::vector<float>(static_cast<size_t>(width) * height * 4)};
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x) {
+      Bilinear(image, (x + 0.5f) * image.width / width,
+               (y + 0.5f) * image.height / height, out.at(x, y));
+    }
+  }
+  return out;
+}
+
+// Same mesh as DynamicBgProcessor._meshFloats, intensity 1.5.
+const float kMesh[72] = {
+    -0.2351f, -0.0967f, 0.2135f,  -0.1414f, 0.9221f,  -0.0908f, 0.9221f,
+    -0.0685f, 1.3027f,  0.0253f,  1.2351f,  0.1786f,  -0.3768f, 0.1851f,
+    0.2f,     0.2f,     0.6615f,  0.3146f,  0.9543f,  0.0f,     0.6969f,
+    0.1911f,  1.0f,     0.2f,     0.0f,     0.4f,     0.2f,     0.4f,
+    0.0776f,  0.2318f,  0.6f,     0.4f,     0.6615f,  0.3851f,  1.0f,
+    0.4f,     0.0f,     0.6f,     0.1291f,  0.6f,     0.4f,     0.6f,
+    0.4f,     0.4304f,  0.4264f,  0.5792f,  1.2029f,  0.8188f,  -0.1192f,
+    1.0f,     0.6f,     0.8f,     0.4264f,  0.8104f,  0.6f,     0.8f,
+    0.8f,     0.8f,     1.0f,     0.8f,     0.0f,     1.0f,     0.0776f,
+    1.0283f,  0.4f,     1.0f,     0.6f,     1.0f,     0.8f,     1.0f,
+    1.1868f,  1.0283f,
+};
+
+Buffer Warped(const Buffer& image) {
+  Buffer out{image.width, image.height,
+             std::vector<float>(image.pixels.size(), 0.0f)};
+  float px[36], py[36], tx[36], ty[36];
+  for (int i = 0; i < 36; ++i) {
+    const float gx = (i % 6) / 5.0f;
+    const float gy = (i / 6) / 5.0f;
+    tx[i] = gx * image.width;
+    ty[i] = gy * image.height;
+    px[i] = (gx + (kMesh[i * 2] - gx) * 1.5f) * image.width;
+    py[i] = (gy + (kMesh[i * 2 + 1] - gy) * 1.5f) * image.height;
+  }
+  for (int cell = 0; cell < 25; ++cell) {
+    const int a = (cell / 5) * 6 + cell % 5;
+    const int triangles[2][3] = {{a, a + 1, a + 6}, {a + 1, a + 7, a + 6}};
+    for (const auto& t : triangles) {
+      const float area = (px[t[1]] - px[t[0]]) * (py[t[2]] - py[t[0]]) -
+                         (px[t[2]] - px[t[0]]) * (py[t[1]] - py[t[0]]);
+      if (std::fabs(area) < 1e-6f) continue;
+      for (int y = 0; y < image.height; ++y) {
+        for (int x = 0; x < image.width; ++x) {
+          const float cx = x + 0.5f - px[t[0]];
+          const float cy = y + 0.5f - py[t[0]];
+          const float b1 = (cx * (py[t[2]] - py[t[0]]) -
+                            (px[t[2]] - px[t[0]]) * cy) / area;
+          const float b2 = ((px[t[1]] - px[t[0]]) * cy -
+                            cx * (py[t[1]] - py[t[0]])) / area;
+          const float b0 = 1 - b1 - b2;
+          if (b0 < -1e-5f || b1 < -1e-5f || b2 < -1e-5f) continue;
+          Bilinear(image, b0 * tx[t[0]] + b1 * tx[t[1]] + b2 * tx[t[2]],
+                   b0 * ty[t[0]] + b1 * ty[t[1]] + b2 * ty[t[2]],
+                   out.at(x, y));
+        }
+      }
+    }
+  }
+  return out;
+}
+
+// Returns the reference at |out_width| x |out_height| (box filtered),
+// premultiplied bytes, before the veil.
+std::vector<uint8_t> Reference(const std::vector<uint8_t>& cover,
+                               bool desktop, int out_width, int out_height) {
+  const int full_width = desktop ? 1280 : 1000;
+  const int full_height = desktop ? 720 : 1000;
+  const float first_sigma = desktop ? 12.0f : 90.0f;
+  const float last_sigma = desktop ? 6.0f : 60.0f;
+
+  std::vector<uint8_t> small(150 * 150 * 4);
+  cyrene_music::DownsampleScratch scratch;
+  cyrene_music::DownsampleRgba(cover.data(), kSourceSize * 4,
+                               {0, 0, kSourceSize, kSourceSize}, 150, 150,
+                               small.data(), &scratch);
+  Buffer image{150, 150, std::vector<float>(small.size())};
+  for (size_t i = 0; i < small.size(); ++i) image.pixels[i] = small[i] / 255.f;
+  ExactBlur(&image, first_sigma);
+  image = Warped(image);
+  image = Resized(image, full_width, full_height);
+  image = Warped(image);
+  ExactBlur(&image, last_sigma);
+  for (size_t i = 0; i < image.pixels.size(); i += 4) {
+    float* pixel = &image.pixels[i];
+    const float luma =
+        0.213f * pixel[0] + 0.715f * pixel[1] + 0.072f * pixel[2];
+    for (int c = 0; c < 3; ++c) {
+      pixel[c] = std::clamp(luma + 1.8f * (pixel[c] - luma), 0.0f, pixel[3]);
+    }
+  }
+
+  std::vector<uint8_t> bytes(image.pixels.size());
+  for (size_t i = 0; i < bytes.size(); ++i) {
+    bytes[i] = static_cast<uint8_t>(
+        std::clamp(image.pixels[i] * 255.0f + 0.5f, 0.0f, 255.0f));
+  }
+  std::vector<uint8_t> out(static_cast<size_t>(out_width) * out_height * 4);
+  cyrene_music::DownsampleRgba(bytes.data(),
+                               static_cast<size_t>(full_width) * 4,
+                               {0, 0, full_width, full_height}, out_width,
+                               out_height, out.data(), &scratch);
+  return out;
+}
+
+double Ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+std::mutex done_mutex;
+std::condition_variable done_changed;
+int done_count = 0;
+
+void OnDone(int64_t id, int32_t ok, float brightness) {
+  std::lock_guard<std::mutex> lock(done_mutex);
+  ++done_count;
+  done_changed.notify_all();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int covers = 4;
+  if (argc > 1) covers = std::atoi(argv[1]);
+  if (covers <= 0) {
+    std::fprintf(stderr, "usage: %s [covers]\n", argv[0]);
+    return 1;
+  }
+
+  bool ok = true;
+  FluidBackgroundRenderer renderer;
+  for (int desktop = 0; desktop < 2; ++desktop) {
+    const FluidBackgroundProfile profile =
+        desktop ? FluidBackgroundProfile::Desktop()
+                : FluidBackgroundProfile::Mobile();
+    std::vector<uint8_t> out(static_cast<size_t>(profile.output_width) *
+                             profile.output_height * 4);
+    double render_ms = 0;
+    double reference_ms = 0;
+    double error_total = 0;
+    int worst = 0;
+    for (int i = 0; i < covers; ++i) {
+      const std::vector<uint8_t> cover = RenderCover(static_cast<uint32_t>(i));
+      float brightness = 0;
+      auto start = std::chrono::steady_clock::now();
+      renderer.Render(cover.data(), kSourceSize, kSourceSize, kSourceSize * 4,
+                      profile, out.data(), &brightness);
+      render_ms += Ms(start);
+
+      start = std::chrono::steady_clock::now();
+      const std::vector<uint8_t> reference =
+          Reference(cover, desktop != 0, profile.output_width,
+                    profile.output_height);
+      reference_ms += Ms(start);
+      // Banded covers land between the veil thresholds, so the outputs are
+      // directly comparable.
+      if (brightness > 0.8f || brightness < 0.2f) continue;
+      double error = 0;
+      for (size_t j = 0; j < out.size(); ++j) {
+        const int diff = std::abs(out[j] - reference[j]);
+        error += diff;
+        worst = std::max(worst, diff);
+      }
+      error_total += error / out.size();
+    }
+    const double mean_error = error_total / covers;
+    std::printf("%-8s %dx%d\n", desktop ? "desktop" : "mobile",
+                profile.output_width, profile.output_height);
+    std::printf("  FluidBackgroundRenderer     %8.2f ms/cover\n",
+                render_ms / covers);
+    std::printf("  full-size exact reference   %8.2f ms/cover\n",
+                reference_ms / covers);
+    std::printf("  error vs reference          %8.2f mean, %d worst (of 255)\n",
+                mean_error, worst);
+    if (mean_error > 3.0) {
+      std::printf("FAIL: %s output drifted from the reference\n",
+                  desktop ? "desktop" : "mobile");
+      ok = false;
+    }
+  }
+
+  // Flat covers: saturation and the veil by hand. Mid grey keeps its
+  // colour, a muted teal is pushed away from its luma, near white and near
+  // black get the dark and light veils.
+  struct Flat {
+    uint8_t r, g, b;
+    int expected[3];
+  };
+  const auto saturated = [](int r, int g, int b, int c) {
+    const float luma = 0.213f * r + 0.715f * g + 0.072f * b;
+    const int value = static_cast<int>(
+        std::lround(luma + 1.8f * ((c == 0 ? r : c == 1 ? g : b) - luma)));
+    return std::clamp(value, 0, 255);
+  };
+  const int veil = 79;
+  const Flat flats[] = {
+      {128, 128, 128, {128, 128, 128}},
+      {80, 140, 130,
+       {saturated(80, 140, 130, 0), saturated(80, 140, 130, 1),
+        saturated(80, 140, 130, 2)}},
+      {240, 240, 240,
+       {240 * (255 - veil) / 255, 240 * (255 - veil) / 255,
+        240 * (255 - veil) / 255}},
+      {16, 16, 16,
+       {veil + 16 * (255 - veil) / 255, veil + 16 * (255 - veil) / 255,
+        veil + 16 * (255 - veil) / 255}},
+  };
+  const FluidBackgroundProfile profile = FluidBackgroundProfile::Desktop();
+  std::vector<uint8_t> out(static_cast<size_t>(profile.output_width) *
+                           profile.output_height * 4);
+  for (const Flat& flat : flats) {
+    const std::vector<uint8_t> cover = FlatCover(flat.r, flat.g, flat.b);
+    renderer.Render(cover.data(), kSourceSize, kSourceSize, kSourceSize * 4,
+                    profile, out.data(), nullptr);
+    const uint8_t* centre =
+        &out[(static_cast<size_t>(profile.output_height / 2) *
+                  profile.output_width +
+              profile.output_width / 2) *
+             4];
+    for (int c = 0; c < 3; ++c) {
+      if (std::abs(centre[c] - flat.expected[c]) > 1) {
+        std::printf("FAIL: flat %d,%d,%d channel %d is %d, expected %d\n",
+                    flat.r, flat.g, flat.b, c, centre[c], flat.expected[c]);
+        ok = false;
+      }
+    }
+  }
+
+  // Worker round trips, the way Dart submits them.
+  const std::vector<uint8_t> cover = RenderCover(1);
+  std::vector<std::vector<uint8_t>> outputs(
+      covers, std::vector<uint8_t>(out.size()));
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < covers; ++i) {
+    cyrene_fluid_background_submit(cover.data(), kSourceSize, kSourceSize, 0,
+                                   1, outputs[i].data(), i, &OnDone);
+  }
+  {
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_changed.wait(lock, [&] { return done_count == covers; });
+  }
+  const double worker_ms = Ms(start);
+  renderer.Render(cover.data(), kSourceSize, kSourceSize, kSourceSize * 4,
+                  profile, out.data(), nullptr);
+  for (int i = 0; i < covers; ++i) {
+    if (outputs[i] != out) {
+      std::printf("FAIL: worker output %d differs\n", i);
+      ok = false;
+    }
+  }
+  std::printf("worker round trip (desktop)   %8.2f ms/cover\n",
+              worker_ms / covers);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+// Exercises the single-instance handoff in one process.
+//
+// A primary and a secondary InstanceHandoff are claimed under a bench-only
+// name (the lock and the mutex are per handle, so both roles fit in one
+// process). The bench checks that the second claim is refused, that
+// arguments survive the trip byte for byte, that a secondary started
+// before the primary listens is still answered, that relative paths reach
+// the primary resolved against the secondary's working directory, and
+// times Forward(), which is what a second launch costs before it exits. On Linux it also plants
+// a symlink at a lock path and checks that claiming does not follow it.
+//
+// Usage: instance_handoff_bench [forwards]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "instance/instance_handoff.h"
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+namespace {
+
+using cyrene_music::InstanceHandoff;
+using Clock = std::chrono::steady_clock;
+
+double Microseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::micro>(d).count();
+}
+
+// Counts notifications so the bench can wait for delivery.
+struct Delivery {
+  std::mutex mutex;
+  std::condition_variable cv;
+  int notified = 0;
+
+  void Notify() {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++notified;
+    cv.notify_all();
+  }
+
+  bool WaitFor(int count) {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_for(lock, std::chrono::seconds(2),
+                       [&] { return notified >= count; });
+  }
+};
+
+#if !defined(_WIN32)
+// Someone else may own the directory the lock file goes in (/tmp without
+// $XDG_RUNTIME_DIR) and have put a symlink at the path. The claim must
+// neither follow it nor listen on a socket beside it.
+bool CheckPlantedLock() {
+  char dir_template[] = "/tmp/cyrene_handoff_benchXXXXXX";
+  const char* dir = mkdtemp(dir_template);
+  if (dir == nullptr) return true;
+  const std::string target = std::string(dir) + "/target";
+  const std::string lock = std::string(dir) + "/planted.lock";
+  bool ok = symlink(target.c_str(), lock.c_str()) == 0;
+
+  const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+  const std::string saved = runtime_dir != nullptr ? runtime_dir : "";
+  setenv("XDG_RUNTIME_DIR", dir, 1);
+  {
+    InstanceHandoff planted;
+    // Refusing to start would be worse; it runs without a handoff.
+    ok = ok && planted.ClaimPrimary("planted") &&
+         access(target.c_str(), F_OK) != 0 && !planted.Listen();
+  }
+  if (runtime_dir != nullptr) {
+    setenv("XDG_RUNTIME_DIR", saved.c_str(), 1);
+  } else {
+    unsetenv("XDG_RUNTIME_DIR");
+  }
+  unlink(target.c_str());
+  unlink(lock.c_str());
+  rmdir(dir);
+  return ok;
+}
+#endif
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int forwards = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+  // A fixed name, so repeated runs reuse one lock file.
+  const std::string name = "cyrene_handoff_bench";
+  bool ok = true;
+
+  const std::vector<std::string> sample = {
+      "--flag", "", "/music/歌曲 01.flac",
+      std::string("with\0nul", 8), std::string(40000, 'x')};
+  std::vector<std::string> decoded;
+  const std::vector<uint8_t> message = InstanceHandoff::Encode(sample);
+  if (!InstanceHandoff::Decode(message.data(), message.size(), &decoded) ||
+      decoded != sample) {
+    std::printf("FAIL: encode/decode round trip\n");
+    ok = false;
+  }
+  for (size_t cut = 0; cut < message.size(); cut += 997) {
+    if (InstanceHandoff::Decode(message.data(), cut, &decoded)) {
+      std::printf("FAIL: truncated message at %zu accepted\n", cut);
+      ok = false;
+      break;
+    }
+  }
+
+  InstanceHandoff primary;
+  InstanceHandoff secondary;
+  if (!primary.ClaimPrimary(name)) {
+    std::printf("FAIL: first claim refused (another run in progress?)\n");
+    return 1;
+  }
+  if (secondary.ClaimPrimary(name)) {
+    std::printf("FAIL: second claim granted\n");
+    return 1;
+  }
+
+  Delivery delivery;
+  primary.SetNotify([&delivery] { delivery.Notify(); });
+
+  // A secondary that starts while the primary is still coming up.
+  std::thread early([&] {
+    if (!secondary.Forward({"early"}, std::chrono::milliseconds(2000))) {
+      std::printf("FAIL: forward before listen\n");
+      ok = false;
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(30));
+  const Clock::time_point listen_start = Clock::now();
+  if (!primary.Listen()) {
+    std::printf("FAIL: listen\n");
+    early.join();
+    return 1;
+  }
+  early.join();
+  std::printf("late listen: answered %.0f us after Listen()\n",
+              Microseconds(Clock::now() - listen_start));
+  if (!delivery.WaitFor(1) || primary.TakePending() !=
+                                  std::vector<InstanceHandoff::ArgumentList>{
+                                      {"early"}}) {
+    std::printf("FAIL: early arguments not delivered\n");
+    ok = false;
+  }
+
+  std::vector<double> times;
+  times.reserve(forwards);
+  for (int i = 0; i < forwards; ++i) {
+    const Clock::time_point start = Clock::now();
+    if (!secondary.Forward(sample, std::chrono::milliseconds(1000))) {
+      std::printf("FAIL: forward %d\n", i);
+      ok = false;
+      break;
+    }
+    times.push_back(Microseconds(Clock::now() - start));
+  }
+  delivery.WaitFor(1 + forwards);
+  const std::vector<InstanceHandoff::ArgumentList> received =
+      primary.TakePending();
+  if (static_cast<int>(received.size()) != forwards ||
+      std::any_of(received.begin(), received.end(),
+                  [&](const InstanceHandoff::ArgumentList& list) {
+                    return list != sample;
+                  })) {
+    std::printf("FAIL: received %zu of %d lists intact\n", received.size(),
+                forwards);
+    ok = false;
+  }
+
+  if (!times.empty()) {
+    std::sort(times.begin(), times.end());
+    std::printf("forward (%zu bytes, %d runs): median %.1f us, p99 %.1f us\n",
+                message.size(), forwards, times[times.size() / 2],
+                times[std::min(times.size() - 1, times.size() * 99 / 100)]);
+  }
+
+  // "cyrene_music song.mp3" run in another directory than the primary's.
+  {
+    const std::filesystem::path cwd = std::filesystem::current_path();
+    const InstanceHandoff::ArgumentList launch = {
+        "song.mp3", "../album/02.flac", "--minimized",
+        (cwd / "abs.mp3").u8string(), "https://example.com/a.mp3"};
+    const InstanceHandoff::ArgumentList expected = {
+        (cwd / "song.mp3").u8string(),
+        (cwd.parent_path() / "album" / "02.flac").u8string(),
+        "--minimized", (cwd / "abs.mp3").u8string(),
+        "https://example.com/a.mp3"};
+    int before = 0;
+    {
+      std::lock_guard<std::mutex> lock(delivery.mutex);
+      before = delivery.notified;
+    }
+    if (!secondary.Forward(InstanceHandoff::WithAbsolutePaths(launch),
+                           std::chrono::milliseconds(1000)) ||
+        !delivery.WaitFor(before + 1) ||
+        primary.TakePending() !=
+            std::vector<InstanceHandoff::ArgumentList>{expected}) {
+      std::printf("FAIL: relative paths not resolved for the primary\n");
+      ok = false;
+    }
+  }
+
+  primary.Stop();
+  if (secondary.Forward({"after stop"}, std::chrono::milliseconds(50))) {
+    std::printf("FAIL: forward after stop succeeded\n");
+    ok = false;
+  }
+
+#if !defined(_WIN32)
+  if (!CheckPlantedLock()) {
+    std::printf("FAIL: claim followed a symlinked lock file\n");
+    ok = false;
+  }
+#endif
+
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
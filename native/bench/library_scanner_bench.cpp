@@ -0,0 +1,529 @@
+// Measures scanning a local music folder.
+//
+// Writes a synthetic library (artist/album folders of FLAC and MP3 files
+// with tags, covers and embedded lyrics, sidecar .lrc files next to some
+// songs and in "Lyrics" folders for others, and a few WAV files the tag
+// reader does not handle), then compares the old LocalLibraryService path
+// with LibraryScanner:
+//
+//   one by one: a recursive walk on one thread that, per song, checks the
+//     list of known songs linearly, probes both sidecar locations, reads the
+//     whole file to parse its tags and writes the cover out;
+//   scanner: LibraryScanner, a work-stealing walk that maps each file and
+//     touches only its tag region, from an empty index and again with the
+//     index in place, then after changing, adding and deleting a few songs.
+//
+// Checks every reported track against what was written, the batch sizes,
+// that the rescans report exactly the changed, new and removed files, that
+// a snapshot written aside leaves the index in place until it is moved
+// over it, and that an index claiming more entries than it holds is
+// rejected.
+// On Linux the page cache is dropped for the library before each cold run.
+//
+// Usage: library_scanner_bench [songs] [megabytes per song] [threads]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cache/md5.h"
+#include "library/library_scanner.h"
+#include "media/audio_tags.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using cyrene_music::AudioTags;
+using cyrene_music::LibraryScanBatch;
+using cyrene_music::LibraryScanner;
+using cyrene_music::LibraryScanOptions;
+using cyrene_music::LibraryTrack;
+using cyrene_music::Md5;
+using Clock = std::chrono::steady_clock;
+using Bytes = std::string;
+namespace fs = std::filesystem;
+
+const std::vector<std::string> kExtensions = {"mp3", "wav", "flac", "aac",
+                                              "m4a", "ogg", "opus", "ape",
+                                              "wma", "alac"};
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+void Put32Be(Bytes* out, uint32_t v) {
+  for (int i = 3; i >= 0; --i) out->push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void Put24Be(Bytes* out, uint32_t v) {
+  for (int i = 2; i >= 0; --i) out->push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void Put32Le(Bytes* out, uint32_t v) {
+  for (int i = 0; i < 4; ++i) out->push_back(static_cast<char>(v >> (8 * i)));
+}
+
+void PutSyncSafe(Bytes* out, uint32_t v) {
+  for (int i = 3; i >= 0; --i) {
+    out->push_back(static_cast<char>((v >> (7 * i)) & 0x7F));
+  }
+}
+
+Bytes Random(size_t size, uint32_t seed) {
+  Bytes out(size, '\0');
+  std::mt19937 random(seed);
+  for (char& c : out) c = static_cast<char>(random());
+  return out;
+}
+
+// What song |i| is tagged with.
+struct Song {
+  std::string title;
+  std::string artist;
+  std::string album;
+  std::string lyric;  // the text the scan should report
+  bool flac = false;
+  bool wav = false;
+  // Where the reported lyric comes from.
+  enum class Lyric { kEmbedded, kSidecar, kLyricsFolder } lyric_source;
+};
+
+Song SongFor(size_t i) {
+  Song song;
+  song.title = "Song " + std::to_string(i);
+  song.artist = "Artist " + std::to_string(i / 50);
+  song.album = "Album " + std::to_string(i / 10);
+  song.wav = i % 25 == 24;
+  song.flac = !song.wav && i % 4 != 3;
+  if (i % 3 == 0) {
+    song.lyric_source = Song::Lyric::kSidecar;
+    song.lyric = "[00:01.00]sidecar " + std::to_string(i);
+  } else if (i % 5 == 0) {
+    song.lyric_source = Song::Lyric::kLyricsFolder;
+    song.lyric = "[00:01.00]lyrics folder " + std::to_string(i);
+  } else {
+    song.lyric_source = Song::Lyric::kEmbedded;
+    song.lyric =
+        song.wav ? std::string() : "[00:01.00]embedded " + std::to_string(i);
+  }
+  return song;
+}
+
+fs::path SongPath(const fs::path& root, size_t i) {
+  const Song song = SongFor(i);
+  char name[32];
+  std::snprintf(name, sizeof(name), "%02zu Track.", i % 10);
+  return root / song.artist / song.album /
+         (name + std::string(song.wav ? "wav" : song.flac ? "flac" : "mp3"));
+}
+
+Bytes Flac(const Song& song, const Bytes& cover, size_t audio_size,
+           uint32_t seed) {
+  Bytes comment;
+  const Bytes vendor = "reference libFLAC 1.4.3";
+  Put32Le(&comment, static_cast<uint32_t>(vendor.size()));
+  comment += vendor;
+  const std::vector<Bytes> fields = {
+      "TITLE=" + song.title, "ARTIST=" + song.artist, "ALBUM=" + song.album,
+      "LYRICS=[00:01.00]embedded " + song.title.substr(5)};
+  Put32Le(&comment, static_cast<uint32_t>(fields.size()));
+  for (const Bytes& field : fields) {
+    Put32Le(&comment, static_cast<uint32_t>(field.size()));
+    comment += field;
+  }
+  Bytes picture;
+  Put32Be(&picture, 3);
+  Put32Be(&picture, 10);
+  picture += "image/jpeg";
+  for (int i = 0; i < 5; ++i) Put32Be(&picture, 0);
+  Put32Be(&picture, static_cast<uint32_t>(cover.size()));
+  picture += cover;
+
+  Bytes out = "fLaC";
+  out += '\x00';
+  Put24Be(&out, 34);
+  out += Bytes(34, '\0');
+  out += '\x04';
+  Put24Be(&out, static_cast<uint32_t>(comment.size()));
+  out += comment;
+  out += '\x86';
+  Put24Be(&out, static_cast<uint32_t>(picture.size()));
+  out += picture;
+  return out + Random(audio_size, seed);
+}
+
+Bytes Id3Frame(const char* id, const Bytes& body) {
+  Bytes out = id;
+  PutSyncSafe(&out, static_cast<uint32_t>(body.size()));
+  out += Bytes(2, '\0');
+  return out + body;
+}
+
+Bytes Mp3(const Song& song, const Bytes& cover, size_t audio_size,
+          uint32_t seed) {
+  Bytes frames;
+  frames += Id3Frame("TIT2", "\x03" + song.title);
+  frames += Id3Frame("TPE1", "\x03" + song.artist);
+  frames += Id3Frame("TALB", "\x03" + song.album);
+  frames += Id3Frame("USLT", Bytes("\x03" "eng\0", 5) +
+                                 "[00:01.00]embedded " + song.title.substr(5));
+  frames += Id3Frame("APIC", Bytes("\x03" "image/png\0\x03\0", 13) + cover);
+  Bytes out = "ID3";
+  out += '\x04';
+  out += Bytes(2, '\0');
+  PutSyncSafe(&out, static_cast<uint32_t>(frames.size()));
+  Bytes audio = Random(audio_size, seed);
+  audio[0] = static_cast<char>(0xFF);
+  audio[1] = static_cast<char>(0xFB);
+  return out + frames + audio;
+}
+
+Bytes Wav(size_t audio_size, uint32_t seed) {
+  return Bytes("RIFF\0\0\0\0WAVE", 12) + Random(audio_size, seed);
+}
+
+void WriteFile(const fs::path& path, const Bytes& bytes) {
+  std::error_code error;
+  fs::create_directories(path.parent_path(), error);
+  std::ofstream(path, std::ios::binary | std::ios::trunc)
+      .write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+void WriteSong(const fs::path& root, size_t i, size_t audio_size,
+               uint32_t seed) {
+  const Song song = SongFor(i);
+  const fs::path path = SongPath(root, i);
+  Bytes cover = Random(32 * 1024, static_cast<uint32_t>(i));
+  cover[0] = static_cast<char>(0xFF);
+  cover[1] = static_cast<char>(0xD8);
+  if (song.wav) {
+    WriteFile(path, Wav(audio_size, seed));
+  } else if (song.flac) {
+    WriteFile(path, Flac(song, cover, audio_size, seed));
+  } else {
+    WriteFile(path, Mp3(song, cover, audio_size, seed));
+  }
+  const std::string lrc = path.stem().u8string() + ".lrc";
+  if (song.lyric_source == Song::Lyric::kSidecar) {
+    WriteFile(path.parent_path() / lrc, "\xEF\xBB\xBF" + song.lyric);
+  } else if (song.lyric_source == Song::Lyric::kLyricsFolder) {
+    WriteFile(path.parent_path() / "Lyrics" / lrc, song.lyric);
+  }
+}
+
+void DropPageCache(const fs::path& root) {
+#if !defined(_WIN32)
+  std::error_code error;
+  for (fs::recursive_directory_iterator it(root, error), end;
+       !error && it != end; it.increment(error)) {
+    if (!it->is_regular_file(error)) continue;
+    const int fd = open(it->path().c_str(), O_RDONLY);
+    if (fd < 0) continue;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+  }
+#endif
+}
+
+std::string CoverPath(const fs::path& covers, const std::string& path,
+                      const char* extension) {
+  Md5 md5;
+  md5.Update(reinterpret_cast<const uint8_t*>(path.data()), path.size());
+  return (covers / (md5.FinishHex() + extension)).u8string();
+}
+
+// The old path, as LocalLibraryService._addAudioFile did it per song.
+size_t ScanOneByOne(const fs::path& root, const fs::path& covers) {
+  std::vector<std::string> tracks;
+  std::error_code error;
+  for (fs::recursive_directory_iterator it(root, error), end;
+       !error && it != end; it.increment(error)) {
+    if (!it->is_regular_file(error)) continue;
+    std::string extension = it->path().extension().u8string();
+    if (extension.empty()) continue;
+    extension.erase(0, 1);
+    if (std::find(kExtensions.begin(), kExtensions.end(), extension) ==
+        kExtensions.end()) {
+      continue;
+    }
+    const std::string path = it->path().u8string();
+    if (std::find(tracks.begin(), tracks.end(), path) != tracks.end()) {
+      continue;
+    }
+
+    const std::string lrc = it->path().stem().u8string() + ".lrc";
+    fs::path lyric_path = it->path().parent_path() / lrc;
+    if (!fs::exists(lyric_path, error)) {
+      lyric_path = it->path().parent_path() / "Lyrics" / lrc;
+    }
+    std::string lyric;
+    if (fs::exists(lyric_path, error)) {
+      std::ifstream in(lyric_path, std::ios::binary);
+      lyric.assign(std::istreambuf_iterator<char>(in),
+                   std::istreambuf_iterator<char>());
+    }
+
+    std::ifstream in(it->path(), std::ios::binary);
+    std::vector<uint8_t> bytes(static_cast<size_t>(it->file_size(error)));
+    in.read(reinterpret_cast<char*>(bytes.data()),
+            static_cast<std::streamsize>(bytes.size()));
+    AudioTags tags;
+    if (tags.Parse(bytes.data(), bytes.size()) &&
+        tags.cover().data != nullptr) {
+      const fs::path cover = CoverPath(covers, path, ".jpg");
+      if (!fs::exists(cover, error)) {
+        std::ofstream(cover, std::ios::binary)
+            .write(reinterpret_cast<const char*>(tags.cover().data),
+                   static_cast<std::streamsize>(tags.cover().size));
+      }
+    }
+    tracks.push_back(path);
+  }
+  return tracks.size();
+}
+
+struct ScanResult {
+  std::vector<LibraryScanBatch> batches;
+  std::unordered_map<std::string, LibraryTrack> tracks;
+  std::vector<std::string> removed;
+  cyrene_music::LibraryScanStats stats;
+  double ms = 0;
+};
+
+ScanResult Scan(LibraryScanner* scanner, const LibraryScanOptions& options) {
+  ScanResult result;
+  const Clock::time_point start = Clock::now();
+  if (!scanner->Start(options)) return result;
+  scanner->Wait();
+  result.ms = Milliseconds(Clock::now() - start);
+  result.batches = scanner->TakeBatches();
+  for (LibraryScanBatch& batch : result.batches) {
+    for (LibraryTrack& track : batch.tracks) {
+      result.tracks[track.path] = track;
+    }
+    if (batch.done) {
+      result.stats = batch.stats;
+      result.removed = batch.removed;
+    }
+  }
+  return result;
+}
+
+void PrintScan(const char* label, const ScanResult& result) {
+  std::printf("%-22s %8.1f ms  %5llu files, %5llu read, %5llu unchanged, "
+              "%3llu removed, %3zu batches, %llu steals\n",
+              label, result.ms,
+              static_cast<unsigned long long>(result.stats.files),
+              static_cast<unsigned long long>(result.stats.changed),
+              static_cast<unsigned long long>(result.stats.unchanged),
+              static_cast<unsigned long long>(result.stats.removed),
+              result.batches.size(),
+              static_cast<unsigned long long>(result.stats.steals));
+}
+
+bool CheckTracks(const fs::path& root, const fs::path& covers, size_t songs,
+                 const ScanResult& result, size_t batch_size) {
+  bool ok = true;
+  if (result.tracks.size() != songs) {
+    std::printf("FAIL: %zu tracks reported for %zu songs\n",
+                result.tracks.size(), songs);
+    ok = false;
+  }
+  for (size_t b = 0; b < result.batches.size(); ++b) {
+    const LibraryScanBatch& batch = result.batches[b];
+    if (batch.tracks.size() > batch_size || batch.done !=
+        (b + 1 == result.batches.size())) {
+      std::printf("FAIL: batch %zu has %zu tracks, done %d\n", b,
+                  batch.tracks.size(), batch.done);
+      ok = false;
+      break;
+    }
+  }
+  for (size_t i = 0; i < songs && ok; ++i) {
+    const Song song = SongFor(i);
+    const std::string path = SongPath(root, i).u8string();
+    auto it = result.tracks.find(path);
+    if (it == result.tracks.end()) {
+      std::printf("FAIL: %s not reported\n", path.c_str());
+      ok = false;
+      break;
+    }
+    const LibraryTrack& track = it->second;
+    const bool tagged = !song.wav;
+    const std::string cover =
+        tagged ? CoverPath(covers, path, song.flac ? ".jpg" : ".png")
+               : std::string();
+    if (track.lyric != song.lyric ||
+        (tagged && (track.title != song.title || track.artist != song.artist ||
+                    track.album != song.album)) ||
+        (track.format == 0) == tagged || track.cover_path != cover ||
+        (tagged && !fs::exists(fs::u8path(cover)))) {
+      std::printf("FAIL: song %zu read as \"%s\" \"%s\" \"%s\" lyric \"%s\" "
+                  "cover \"%s\"\n",
+                  i, track.title.c_str(), track.artist.c_str(),
+                  track.album.c_str(), track.lyric.c_str(),
+                  track.cover_path.c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t songs =
+      argc > 1 ? static_cast<size_t>(std::max(50, std::atoi(argv[1]))) : 1000;
+  const size_t audio_size =
+      (argc > 2 ? static_cast<size_t>(std::max(1, std::atoi(argv[2]))) : 1) *
+      1024 * 1024;
+  const size_t threads =
+      argc > 3 ? static_cast<size_t>(std::max(1, std::atoi(argv[3]))) : 0;
+  bool ok = true;
+
+  std::error_code error;
+  const fs::path directory =
+      fs::temp_directory_path(error) / "library_scanner_bench";
+  const fs::path root = directory / "Music";
+  const fs::path covers = directory / "covers";
+  const std::string index_path = (directory / "library_index.bin").u8string();
+  fs::remove_all(directory, error);
+  for (size_t i = 0; i < songs; ++i) {
+    WriteSong(root, i, audio_size, static_cast<uint32_t>(i));
+  }
+  std::printf("%zu songs of %zu MB, %zu scanner threads\n", songs,
+              audio_size >> 20,
+              threads != 0 ? threads : std::thread::hardware_concurrency());
+
+  for (const bool cold : {true, false}) {
+    fs::remove_all(covers, error);
+    fs::create_directories(covers, error);
+    if (cold) DropPageCache(root);
+    const Clock::time_point start = Clock::now();
+    const size_t found = ScanOneByOne(root, covers);
+    std::printf("%-22s %8.1f ms  %5zu files\n",
+                cold ? "one by one, cold" : "one by one, warm",
+                Milliseconds(Clock::now() - start), found);
+  }
+
+  LibraryScanOptions options;
+  options.roots = {root.u8string()};
+  options.extensions = kExtensions;
+  options.index_path = index_path;
+  options.cover_directory = covers.u8string();
+  LibraryScanner scanner(threads);
+
+  // Full scans: no index, every file read.
+  for (const bool cold : {true, false}) {
+    fs::remove_all(covers, error);
+    fs::create_directories(covers, error);
+    fs::remove(fs::u8path(index_path), error);
+    if (cold) DropPageCache(root);
+    const ScanResult result = Scan(&scanner, options);
+    PrintScan(cold ? "scanner, cold" : "scanner, warm", result);
+    if (!CheckTracks(root, covers, songs, result, options.batch_size)) {
+      ok = false;
+    }
+  }
+
+  // Nothing changed: the index turns the rescan into a walk.
+  DropPageCache(root);
+  ScanResult rescan = Scan(&scanner, options);
+  PrintScan("rescan, unchanged", rescan);
+  if (!rescan.tracks.empty() || rescan.stats.unchanged != songs) {
+    std::printf("FAIL: unchanged rescan reported %zu tracks\n",
+                rescan.tracks.size());
+    ok = false;
+  }
+
+  // Rewrite some songs, add some and delete some.
+  const size_t changes = std::max<size_t>(1, songs / 100);
+  std::vector<std::string> expected_changed;
+  std::vector<std::string> expected_removed;
+  for (size_t k = 0; k < changes; ++k) {
+    const size_t rewritten = k * 7 % songs;
+    WriteSong(root, rewritten, audio_size + 1, 99);
+    expected_changed.push_back(SongPath(root, rewritten).u8string());
+    WriteSong(root, songs + k, audio_size, 98);
+    expected_changed.push_back(SongPath(root, songs + k).u8string());
+    const size_t removed = songs - 1 - k * 3;
+    fs::remove(SongPath(root, removed), error);
+    expected_removed.push_back(SongPath(root, removed).u8string());
+  }
+  // Written aside, as LocalLibraryService does until it has stored the
+  // tracks.
+  const std::string pending_path = index_path + ".pending";
+  options.save_path = pending_path;
+  DropPageCache(root);
+  rescan = Scan(&scanner, options);
+  PrintScan("rescan, 1% changed", rescan);
+  std::sort(expected_changed.begin(), expected_changed.end());
+  expected_changed.erase(
+      std::unique(expected_changed.begin(), expected_changed.end()),
+      expected_changed.end());
+  std::vector<std::string> changed;
+  for (const auto& [path, track] : rescan.tracks) {
+    if (std::find(expected_removed.begin(), expected_removed.end(), path) ==
+        expected_removed.end()) {
+      changed.push_back(path);
+    }
+  }
+  std::sort(changed.begin(), changed.end());
+  std::sort(expected_removed.begin(), expected_removed.end());
+  std::sort(rescan.removed.begin(), rescan.removed.end());
+  if (changed != expected_changed || rescan.removed != expected_removed) {
+    std::printf("FAIL: rescan reported %zu changed, %zu removed; expected "
+                "%zu, %zu\n",
+                changed.size(), rescan.removed.size(),
+                expected_changed.size(), expected_removed.size());
+    ok = false;
+  }
+
+  // Not moved over yet: the same files are reported again.
+  const size_t reported = rescan.tracks.size();
+  if (Scan(&scanner, options).tracks.size() != reported) {
+    std::printf("FAIL: a snapshot written aside replaced the index\n");
+    ok = false;
+  }
+
+  // Once it is, the index has caught up.
+  fs::rename(fs::u8path(pending_path), fs::u8path(index_path), error);
+  options.save_path.clear();
+  rescan = Scan(&scanner, options);
+  if (!rescan.tracks.empty() || !rescan.removed.empty()) {
+    std::printf("FAIL: second rescan reported %zu tracks, %zu removed\n",
+                rescan.tracks.size(), rescan.removed.size());
+    ok = false;
+  }
+
+  // A header claiming four billion entries over an empty body.
+  {
+    const uint8_t header[12] = {'C', 'Y', 'L', 'B', 1, 0, 0, 0,
+                                0xFF, 0xFF, 0xFF, 0xFF};
+    std::ofstream(fs::u8path(index_path), std::ios::binary)
+        .write(reinterpret_cast<const char*>(header), sizeof(header));
+    cyrene_music::LibraryIndex index;
+    if (index.Load(index_path) || !index.entries().empty()) {
+      std::printf("FAIL: oversized entry count accepted\n");
+      ok = false;
+    }
+  }
+
+  fs::remove_all(directory, error);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,436 @@
+// Headless benchmark and golden-image check for the portable desktop lyric
+// renderer.
+//
+// First renders a few fixed-size frames (horizontal, stroked, with a
+// translation, vertical, mid-scroll) and compares them with the reference
+// images in bench/golden, allowing small per-channel differences so float
+// rounding across compilers does not count, and checks that a pause or a
+// stall in the middle of a scroll does not jump the marquee. Then plays a
+// synthetic lyric sheet through LyricRenderer at the overlay's 30 ms scroll
+// cadence, for each layout mode, and prints the same timing histograms the
+// desktop_lyric getRenderStats method reports in the field.
+//
+// Usage: lyric_render_bench [passes] [--update-golden]
+//   --update-golden rewrites the reference images from this build.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "box_text_rasterizer.h"
+#include "lyric/argb_surface.h"
+#include "lyric/glyph_atlas.h"
+#include "lyric/lyric_renderer.h"
+#include "lyric/render_stats.h"
+#include "playback/playback_clock.h"
+
+namespace {
+
+using cyrene_music::ArgbSurface;
+using cyrene_music::BoxTextRasterizer;
+using cyrene_music::DurationHistogram;
+using cyrene_music::GlyphAtlasRasterizer;
+using cyrene_music::LyricRenderer;
+using cyrene_music::LyricStyle;
+using cyrene_music::PlaybackClock;
+using cyrene_music::PlaybackState;
+using cyrene_music::RenderStats;
+
+constexpr int kFrameIntervalMs = 30;
+constexpr uint32_t kLineDurationMs = 4000;
+
+// A pixel matches its reference when no channel is further off than this;
+// an image matches when at most kGoldenMaxMismatch of its pixels do not.
+constexpr int kGoldenChannelTolerance = 4;
+constexpr double kGoldenMaxMismatch = 0.002;
+
+struct Line {
+  const char* lyric;
+  const char* translation;
+};
+
+// Mix of short CJK, long CJK that scrolls, Latin and mixed lines.
+const Line kSheet[] = {
+    {u8"你好，世界", u8"Hello, world"},
+    {u8"在这个安静的夜晚里我听"
+     u8"见风穿过城市的每一条街"
+     u8"道也听见你的声音",
+     u8"On this quiet night I hear the wind pass through every street of the "
+     u8"city, and I hear your voice"},
+    {u8"Never gonna give you up, never gonna let you down", u8""},
+    {u8"君の名は　Your name is a song that I keep "
+     u8"singing until the morning light",
+     u8"你的名字是我一直唱到黎"
+     u8"明的歌"},
+    {u8"사랑해요", u8"我爱你"},
+};
+
+struct Scenario {
+  const char* name;
+  bool vertical;
+  bool show_translation;
+  bool cold_cache;  // clear the line cache before every line
+  bool glyph_atlas;  // compose CJK from the glyph atlas
+};
+
+// One reference render. The frame is |width| x |height| whatever the
+// window would be, and is taken |at_ms| after the line starts, following
+// the scroll timer up to then.
+struct GoldenCase {
+  const char* name;
+  int width;
+  int height;
+  bool vertical;
+  int stroke_width;
+  uint32_t stroke_color;
+  const char* lyric;
+  const char* translation;  // nullptr for none
+  uint64_t at_ms;
+};
+
+const GoldenCase kGoldenCases[] = {
+    {"horizontal", 320, 48, false, 0, 0xFF000000, u8"你好，世界 hello", nullptr,
+     0},
+    {"stroke", 320, 48, false, 3, 0xFFFF2040, u8"晚风 night wind", nullptr, 0},
+    {"translation", 320, 64, false, 1, 0xFF000000, u8"사랑해요 love",
+     u8"我爱你", 0},
+    {"vertical", 64, 320, true, 1, 0xFF000000, u8"月亮代表 my heart",
+     u8"The moon", 0},
+    {"scroll", 320, 48, false, 1, 0xFF000000,
+     u8"在这个安静的夜晚里我听见风穿过城市的每一条街道", nullptr, 1500},
+};
+
+std::string GoldenPath(const char* name) {
+  return std::string(LYRIC_GOLDEN_DIR) + "/" + name + ".pam";
+}
+
+// Reference images are binary PAM (RGB_ALPHA), holding the premultiplied
+// channels as rendered.
+bool WritePam(const std::string& path, const ArgbSurface& surface) {
+  std::ofstream file(path, std::ios::binary);
+  file << "P7\nWIDTH " << surface.width() << "\nHEIGHT " << surface.height()
+       << "\nDEPTH 4\nMAXVAL 255\nTUPLTYPE RGB_ALPHA\nENDHDR\n";
+  for (int y = 0; y < surface.height(); ++y) {
+    const uint32_t* row = surface.row(y);
+    for (int x = 0; x < surface.width(); ++x) {
+      const char rgba[4] = {static_cast<char>(row[x] >> 16),
+                            static_cast<char>(row[x] >> 8),
+                            static_cast<char>(row[x]),
+                            static_cast<char>(row[x] >> 24)};
+      file.write(rgba, sizeof(rgba));
+    }
+  }
+  return static_cast<bool>(file);
+}
+
+// Reads a PAM written by WritePam() into |*surface|.
+bool ReadPam(const std::string& path, ArgbSurface* surface) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return false;
+  const std::string data((std::istreambuf_iterator<char>(file)),
+                         std::istreambuf_iterator<char>());
+  const size_t end = data.find("ENDHDR\n");
+  if (data.compare(0, 3, "P7\n") != 0 || end == std::string::npos) {
+    return false;
+  }
+  std::istringstream header(data.substr(3, end - 3));
+  int width = 0;
+  int height = 0;
+  int depth = 0;
+  std::string key;
+  while (header >> key) {
+    if (key == "WIDTH") header >> width;
+    if (key == "HEIGHT") header >> height;
+    if (key == "DEPTH") header >> depth;
+  }
+  const size_t body = end + 7;
+  if (width <= 0 || height <= 0 || depth != 4 ||
+      data.size() - body != static_cast<size_t>(width) * height * 4) {
+    return false;
+  }
+  *surface = ArgbSurface(width, height);
+  const auto* bytes = reinterpret_cast<const uint8_t*>(data.data() + body);
+  for (int y = 0; y < height; ++y) {
+    uint32_t* row = surface->row(y);
+    for (int x = 0; x < width; ++x, bytes += 4) {
+      row[x] = (static_cast<uint32_t>(bytes[3]) << 24) |
+               (static_cast<uint32_t>(bytes[0]) << 16) |
+               (static_cast<uint32_t>(bytes[1]) << 8) | bytes[2];
+    }
+  }
+  return true;
+}
+
+void RenderGolden(const GoldenCase& golden, ArgbSurface* frame) {
+  BoxTextRasterizer rasterizer;
+  LyricRenderer renderer(&rasterizer);
+  RenderStats stats;
+  LyricStyle style;
+  style.font_size = 20;
+  style.stroke_width = golden.stroke_width;
+  style.stroke_color = golden.stroke_color;
+  renderer.SetStyle(style);
+  renderer.SetVertical(golden.vertical);
+  renderer.SetShowTranslation(golden.translation != nullptr);
+  renderer.SetLineDuration(kLineDurationMs);
+
+  const uint64_t start_ms = 1000;
+  renderer.SetLyric(golden.lyric, start_ms);
+  if (golden.translation) renderer.SetTranslation(golden.translation, start_ms);
+  *frame = ArgbSurface(golden.width, golden.height);
+  for (uint64_t t = 0; t < golden.at_ms; t += kFrameIntervalMs) {
+    renderer.RenderFrame(start_ms + t, frame, &stats);
+  }
+  renderer.RenderFrame(start_ms + golden.at_ms, frame, &stats);
+}
+
+// Renders every golden case and compares it with (or, with |update|,
+// stores it as) its reference. Returns false on any mismatch.
+bool CheckGoldens(bool update) {
+  bool ok = true;
+  for (const GoldenCase& golden : kGoldenCases) {
+    ArgbSurface frame;
+    RenderGolden(golden, &frame);
+    const std::string path = GoldenPath(golden.name);
+    if (update) {
+      if (!WritePam(path, frame)) {
+        std::printf("FAIL: cannot write %s\n", path.c_str());
+        ok = false;
+      } else {
+        std::printf("golden %-12s written\n", golden.name);
+      }
+      continue;
+    }
+
+    ArgbSurface reference;
+    if (!ReadPam(path, &reference)) {
+      std::printf("FAIL: golden %s: cannot read %s\n", golden.name,
+                  path.c_str());
+      ok = false;
+      continue;
+    }
+    if (reference.width() != frame.width() ||
+        reference.height() != frame.height()) {
+      std::printf("FAIL: golden %s: %dx%d, reference %dx%d\n", golden.name,
+                  frame.width(), frame.height(), reference.width(),
+                  reference.height());
+      ok = false;
+      continue;
+    }
+    size_t mismatched = 0;
+    int max_delta = 0;
+    for (int y = 0; y < frame.height(); ++y) {
+      const uint32_t* got = frame.row(y);
+      const uint32_t* want = reference.row(y);
+      for (int x = 0; x < frame.width(); ++x) {
+        int delta = 0;
+        for (int shift = 0; shift < 32; shift += 8) {
+          const int a = static_cast<int>((got[x] >> shift) & 0xFF);
+          const int b = static_cast<int>((want[x] >> shift) & 0xFF);
+          delta = std::max(delta, std::abs(a - b));
+        }
+        max_delta = std::max(max_delta, delta);
+        if (delta > kGoldenChannelTolerance) ++mismatched;
+      }
+    }
+    const size_t pixels = static_cast<size_t>(frame.width()) * frame.height();
+    const bool match = mismatched <= pixels * kGoldenMaxMismatch;
+    std::printf("golden %-12s %s (%zu of %zu pixels off, max delta %d)\n",
+                golden.name, match ? "ok" : "MISMATCH", mismatched, pixels,
+                max_delta);
+    if (!match) {
+      std::printf("FAIL: golden %s differs from %s\n", golden.name,
+                  path.c_str());
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+// Scrolls a long line, pauses playback for two seconds mid-scroll, then
+// resumes: the marquee must pick up where it stopped, and a two-second gap
+// in frames while playing must not jump it either. Returns false if it
+// does.
+bool CheckPauseContinuity() {
+  BoxTextRasterizer rasterizer;
+  LyricRenderer renderer(&rasterizer);
+  PlaybackClock clock;
+  RenderStats stats;
+  renderer.SetPlaybackClock(&clock);
+  renderer.SetLineDuration(kLineDurationMs);
+  clock.Update(0, 240000, 1.0, PlaybackState::kPlaying);
+
+  uint64_t now_ms = 1000;
+  renderer.SetLyric(kSheet[1].lyric, now_ms);
+  ArgbSurface frame(800, 100);
+  for (; now_ms < 2000; now_ms += kFrameIntervalMs) {
+    renderer.RenderFrame(now_ms, &frame, &stats);
+  }
+  const float before = renderer.lyric_scroll_offset();
+  renderer.RenderFrame(now_ms, &frame, &stats);
+  const float per_frame = renderer.lyric_scroll_offset() - before;
+
+  clock.Update(0, 240000, 1.0, PlaybackState::kPaused);
+  now_ms += kFrameIntervalMs;
+  const bool paused_animating = renderer.RenderFrame(now_ms, &frame, &stats);
+  const float paused_offset = renderer.lyric_scroll_offset();
+
+  now_ms += 2000;
+  clock.Update(0, 240000, 1.0, PlaybackState::kPlaying);
+  renderer.RenderFrame(now_ms, &frame, &stats);
+  const float resumed_offset = renderer.lyric_scroll_offset();
+  now_ms += kFrameIntervalMs;
+  renderer.RenderFrame(now_ms, &frame, &stats);
+  const float after_resume = renderer.lyric_scroll_offset();
+
+  now_ms += 2000;
+  renderer.RenderFrame(now_ms, &frame, &stats);
+  const float after_stall = renderer.lyric_scroll_offset();
+
+  // Allow the jump of a single 50 ms step, the most one frame may take.
+  const float max_jump = per_frame * 50.0f / kFrameIntervalMs + 0.5f;
+  std::printf("pause continuity: %.1f px/frame, paused at %.1f, resumed at "
+              "%.1f, next %.1f, after a 2 s stall %.1f\n",
+              per_frame, paused_offset, resumed_offset, after_resume,
+              after_stall);
+  bool ok = true;
+  if (per_frame <= 0.0f || paused_animating) {
+    std::printf("FAIL: pause continuity: not scrolling, or animating while "
+                "paused\n");
+    ok = false;
+  }
+  if (resumed_offset - paused_offset > 0.5f ||
+      after_resume - resumed_offset > max_jump) {
+    std::printf("FAIL: pause continuity: the marquee jumped on resume\n");
+    ok = false;
+  }
+  if (after_stall - after_resume > max_jump) {
+    std::printf("FAIL: pause continuity: the marquee jumped after a stall\n");
+    ok = false;
+  }
+  return ok;
+}
+
+void PrintHistogram(const char* label, const DurationHistogram& histogram) {
+  std::printf("  %-10s mean %8.1f us  p50 %6lld us  p95 %6lld us  max %6lld us\n",
+              label, histogram.mean_us(),
+              static_cast<long long>(histogram.PercentileUs(50.0)),
+              static_cast<long long>(histogram.PercentileUs(95.0)),
+              static_cast<long long>(histogram.max_us()));
+}
+
+void RunScenario(const Scenario& scenario, int passes) {
+  BoxTextRasterizer rasterizer;
+  GlyphAtlasRasterizer atlas_rasterizer(&rasterizer);
+  LyricRenderer renderer(scenario.glyph_atlas
+                             ? static_cast<cyrene_music::TextRasterizer*>(
+                                   &atlas_rasterizer)
+                             : &rasterizer);
+  RenderStats stats;
+  renderer.SetVertical(scenario.vertical);
+  renderer.SetShowTranslation(scenario.show_translation);
+  renderer.SetLineDuration(kLineDurationMs);
+
+  uint64_t now_ms = 1;
+  const auto wall_start = std::chrono::steady_clock::now();
+  ArgbSurface frame;
+
+  for (int pass = 0; pass < passes; ++pass) {
+    for (const Line& line : kSheet) {
+      if (scenario.cold_cache) renderer.cache().Clear();
+      renderer.SetLyric(line.lyric, now_ms);
+      renderer.SetTranslation(line.translation, now_ms);
+      stats.BeginLine();
+
+      const auto size = renderer.FrameSize();
+      if (frame.width() != size.width || frame.height() != size.height) {
+        frame = ArgbSurface(size.width, size.height);
+      }
+
+      // First frame is on demand, the rest follow the scroll timer until the
+      // marquee settles or the line's time is up.
+      int interval = 0;
+      const uint64_t line_end = now_ms + kLineDurationMs;
+      while (now_ms < line_end) {
+        stats.BeginFrame(interval);
+        const bool animating = renderer.RenderFrame(now_ms, &frame, &stats);
+        stats.EndFrame();
+        if (!animating) break;
+        interval = kFrameIntervalMs;
+        now_ms += kFrameIntervalMs;
+      }
+      now_ms = line_end;
+    }
+  }
+  stats.BeginLine();  // close the last line
+
+  const double wall_ms = std::chrono::duration<double, std::milli>(
+      std::chrono::steady_clock::now() - wall_start).count();
+
+  std::printf("%s\n", scenario.name);
+  std::printf("  frames %llu in %.1f ms (%.0f frames/s), %.1f frames/line (max %llu)\n",
+              static_cast<unsigned long long>(stats.frames()), wall_ms,
+              stats.frames() / (wall_ms / 1000.0), stats.mean_frames_per_line(),
+              static_cast<unsigned long long>(stats.max_frames_per_line()));
+  std::printf("  line cache: %llu hits, %llu misses, %zu lines / %zu KiB resident\n",
+              static_cast<unsigned long long>(stats.cache_hits()),
+              static_cast<unsigned long long>(stats.cache_misses()),
+              renderer.cache().size(), renderer.cache().bytes() / 1024);
+  if (scenario.glyph_atlas) {
+    const auto& atlas = atlas_rasterizer.atlas();
+    std::printf("  glyph atlas: %llu hits, %llu misses, %zu glyphs / %zu KiB resident\n",
+                static_cast<unsigned long long>(atlas.hits()),
+                static_cast<unsigned long long>(atlas.misses()), atlas.size(),
+                atlas.bytes() / 1024);
+  }
+  PrintHistogram("layout", stats.phase(RenderStats::Phase::kLayout));
+  PrintHistogram("rasterise", stats.phase(RenderStats::Phase::kRasterise));
+  PrintHistogram("frame", stats.frame_total());
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int passes = 20;
+  bool update_golden = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::strcmp(argv[i], "--update-golden") == 0) {
+      update_golden = true;
+      continue;
+    }
+    passes = std::atoi(argv[i]);
+    if (passes <= 0) {
+      std::fprintf(stderr, "usage: %s [passes] [--update-golden]\n",
+                   argv[0]);
+      return 1;
+    }
+  }
+
+  bool ok = CheckGoldens(update_golden);
+  if (update_golden) return ok ? 0 : 1;
+  ok &= CheckPauseContinuity();
+
+  const Scenario scenarios[] = {
+      {"horizontal", false, false, false, false},
+      {"horizontal + translation", false, true, false, false},
+      {"vertical + translation", true, true, false, false},
+      {"horizontal + translation, cold cache", false, true, true, false},
+      {"horizontal + translation, cold cache, glyph atlas", false, true, true,
+       true},
+      {"vertical + translation, cold cache, glyph atlas", true, true, true,
+       true},
+  };
+  for (const Scenario& scenario : scenarios) {
+    RunScenario(scenario, passes);
+  }
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
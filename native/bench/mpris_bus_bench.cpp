@@ -0,0 +1,326 @@
+// Checks the Linux runner's MprisService against a private session bus.
+//
+// Starts `dbus-daemon --session --print-address`, points
+// DBUS_SESSION_BUS_ADDRESS at it and talks to the service from a second
+// connection on that bus: the name is owned and the properties answer, a
+// burst of state changes arrives as one PropertiesChanged signal, player
+// methods come back as buttons, and when another client holds the name the
+// service stays off the bus and takes the name once it is released. Exits
+// with 0 and a note when dbus-daemon is not installed.
+//
+// Usage: mpris_bus_bench
+
+#include <gio/gio.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "mpris_service.h"
+
+namespace {
+
+const char kBusName[] = "org.mpris.MediaPlayer2.cyrene_music";
+const char kObjectPath[] = "/org/mpris/MediaPlayer2";
+const char kRootInterface[] = "org.mpris.MediaPlayer2";
+const char kPlayerInterface[] = "org.mpris.MediaPlayer2.Player";
+const char kDesktopEntry[] = "com.cyrene.music.bench";
+
+bool g_ok = true;
+
+void Expect(bool condition, const char* what) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    g_ok = false;
+  }
+}
+
+// Runs the default main context, where the service lives, until |done|.
+template <typename Done>
+bool Pump(Done done, int timeout_ms) {
+  const gint64 deadline = g_get_monotonic_time() + timeout_ms * 1000LL;
+  while (!done()) {
+    if (g_get_monotonic_time() >= deadline) return false;
+    if (!g_main_context_iteration(nullptr, FALSE)) g_usleep(1000);
+  }
+  return true;
+}
+
+void PumpFor(int timeout_ms) {
+  Pump([] { return false; }, timeout_ms);
+}
+
+// A blocking call would stall the service on the same thread, so the call
+// is made asynchronously and the context pumped until it returns. Null on
+// error.
+GVariant* Call(GDBusConnection* connection, const char* destination,
+               const char* path, const char* interface_name,
+               const char* method, GVariant* parameters) {
+  struct Pending {
+    bool done = false;
+    GVariant* reply = nullptr;
+  } pending;
+  g_dbus_connection_call(
+      connection, destination, path, interface_name, method, parameters,
+      nullptr, G_DBUS_CALL_FLAGS_NONE, 2000, nullptr,
+      [](GObject* source, GAsyncResult* result, gpointer user_data) {
+        auto* pending = static_cast<Pending*>(user_data);
+        pending->reply = g_dbus_connection_call_finish(
+            G_DBUS_CONNECTION(source), result, nullptr);
+        pending->done = true;
+      },
+      &pending);
+  // Longer than the call timeout, so the callback always runs.
+  Pump([&] { return pending.done; }, 3000);
+  return pending.reply;
+}
+
+GVariant* CallBus(GDBusConnection* connection, const char* method,
+                  GVariant* parameters) {
+  return Call(connection, "org.freedesktop.DBus", "/org/freedesktop/DBus",
+              "org.freedesktop.DBus", method, parameters);
+}
+
+std::string NameOwner(GDBusConnection* connection) {
+  GVariant* reply =
+      CallBus(connection, "GetNameOwner", g_variant_new("(s)", kBusName));
+  if (reply == nullptr) return std::string();
+  const gchar* owner = nullptr;
+  g_variant_get(reply, "(&s)", &owner);
+  std::string result = owner;
+  g_variant_unref(reply);
+  return result;
+}
+
+// Properties.Get on the service; null on error.
+GVariant* GetProperty(GDBusConnection* connection, const char* interface_name,
+                      const char* property) {
+  GVariant* reply = Call(connection, kBusName, kObjectPath,
+                         "org.freedesktop.DBus.Properties", "Get",
+                         g_variant_new("(ss)", interface_name, property));
+  if (reply == nullptr) return nullptr;
+  GVariant* value = nullptr;
+  g_variant_get(reply, "(v)", &value);
+  g_variant_unref(reply);
+  return value;
+}
+
+std::string GetString(GDBusConnection* connection,
+                      const char* interface_name, const char* property) {
+  GVariant* value = GetProperty(connection, interface_name, property);
+  if (value == nullptr) return "<error>";
+  std::string result = g_variant_is_of_type(value, G_VARIANT_TYPE_STRING)
+                           ? g_variant_get_string(value, nullptr)
+                           : "<not a string>";
+  g_variant_unref(value);
+  return result;
+}
+
+// PropertiesChanged signals seen by the client.
+struct Signals {
+  int count = 0;
+  std::set<std::string> keys;
+  std::string playback_status;
+  std::string title;
+};
+
+void OnPropertiesChanged(GDBusConnection* connection, const gchar* sender,
+                         const gchar* object_path,
+                         const gchar* interface_name,
+                         const gchar* signal_name, GVariant* parameters,
+                         gpointer user_data) {
+  auto* signals = static_cast<Signals*>(user_data);
+  ++signals->count;
+  GVariant* changed = g_variant_get_child_value(parameters, 1);
+  GVariantIter iter;
+  g_variant_iter_init(&iter, changed);
+  const gchar* key = nullptr;
+  GVariant* value = nullptr;
+  while (g_variant_iter_next(&iter, "{&sv}", &key, &value)) {
+    signals->keys.insert(key);
+    if (strcmp(key, "PlaybackStatus") == 0) {
+      signals->playback_status = g_variant_get_string(value, nullptr);
+    } else if (strcmp(key, "Metadata") == 0) {
+      const gchar* title = nullptr;
+      if (g_variant_lookup(value, "xesam:title", "&s", &title)) {
+        signals->title = title;
+      }
+    }
+    g_variant_unref(value);
+  }
+  g_variant_unref(changed);
+}
+
+// Spawns a private session bus; false when dbus-daemon cannot be run.
+bool StartBus(GPid* pid, std::string* address) {
+  gchar* argv[] = {const_cast<gchar*>("dbus-daemon"),
+                   const_cast<gchar*>("--session"),
+                   const_cast<gchar*>("--print-address"),
+                   const_cast<gchar*>("--nofork"), nullptr};
+  gint out_fd = -1;
+  if (!g_spawn_async_with_pipes(nullptr, argv, nullptr, G_SPAWN_SEARCH_PATH,
+                                nullptr, nullptr, pid, nullptr, &out_fd,
+                                nullptr, nullptr)) {
+    return false;
+  }
+  FILE* out = fdopen(out_fd, "r");
+  char line[512] = {};
+  const bool got_line = out != nullptr && fgets(line, sizeof(line), out);
+  if (out != nullptr) fclose(out);
+  if (!got_line) {
+    kill(*pid, SIGTERM);
+    g_spawn_close_pid(*pid);
+    return false;
+  }
+  line[strcspn(line, "\r\n")] = '\0';
+  *address = line;
+  return !address->empty();
+}
+
+void CheckProperties(GDBusConnection* client) {
+  Expect(GetString(client, kRootInterface, "Identity") == "Cyrene Music",
+         "Identity");
+  Expect(GetString(client, kRootInterface, "DesktopEntry") == kDesktopEntry,
+         "DesktopEntry");
+  Expect(GetString(client, kPlayerInterface, "PlaybackStatus") == "Stopped",
+         "PlaybackStatus before any update");
+  GVariant* position = GetProperty(client, kPlayerInterface, "Position");
+  Expect(position != nullptr &&
+             g_variant_is_of_type(position, G_VARIANT_TYPE_INT64),
+         "Position is an int64");
+  if (position != nullptr) g_variant_unref(position);
+}
+
+void CheckBatchedSignal(GDBusConnection* client, MprisService* service) {
+  Signals signals;
+  const guint subscription = g_dbus_connection_signal_subscribe(
+      client, nullptr, "org.freedesktop.DBus.Properties", "PropertiesChanged",
+      kObjectPath, nullptr, G_DBUS_SIGNAL_FLAGS_NONE, OnPropertiesChanged,
+      &signals, nullptr);
+  // A round trip, so the match rule is in place before anything is sent.
+  NameOwner(client);
+
+  cyrene_music::MprisState::Metadata metadata;
+  metadata.title = "Tick";
+  metadata.artist = "Bench";
+  service->state().SetMetadata(metadata);
+  service->Changed();
+  service->state().SetPlaybackStatus("playing");
+  service->Changed();
+  service->state().SetLength(180000000);
+  service->Changed();
+  service->state().SetPlaybackStatus("paused");
+  service->Changed();
+  PumpFor(400);
+
+  Expect(signals.count == 1, "one PropertiesChanged for a burst of changes");
+  Expect(signals.keys.count("PlaybackStatus") == 1 &&
+             signals.keys.count("Metadata") == 1,
+         "the signal carries PlaybackStatus and Metadata");
+  Expect(signals.playback_status == "Paused",
+         "the signal has the last status");
+  Expect(signals.title == "Tick", "the signal has the metadata");
+  g_dbus_connection_signal_unsubscribe(client, subscription);
+}
+
+void CheckButtons(GDBusConnection* client,
+                  const std::vector<std::string>& buttons) {
+  for (const char* method : {"PlayPause", "Next", "Stop"}) {
+    GVariant* reply = Call(client, kBusName, kObjectPath, kPlayerInterface,
+                           method, nullptr);
+    if (reply != nullptr) g_variant_unref(reply);
+  }
+  // Paused at this point, so PlayPause means play.
+  Expect(buttons == std::vector<std::string>({"play", "next", "stop"}),
+         "player methods come back as buttons");
+}
+
+void CheckNameTaken(GDBusConnection* client, MprisService* service) {
+  service->Disable();
+  Expect(Pump([&] { return NameOwner(client).empty(); }, 2000),
+         "Disable releases the name");
+
+  // DBUS_NAME_FLAG_DO_NOT_QUEUE; 1 is DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER.
+  GVariant* reply =
+      CallBus(client, "RequestName", g_variant_new("(su)", kBusName, 4u));
+  guint32 result = 0;
+  if (reply != nullptr) {
+    g_variant_get(reply, "(u)", &result);
+    g_variant_unref(reply);
+  }
+  Expect(result == 1, "the client takes the name");
+
+  service->Enable();
+  PumpFor(300);
+  Expect(!service->on_bus(), "the service stays off the bus while refused");
+  Expect(NameOwner(client) == g_dbus_connection_get_unique_name(client),
+         "the client keeps the name");
+
+  reply = CallBus(client, "ReleaseName", g_variant_new("(s)", kBusName));
+  if (reply != nullptr) g_variant_unref(reply);
+  const int retry_ms = static_cast<int>(MprisService::kOwnRetryBaseMs) * 2;
+  Expect(Pump([&] { return service->on_bus(); }, retry_ms + 1000),
+         "the service takes the name once it is released");
+  const std::string owner = NameOwner(client);
+  Expect(!owner.empty() && owner != g_dbus_connection_get_unique_name(client),
+         "the service owns the name");
+  Expect(GetString(client, kPlayerInterface, "PlaybackStatus") == "Paused",
+         "the objects are registered again");
+}
+
+}  // namespace
+
+int main() {
+  GPid bus_pid = 0;
+  std::string address;
+  if (!StartBus(&bus_pid, &address)) {
+    std::printf("dbus-daemon not available, nothing checked\n");
+    return 0;
+  }
+  g_setenv("DBUS_SESSION_BUS_ADDRESS", address.c_str(), TRUE);
+  // The service's connection; it must not exit the process when the bus
+  // is stopped at the end.
+  GDBusConnection* session = g_bus_get_sync(G_BUS_TYPE_SESSION, nullptr,
+                                            nullptr);
+  if (session != nullptr) g_dbus_connection_set_exit_on_close(session, FALSE);
+
+  GDBusConnection* client = g_dbus_connection_new_for_address_sync(
+      address.c_str(),
+      static_cast<GDBusConnectionFlags>(
+          G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+          G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION),
+      nullptr, nullptr, nullptr);
+  if (client == nullptr) {
+    std::printf("FAIL: could not connect to %s\n", address.c_str());
+    kill(bus_pid, SIGTERM);
+    g_spawn_close_pid(bus_pid);
+    return 1;
+  }
+
+  {
+    std::vector<std::string> buttons;
+    MprisService service(kDesktopEntry, [&](const char* button) {
+      buttons.push_back(button);
+    });
+    service.Enable();
+    Expect(Pump([&] { return service.on_bus(); }, 3000), "the name is owned");
+    Expect(!NameOwner(client).empty(), "the bus reports an owner");
+
+    CheckProperties(client);
+    CheckBatchedSignal(client, &service);
+    CheckButtons(client, buttons);
+    CheckNameTaken(client, &service);
+    service.Disable();
+  }
+
+  g_object_unref(client);
+  if (session != nullptr) g_object_unref(session);
+  kill(bus_pid, SIGTERM);
+  g_spawn_close_pid(bus_pid);
+
+  std::printf("%s\n", g_ok ? "OK" : "FAILED");
+  return g_ok ? 0 : 1;
+}
@@ -0,0 +1,364 @@
+// Benchmark for the album-art palette extractor.
+//
+// Renders synthetic 1000x1000 RGBA covers (soft colour fields with noise,
+// one with a transparent border) and extracts their palettes two ways: a
+// replica of ColorExtractionService's isolate code (copyResize with
+// Interpolation.average, then per pixel a hash map insert, a boxed list for
+// max/min and double HSL, then sorting the map entries) and
+// PaletteExtractor, whole cover and the bottom 30% region the mobile player
+// asks for. Every palette must equal the replica's, so a faster but
+// different answer fails the run. Also times a round trip through
+// PaletteWorker, the path Dart takes.
+//
+// The replica runs as C++, so it understates what the Dart version costs;
+// decoding the cover and spawning an isolate per cover are not included.
+//
+// Usage: palette_bench [covers] [sample_size]
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "cover/palette_extractor.h"
+
+namespace {
+
+using cyrene_music::Palette;
+using cyrene_music::PaletteExtractor;
+using cyrene_music::PaletteRegion;
+
+constexpr int kSourceSize = 1000;
+
+struct Image {
+  int width = 0;
+  int height = 0;
+  std::vector<uint8_t> rgba;
+};
+
+uint32_t Next(uint32_t* state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state >> 8;
+}
+
+// A few colour fields blended by distance, plus noise, so the histogram has
+// clear winners and a long tail like real artwork.
+Image RenderCover(uint32_t seed, bool transparent_border) {
+  Image image;
+  image.width = kSourceSize;
+  image.height = kSourceSize;
+  image.rgba.resize(static_cast<size_t>(kSourceSize) * kSourceSize * 4);
+  struct Field {
+    int x, y;
+    int r, g, b;
+  };
+  uint32_t state = seed * 2654435761u + 1;
+  Field fields[4];
+  for (Field& field : fields) {
+    field.x = static_cast<int>(Next(&state) % kSourceSize);
+    field.y = static_cast<int>(Next(&state) % kSourceSize);
+    field.r = static_cast<int>(Next(&state) & 0xFF);
+    field.g = static_cast<int>(Next(&state) & 0xFF);
+    field.b = static_cast<int>(Next(&state) & 0xFF);
+  }
+  for (int y = 0; y < kSourceSize; ++y) {
+    for (int x = 0; x < kSourceSize; ++x) {
+      int best = 0;
+      int64_t best_distance = INT64_MAX;
+      for (int i = 0; i < 4; ++i) {
+        const int64_t dx = x - fields[i].x;
+        const int64_t dy = y - fields[i].y;
+        if (dx * dx + dy * dy < best_distance) {
+          best_distance = dx * dx + dy * dy;
+          best = i;
+        }
+      }
+      const int noise = static_cast<int>(Next(&state) % 24) - 12;
+      uint8_t* pixel = &image.rgba[(static_cast<size_t>(y) * kSourceSize +
+                                    x) * 4];
+      pixel[0] = static_cast<uint8_t>(std::clamp(fields[best].r + noise, 0,
+                                                 255));
+      pixel[1] = static_cast<uint8_t>(std::clamp(fields[best].g + noise, 0,
+                                                 255));
+      pixel[2] = static_cast<uint8_t>(std::clamp(fields[best].b - noise, 0,
+                                                 255));
+      const bool border = x < 100 || y < 100 || x >= kSourceSize - 100 ||
+                          y >= kSourceSize - 100;
+      pixel[3] = transparent_border && border ? 0 : 255;
+    }
+  }
+  return image;
+}
+
+// Insertion-ordered counter, as Dart's default LinkedHashMap iterates.
+struct OrderedCounts {
+  std::unordered_map<int, size_t> index;
+  std::vector<std::pair<int, int>> entries;
+
+  void Add(int key) {
+    auto [it, inserted] = index.emplace(key, entries.size());
+    if (inserted) entries.emplace_back(key, 0);
+    ++entries[it->second].second;
+  }
+
+  std::vector<std::pair<int, int>> Sorted() const {
+    std::vector<std::pair<int, int>> sorted = entries;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const auto& a, const auto& b) {
+                       return a.second > b.second;
+                     });
+    return sorted;
+  }
+};
+
+double ReplicaLightness(int value) {
+  const std::vector<int> channels{(value >> 16) & 0xFF, (value >> 8) & 0xFF,
+                                  value & 0xFF};
+  const int max = *std::max_element(channels.begin(), channels.end());
+  const int min = *std::min_element(channels.begin(), channels.end());
+  return (max + min) / 2.0 / 255;
+}
+
+void ReplicaPick(const OrderedCounts& counts, uint32_t* main, uint32_t* light,
+                 uint32_t* dark) {
+  if (counts.entries.empty()) return;
+  const auto sorted = counts.Sorted();
+  *main = static_cast<uint32_t>(sorted.front().first);
+  for (const auto& entry : sorted) {
+    const double lightness = ReplicaLightness(entry.first);
+    if (lightness > 0.6 && *light == 0) {
+      *light = static_cast<uint32_t>(entry.first);
+    } else if (lightness < 0.4 && *dark == 0) {
+      *dark = static_cast<uint32_t>(entry.first);
+    }
+    if (*light != 0 && *dark != 0) break;
+  }
+}
+
+// _extractColorsInIsolate after decoding.
+Palette Replica(const Image& source, const PaletteRegion* region,
+                int sample_size) {
+  Image image = source;
+  if (region != nullptr) {
+    const int x = std::clamp(region->x, 0, source.width - 1);
+    const int y = std::clamp(region->y, 0, source.height - 1);
+    const int width = std::min(region->width, source.width - x);
+    const int height = std::min(region->height, source.height - y);
+    image.width = width;
+    image.height = height;
+    image.rgba.assign(static_cast<size_t>(width) * height * 4, 0);
+    for (int row = 0; row < height; ++row) {
+      std::copy_n(&source.rgba[(static_cast<size_t>(y + row) * source.width +
+                                x) * 4],
+                  static_cast<size_t>(width) * 4,
+                  &image.rgba[static_cast<size_t>(row) * width * 4]);
+    }
+  }
+
+  std::vector<uint8_t> resized(static_cast<size_t>(sample_size) *
+                               sample_size * 4);
+  const double dx = static_cast<double>(image.width) / sample_size;
+  const double dy = static_cast<double>(image.height) / sample_size;
+  for (int y = 0; y < sample_size; ++y) {
+    const int ay1 = static_cast<int>(y * dy);
+    int ay2 = static_cast<int>((y + 1) * dy);
+    if (ay2 == ay1) ++ay2;
+    for (int x = 0; x < sample_size; ++x) {
+      const int ax1 = static_cast<int>(x * dx);
+      int ax2 = static_cast<int>((x + 1) * dx);
+      if (ax2 == ax1) ++ax2;
+      double sum[4] = {};
+      int count = 0;
+      for (int sy = ay1; sy < ay2; ++sy) {
+        for (int sx = ax1; sx < ax2; ++sx) {
+          const uint8_t* pixel =
+              &image.rgba[(static_cast<size_t>(sy) * image.width + sx) * 4];
+          for (int c = 0; c < 4; ++c) sum[c] += pixel[c];
+          ++count;
+        }
+      }
+      for (int c = 0; c < 4; ++c) {
+        resized[(static_cast<size_t>(y) * sample_size + x) * 4 + c] =
+            static_cast<uint8_t>(sum[c] / count);
+      }
+    }
+  }
+
+  OrderedCounts colors;
+  OrderedCounts vibrant;
+  OrderedCounts muted;
+  for (int i = 0; i < sample_size * sample_size; ++i) {
+    const uint8_t* pixel = &resized[static_cast<size_t>(i) * 4];
+    if (pixel[3] < 128) continue;
+    const int r = pixel[0];
+    const int g = pixel[1];
+    const int b = pixel[2];
+    const int value = static_cast<int>(0xFF000000u) | ((r / 8 * 8) << 16) |
+                      ((g / 8 * 8) << 8) | (b / 8 * 8);
+    colors.Add(value);
+    // [r, g, b].reduce(...) allocates a list per pixel in Dart.
+    const auto channels = std::make_unique<std::vector<int>>(
+        std::vector<int>{r, g, b});
+    const int max = *std::max_element(channels->begin(), channels->end());
+    const int min = *std::min_element(channels->begin(), channels->end());
+    const double lightness = (max + min) / 2.0 / 255;
+    const double saturation =
+        max == min ? 0.0
+                   : (max - min) / (255 - std::abs(2 * lightness * 255 - 255));
+    if (saturation > 0.35 && lightness > 0.2 && lightness < 0.8) {
+      vibrant.Add(value);
+    } else if (saturation < 0.35 && lightness > 0.2 && lightness < 0.8) {
+      muted.Add(value);
+    }
+  }
+
+  Palette palette;
+  if (!colors.entries.empty()) {
+    palette.colors[Palette::kDominant] =
+        static_cast<uint32_t>(colors.Sorted().front().first);
+  }
+  ReplicaPick(vibrant, &palette.colors[Palette::kVibrant],
+              &palette.colors[Palette::kLightVibrant],
+              &palette.colors[Palette::kDarkVibrant]);
+  ReplicaPick(muted, &palette.colors[Palette::kMuted],
+              &palette.colors[Palette::kLightMuted],
+              &palette.colors[Palette::kDarkMuted]);
+  return palette;
+}
+
+bool SamePalette(const Palette& a, const Palette& b) {
+  return std::equal(std::begin(a.colors), std::end(a.colors),
+                    std::begin(b.colors));
+}
+
+void PrintPalette(const char* label, const Palette& palette) {
+  std::printf("  %-8s", label);
+  for (uint32_t color : palette.colors) std::printf(" %08x", color);
+  std::printf("\n");
+}
+
+double Ms(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+std::mutex done_mutex;
+std::condition_variable done_changed;
+int done_count = 0;
+
+void OnDone(int64_t id, int32_t ok) {
+  std::lock_guard<std::mutex> lock(done_mutex);
+  ++done_count;
+  done_changed.notify_all();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int covers = 16;
+  int sample_size = 32;
+  if (argc > 1) covers = std::atoi(argv[1]);
+  if (argc > 2) sample_size = std::atoi(argv[2]);
+  if (covers <= 0 || sample_size <= 0) {
+    std::fprintf(stderr, "usage: %s [covers] [sample_size]\n", argv[0]);
+    return 1;
+  }
+
+  std::vector<Image> images;
+  for (int i = 0; i < covers; ++i) {
+    images.push_back(RenderCover(static_cast<uint32_t>(i), i % 4 == 3));
+  }
+  // Bottom 30%, as PlayerService asks for on mobile; the second one runs
+  // off the image and is clamped.
+  const PaletteRegion regions[] = {
+      {0, kSourceSize * 7 / 10, kSourceSize, kSourceSize * 3 / 10},
+      {kSourceSize / 2, kSourceSize / 2, kSourceSize, kSourceSize},
+  };
+
+  bool ok = true;
+  PaletteExtractor extractor;
+  double replica_ms = 0;
+  double native_ms = 0;
+  int extractions = 0;
+  for (int i = 0; i < covers; ++i) {
+    const Image& image = images[i];
+    const PaletteRegion* cases[] = {nullptr, &regions[0], &regions[1]};
+    for (const PaletteRegion* region : cases) {
+      auto start = std::chrono::steady_clock::now();
+      const Palette expected = Replica(image, region, sample_size);
+      replica_ms += Ms(start);
+
+      start = std::chrono::steady_clock::now();
+      Palette palette;
+      const bool extracted =
+          extractor.Extract(image.rgba.data(), image.width, image.height,
+                            static_cast<size_t>(image.width) * 4, region,
+                            sample_size, &palette);
+      native_ms += Ms(start);
+      ++extractions;
+
+      if (!extracted || !SamePalette(palette, expected)) {
+        std::printf("FAIL: cover %d%s palette differs from the replica\n", i,
+                    region ? " (region)" : "");
+        PrintPalette("replica", expected);
+        PrintPalette("native", palette);
+        ok = false;
+      }
+    }
+  }
+
+  // Nothing left after the crop, and an empty input.
+  Palette palette;
+  const PaletteRegion empty{10, 10, 0, 10};
+  if (extractor.Extract(images[0].rgba.data(), kSourceSize, kSourceSize,
+                        kSourceSize * 4, &empty, sample_size, &palette)) {
+    std::printf("FAIL: an empty region produced a palette\n");
+    ok = false;
+  }
+
+  // Worker round trips, the way Dart submits them.
+  std::vector<uint32_t> colors(static_cast<size_t>(covers) *
+                               Palette::kSwatchCount);
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < covers; ++i) {
+    cyrene_palette_submit(images[i].rgba.data(), kSourceSize, kSourceSize, 0,
+                          nullptr, sample_size,
+                          &colors[static_cast<size_t>(i) *
+                                  Palette::kSwatchCount],
+                          i, &OnDone);
+  }
+  {
+    std::unique_lock<std::mutex> lock(done_mutex);
+    done_changed.wait(lock, [&] { return done_count == covers; });
+  }
+  const double worker_ms = Ms(start);
+  for (int i = 0; i < covers; ++i) {
+    Palette expected;
+    extractor.Extract(images[i].rgba.data(), kSourceSize, kSourceSize,
+                      kSourceSize * 4, nullptr, sample_size, &expected);
+    if (!std::equal(std::begin(expected.colors), std::end(expected.colors),
+                    &colors[static_cast<size_t>(i) * Palette::kSwatchCount])) {
+      std::printf("FAIL: worker palette for cover %d differs\n", i);
+      ok = false;
+    }
+  }
+
+  std::printf("covers                      %d (%dx%d RGBA, %d samples)\n",
+              covers, kSourceSize, kSourceSize, sample_size);
+  std::printf("replica (isolate code)      %8.3f ms/palette\n",
+              replica_ms / extractions);
+  std::printf("PaletteExtractor            %8.3f ms/palette\n",
+              native_ms / extractions);
+  std::printf("PaletteWorker round trip    %8.3f ms/cover\n",
+              worker_ms / covers);
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,453 @@
+// Checks and measures SegmentedDownloader against a local HTTP server.
+//
+// The server is a small blocking HTTP/1.1 server on 127.0.0.1 that serves a
+// synthetic song with range support, an ETag and, like a far-away CDN, a
+// delay before each response and a per-connection bandwidth cap. Other
+// routes ignore ranges, drop connections midway, redirect or 404. The
+// bench checks every download byte for byte, that a cancelled download
+// resumes by fetching only what it lacked, that a changed file starts
+// over, that a failure leaves no state file behind, and that progress
+// events stay within their rate; then compares one connection with
+// several.
+//
+// Usage: segmented_download_bench [megabytes] [directory]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+#include "net/http_message.h"
+#include "net/segmented_downloader.h"
+#include "net/socket.h"
+
+namespace {
+
+using cyrene_music::CloseSocket;
+using cyrene_music::DownloadEvent;
+using cyrene_music::DownloadOptions;
+using cyrene_music::HttpRequestHead;
+using cyrene_music::kInvalidSocket;
+using cyrene_music::kSendFlags;
+using cyrene_music::SegmentedDownloader;
+using cyrene_music::ShutdownSocket;
+using cyrene_music::SocketHandle;
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+bool SendAll(SocketHandle s, const char* data, size_t size) {
+  while (size > 0) {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const auto n = send(s, data, chunk, kSendFlags);
+    if (n <= 0) return false;
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool SendAll(SocketHandle s, const std::string& data) {
+  return SendAll(s, data.data(), data.size());
+}
+
+// The test server: one thread per connection, one request each.
+class Server {
+ public:
+  ~Server() { Stop(); }
+
+  bool Start() {
+    listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener_, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(listener_, 64) != 0 ||
+        getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0) {
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+    thread_ = std::thread([this] { AcceptLoop(); });
+    return true;
+  }
+
+  void Stop() {
+    if (listener_ == kInvalidSocket) return;
+    stopping_ = true;
+    ShutdownSocket(listener_);
+    CloseSocket(listener_);
+    thread_.join();
+    listener_ = kInvalidSocket;
+    while (active_ > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  std::string Url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(port_) + path;
+  }
+
+  // The song and its ETag; swapped between runs only.
+  void SetContent(std::string content, std::string etag) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    content_ = std::move(content);
+    etag_ = std::move(etag);
+  }
+
+  // Per response: delay before the head, and bytes per second per
+  // connection (0 for no cap).
+  std::atomic<int> latency_ms{0};
+  std::atomic<uint64_t> bytes_per_second{0};
+  // /flaky drops this many connections after sending half their range.
+  std::atomic<int> drops{0};
+
+  std::atomic<uint64_t> requests{0};
+  std::atomic<uint64_t> body_bytes{0};
+
+ private:
+  void AcceptLoop() {
+    while (!stopping_) {
+      const SocketHandle client = accept(listener_, nullptr, nullptr);
+      if (client == kInvalidSocket) continue;
+      ++active_;
+      std::thread([this, client] {
+        Serve(client);
+        CloseSocket(client);
+        --active_;
+      }).detach();
+    }
+  }
+
+  // Sends |size| bytes of the body, paced to the bandwidth cap; false if
+  // the client went away.
+  bool SendBody(SocketHandle s, const char* data, size_t size) {
+    const uint64_t rate = bytes_per_second.load();
+    const size_t block = 64 * 1024;
+    const Clock::time_point start = Clock::now();
+    size_t sent = 0;
+    while (sent < size) {
+      const size_t n = std::min(block, size - sent);
+      if (!SendAll(s, data + sent, n)) return false;
+      sent += n;
+      body_bytes += n;
+      if (rate > 0) {
+        std::this_thread::sleep_until(
+            start + std::chrono::microseconds(sent * 1000000 / rate));
+      }
+    }
+    return true;
+  }
+
+  void Serve(SocketHandle s) {
+    std::string in;
+    char chunk[4096];
+    while (in.find("\r\n\r\n") == std::string::npos) {
+      const auto n = recv(s, chunk, sizeof(chunk), 0);
+      if (n <= 0) return;
+      in.append(chunk, static_cast<size_t>(n));
+    }
+    HttpRequestHead request;
+    if (!HttpRequestHead::Parse(in.substr(0, in.find("\r\n\r\n")),
+                                &request)) {
+      return;
+    }
+    ++requests;
+    std::string content;
+    std::string etag;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      content = content_;
+      etag = etag_;
+    }
+    if (latency_ms > 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(latency_ms));
+    }
+
+    const std::string& path = request.target;
+    if (path == "/redirect") {
+      SendAll(s,
+              "HTTP/1.1 302 Found\r\nLocation: /file\r\n"
+              "Content-Length: 0\r\nConnection: close\r\n\r\n");
+      return;
+    }
+    if (path != "/file" && path != "/flaky" && path != "/norange") {
+      SendAll(s,
+              "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+              "Connection: close\r\n\r\n");
+      return;
+    }
+
+    size_t first = 0;
+    size_t last = content.size() - 1;
+    const std::string* range = request.headers.Find("range");
+    const bool ranged = range != nullptr && path != "/norange";
+    if (ranged) {
+      const int fields =
+          std::sscanf(range->c_str(), "bytes=%zu-%zu", &first, &last);
+      if (fields < 2) last = content.size() - 1;
+      last = std::min(last, content.size() - 1);
+    }
+    const size_t length = last - first + 1;
+    std::string head = ranged ? "HTTP/1.1 206 Partial Content\r\n"
+                              : "HTTP/1.1 200 OK\r\n";
+    head += "Content-Type: audio/flac\r\nETag: " + etag + "\r\n";
+    if (path != "/norange") head += "Accept-Ranges: bytes\r\n";
+    if (ranged) {
+      head += "Content-Range: bytes " + std::to_string(first) + "-" +
+              std::to_string(last) + "/" + std::to_string(content.size()) +
+              "\r\n";
+    }
+    head += "Content-Length: " + std::to_string(length) +
+            "\r\nConnection: close\r\n\r\n";
+    if (!SendAll(s, head)) return;
+
+    size_t send = length;
+    if (path == "/flaky" && length > 2 && drops.fetch_sub(1) > 0) {
+      send = length / 2;
+    }
+    SendBody(s, content.data() + first, send);
+  }
+
+  SocketHandle listener_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> active_{0};
+  std::mutex mutex_;
+  std::string content_;
+  std::string etag_;
+};
+
+std::string ReadFile(const std::string& path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) return std::string();
+  return std::string(std::istreambuf_iterator<char>(file),
+                     std::istreambuf_iterator<char>());
+}
+
+bool Exists(const std::string& path) {
+  return static_cast<bool>(std::ifstream(path, std::ios::binary));
+}
+
+std::string RandomContent(size_t size, unsigned seed) {
+  std::string content(size, '\0');
+  std::mt19937 random(seed);
+  for (char& c : content) c = static_cast<char>(random());
+  return content;
+}
+
+struct Run {
+  DownloadEvent done;
+  double ms = 0;
+  // Events posted while it ran, done included.
+  int events = 0;
+};
+
+// Downloads |url| to |path| and waits for the done event.
+Run Download(SegmentedDownloader* downloader, std::atomic<int>* posts,
+             int64_t id, const std::string& url, const std::string& path,
+             size_t connections, uint64_t min_segment = 1024 * 1024) {
+  DownloadOptions options;
+  options.url = url;
+  options.path = path;
+  options.connections = connections;
+  options.min_segment_size = min_segment;
+  options.timeout_seconds = 5;
+  Run run;
+  const int posts_before = posts->load();
+  const Clock::time_point start = Clock::now();
+  downloader->Start(id, std::move(options));
+  downloader->Wait(id);
+  run.ms = Milliseconds(Clock::now() - start);
+  run.events = posts->load() - posts_before;
+  for (DownloadEvent& event : downloader->TakeEvents()) {
+    if (event.id == id && event.done) run.done = std::move(event);
+  }
+  return run;
+}
+
+bool Expect(bool condition, const char* what, bool* ok) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    *ok = false;
+  }
+  return condition;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t megabytes =
+      argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 16;
+  const std::string directory = argc > 2 ? argv[2] : ".";
+  const std::string path = directory + "/segmented_download_bench.flac";
+  bool ok = true;
+  if (!cyrene_music::InitSockets()) return 1;
+
+  Server server;
+  const std::string song = RandomContent(megabytes * 1024 * 1024 + 777, 5);
+  server.SetContent(song, "\"v1\"");
+  if (!server.Start()) {
+    std::printf("FAIL: cannot start the server\n");
+    return 1;
+  }
+
+  SegmentedDownloader downloader;
+  std::atomic<int> posts{0};
+  downloader.SetNotify([&posts] { ++posts; });
+  SegmentedDownloader::Discard(path);
+  std::remove(path.c_str());
+  int64_t id = 1;
+
+  // A CDN far away: 30 ms to the first byte, and each connection capped so
+  // that four take about a second whatever the size.
+  server.latency_ms = 30;
+  server.bytes_per_second = song.size() / 4;
+
+  // One connection, then four.
+  const Run single =
+      Download(&downloader, &posts, id++, server.Url("/file"), path, 1);
+  Expect(single.done.error.empty() && ReadFile(path) == song,
+         "one connection", &ok);
+  std::remove(path.c_str());
+  const Run parallel =
+      Download(&downloader, &posts, id++, server.Url("/file"), path, 4);
+  Expect(parallel.done.error.empty() && ReadFile(path) == song,
+         "four connections", &ok);
+  // Below 4 MB the 1 MB minimum segment leaves fewer connections.
+  const uint32_t planned = static_cast<uint32_t>(
+      std::min<uint64_t>(4, std::max<uint64_t>(1, song.size() >> 20)));
+  Expect(parallel.done.connections == planned &&
+             parallel.done.received == song.size() &&
+             parallel.done.total == song.size(),
+         "four connections totals", &ok);
+  Expect(!Exists(path + ".part") && !Exists(path + ".part.state"),
+         "partial files removed", &ok);
+  // 200 ms apart, plus the done event and one for rounding.
+  const int allowed = static_cast<int>(parallel.ms / 200) + 2;
+  Expect(parallel.events >= 2 && parallel.events <= allowed,
+         "progress event rate", &ok);
+  std::remove(path.c_str());
+
+  // Cancel midway, then resume.
+  DownloadOptions options;
+  options.url = server.Url("/file");
+  options.path = path;
+  options.connections = 4;
+  options.timeout_seconds = 5;
+  const int64_t cancelled_id = id++;
+  downloader.Start(cancelled_id, options);
+  uint64_t received = 0;
+  while (received < song.size() * 2 / 5) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    for (const DownloadEvent& event : downloader.TakeEvents()) {
+      if (event.id == cancelled_id) received = event.received;
+    }
+  }
+  downloader.Cancel(cancelled_id);
+  downloader.Wait(cancelled_id);
+  DownloadEvent cancelled;
+  for (DownloadEvent& event : downloader.TakeEvents()) {
+    if (event.id == cancelled_id && event.done) cancelled = std::move(event);
+  }
+  Expect(cancelled.error == "Cancelled" && Exists(path + ".part.state") &&
+             !Exists(path),
+         "cancel keeps the state", &ok);
+  const uint64_t served_before = server.body_bytes.load();
+  const Run resumed =
+      Download(&downloader, &posts, id++, server.Url("/file"), path, 4);
+  const uint64_t served = server.body_bytes.load() - served_before;
+  Expect(resumed.done.error.empty() && ReadFile(path) == song,
+         "resumed download", &ok);
+  Expect(resumed.done.resumed >= cancelled.received / 2 &&
+             resumed.done.resumed <= cancelled.received,
+         "resumed from the state", &ok);
+  // Only what was missing, give or take the blocks in flight at the cancel.
+  Expect(served <= song.size() - resumed.done.resumed + 4 * 256 * 1024,
+         "resume fetches only the rest", &ok);
+  std::printf("%-30s %8.1f%% resumed, %.1f MB fetched again\n",
+              "cancel at ~40%, resume",
+              100.0 * static_cast<double>(resumed.done.resumed) /
+                  static_cast<double>(song.size()),
+              static_cast<double>(served) / (1024.0 * 1024.0));
+  std::remove(path.c_str());
+
+  // Cancel, then the file changes on the server: start over.
+  const int64_t changed_id = id++;
+  downloader.Start(changed_id, options);
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+  downloader.Cancel(changed_id);
+  downloader.Wait(changed_id);
+  downloader.TakeEvents();
+  const std::string updated = RandomContent(song.size(), 6);
+  server.SetContent(updated, "\"v2\"");
+  const Run restarted =
+      Download(&downloader, &posts, id++, server.Url("/file"), path, 4);
+  Expect(restarted.done.error.empty() && restarted.done.resumed == 0 &&
+             ReadFile(path) == updated,
+         "changed file starts over", &ok);
+  std::remove(path.c_str());
+  server.SetContent(song, "\"v1\"");
+
+  // The rest at full speed.
+  server.latency_ms = 0;
+  server.bytes_per_second = 0;
+
+  const Run no_range =
+      Download(&downloader, &posts, id++, server.Url("/norange"), path, 4);
+  Expect(no_range.done.error.empty() && no_range.done.connections == 1 &&
+             ReadFile(path) == song,
+         "server without ranges", &ok);
+  std::remove(path.c_str());
+
+  server.drops = 3;
+  const Run flaky =
+      Download(&downloader, &posts, id++, server.Url("/flaky"), path, 4);
+  Expect(flaky.done.error.empty() && ReadFile(path) == song,
+         "dropped connections retried", &ok);
+  std::remove(path.c_str());
+
+  const Run redirected =
+      Download(&downloader, &posts, id++, server.Url("/redirect"), path, 4);
+  Expect(redirected.done.error.empty() && ReadFile(path) == song,
+         "redirect followed", &ok);
+  std::remove(path.c_str());
+
+  // Small segments: idle connections keep splitting the tail.
+  const Run split = Download(&downloader, &posts, id++, server.Url("/file"),
+                             path, 8, 256 * 1024);
+  Expect(split.done.error.empty() && ReadFile(path) == song,
+         "fine-grained splitting", &ok);
+  std::remove(path.c_str());
+
+  const Run missing =
+      Download(&downloader, &posts, id++, server.Url("/missing"), path, 4);
+  // Looking for a saved state must not leave an empty one behind.
+  Expect(missing.done.error == "HTTP 404" && !Exists(path) &&
+             !Exists(path + ".part") && !Exists(path + ".part.state"),
+         "404 reported", &ok);
+
+  const double mb = static_cast<double>(song.size()) / (1024.0 * 1024.0);
+  std::printf("%-30s %8.1f ms %8.1f MB/s\n", "1 connection", single.ms,
+              mb / (single.ms / 1000.0));
+  std::printf("%-30s %8.1f ms %8.1f MB/s  %d events\n", "4 connections",
+              parallel.ms, mb / (parallel.ms / 1000.0), parallel.events);
+  std::printf("%-30s %8.1f ms\n", "resume", resumed.ms);
+
+  downloader.SetNotify(nullptr);
+  server.Stop();
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,537 @@
+// Checks and measures StreamProxy against a local stand-in upstream.
+//
+// The stand-in is a small blocking HTTP/1.1 server on 127.0.0.1 that
+// serves a synthetic song with range support, the same bytes chunked and
+// close-delimited, a redirect, an HLS playlist and a 404, and records the
+// headers of the last request it saw. The bench drives the proxy the way a
+// player does (the ProxyService URL contract, keep-alive, range requests)
+// and checks bodies, status codes, the rewritten request headers and the
+// rewritten playlist, then compares relay throughput and time to first
+// byte with fetching straight from the stand-in.
+//
+// Usage: stream_proxy_bench [megabytes]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "net/http_message.h"
+#include "net/socket.h"
+#include "net/stream_proxy.h"
+
+namespace {
+
+using cyrene_music::CloseSocket;
+using cyrene_music::EncodeUriComponent;
+using cyrene_music::HttpHeaders;
+using cyrene_music::HttpRequestHead;
+using cyrene_music::kInvalidSocket;
+using cyrene_music::kSendFlags;
+using cyrene_music::ShutdownSocket;
+using cyrene_music::SocketHandle;
+using cyrene_music::StreamProxy;
+using Clock = std::chrono::steady_clock;
+
+double Milliseconds(Clock::duration d) {
+  return std::chrono::duration<double, std::milli>(d).count();
+}
+
+bool SendAll(SocketHandle s, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const int chunk =
+        static_cast<int>(std::min<size_t>(data.size() - sent, 1 << 20));
+    const auto n = send(s, data.data() + sent, chunk, kSendFlags);
+    if (n <= 0) return false;
+    sent += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+SocketHandle ConnectTo(uint16_t port) {
+  const SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(port);
+  if (connect(s, reinterpret_cast<const sockaddr*>(&address),
+              sizeof(address)) != 0) {
+    CloseSocket(s);
+    return kInvalidSocket;
+  }
+  return s;
+}
+
+// The stand-in upstream: one thread per connection, one request each.
+class Upstream {
+ public:
+  explicit Upstream(const std::string* song) : song_(song) {}
+  ~Upstream() { Stop(); }
+
+  bool Start() {
+    listener_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    if (bind(listener_, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) != 0 ||
+        listen(listener_, 16) != 0 ||
+        getsockname(listener_, reinterpret_cast<sockaddr*>(&address),
+                    &length) != 0) {
+      return false;
+    }
+    port_ = ntohs(address.sin_port);
+    thread_ = std::thread([this] { AcceptLoop(); });
+    return true;
+  }
+
+  void Stop() {
+    if (listener_ == kInvalidSocket) return;
+    stopping_ = true;
+    ShutdownSocket(listener_);
+    CloseSocket(listener_);
+    thread_.join();
+    listener_ = kInvalidSocket;
+    while (active_ > 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  uint16_t port() const { return port_; }
+  std::string Url(const std::string& path) const {
+    return "http://127.0.0.1:" + std::to_string(port_) + path;
+  }
+
+  HttpHeaders last_headers() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_headers_;
+  }
+
+ private:
+  void AcceptLoop() {
+    while (!stopping_) {
+      const SocketHandle client = accept(listener_, nullptr, nullptr);
+      if (client == kInvalidSocket) continue;
+      ++active_;
+      std::thread([this, client] {
+        Serve(client);
+        CloseSocket(client);
+        --active_;
+      }).detach();
+    }
+  }
+
+  void Serve(SocketHandle s) {
+    std::string in;
+    char chunk[4096];
+    while (in.find("\r\n\r\n") == std::string::npos) {
+      const auto n = recv(s, chunk, sizeof(chunk), 0);
+      if (n <= 0) return;
+      in.append(chunk, static_cast<size_t>(n));
+    }
+    HttpRequestHead request;
+    if (!HttpRequestHead::Parse(in.substr(0, in.find("\r\n\r\n")), &request)) {
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_headers_ = request.headers;
+    }
+    const bool head = request.method == "HEAD";
+    const std::string& path = request.target;
+    const std::string& song = *song_;
+
+    if (path == "/audio.bin") {
+      size_t first = 0;
+      size_t last = song.size() - 1;
+      const std::string* range = request.headers.Find("range");
+      if (range != nullptr) {
+        std::sscanf(range->c_str(), "bytes=%zu-%zu", &first, &last);
+        last = std::min(last, song.size() - 1);
+      }
+      std::string response =
+          range != nullptr ? "HTTP/1.1 206 Partial Content\r\n"
+                           : "HTTP/1.1 200 OK\r\n";
+      response += "Content-Type: audio/flac\r\nAccept-Ranges: bytes\r\n";
+      response += "Content-Length: " + std::to_string(last - first + 1) +
+                  "\r\n";
+      if (range != nullptr) {
+        response += "Content-Range: bytes " + std::to_string(first) + "-" +
+                    std::to_string(last) + "/" + std::to_string(song.size()) +
+                    "\r\n";
+      }
+      response += "Connection: close\r\n\r\n";
+      if (!SendAll(s, response) || head) return;
+      SendAll(s, song.substr(first, last - first + 1));
+    } else if (path == "/chunked.bin") {
+      SendAll(s,
+              "HTTP/1.1 200 OK\r\nContent-Type: audio/mpeg\r\n"
+              "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n");
+      for (size_t offset = 0; offset < song.size(); offset += 100000) {
+        const size_t n = std::min<size_t>(100000, song.size() - offset);
+        char size_line[32];
+        std::snprintf(size_line, sizeof(size_line), "%zx\r\n", n);
+        if (!SendAll(s, size_line + song.substr(offset, n) + "\r\n")) return;
+      }
+      SendAll(s, "0\r\n\r\n");
+    } else if (path == "/close.bin") {
+      SendAll(s, "HTTP/1.1 200 OK\r\nConnection: close\r\n\r\n" + song);
+    } else if (path == "/redirect") {
+      SendAll(s,
+              "HTTP/1.1 302 Found\r\nLocation: /audio.bin\r\n"
+              "Content-Length: 0\r\nConnection: close\r\n\r\n");
+    } else if (path == "/hls/list.m3u8") {
+      const std::string playlist =
+          "#EXTM3U\r\n"
+          "#EXT-X-KEY:METHOD=AES-128,URI=\"key.bin\"\r\n"
+          "#EXT-X-SESSION-KEY:METHOD=SAMPLE-AES,URI=\"skd://asset\"\r\n"
+          "#EXTINF:10,\r\n"
+          "seg0.ts\r\n"
+          "\r\n"
+          "#EXTINF:10,\r\n"
+          "/abs/seg1.ts?x=1\r\n"
+          "https://cdn.example/seg2.ts\r\n";
+      SendAll(s,
+              "HTTP/1.1 200 OK\r\nContent-Type: application/x-mpegURL\r\n"
+              "Content-Length: " +
+                  std::to_string(playlist.size()) +
+                  "\r\nConnection: close\r\n\r\n" + playlist);
+    } else {
+      SendAll(s,
+              "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n"
+              "Connection: close\r\n\r\n");
+    }
+  }
+
+  const std::string* song_;
+  SocketHandle listener_ = kInvalidSocket;
+  uint16_t port_ = 0;
+  std::thread thread_;
+  std::atomic<bool> stopping_{false};
+  std::atomic<int> active_{0};
+  std::mutex mutex_;
+  HttpHeaders last_headers_;
+};
+
+struct Response {
+  int status = 0;
+  HttpHeaders headers;
+  std::string body;
+  bool closed = false;  // the server closed the connection after it
+  double first_byte_ms = 0;
+};
+
+// One request on |s|, read to the end of its body (Content-Length,
+// chunked or close).
+bool Exchange(SocketHandle s, const std::string& method,
+              const std::string& target, const std::string& extra_headers,
+              Response* response) {
+  const Clock::time_point start = Clock::now();
+  if (!SendAll(s, method + " " + target +
+                      " HTTP/1.1\r\nHost: 127.0.0.1\r\n"
+                      "User-Agent: bench-player\r\nAccept-Encoding: gzip\r\n" +
+                      extra_headers + "\r\n")) {
+    return false;
+  }
+
+  std::string in;
+  std::vector<char> chunk(256 * 1024);
+  auto fill = [&] {
+    const auto n = recv(s, chunk.data(), static_cast<int>(chunk.size()), 0);
+    if (n <= 0) return false;
+    if (response->first_byte_ms == 0) {
+      response->first_byte_ms = Milliseconds(Clock::now() - start);
+    }
+    in.append(chunk.data(), static_cast<size_t>(n));
+    return true;
+  };
+  size_t head_end;
+  while ((head_end = in.find("\r\n\r\n")) == std::string::npos) {
+    if (!fill()) return false;
+  }
+  cyrene_music::HttpResponseHead head;
+  if (!cyrene_music::HttpResponseHead::Parse(in.substr(0, head_end), &head)) {
+    return false;
+  }
+  response->status = head.status;
+  response->headers = head.headers;
+  in.erase(0, head_end + 4);
+  const std::string* connection = head.headers.Find("connection");
+  response->closed = connection != nullptr && *connection == "close";
+
+  const std::string* length = head.headers.Find("content-length");
+  const std::string* encoding = head.headers.Find("transfer-encoding");
+  if (method == "HEAD") {
+    response->body.clear();
+  } else if (encoding != nullptr && *encoding == "chunked") {
+    for (;;) {
+      size_t line_end;
+      while ((line_end = in.find("\r\n")) == std::string::npos) {
+        if (!fill()) return false;
+      }
+      const size_t size = std::strtoull(in.c_str(), nullptr, 16);
+      in.erase(0, line_end + 2);
+      while (in.size() < size + 2) {
+        if (!fill()) return false;
+      }
+      response->body.append(in, 0, size);
+      in.erase(0, size + 2);
+      if (size == 0) break;
+    }
+  } else if (length != nullptr) {
+    const size_t size = std::strtoull(length->c_str(), nullptr, 10);
+    while (in.size() < size) {
+      if (!fill()) return false;
+    }
+    response->body = in.substr(0, size);
+  } else {
+    while (fill()) {
+    }
+    response->body = in;
+  }
+  return true;
+}
+
+// One request on a fresh connection.
+bool Fetch(uint16_t port, const std::string& method, const std::string& target,
+           const std::string& extra_headers, Response* response) {
+  const SocketHandle s = ConnectTo(port);
+  if (s == kInvalidSocket) return false;
+  const bool ok = Exchange(s, method, target, extra_headers, response);
+  CloseSocket(s);
+  return ok;
+}
+
+std::string ProxyTarget(const std::string& url, const char* platform) {
+  std::string target = "/proxy?url=" + EncodeUriComponent(url);
+  if (platform != nullptr) target += std::string("&platform=") + platform;
+  return target;
+}
+
+bool Expect(bool condition, const char* what, bool* ok) {
+  if (!condition) {
+    std::printf("FAIL: %s\n", what);
+    *ok = false;
+  }
+  return condition;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const size_t megabytes =
+      argc > 1 ? static_cast<size_t>(std::max(1, std::atoi(argv[1]))) : 64;
+  bool ok = true;
+  if (!cyrene_music::InitSockets()) return 1;
+
+  std::string song(megabytes * 1024 * 1024 + 4321, '\0');
+  std::mt19937 random(11);
+  for (char& c : song) c = static_cast<char>(random());
+
+  Upstream upstream(&song);
+  if (!upstream.Start()) {
+    std::printf("FAIL: cannot start the stand-in upstream\n");
+    return 1;
+  }
+  StreamProxy proxy;
+  const uint16_t port = proxy.Start(18888, 18897);
+  if (port == 0) {
+    std::printf("FAIL: cannot start the proxy\n");
+    return 1;
+  }
+  std::printf("proxy on port %u, upstream on %u, %zu MB song\n",
+              static_cast<unsigned>(port),
+              static_cast<unsigned>(upstream.port()), megabytes);
+
+  // Full GET, with the QQ Music header rules.
+  Response full;
+  if (Expect(Fetch(port, "GET", ProxyTarget(upstream.Url("/audio.bin"), "qq"),
+                   "Referer: https://player.local\r\n", &full),
+             "full GET", &ok)) {
+    Expect(full.status == 200, "full GET status", &ok);
+    Expect(full.body == song, "full GET body", &ok);
+    const std::string* type = full.headers.Find("content-type");
+    Expect(type != nullptr && *type == "audio/flac", "full GET type", &ok);
+    Expect(full.headers.Find("cache-control") != nullptr,
+           "full GET cache-control", &ok);
+    const HttpHeaders sent = upstream.last_headers();
+    const std::string* agent = sent.Find("user-agent");
+    const std::string* referer = sent.Find("referer");
+    const std::string* encoding = sent.Find("accept-encoding");
+    Expect(agent != nullptr &&
+               agent->find("lx-music-desktop") != std::string::npos,
+           "qq User-Agent", &ok);
+    Expect(referer != nullptr && *referer == "https://y.qq.com",
+           "qq Referer", &ok);
+    Expect(sent.Find("origin") != nullptr, "qq Origin", &ok);
+    Expect(encoding != nullptr && *encoding == "identity",
+           "identity Accept-Encoding", &ok);
+  }
+
+  // Range requests on one keep-alive connection, kugou rules.
+  {
+    const SocketHandle s = ConnectTo(port);
+    const std::string target =
+        ProxyTarget(upstream.Url("/audio.bin"), "kugou");
+    const size_t offsets[] = {0, 1000, song.size() - 5000};
+    for (size_t offset : offsets) {
+      Response part;
+      const size_t last = std::min(offset + 65535, song.size() - 1);
+      const std::string range = "Range: bytes=" + std::to_string(offset) +
+                                "-" + std::to_string(last) + "\r\n";
+      if (!Expect(Exchange(s, "GET", target, range, &part), "range GET",
+                  &ok)) {
+        break;
+      }
+      Expect(part.status == 206, "range status", &ok);
+      Expect(part.body == song.substr(offset, last - offset + 1),
+             "range body", &ok);
+      Expect(part.headers.Find("content-range") != nullptr, "content-range",
+             &ok);
+      Expect(!part.closed, "range keep-alive", &ok);
+      const HttpHeaders sent = upstream.last_headers();
+      const std::string* forwarded = sent.Find("range");
+      Expect(forwarded != nullptr && "Range: " + *forwarded + "\r\n" == range,
+             "range forwarded", &ok);
+      const std::string* referer = sent.Find("referer");
+      Expect(referer != nullptr && *referer == "https://www.kugou.com",
+             "kugou Referer", &ok);
+    }
+    CloseSocket(s);
+  }
+
+  // HEAD, chunked, close-delimited, redirect, 404, bad requests.
+  Response head;
+  if (Expect(Fetch(port, "HEAD", ProxyTarget(upstream.Url("/audio.bin"), "apple"),
+                   "", &head),
+             "HEAD", &ok)) {
+    const std::string* length = head.headers.Find("content-length");
+    Expect(head.status == 200 && length != nullptr &&
+               *length == std::to_string(song.size()),
+           "HEAD length", &ok);
+  }
+  Response chunked;
+  Expect(Fetch(port, "GET", ProxyTarget(upstream.Url("/chunked.bin"), nullptr),
+               "", &chunked) &&
+             chunked.body == song,
+         "chunked body", &ok);
+  Response until_close;
+  Expect(Fetch(port, "GET", ProxyTarget(upstream.Url("/close.bin"), nullptr),
+               "", &until_close) &&
+             until_close.body == song,
+         "close-delimited body", &ok);
+  Response redirected;
+  Expect(Fetch(port, "GET", ProxyTarget(upstream.Url("/redirect"), "qq"), "",
+               &redirected) &&
+             redirected.status == 200 && redirected.body == song,
+         "redirect followed", &ok);
+  Response missing;
+  Expect(Fetch(port, "GET", ProxyTarget(upstream.Url("/missing"), "qq"), "",
+               &missing) &&
+             missing.status == 404 &&
+             missing.body == "Upstream server error: 404",
+         "upstream 404", &ok);
+  Response no_url;
+  Expect(Fetch(port, "GET", "/proxy?platform=qq", "", &no_url) &&
+             no_url.status == 400,
+         "missing url", &ok);
+  Response post;
+  Expect(Fetch(port, "POST", ProxyTarget(upstream.Url("/audio.bin"), "qq"),
+               "Content-Length: 0\r\n", &post) &&
+             post.status == 405,
+         "POST refused", &ok);
+  Response unreachable;
+  Expect(Fetch(port, "GET", ProxyTarget("http://127.0.0.1:1/x", "qq"), "",
+               &unreachable) &&
+             unreachable.status == 500,
+         "unreachable upstream", &ok);
+
+  // Playlist rewriting.
+  Response playlist;
+  if (Expect(Fetch(port, "GET",
+                   ProxyTarget(upstream.Url("/hls/list.m3u8"), "apple"), "",
+                   &playlist),
+             "playlist", &ok)) {
+    const std::string prefix =
+        "http://localhost:" + std::to_string(port) + "/proxy?url=";
+    const std::string expected =
+        "#EXTM3U\n"
+        "#EXT-X-KEY:METHOD=AES-128,URI=\"" + prefix +
+        EncodeUriComponent(upstream.Url("/hls/key.bin")) +
+        "&platform=apple\"\n"
+        "#EXT-X-SESSION-KEY:METHOD=SAMPLE-AES,URI=\"skd://asset\"\n"
+        "#EXTINF:10,\n" + prefix +
+        EncodeUriComponent(upstream.Url("/hls/seg0.ts")) +
+        "&platform=apple\n"
+        "\n"
+        "#EXTINF:10,\n" + prefix +
+        EncodeUriComponent(upstream.Url("/abs/seg1.ts?x=1")) +
+        "&platform=apple\n" + prefix +
+        EncodeUriComponent("https://cdn.example/seg2.ts") +
+        "&platform=apple\n";
+    if (!Expect(playlist.status == 200 && playlist.body == expected,
+                "playlist rewrite", &ok)) {
+      std::printf("%s\n", playlist.body.c_str());
+    }
+  }
+
+  // Throughput and first byte: straight from the upstream, then through
+  // the proxy, one stream and four at once.
+  Response direct;
+  Clock::time_point start = Clock::now();
+  Fetch(upstream.port(), "GET", "/audio.bin", "", &direct);
+  const double direct_ms = Milliseconds(Clock::now() - start);
+  Response relayed;
+  start = Clock::now();
+  Fetch(port, "GET", ProxyTarget(upstream.Url("/audio.bin"), "qq"), "",
+        &relayed);
+  const double relayed_ms = Milliseconds(Clock::now() - start);
+  Expect(relayed.body == song, "relayed body", &ok);
+
+  std::vector<std::thread> streams;
+  std::atomic<int> good{0};
+  start = Clock::now();
+  for (int i = 0; i < 4; ++i) {
+    streams.emplace_back([&] {
+      Response r;
+      if (Fetch(port, "GET", ProxyTarget(upstream.Url("/audio.bin"), "qq"),
+                "", &r) &&
+          r.body == song) {
+        ++good;
+      }
+    });
+  }
+  for (std::thread& t : streams) t.join();
+  const double parallel_ms = Milliseconds(Clock::now() - start);
+  Expect(good == 4, "parallel streams", &ok);
+
+  const double mb = static_cast<double>(song.size()) / (1024.0 * 1024.0);
+  std::printf("%-28s %8.2f ms first byte %8.1f MB/s\n", "direct from upstream",
+              direct.first_byte_ms, mb / (direct_ms / 1000.0));
+  std::printf("%-28s %8.2f ms first byte %8.1f MB/s\n", "through the proxy",
+              relayed.first_byte_ms, mb / (relayed_ms / 1000.0));
+  std::printf("%-28s %8s             %8.1f MB/s total\n", "4 streams at once",
+              "", 4 * mb / (parallel_ms / 1000.0));
+
+  // Restart on the same range.
+  proxy.Stop();
+  const uint16_t again = proxy.Start(18888, 18897);
+  Response after;
+  Expect(again != 0 &&
+             Fetch(again, "GET", ProxyTarget(upstream.Url("/audio.bin"), "qq"),
+                   "Range: bytes=0-99\r\n", &after) &&
+             after.body == song.substr(0, 100),
+         "restart", &ok);
+  proxy.Stop();
+  upstream.Stop();
+
+  std::printf("%s\n", ok ? "OK" : "FAILED");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Exercises thread roles in isolation.
+//
+// Each role is entered on a fresh thread; the bench prints the scheduling
+// the OS actually granted, checks that leaving the scope restores the
+// thread, and measures how far a 1 ms sleep overshoots with and without a
+// fine-timer role, which is what the render and capture roles are for.
+// Real-time capture scheduling only shows up with CAP_SYS_NICE or an
+// RLIMIT_RTPRIO allowance; otherwise the fallback is reported.
+//
+// It also checks that kUi never lowers a thread that already runs raised,
+// and that a thread started inside kRender, which inherits the boost on
+// Linux, is back at the process default after ResetThreadScheduling().
+//
+// Usage: thread_role_bench [sleeps]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "thread/thread_role.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using cyrene_music::ScopedThreadRole;
+using cyrene_music::ThreadRole;
+
+// The calling thread's scheduling, printable and comparable.
+std::string DescribeSchedule() {
+  char text[128];
+#if defined(_WIN32)
+  std::snprintf(text, sizeof(text), "priority %d",
+                GetThreadPriority(GetCurrentThread()));
+#else
+  int policy = 0;
+  sched_param param{};
+  pthread_getschedparam(pthread_self(), &policy, &param);
+  const char* policy_name = policy == SCHED_FIFO    ? "fifo"
+                            : policy == SCHED_RR    ? "rr"
+                            : policy == SCHED_BATCH ? "batch"
+                            : policy == SCHED_IDLE  ? "idle"
+                                                    : "other";
+  const int nice = getpriority(PRIO_PROCESS,
+                               static_cast<id_t>(syscall(SYS_gettid)));
+  std::snprintf(text, sizeof(text), "%s/%d nice %d slack %dns", policy_name,
+                param.sched_priority, nice,
+                static_cast<int>(prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0)));
+#endif
+  return text;
+}
+
+// Median and worst overshoot of sleep_for(1ms), in microseconds.
+void MeasureSleep(int sleeps, double* median_us, double* worst_us) {
+  std::vector<double> overshoot;
+  overshoot.reserve(sleeps);
+  for (int i = 0; i < sleeps; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const double slept = std::chrono::duration<double, std::micro>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    overshoot.push_back(slept - 1000.0);
+  }
+  std::sort(overshoot.begin(), overshoot.end());
+  *median_us = overshoot[overshoot.size() / 2];
+  *worst_us = overshoot.back();
+}
+
+// Returns false on a failed check; a render role the OS refused leaves
+// nothing to check and is only reported.
+bool CheckInheritance() {
+  bool ok = true;
+  std::thread([&] {
+    const std::string start = DescribeSchedule();
+    ScopedThreadRole render(ThreadRole::kRender);
+    if (!render.applied()) {
+      std::printf("render role refused; inheritance not checked\n");
+      return;
+    }
+    const std::string raised = DescribeSchedule();
+    {
+      ScopedThreadRole ui(ThreadRole::kUi);
+      if (DescribeSchedule() != raised) {
+        std::printf("FAIL: kUi moved a raised thread: %s -> %s\n",
+                    raised.c_str(), DescribeSchedule().c_str());
+        ok = false;
+      }
+    }
+    std::thread([&] {
+      const std::string inherited = DescribeSchedule();
+      cyrene_music::ResetThreadScheduling();
+      const std::string reset = DescribeSchedule();
+      std::printf("spawned in render: %s, after reset: %s\n",
+                  inherited.c_str(), reset.c_str());
+      if (reset != start) {
+        std::printf("FAIL: reset gave %s, the default is %s\n", reset.c_str(),
+                    start.c_str());
+        ok = false;
+      }
+    }).join();
+  }).join();
+  return ok;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  int sleeps = 200;
+  if (argc > 1) {
+    sleeps = std::atoi(argv[1]);
+    if (sleeps <= 0) {
+      std::fprintf(stderr, "usage: %s [sleeps]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  bool restored = true;
+  const ThreadRole roles[] = {ThreadRole::kUi, ThreadRole::kRender,
+                              ThreadRole::kAudioCapture,
+                              ThreadRole::kBackground};
+  std::printf("%-14s %-8s %-40s %s\n", "role", "applied", "schedule",
+              "sleep(1ms) overshoot median/worst");
+  for (ThreadRole role : roles) {
+    std::thread([&] {
+      const std::string before = DescribeSchedule();
+      std::string during;
+      bool applied = false;
+      double median_us = 0.0;
+      double worst_us = 0.0;
+      {
+        ScopedThreadRole scope(role);
+        applied = scope.applied();
+        during = DescribeSchedule();
+        MeasureSleep(sleeps, &median_us, &worst_us);
+      }
+      const std::string after = DescribeSchedule();
+      std::printf("%-14s %-8s %-40s %7.1f / %7.1f us\n",
+                  cyrene_music::ThreadRoleName(role), applied ? "yes" : "no",
+                  during.c_str(), median_us, worst_us);
+      // Raising a lowered nice value back needs privileges; report rather
+      // than fail when only that part could not be undone.
+      if (after != before) {
+        std::printf("  not fully restored: %s -> %s\n", before.c_str(),
+                    after.c_str());
+        if (role != ThreadRole::kBackground) restored = false;
+      }
+    }).join();
+  }
+
+  double median_us = 0.0;
+  double worst_us = 0.0;
+  MeasureSleep(sleeps, &median_us, &worst_us);
+  std::printf("%-14s %-8s %-40s %7.1f / %7.1f us\n", "(none)", "-",
+              DescribeSchedule().c_str(), median_us, worst_us);
+
+  const bool defaults_ok = CheckInheritance();
+
+  if (ScopedThreadRole::fine_timer_holders() != 0) {
+    std::fprintf(stderr, "fine timer still held after every scope ended\n");
+    return 1;
+  }
+  if (!restored) {
+    std::fprintf(stderr, "a role did not restore the thread's scheduling\n");
+    return 1;
+  }
+  return defaults_ok ? 0 : 1;
+}
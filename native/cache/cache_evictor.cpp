@@ -0,0 +1,189 @@
+#include "cache/cache_evictor.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#include "cache/random_access_file.h"
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+namespace {
+
+// Evicted files are renamed to "<key>.cyrene.<n>.evicted" before the
+// worker unlinks them; no put ever writes that name.
+constexpr char kTombstoneSuffix[] = ".evicted";
+
+bool IsTombstone(const std::string& name) {
+  const size_t suffix = sizeof(kTombstoneSuffix) - 1;
+  return name.size() > suffix &&
+         name.compare(name.size() - suffix, suffix, kTombstoneSuffix) == 0;
+}
+
+}  // namespace
+
+CacheEvictor::CacheEvictor() : thread_(&CacheEvictor::Run, this) {}
+
+CacheEvictor::~CacheEvictor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) thread_.join();
+}
+
+void CacheEvictor::Configure(const std::string& directory,
+                             uint64_t budget_bytes, Policy policy) {
+  if (directory != directory_ && !directory.empty()) {
+    // Tombstones a previous run did not get to.
+    std::vector<std::string> leftovers;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(
+             std::filesystem::u8path(directory), error)) {
+      const std::string name = entry.path().filename().u8string();
+      if (IsTombstone(name)) leftovers.push_back(directory + "/" + name);
+    }
+    if (!leftovers.empty()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending_.insert(pending_.end(),
+                        std::make_move_iterator(leftovers.begin()),
+                        std::make_move_iterator(leftovers.end()));
+      }
+      wake_.notify_one();
+    }
+  }
+  directory_ = directory;
+  budget_bytes_ = budget_bytes;
+  policy_ = policy;
+}
+
+std::vector<std::string> CacheEvictor::Enforce(CacheIndex* index,
+                                               int64_t now_ms) {
+  if (budget_bytes_ == 0 || directory_.empty() || !index->is_open()) {
+    return {};
+  }
+  uint64_t total = 0;
+  for (const auto& [key, entry] : index->entries()) total += entry.file_size;
+  if (total <= budget_bytes_) return {};
+
+  const std::vector<std::string> candidates = SelectVictims(
+      index->entries(), total, budget_bytes_ / 100 * kLowWatermarkPercent,
+      policy_, now_ms);
+
+  // Unlinking "<key>.cyrene" later, from the worker, would delete the song
+  // again if it were cached anew in between. Each file is renamed aside
+  // here, while the caller still holds the index, and only the tombstone
+  // is left to the worker. A rename is a metadata update, cheap next to
+  // freeing the blocks. A file that cannot be moved (still open on
+  // Windows, e.g. served by CacheStreamServer) stays indexed and counted,
+  // and a later pass tries it again; one already gone just leaves the
+  // index.
+  std::vector<std::string> victims;
+  std::vector<std::pair<std::string, std::string>> moved;
+  victims.reserve(candidates.size());
+  moved.reserve(candidates.size());
+  for (const std::string& key : candidates) {
+    const std::string path = directory_ + "/" + key + ".cyrene";
+    std::string tombstone =
+        path + "." + std::to_string(++tombstones_) + kTombstoneSuffix;
+    if (RandomAccessFile::Rename(path, tombstone)) {
+      moved.emplace_back(path, std::move(tombstone));
+    } else {
+      std::error_code error;
+      if (std::filesystem::exists(std::filesystem::u8path(path), error) ||
+          error) {
+        continue;
+      }
+    }
+    victims.push_back(key);
+  }
+  if (victims.empty()) return {};
+
+  uint64_t bytes = 0;
+  for (const std::string& key : victims) bytes += index->Find(key)->file_size;
+  if (!index->RemoveAll(victims)) {
+    // The index still points at them: put the files back.
+    for (const auto& [path, tombstone] : moved) {
+      RandomAccessFile::Rename(tombstone, path);
+    }
+    return {};
+  }
+  metrics_.evictions += victims.size();
+  metrics_.evicted_bytes += bytes;
+
+  std::vector<std::string> paths;
+  paths.reserve(moved.size());
+  for (auto& entry : moved) paths.push_back(std::move(entry.second));
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pending_.insert(pending_.end(), std::make_move_iterator(paths.begin()),
+                    std::make_move_iterator(paths.end()));
+  }
+  wake_.notify_one();
+  return victims;
+}
+
+// static
+std::vector<std::string> CacheEvictor::SelectVictims(
+    const std::unordered_map<std::string, CacheIndex::Entry>& entries,
+    uint64_t total_bytes, uint64_t target_bytes, Policy policy,
+    int64_t now_ms) {
+  using Candidate = std::pair<const std::string*, const CacheIndex::Entry*>;
+  std::vector<Candidate> candidates;
+  candidates.reserve(entries.size());
+  for (const auto& [key, entry] : entries) candidates.emplace_back(&key, &entry);
+
+  const auto recent = [now_ms](const CacheIndex::Entry& e) {
+    return now_ms - e.last_access_ms < kMinResidencyMs;
+  };
+  std::sort(candidates.begin(), candidates.end(),
+            [&](const Candidate& a, const Candidate& b) {
+              const CacheIndex::Entry& x = *a.second;
+              const CacheIndex::Entry& y = *b.second;
+              if (recent(x) != recent(y)) return !recent(x);
+              if (policy == Policy::kLfu && x.hits != y.hits) {
+                return x.hits < y.hits;
+              }
+              if (x.last_access_ms != y.last_access_ms) {
+                return x.last_access_ms < y.last_access_ms;
+              }
+              return *a.first < *b.first;
+            });
+
+  std::vector<std::string> victims;
+  for (const Candidate& candidate : candidates) {
+    if (total_bytes <= target_bytes) break;
+    victims.push_back(*candidate.first);
+    total_bytes -= std::min(total_bytes, candidate.second->file_size);
+  }
+  return victims;
+}
+
+void CacheEvictor::Flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  drained_.wait(lock, [this] { return pending_.empty() && !busy_; });
+}
+
+void CacheEvictor::Run() {
+  ScopedThreadRole role(ThreadRole::kBackground);
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    wake_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty()) break;
+    std::vector<std::string> batch = std::move(pending_);
+    pending_.clear();
+    busy_ = true;
+    lock.unlock();
+    for (const std::string& path : batch) RandomAccessFile::Remove(path);
+    lock.lock();
+    busy_ = false;
+    drained_.notify_all();
+  }
+}
+
+}  // namespace cyrene_music
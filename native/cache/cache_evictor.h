@@ -0,0 +1,104 @@
+#ifndef NATIVE_CACHE_CACHE_EVICTOR_H_
+#define NATIVE_CACHE_CACHE_EVICTOR_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cache/cache_index.h"
+
+namespace cyrene_music {
+
+// Keeps the song cache within a byte budget.
+//
+// Enforce() runs after the index grows: once the cached audio exceeds the
+// budget it picks victims by the configured policy until the total is back
+// under the low watermark (so the next few songs do not each trigger a
+// round), renames their files to tombstones, drops them from the index
+// with one append and hands the tombstones to a background thread that
+// unlinks the whole batch. Ranking, the renames and the index update stay
+// on the caller's thread, so a song cached again right after its eviction
+// is never deleted by the worker; only freeing the blocks moves off it.
+// A file that cannot be renamed yet (open on Windows) keeps its entry, so
+// it still counts against the budget and is tried again next time.
+//
+// Songs used within kMinResidencyMs are passed over while anything older
+// remains, so the song that is playing, or that has just been cached and
+// has no hits yet under LFU, is not evicted under it.
+//
+// Also counts cache hits and misses for the metrics shown in settings.
+class CacheEvictor {
+ public:
+  enum class Policy { kLru, kLfu };
+
+  struct Metrics {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    uint64_t evicted_bytes = 0;
+  };
+
+  // Evict down to this share of the budget once it is exceeded.
+  static constexpr uint64_t kLowWatermarkPercent = 90;
+  static constexpr int64_t kMinResidencyMs = 10 * 60 * 1000;
+
+  CacheEvictor();
+  // Finishes the queued unlinks.
+  ~CacheEvictor();
+
+  CacheEvictor(const CacheEvictor&) = delete;
+  CacheEvictor& operator=(const CacheEvictor&) = delete;
+
+  // |directory| holds the "<key>.cyrene" files; a |budget_bytes| of zero
+  // disables eviction. Tombstones left in a new |directory| by an earlier
+  // run are queued for unlinking.
+  void Configure(const std::string& directory, uint64_t budget_bytes,
+                 Policy policy);
+  uint64_t budget_bytes() const { return budget_bytes_; }
+
+  // Brings |index| within the budget and returns the evicted keys, which
+  // leave out any victim whose file could not be moved.
+  std::vector<std::string> Enforce(CacheIndex* index, int64_t now_ms);
+
+  // The keys to evict from |entries| to get |total_bytes| down to
+  // |target_bytes|, in eviction order.
+  static std::vector<std::string> SelectVictims(
+      const std::unordered_map<std::string, CacheIndex::Entry>& entries,
+      uint64_t total_bytes, uint64_t target_bytes, Policy policy,
+      int64_t now_ms);
+
+  void RecordHit() { ++metrics_.hits; }
+  void RecordMiss() { ++metrics_.misses; }
+  const Metrics& metrics() const { return metrics_; }
+
+  // Blocks until every queued file is gone.
+  void Flush();
+
+ private:
+  void Run();
+
+  std::string directory_;
+  uint64_t budget_bytes_ = 0;
+  Policy policy_ = Policy::kLru;
+  Metrics metrics_;
+  uint64_t tombstones_ = 0;
+
+  // Unlink queue, shared with the worker.
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable drained_;
+  std::vector<std::string> pending_;
+  bool busy_ = false;
+  bool stopping_ = false;
+
+  // Last, so everything above exists before the thread starts.
+  std::thread thread_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_CACHE_EVICTOR_H_
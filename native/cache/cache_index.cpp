@@ -0,0 +1,415 @@
+#include "cache/cache_index.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+#include "cache/cyrene_cache_file.h"
+
+namespace cyrene_music {
+
+namespace {
+
+// File header: magic and format version.
+constexpr uint8_t kMagic[4] = {'C', 'Y', 'I', 'X'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kFileHeaderSize = 8;
+
+// Record header, little-endian:
+//   u32 crc       CRC-32 of everything after this field
+//   u8  type, u24 hit count (Put; zero in older logs)
+//   u32 key size, u32 value size
+//   u64 file size (Put), hit count (Touch; zero in older logs)
+//   i64 time in ms (Put, Touch)
+// followed by the key and the value.
+constexpr size_t kRecordHeaderSize = 32;
+
+// Keys are "<source>_<id>"; anything longer is corruption.
+constexpr uint32_t kMaxKeySize = 4096;
+constexpr uint32_t kMaxValueSize = 64u << 20;
+
+// CRC-32 (IEEE), slicing by 8: eight bytes per step, so a reopen is
+// bound by the scan rather than the checksum.
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+const CrcTables& SharedCrcTables() {
+  static const CrcTables tables = [] {
+    CrcTables t{};
+    for (uint32_t i = 0; i < 256; ++i) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      t[0][i] = c;
+    }
+    for (uint32_t i = 0; i < 256; ++i) {
+      for (size_t k = 1; k < 8; ++k) {
+        t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+      }
+    }
+    return t;
+  }();
+  return tables;
+}
+
+uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size) {
+  const CrcTables& t = SharedCrcTables();
+  crc = ~crc;
+  for (; size >= 8; data += 8, size -= 8) {
+    const uint32_t low = crc ^ (static_cast<uint32_t>(data[0]) |
+                                (static_cast<uint32_t>(data[1]) << 8) |
+                                (static_cast<uint32_t>(data[2]) << 16) |
+                                (static_cast<uint32_t>(data[3]) << 24));
+    crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^
+          t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^ t[3][data[4]] ^
+          t[2][data[5]] ^ t[1][data[6]] ^ t[0][data[7]];
+  }
+  for (; size > 0; ++data, --size) {
+    crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+void Store32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void Store64(uint8_t* out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t Load32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) value = (value << 8) | in[i];
+  return value;
+}
+
+uint64_t Load64(const uint8_t* in) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) value = (value << 8) | in[i];
+  return value;
+}
+
+size_t RecordSize(size_t key_size, size_t value_size) {
+  return kRecordHeaderSize + key_size + value_size;
+}
+
+// Builds a complete record with |value| copied as given (already
+// encrypted).
+std::vector<uint8_t> BuildRecord(uint8_t type, const std::string& key,
+                                 const uint8_t* value, uint32_t value_size,
+                                 uint64_t file_size, int64_t time_ms,
+                                 uint32_t hits) {
+  std::vector<uint8_t> record(RecordSize(key.size(), value_size), 0);
+  uint8_t* header = record.data();
+  header[4] = type;
+  header[5] = static_cast<uint8_t>(hits);
+  header[6] = static_cast<uint8_t>(hits >> 8);
+  header[7] = static_cast<uint8_t>(hits >> 16);
+  Store32(header + 8, static_cast<uint32_t>(key.size()));
+  Store32(header + 12, value_size);
+  Store64(header + 16, file_size);
+  Store64(header + 24, static_cast<uint64_t>(time_ms));
+  std::memcpy(header + kRecordHeaderSize, key.data(), key.size());
+  if (value_size > 0) {
+    std::memcpy(header + kRecordHeaderSize + key.size(), value, value_size);
+  }
+  Store32(header, Crc32(0, header + 4, record.size() - 4));
+  return record;
+}
+
+}  // namespace
+
+bool CacheIndex::Open(const std::string& path) {
+  Close();
+  path_ = path;
+
+  uint64_t valid_size = 0;
+  {
+    MappedFile mapped;
+    if (mapped.Open(path) && !Scan(mapped.data(), mapped.size(), &valid_size)) {
+      // Not an index (or a different version): start over.
+      valid_size = 0;
+      entries_.clear();
+      live_bytes_ = 0;
+    }
+  }
+
+  if (!file_.Open(path, RandomAccessFile::Mode::kOpenOrCreate)) return false;
+  if (valid_size == 0) {
+    uint8_t header[kFileHeaderSize];
+    std::memcpy(header, kMagic, sizeof(kMagic));
+    Store32(header + 4, kVersion);
+    if (!file_.Truncate(0) || !file_.WriteAt(0, header, sizeof(header))) {
+      file_.Close();
+      return false;
+    }
+    valid_size = kFileHeaderSize;
+  } else if (file_.Size() != valid_size) {
+    // Drop a torn tail so new records follow the last good one.
+    file_.Truncate(valid_size);
+  }
+  log_size_ = valid_size;
+  MaybeCompact();
+  return true;
+}
+
+void CacheIndex::Close() {
+  file_.Close();
+  entries_.clear();
+  log_size_ = 0;
+  live_bytes_ = 0;
+}
+
+bool CacheIndex::Scan(const uint8_t* data, size_t size,
+                      uint64_t* valid_size) {
+  if (size < kFileHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      Load32(data + 4) != kVersion) {
+    return false;
+  }
+  size_t offset = kFileHeaderSize;
+  while (size - offset >= kRecordHeaderSize) {
+    const uint8_t* header = data + offset;
+    const uint8_t type = header[4];
+    const uint32_t key_size = Load32(header + 8);
+    const uint32_t value_size = Load32(header + 12);
+    if (type < static_cast<uint8_t>(RecordType::kPut) ||
+        type > static_cast<uint8_t>(RecordType::kTouch) ||
+        key_size > kMaxKeySize || value_size > kMaxValueSize) {
+      break;
+    }
+    const size_t record_size = RecordSize(key_size, value_size);
+    if (size - offset < record_size ||
+        Crc32(0, header + 4, record_size - 4) != Load32(header)) {
+      break;
+    }
+
+    std::string key(reinterpret_cast<const char*>(header + kRecordHeaderSize),
+                    key_size);
+    const auto existing = entries_.find(key);
+    switch (static_cast<RecordType>(type)) {
+      case RecordType::kPut: {
+        if (existing != entries_.end()) {
+          live_bytes_ -= RecordSize(key.size(), existing->second.metadata_size);
+        }
+        Entry& entry = entries_[std::move(key)];
+        entry.file_size = Load64(header + 16);
+        entry.last_access_ms = static_cast<int64_t>(Load64(header + 24));
+        entry.hits = std::max<uint32_t>(entry.hits, Load32(header + 4) >> 8);
+        entry.metadata_offset = offset + kRecordHeaderSize + key_size;
+        entry.metadata_size = value_size;
+        live_bytes_ += record_size;
+        break;
+      }
+      case RecordType::kRemove:
+        if (existing != entries_.end()) {
+          live_bytes_ -= RecordSize(key.size(), existing->second.metadata_size);
+          entries_.erase(existing);
+        }
+        break;
+      case RecordType::kTouch:
+        if (existing != entries_.end()) {
+          Entry& entry = existing->second;
+          entry.last_access_ms = static_cast<int64_t>(Load64(header + 24));
+          // Older logs carry no count; count the record instead.
+          const uint64_t hits = Load64(header + 16);
+          entry.hits = static_cast<uint32_t>(std::min<uint64_t>(
+              hits != 0 ? hits : uint64_t{entry.hits} + 1, kMaxHits));
+        }
+        break;
+    }
+    offset += record_size;
+  }
+  *valid_size = offset;
+  return true;
+}
+
+bool CacheIndex::Append(RecordType type, const std::string& key,
+                        const uint8_t* value, uint32_t value_size,
+                        uint64_t file_size, int64_t time_ms, uint32_t hits,
+                        uint64_t* value_offset) {
+  if (!file_.is_open() || key.size() > kMaxKeySize ||
+      value_size > kMaxValueSize) {
+    return false;
+  }
+  const std::vector<uint8_t> record =
+      BuildRecord(static_cast<uint8_t>(type), key, value, value_size,
+                  file_size, time_ms, hits);
+  if (!file_.WriteAt(log_size_, record.data(), record.size())) {
+    // Leave no partial record for the next append to follow.
+    file_.Truncate(log_size_);
+    return false;
+  }
+  if (value_offset != nullptr) {
+    *value_offset = log_size_ + kRecordHeaderSize + key.size();
+  }
+  log_size_ += record.size();
+  return true;
+}
+
+bool CacheIndex::Put(const std::string& key, uint64_t file_size,
+                     std::string_view metadata, int64_t now_ms) {
+  if (metadata.size() > kMaxValueSize) return false;
+  std::vector<uint8_t> encrypted(metadata.size());
+  CyreneXor(reinterpret_cast<const uint8_t*>(metadata.data()),
+            encrypted.data(), metadata.size(), 0);
+  const Entry* existing = Find(key);
+  const uint32_t hits = existing != nullptr ? existing->hits : 0;
+  uint64_t offset = 0;
+  if (!Append(RecordType::kPut, key, encrypted.data(),
+              static_cast<uint32_t>(encrypted.size()), file_size, now_ms,
+              hits, &offset)) {
+    return false;
+  }
+  const auto [it, added] = entries_.try_emplace(key);
+  Entry& entry = it->second;
+  if (!added) live_bytes_ -= RecordSize(key.size(), entry.metadata_size);
+  entry.file_size = file_size;
+  entry.last_access_ms = now_ms;
+  entry.metadata_offset = offset;
+  entry.metadata_size = static_cast<uint32_t>(encrypted.size());
+  live_bytes_ += RecordSize(key.size(), encrypted.size());
+  MaybeCompact();
+  return true;
+}
+
+bool CacheIndex::Remove(const std::string& key) {
+  const auto it = entries_.find(key);
+  if (it == entries_.end()) return true;
+  if (!Append(RecordType::kRemove, key, nullptr, 0, 0, 0, 0, nullptr)) {
+    return false;
+  }
+  live_bytes_ -= RecordSize(key.size(), it->second.metadata_size);
+  entries_.erase(it);
+  MaybeCompact();
+  return true;
+}
+
+bool CacheIndex::RemoveAll(const std::vector<std::string>& keys) {
+  if (!file_.is_open()) return false;
+  std::vector<uint8_t> batch;
+  for (const std::string& key : keys) {
+    if (entries_.count(key) == 0 || key.size() > kMaxKeySize) continue;
+    const std::vector<uint8_t> record = BuildRecord(
+        static_cast<uint8_t>(RecordType::kRemove), key, nullptr, 0, 0, 0, 0);
+    batch.insert(batch.end(), record.begin(), record.end());
+  }
+  if (batch.empty()) return true;
+  if (!file_.WriteAt(log_size_, batch.data(), batch.size())) {
+    file_.Truncate(log_size_);
+    return false;
+  }
+  log_size_ += batch.size();
+  for (const std::string& key : keys) {
+    const auto it = entries_.find(key);
+    if (it == entries_.end()) continue;
+    live_bytes_ -= RecordSize(key.size(), it->second.metadata_size);
+    entries_.erase(it);
+  }
+  MaybeCompact();
+  return true;
+}
+
+bool CacheIndex::Touch(const std::string& key, int64_t now_ms) {
+  const auto it = entries_.find(key);
+  if (it == entries_.end()) return false;
+  Entry& entry = it->second;
+  const uint32_t hits = std::min(entry.hits + 1, kMaxHits);
+  if (!Append(RecordType::kTouch, key, nullptr, 0, hits, now_ms, 0,
+              nullptr)) {
+    return false;
+  }
+  entry.last_access_ms = now_ms;
+  entry.hits = hits;
+  MaybeCompact();
+  return true;
+}
+
+bool CacheIndex::Clear() {
+  if (!file_.is_open() || !file_.Truncate(kFileHeaderSize)) return false;
+  entries_.clear();
+  log_size_ = kFileHeaderSize;
+  live_bytes_ = 0;
+  return true;
+}
+
+const CacheIndex::Entry* CacheIndex::Find(const std::string& key) const {
+  const auto it = entries_.find(key);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+bool CacheIndex::ReadMetadata(const std::string& key,
+                              std::string* metadata) const {
+  const Entry* entry = Find(key);
+  if (entry == nullptr) return false;
+  metadata->resize(entry->metadata_size);
+  auto* bytes = reinterpret_cast<uint8_t*>(metadata->data());
+  if (entry->metadata_size > 0 &&
+      !file_.ReadAt(entry->metadata_offset, bytes, entry->metadata_size)) {
+    return false;
+  }
+  CyreneXor(bytes, bytes, entry->metadata_size, 0);
+  return true;
+}
+
+void CacheIndex::MaybeCompact() {
+  if (log_size_ >= kCompactMinBytes &&
+      log_size_ - kFileHeaderSize > 2 * live_bytes_) {
+    Compact();
+  }
+}
+
+bool CacheIndex::Compact() {
+  if (!file_.is_open()) return false;
+  const std::string temp_path = path_ + ".tmp";
+  RandomAccessFile temp;
+  if (!temp.Open(temp_path, RandomAccessFile::Mode::kCreate)) return false;
+
+  uint8_t header[kFileHeaderSize];
+  std::memcpy(header, kMagic, sizeof(kMagic));
+  Store32(header + 4, kVersion);
+  bool ok = temp.WriteAt(0, header, sizeof(header));
+
+  // Live Put records, re-stamped with the latest access time and hit count
+  // so the Touch records can go. New offsets are applied only once the swap succeeds.
+  std::unordered_map<std::string, uint64_t> offsets;
+  offsets.reserve(entries_.size());
+  uint64_t size = kFileHeaderSize;
+  std::vector<uint8_t> value;
+  for (auto it = entries_.begin(); ok && it != entries_.end(); ++it) {
+    const Entry& entry = it->second;
+    value.resize(entry.metadata_size);
+    if (entry.metadata_size > 0 &&
+        !file_.ReadAt(entry.metadata_offset, value.data(), value.size())) {
+      ok = false;
+      break;
+    }
+    const std::vector<uint8_t> record =
+        BuildRecord(static_cast<uint8_t>(RecordType::kPut), it->first,
+                    value.data(), entry.metadata_size, entry.file_size,
+                    entry.last_access_ms, entry.hits);
+    ok = temp.WriteAt(size, record.data(), record.size());
+    offsets.emplace(it->first, size + kRecordHeaderSize + it->first.size());
+    size += record.size();
+  }
+  ok = ok && temp.Sync();
+  temp.Close();
+  if (!ok) {
+    RandomAccessFile::Remove(temp_path);
+    return false;
+  }
+
+  file_.Close();
+  if (!RandomAccessFile::Rename(temp_path, path_)) {
+    RandomAccessFile::Remove(temp_path);
+    // The old log is untouched; carry on appending to it.
+    file_.Open(path_, RandomAccessFile::Mode::kOpenOrCreate);
+    return false;
+  }
+  if (!file_.Open(path_, RandomAccessFile::Mode::kOpenOrCreate)) return false;
+  for (auto& [key, entry] : entries_) entry.metadata_offset = offsets[key];
+  log_size_ = size;
+  live_bytes_ = size - kFileHeaderSize;
+  return true;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,103 @@
+#ifndef NATIVE_CACHE_CACHE_INDEX_H_
+#define NATIVE_CACHE_CACHE_INDEX_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "cache/random_access_file.h"
+
+namespace cyrene_music {
+
+// The index of cached songs: cache key -> audio size, last use and the
+// metadata JSON CacheService stores with the song.
+//
+// Kept as an append-only log rather than a document rewritten on every
+// change: Put, Remove and Touch each append one small record. Open() scans
+// the mapped log once into a hash table of keys and record offsets, so
+// lookups are O(1) and metadata is read back only when asked for. Every
+// record carries a CRC; a torn record at the end (a crash mid-append) and
+// anything after it is dropped on the next Open(). Once superseded records
+// outweigh live ones the log is compacted into a fresh file that replaces
+// it by rename.
+//
+// Each entry also keeps how often it was used (Touch count), so an evictor
+// can rank by frequency as well as recency; see CacheEvictor.
+//
+// Metadata is XOR-encrypted with the cache key like the songs themselves.
+// Appends are not individually synced: a crash of the process loses
+// nothing, a power cut at most the latest records.
+class CacheIndex {
+ public:
+  struct Entry {
+    uint64_t file_size = 0;
+    int64_t last_access_ms = 0;
+    // Touches since the song was cached, saturating at kMaxHits.
+    uint32_t hits = 0;
+    // The metadata as stored in the log.
+    uint64_t metadata_offset = 0;
+    uint32_t metadata_size = 0;
+  };
+
+  static constexpr uint32_t kMaxHits = 0xFFFFFF;
+
+  // Logs smaller than this are never compacted.
+  static constexpr uint64_t kCompactMinBytes = 256 * 1024;
+
+  CacheIndex() = default;
+
+  CacheIndex(const CacheIndex&) = delete;
+  CacheIndex& operator=(const CacheIndex&) = delete;
+
+  // Loads (or creates) the log at |path|, UTF-8.
+  bool Open(const std::string& path);
+  void Close();
+  bool is_open() const { return file_.is_open(); }
+
+  // Adds or replaces |key|. |now_ms| becomes its last access time; a
+  // replaced entry keeps its hit count.
+  bool Put(const std::string& key, uint64_t file_size,
+           std::string_view metadata, int64_t now_ms);
+  bool Remove(const std::string& key);
+  // Removes every key in |keys| with a single append.
+  bool RemoveAll(const std::vector<std::string>& keys);
+  // Marks |key| as used at |now_ms|; false if it is not in the index.
+  bool Touch(const std::string& key, int64_t now_ms);
+  // Drops every entry.
+  bool Clear();
+
+  const Entry* Find(const std::string& key) const;
+  bool ReadMetadata(const std::string& key, std::string* metadata) const;
+  const std::unordered_map<std::string, Entry>& entries() const {
+    return entries_;
+  }
+
+  uint64_t log_size() const { return log_size_; }
+  // Bytes of the log still referenced by an entry.
+  uint64_t live_bytes() const { return live_bytes_; }
+
+  // Rewrites the log with only the live entries.
+  bool Compact();
+
+ private:
+  enum class RecordType : uint8_t { kPut = 1, kRemove = 2, kTouch = 3 };
+
+  bool Scan(const uint8_t* data, size_t size, uint64_t* valid_size);
+  bool Append(RecordType type, const std::string& key, const uint8_t* value,
+              uint32_t value_size, uint64_t file_size, int64_t time_ms,
+              uint32_t hits, uint64_t* value_offset);
+  void MaybeCompact();
+
+  std::string path_;
+  RandomAccessFile file_;
+  uint64_t log_size_ = 0;
+  uint64_t live_bytes_ = 0;
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_CACHE_INDEX_H_
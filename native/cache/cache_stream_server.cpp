@@ -0,0 +1,408 @@
+#include "cache/cache_stream_server.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+namespace {
+
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+void CloseSocket(SocketHandle s) { closesocket(s); }
+void ShutdownSocket(SocketHandle s) { shutdown(s, SD_BOTH); }
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+void CloseSocket(SocketHandle s) { close(s); }
+void ShutdownSocket(SocketHandle s) { shutdown(s, SHUT_RDWR); }
+#endif
+
+SocketHandle ToHandle(intptr_t s) { return static_cast<SocketHandle>(s); }
+
+constexpr size_t kMaxRequestHead = 16 * 1024;
+// A player that has buffered enough may sit on a keep-alive connection
+// for a while before its next range request.
+constexpr int kIdleTimeoutSeconds = 60;
+
+void SetReceiveTimeout(SocketHandle s, int seconds) {
+#if defined(_WIN32)
+  const DWORD timeout = static_cast<DWORD>(seconds) * 1000;
+#else
+  timeval timeout = {};
+  timeout.tv_sec = seconds;
+#endif
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+bool SendAll(SocketHandle s, const char* data, size_t size) {
+#if defined(_WIN32)
+  constexpr int kFlags = 0;
+#else
+  constexpr int kFlags = MSG_NOSIGNAL;
+#endif
+  while (size > 0) {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const auto n = send(s, data, chunk, kFlags);
+    if (n <= 0) return false;
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+std::string ToLower(std::string text) {
+  std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return text;
+}
+
+std::string ContentTypeFor(const std::string& extension) {
+  const std::string ext = ToLower(extension);
+  if (ext == "mp3") return "audio/mpeg";
+  if (ext == "flac") return "audio/flac";
+  if (ext == "m4a" || ext == "mp4" || ext == "aac") return "audio/mp4";
+  if (ext == "ogg" || ext == "opus") return "audio/ogg";
+  if (ext == "wav") return "audio/wav";
+  return "application/octet-stream";
+}
+
+// The token of a "/<token>.<ext>" target or URL; empty if there is none.
+std::string TokenOf(const std::string& target) {
+  const size_t slash = target.rfind('/');
+  if (slash == std::string::npos) return std::string();
+  const size_t end = target.find_first_of(".?#", slash + 1);
+  return target.substr(slash + 1, end == std::string::npos
+                                      ? std::string::npos
+                                      : end - slash - 1);
+}
+
+struct Request {
+  std::string method;
+  std::string target;
+  std::string range;
+  bool keep_alive = true;
+};
+
+bool ParseRequest(const std::string& head, Request* request) {
+  size_t line_end = head.find("\r\n");
+  const std::string line = head.substr(0, line_end);
+  const size_t first_space = line.find(' ');
+  const size_t second_space = line.find(' ', first_space + 1);
+  if (first_space == std::string::npos || second_space == std::string::npos) {
+    return false;
+  }
+  request->method = line.substr(0, first_space);
+  request->target = line.substr(first_space + 1, second_space - first_space - 1);
+  const std::string version = line.substr(second_space + 1);
+  request->keep_alive = version == "HTTP/1.1";
+
+  while (line_end != std::string::npos) {
+    const size_t start = line_end + 2;
+    line_end = head.find("\r\n", start);
+    const std::string header = head.substr(
+        start, line_end == std::string::npos ? std::string::npos
+                                             : line_end - start);
+    const size_t colon = header.find(':');
+    if (colon == std::string::npos) continue;
+    const std::string name = ToLower(header.substr(0, colon));
+    size_t value_start = colon + 1;
+    while (value_start < header.size() && header[value_start] == ' ') {
+      ++value_start;
+    }
+    const std::string value = header.substr(value_start);
+    if (name == "range") {
+      request->range = value;
+    } else if (name == "connection") {
+      const std::string connection = ToLower(value);
+      if (connection == "close") request->keep_alive = false;
+      if (connection == "keep-alive") request->keep_alive = true;
+    }
+  }
+  return true;
+}
+
+enum class RangeResult { kNone, kSatisfiable, kUnsatisfiable };
+
+// A single "bytes=" range against |size| bytes, as inclusive [first, last].
+// Multiple ranges are answered with the whole body, which HTTP allows.
+RangeResult ParseRange(const std::string& value, uint64_t size,
+                       uint64_t* first, uint64_t* last) {
+  if (value.rfind("bytes=", 0) != 0 ||
+      value.find(',') != std::string::npos) {
+    return RangeResult::kNone;
+  }
+  const std::string spec = value.substr(6);
+  const size_t dash = spec.find('-');
+  if (dash == std::string::npos) return RangeResult::kNone;
+  const std::string from = spec.substr(0, dash);
+  const std::string to = spec.substr(dash + 1);
+  char* end = nullptr;
+  if (from.empty()) {
+    // Suffix range: the last N bytes.
+    const uint64_t suffix = std::strtoull(to.c_str(), &end, 10);
+    if (to.empty() || *end != '\0') return RangeResult::kNone;
+    if (suffix == 0 || size == 0) return RangeResult::kUnsatisfiable;
+    *first = size - std::min(suffix, size);
+    *last = size - 1;
+    return RangeResult::kSatisfiable;
+  }
+  *first = std::strtoull(from.c_str(), &end, 10);
+  if (*end != '\0') return RangeResult::kNone;
+  if (*first >= size) return RangeResult::kUnsatisfiable;
+  if (to.empty()) {
+    *last = size - 1;
+  } else {
+    *last = std::strtoull(to.c_str(), &end, 10);
+    if (*end != '\0' || *last < *first) return RangeResult::kNone;
+    *last = std::min(*last, size - 1);
+  }
+  return RangeResult::kSatisfiable;
+}
+
+std::string StatusHead(int status, const char* reason, bool keep_alive) {
+  char line[128];
+  std::snprintf(line, sizeof(line),
+                "HTTP/1.1 %d %s\r\nConnection: %s\r\n", status, reason,
+                keep_alive ? "keep-alive" : "close");
+  return line;
+}
+
+}  // namespace
+
+// static
+CacheStreamServer& CacheStreamServer::Shared() {
+  static CacheStreamServer server;
+  return server;
+}
+
+CacheStreamServer::CacheStreamServer()
+    : token_source_(std::random_device{}()) {}
+
+CacheStreamServer::~CacheStreamServer() { Stop(); }
+
+std::string CacheStreamServer::Open(const std::string& path,
+                                    const std::string& extension) {
+  auto file = std::make_shared<CyreneCacheFile>();
+  if (!file->Open(path)) return std::string();
+
+  auto stream = std::make_shared<Stream>();
+  stream->file = std::move(file);
+  stream->content_type = ContentTypeFor(extension);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_ && !Start()) return std::string();
+  char token[33];
+  std::snprintf(token, sizeof(token), "%016llx%016llx",
+                static_cast<unsigned long long>(token_source_()),
+                static_cast<unsigned long long>(token_source_()));
+  streams_[token] = std::move(stream);
+
+  char url[96];
+  std::snprintf(url, sizeof(url), "http://127.0.0.1:%u/%s.",
+                static_cast<unsigned>(port_), token);
+  return url + (extension.empty() ? std::string("bin") : extension);
+}
+
+void CacheStreamServer::Close(const std::string& url) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  streams_.erase(TokenOf(url));
+}
+
+std::shared_ptr<const CacheStreamServer::Stream> CacheStreamServer::Find(
+    const std::string& target) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = streams_.find(TokenOf(target));
+  return it == streams_.end() ? nullptr : it->second;
+}
+
+bool CacheStreamServer::Start() {
+#if defined(_WIN32)
+  static const bool winsock_ready = [] {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }();
+  if (!winsock_ready) return false;
+#endif
+  const SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (s == kInvalidSocket) return false;
+
+  sockaddr_in address = {};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;  // any free port
+  socklen_t length = sizeof(address);
+  if (bind(s, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      listen(s, 16) != 0 ||
+      getsockname(s, reinterpret_cast<sockaddr*>(&address), &length) != 0) {
+    CloseSocket(s);
+    return false;
+  }
+  listen_socket_ = static_cast<intptr_t>(s);
+  port_ = ntohs(address.sin_port);
+  running_ = true;
+  accept_thread_ = std::thread(&CacheStreamServer::AcceptLoop, this);
+  return true;
+}
+
+void CacheStreamServer::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_.exchange(false)) return;
+  }
+  // Shutting the socket down is what wakes a blocked accept() on Linux.
+  ShutdownSocket(ToHandle(listen_socket_));
+  CloseSocket(ToHandle(listen_socket_));
+  accept_thread_.join();
+  listen_socket_ = -1;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (intptr_t connection : connections_) {
+    ShutdownSocket(ToHandle(connection));
+  }
+  connections_done_.wait(lock, [this] { return connections_.empty(); });
+  streams_.clear();
+}
+
+void CacheStreamServer::AcceptLoop() {
+  // Connection threads start from here and inherit what this one runs at.
+  ResetThreadScheduling();
+  while (running_) {
+    const SocketHandle client =
+        accept(ToHandle(listen_socket_), nullptr, nullptr);
+    if (client == kInvalidSocket) {
+      if (!running_) break;
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!running_) {
+      CloseSocket(client);
+      break;
+    }
+    const intptr_t handle = static_cast<intptr_t>(client);
+    connections_.insert(handle);
+    std::thread(&CacheStreamServer::ServeConnection, this, handle).detach();
+  }
+}
+
+void CacheStreamServer::ServeConnection(intptr_t handle) {
+  const SocketHandle s = ToHandle(handle);
+  SetReceiveTimeout(s, kIdleTimeoutSeconds);
+  const int no_delay = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY,
+             reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+
+  std::string pending;
+  std::vector<uint8_t> block(kBlockSize);
+  bool keep_alive = true;
+  while (keep_alive) {
+    size_t head_end;
+    while ((head_end = pending.find("\r\n\r\n")) == std::string::npos) {
+      char chunk[4096];
+      const auto n = recv(s, chunk, sizeof(chunk), 0);
+      if (n <= 0 || pending.size() > kMaxRequestHead) {
+        keep_alive = false;
+        break;
+      }
+      pending.append(chunk, static_cast<size_t>(n));
+    }
+    if (!keep_alive) break;
+    Request request;
+    const bool parsed = ParseRequest(pending.substr(0, head_end), &request);
+    pending.erase(0, head_end + 4);
+    keep_alive = parsed && request.keep_alive;
+
+    const bool head_only = request.method == "HEAD";
+    if (!parsed || (!head_only && request.method != "GET")) {
+      const std::string response = StatusHead(405, "Method Not Allowed", false) +
+                                   "Content-Length: 0\r\n\r\n";
+      SendAll(s, response.data(), response.size());
+      break;
+    }
+    const std::shared_ptr<const Stream> stream = Find(request.target);
+    if (!stream) {
+      const std::string response = StatusHead(404, "Not Found", keep_alive) +
+                                   "Content-Length: 0\r\n\r\n";
+      if (!SendAll(s, response.data(), response.size())) break;
+      continue;
+    }
+
+    const uint64_t size = stream->file->audio_size();
+    uint64_t first = 0;
+    uint64_t last = size == 0 ? 0 : size - 1;
+    const RangeResult range = request.range.empty()
+                                  ? RangeResult::kNone
+                                  : ParseRange(request.range, size, &first, &last);
+    char fields[256];
+    std::string response;
+    if (range == RangeResult::kUnsatisfiable) {
+      std::snprintf(fields, sizeof(fields),
+                    "Content-Range: bytes */%llu\r\nContent-Length: 0\r\n\r\n",
+                    static_cast<unsigned long long>(size));
+      response = StatusHead(416, "Range Not Satisfiable", keep_alive) + fields;
+      if (!SendAll(s, response.data(), response.size())) break;
+      continue;
+    }
+    const uint64_t length = size == 0 ? 0 : last - first + 1;
+    if (range == RangeResult::kSatisfiable) {
+      std::snprintf(fields, sizeof(fields),
+                    "Content-Range: bytes %llu-%llu/%llu\r\n",
+                    static_cast<unsigned long long>(first),
+                    static_cast<unsigned long long>(last),
+                    static_cast<unsigned long long>(size));
+      response = StatusHead(206, "Partial Content", keep_alive) + fields;
+    } else {
+      response = StatusHead(200, "OK", keep_alive);
+    }
+    std::snprintf(fields, sizeof(fields),
+                  "Content-Type: %s\r\nContent-Length: %llu\r\n"
+                  "Accept-Ranges: bytes\r\n\r\n",
+                  stream->content_type.c_str(),
+                  static_cast<unsigned long long>(length));
+    response += fields;
+    if (!SendAll(s, response.data(), response.size())) break;
+    if (head_only) continue;
+
+    // Decrypt one block, send it, repeat: the first bytes leave as soon as
+    // one block is ready, and only one block is ever held.
+    bool sent = true;
+    for (uint64_t offset = first; sent && offset < first + length;) {
+      const size_t want = static_cast<size_t>(
+          std::min<uint64_t>(block.size(), first + length - offset));
+      const size_t n = stream->file->Read(offset, block.data(), want);
+      sent = n == want &&
+             SendAll(s, reinterpret_cast<const char*>(block.data()), n);
+      offset += n;
+    }
+    if (!sent) break;
+  }
+
+  // Closed under the lock so Stop() never shuts down a reused handle.
+  std::lock_guard<std::mutex> lock(mutex_);
+  CloseSocket(s);
+  connections_.erase(handle);
+  if (connections_.empty()) connections_done_.notify_all();
+}
+
+}  // namespace cyrene_music
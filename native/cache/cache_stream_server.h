@@ -0,0 +1,82 @@
+#ifndef NATIVE_CACHE_CACHE_STREAM_SERVER_H_
+#define NATIVE_CACHE_CACHE_STREAM_SERVER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "cache/cyrene_cache_file.h"
+
+namespace cyrene_music {
+
+// Serves cached songs to the player as plain audio over HTTP on 127.0.0.1,
+// decrypting each requested range block by block straight out of the
+// mapped .cyrene file. The player gets a URL instead of a decrypted temp
+// copy, so playback starts after the first block rather than after the
+// whole file has been read, decrypted and written out again.
+//
+// GET and HEAD with single byte ranges and keep-alive, which is what
+// mpv/FFmpeg and the platform players use to probe and seek. Each URL
+// carries an unguessable token; anything else is a 404.
+class CacheStreamServer {
+ public:
+  static CacheStreamServer& Shared();
+
+  CacheStreamServer();
+  ~CacheStreamServer();
+
+  CacheStreamServer(const CacheStreamServer&) = delete;
+  CacheStreamServer& operator=(const CacheStreamServer&) = delete;
+
+  // Maps |path| and returns its URL, ending in ".|extension|" so players
+  // that sniff by name see the right format. Starts the server on first
+  // use. Empty if the file is missing or malformed, or no port is free.
+  std::string Open(const std::string& path, const std::string& extension);
+
+  // Forgets |url|. Requests already being served finish first.
+  void Close(const std::string& url);
+
+  // Stops serving and drops every URL; the destructor does this too.
+  void Stop();
+
+  uint16_t port() const { return port_; }
+
+  // Bytes of audio per read/send, and so what the player waits for before
+  // its first data arrives.
+  static constexpr size_t kBlockSize = 64 * 1024;
+
+ private:
+  struct Stream {
+    std::shared_ptr<const CyreneCacheFile> file;
+    std::string content_type;
+  };
+
+  bool Start();
+  void AcceptLoop();
+  void ServeConnection(intptr_t socket);
+  std::shared_ptr<const Stream> Find(const std::string& target);
+
+  std::atomic<bool> running_{false};
+  intptr_t listen_socket_ = -1;
+  uint16_t port_ = 0;
+  std::thread accept_thread_;
+
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::shared_ptr<const Stream>> streams_;
+  std::mt19937_64 token_source_;
+  // Each connection runs on its own detached thread; Stop() shuts the
+  // sockets and waits for the set to empty.
+  std::unordered_set<intptr_t> connections_;
+  std::condition_variable connections_done_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_CACHE_STREAM_SERVER_H_
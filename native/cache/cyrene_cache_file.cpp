@@ -0,0 +1,212 @@
+#include "cache/cyrene_cache_file.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CYRENE_XOR_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CYRENE_XOR_NEON 1
+#endif
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr size_t kKeyLength = kCyreneCacheKey.size();
+
+// Blocks are a whole number of key periods, so every block starts at the
+// same key phase and XORs against one contiguous run of the key stream.
+constexpr size_t kBlockSize = kKeyLength * 64;
+
+// The key repeated to cover any phase plus a full block.
+struct KeyStream {
+  std::array<uint8_t, kKeyLength + kBlockSize> bytes;
+
+  KeyStream() {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      bytes[i] = static_cast<uint8_t>(kCyreneCacheKey[i % kKeyLength]);
+    }
+  }
+};
+
+const KeyStream& SharedKeyStream() {
+  static const KeyStream stream;
+  return stream;
+}
+
+// out[i] = in[i] ^ key[i] for |size| bytes.
+void XorBlock(const uint8_t* in, const uint8_t* key, uint8_t* out,
+              size_t size) {
+  size_t i = 0;
+#if defined(CYRENE_XOR_SSE2)
+  for (; i + 16 <= size; i += 16) {
+    const __m128i data =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+    const __m128i mask =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(key + i));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                     _mm_xor_si128(data, mask));
+  }
+#elif defined(CYRENE_XOR_NEON)
+  for (; i + 16 <= size; i += 16) {
+    vst1q_u8(out + i, veorq_u8(vld1q_u8(in + i), vld1q_u8(key + i)));
+  }
+#else
+  for (; i + 8 <= size; i += 8) {
+    uint64_t data;
+    uint64_t mask;
+    std::memcpy(&data, in + i, sizeof(data));
+    std::memcpy(&mask, key + i, sizeof(mask));
+    data ^= mask;
+    std::memcpy(out + i, &data, sizeof(data));
+  }
+#endif
+  for (; i < size; ++i) out[i] = in[i] ^ key[i];
+}
+
+}  // namespace
+
+void CyreneXor(const uint8_t* in, uint8_t* out, size_t size,
+               uint64_t key_offset) {
+  const uint8_t* key =
+      SharedKeyStream().bytes.data() + static_cast<size_t>(key_offset % kKeyLength);
+  while (size > 0) {
+    const size_t n = std::min(size, kBlockSize);
+    XorBlock(in, key, out, n);
+    in += n;
+    out += n;
+    size -= n;
+  }
+}
+
+MappedFile::~MappedFile() { Close(); }
+
+#if defined(_WIN32)
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  const int length = MultiByteToWideChar(
+      CP_UTF8, 0, path.data(), static_cast<int>(path.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, path.data(), static_cast<int>(path.size()),
+                      wide.data(), length);
+
+  // Sharing delete lets the cache evict or replace a song that is playing.
+  HANDLE file = CreateFileW(
+      wide.c_str(), GENERIC_READ,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+      OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN,
+      nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0 ||
+      static_cast<uint64_t>(file_size.QuadPart) > SIZE_MAX) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping =
+      CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  void* view = mapping != nullptr
+                   ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)
+                   : nullptr;
+  if (view == nullptr) {
+    if (mapping != nullptr) CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<const uint8_t*>(view);
+  size_ = static_cast<size_t>(file_size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) UnmapViewOfFile(data_);
+  if (mapping_ != nullptr) CloseHandle(mapping_);
+  if (file_ != nullptr) CloseHandle(file_);
+  data_ = nullptr;
+  mapping_ = nullptr;
+  file_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) return false;
+  struct stat info;
+  if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+    close(fd);
+    return false;
+  }
+  void* view = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file alive; the descriptor is not needed.
+  close(fd);
+  if (view == MAP_FAILED) return false;
+  // Songs are streamed front to back; let the kernel read ahead.
+  madvise(view, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+  data_ = static_cast<const uint8_t*>(view);
+  size_ = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+bool CyreneCacheFile::Open(const std::string& path) {
+  metadata_ = std::string_view();
+  audio_ = nullptr;
+  audio_size_ = 0;
+  if (!file_.Open(path) || file_.size() < 4) return false;
+
+  const uint8_t* data = file_.data();
+  const uint64_t metadata_length = (static_cast<uint64_t>(data[0]) << 24) |
+                                   (static_cast<uint64_t>(data[1]) << 16) |
+                                   (static_cast<uint64_t>(data[2]) << 8) |
+                                   static_cast<uint64_t>(data[3]);
+  if (file_.size() - 4 < metadata_length) {
+    file_.Close();
+    return false;
+  }
+  metadata_ = std::string_view(reinterpret_cast<const char*>(data + 4),
+                               static_cast<size_t>(metadata_length));
+  audio_ = data + 4 + metadata_length;
+  audio_size_ = file_.size() - 4 - metadata_length;
+  return true;
+}
+
+size_t CyreneCacheFile::Read(uint64_t offset, uint8_t* out,
+                             size_t size) const {
+  if (offset >= audio_size_) return 0;
+  const size_t n =
+      static_cast<size_t>(std::min<uint64_t>(size, audio_size_ - offset));
+  CyreneXor(audio_ + offset, out, n, offset);
+  return n;
+}
+
+}  // namespace cyrene_music
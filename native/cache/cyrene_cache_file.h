@@ -0,0 +1,79 @@
+#ifndef NATIVE_CACHE_CYRENE_CACHE_FILE_H_
+#define NATIVE_CACHE_CYRENE_CACHE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace cyrene_music {
+
+// The repeating XOR key of .cyrene song files and the cache index, shared
+// with lib/services/cache_service.dart.
+constexpr std::string_view kCyreneCacheKey = "CyreneMusicCacheKey2025";
+
+// XORs |size| bytes of |in| into |out| with the cache key, where
+// |key_offset| is the position of in[0] in the key stream (its offset from
+// the start of the encrypted data). Encryption and decryption are the same
+// operation; |in| and |out| may be the same buffer. Vectorised (SSE2 /
+// NEON, 8-byte words elsewhere).
+void CyreneXor(const uint8_t* in, uint8_t* out, size_t size,
+               uint64_t key_offset);
+
+// A read-only memory mapping of a whole file.
+class MappedFile {
+ public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  // |path| is UTF-8. False if the file cannot be opened or is empty.
+  bool Open(const std::string& path);
+  void Close();
+
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  const uint8_t* data_ = nullptr;
+  size_t size_ = 0;
+#if defined(_WIN32)
+  void* file_ = nullptr;
+  void* mapping_ = nullptr;
+#endif
+};
+
+// A cached song, read in place. The file is
+//   [u32 big-endian metadata length][metadata JSON][XOR-encrypted audio]
+// and is memory-mapped rather than read, so opening costs a header parse
+// and every Read() decrypts only the range asked for.
+class CyreneCacheFile {
+ public:
+  CyreneCacheFile() = default;
+
+  CyreneCacheFile(const CyreneCacheFile&) = delete;
+  CyreneCacheFile& operator=(const CyreneCacheFile&) = delete;
+
+  // False if the file is missing or its header does not fit.
+  bool Open(const std::string& path);
+
+  // The metadata JSON as written by CacheService.
+  std::string_view metadata() const { return metadata_; }
+  uint64_t audio_size() const { return audio_size_; }
+
+  // Decrypts audio bytes from |offset| into |out|; returns how many were
+  // written (short at the end of the audio).
+  size_t Read(uint64_t offset, uint8_t* out, size_t size) const;
+
+ private:
+  MappedFile file_;
+  std::string_view metadata_;
+  const uint8_t* audio_ = nullptr;
+  uint64_t audio_size_ = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_CYRENE_CACHE_FILE_H_
@@ -0,0 +1,97 @@
+#include "cache/cyrene_cache_writer.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "cache/cyrene_cache_file.h"
+
+namespace cyrene_music {
+
+CyreneCacheWriter::CyreneCacheWriter() = default;
+
+CyreneCacheWriter::~CyreneCacheWriter() { Abort(); }
+
+bool CyreneCacheWriter::Begin(const std::string& path,
+                              size_t metadata_reserve) {
+  Abort();
+  if (metadata_reserve > UINT32_MAX) return false;
+  if (!file_.Open(path + ".tmp", RandomAccessFile::Mode::kCreate)) {
+    return false;
+  }
+  path_ = path;
+  metadata_reserve_ = metadata_reserve;
+  audio_size_ = 0;
+  failed_ = false;
+  md5_.Reset();
+  checksum_.clear();
+  if (!buffer_) buffer_ = std::make_unique<uint8_t[]>(kBufferSize);
+  buffered_ = 0;
+  return true;
+}
+
+bool CyreneCacheWriter::Write(const uint8_t* data, size_t size) {
+  if (!file_.is_open() || failed_ || !checksum_.empty()) return false;
+  md5_.Update(data, size);
+  while (size > 0) {
+    const size_t n = std::min(size, kBufferSize - buffered_);
+    // The key phase follows the audio offset, as in CyreneCacheFile::Read.
+    CyreneXor(data, buffer_.get() + buffered_, n, audio_size_);
+    buffered_ += n;
+    audio_size_ += n;
+    data += n;
+    size -= n;
+    if (buffered_ == kBufferSize && !Flush()) return false;
+  }
+  return true;
+}
+
+bool CyreneCacheWriter::Flush() {
+  if (buffered_ == 0) return true;
+  const uint64_t offset = 4 + metadata_reserve_ + audio_size_ - buffered_;
+  if (!file_.WriteAt(offset, buffer_.get(), buffered_)) failed_ = true;
+  buffered_ = 0;
+  return !failed_;
+}
+
+const std::string& CyreneCacheWriter::Digest() {
+  if (checksum_.empty()) checksum_ = md5_.FinishHex();
+  return checksum_;
+}
+
+bool CyreneCacheWriter::Commit(const std::string& metadata) {
+  if (!file_.is_open() || metadata.size() > metadata_reserve_) {
+    Abort();
+    return false;
+  }
+  Digest();
+  std::vector<uint8_t> header(4 + metadata_reserve_, ' ');
+  const uint32_t length = static_cast<uint32_t>(metadata_reserve_);
+  header[0] = static_cast<uint8_t>(length >> 24);
+  header[1] = static_cast<uint8_t>(length >> 16);
+  header[2] = static_cast<uint8_t>(length >> 8);
+  header[3] = static_cast<uint8_t>(length);
+  std::copy(metadata.begin(), metadata.end(), header.begin() + 4);
+
+  // Data before the header, and both on disk before the rename, so a crash
+  // cannot leave a complete-looking file with missing audio.
+  if (!Flush() || !file_.WriteAt(0, header.data(), header.size()) ||
+      !file_.Sync()) {
+    Abort();
+    return false;
+  }
+  file_.Close();
+  if (!RandomAccessFile::Rename(file_.path(), path_)) {
+    RandomAccessFile::Remove(file_.path());
+    return false;
+  }
+  return true;
+}
+
+void CyreneCacheWriter::Abort() {
+  if (!file_.is_open()) return;
+  file_.Close();
+  RandomAccessFile::Remove(file_.path());
+  buffered_ = 0;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,74 @@
+#ifndef NATIVE_CACHE_CYRENE_CACHE_WRITER_H_
+#define NATIVE_CACHE_CYRENE_CACHE_WRITER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "cache/md5.h"
+#include "cache/random_access_file.h"
+
+namespace cyrene_music {
+
+// Writes a .cyrene song file as the audio downloads. Each chunk is hashed
+// (MD5 of the plain audio, as CacheService stores it), XOR-encrypted into a
+// fixed buffer and written out when the buffer fills, so memory stays at
+// one buffer whatever the song size.
+//
+// The metadata JSON sits in front of the audio but holds its size and
+// checksum, so Begin() reserves room for it and Commit() fills it in,
+// padded with spaces (valid JSON whitespace), once the audio is complete.
+// Everything goes to "<path>.tmp", which is flushed and renamed over |path|
+// only on Commit(); readers see the old file or the whole new one, never a
+// partial one.
+class CyreneCacheWriter {
+ public:
+  static constexpr size_t kBufferSize = 256 * 1024;
+
+  CyreneCacheWriter();
+  // Abandons an uncommitted file.
+  ~CyreneCacheWriter();
+
+  CyreneCacheWriter(const CyreneCacheWriter&) = delete;
+  CyreneCacheWriter& operator=(const CyreneCacheWriter&) = delete;
+
+  // |path| is UTF-8. |metadata_reserve| bounds the metadata Commit() may
+  // write.
+  bool Begin(const std::string& path, size_t metadata_reserve);
+
+  // Appends plain audio. False once a write has failed.
+  bool Write(const uint8_t* data, size_t size);
+
+  uint64_t audio_size() const { return audio_size_; }
+
+  // Ends the audio and returns its checksum. No more Write() after this.
+  const std::string& Digest();
+
+  // Writes the header with |metadata|, flushes and moves the file into
+  // place. False, leaving nothing behind, if |metadata| exceeds the reserve
+  // or the file system fails.
+  bool Commit(const std::string& metadata);
+
+  // Deletes the partial file.
+  void Abort();
+
+ private:
+  bool Flush();
+
+  std::string path_;
+  RandomAccessFile file_;
+  size_t metadata_reserve_ = 0;
+  uint64_t audio_size_ = 0;
+  bool failed_ = false;
+
+  Md5 md5_;
+  std::string checksum_;
+
+  std::unique_ptr<uint8_t[]> buffer_;
+  size_t buffered_ = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_CYRENE_CACHE_WRITER_H_
@@ -0,0 +1,37 @@
+#ifndef NATIVE_CACHE_MD5_H_
+#define NATIVE_CACHE_MD5_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cyrene_music {
+
+// Incremental MD5, for the checksum CacheService stores with each cached
+// song (package:crypto's md5 on the Dart side). Not for anything that needs
+// collision resistance.
+class Md5 {
+ public:
+  Md5() { Reset(); }
+
+  void Reset();
+  void Update(const uint8_t* data, size_t size);
+
+  // Pads and returns the digest. Reset() before hashing anything else.
+  std::array<uint8_t, 16> Finish();
+
+  // Finish() as 32 lowercase hex digits.
+  std::string FinishHex();
+
+ private:
+  void Transform(const uint8_t* block);
+
+  uint32_t state_[4];
+  uint64_t length_ = 0;  // bytes
+  uint8_t buffer_[64];
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_MD5_H_
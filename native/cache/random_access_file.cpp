@@ -0,0 +1,200 @@
+#include "cache/random_access_file.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace cyrene_music {
+
+RandomAccessFile::~RandomAccessFile() { Close(); }
+
+#if defined(_WIN32)
+
+namespace {
+
+std::wstring Widen(const std::string& utf8) {
+  const int length = MultiByteToWideChar(
+      CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()),
+                      wide.data(), length);
+  return wide;
+}
+
+OVERLAPPED At(uint64_t offset) {
+  OVERLAPPED position = {};
+  position.Offset = static_cast<DWORD>(offset);
+  position.OffsetHigh = static_cast<DWORD>(offset >> 32);
+  return position;
+}
+
+}  // namespace
+
+bool RandomAccessFile::Open(const std::string& path, Mode mode) {
+  Close();
+  // Shared so a reader (CacheStreamServer's mapping, another index scan)
+  // is not locked out, and so the file can be renamed over.
+  HANDLE handle = CreateFileW(
+      Widen(path).c_str(), GENERIC_READ | GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+      mode == Mode::kCreate         ? CREATE_ALWAYS
+      : mode == Mode::kOpenOrCreate ? OPEN_ALWAYS
+                                    : OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) return false;
+  handle_ = handle;
+  path_ = path;
+  return true;
+}
+
+void RandomAccessFile::Close() {
+  if (handle_ != nullptr) CloseHandle(handle_);
+  handle_ = nullptr;
+}
+
+bool RandomAccessFile::is_open() const { return handle_ != nullptr; }
+
+bool RandomAccessFile::ReadAt(uint64_t offset, uint8_t* out,
+                              size_t size) const {
+  while (size > 0) {
+    OVERLAPPED position = At(offset);
+    const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+    DWORD read = 0;
+    if (!ReadFile(handle_, out, chunk, &read, &position) || read == 0) {
+      return false;
+    }
+    out += read;
+    size -= read;
+    offset += read;
+  }
+  return true;
+}
+
+bool RandomAccessFile::WriteAt(uint64_t offset, const uint8_t* data,
+                               size_t size) {
+  while (size > 0) {
+    OVERLAPPED position = At(offset);
+    const DWORD chunk = static_cast<DWORD>(std::min<size_t>(size, 1u << 30));
+    DWORD written = 0;
+    if (!WriteFile(handle_, data, chunk, &written, &position)) return false;
+    data += written;
+    size -= written;
+    offset += written;
+  }
+  return true;
+}
+
+uint64_t RandomAccessFile::Size() const {
+  LARGE_INTEGER size;
+  return GetFileSizeEx(handle_, &size) ? static_cast<uint64_t>(size.QuadPart)
+                                       : 0;
+}
+
+bool RandomAccessFile::Truncate(uint64_t size) {
+  FILE_END_OF_FILE_INFO info;
+  info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+  return SetFileInformationByHandle(handle_, FileEndOfFileInfo, &info,
+                                    sizeof(info)) != FALSE;
+}
+
+bool RandomAccessFile::Allocate(uint64_t size) {
+  FILE_ALLOCATION_INFO info;
+  info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+  SetFileInformationByHandle(handle_, FileAllocationInfo, &info, sizeof(info));
+  return Truncate(size);
+}
+
+bool RandomAccessFile::Sync() { return FlushFileBuffers(handle_) != FALSE; }
+
+bool RandomAccessFile::Rename(const std::string& from, const std::string& to) {
+  return MoveFileExW(Widen(from).c_str(), Widen(to).c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) !=
+         FALSE;
+}
+
+void RandomAccessFile::Remove(const std::string& path) {
+  DeleteFileW(Widen(path).c_str());
+}
+
+#else
+
+bool RandomAccessFile::Open(const std::string& path, Mode mode) {
+  Close();
+  const int flags = O_RDWR | O_CLOEXEC |
+                    (mode == Mode::kCreate         ? O_CREAT | O_TRUNC
+                     : mode == Mode::kOpenOrCreate ? O_CREAT
+                                                   : 0);
+  const int fd = open(path.c_str(), flags, 0644);
+  if (fd < 0) return false;
+  fd_ = fd;
+  path_ = path;
+  return true;
+}
+
+void RandomAccessFile::Close() {
+  if (fd_ >= 0) close(fd_);
+  fd_ = -1;
+}
+
+bool RandomAccessFile::is_open() const { return fd_ >= 0; }
+
+bool RandomAccessFile::ReadAt(uint64_t offset, uint8_t* out,
+                              size_t size) const {
+  while (size > 0) {
+    const ssize_t n = pread(fd_, out, size, static_cast<off_t>(offset));
+    if (n <= 0) return false;
+    out += n;
+    size -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+bool RandomAccessFile::WriteAt(uint64_t offset, const uint8_t* data,
+                               size_t size) {
+  while (size > 0) {
+    const ssize_t n = pwrite(fd_, data, size, static_cast<off_t>(offset));
+    if (n <= 0) return false;
+    data += n;
+    size -= static_cast<size_t>(n);
+    offset += static_cast<uint64_t>(n);
+  }
+  return true;
+}
+
+uint64_t RandomAccessFile::Size() const {
+  struct stat info;
+  return fstat(fd_, &info) == 0 ? static_cast<uint64_t>(info.st_size) : 0;
+}
+
+bool RandomAccessFile::Truncate(uint64_t size) {
+  return ftruncate(fd_, static_cast<off_t>(size)) == 0;
+}
+
+bool RandomAccessFile::Allocate(uint64_t size) {
+  if (!Truncate(size)) return false;
+  // Reserves the blocks; the size is already right if this is refused.
+  posix_fallocate(fd_, 0, static_cast<off_t>(size));
+  return true;
+}
+
+bool RandomAccessFile::Sync() { return fsync(fd_) == 0; }
+
+bool RandomAccessFile::Rename(const std::string& from, const std::string& to) {
+  return std::rename(from.c_str(), to.c_str()) == 0;
+}
+
+void RandomAccessFile::Remove(const std::string& path) {
+  unlink(path.c_str());
+}
+
+#endif
+
+}  // namespace cyrene_music
@@ -0,0 +1,57 @@
+#ifndef NATIVE_CACHE_RANDOM_ACCESS_FILE_H_
+#define NATIVE_CACHE_RANDOM_ACCESS_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace cyrene_music {
+
+// Positional reads and writes on one file, for the cache writer and the
+// cache index. Paths are UTF-8.
+class RandomAccessFile {
+ public:
+  enum class Mode {
+    kCreate,    // empty the file, creating it if needed
+    kOpenOrCreate,
+    kOpen,      // an existing file only
+  };
+
+  RandomAccessFile() = default;
+  ~RandomAccessFile();
+
+  RandomAccessFile(const RandomAccessFile&) = delete;
+  RandomAccessFile& operator=(const RandomAccessFile&) = delete;
+
+  bool Open(const std::string& path, Mode mode);
+  void Close();
+  bool is_open() const;
+  const std::string& path() const { return path_; }
+
+  bool ReadAt(uint64_t offset, uint8_t* out, size_t size) const;
+  bool WriteAt(uint64_t offset, const uint8_t* data, size_t size);
+  uint64_t Size() const;
+  bool Truncate(uint64_t size);
+  // Sets the size to |size| with the blocks reserved up front, so writes
+  // landing anywhere in the file neither fragment it nor fail for space
+  // midway. Falls back to Truncate() where the file system cannot.
+  bool Allocate(uint64_t size);
+  // Flushes written data to the device.
+  bool Sync();
+
+  // Atomically replaces |to| with |from|.
+  static bool Rename(const std::string& from, const std::string& to);
+  static void Remove(const std::string& path);
+
+ private:
+  std::string path_;
+#if defined(_WIN32)
+  void* handle_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CACHE_RANDOM_ACCESS_FILE_H_
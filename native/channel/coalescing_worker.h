@@ -0,0 +1,131 @@
+#ifndef NATIVE_CHANNEL_COALESCING_WORKER_H_
+#define NATIVE_CHANNEL_COALESCING_WORKER_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+// Latest-wins update queue serviced by one dedicated thread, for pushing
+// state to slow or blocking OS APIs (SMTC, MPRIS) off the platform thread.
+//
+// Post() never blocks on the consumer: it merges the update into the single
+// pending one and returns. The worker applies whatever is pending at most
+// once per |min_interval|, so a burst of track skips costs one apply with
+// the final state instead of one per skip.
+//
+// |Update| must be default constructible (the empty update) and provide
+//   void Merge(Update&& newer);  // newer fields win
+//   bool empty() const;
+//
+// |on_start| and |on_stop| run on the worker thread, before the first and
+// after the last apply, e.g. to enter and leave a COM apartment and to
+// create and release objects that belong to it. The thread runs in the
+// background role: nothing it does is worth delaying a frame for.
+template <typename Update>
+class CoalescingWorker {
+ public:
+  using ApplyCallback = std::function<void(Update& update)>;
+  using ThreadCallback = std::function<void()>;
+
+  CoalescingWorker(std::chrono::milliseconds min_interval, ApplyCallback apply,
+                   ThreadCallback on_start = nullptr,
+                   ThreadCallback on_stop = nullptr)
+      : min_interval_(min_interval),
+        apply_(std::move(apply)),
+        on_start_(std::move(on_start)),
+        on_stop_(std::move(on_stop)),
+        thread_(&CoalescingWorker::Run, this) {}
+
+  ~CoalescingWorker() { Stop(); }
+
+  CoalescingWorker(const CoalescingWorker&) = delete;
+  CoalescingWorker& operator=(const CoalescingWorker&) = delete;
+
+  void Post(Update update) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_.Merge(std::move(update));
+      ++posted_;
+    }
+    wake_.notify_one();
+  }
+
+  // Applies what is still pending, runs |on_stop| and joins. Idempotent,
+  // but only call it from the owning thread.
+  void Stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    wake_.notify_one();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  // Updates posted and applies made; the difference is what coalescing saved.
+  uint64_t posted() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return posted_;
+  }
+  uint64_t applied() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return applied_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void Run() {
+    ScopedThreadRole role(ThreadRole::kBackground);
+    if (on_start_) on_start_();
+    Clock::time_point last_apply = Clock::now() - min_interval_;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+      if (!stopping_) {
+        // Keep merging until the rate limit allows the next apply.
+        wake_.wait_until(lock, last_apply + min_interval_,
+                         [this] { return stopping_; });
+      }
+      if (pending_.empty()) {
+        if (stopping_) break;
+        continue;
+      }
+      Update update = std::move(pending_);
+      pending_ = Update();
+      ++applied_;
+      lock.unlock();
+      apply_(update);
+      last_apply = Clock::now();
+      lock.lock();
+    }
+    lock.unlock();
+    if (on_stop_) on_stop_();
+  }
+
+  const std::chrono::milliseconds min_interval_;
+  ApplyCallback apply_;
+  ThreadCallback on_start_;
+  ThreadCallback on_stop_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  Update pending_;
+  bool stopping_ = false;
+  uint64_t posted_ = 0;
+  uint64_t applied_ = 0;
+
+  // Last, so everything above exists before the thread starts.
+  std::thread thread_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CHANNEL_COALESCING_WORKER_H_
@@ -0,0 +1,248 @@
+#ifndef NATIVE_CHANNEL_METHOD_DISPATCH_H_
+#define NATIVE_CHANNEL_METHOD_DISPATCH_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace cyrene_music {
+
+// FNV-1a, usable in constant expressions.
+constexpr uint64_t HashMethodName(std::string_view name) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (char c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001B3ull;
+  }
+  return hash;
+}
+
+// Method name -> handler lookup for plugin channels: one hash, one probe of
+// an open-addressed table and one string compare, instead of a chain of
+// string compares that is longest for the methods listed last.
+//
+// Built once (typically a function-local static) and read-only afterwards.
+// The names must outlive the table; string literals do.
+template <typename Handler>
+class MethodTable {
+ public:
+  struct Entry {
+    std::string_view name;
+    Handler handler;
+  };
+
+  MethodTable(std::initializer_list<Entry> entries) {
+    size_t capacity = 8;
+    while (capacity < entries.size() * 2) capacity *= 2;
+    slots_.resize(capacity);
+    mask_ = capacity - 1;
+    for (const Entry& entry : entries) {
+      const uint64_t hash = HashMethodName(entry.name);
+      size_t index = static_cast<size_t>(hash) & mask_;
+      while (slots_[index].used) index = (index + 1) & mask_;
+      slots_[index] = {hash, entry.name, entry.handler, true};
+    }
+  }
+
+  // nullptr for unknown methods.
+  const Handler* Find(std::string_view name) const {
+    const uint64_t hash = HashMethodName(name);
+    for (size_t index = static_cast<size_t>(hash) & mask_; slots_[index].used;
+         index = (index + 1) & mask_) {
+      const Slot& slot = slots_[index];
+      if (slot.hash == hash && slot.name == name) return &slot.handler;
+    }
+    return nullptr;
+  }
+
+ private:
+  struct Slot {
+    uint64_t hash = 0;
+    std::string_view name;
+    Handler handler{};
+    bool used = false;
+  };
+
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+};
+
+// Argument schemas. A handler declares its arguments as a fixed list of
+// Required()/Optional() specs and decodes a codec map into them in one
+// pass, without exceptions. Works with any std::variant-based value type
+// whose map is iterable as (key, value) pairs with std::string keys, i.e.
+// flutter::EncodableValue / EncodableMap.
+template <typename T>
+struct ArgSpec {
+  std::string_view key;
+  T* out;
+  bool required;
+};
+
+template <typename T>
+constexpr ArgSpec<T> Required(std::string_view key, T* out) {
+  return {key, out, true};
+}
+
+// Leaves |*out| untouched when the key is absent.
+template <typename T>
+constexpr ArgSpec<T> Optional(std::string_view key, T* out) {
+  return {key, out, false};
+}
+
+struct ArgError {
+  enum class Kind { kNone, kNotAMap, kMissing, kWrongType };
+
+  Kind kind = Kind::kNone;
+  std::string_view key;
+
+  bool ok() const { return kind == Kind::kNone; }
+
+  // "Missing 'text' argument" and friends, for INVALID_ARGUMENT errors.
+  std::string Message() const {
+    switch (kind) {
+      case Kind::kNone:
+        return std::string();
+      case Kind::kNotAMap:
+        return "Expected map argument";
+      case Kind::kMissing:
+        return "Missing '" + std::string(key) + "' argument";
+      case Kind::kWrongType:
+        return "Invalid '" + std::string(key) + "' argument";
+    }
+    return std::string();
+  }
+};
+
+namespace method_dispatch_internal {
+
+template <typename T>
+struct IsVector : std::false_type {};
+template <typename E, typename A>
+struct IsVector<std::vector<E, A>> : std::true_type {};
+
+// Whether |T| is one of the codec value's own alternatives. Takes a pointer
+// so a class derived from std::variant (EncodableValue) deduces its base.
+template <typename T, typename... Alternatives>
+constexpr bool IsAlternative(const std::variant<Alternatives...>*) {
+  return (std::is_same_v<T, Alternatives> || ...);
+}
+
+// Integers arrive as int32 or int64 depending on magnitude; accept either
+// for every integral target, and integers for doubles.
+template <typename T, typename Value>
+bool ReadValue(const Value& value, T* out) {
+  if constexpr (std::is_same_v<T, bool>) {
+    if (const auto* v = std::get_if<bool>(&value)) {
+      *out = *v;
+      return true;
+    }
+    return false;
+  } else if constexpr (std::is_integral_v<T>) {
+    if (const auto* v = std::get_if<int32_t>(&value)) {
+      *out = static_cast<T>(*v);
+      return true;
+    }
+    if (const auto* v = std::get_if<int64_t>(&value)) {
+      *out = static_cast<T>(*v);
+      return true;
+    }
+    return false;
+  } else if constexpr (std::is_floating_point_v<T>) {
+    if (const auto* v = std::get_if<double>(&value)) {
+      *out = static_cast<T>(*v);
+      return true;
+    }
+    int64_t integer = 0;
+    if (ReadValue(value, &integer)) {
+      *out = static_cast<T>(integer);
+      return true;
+    }
+    return false;
+  } else if constexpr (std::is_same_v<T, std::string>) {
+    if (const auto* v = std::get_if<std::string>(&value)) {
+      *out = *v;
+      return true;
+    }
+    return false;
+  } else if constexpr (IsVector<T>::value) {
+    // Typed data (Uint8List, Int64List, ...) has its own alternative.
+    if constexpr (IsAlternative<T>(static_cast<const Value*>(nullptr))) {
+      if (const auto* v = std::get_if<T>(&value)) {
+        *out = *v;
+        return true;
+      }
+    }
+    // Dart lists arrive as a list of values (EncodableList); every element
+    // must decode.
+    const auto* list = std::get_if<std::vector<Value>>(&value);
+    if (list == nullptr) return false;
+    out->clear();
+    out->reserve(list->size());
+    for (const Value& element : *list) {
+      typename T::value_type decoded{};
+      if (!ReadValue(element, &decoded)) return false;
+      out->push_back(std::move(decoded));
+    }
+    return true;
+  } else {
+    static_assert(std::is_same_v<T, void>, "unsupported argument type");
+    return false;
+  }
+}
+
+template <typename Value, typename T>
+bool MatchSpec(std::string_view key, const Value& value, const ArgSpec<T>& spec,
+               bool* found, ArgError* error) {
+  if (*found || key != spec.key) return false;
+  *found = true;
+  if (!ReadValue(value, spec.out) && error->ok()) {
+    *error = {ArgError::Kind::kWrongType, spec.key};
+  }
+  return true;
+}
+
+}  // namespace method_dispatch_internal
+
+// Decodes |map| (nullptr when the call carried no map) into |specs|. Walks
+// the map once, matching each key against the schema, so no key values are
+// constructed for lookups. On failure the first offending key is reported;
+// arguments decoded before it may already have been written.
+template <typename Map, typename... T>
+ArgError DecodeArgs(const Map* map, const ArgSpec<T>&... specs) {
+  using method_dispatch_internal::MatchSpec;
+  constexpr size_t kCount = sizeof...(T);
+  if constexpr (kCount == 0) {
+    return {};
+  } else {
+    if (map == nullptr) return {ArgError::Kind::kNotAMap, {}};
+
+    bool found[kCount] = {};
+    ArgError error;
+    for (const auto& [key_value, value] : *map) {
+      const auto* key = std::get_if<std::string>(&key_value);
+      if (key == nullptr) continue;
+      size_t i = 0;
+      // Stops at the first spec that claims the key.
+      (void)(MatchSpec(*key, value, specs, &found[i++], &error) || ...);
+    }
+    if (!error.ok()) return error;
+
+    const bool required[kCount] = {specs.required...};
+    const std::string_view keys[kCount] = {specs.key...};
+    for (size_t i = 0; i < kCount; ++i) {
+      if (required[i] && !found[i]) return {ArgError::Kind::kMissing, keys[i]};
+    }
+    return error;
+  }
+}
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_CHANNEL_METHOD_DISPATCH_H_
@@ -0,0 +1,461 @@
+#include "cover/cover_art_cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr char kFileMagic[4] = {'C', 'Y', 'C', 'V'};
+constexpr uint32_t kFileVersion = 1;
+constexpr char kFileExtension[] = ".cover";
+
+// Covers are keyed by URL; the file name is its FNV-1a hash and the URL
+// itself is stored in the file to rule out collisions.
+std::string FileNameForKey(const std::string& key) {
+  uint64_t hash = 0xCBF29CE484222325ull;
+  for (char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001B3ull;
+  }
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx",
+                static_cast<unsigned long long>(hash));
+  return std::string(name) + kFileExtension;
+}
+
+void WriteU32(std::ostream& out, uint32_t value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+bool ReadU32(std::istream& in, uint32_t* value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char*>(value), sizeof(*value)));
+}
+
+void WriteSurface(std::ostream& out, const ArgbSurface& surface) {
+  WriteU32(out, static_cast<uint32_t>(surface.width()));
+  WriteU32(out, static_cast<uint32_t>(surface.height()));
+  for (int y = 0; y < surface.height(); ++y) {
+    out.write(reinterpret_cast<const char*>(surface.row(y)),
+              static_cast<std::streamsize>(surface.width()) * 4);
+  }
+}
+
+bool ReadSurface(std::istream& in, int max_size, ArgbSurface* surface) {
+  uint32_t width = 0;
+  uint32_t height = 0;
+  if (!ReadU32(in, &width) || !ReadU32(in, &height)) return false;
+  if (width > static_cast<uint32_t>(max_size) ||
+      height > static_cast<uint32_t>(max_size)) {
+    return false;
+  }
+  ArgbSurface result(static_cast<int>(width), static_cast<int>(height));
+  for (int y = 0; y < result.height(); ++y) {
+    if (!in.read(reinterpret_cast<char*>(result.row(y)),
+                 static_cast<std::streamsize>(width) * 4)) {
+      return false;
+    }
+  }
+  *surface = std::move(result);
+  return true;
+}
+
+void AppendLe(std::vector<uint8_t>* out, uint32_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+}  // namespace
+
+ArgbSurface DownscaleSquare(const ArgbSurface& src, int size) {
+  if (src.empty() || size <= 0) return ArgbSurface();
+  const int side = std::min(src.width(), src.height());
+  const int left = (src.width() - side) / 2;
+  const int top = (src.height() - side) / 2;
+  const int out_size = std::min(side, size);
+  ArgbSurface out(out_size, out_size);
+
+  // Box filter: each output pixel averages the source block it covers.
+  // Averaging premultiplied channels is exact for alpha.
+  for (int y = 0; y < out_size; ++y) {
+    const int y0 = top + static_cast<int>(static_cast<int64_t>(y) * side / out_size);
+    const int y1 =
+        top + static_cast<int>(static_cast<int64_t>(y + 1) * side / out_size);
+    uint32_t* dst = out.row(y);
+    for (int x = 0; x < out_size; ++x) {
+      const int x0 =
+          left + static_cast<int>(static_cast<int64_t>(x) * side / out_size);
+      const int x1 =
+          left + static_cast<int>(static_cast<int64_t>(x + 1) * side / out_size);
+      uint32_t a = 0, r = 0, g = 0, b = 0;
+      for (int sy = y0; sy < y1; ++sy) {
+        const uint32_t* row = src.row(sy);
+        for (int sx = x0; sx < x1; ++sx) {
+          const uint32_t p = row[sx];
+          a += p >> 24;
+          r += (p >> 16) & 0xFF;
+          g += (p >> 8) & 0xFF;
+          b += p & 0xFF;
+        }
+      }
+      const uint32_t n = static_cast<uint32_t>((y1 - y0) * (x1 - x0));
+      dst[x] = ((a / n) << 24) | ((r / n) << 16) | ((g / n) << 8) | (b / n);
+    }
+  }
+  return out;
+}
+
+std::vector<uint8_t> EncodeBmp(const ArgbSurface& surface) {
+  std::vector<uint8_t> bmp;
+  if (surface.empty()) return bmp;
+  const uint32_t pixel_bytes =
+      static_cast<uint32_t>(surface.width()) * surface.height() * 4;
+  const uint32_t header_bytes = 14 + 40;
+  bmp.reserve(header_bytes + pixel_bytes);
+
+  // BITMAPFILEHEADER
+  bmp.push_back('B');
+  bmp.push_back('M');
+  AppendLe(&bmp, header_bytes + pixel_bytes, 4);
+  AppendLe(&bmp, 0, 4);
+  AppendLe(&bmp, header_bytes, 4);
+  // BITMAPINFOHEADER, negative height = top-down rows
+  AppendLe(&bmp, 40, 4);
+  AppendLe(&bmp, static_cast<uint32_t>(surface.width()), 4);
+  AppendLe(&bmp, static_cast<uint32_t>(-surface.height()), 4);
+  AppendLe(&bmp, 1, 2);   // planes
+  AppendLe(&bmp, 32, 2);  // bits per pixel
+  AppendLe(&bmp, 0, 4);   // BI_RGB
+  AppendLe(&bmp, pixel_bytes, 4);
+  AppendLe(&bmp, 2835, 4);  // 72 dpi
+  AppendLe(&bmp, 2835, 4);
+  AppendLe(&bmp, 0, 4);
+  AppendLe(&bmp, 0, 4);
+
+  for (int y = 0; y < surface.height(); ++y) {
+    const uint32_t* row = surface.row(y);
+    for (int x = 0; x < surface.width(); ++x) {
+      const uint32_t p = row[x];
+      const uint32_t a = p >> 24;
+      uint32_t r = (p >> 16) & 0xFF;
+      uint32_t g = (p >> 8) & 0xFF;
+      uint32_t b = p & 0xFF;
+      if (a != 0 && a != 255) {
+        r = std::min<uint32_t>(255, r * 255 / a);
+        g = std::min<uint32_t>(255, g * 255 / a);
+        b = std::min<uint32_t>(255, b * 255 / a);
+      }
+      bmp.push_back(static_cast<uint8_t>(b));
+      bmp.push_back(static_cast<uint8_t>(g));
+      bmp.push_back(static_cast<uint8_t>(r));
+      bmp.push_back(static_cast<uint8_t>(a));
+    }
+  }
+  return bmp;
+}
+
+void CoverArtJobs::Merge(CoverArtJobs&& newer) {
+  if (newer.disk_directory) disk_directory = std::move(newer.disk_directory);
+  if (covers.empty()) {
+    covers = std::move(newer.covers);
+  } else {
+    covers.insert(covers.end(), std::make_move_iterator(newer.covers.begin()),
+                  std::make_move_iterator(newer.covers.end()));
+  }
+}
+
+// static
+CoverArtCache& CoverArtCache::Shared() {
+  static CoverArtCache cache;
+  return cache;
+}
+
+CoverArtCache::CoverArtCache() = default;
+
+void CoverArtCache::Configure(ImageDecoder* decoder,
+                              const CoverArtCacheOptions& options) {
+  // Index the files already on disk, most recently used first.
+  std::vector<std::pair<fs::file_time_type, DiskEntry>> found;
+  if (!options.disk_directory.empty()) {
+    std::error_code error;
+    const fs::path directory = fs::u8path(options.disk_directory);
+    fs::create_directories(directory, error);
+    for (fs::directory_iterator it(directory, error), end;
+         !error && it != end; it.increment(error)) {
+      const fs::path& path = it->path();
+      if (path.extension() == ".tmp") {
+        // Left behind by a write that never finished.
+        std::error_code remove_error;
+        fs::remove(path, remove_error);
+        continue;
+      }
+      if (path.extension() != kFileExtension) continue;
+      std::error_code size_error;
+      std::error_code time_error;
+      const uintmax_t size = fs::file_size(path, size_error);
+      const fs::file_time_type time = fs::last_write_time(path, time_error);
+      if (size_error || time_error) continue;
+      found.push_back(
+          {time, {path.filename().u8string(), static_cast<size_t>(size)}});
+    }
+    std::sort(found.begin(), found.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+  }
+
+  std::vector<std::string> victims;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    decoder_ = decoder;
+    options_ = options;
+    memory_.clear();
+    memory_index_.clear();
+    memory_bytes_ = 0;
+    disk_.clear();
+    disk_index_.clear();
+    disk_bytes_ = 0;
+    for (auto& [time, entry] : found) {
+      disk_bytes_ += entry.bytes;
+      disk_.push_back(std::move(entry));
+      disk_index_[disk_.back().file_name] = std::prev(disk_.end());
+    }
+    victims = EvictDisk();
+  }
+  for (const std::string& victim : victims) {
+    std::error_code error;
+    fs::remove(fs::u8path(victim), error);
+  }
+}
+
+std::shared_ptr<const CoverArt> CoverArtCache::Find(const std::string& key) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = memory_index_.find(key);
+    if (it != memory_index_.end()) {
+      memory_.splice(memory_.begin(), memory_, it->second);
+      ++hits_;
+      return it->second->art;
+    }
+  }
+  std::shared_ptr<const CoverArt> art = LoadFromDisk(key);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (art) {
+    ++hits_;
+    InsertMemory(key, art);
+  } else {
+    ++misses_;
+  }
+  return art;
+}
+
+std::shared_ptr<const CoverArt> CoverArtCache::Put(const std::string& key,
+                                                   const uint8_t* data,
+                                                   size_t size) {
+  ImageDecoder* decoder = nullptr;
+  CoverArtCacheOptions options;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = memory_index_.find(key);
+    if (it != memory_index_.end()) {
+      memory_.splice(memory_.begin(), memory_, it->second);
+      return it->second->art;
+    }
+    decoder = decoder_;
+    options = options_;
+  }
+  if (decoder == nullptr || data == nullptr || size == 0) return nullptr;
+
+  ArgbSurface decoded;
+  if (!decoder->Decode(data, size, &decoded) || decoded.empty()) {
+    return nullptr;
+  }
+  auto art = std::make_shared<CoverArt>();
+  art->thumbnail = DownscaleSquare(decoded, options.thumbnail_size);
+  art->panel = DownscaleSquare(decoded, options.panel_size);
+  if (!options.disk_directory.empty()) StoreToDisk(key, *art);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++decodes_;
+  InsertMemory(key, art);
+  return art;
+}
+
+void CoverArtCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  memory_.clear();
+  memory_index_.clear();
+  memory_bytes_ = 0;
+}
+
+size_t CoverArtCache::memory_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return memory_bytes_;
+}
+
+size_t CoverArtCache::disk_bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return disk_bytes_;
+}
+
+uint64_t CoverArtCache::hits() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return hits_;
+}
+
+uint64_t CoverArtCache::misses() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return misses_;
+}
+
+uint64_t CoverArtCache::decodes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return decodes_;
+}
+
+std::string CoverArtCache::DiskPath(const std::string& file_name) const {
+  return (fs::u8path(options_.disk_directory) / fs::u8path(file_name))
+      .u8string();
+}
+
+std::shared_ptr<const CoverArt> CoverArtCache::LoadFromDisk(
+    const std::string& key) {
+  const std::string file_name = FileNameForKey(key);
+  std::string path;
+  int max_size = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (disk_index_.find(file_name) == disk_index_.end()) return nullptr;
+    path = DiskPath(file_name);
+    max_size = std::max(options_.thumbnail_size, options_.panel_size);
+  }
+
+  std::ifstream in(fs::u8path(path), std::ios::binary);
+  char magic[sizeof(kFileMagic)];
+  uint32_t version = 0;
+  uint32_t key_length = 0;
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kFileMagic, sizeof(magic)) != 0 ||
+      !ReadU32(in, &version) || version != kFileVersion ||
+      !ReadU32(in, &key_length) || key_length != key.size()) {
+    return nullptr;
+  }
+  std::string stored_key(key_length, '\0');
+  if (!in.read(&stored_key[0], key_length) || stored_key != key) {
+    return nullptr;
+  }
+  auto art = std::make_shared<CoverArt>();
+  if (!ReadSurface(in, max_size, &art->thumbnail) ||
+      !ReadSurface(in, max_size, &art->panel)) {
+    return nullptr;
+  }
+  in.close();
+
+  // Persist the recency for the next session's scan.
+  std::error_code error;
+  fs::last_write_time(fs::u8path(path), fs::file_time_type::clock::now(),
+                      error);
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = disk_index_.find(file_name);
+  if (it != disk_index_.end()) TouchDisk(file_name, it->second->bytes);
+  return art;
+}
+
+void CoverArtCache::StoreToDisk(const std::string& key, const CoverArt& art) {
+  const std::string file_name = FileNameForKey(key);
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path = DiskPath(file_name);
+  }
+
+  // Write aside and rename, so a crash never leaves a torn cover behind.
+  const fs::path final_path = fs::u8path(path);
+  fs::path temp_path = final_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    out.write(kFileMagic, sizeof(kFileMagic));
+    WriteU32(out, kFileVersion);
+    WriteU32(out, static_cast<uint32_t>(key.size()));
+    out.write(key.data(), static_cast<std::streamsize>(key.size()));
+    WriteSurface(out, art.thumbnail);
+    WriteSurface(out, art.panel);
+    if (!out) {
+      out.close();
+      std::error_code error;
+      fs::remove(temp_path, error);
+      return;
+    }
+  }
+  std::error_code error;
+  fs::rename(temp_path, final_path, error);
+  if (error) {
+    fs::remove(temp_path, error);
+    return;
+  }
+  const uintmax_t bytes = fs::file_size(final_path, error);
+  if (error) return;
+
+  std::vector<std::string> victims;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    TouchDisk(file_name, static_cast<size_t>(bytes));
+    victims = EvictDisk();
+  }
+  for (const std::string& victim : victims) {
+    fs::remove(fs::u8path(victim), error);
+  }
+}
+
+void CoverArtCache::InsertMemory(const std::string& key,
+                                 std::shared_ptr<const CoverArt> art) {
+  auto existing = memory_index_.find(key);
+  if (existing != memory_index_.end()) {
+    memory_bytes_ -= existing->second->art->bytes();
+    memory_.erase(existing->second);
+    memory_index_.erase(existing);
+  }
+  memory_bytes_ += art->bytes();
+  memory_.push_front({key, std::move(art)});
+  memory_index_[key] = memory_.begin();
+  // Keep at least the newest cover even if it alone exceeds the budget.
+  while (memory_bytes_ > options_.memory_budget_bytes && memory_.size() > 1) {
+    memory_bytes_ -= memory_.back().art->bytes();
+    memory_index_.erase(memory_.back().key);
+    memory_.pop_back();
+  }
+}
+
+void CoverArtCache::TouchDisk(const std::string& file_name, size_t bytes) {
+  auto it = disk_index_.find(file_name);
+  if (it != disk_index_.end()) {
+    disk_bytes_ -= it->second->bytes;
+    disk_.erase(it->second);
+  }
+  disk_.push_front({file_name, bytes});
+  disk_index_[file_name] = disk_.begin();
+  disk_bytes_ += bytes;
+}
+
+std::vector<std::string> CoverArtCache::EvictDisk() {
+  std::vector<std::string> victims;
+  while (disk_bytes_ > options_.disk_budget_bytes && disk_.size() > 1) {
+    disk_bytes_ -= disk_.back().bytes;
+    disk_index_.erase(disk_.back().file_name);
+    victims.push_back(DiskPath(disk_.back().file_name));
+    disk_.pop_back();
+  }
+  return victims;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,148 @@
+#ifndef NATIVE_COVER_COVER_ART_CACHE_H_
+#define NATIVE_COVER_COVER_ART_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "lyric/argb_surface.h"
+#include "lyric/lyric_layout.h"
+
+namespace cyrene_music {
+
+// Platform image decoder (WIC on Windows, gdk-pixbuf on Linux). Decodes an
+// encoded JPEG/PNG/... into a premultiplied ARGB surface.
+class ImageDecoder {
+ public:
+  virtual ~ImageDecoder() = default;
+  virtual bool Decode(const uint8_t* data, size_t size, ArgbSurface* out) = 0;
+};
+
+// One cover, decoded once and downscaled (centre-cropped to a square) to
+// the sizes its consumers draw. Immutable once built, so it is shared
+// between threads as shared_ptr<const CoverArt>.
+struct CoverArt {
+  ArgbSurface thumbnail;  // media controls (SMTC / MPRIS)
+  ArgbSurface panel;      // desktop lyric control panel
+
+  size_t bytes() const { return thumbnail.byte_size() + panel.byte_size(); }
+};
+
+struct CoverArtCacheOptions {
+  int thumbnail_size = 256;
+  // Drawn 1:1 next to the song title in the desktop lyric control panel.
+  int panel_size = lyric_layout::kPanelCoverSize;
+  size_t memory_budget_bytes = 8 * 1024 * 1024;
+  // Empty keeps the cache in memory only.
+  std::string disk_directory;
+  size_t disk_budget_bytes = 64 * 1024 * 1024;
+};
+
+// Centre-crops |src| to a square and box-filters it down to |size| pixels
+// (never up; smaller sources keep their size).
+ArgbSurface DownscaleSquare(const ArgbSurface& src, int size);
+
+// Uncompressed 32-bit top-down BMP of |surface| (straight alpha), the
+// cheapest container the OS media controls accept from memory.
+std::vector<uint8_t> EncodeBmp(const ArgbSurface& surface);
+
+// Work for the thread that feeds a CoverArtCache, in the shape
+// CoalescingWorker expects: covers queue up in arrival order (none is
+// dropped), a new disk directory replaces an older one.
+struct CoverArtJobs {
+  struct Cover {
+    std::string key;
+    std::vector<uint8_t> data;
+  };
+
+  std::optional<std::string> disk_directory;
+  std::vector<Cover> covers;
+
+  void Merge(CoverArtJobs&& newer);
+  bool empty() const { return !disk_directory && covers.empty(); }
+};
+
+// Cover art keyed by URL, bounded by bytes in memory and on disk, both LRU.
+// A miss in memory falls back to the disk cache, which stores the decoded
+// variants so a cover is downloaded and decoded once across sessions.
+// Thread-safe; decoding and disk IO happen outside the lock.
+class CoverArtCache {
+ public:
+  static CoverArtCache& Shared();
+
+  CoverArtCache();
+
+  CoverArtCache(const CoverArtCache&) = delete;
+  CoverArtCache& operator=(const CoverArtCache&) = delete;
+
+  // |decoder| must outlive the cache (or the next Configure). Scans the
+  // disk directory, creating it if needed.
+  void Configure(ImageDecoder* decoder, const CoverArtCacheOptions& options);
+
+  // The cover for |key|, or nullptr when neither cache has it.
+  std::shared_ptr<const CoverArt> Find(const std::string& key);
+
+  // Decodes |data| once and stores the variants. Returns the stored cover,
+  // nullptr when there is no decoder or the data does not decode.
+  std::shared_ptr<const CoverArt> Put(const std::string& key,
+                                      const uint8_t* data, size_t size);
+
+  void Clear();
+
+  size_t memory_bytes() const;
+  size_t disk_bytes() const;
+  uint64_t hits() const;
+  uint64_t misses() const;
+  uint64_t decodes() const;
+
+ private:
+  struct MemoryEntry {
+    std::string key;
+    std::shared_ptr<const CoverArt> art;
+  };
+  struct DiskEntry {
+    std::string file_name;
+    size_t bytes = 0;
+  };
+
+  // Callers hold mutex_, since it reads options_.
+  std::string DiskPath(const std::string& file_name) const;
+  std::shared_ptr<const CoverArt> LoadFromDisk(const std::string& key);
+  void StoreToDisk(const std::string& key, const CoverArt& art);
+
+  // Callers hold mutex_.
+  void InsertMemory(const std::string& key,
+                    std::shared_ptr<const CoverArt> art);
+  void TouchDisk(const std::string& file_name, size_t bytes);
+  // Drops files until the disk budget holds and returns their full paths,
+  // resolved while the directory cannot change, for deleting after the
+  // lock is released.
+  std::vector<std::string> EvictDisk();
+
+  mutable std::mutex mutex_;
+  ImageDecoder* decoder_ = nullptr;
+  CoverArtCacheOptions options_;
+
+  std::list<MemoryEntry> memory_;  // front = most recently used
+  std::unordered_map<std::string, std::list<MemoryEntry>::iterator>
+      memory_index_;
+  size_t memory_bytes_ = 0;
+
+  std::list<DiskEntry> disk_;  // front = most recently used
+  std::unordered_map<std::string, std::list<DiskEntry>::iterator> disk_index_;
+  size_t disk_bytes_ = 0;
+
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  uint64_t decodes_ = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_COVER_COVER_ART_CACHE_H_
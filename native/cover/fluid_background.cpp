@@ -0,0 +1,553 @@
+#include "cover/fluid_background.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CYRENE_FLUID_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CYRENE_FLUID_NEON 1
+#endif
+
+namespace cyrene_music {
+
+namespace {
+
+// One premultiplied RGBA pixel.
+#if defined(CYRENE_FLUID_SSE2)
+using Vec = __m128;
+Vec Zero() { return _mm_setzero_ps(); }
+Vec Load(const float* p) { return _mm_loadu_ps(p); }
+void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+Vec Scale(Vec a, float s) { return _mm_mul_ps(a, _mm_set1_ps(s)); }
+#elif defined(CYRENE_FLUID_NEON)
+using Vec = float32x4_t;
+Vec Zero() { return vdupq_n_f32(0); }
+Vec Load(const float* p) { return vld1q_f32(p); }
+void Store(float* p, Vec v) { vst1q_f32(p, v); }
+Vec Add(Vec a, Vec b) { return vaddq_f32(a, b); }
+Vec Sub(Vec a, Vec b) { return vsubq_f32(a, b); }
+Vec Scale(Vec a, float s) { return vmulq_n_f32(a, s); }
+#else
+struct Vec {
+  float c[4];
+};
+Vec Zero() { return Vec{{0, 0, 0, 0}}; }
+Vec Load(const float* p) { return Vec{{p[0], p[1], p[2], p[3]}}; }
+void Store(float* p, Vec v) { std::copy(v.c, v.c + 4, p); }
+Vec Add(Vec a, Vec b) {
+  return Vec{{a.c[0] + b.c[0], a.c[1] + b.c[1], a.c[2] + b.c[2],
+              a.c[3] + b.c[3]}};
+}
+Vec Sub(Vec a, Vec b) {
+  return Vec{{a.c[0] - b.c[0], a.c[1] - b.c[1], a.c[2] - b.c[2],
+              a.c[3] - b.c[3]}};
+}
+Vec Scale(Vec a, float s) {
+  return Vec{{a.c[0] * s, a.c[1] * s, a.c[2] * s, a.c[3] * s}};
+}
+#endif
+
+// The reference mesh (Apple Music's), 6x6 vertices as normalised x, y.
+constexpr int kMeshCells = 5;
+constexpr float kMesh[(kMeshCells + 1) * (kMeshCells + 1) * 2] = {
+    -0.2351f, -0.0967f, 0.2135f,  -0.1414f, 0.9221f,  -0.0908f, 0.9221f,
+    -0.0685f, 1.3027f,  0.0253f,  1.2351f,  0.1786f,  -0.3768f, 0.1851f,
+    0.2f,     0.2f,     0.6615f,  0.3146f,  0.9543f,  0.0f,     0.6969f,
+    0.1911f,  1.0f,     0.2f,     0.0f,     0.4f,     0.2f,     0.4f,
+    0.0776f,  0.2318f,  0.6f,     0.4f,     0.6615f,  0.3851f,  1.0f,
+    0.4f,     0.0f,     0.6f,     0.1291f,  0.6f,     0.4f,     0.6f,
+    0.4f,     0.4304f,  0.4264f,  0.5792f,  1.2029f,  0.8188f,  -0.1192f,
+    1.0f,     0.6f,     0.8f,     0.4264f,  0.8104f,  0.6f,     0.8f,
+    0.8f,     0.8f,     1.0f,     0.8f,     0.0f,     1.0f,     0.0776f,
+    1.0283f,  0.4f,     1.0f,     0.6f,     1.0f,     0.8f,     1.0f,
+    1.1868f,  1.0283f,
+};
+
+// #50000000 / #50FFFFFF, laid over backgrounds brighter than 0.8 / darker
+// than 0.2.
+constexpr float kVeilAlpha = 79.0f / 255.0f;
+
+struct Point {
+  float x;
+  float y;
+};
+
+int Clamp(int value, int low, int high) {
+  return std::min(std::max(value, low), high);
+}
+
+// Odd box widths for three passes that approximate a Gaussian of |sigma|
+// (Kovesi's construction).
+void BoxRadii(float sigma, int radii[3]) {
+  const double variance = 12.0 * sigma * sigma;
+  int lower = static_cast<int>(std::floor(std::sqrt(variance / 3 + 1)));
+  if (lower % 2 == 0) --lower;
+  const int upper = lower + 2;
+  const int lower_passes = static_cast<int>(
+      std::lround((variance - 3.0 * lower * lower - 12.0 * lower - 9) /
+                  (-4.0 * lower - 4)));
+  for (int i = 0; i < 3; ++i) {
+    radii[i] = ((i < lower_passes ? lower : upper) - 1) / 2;
+  }
+}
+
+// Box blur of radius |r| along rows, edges clamped.
+void BlurRows(const float* in, float* out, int width, int height, int r) {
+  const float scale = 1.0f / (2 * r + 1);
+  const int last = width - 1;
+  for (int y = 0; y < height; ++y) {
+    const float* row = in + static_cast<size_t>(y) * width * 4;
+    float* target = out + static_cast<size_t>(y) * width * 4;
+    Vec sum = Zero();
+    for (int i = -r; i <= r; ++i) {
+      sum = Add(sum, Load(row + Clamp(i, 0, last) * 4));
+    }
+    for (int x = 0; x < width; ++x) {
+      Store(target + x * 4, Scale(sum, scale));
+      sum = Add(sum, Load(row + Clamp(x + r + 1, 0, last) * 4));
+      sum = Sub(sum, Load(row + Clamp(x - r, 0, last) * 4));
+    }
+  }
+}
+
+// The same along columns, a whole row of running sums at a time so the
+// reads stay sequential.
+void BlurColumns(const float* in, float* out, int width, int height, int r,
+                 std::vector<float>* sums) {
+  const float scale = 1.0f / (2 * r + 1);
+  const int last = height - 1;
+  const size_t row_floats = static_cast<size_t>(width) * 4;
+  sums->assign(row_floats, 0.0f);
+  float* sum = sums->data();
+  const auto row = [in, row_floats, last](int y) {
+    return in + static_cast<size_t>(Clamp(y, 0, last)) * row_floats;
+  };
+  for (int i = -r; i <= r; ++i) {
+    const float* source = row(i);
+    for (size_t x = 0; x < row_floats; x += 4) {
+      Store(sum + x, Add(Load(sum + x), Load(source + x)));
+    }
+  }
+  for (int y = 0; y < height; ++y) {
+    float* target = out + static_cast<size_t>(y) * row_floats;
+    const float* incoming = row(y + r + 1);
+    const float* outgoing = row(y - r);
+    for (size_t x = 0; x < row_floats; x += 4) {
+      const Vec total = Load(sum + x);
+      Store(target + x, Scale(total, scale));
+      Store(sum + x, Sub(Add(total, Load(incoming + x)), Load(outgoing + x)));
+    }
+  }
+}
+
+// Weights of an exact Gaussian along a side of |length| pixels with the
+// edges clamped, folded into a length x length matrix: row i holds what
+// each source pixel contributes to pixel i.
+std::vector<float> FoldedGaussian(int length, float sigma) {
+  const int radius = static_cast<int>(std::ceil(3 * sigma));
+  std::vector<float> kernel(2 * radius + 1);
+  float total = 0;
+  for (int i = -radius; i <= radius; ++i) {
+    kernel[i + radius] = std::exp(-0.5f * i * i / (sigma * sigma));
+    total += kernel[i + radius];
+  }
+  std::vector<float> weights(static_cast<size_t>(length) * length, 0.0f);
+  for (int i = 0; i < length; ++i) {
+    float* row = &weights[static_cast<size_t>(i) * length];
+    for (int k = -radius; k <= radius; ++k) {
+      row[Clamp(i + k, 0, length - 1)] += kernel[k + radius] / total;
+    }
+  }
+  return weights;
+}
+
+// Blurs with folded kernels, for sigmas as wide as the image itself, where
+// box passes over clamped edges drift from the Gaussian by several levels.
+// Costs length^2 per row and column, fine on the small first stage.
+void DenseGaussianBlur(std::vector<float>* image, std::vector<float>* temp,
+                       int width, int height, float sigma) {
+  const std::vector<float> across = FoldedGaussian(width, sigma);
+  const std::vector<float> down = FoldedGaussian(height, sigma);
+  temp->resize(image->size());
+  const size_t row_floats = static_cast<size_t>(width) * 4;
+  for (int y = 0; y < height; ++y) {
+    const float* row = image->data() + y * row_floats;
+    float* target = temp->data() + y * row_floats;
+    for (int x = 0; x < width; ++x) {
+      const float* weights = &across[static_cast<size_t>(x) * width];
+      Vec sum = Zero();
+      for (int i = 0; i < width; ++i) {
+        sum = Add(sum, Scale(Load(row + i * 4), weights[i]));
+      }
+      Store(target + x * 4, sum);
+    }
+  }
+  for (int y = 0; y < height; ++y) {
+    const float* weights = &down[static_cast<size_t>(y) * height];
+    float* target = image->data() + y * row_floats;
+    std::fill(target, target + row_floats, 0.0f);
+    for (int i = 0; i < height; ++i) {
+      if (weights[i] == 0) continue;
+      const float* row = temp->data() + i * row_floats;
+      for (size_t x = 0; x < row_floats; x += 4) {
+        Store(target + x,
+              Add(Load(target + x), Scale(Load(row + x), weights[i])));
+      }
+    }
+  }
+}
+
+void GaussianBlur(std::vector<float>* image, std::vector<float>* temp,
+                  int width, int height, float sigma) {
+  if (sigma <= 0) return;
+  if (3 * sigma >= std::min(width, height)) {
+    DenseGaussianBlur(image, temp, width, height, sigma);
+    return;
+  }
+  int radii[3];
+  BoxRadii(sigma, radii);
+  temp->resize(image->size());
+  std::vector<float> sums;
+  for (int r : radii) {
+    if (r <= 0) continue;
+    BlurRows(image->data(), temp->data(), width, height, r);
+    BlurColumns(temp->data(), image->data(), width, height, r, &sums);
+  }
+}
+
+// Bilinear sample at pixel coordinates (centres on .5), edges clamped.
+Vec Sample(const float* image, int width, int height, float u, float v) {
+  const float x = std::min(std::max(u - 0.5f, 0.0f), width - 1.0f);
+  const float y = std::min(std::max(v - 0.5f, 0.0f), height - 1.0f);
+  const int x0 = static_cast<int>(x);
+  const int y0 = static_cast<int>(y);
+  const int x1 = std::min(x0 + 1, width - 1);
+  const int y1 = std::min(y0 + 1, height - 1);
+  const float fx = x - x0;
+  const float fy = y - y0;
+  const float* top = image + static_cast<size_t>(y0) * width * 4;
+  const float* bottom = image + static_cast<size_t>(y1) * width * 4;
+  const Vec upper = Add(Scale(Load(top + x0 * 4), 1 - fx),
+                        Scale(Load(top + x1 * 4), fx));
+  const Vec lower = Add(Scale(Load(bottom + x0 * 4), 1 - fx),
+                        Scale(Load(bottom + x1 * 4), fx));
+  return Add(Scale(upper, 1 - fy), Scale(lower, fy));
+}
+
+void Resize(const std::vector<float>& in, int in_width, int in_height,
+            std::vector<float>* out, int out_width, int out_height) {
+  out->resize(static_cast<size_t>(out_width) * out_height * 4);
+  const float scale_x = static_cast<float>(in_width) / out_width;
+  const float scale_y = static_cast<float>(in_height) / out_height;
+  for (int y = 0; y < out_height; ++y) {
+    float* target = out->data() + static_cast<size_t>(y) * out_width * 4;
+    const float v = (y + 0.5f) * scale_y;
+    for (int x = 0; x < out_width; ++x) {
+      Store(target + x * 4,
+            Sample(in.data(), in_width, in_height, (x + 0.5f) * scale_x, v));
+    }
+  }
+}
+
+// Draws the triangle |p| of |target| from the texture coordinates |t| of
+// |source| (same size) where |covered| is still clear. Triangles are drawn
+// last to first, so this keeps what drawing them in order with
+// BlendMode.src would, and each pixel is sampled once however much the
+// mesh folds over itself.
+void DrawTriangle(const float* source, float* target, uint8_t* covered,
+                  int width, int height, const Point p[3], const Point t[3]) {
+  const float area =
+      (p[1].x - p[0].x) * (p[2].y - p[0].y) -
+      (p[2].x - p[0].x) * (p[1].y - p[0].y);
+  if (std::fabs(area) < 1e-6f) return;
+  const float inverse = 1.0f / area;
+  const int min_x = std::max(
+      0, static_cast<int>(std::floor(std::min({p[0].x, p[1].x, p[2].x}))));
+  const int max_x = std::min(
+      width - 1,
+      static_cast<int>(std::ceil(std::max({p[0].x, p[1].x, p[2].x}))));
+  const int min_y = std::max(
+      0, static_cast<int>(std::floor(std::min({p[0].y, p[1].y, p[2].y}))));
+  const int max_y = std::min(
+      height - 1,
+      static_cast<int>(std::ceil(std::max({p[0].y, p[1].y, p[2].y}))));
+  // Barycentric weights are linear in x along a row: b = offset + slope * cx.
+  const float slope1 = (p[2].y - p[0].y) * inverse;
+  const float slope2 = -(p[1].y - p[0].y) * inverse;
+  constexpr float kEdge = -1e-5f;
+  for (int y = min_y; y <= max_y; ++y) {
+    const float cy = y + 0.5f - p[0].y;
+    const float offset1 = -(p[2].x - p[0].x) * cy * inverse;
+    const float offset2 = (p[1].x - p[0].x) * cy * inverse;
+    const float slopes[3] = {-slope1 - slope2, slope1, slope2};
+    const float offsets[3] = {1 - offset1 - offset2, offset1, offset2};
+
+    // The span where all three are non-negative, padded a pixel; the test
+    // below decides.
+    float low = -1e9f;
+    float high = 1e9f;
+    for (int k = 0; k < 3; ++k) {
+      if (slopes[k] > 0) {
+        low = std::max(low, (kEdge - offsets[k]) / slopes[k]);
+      } else if (slopes[k] < 0) {
+        high = std::min(high, (kEdge - offsets[k]) / slopes[k]);
+      } else if (offsets[k] < kEdge) {
+        high = low - 1;
+      }
+    }
+    if (high < low) continue;
+    const int begin = std::max(
+        min_x, static_cast<int>(std::floor(low + p[0].x - 0.5f)) - 1);
+    const int end = std::min(
+        max_x, static_cast<int>(std::ceil(high + p[0].x - 0.5f)) + 1);
+
+    float* row = target + static_cast<size_t>(y) * width * 4;
+    uint8_t* row_covered = covered + static_cast<size_t>(y) * width;
+    for (int x = begin; x <= end; ++x) {
+      if (row_covered[x]) continue;
+      const float cx = x + 0.5f - p[0].x;
+      const float b1 = offsets[1] + slopes[1] * cx;
+      const float b2 = offsets[2] + slopes[2] * cx;
+      const float b0 = 1 - b1 - b2;
+      if (b0 < kEdge || b1 < kEdge || b2 < kEdge) continue;
+      const float u = b0 * t[0].x + b1 * t[1].x + b2 * t[2].x;
+      const float v = b0 * t[0].y + b1 * t[1].y + b2 * t[2].y;
+      Store(row + x * 4, Sample(source, width, height, u, v));
+      row_covered[x] = 1;
+    }
+  }
+}
+
+// drawVertices of the reference mesh, its distortion scaled by
+// |intensity|; what no triangle covers stays transparent.
+void WarpMesh(const std::vector<float>& source, std::vector<float>* target,
+              std::vector<uint8_t>* covered, int width, int height,
+              float intensity) {
+  target->assign(source.size(), 0.0f);
+  constexpr int kStride = kMeshCells + 1;
+  Point positions[kStride * kStride];
+  Point texture[kStride * kStride];
+  for (int y = 0; y <= kMeshCells; ++y) {
+    for (int x = 0; x <= kMeshCells; ++x) {
+      const int index = y * kStride + x;
+      const float grid_x = static_cast<float>(x) / kMeshCells;
+      const float grid_y = static_cast<float>(y) / kMeshCells;
+      const float mesh_x = kMesh[index * 2];
+      const float mesh_y = kMesh[index * 2 + 1];
+      texture[index] = {grid_x * width, grid_y * height};
+      positions[index] = {
+          (grid_x + (mesh_x - grid_x) * intensity) * width,
+          (grid_y + (mesh_y - grid_y) * intensity) * height};
+    }
+  }
+  covered->assign(static_cast<size_t>(width) * height, 0);
+  for (int cell = kMeshCells * kMeshCells - 1; cell >= 0; --cell) {
+    const int top_left = (cell / kMeshCells) * kStride + cell % kMeshCells;
+    const int top_right = top_left + 1;
+    const int bottom_left = top_left + kStride;
+    const int bottom_right = bottom_left + 1;
+    const int triangles[2][3] = {{top_right, bottom_right, bottom_left},
+                                 {top_left, top_right, bottom_left}};
+    for (const auto& triangle : triangles) {
+      const Point p[3] = {positions[triangle[0]], positions[triangle[1]],
+                          positions[triangle[2]]};
+      const Point t[3] = {texture[triangle[0]], texture[triangle[1]],
+                          texture[triangle[2]]};
+      DrawTriangle(source.data(), target->data(), covered->data(), width,
+                   height, p, t);
+    }
+  }
+}
+
+// The saturation matrix of DynamicBgProcessor (luma weights 0.213, 0.715,
+// 0.072). On premultiplied pixels clamping to [0, alpha] is the same as
+// clamping the straight colour to [0, 1].
+void Saturate(std::vector<float>* image, float saturation) {
+  float* pixel = image->data();
+  for (size_t i = 0; i < image->size(); i += 4, pixel += 4) {
+    const float luma =
+        0.213f * pixel[0] + 0.715f * pixel[1] + 0.072f * pixel[2];
+    for (int c = 0; c < 3; ++c) {
+      const float value = luma + saturation * (pixel[c] - luma);
+      pixel[c] = std::min(std::max(value, 0.0f), pixel[3]);
+    }
+  }
+}
+
+// Rec. 601 luma of the middle third, what the GPU version read back from a
+// 3x3 reduction.
+float CentreBrightness(const std::vector<float>& image, int width,
+                       int height) {
+  const int x0 = width / 3;
+  const int x1 = std::max(x0 + 1, width - width / 3);
+  const int y0 = height / 3;
+  const int y1 = std::max(y0 + 1, height - height / 3);
+  double total = 0;
+  for (int y = y0; y < y1; ++y) {
+    const float* pixel = &image[(static_cast<size_t>(y) * width + x0) * 4];
+    for (int x = x0; x < x1; ++x, pixel += 4) {
+      total += 0.299 * pixel[0] + 0.587 * pixel[1] + 0.114 * pixel[2];
+    }
+  }
+  return static_cast<float>(total / (static_cast<double>(x1 - x0) * (y1 - y0)));
+}
+
+uint8_t ToByte(float value) {
+  return static_cast<uint8_t>(
+      std::min(std::max(value * 255.0f + 0.5f, 0.0f), 255.0f));
+}
+
+}  // namespace
+
+// static
+FluidBackgroundProfile FluidBackgroundProfile::Mobile() {
+  FluidBackgroundProfile profile;
+  profile.initial_sigma = 90;
+  profile.output_width = 250;
+  profile.output_height = 250;
+  profile.final_sigma = 15;
+  return profile;
+}
+
+// static
+FluidBackgroundProfile FluidBackgroundProfile::Desktop() {
+  FluidBackgroundProfile profile;
+  profile.initial_sigma = 12;
+  profile.output_width = 640;
+  profile.output_height = 360;
+  profile.final_sigma = 3;
+  return profile;
+}
+
+bool FluidBackgroundRenderer::Render(const uint8_t* rgba, int width,
+                                     int height, size_t stride,
+                                     const FluidBackgroundProfile& profile,
+                                     uint8_t* out, float* brightness) {
+  if (rgba == nullptr || out == nullptr || width <= 0 || height <= 0 ||
+      profile.initial_width <= 0 || profile.output_width <= 0 ||
+      profile.output_height <= 0) {
+    return false;
+  }
+
+  // 1. Shrink (box filter) and blur.
+  const int small_width = profile.initial_width;
+  const int small_height = std::max(
+      1, static_cast<int>(static_cast<double>(height) * small_width / width));
+  initial_.resize(static_cast<size_t>(small_width) * small_height * 4);
+  DownsampleRgba(rgba, stride, PaletteRegion{0, 0, width, height},
+                 small_width, small_height, initial_.data(), &scratch_);
+  small_.resize(initial_.size());
+  for (size_t i = 0; i < initial_.size(); i += 4) {
+    const float alpha = initial_[i + 3] / 255.0f;
+    for (int c = 0; c < 3; ++c) {
+      small_[i + c] = initial_[i + c] / 255.0f * alpha;
+    }
+    small_[i + 3] = alpha;
+  }
+  GaussianBlur(&small_, &temp_, small_width, small_height,
+               profile.initial_sigma);
+
+  // 2. Warp. 3. Enlarge. 4. Warp again.
+  WarpMesh(small_, &warped_, &covered_, small_width, small_height,
+           profile.mesh_intensity);
+  const int out_width = profile.output_width;
+  const int out_height = profile.output_height;
+  Resize(warped_, small_width, small_height, &large_, out_width, out_height);
+  WarpMesh(large_, &warped_, &covered_, out_width, out_height,
+           profile.mesh_intensity);
+
+  // 5. Blur and saturate.
+  GaussianBlur(&warped_, &temp_, out_width, out_height, profile.final_sigma);
+  Saturate(&warped_, profile.saturation);
+
+  // 6. Veil backgrounds that are too bright or too dark.
+  const float luma = CentreBrightness(warped_, out_width, out_height);
+  if (brightness != nullptr) *brightness = luma;
+  float veil = 0;
+  float veil_color = 0;
+  if (luma > 0.8f) {
+    veil = kVeilAlpha;
+  } else if (luma < 0.2f) {
+    veil = kVeilAlpha;
+    veil_color = kVeilAlpha;
+  }
+  const float keep = 1 - veil;
+  const float* pixel = warped_.data();
+  for (size_t i = 0; i < warped_.size(); i += 4, pixel += 4) {
+    out[i] = ToByte(veil_color + pixel[0] * keep);
+    out[i + 1] = ToByte(veil_color + pixel[1] * keep);
+    out[i + 2] = ToByte(veil_color + pixel[2] * keep);
+    out[i + 3] = ToByte(veil + pixel[3] * keep);
+  }
+  return true;
+}
+
+void FluidBackgroundJobs::Merge(FluidBackgroundJobs&& newer) {
+  if (jobs.empty()) {
+    jobs = std::move(newer.jobs);
+  } else {
+    jobs.insert(jobs.end(), newer.jobs.begin(), newer.jobs.end());
+  }
+}
+
+// static
+FluidBackgroundWorker& FluidBackgroundWorker::Shared() {
+  static FluidBackgroundWorker* worker = new FluidBackgroundWorker();
+  return *worker;
+}
+
+FluidBackgroundWorker::FluidBackgroundWorker()
+    : worker_(std::chrono::milliseconds(0),
+              [this](FluidBackgroundJobs& jobs) { Run(jobs); }) {}
+
+void FluidBackgroundWorker::Post(const FluidBackgroundJobs::Job& job) {
+  FluidBackgroundJobs jobs;
+  jobs.jobs.push_back(job);
+  worker_.Post(std::move(jobs));
+}
+
+void FluidBackgroundWorker::Run(FluidBackgroundJobs& jobs) {
+  for (const FluidBackgroundJobs::Job& job : jobs.jobs) {
+    float brightness = 0;
+    const bool ok = renderer_.Render(job.rgba, job.width, job.height,
+                                     job.stride, job.profile, job.out,
+                                     &brightness);
+    if (job.done != nullptr) job.done(job.id, ok ? 1 : 0, brightness);
+  }
+}
+
+}  // namespace cyrene_music
+
+void cyrene_fluid_background_size(int32_t desktop, int32_t* width,
+                                  int32_t* height) {
+  const cyrene_music::FluidBackgroundProfile profile =
+      desktop ? cyrene_music::FluidBackgroundProfile::Desktop()
+              : cyrene_music::FluidBackgroundProfile::Mobile();
+  *width = profile.output_width;
+  *height = profile.output_height;
+}
+
+void cyrene_fluid_background_submit(const uint8_t* rgba, int32_t width,
+                                    int32_t height, int32_t stride,
+                                    int32_t desktop, uint8_t* out, int64_t id,
+                                    void (*done)(int64_t id, int32_t ok,
+                                                 float brightness)) {
+  cyrene_music::FluidBackgroundJobs::Job job;
+  job.rgba = rgba;
+  job.width = width;
+  job.height = height;
+  job.stride = stride > 0 ? static_cast<size_t>(stride)
+                          : static_cast<size_t>(width) * 4;
+  job.profile = desktop ? cyrene_music::FluidBackgroundProfile::Desktop()
+                        : cyrene_music::FluidBackgroundProfile::Mobile();
+  job.out = out;
+  job.id = id;
+  job.done = done;
+  cyrene_music::FluidBackgroundWorker::Shared().Post(job);
+}
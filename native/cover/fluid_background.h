@@ -0,0 +1,132 @@
+#ifndef NATIVE_COVER_FLUID_BACKGROUND_H_
+#define NATIVE_COVER_FLUID_BACKGROUND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "channel/coalescing_worker.h"
+#include "cover/palette_extractor.h"
+#include "ffi/export.h"
+
+namespace cyrene_music {
+
+// Parameters of the fluid (Apple Music style) player background that
+// DynamicBgProcessor used to build out of ui.Image round trips: shrink the
+// cover to |initial_width| and blur it, warp it through the mesh, enlarge
+// it to the output size, warp it again, blur it, boost the saturation and
+// lay a dark or light veil over it when it is too bright or too dark.
+//
+// The GPU version enlarged to 1000x1000 (1280x720 on desktop) before the
+// last blur. Everything after the first warp is low frequency, so the
+// profiles render at a quarter (half) of that with the blur scaled to
+// match, and the texture is enlarged when it is drawn.
+struct FluidBackgroundProfile {
+  int initial_width = 150;
+  float initial_sigma = 0;
+  int output_width = 0;
+  int output_height = 0;
+  float final_sigma = 0;
+  float saturation = 1.8f;
+  // How far the mesh vertices are pushed past the reference mesh.
+  float mesh_intensity = 1.5f;
+
+  // processImage: square, very soft.
+  static FluidBackgroundProfile Mobile();
+  // processImageDesktop: 16:9, keeps more of the cover's shapes.
+  static FluidBackgroundProfile Desktop();
+};
+
+// Renders fluid backgrounds on the CPU over premultiplied float RGBA, small
+// enough (at most 640x360) that the whole pipeline stays in cache. Blurs
+// are three box passes per axis with running sums (close to a Gaussian, at
+// a constant cost per pixel whatever the sigma), or exact folded kernels
+// when the sigma is as wide as the image; the warp rasterises the mesh
+// triangles with bilinear sampling. Pixels are one SSE2 / NEON vector each
+// where available.
+//
+// Keeps its buffers between calls, so reuse one per thread.
+class FluidBackgroundRenderer {
+ public:
+  FluidBackgroundRenderer() = default;
+
+  FluidBackgroundRenderer(const FluidBackgroundRenderer&) = delete;
+  FluidBackgroundRenderer& operator=(const FluidBackgroundRenderer&) = delete;
+
+  // Renders the cover (straight-alpha RGBA) into |out|, premultiplied RGBA
+  // of profile.output_width x profile.output_height. |brightness| (may be
+  // null) receives the Rec. 601 luma of the centre before the veil, 0..1.
+  bool Render(const uint8_t* rgba, int width, int height, size_t stride,
+              const FluidBackgroundProfile& profile, uint8_t* out,
+              float* brightness);
+
+ private:
+  std::vector<uint8_t> initial_;
+  DownsampleScratch scratch_;
+  std::vector<float> small_;
+  std::vector<float> large_;
+  std::vector<float> warped_;
+  std::vector<float> temp_;
+  std::vector<uint8_t> covered_;
+};
+
+// Render requests for FluidBackgroundWorker, in the shape CoalescingWorker
+// expects: jobs queue up in arrival order, none is dropped.
+struct FluidBackgroundJobs {
+  struct Job {
+    // Owned by the caller until |done| runs.
+    const uint8_t* rgba = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    FluidBackgroundProfile profile;
+    uint8_t* out = nullptr;
+    int64_t id = 0;
+    void (*done)(int64_t id, int32_t ok, float brightness) = nullptr;
+  };
+
+  std::vector<Job> jobs;
+
+  void Merge(FluidBackgroundJobs&& newer);
+  bool empty() const { return jobs.empty(); }
+};
+
+// One background thread rendering fluid backgrounds for Dart; the platform
+// thread only uploads the finished texture. Jobs run in order; each calls
+// its |done| on the worker thread.
+class FluidBackgroundWorker {
+ public:
+  // Never destroyed, for the same reason as PaletteWorker::Shared().
+  static FluidBackgroundWorker& Shared();
+
+  FluidBackgroundWorker();
+
+  FluidBackgroundWorker(const FluidBackgroundWorker&) = delete;
+  FluidBackgroundWorker& operator=(const FluidBackgroundWorker&) = delete;
+
+  void Post(const FluidBackgroundJobs::Job& job);
+
+ private:
+  void Run(FluidBackgroundJobs& jobs);
+
+  // Used on the worker thread only.
+  FluidBackgroundRenderer renderer_;
+  // Last, so the renderer exists before the thread starts.
+  CoalescingWorker<FluidBackgroundJobs> worker_;
+};
+
+}  // namespace cyrene_music
+
+// FFI entry points, see lib/services/dynamic_bg_processor.dart. |desktop|
+// picks FluidBackgroundProfile::Desktop() over Mobile().
+CYRENE_FFI_EXPORT void cyrene_fluid_background_size(int32_t desktop,
+                                                    int32_t* width,
+                                                    int32_t* height);
+// |rgba| and |out| (width*height*4 bytes of the size above) must stay valid
+// until |done| has been called with |id|.
+CYRENE_FFI_EXPORT void cyrene_fluid_background_submit(
+    const uint8_t* rgba, int32_t width, int32_t height, int32_t stride,
+    int32_t desktop, uint8_t* out, int64_t id,
+    void (*done)(int64_t id, int32_t ok, float brightness));
+
+#endif  // NATIVE_COVER_FLUID_BACKGROUND_H_
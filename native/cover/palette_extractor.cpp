@@ -0,0 +1,351 @@
+#include "cover/palette_extractor.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CYRENE_PALETTE_SSE2 1
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#include <arm_neon.h>
+#define CYRENE_PALETTE_NEON 1
+#endif
+
+namespace cyrene_music {
+
+namespace {
+
+// Rows added into the 16-bit partial sums before they are widened; 256
+// rows of 255 still fit.
+constexpr int kPartialRows = 256;
+
+// Histogram key of a colour quantised to 5 bits per channel.
+constexpr size_t kBinCount = 1 << 15;
+
+// partial[i] += row[i] for |size| bytes.
+void AddRow(const uint8_t* row, size_t size, uint16_t* partial) {
+  size_t i = 0;
+#if defined(CYRENE_PALETTE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 16 <= size; i += 16) {
+    const __m128i bytes =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+    __m128i* low = reinterpret_cast<__m128i*>(partial + i);
+    __m128i* high = reinterpret_cast<__m128i*>(partial + i + 8);
+    _mm_storeu_si128(low, _mm_add_epi16(_mm_loadu_si128(low),
+                                        _mm_unpacklo_epi8(bytes, zero)));
+    _mm_storeu_si128(high, _mm_add_epi16(_mm_loadu_si128(high),
+                                         _mm_unpackhi_epi8(bytes, zero)));
+  }
+#elif defined(CYRENE_PALETTE_NEON)
+  for (; i + 16 <= size; i += 16) {
+    const uint8x16_t bytes = vld1q_u8(row + i);
+    vst1q_u16(partial + i,
+              vaddw_u8(vld1q_u16(partial + i), vget_low_u8(bytes)));
+    vst1q_u16(partial + i + 8,
+              vaddw_u8(vld1q_u16(partial + i + 8), vget_high_u8(bytes)));
+  }
+#endif
+  for (; i < size; ++i) partial[i] = static_cast<uint16_t>(partial[i] + row[i]);
+}
+
+// sums[i] += partial[i] for |size| entries.
+void Widen(const uint16_t* partial, size_t size, uint32_t* sums) {
+  size_t i = 0;
+#if defined(CYRENE_PALETTE_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  for (; i + 8 <= size; i += 8) {
+    const __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(partial + i));
+    __m128i* low = reinterpret_cast<__m128i*>(sums + i);
+    __m128i* high = reinterpret_cast<__m128i*>(sums + i + 4);
+    _mm_storeu_si128(low, _mm_add_epi32(_mm_loadu_si128(low),
+                                        _mm_unpacklo_epi16(values, zero)));
+    _mm_storeu_si128(high, _mm_add_epi32(_mm_loadu_si128(high),
+                                         _mm_unpackhi_epi16(values, zero)));
+  }
+#elif defined(CYRENE_PALETTE_NEON)
+  for (; i + 8 <= size; i += 8) {
+    const uint16x8_t values = vld1q_u16(partial + i);
+    vst1q_u32(sums + i, vaddw_u16(vld1q_u32(sums + i), vget_low_u16(values)));
+    vst1q_u32(sums + i + 4,
+              vaddw_u16(vld1q_u32(sums + i + 4), vget_high_u16(values)));
+  }
+#endif
+  for (; i < size; ++i) sums[i] += partial[i];
+}
+
+// Per-channel sum of the RGBA pixels [x0, x1) of summed rows.
+void SumColumns(const uint32_t* sums, int x0, int x1, uint32_t out[4]) {
+#if defined(CYRENE_PALETTE_SSE2)
+  __m128i total = _mm_setzero_si128();
+  for (int x = x0; x < x1; ++x) {
+    total = _mm_add_epi32(
+        total, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sums + x * 4)));
+  }
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), total);
+#elif defined(CYRENE_PALETTE_NEON)
+  uint32x4_t total = vdupq_n_u32(0);
+  for (int x = x0; x < x1; ++x) {
+    total = vaddq_u32(total, vld1q_u32(sums + x * 4));
+  }
+  vst1q_u32(out, total);
+#else
+  out[0] = out[1] = out[2] = out[3] = 0;
+  for (int x = x0; x < x1; ++x) {
+    for (int c = 0; c < 4; ++c) out[c] += sums[x * 4 + c];
+  }
+#endif
+}
+
+// [begin, end) of the source pixels under output pixel |i| of |size|
+// along a side of |length| pixels; never empty. In doubles, as copyResize
+// computes it, so the boxes land on the same pixels.
+void BoxSpan(int i, int size, int length, int* begin, int* end) {
+  const double scale = static_cast<double>(length) / size;
+  *begin = static_cast<int>(i * scale);
+  *end = static_cast<int>((i + 1) * scale);
+  if (*end == *begin) ++*end;
+}
+
+uint32_t ColorOf(uint16_t key) {
+  const uint32_t r = (key >> 10) << 3;
+  const uint32_t g = ((key >> 5) & 0x1F) << 3;
+  const uint32_t b = (key & 0x1F) << 3;
+  return 0xFF000000u | (r << 16) | (g << 8) | b;
+}
+
+// max + min of the channels, twice the HSL lightness in 0..510.
+int LightnessSum(int r, int g, int b) {
+  return std::max({r, g, b}) + std::min({r, g, b});
+}
+
+int LightnessSum(uint16_t key) {
+  return LightnessSum((key >> 10) << 3, ((key >> 5) & 0x1F) << 3,
+                      (key & 0x1F) << 3);
+}
+
+// Most frequent first, then the light (above 0.6) and dark (below 0.4)
+// ones among |ranked|.
+void PickSwatches(const std::vector<uint16_t>& ranked, uint32_t* main,
+                  uint32_t* light, uint32_t* dark) {
+  if (ranked.empty()) return;
+  *main = ColorOf(ranked.front());
+  for (uint16_t key : ranked) {
+    const int lightness = LightnessSum(key);
+    if (lightness > 306 && *light == 0) {
+      *light = ColorOf(key);
+    } else if (lightness < 204 && *dark == 0) {
+      *dark = ColorOf(key);
+    }
+    if (*light != 0 && *dark != 0) break;
+  }
+}
+
+}  // namespace
+
+void DownsampleRgba(const uint8_t* rgba, size_t stride,
+                    const PaletteRegion& region, int out_width,
+                    int out_height, uint8_t* out, DownsampleScratch* scratch) {
+  const size_t row_bytes = static_cast<size_t>(region.width) * 4;
+  const uint8_t* origin = rgba + static_cast<size_t>(region.y) * stride +
+                          static_cast<size_t>(region.x) * 4;
+  for (int out_y = 0; out_y < out_height; ++out_y) {
+    int y0;
+    int y1;
+    BoxSpan(out_y, out_height, region.height, &y0, &y1);
+
+    // Column sums of the rows under this output row, added as bytes into
+    // 16-bit lanes and widened every kPartialRows rows.
+    scratch->sums.assign(row_bytes, 0);
+    for (int chunk = y0; chunk < y1; chunk += kPartialRows) {
+      scratch->partial.assign(row_bytes, 0);
+      const int chunk_end = std::min(y1, chunk + kPartialRows);
+      for (int y = chunk; y < chunk_end; ++y) {
+        AddRow(origin + static_cast<size_t>(y) * stride, row_bytes,
+               scratch->partial.data());
+      }
+      Widen(scratch->partial.data(), row_bytes, scratch->sums.data());
+    }
+
+    for (int out_x = 0; out_x < out_width; ++out_x) {
+      int x0;
+      int x1;
+      BoxSpan(out_x, out_width, region.width, &x0, &x1);
+      uint32_t total[4];
+      SumColumns(scratch->sums.data(), x0, x1, total);
+      const uint32_t count = static_cast<uint32_t>((x1 - x0) * (y1 - y0));
+      uint8_t* pixel =
+          out + (static_cast<size_t>(out_y) * out_width + out_x) * 4;
+      for (int c = 0; c < 4; ++c) {
+        pixel[c] = static_cast<uint8_t>(total[c] / count);
+      }
+    }
+  }
+}
+
+PaletteExtractor::PaletteExtractor() : bins_(kBinCount) {}
+
+template <typename Count>
+void PaletteExtractor::Rank(std::vector<uint16_t>* keys, Count count) const {
+  std::stable_sort(keys->begin(), keys->end(),
+                   [this, &count](uint16_t a, uint16_t b) {
+                     return count(bins_[a]) > count(bins_[b]);
+                   });
+}
+
+bool PaletteExtractor::Extract(const uint8_t* rgba, int width, int height,
+                               size_t stride, const PaletteRegion* region,
+                               int sample_size, Palette* out) {
+  *out = Palette();
+  if (rgba == nullptr || width <= 0 || height <= 0 || sample_size <= 0) {
+    return false;
+  }
+  PaletteRegion area{0, 0, width, height};
+  if (region != nullptr) {
+    // copyCrop: the origin is clamped into the image, the size trimmed to
+    // what is left of it.
+    area.x = std::clamp(region->x, 0, width - 1);
+    area.y = std::clamp(region->y, 0, height - 1);
+    area.width = std::min(region->width, width - area.x);
+    area.height = std::min(region->height, height - area.y);
+    if (area.width <= 0 || area.height <= 0) return false;
+  }
+
+  const size_t count = static_cast<size_t>(sample_size) * sample_size;
+  samples_.resize(count * 4);
+  DownsampleRgba(rgba, stride, area, sample_size, sample_size,
+                 samples_.data(), &scratch_);
+
+  for (uint16_t key : seen_) bins_[key] = Bin();
+  seen_.clear();
+  vibrant_.clear();
+  muted_.clear();
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t* pixel = &samples_[i * 4];
+    if (pixel[3] < 128) continue;
+    const int r = pixel[0];
+    const int g = pixel[1];
+    const int b = pixel[2];
+    const uint16_t key =
+        static_cast<uint16_t>(((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3));
+    Bin& bin = bins_[key];
+    if (bin.all++ == 0) seen_.push_back(key);
+
+    // HSL in integers: lightness in (0.2, 0.8) is max + min in (102, 408),
+    // saturation (max - min) / (255 - |max + min - 255|) against 0.35 is
+    // 20 (max - min) against 7 times the denominator.
+    const int lightness = LightnessSum(r, g, b);
+    if (lightness <= 102 || lightness >= 408) continue;
+    const int chroma = 20 * (std::max({r, g, b}) - std::min({r, g, b}));
+    const int limit = 7 * (255 - std::abs(lightness - 255));
+    if (chroma > limit) {
+      if (bin.vibrant++ == 0) vibrant_.push_back(key);
+    } else if (chroma < limit) {
+      if (bin.muted++ == 0) muted_.push_back(key);
+    }
+  }
+  if (seen_.empty()) return true;
+
+  Rank(&seen_, [](const Bin& bin) { return bin.all; });
+  Rank(&vibrant_, [](const Bin& bin) { return bin.vibrant; });
+  Rank(&muted_, [](const Bin& bin) { return bin.muted; });
+  out->colors[Palette::kDominant] = ColorOf(seen_.front());
+  PickSwatches(vibrant_, &out->colors[Palette::kVibrant],
+               &out->colors[Palette::kLightVibrant],
+               &out->colors[Palette::kDarkVibrant]);
+  PickSwatches(muted_, &out->colors[Palette::kMuted],
+               &out->colors[Palette::kLightMuted],
+               &out->colors[Palette::kDarkMuted]);
+  return true;
+}
+
+void PaletteJobs::Merge(PaletteJobs&& newer) {
+  if (jobs.empty()) {
+    jobs = std::move(newer.jobs);
+  } else {
+    jobs.insert(jobs.end(), newer.jobs.begin(), newer.jobs.end());
+  }
+}
+
+// static
+PaletteWorker& PaletteWorker::Shared() {
+  static PaletteWorker* worker = new PaletteWorker();
+  return *worker;
+}
+
+PaletteWorker::PaletteWorker()
+    : worker_(std::chrono::milliseconds(0),
+              [this](PaletteJobs& jobs) { Run(jobs); }) {}
+
+void PaletteWorker::Post(const PaletteJobs::Job& job) {
+  PaletteJobs jobs;
+  jobs.jobs.push_back(job);
+  worker_.Post(std::move(jobs));
+}
+
+void PaletteWorker::Run(PaletteJobs& jobs) {
+  for (const PaletteJobs::Job& job : jobs.jobs) {
+    Palette palette;
+    const bool ok = extractor_.Extract(
+        job.rgba, job.width, job.height, job.stride,
+        job.has_region ? &job.region : nullptr, job.sample_size, &palette);
+    std::copy(std::begin(palette.colors), std::end(palette.colors),
+              job.colors);
+    if (job.done != nullptr) job.done(job.id, ok ? 1 : 0);
+  }
+}
+
+}  // namespace cyrene_music
+
+namespace {
+
+cyrene_music::PaletteJobs::Job MakeJob(const uint8_t* rgba, int32_t width,
+                                       int32_t height, int32_t stride,
+                                       const int32_t* region,
+                                       int32_t sample_size) {
+  cyrene_music::PaletteJobs::Job job;
+  job.rgba = rgba;
+  job.width = width;
+  job.height = height;
+  job.stride = stride > 0 ? static_cast<size_t>(stride)
+                          : static_cast<size_t>(width) * 4;
+  if (region != nullptr) {
+    job.has_region = true;
+    job.region = {region[0], region[1], region[2], region[3]};
+  }
+  job.sample_size = sample_size;
+  return job;
+}
+
+}  // namespace
+
+int32_t cyrene_palette_extract(const uint8_t* rgba, int32_t width,
+                               int32_t height, int32_t stride,
+                               const int32_t* region, int32_t sample_size,
+                               uint32_t* colors) {
+  thread_local cyrene_music::PaletteExtractor extractor;
+  const cyrene_music::PaletteJobs::Job job =
+      MakeJob(rgba, width, height, stride, region, sample_size);
+  cyrene_music::Palette palette;
+  const bool ok = extractor.Extract(job.rgba, job.width, job.height,
+                                    job.stride,
+                                    job.has_region ? &job.region : nullptr,
+                                    job.sample_size, &palette);
+  std::copy(std::begin(palette.colors), std::end(palette.colors), colors);
+  return ok ? 1 : 0;
+}
+
+void cyrene_palette_submit(const uint8_t* rgba, int32_t width, int32_t height,
+                           int32_t stride, const int32_t* region,
+                           int32_t sample_size, uint32_t* colors, int64_t id,
+                           void (*done)(int64_t id, int32_t ok)) {
+  cyrene_music::PaletteJobs::Job job =
+      MakeJob(rgba, width, height, stride, region, sample_size);
+  job.colors = colors;
+  job.id = id;
+  job.done = done;
+  cyrene_music::PaletteWorker::Shared().Post(job);
+}
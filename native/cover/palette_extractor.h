@@ -0,0 +1,162 @@
+#ifndef NATIVE_COVER_PALETTE_EXTRACTOR_H_
+#define NATIVE_COVER_PALETTE_EXTRACTOR_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "channel/coalescing_worker.h"
+#include "ffi/export.h"
+
+namespace cyrene_music {
+
+// Pixel rectangle of an image, as the Dart Rect it comes from truncated to
+// integers.
+struct PaletteRegion {
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+};
+
+// Colours picked from a cover, 0xAARRGGBB, 0 where the cover has no colour
+// of that kind. Matches the fields of ColorExtractionResult in
+// color_extraction_service.dart.
+struct Palette {
+  enum Swatch {
+    kVibrant,
+    kMuted,
+    kDominant,
+    kLightVibrant,
+    kDarkVibrant,
+    kLightMuted,
+    kDarkMuted,
+    kSwatchCount,
+  };
+
+  uint32_t colors[kSwatchCount] = {};
+};
+
+// Buffers DownsampleRgba reuses between calls.
+struct DownsampleScratch {
+  std::vector<uint32_t> sums;
+  std::vector<uint16_t> partial;
+};
+
+// Box-filters |region| of an RGBA image to |out_width| x |out_height|
+// pixels (up or down, each output pixel the truncated mean of the source
+// pixels under it), like copyResize with Interpolation.average. The rows
+// are summed with SSE2 / NEON where available. |out| holds
+// out_width*out_height*4 bytes; |region| must lie inside the image.
+void DownsampleRgba(const uint8_t* rgba, size_t stride,
+                    const PaletteRegion& region, int out_width,
+                    int out_height, uint8_t* out, DownsampleScratch* scratch);
+
+// The palette the Dart isolate used to compute with the image package:
+// downsample to |sample_size| squared, quantise to 5 bits per channel,
+// count every opaque colour and classify it as vibrant (saturation above
+// 0.35) or muted by HSL, both with lightness in (0.2, 0.8). The dominant,
+// vibrant and muted colours are the most frequent of their kind; the light
+// (lightness above 0.6) and dark (below 0.4) variants the most frequent of
+// those. Ties go to the colour seen first.
+//
+// Keeps its histogram between calls, so reuse one per thread.
+class PaletteExtractor {
+ public:
+  PaletteExtractor();
+
+  PaletteExtractor(const PaletteExtractor&) = delete;
+  PaletteExtractor& operator=(const PaletteExtractor&) = delete;
+
+  // |region| (may be null for the whole image) is clamped to the image the
+  // way copyCrop clamps it. False if nothing is left to sample.
+  bool Extract(const uint8_t* rgba, int width, int height, size_t stride,
+               const PaletteRegion* region, int sample_size, Palette* out);
+
+ private:
+  struct Bin {
+    uint32_t all = 0;
+    uint32_t vibrant = 0;
+    uint32_t muted = 0;
+  };
+
+  // Most frequent of |keys| by |count|, first seen wins ties.
+  template <typename Count>
+  void Rank(std::vector<uint16_t>* keys, Count count) const;
+
+  std::vector<uint8_t> samples_;
+  DownsampleScratch scratch_;
+  std::vector<Bin> bins_;
+  // Keys with a non-zero count, in the order they were first counted.
+  std::vector<uint16_t> seen_;
+  std::vector<uint16_t> vibrant_;
+  std::vector<uint16_t> muted_;
+};
+
+// Extraction requests for PaletteWorker, in the shape CoalescingWorker
+// expects: jobs queue up in arrival order, none is dropped.
+struct PaletteJobs {
+  struct Job {
+    // Owned by the caller until |done| runs.
+    const uint8_t* rgba = nullptr;
+    int width = 0;
+    int height = 0;
+    size_t stride = 0;
+    bool has_region = false;
+    PaletteRegion region;
+    int sample_size = 0;
+    uint32_t* colors = nullptr;  // Palette::kSwatchCount entries
+    int64_t id = 0;
+    void (*done)(int64_t id, int32_t ok) = nullptr;
+  };
+
+  std::vector<Job> jobs;
+
+  void Merge(PaletteJobs&& newer);
+  bool empty() const { return jobs.empty(); }
+};
+
+// One background thread extracting palettes for Dart, so a cover costs a
+// queue push instead of spawning an isolate. Jobs run in order; each calls
+// its |done| on the worker thread.
+class PaletteWorker {
+ public:
+  // Never destroyed: a job finishing during static destruction would call
+  // back into a Dart VM that is already gone.
+  static PaletteWorker& Shared();
+
+  PaletteWorker();
+
+  PaletteWorker(const PaletteWorker&) = delete;
+  PaletteWorker& operator=(const PaletteWorker&) = delete;
+
+  void Post(const PaletteJobs::Job& job);
+
+ private:
+  void Run(PaletteJobs& jobs);
+
+  // Used on the worker thread only.
+  PaletteExtractor extractor_;
+  // Last, so the extractor exists before the thread starts.
+  CoalescingWorker<PaletteJobs> worker_;
+};
+
+}  // namespace cyrene_music
+
+// FFI entry points, see lib/services/native_palette_extractor.dart.
+// |region| is null or {x, y, width, height}; |colors| receives
+// Palette::kSwatchCount colours in Palette::Swatch order.
+CYRENE_FFI_EXPORT int32_t cyrene_palette_extract(const uint8_t* rgba,
+                                                 int32_t width, int32_t height,
+                                                 int32_t stride,
+                                                 const int32_t* region,
+                                                 int32_t sample_size,
+                                                 uint32_t* colors);
+// Same on PaletteWorker; |rgba| and |colors| must stay valid until |done|
+// has been called with |id| and whether a palette was written.
+CYRENE_FFI_EXPORT void cyrene_palette_submit(
+    const uint8_t* rgba, int32_t width, int32_t height, int32_t stride,
+    const int32_t* region, int32_t sample_size, uint32_t* colors, int64_t id,
+    void (*done)(int64_t id, int32_t ok));
+
+#endif  // NATIVE_COVER_PALETTE_EXTRACTOR_H_
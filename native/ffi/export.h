@@ -0,0 +1,14 @@
+#ifndef NATIVE_FFI_EXPORT_H_
+#define NATIVE_FFI_EXPORT_H_
+
+// Marks a C entry point that Dart looks up with dart:ffi. The symbols are
+// exported from the runner executable itself (DynamicLibrary.executable() on
+// Windows, DynamicLibrary.process() on Linux, where the runner is linked with
+// ENABLE_EXPORTS).
+#if defined(_WIN32)
+#define CYRENE_FFI_EXPORT extern "C" __declspec(dllexport)
+#else
+#define CYRENE_FFI_EXPORT extern "C" __attribute__((visibility("default")))
+#endif
+
+#endif  // NATIVE_FFI_EXPORT_H_
@@ -0,0 +1,576 @@
+#include "instance/instance_handoff.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#endif
+
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'C', 'Y', 'A', 'R'};
+constexpr size_t kHeaderSize = 8;  // magic + payload size
+constexpr uint8_t kAck = 1;
+
+// A Windows command line is at most 32767 UTF-16 units; this leaves room
+// for its UTF-8 form.
+constexpr uint32_t kMaxPayload = 256 * 1024;
+constexpr uint32_t kMaxArguments = 4096;
+
+// How long the primary waits on a connected client, and how often a
+// secondary retries while the primary is still starting up.
+constexpr std::chrono::milliseconds kClientTimeout(1000);
+constexpr std::chrono::milliseconds kRetryInterval(5);
+
+void PutU32(std::vector<uint8_t>* out, uint32_t value) {
+  const size_t offset = out->size();
+  out->resize(offset + sizeof(value));
+  std::memcpy(out->data() + offset, &value, sizeof(value));
+}
+
+uint32_t GetU32(const uint8_t* data) {
+  uint32_t value;
+  std::memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+// Payload size from a message header; false if it is not one of ours.
+bool ParseHeader(const uint8_t* header, uint32_t* payload_size) {
+  if (std::memcmp(header, kMagic, sizeof(kMagic)) != 0) return false;
+  *payload_size = GetU32(header + sizeof(kMagic));
+  return *payload_size <= kMaxPayload;
+}
+
+int64_t MillisecondsUntil(std::chrono::steady_clock::time_point deadline) {
+  const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(
+      deadline - std::chrono::steady_clock::now());
+  return left.count() > 0 ? left.count() : 0;
+}
+
+#if defined(_WIN32)
+
+std::wstring Widen(const std::string& utf8) {
+  if (utf8.empty()) return std::wstring();
+  const int length = MultiByteToWideChar(
+      CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()), nullptr, 0);
+  std::wstring wide(static_cast<size_t>(length), L'\0');
+  MultiByteToWideChar(CP_UTF8, 0, utf8.data(), static_cast<int>(utf8.size()),
+                      wide.data(), length);
+  return wide;
+}
+
+// Reads or writes exactly |size| bytes on an overlapped pipe handle, giving
+// up after |timeout|.
+bool TransferExact(HANDLE pipe, HANDLE event, bool write, uint8_t* data,
+                   DWORD size, std::chrono::milliseconds timeout) {
+  DWORD done = 0;
+  while (done < size) {
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = event;
+    ResetEvent(event);
+    const BOOL ok =
+        write ? WriteFile(pipe, data + done, size - done, nullptr, &overlapped)
+              : ReadFile(pipe, data + done, size - done, nullptr, &overlapped);
+    if (!ok && GetLastError() != ERROR_IO_PENDING) return false;
+    if (WaitForSingleObject(event, static_cast<DWORD>(timeout.count())) !=
+        WAIT_OBJECT_0) {
+      CancelIo(pipe);
+      DWORD ignored = 0;
+      GetOverlappedResult(pipe, &overlapped, &ignored, TRUE);
+      return false;
+    }
+    DWORD transferred = 0;
+    if (!GetOverlappedResult(pipe, &overlapped, &transferred, FALSE) ||
+        transferred == 0) {
+      return false;
+    }
+    done += transferred;
+  }
+  return true;
+}
+
+#else
+
+bool SameUser(int fd) {
+  ucred cred = {};
+  socklen_t length = sizeof(cred);
+  return getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &cred, &length) == 0 &&
+         cred.uid == getuid();
+}
+
+void SetSocketTimeouts(int fd, std::chrono::milliseconds timeout) {
+  timeval tv = {};
+  tv.tv_sec = static_cast<time_t>(timeout.count() / 1000);
+  tv.tv_usec = static_cast<suseconds_t>((timeout.count() % 1000) * 1000);
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+bool ReadExact(int fd, uint8_t* data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    const ssize_t n = recv(fd, data + done, size - done, 0);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool WriteExact(int fd, const uint8_t* data, size_t size) {
+  size_t done = 0;
+  while (done < size) {
+    const ssize_t n = send(fd, data + done, size - done, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) continue;
+    if (n <= 0) return false;
+    done += static_cast<size_t>(n);
+  }
+  return true;
+}
+
+bool SocketAddress(const std::string& path, sockaddr_un* address) {
+  if (path.empty() || path.size() >= sizeof(address->sun_path)) return false;
+  std::memset(address, 0, sizeof(*address));
+  address->sun_family = AF_UNIX;
+  std::memcpy(address->sun_path, path.c_str(), path.size() + 1);
+  return true;
+}
+
+#endif
+
+}  // namespace
+
+// static
+InstanceHandoff& InstanceHandoff::Shared() {
+  static InstanceHandoff handoff;
+  return handoff;
+}
+
+InstanceHandoff::InstanceHandoff() = default;
+
+InstanceHandoff::~InstanceHandoff() {
+  Stop();
+#if defined(_WIN32)
+  if (mutex_ != nullptr) CloseHandle(mutex_);
+#else
+  // The lock file stays; removing it would race a starting process.
+  if (lock_fd_ >= 0) close(lock_fd_);
+#endif
+}
+
+// static
+InstanceHandoff::ArgumentList InstanceHandoff::WithAbsolutePaths(
+    const ArgumentList& arguments) {
+  ArgumentList resolved;
+  resolved.reserve(arguments.size());
+  for (const std::string& argument : arguments) {
+    if (argument.empty() || argument[0] == '-' ||
+        argument.find("://") != std::string::npos) {
+      resolved.push_back(argument);
+      continue;
+    }
+    // GetFullPathNameW on Windows; the file need not exist.
+    std::error_code error;
+    const std::filesystem::path path = std::filesystem::u8path(argument);
+    const std::filesystem::path absolute =
+        path.is_absolute() ? path : std::filesystem::absolute(path, error);
+    resolved.push_back(error ? argument
+                             : absolute.lexically_normal().u8string());
+  }
+  return resolved;
+}
+
+// static
+std::vector<uint8_t> InstanceHandoff::Encode(const ArgumentList& arguments) {
+  std::vector<uint8_t> message(kMagic, kMagic + sizeof(kMagic));
+  PutU32(&message, 0);  // payload size, patched below
+  PutU32(&message, static_cast<uint32_t>(arguments.size()));
+  for (const std::string& argument : arguments) {
+    PutU32(&message, static_cast<uint32_t>(argument.size()));
+    message.insert(message.end(), argument.begin(), argument.end());
+  }
+  const uint32_t payload = static_cast<uint32_t>(message.size() - kHeaderSize);
+  std::memcpy(message.data() + sizeof(kMagic), &payload, sizeof(payload));
+  return message;
+}
+
+// static
+bool InstanceHandoff::Decode(const uint8_t* data, size_t size,
+                             ArgumentList* arguments) {
+  uint32_t payload_size = 0;
+  if (size < kHeaderSize || !ParseHeader(data, &payload_size) ||
+      payload_size != size - kHeaderSize || payload_size < sizeof(uint32_t)) {
+    return false;
+  }
+  const uint8_t* cursor = data + kHeaderSize;
+  const uint8_t* end = data + size;
+  const uint32_t count = GetU32(cursor);
+  cursor += sizeof(uint32_t);
+  if (count > kMaxArguments) return false;
+
+  ArgumentList decoded;
+  decoded.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    if (static_cast<size_t>(end - cursor) < sizeof(uint32_t)) return false;
+    const uint32_t length = GetU32(cursor);
+    cursor += sizeof(uint32_t);
+    if (static_cast<size_t>(end - cursor) < length) return false;
+    decoded.emplace_back(reinterpret_cast<const char*>(cursor), length);
+    cursor += length;
+  }
+  if (cursor != end) return false;
+  *arguments = std::move(decoded);
+  return true;
+}
+
+void InstanceHandoff::SetNotify(std::function<void()> notify) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  notify_ = std::move(notify);
+}
+
+void InstanceHandoff::Post(ArgumentList arguments) {
+  std::function<void()> notify;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_.push_back(std::move(arguments));
+    notify = notify_;
+  }
+  if (notify) notify();
+}
+
+std::vector<InstanceHandoff::ArgumentList> InstanceHandoff::TakePending() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  std::vector<ArgumentList> pending;
+  pending.swap(pending_);
+  return pending;
+}
+
+#if defined(_WIN32)
+
+bool InstanceHandoff::ClaimPrimary(const std::string& name) {
+  DWORD session = 0;
+  ProcessIdToSessionId(GetCurrentProcessId(), &session);
+  // Pipe names are machine-wide; the session id keeps them per login like
+  // the Local\ mutex.
+  endpoint_ = "\\\\.\\pipe\\" + name + "-" + std::to_string(session);
+
+  const std::wstring mutex_name = L"Local\\" + Widen(name) + L"InstanceMutex";
+  HANDLE mutex = CreateMutexW(nullptr, TRUE, mutex_name.c_str());
+  if (mutex != nullptr && GetLastError() == ERROR_ALREADY_EXISTS) {
+    CloseHandle(mutex);
+    return false;
+  }
+  // Without a mutex there is no telling; run rather than refuse to start.
+  mutex_ = mutex;
+  primary_ = true;
+  return true;
+}
+
+bool InstanceHandoff::Forward(const ArgumentList& arguments,
+                              std::chrono::milliseconds timeout) {
+  std::vector<uint8_t> message = Encode(arguments);
+  if (endpoint_.empty() || message.size() - kHeaderSize > kMaxPayload) {
+    return false;
+  }
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+  const std::wstring pipe_name = Widen(endpoint_);
+
+  HANDLE pipe = INVALID_HANDLE_VALUE;
+  for (;;) {
+    // Overlapped, so a primary that accepts but never reads or answers
+    // costs at most the rest of |timeout|.
+    pipe = CreateFileW(pipe_name.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                       nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED, nullptr);
+    if (pipe != INVALID_HANDLE_VALUE) break;
+    const DWORD error = GetLastError();
+    const int64_t left = MillisecondsUntil(deadline);
+    if (left == 0) return false;
+    if (error == ERROR_PIPE_BUSY) {
+      // Another secondary is being served.
+      WaitNamedPipeW(pipe_name.c_str(), static_cast<DWORD>(left));
+    } else if (error == ERROR_FILE_NOT_FOUND) {
+      // The primary has not started listening yet.
+      Sleep(static_cast<DWORD>(kRetryInterval.count()));
+    } else {
+      return false;
+    }
+  }
+
+  // This process was just started by the user and may take the
+  // foreground; pass that on so the primary can raise its window.
+  ULONG server_process = 0;
+  if (GetNamedPipeServerProcessId(pipe, &server_process)) {
+    AllowSetForegroundWindow(server_process);
+  }
+
+  const auto left = [&] {
+    return std::chrono::milliseconds(
+        std::max<int64_t>(MillisecondsUntil(deadline), 1));
+  };
+  HANDLE event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  uint8_t ack = 0;
+  const bool ok =
+      event != nullptr &&
+      TransferExact(pipe, event, true, message.data(),
+                    static_cast<DWORD>(message.size()), left()) &&
+      TransferExact(pipe, event, false, &ack, 1, left()) && ack == kAck;
+  if (event != nullptr) CloseHandle(event);
+  CloseHandle(pipe);
+  return ok;
+}
+
+bool InstanceHandoff::Listen() {
+  if (!primary_ || endpoint_.empty() || listening_) return false;
+  // A single pipe instance, reconnected after each client; the first
+  // instance flag refuses a pipe someone else already created.
+  HANDLE pipe = CreateNamedPipeW(
+      Widen(endpoint_).c_str(),
+      PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+          PIPE_REJECT_REMOTE_CLIENTS,
+      1, 4096, 4096, 0, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE) return false;
+  pipe_ = pipe;
+  stop_event_ = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  listening_ = true;
+  listener_ = std::thread(&InstanceHandoff::ListenLoop, this);
+  return true;
+}
+
+void InstanceHandoff::Stop() {
+  if (!listening_.exchange(false)) return;
+  SetEvent(stop_event_);
+  listener_.join();
+  CloseHandle(stop_event_);
+  stop_event_ = nullptr;
+  CloseHandle(pipe_);
+  pipe_ = nullptr;
+}
+
+void InstanceHandoff::ListenLoop() {
+  ResetThreadScheduling();
+  HANDLE connected = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  HANDLE io_event = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+  while (listening_) {
+    OVERLAPPED overlapped = {};
+    overlapped.hEvent = connected;
+    ResetEvent(connected);
+    bool client = false;
+    if (!ConnectNamedPipe(pipe_, &overlapped)) {
+      const DWORD error = GetLastError();
+      if (error == ERROR_IO_PENDING) {
+        HANDLE events[2] = {connected, stop_event_};
+        if (WaitForMultipleObjects(2, events, FALSE, INFINITE) !=
+            WAIT_OBJECT_0) {
+          CancelIo(pipe_);
+          DWORD ignored = 0;
+          GetOverlappedResult(pipe_, &overlapped, &ignored, TRUE);
+          break;
+        }
+        DWORD ignored = 0;
+        client = GetOverlappedResult(pipe_, &overlapped, &ignored, FALSE);
+      } else {
+        client = error == ERROR_PIPE_CONNECTED;
+      }
+    }
+    if (client) ServeClient(pipe_, io_event);
+    DisconnectNamedPipe(pipe_);
+  }
+  CloseHandle(io_event);
+  CloseHandle(connected);
+}
+
+void InstanceHandoff::ServeClient(void* pipe, void* io_event) {
+  HANDLE handle = static_cast<HANDLE>(pipe);
+  HANDLE event = static_cast<HANDLE>(io_event);
+  std::vector<uint8_t> message(kHeaderSize);
+  uint32_t payload_size = 0;
+  if (!TransferExact(handle, event, false, message.data(), kHeaderSize,
+                     kClientTimeout) ||
+      !ParseHeader(message.data(), &payload_size)) {
+    return;
+  }
+  message.resize(kHeaderSize + payload_size);
+  ArgumentList arguments;
+  if (!TransferExact(handle, event, false, message.data() + kHeaderSize,
+                     payload_size, kClientTimeout) ||
+      !Decode(message.data(), message.size(), &arguments)) {
+    return;
+  }
+  uint8_t ack = kAck;
+  TransferExact(handle, event, true, &ack, 1, kClientTimeout);
+  Post(std::move(arguments));
+}
+
+#else
+
+bool InstanceHandoff::ClaimPrimary(const std::string& name) {
+  // $XDG_RUNTIME_DIR is private to the user; /tmp is not, which is why the
+  // uid is in the name there and peers are checked on every connection.
+  std::string base;
+  const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+  if (runtime_dir != nullptr && runtime_dir[0] != '\0') {
+    base = std::string(runtime_dir) + "/" + name;
+  } else {
+    base = "/tmp/" + name + "-" + std::to_string(getuid());
+  }
+  endpoint_ = base + ".sock";
+
+  // Never through a symlink, and only a regular file of our own: in /tmp
+  // anyone may have put something at that path first.
+  const std::string lock_path = base + ".lock";
+  int fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC,
+                0600);
+  struct stat info = {};
+  if (fd >= 0 && (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) ||
+                  info.st_uid != getuid())) {
+    close(fd);
+    fd = -1;
+    errno = EPERM;
+  }
+  if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+    lock_fd_ = fd;
+    primary_ = true;
+    return true;
+  }
+  const int error = errno;
+  if (fd >= 0) close(fd);
+  if (error == EWOULDBLOCK) return false;
+  // Without a lock there is no telling; run, but do not take over a socket
+  // that may belong to a primary after all.
+  endpoint_.clear();
+  primary_ = true;
+  return true;
+}
+
+bool InstanceHandoff::Forward(const ArgumentList& arguments,
+                              std::chrono::milliseconds timeout) {
+  const std::vector<uint8_t> message = Encode(arguments);
+  sockaddr_un address;
+  if (!SocketAddress(endpoint_, &address) ||
+      message.size() - kHeaderSize > kMaxPayload) {
+    return false;
+  }
+  const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+  for (;;) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (connect(fd, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) == 0) {
+      bool ok = SameUser(fd);
+      if (ok) {
+        SetSocketTimeouts(fd, std::chrono::milliseconds(
+                                  std::max<int64_t>(MillisecondsUntil(deadline), 1)));
+        ok = WriteExact(fd, message.data(), message.size());
+      }
+      uint8_t ack = 0;
+      ok = ok && ReadExact(fd, &ack, 1) && ack == kAck;
+      close(fd);
+      return ok;
+    }
+    const int error = errno;
+    close(fd);
+    // No socket yet, or a stale one: the primary is still starting up.
+    if ((error != ENOENT && error != ECONNREFUSED && error != EAGAIN) ||
+        MillisecondsUntil(deadline) == 0) {
+      return false;
+    }
+    std::this_thread::sleep_for(kRetryInterval);
+  }
+}
+
+bool InstanceHandoff::Listen() {
+  sockaddr_un address;
+  if (!primary_ || listening_ || !SocketAddress(endpoint_, &address)) {
+    return false;
+  }
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) return false;
+  // Left behind by a primary that crashed; holding the lock makes it ours.
+  unlink(endpoint_.c_str());
+  if (bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) !=
+          0 ||
+      chmod(endpoint_.c_str(), 0600) != 0 || listen(fd, 8) != 0 ||
+      pipe2(stop_fds_, O_CLOEXEC) != 0) {
+    close(fd);
+    return false;
+  }
+  listen_fd_ = fd;
+  listening_ = true;
+  listener_ = std::thread(&InstanceHandoff::ListenLoop, this);
+  return true;
+}
+
+void InstanceHandoff::Stop() {
+  if (!listening_.exchange(false)) return;
+  const uint8_t wake = 0;
+  while (write(stop_fds_[1], &wake, 1) < 0 && errno == EINTR) {
+  }
+  listener_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  close(stop_fds_[0]);
+  close(stop_fds_[1]);
+  stop_fds_[0] = stop_fds_[1] = -1;
+  unlink(endpoint_.c_str());
+}
+
+void InstanceHandoff::ListenLoop() {
+  ResetThreadScheduling();
+  pollfd fds[2] = {{listen_fd_, POLLIN, 0}, {stop_fds_[0], POLLIN, 0}};
+  while (listening_) {
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) continue;
+      break;
+    }
+    if (fds[1].revents != 0) break;
+    if ((fds[0].revents & POLLIN) == 0) continue;
+    const int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (client < 0) continue;
+    ServeClient(client);
+    close(client);
+  }
+}
+
+void InstanceHandoff::ServeClient(int fd) {
+  if (!SameUser(fd)) return;
+  SetSocketTimeouts(fd, kClientTimeout);
+  std::vector<uint8_t> message(kHeaderSize);
+  uint32_t payload_size = 0;
+  if (!ReadExact(fd, message.data(), kHeaderSize) ||
+      !ParseHeader(message.data(), &payload_size)) {
+    return;
+  }
+  message.resize(kHeaderSize + payload_size);
+  ArgumentList arguments;
+  if (!ReadExact(fd, message.data() + kHeaderSize, payload_size) ||
+      !Decode(message.data(), message.size(), &arguments)) {
+    return;
+  }
+  WriteExact(fd, &kAck, 1);
+  Post(std::move(arguments));
+}
+
+#endif
+
+}  // namespace cyrene_music
@@ -0,0 +1,117 @@
+#ifndef NATIVE_INSTANCE_INSTANCE_HANDOFF_H_
+#define NATIVE_INSTANCE_INSTANCE_HANDOFF_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace cyrene_music {
+
+// Keeps the app to one process per user session. The first process claims
+// the primary role and listens; later ones hand their command-line
+// arguments to it and exit before they bring up a window or an engine.
+//
+// Windows: a named mutex elects the primary, arguments travel over a named
+// pipe local to the session, and a secondary waits on it with a deadline.
+// Linux: flock() on a lock file elects it, arguments travel over a Unix
+// socket in $XDG_RUNTIME_DIR (or /tmp), accepted only from the same user.
+// The lock file is never opened through a symlink or when another user
+// owns it.
+//
+// The primary listens from the moment it has claimed the role, so a
+// secondary started during its cold start is answered right away. Received
+// argument lists are queued until the runner takes them on its own thread
+// with TakePending(); the notify callback (run on the listener thread)
+// tells it when to look.
+class InstanceHandoff {
+ public:
+  using ArgumentList = std::vector<std::string>;
+
+  static InstanceHandoff& Shared();
+
+  InstanceHandoff();
+  ~InstanceHandoff();
+
+  InstanceHandoff(const InstanceHandoff&) = delete;
+  InstanceHandoff& operator=(const InstanceHandoff&) = delete;
+
+  // True if this process is the first under |name|; the claim is held until
+  // the process exits. |name| becomes part of the mutex / pipe / socket
+  // names, so it must be a plain file-name-safe string.
+  bool ClaimPrimary(const std::string& name);
+  bool primary() const { return primary_; }
+
+  // |arguments| with each relative path made absolute against this
+  // process's working directory, which the primary does not share. Flags
+  // ("-..."), URIs ("scheme://...") and empty arguments are kept as they
+  // are. For a secondary to apply before Forward().
+  static ArgumentList WithAbsolutePaths(const ArgumentList& arguments);
+
+  // From a secondary: delivers |arguments| to the primary and waits for its
+  // acknowledgement. Retries while the primary is still starting up; false
+  // if it did not answer within |timeout|.
+  bool Forward(const ArgumentList& arguments,
+               std::chrono::milliseconds timeout);
+
+  // From the primary: starts accepting forwarded lists on a listener
+  // thread.
+  bool Listen();
+
+  // Stops the listener; the destructor does this too.
+  void Stop();
+
+  // Runs after each list has been queued, on the thread that queued it;
+  // nullptr to stop notifying. Must not block.
+  void SetNotify(std::function<void()> notify);
+
+  // Queues a list without going through the transport, e.g. the primary's
+  // own launch arguments.
+  void Post(ArgumentList arguments);
+
+  // Everything queued so far, oldest first.
+  std::vector<ArgumentList> TakePending();
+
+  // Wire format, exposed for the benchmark: a magic, the payload size,
+  // then the argument count and each length-prefixed argument.
+  static std::vector<uint8_t> Encode(const ArgumentList& arguments);
+  // False for a malformed or oversized message.
+  static bool Decode(const uint8_t* data, size_t size, ArgumentList* arguments);
+
+ private:
+  void ListenLoop();
+  // Reads one message from a connected client, acknowledges and queues it.
+#if defined(_WIN32)
+  void ServeClient(void* pipe, void* io_event);
+#else
+  void ServeClient(int fd);
+#endif
+
+  bool primary_ = false;
+  std::string endpoint_;  // pipe name or socket path
+
+#if defined(_WIN32)
+  void* mutex_ = nullptr;
+  void* pipe_ = nullptr;
+  void* stop_event_ = nullptr;
+#else
+  int lock_fd_ = -1;
+  int listen_fd_ = -1;
+  int stop_fds_[2] = {-1, -1};
+#endif
+
+  std::thread listener_;
+  std::atomic<bool> listening_{false};
+
+  std::mutex pending_mutex_;
+  std::vector<ArgumentList> pending_;
+  std::function<void()> notify_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_INSTANCE_INSTANCE_HANDOFF_H_
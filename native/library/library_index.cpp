@@ -0,0 +1,121 @@
+#include "library/library_index.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "cache/cyrene_cache_file.h"
+#include "cache/random_access_file.h"
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr uint8_t kMagic[4] = {'C', 'Y', 'L', 'B'};
+constexpr uint32_t kVersion = 1;
+constexpr size_t kHeaderSize = 12;
+constexpr size_t kEntryFixedSize = 4 + 8 + 8;
+constexpr uint32_t kMaxPathSize = 32 * 1024;
+
+void Store32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+void Store64(uint8_t* out, uint64_t value) {
+  for (int i = 0; i < 8; ++i) out[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint32_t Load32(const uint8_t* in) {
+  uint32_t value = 0;
+  for (int i = 3; i >= 0; --i) value = (value << 8) | in[i];
+  return value;
+}
+
+uint64_t Load64(const uint8_t* in) {
+  uint64_t value = 0;
+  for (int i = 7; i >= 0; --i) value = (value << 8) | in[i];
+  return value;
+}
+
+}  // namespace
+
+bool LibraryIndex::Load(const std::string& path) {
+  entries_.clear();
+  MappedFile file;
+  if (!file.Open(path)) return false;
+  const uint8_t* data = file.data();
+  const size_t size = file.size();
+  if (size < kHeaderSize || std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      Load32(data + 4) != kVersion) {
+    return false;
+  }
+  const uint32_t count = Load32(data + 8);
+  // The count comes from the file; it cannot claim more entries than fit.
+  entries_.reserve(std::min<size_t>(count, (size - kHeaderSize) /
+                                               kEntryFixedSize));
+  size_t offset = kHeaderSize;
+  for (uint32_t i = 0; i < count; ++i) {
+    if (size - offset < kEntryFixedSize) break;
+    const uint32_t path_size = Load32(data + offset);
+    if (path_size > kMaxPathSize ||
+        size - offset - kEntryFixedSize < path_size) {
+      break;
+    }
+    const uint8_t* entry = data + offset + 4;
+    Stamp stamp;
+    stamp.size = Load64(entry + path_size);
+    stamp.mtime = static_cast<int64_t>(Load64(entry + path_size + 8));
+    entries_[std::string(reinterpret_cast<const char*>(entry), path_size)] =
+        stamp;
+    offset += kEntryFixedSize + path_size;
+  }
+  if (entries_.size() != count) {
+    entries_.clear();
+    return false;
+  }
+  return true;
+}
+
+bool LibraryIndex::Save(const std::string& path) const {
+  size_t total = kHeaderSize;
+  for (const auto& [file, stamp] : entries_) {
+    total += kEntryFixedSize + file.size();
+  }
+  std::vector<uint8_t> buffer(total);
+  std::memcpy(buffer.data(), kMagic, sizeof(kMagic));
+  Store32(buffer.data() + 4, kVersion);
+  Store32(buffer.data() + 8, static_cast<uint32_t>(entries_.size()));
+  uint8_t* out = buffer.data() + kHeaderSize;
+  for (const auto& [file, stamp] : entries_) {
+    Store32(out, static_cast<uint32_t>(file.size()));
+    std::memcpy(out + 4, file.data(), file.size());
+    Store64(out + 4 + file.size(), stamp.size);
+    Store64(out + 12 + file.size(), static_cast<uint64_t>(stamp.mtime));
+    out += kEntryFixedSize + file.size();
+  }
+
+  // Written aside and renamed, so a crash keeps the previous snapshot.
+  const std::string temp_path = path + ".tmp";
+  RandomAccessFile temp;
+  if (!temp.Open(temp_path, RandomAccessFile::Mode::kCreate)) return false;
+  const bool ok = temp.WriteAt(0, buffer.data(), buffer.size()) && temp.Sync();
+  temp.Close();
+  if (!ok || !RandomAccessFile::Rename(temp_path, path)) {
+    RandomAccessFile::Remove(temp_path);
+    return false;
+  }
+  return true;
+}
+
+const LibraryIndex::Stamp* LibraryIndex::Find(const std::string& path) const {
+  auto it = entries_.find(path);
+  return it != entries_.end() ? &it->second : nullptr;
+}
+
+void LibraryIndex::Set(const std::string& path, const Stamp& stamp) {
+  entries_[path] = stamp;
+}
+
+void LibraryIndex::Erase(const std::string& path) { entries_.erase(path); }
+
+}  // namespace cyrene_music
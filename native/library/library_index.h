@@ -0,0 +1,53 @@
+#ifndef NATIVE_LIBRARY_LIBRARY_INDEX_H_
+#define NATIVE_LIBRARY_LIBRARY_INDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace cyrene_music {
+
+// Size and modification time of every audio file a library scan has
+// reported, so a rescan opens only the files that are new or changed and
+// can tell which ones disappeared.
+//
+// Kept in memory and persisted as one snapshot, written aside and renamed
+// over the old one after each scan:
+//   "CYLB" u32 version, u32 count, then per file
+//   u32 path size, path (UTF-8), u64 size, i64 mtime
+// all little-endian. The mtime is whatever the file system reports, in its
+// own units; it is only ever compared for equality.
+class LibraryIndex {
+ public:
+  struct Stamp {
+    uint64_t size = 0;
+    int64_t mtime = 0;
+
+    bool operator==(const Stamp& other) const {
+      return size == other.size && mtime == other.mtime;
+    }
+    bool operator!=(const Stamp& other) const { return !(*this == other); }
+  };
+
+  // Replaces the contents with the snapshot at |path|. A missing or
+  // malformed snapshot leaves the index empty and returns false, which
+  // only costs the next scan a full pass.
+  bool Load(const std::string& path);
+  bool Save(const std::string& path) const;
+
+  const Stamp* Find(const std::string& path) const;
+  void Set(const std::string& path, const Stamp& stamp);
+  void Erase(const std::string& path);
+  void Clear() { entries_.clear(); }
+
+  const std::unordered_map<std::string, Stamp>& entries() const {
+    return entries_;
+  }
+
+ private:
+  std::unordered_map<std::string, Stamp> entries_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LIBRARY_LIBRARY_INDEX_H_
@@ -0,0 +1,493 @@
+#include "library/library_scanner.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+#include "cache/md5.h"
+#include "cache/random_access_file.h"
+#include "media/audio_tags.h"
+#include "thread/thread_role.h"
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+namespace cyrene_music {
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Anything bigger next to a song is not a lyric file.
+constexpr uintmax_t kMaxLyricFileBytes = 4 * 1024 * 1024;
+
+bool IsContinuation(uint8_t byte) { return (byte & 0xC0) == 0x80; }
+
+// Length of the well-formed UTF-8 sequence at |data|, or 0.
+size_t Utf8SequenceLength(const uint8_t* data, size_t size) {
+  const uint8_t lead = data[0];
+  if (lead < 0x80) return 1;
+  size_t length;
+  uint32_t min;
+  uint32_t code;
+  if ((lead & 0xE0) == 0xC0) {
+    length = 2;
+    min = 0x80;
+    code = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    length = 3;
+    min = 0x800;
+    code = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    length = 4;
+    min = 0x10000;
+    code = lead & 0x07;
+  } else {
+    return 0;
+  }
+  if (size < length) return 0;
+  for (size_t i = 1; i < length; ++i) {
+    if (!IsContinuation(data[i])) return 0;
+    code = (code << 6) | (data[i] & 0x3F);
+  }
+  if (code < min || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+    return 0;
+  }
+  return length;
+}
+
+bool IsValidUtf8(std::string_view text) {
+  const auto* data = reinterpret_cast<const uint8_t*>(text.data());
+  for (size_t i = 0; i < text.size();) {
+    const size_t length = Utf8SequenceLength(data + i, text.size() - i);
+    if (length == 0) return false;
+    i += length;
+  }
+  return true;
+}
+
+// Tags and lyric files are UTF-8 only by convention, and the channel
+// codecs reject anything else: ill-formed bytes become U+FFFD.
+std::string ToValidUtf8(std::string_view text) {
+  if (IsValidUtf8(text)) return std::string(text);
+  const auto* data = reinterpret_cast<const uint8_t*>(text.data());
+  std::string out;
+  out.reserve(text.size() + 8);
+  for (size_t i = 0; i < text.size();) {
+    const size_t length = Utf8SequenceLength(data + i, text.size() - i);
+    if (length == 0) {
+      out += "\xEF\xBF\xBD";
+      ++i;
+    } else {
+      out.append(text.data() + i, length);
+      i += length;
+    }
+  }
+  return out;
+}
+
+// File names compare the way the file system does: case-insensitively
+// (for ASCII) on Windows.
+std::string FileKey(std::string name) {
+#if defined(_WIN32)
+  for (char& c : name) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+#endif
+  return name;
+}
+
+std::string LowerExtension(const fs::path& path) {
+  std::string extension = path.extension().u8string();
+  if (!extension.empty()) extension.erase(0, 1);
+  for (char& c : extension) {
+    if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+  }
+  return extension;
+}
+
+bool ReadStamp(const fs::directory_entry& entry, LibraryIndex::Stamp* stamp) {
+#if defined(_WIN32)
+  // Both come from the directory listing itself on Windows.
+  std::error_code size_error;
+  std::error_code time_error;
+  stamp->size = entry.file_size(size_error);
+  stamp->mtime = entry.last_write_time(time_error).time_since_epoch().count();
+  return !size_error && !time_error;
+#else
+  // One stat() for both, where the directory_entry accessors take two.
+  struct stat info;
+  if (::stat(entry.path().c_str(), &info) != 0) return false;
+  stamp->size = static_cast<uint64_t>(info.st_size);
+  stamp->mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 +
+                 info.st_mtim.tv_nsec;
+  return true;
+#endif
+}
+
+// Whether |path| lies in the tree under |root|.
+bool IsUnder(const std::string& path, const std::string& root) {
+  if (path.size() <= root.size() || path.compare(0, root.size(), root) != 0) {
+    return false;
+  }
+  const char next = path[root.size()];
+  const char last = root.empty() ? '\0' : root.back();
+#if defined(_WIN32)
+  return next == '\\' || next == '/' || last == '\\' || last == '/';
+#else
+  return next == '/' || last == '/';
+#endif
+}
+
+std::string ReadLyricFile(const fs::path& path) {
+  std::error_code error;
+  const uintmax_t size = fs::file_size(path, error);
+  if (error || size > kMaxLyricFileBytes) return std::string();
+  std::string text(static_cast<size_t>(size), '\0');
+  std::ifstream in(path, std::ios::binary);
+  if (!in.read(&text[0], static_cast<std::streamsize>(text.size()))) {
+    return std::string();
+  }
+  std::string_view view(text);
+  if (view.substr(0, 3) == "\xEF\xBB\xBF") view.remove_prefix(3);
+  return ToValidUtf8(view);
+}
+
+// Same extension choice as LocalLibraryService._saveCoverImage.
+const char* CoverExtension(std::string_view mime) {
+  if (mime.find("png") != std::string_view::npos) return "png";
+  if (mime.find("webp") != std::string_view::npos) return "webp";
+  if (mime.find("gif") != std::string_view::npos) return "gif";
+  return "jpg";
+}
+
+}  // namespace
+
+// State of one scan, shared by its directory and file tasks.
+class LibraryScanner::Scan {
+ public:
+  Scan(LibraryScanner* owner, const LibraryScanOptions& options,
+       const LibraryIndex& index)
+      : owner_(owner),
+        options_(options),
+        index_(index),
+        extensions_(options.extensions.begin(), options.extensions.end()) {}
+
+  void WalkDirectory(const fs::path& directory);
+  void ReadFile(const std::string& path, const LibraryIndex::Stamp& stamp,
+                const fs::path& lyric_path);
+
+  // Delivers the tracks collected so far, if any.
+  void Flush();
+
+  // After the pool went idle: applies what the walk found to |index| and
+  // returns the last batch.
+  LibraryScanBatch Finish(LibraryIndex* index, bool cancelled);
+
+ private:
+  std::string WriteCover(const std::string& path, const AudioTags& tags);
+
+  LibraryScanner* const owner_;
+  const LibraryScanOptions& options_;
+  const LibraryIndex& index_;
+  const std::unordered_set<std::string> extensions_;
+
+  std::atomic<uint64_t> directories_{0};
+  std::atomic<uint64_t> files_{0};
+  std::atomic<uint64_t> changed_{0};
+  std::atomic<uint64_t> unchanged_{0};
+
+  std::mutex mutex_;
+  std::vector<LibraryTrack> tracks_;
+  // Every audio file on disk, and those whose stamp goes into the index:
+  // the unchanged ones and the ones reported.
+  std::vector<std::string> found_;
+  std::vector<std::pair<std::string, LibraryIndex::Stamp>> stamped_;
+};
+
+void LibraryScanner::Scan::WalkDirectory(const fs::path& directory) {
+  if (owner_->cancelled_.load()) return;
+  directories_.fetch_add(1);
+
+  struct AudioFile {
+    std::string path;
+    std::string stem;
+    LibraryIndex::Stamp stamp;
+  };
+  std::vector<AudioFile> audio;
+  std::vector<std::string> lyrics;
+  std::vector<std::string> lyrics_subdirectory;
+  const std::string lyrics_directory_key = FileKey("Lyrics");
+
+  std::error_code error;
+  for (fs::directory_iterator
+           it(directory, fs::directory_options::skip_permission_denied, error),
+       end;
+       !error && it != end; it.increment(error)) {
+    const fs::directory_entry& entry = *it;
+    std::error_code type_error;
+    if (entry.is_symlink(type_error)) continue;
+    if (entry.is_directory(type_error)) {
+      if (FileKey(entry.path().filename().u8string()) ==
+          lyrics_directory_key) {
+        std::error_code lyrics_error;
+        for (fs::directory_iterator lyric_it(entry.path(), lyrics_error);
+             !lyrics_error && lyric_it != fs::directory_iterator();
+             lyric_it.increment(lyrics_error)) {
+          if (LowerExtension(lyric_it->path()) == "lrc") {
+            lyrics_subdirectory.push_back(
+                FileKey(lyric_it->path().filename().u8string()));
+          }
+        }
+      }
+      owner_->pool_->Submit(
+          [this, path = entry.path()] { WalkDirectory(path); });
+      continue;
+    }
+    if (!entry.is_regular_file(type_error)) continue;
+
+    const std::string extension = LowerExtension(entry.path());
+    if (extension == "lrc") {
+      lyrics.push_back(FileKey(entry.path().filename().u8string()));
+      continue;
+    }
+    if (extensions_.count(extension) == 0) continue;
+    AudioFile file;
+    file.path = entry.path().u8string();
+    // Dart could not open a path that is not UTF-8 again.
+    if (!IsValidUtf8(file.path) || !ReadStamp(entry, &file.stamp)) continue;
+    file.stem = entry.path().stem().u8string();
+    audio.push_back(std::move(file));
+  }
+  if (audio.empty()) return;
+  std::sort(lyrics.begin(), lyrics.end());
+  std::sort(lyrics_subdirectory.begin(), lyrics_subdirectory.end());
+
+  files_.fetch_add(audio.size());
+  std::vector<std::pair<std::string, LibraryIndex::Stamp>> unchanged;
+  for (AudioFile& file : audio) {
+    const LibraryIndex::Stamp* known = index_.Find(file.path);
+    if (!options_.full && known != nullptr && *known == file.stamp) {
+      unchanged.emplace_back(file.path, file.stamp);
+      continue;
+    }
+    const std::string lyric_name = file.stem + ".lrc";
+    const std::string lyric_key = FileKey(lyric_name);
+    fs::path lyric_path;
+    if (std::binary_search(lyrics.begin(), lyrics.end(), lyric_key)) {
+      lyric_path = directory / fs::u8path(lyric_name);
+    } else if (std::binary_search(lyrics_subdirectory.begin(),
+                                  lyrics_subdirectory.end(), lyric_key)) {
+      lyric_path = directory / "Lyrics" / fs::u8path(lyric_name);
+    }
+    owner_->pool_->Submit([this, path = file.path, stamp = file.stamp,
+                           lyric_path = std::move(lyric_path)] {
+      ReadFile(path, stamp, lyric_path);
+    });
+  }
+  unchanged_.fetch_add(unchanged.size());
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (AudioFile& file : audio) found_.push_back(std::move(file.path));
+  for (auto& entry : unchanged) stamped_.push_back(std::move(entry));
+}
+
+void LibraryScanner::Scan::ReadFile(const std::string& path,
+                                    const LibraryIndex::Stamp& stamp,
+                                    const fs::path& lyric_path) {
+  if (owner_->cancelled_.load()) return;
+
+  LibraryTrack track;
+  track.path = path;
+  AudioTags tags;
+  if (tags.Open(path)) {
+    track.format = static_cast<int32_t>(tags.format());
+    track.title = ToValidUtf8(tags.title());
+    track.artist = ToValidUtf8(tags.artist());
+    track.album = ToValidUtf8(tags.album());
+    if (!options_.cover_directory.empty() && tags.cover().data != nullptr) {
+      track.cover_path = WriteCover(path, tags);
+    }
+  }
+  if (!lyric_path.empty()) {
+    track.lyric = ReadLyricFile(lyric_path);
+  } else if (track.format != 0) {
+    track.lyric = ToValidUtf8(tags.lyrics());
+  }
+  changed_.fetch_add(1);
+
+  LibraryScanBatch batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tracks_.push_back(std::move(track));
+    stamped_.emplace_back(path, stamp);
+    if (tracks_.size() < options_.batch_size) return;
+    batch.tracks.swap(tracks_);
+  }
+  owner_->Post(std::move(batch));
+}
+
+std::string LibraryScanner::Scan::WriteCover(const std::string& path,
+                                             const AudioTags& tags) {
+  Md5 md5;
+  md5.Update(reinterpret_cast<const uint8_t*>(path.data()), path.size());
+  const fs::path cover_path =
+      fs::u8path(options_.cover_directory) /
+      fs::u8path(md5.FinishHex() + "." +
+                 CoverExtension(tags.field(AudioTags::kCoverMime)));
+  std::error_code error;
+  // Same name for the same song, so a rescan of a changed file keeps the
+  // cover it already has, like the Dart side does.
+  if (fs::exists(cover_path, error)) return cover_path.u8string();
+
+  // Written aside and renamed, so a crash never leaves a torn cover behind.
+  fs::path temp_path = cover_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(tags.cover().data),
+              static_cast<std::streamsize>(tags.cover().size));
+    if (!out) {
+      out.close();
+      fs::remove(temp_path, error);
+      return std::string();
+    }
+  }
+  fs::rename(temp_path, cover_path, error);
+  if (error) {
+    fs::remove(temp_path, error);
+    return std::string();
+  }
+  return cover_path.u8string();
+}
+
+void LibraryScanner::Scan::Flush() {
+  LibraryScanBatch batch;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (tracks_.empty()) return;
+    batch.tracks.swap(tracks_);
+  }
+  owner_->Post(std::move(batch));
+}
+
+LibraryScanBatch LibraryScanner::Scan::Finish(LibraryIndex* index,
+                                              bool cancelled) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  LibraryScanBatch batch;
+  batch.tracks.swap(tracks_);
+  batch.done = true;
+  batch.cancelled = cancelled;
+
+  // A cancelled walk may not have seen everything, so nothing counts as
+  // removed; unreported files stay out of the index and are read next time.
+  if (!cancelled) {
+    const std::unordered_set<std::string> found(found_.begin(), found_.end());
+    for (const auto& [path, stamp] : index->entries()) {
+      if (found.count(path) != 0) continue;
+      for (const std::string& root : options_.roots) {
+        if (IsUnder(path, root)) {
+          batch.removed.push_back(path);
+          break;
+        }
+      }
+    }
+    for (const std::string& path : batch.removed) index->Erase(path);
+  }
+  for (const auto& [path, stamp] : stamped_) index->Set(path, stamp);
+
+  batch.stats.directories = directories_.load();
+  batch.stats.files = files_.load();
+  batch.stats.changed = changed_.load();
+  batch.stats.unchanged = unchanged_.load();
+  batch.stats.removed = batch.removed.size();
+  return batch;
+}
+
+LibraryScanner::LibraryScanner(size_t threads) : threads_(threads) {}
+
+LibraryScanner::~LibraryScanner() {
+  Cancel();
+  Wait();
+}
+
+bool LibraryScanner::Start(LibraryScanOptions options) {
+  if (running_.exchange(true)) return false;
+  // The previous scan has posted its last batch; only the join is left.
+  if (thread_.joinable()) thread_.join();
+  if (!pool_) pool_ = std::make_unique<WorkStealingPool>(threads_);
+  cancelled_.store(false);
+  thread_ = std::thread(&LibraryScanner::Run, this, std::move(options));
+  return true;
+}
+
+void LibraryScanner::Cancel() { cancelled_.store(true); }
+
+void LibraryScanner::Wait() {
+  if (thread_.joinable()) thread_.join();
+}
+
+void LibraryScanner::SetNotify(std::function<void()> notify) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  notify_ = std::move(notify);
+}
+
+std::vector<LibraryScanBatch> LibraryScanner::TakeBatches() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  std::vector<LibraryScanBatch> pending;
+  pending.swap(pending_);
+  return pending;
+}
+
+// static
+void LibraryScanner::ResetIndex(const std::string& index_path) {
+  RandomAccessFile::Remove(index_path);
+}
+
+void LibraryScanner::Run(LibraryScanOptions options) {
+  ScopedThreadRole role(ThreadRole::kBackground);
+  const Clock::time_point start = Clock::now();
+  const uint64_t steals_before = pool_->steals();
+
+  LibraryIndex index;
+  if (!options.index_path.empty()) index.Load(options.index_path);
+
+  LibraryScanBatch last;
+  {
+    Scan scan(this, options, index);
+    for (const std::string& root : options.roots) {
+      pool_->Submit([&scan, root] { scan.WalkDirectory(fs::u8path(root)); });
+    }
+    while (!pool_->WaitFor(options.batch_interval)) scan.Flush();
+    // Nothing reads |index| any more; the tasks are done.
+    last = scan.Finish(&index, cancelled_.load());
+  }
+  const std::string& save_path =
+      options.save_path.empty() ? options.index_path : options.save_path;
+  if (!save_path.empty()) index.Save(save_path);
+
+  last.stats.steals = pool_->steals() - steals_before;
+  last.stats.elapsed_ms =
+      std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  // Before the post, so a scan started in response to it is accepted.
+  running_.store(false);
+  Post(std::move(last));
+}
+
+void LibraryScanner::Post(LibraryScanBatch batch) {
+  std::function<void()> notify;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    pending_.push_back(std::move(batch));
+    notify = notify_;
+  }
+  if (notify) notify();
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,141 @@
+#ifndef NATIVE_LIBRARY_LIBRARY_SCANNER_H_
+#define NATIVE_LIBRARY_LIBRARY_SCANNER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "library/library_index.h"
+#include "thread/work_stealing_pool.h"
+
+namespace cyrene_music {
+
+// One audio file as LocalLibraryService stores it. Strings are UTF-8.
+struct LibraryTrack {
+  std::string path;
+  // AudioTags::Format; kUnknown (0) when the container is not one the
+  // native tag reader handles, in which case only |lyric| is filled in.
+  int32_t format = 0;
+  std::string title;
+  std::string artist;
+  std::string album;
+  // The sidecar "<name>.lrc" (next to the file or in a "Lyrics"
+  // subdirectory), else the embedded lyrics.
+  std::string lyric;
+  // The embedded cover, written to the cover directory; empty if none.
+  std::string cover_path;
+};
+
+struct LibraryScanOptions {
+  // Directories walked recursively. Symbolic links are not followed.
+  std::vector<std::string> roots;
+  // Lowercase, without the dot.
+  std::vector<std::string> extensions;
+  // Size/mtime snapshot; empty scans without one.
+  std::string index_path;
+  // Where the updated snapshot is written; empty writes it back to
+  // |index_path|. A caller that stores the reported tracks itself moves it
+  // over |index_path| only once they are stored, so a crash in between
+  // reports the same files again rather than losing them.
+  std::string save_path;
+  // Where embedded covers go, as "<md5 of the path>.<ext>" like the Dart
+  // side names them; empty skips cover extraction.
+  std::string cover_directory;
+  // Report every file, not only new and changed ones.
+  bool full = false;
+  // A batch is delivered once it holds |batch_size| tracks or
+  // |batch_interval| after the previous one, whichever comes first.
+  size_t batch_size = 64;
+  std::chrono::milliseconds batch_interval{100};
+};
+
+struct LibraryScanStats {
+  uint64_t directories = 0;
+  uint64_t files = 0;      // audio files found
+  uint64_t changed = 0;    // new or modified, opened and reported
+  uint64_t unchanged = 0;  // skipped thanks to the index
+  uint64_t removed = 0;    // in the index under a root, gone from disk
+  uint64_t steals = 0;
+  double elapsed_ms = 0;
+};
+
+struct LibraryScanBatch {
+  std::vector<LibraryTrack> tracks;
+  // Files the index knew under the scanned roots that no longer exist;
+  // sent with the last batch.
+  std::vector<std::string> removed;
+  // Set on the last batch, which carries the totals.
+  bool done = false;
+  bool cancelled = false;
+  LibraryScanStats stats;
+};
+
+// Walks music folders in parallel and reads what LocalLibraryService needs
+// from each audio file: tags, the sidecar or embedded lyrics and the
+// cover, written straight from the tag region to the cover directory.
+//
+// Directories and files are tasks on a WorkStealingPool, so a deep folder
+// keeps every thread busy and a thread that finishes its subtree steals
+// work from the others. Files whose size and mtime match the LibraryIndex
+// are not opened at all, which turns a rescan of an unchanged library into
+// a directory walk.
+//
+// One scan at a time runs on a background thread. Results are queued in
+// batches that the runner takes on its own thread with TakeBatches(); the
+// notify callback (run on a scanning thread) tells it when to look.
+class LibraryScanner {
+ public:
+  // |threads| for the pool, 0 for one per hardware thread.
+  explicit LibraryScanner(size_t threads = 0);
+  // Cancels a running scan and waits for it.
+  ~LibraryScanner();
+
+  LibraryScanner(const LibraryScanner&) = delete;
+  LibraryScanner& operator=(const LibraryScanner&) = delete;
+
+  // False if a scan is still running.
+  bool Start(LibraryScanOptions options);
+  // Stops opening files; the scan still ends with a done batch, and the
+  // index keeps only what was reported.
+  void Cancel();
+  // Blocks until the running scan, if any, has delivered its last batch.
+  void Wait();
+  bool running() const { return running_.load(); }
+
+  // Runs after each batch has been queued; nullptr to stop notifying.
+  // Must not block.
+  void SetNotify(std::function<void()> notify);
+  // Everything queued so far, oldest first.
+  std::vector<LibraryScanBatch> TakeBatches();
+
+  // Deletes the snapshot at |index_path|, so the next scan reports every
+  // file. Not while a scan is running.
+  static void ResetIndex(const std::string& index_path);
+
+ private:
+  class Scan;
+
+  void Run(LibraryScanOptions options);
+  void Post(LibraryScanBatch batch);
+
+  const size_t threads_;
+  std::unique_ptr<WorkStealingPool> pool_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+  std::atomic<bool> cancelled_{false};
+
+  std::mutex pending_mutex_;
+  std::vector<LibraryScanBatch> pending_;
+  std::function<void()> notify_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LIBRARY_LIBRARY_SCANNER_H_
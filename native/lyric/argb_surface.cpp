@@ -0,0 +1,135 @@
+#include "lyric/argb_surface.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+inline uint32_t Div255(uint32_t value) {
+  // Exact for value in [0, 255 * 255].
+  return (value + 1 + (value >> 8)) >> 8;
+}
+
+// Source-over of a premultiplied pixel onto a premultiplied pixel. Works on
+// the two 8-bit lane pairs (AG and RB) at once.
+inline uint32_t BlendPremultiplied(uint32_t dst, uint32_t src) {
+  const uint32_t src_alpha = src >> 24;
+  if (src_alpha == 255) return src;
+  if (src_alpha == 0) return dst;
+  const uint32_t inv = 255 - src_alpha;
+  uint32_t rb = (dst & 0x00FF00FFu) * inv;
+  uint32_t ag = ((dst >> 8) & 0x00FF00FFu) * inv;
+  rb = ((rb + 0x00800080u + ((rb >> 8) & 0x00FF00FFu)) >> 8) & 0x00FF00FFu;
+  ag = (ag + 0x00800080u + ((ag >> 8) & 0x00FF00FFu)) & 0xFF00FF00u;
+  return src + (rb | ag);
+}
+
+}  // namespace
+
+PixelRect PixelRect::Intersect(const PixelRect& other) const {
+  PixelRect result;
+  result.left = std::max(left, other.left);
+  result.top = std::max(top, other.top);
+  result.right = std::min(right, other.right);
+  result.bottom = std::min(bottom, other.bottom);
+  if (result.empty()) return PixelRect();
+  return result;
+}
+
+uint32_t PremultiplyArgb(uint32_t argb) {
+  const uint32_t a = argb >> 24;
+  if (a == 255) return argb;
+  if (a == 0) return 0;
+  const uint32_t r = Div255(((argb >> 16) & 0xFF) * a);
+  const uint32_t g = Div255(((argb >> 8) & 0xFF) * a);
+  const uint32_t b = Div255((argb & 0xFF) * a);
+  return (a << 24) | (r << 16) | (g << 8) | b;
+}
+
+ArgbSurface::ArgbSurface(int width, int height)
+    : width_(std::max(width, 0)),
+      height_(std::max(height, 0)),
+      stride_(std::max(width, 0)) {
+  storage_.assign(static_cast<size_t>(stride_) * height_, 0);
+  pixels_ = storage_.empty() ? nullptr : storage_.data();
+}
+
+ArgbSurface::ArgbSurface(uint32_t* pixels, int width, int height,
+                         int stride_bytes)
+    : pixels_(pixels),
+      width_(width),
+      height_(height),
+      stride_(stride_bytes / 4) {}
+
+ArgbSurface::ArgbSurface(ArgbSurface&& other) noexcept {
+  *this = std::move(other);
+}
+
+ArgbSurface& ArgbSurface::operator=(ArgbSurface&& other) noexcept {
+  if (this != &other) {
+    const bool owned = other.pixels_ != nullptr && !other.storage_.empty() &&
+                       other.pixels_ == other.storage_.data();
+    storage_ = std::move(other.storage_);
+    pixels_ = owned ? storage_.data() : other.pixels_;
+    width_ = other.width_;
+    height_ = other.height_;
+    stride_ = other.stride_;
+    other.storage_.clear();
+    other.pixels_ = nullptr;
+    other.width_ = 0;
+    other.height_ = 0;
+    other.stride_ = 0;
+  }
+  return *this;
+}
+
+void ArgbSurface::Clear(uint32_t premultiplied) {
+  for (int y = 0; y < height_; ++y) {
+    std::fill(row(y), row(y) + width_, premultiplied);
+  }
+}
+
+void ArgbSurface::FillRect(const PixelRect& rect, uint32_t argb) {
+  const PixelRect area = rect.Intersect(bounds());
+  if (area.empty()) return;
+  const uint32_t src = PremultiplyArgb(argb);
+  for (int y = area.top; y < area.bottom; ++y) {
+    uint32_t* dst = row(y);
+    for (int x = area.left; x < area.right; ++x) {
+      dst[x] = BlendPremultiplied(dst[x], src);
+    }
+  }
+}
+
+void ArgbSurface::Composite(const ArgbSurface& src, int dst_x, int dst_y,
+                            const PixelRect& clip) {
+  const PixelRect src_area{dst_x, dst_y, dst_x + src.width(),
+                           dst_y + src.height()};
+  const PixelRect area = src_area.Intersect(clip).Intersect(bounds());
+  if (area.empty()) return;
+  for (int y = area.top; y < area.bottom; ++y) {
+    const uint32_t* src_row = src.row(y - dst_y) - dst_x;
+    uint32_t* dst_row = row(y);
+    for (int x = area.left; x < area.right; ++x) {
+      const uint32_t pixel = src_row[x];
+      // Lyric bitmaps are mostly transparent, so skip those pixels early.
+      if (pixel != 0) dst_row[x] = BlendPremultiplied(dst_row[x], pixel);
+    }
+  }
+}
+
+void ArgbSurface::CopyRotatedClockwise(const ArgbSurface& src) {
+  if (width_ != src.height() || height_ != src.width()) return;
+  const int last_col = width_ - 1;
+  for (int y = 0; y < src.height(); ++y) {
+    const uint32_t* src_row = src.row(y);
+    const int dst_x = last_col - y;
+    for (int x = 0; x < src.width(); ++x) {
+      row(x)[dst_x] = src_row[x];
+    }
+  }
+}
+
+}  // namespace cyrene_music
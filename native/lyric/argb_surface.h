@@ -0,0 +1,85 @@
+#ifndef NATIVE_LYRIC_ARGB_SURFACE_H_
+#define NATIVE_LYRIC_ARGB_SURFACE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cyrene_music {
+
+// Integer rectangle in surface pixels, half-open on the right/bottom.
+struct PixelRect {
+  int left = 0;
+  int top = 0;
+  int right = 0;
+  int bottom = 0;
+
+  int width() const { return right - left; }
+  int height() const { return bottom - top; }
+  bool empty() const { return right <= left || bottom <= top; }
+  PixelRect Intersect(const PixelRect& other) const;
+};
+
+// Converts a straight (non-premultiplied) 0xAARRGGBB colour to premultiplied.
+uint32_t PremultiplyArgb(uint32_t argb);
+
+// 32-bit premultiplied ARGB raster, stored as native-endian uint32 words so
+// the in-memory byte order is B, G, R, A on little-endian machines. That is
+// the layout GDI DIB sections, GDI+ PixelFormat32bppPARGB and cairo
+// CAIRO_FORMAT_ARGB32 all use, so a surface can wrap their memory directly.
+class ArgbSurface {
+ public:
+  ArgbSurface() = default;
+
+  // Allocates an owned, fully transparent surface.
+  ArgbSurface(int width, int height);
+
+  // Wraps caller-owned memory. |stride_bytes| must be a multiple of 4.
+  ArgbSurface(uint32_t* pixels, int width, int height, int stride_bytes);
+
+  ArgbSurface(ArgbSurface&& other) noexcept;
+  ArgbSurface& operator=(ArgbSurface&& other) noexcept;
+  ArgbSurface(const ArgbSurface&) = delete;
+  ArgbSurface& operator=(const ArgbSurface&) = delete;
+
+  int width() const { return width_; }
+  int height() const { return height_; }
+  int stride_pixels() const { return stride_; }
+  int stride_bytes() const { return stride_ * 4; }
+  bool empty() const { return width_ <= 0 || height_ <= 0; }
+  size_t byte_size() const { return static_cast<size_t>(stride_) * height_ * 4; }
+  PixelRect bounds() const { return {0, 0, width_, height_}; }
+
+  uint32_t* row(int y) { return pixels_ + static_cast<size_t>(y) * stride_; }
+  const uint32_t* row(int y) const {
+    return pixels_ + static_cast<size_t>(y) * stride_;
+  }
+  uint32_t* data() { return pixels_; }
+  const uint32_t* data() const { return pixels_; }
+
+  void Clear(uint32_t premultiplied = 0);
+
+  // Source-over fill of |rect| with a straight ARGB colour.
+  void FillRect(const PixelRect& rect, uint32_t argb);
+
+  // Source-over composite of |src| with its top-left at (dst_x, dst_y),
+  // restricted to |clip| (in destination coordinates).
+  void Composite(const ArgbSurface& src, int dst_x, int dst_y,
+                 const PixelRect& clip);
+
+  // Copies |src| into this surface rotated 90 degrees clockwise, i.e. source
+  // pixel (x, y) lands at (src.height() - 1 - y, x). This surface must be
+  // src.height() x src.width().
+  void CopyRotatedClockwise(const ArgbSurface& src);
+
+ private:
+  std::vector<uint32_t> storage_;
+  uint32_t* pixels_ = nullptr;
+  int width_ = 0;
+  int height_ = 0;
+  int stride_ = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_ARGB_SURFACE_H_
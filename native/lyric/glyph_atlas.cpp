@@ -0,0 +1,166 @@
+#include "lyric/glyph_atlas.h"
+
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "lyric/lyric_layout.h"
+
+namespace cyrene_music {
+
+namespace {
+
+size_t HashCombine(size_t seed, uint32_t value) {
+  return seed ^ (value + 0x9E3779B9u + (seed << 6) + (seed >> 2));
+}
+
+uint32_t FloatBits(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+// Band the source draws a glyph into. Taller than any face's line height at
+// this size, so vertical centring inside the band matches centring inside
+// the caller's row up to a fixed offset.
+int GlyphBandHeight(const TextStyle& style) {
+  return static_cast<int>(std::ceil(style.font_size * 1.5f));
+}
+
+int GlyphMargin(const TextStyle& style) {
+  int margin = static_cast<int>(std::ceil(style.stroke_width)) + 2;
+  // A rotated glyph spans its line height across, which is wider than its
+  // advance.
+  if (style.upright_cjk) {
+    margin += static_cast<int>(std::ceil(style.font_size / 4.0f));
+  }
+  return margin;
+}
+
+}  // namespace
+
+size_t GlyphKeyHash::operator()(const GlyphKey& key) const {
+  size_t seed = key.codepoint;
+  seed = HashCombine(seed, FloatBits(key.font_size));
+  seed = HashCombine(seed, FloatBits(key.stroke_width));
+  seed = HashCombine(seed, key.fill_color);
+  seed = HashCombine(seed, key.stroke_color);
+  seed = HashCombine(seed, (key.bold ? 1u : 0u) | (key.rotated ? 2u : 0u));
+  return seed;
+}
+
+GlyphAtlas::GlyphAtlas(TextRasterizer* source, size_t budget_bytes)
+    : source_(source), budget_bytes_(budget_bytes) {}
+
+const GlyphBitmap& GlyphAtlas::Get(char32_t codepoint, const TextStyle& style) {
+  GlyphKey key;
+  key.codepoint = codepoint;
+  key.font_size = style.font_size;
+  key.stroke_width = style.stroke_width;
+  key.fill_color = style.fill_color;
+  key.stroke_color = style.stroke_color;
+  key.bold = style.bold;
+  key.rotated = style.upright_cjk;
+
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    ++hits_;
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return it->second->glyph;
+  }
+  ++misses_;
+
+  entries_.push_front({key, GlyphBitmap()});
+  Render(codepoint, style, &entries_.front().glyph);
+  index_[key] = entries_.begin();
+  bytes_ += entries_.front().glyph.surface.byte_size();
+  EvictToBudget();
+  return entries_.front().glyph;
+}
+
+void GlyphAtlas::Render(char32_t codepoint, const TextStyle& style,
+                        GlyphBitmap* glyph) {
+  scratch_.clear();
+  AppendUtf8(codepoint, &scratch_);
+
+  glyph->advance = source_->MeasureText(scratch_, style);
+  glyph->margin = GlyphMargin(style);
+  glyph->band_height = GlyphBandHeight(style);
+  glyph->surface =
+      ArgbSurface(static_cast<int>(std::ceil(glyph->advance)) + glyph->margin * 2,
+                  glyph->band_height + glyph->margin * 2);
+  source_->DrawText(&glyph->surface, scratch_, style,
+                    static_cast<float>(glyph->margin),
+                    static_cast<float>(glyph->margin),
+                    static_cast<float>(glyph->band_height));
+}
+
+void GlyphAtlas::Clear() {
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+void GlyphAtlas::SetBudget(size_t budget_bytes) {
+  budget_bytes_ = budget_bytes;
+  EvictToBudget();
+}
+
+void GlyphAtlas::EvictToBudget() {
+  // Always keep the most recent entry; Get() is about to return it.
+  while (bytes_ > budget_bytes_ && entries_.size() > 1) {
+    const Entry& victim = entries_.back();
+    bytes_ -= victim.glyph.surface.byte_size();
+    index_.erase(victim.key);
+    entries_.pop_back();
+  }
+}
+
+GlyphAtlasRasterizer::GlyphAtlasRasterizer(TextRasterizer* fallback,
+                                           size_t atlas_budget_bytes)
+    : fallback_(fallback), atlas_(fallback, atlas_budget_bytes) {}
+
+float GlyphAtlasRasterizer::MeasureText(const std::string& utf8,
+                                        const TextStyle& style) {
+  // SegmentForVertical splits out single CJK codepoints in either mode; the
+  // |rotate| flag is only honoured through style.upright_cjk.
+  float width = 0.0f;
+  for (const TextRun& run : SegmentForVertical(utf8)) {
+    if (run.rotate) {
+      size_t pos = run.begin;
+      width += atlas_.Get(DecodeUtf8(utf8, &pos), style).advance;
+    } else {
+      width += fallback_->MeasureText(utf8.substr(run.begin, run.length), style);
+    }
+  }
+  return width;
+}
+
+void GlyphAtlasRasterizer::DrawText(ArgbSurface* target,
+                                    const std::string& utf8,
+                                    const TextStyle& style, float x, float y,
+                                    float height) {
+  if (utf8.empty() || target->empty()) return;
+
+  const PixelRect clip = target->bounds();
+  for (const TextRun& run : SegmentForVertical(utf8)) {
+    if (!run.rotate) {
+      const std::string text = utf8.substr(run.begin, run.length);
+      fallback_->DrawText(target, text, style, x, y, height);
+      x += fallback_->MeasureText(text, style);
+      continue;
+    }
+    size_t pos = run.begin;
+    const GlyphBitmap& glyph = atlas_.Get(DecodeUtf8(utf8, &pos), style);
+    // The glyph was centred in its own band; shift that band so it is
+    // centred in [y, y + height) instead.
+    const int cell_x = static_cast<int>(std::lround(x)) - glyph.margin;
+    const int cell_y =
+        static_cast<int>(std::lround(y + (height - glyph.band_height) / 2.0f)) -
+        glyph.margin;
+    target->Composite(glyph.surface, cell_x, cell_y, clip);
+    x += glyph.advance;
+  }
+}
+
+}  // namespace cyrene_music
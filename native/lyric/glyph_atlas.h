@@ -0,0 +1,115 @@
+#ifndef NATIVE_LYRIC_GLYPH_ATLAS_H_
+#define NATIVE_LYRIC_GLYPH_ATLAS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+
+#include "lyric/argb_surface.h"
+#include "lyric/text_rasterizer.h"
+
+namespace cyrene_music {
+
+// Identifies one rendered glyph: the codepoint plus everything in the style
+// that changes its pixels. |rotated| is the vertical-mode variant.
+struct GlyphKey {
+  char32_t codepoint = 0;
+  float font_size = 0.0f;
+  float stroke_width = 0.0f;
+  uint32_t fill_color = 0;
+  uint32_t stroke_color = 0;
+  bool bold = false;
+  bool rotated = false;
+
+  bool operator==(const GlyphKey& other) const {
+    return codepoint == other.codepoint && font_size == other.font_size &&
+           stroke_width == other.stroke_width &&
+           fill_color == other.fill_color &&
+           stroke_color == other.stroke_color && bold == other.bold &&
+           rotated == other.rotated;
+  }
+};
+
+struct GlyphKeyHash {
+  size_t operator()(const GlyphKey& key) const;
+};
+
+// A stroked and filled glyph drawn once into its own cell. The source
+// rasterizer drew it at (margin, margin) in a band |band_height| pixels
+// tall, so placing the cell only needs an offset, never a re-layout.
+struct GlyphBitmap {
+  ArgbSurface surface;
+  float advance = 0.0f;
+  int margin = 0;
+  int band_height = 0;
+};
+
+// LRU cache of glyph cells bounded by total pixel bytes. Lyrics in Chinese
+// or Japanese keep reusing a few hundred characters over a song, so new
+// lines are mostly composed from glyphs that are already here.
+class GlyphAtlas {
+ public:
+  static constexpr size_t kDefaultBudgetBytes = 4 * 1024 * 1024;
+
+  explicit GlyphAtlas(TextRasterizer* source,
+                      size_t budget_bytes = kDefaultBudgetBytes);
+
+  // Returns the glyph for |codepoint| in |style| (pre-rotated when
+  // style.upright_cjk is set), drawing it through the source rasterizer on
+  // a miss. The reference stays valid until the next call that may insert.
+  const GlyphBitmap& Get(char32_t codepoint, const TextStyle& style);
+
+  void Clear();
+  void SetBudget(size_t budget_bytes);
+
+  size_t bytes() const { return bytes_; }
+  size_t size() const { return entries_.size(); }
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+
+ private:
+  struct Entry {
+    GlyphKey key;
+    GlyphBitmap glyph;
+  };
+
+  void Render(char32_t codepoint, const TextStyle& style, GlyphBitmap* glyph);
+  void EvictToBudget();
+
+  TextRasterizer* source_;
+  size_t budget_bytes_;
+  size_t bytes_ = 0;
+  uint64_t hits_ = 0;
+  uint64_t misses_ = 0;
+  std::list<Entry> entries_;  // front = most recently used
+  std::unordered_map<GlyphKey, std::list<Entry>::iterator, GlyphKeyHash> index_;
+  std::string scratch_;  // single-codepoint UTF-8 handed to the source
+};
+
+// TextRasterizer that composes CJK codepoints from a GlyphAtlas and hands
+// every other run to |fallback| as one continuous string, so Latin text
+// keeps its kerning. Measuring and drawing walk the same runs, so the width
+// the renderer sizes a line bitmap by is exactly the width drawn.
+class GlyphAtlasRasterizer : public TextRasterizer {
+ public:
+  explicit GlyphAtlasRasterizer(
+      TextRasterizer* fallback,
+      size_t atlas_budget_bytes = GlyphAtlas::kDefaultBudgetBytes);
+
+  float MeasureText(const std::string& utf8, const TextStyle& style) override;
+  void DrawText(ArgbSurface* target, const std::string& utf8,
+                const TextStyle& style, float x, float y,
+                float height) override;
+
+  GlyphAtlas& atlas() { return atlas_; }
+
+ private:
+  TextRasterizer* fallback_;
+  GlyphAtlas atlas_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_GLYPH_ATLAS_H_
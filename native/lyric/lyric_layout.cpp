@@ -0,0 +1,292 @@
+#include "lyric/lyric_layout.h"
+
+namespace cyrene_music {
+
+namespace lyric_layout {
+
+namespace {
+
+// Control panel geometry, matching the original GDI+ panel.
+constexpr int kPanelHeaderHeight = 70;  // song title + artist
+constexpr int kPanelButtonSize = 36;
+constexpr int kPanelSmallButtonSize = 28;
+constexpr int kPanelButtonSpacing = 50;
+constexpr int kPanelRow2Spacing = 55;
+constexpr int kPanelCloseSize = 24;
+constexpr float kPanelTranslationScale = 0.7f;
+
+PixelRect MakeRect(int x, int y, int width, int height) {
+  return {x, y, x + width, y + height};
+}
+
+}  // namespace
+
+RowMetrics ComputeRowMetrics(int font_size, int stroke_width,
+                             bool has_translation) {
+  RowMetrics metrics;
+  metrics.lyric_height = font_size + 10;
+  if (has_translation) {
+    metrics.translation_font_size = font_size * kTranslationScale;
+    metrics.translation_height =
+        static_cast<int>(metrics.translation_font_size) + 5;
+    metrics.translation_stroke_width = stroke_width * kTranslationStrokeScale;
+  }
+  return metrics;
+}
+
+int NormalWindowHeight(int font_size, bool has_translation) {
+  if (!has_translation) return kWindowHeight;
+  return kWindowHeight + static_cast<int>(font_size * kTranslationScale) + 10;
+}
+
+int ControlPanelHeight(int font_size, bool has_translation) {
+  // Header area (song title + artist), lyric area, optional translation,
+  // then spacing + button row 1 + gap + button row 2 + bottom padding.
+  int height = kPanelHeaderHeight + font_size + 10;
+  if (has_translation) {
+    height += static_cast<int>(font_size * kPanelTranslationScale) + 5;
+  }
+  height += 15 + kPanelButtonSize + 10 + kPanelSmallButtonSize + 15;
+  return height;
+}
+
+WindowSize PhysicalWindowSize(int logical_width, int logical_height,
+                              bool vertical) {
+  if (vertical) return {logical_height, logical_width};
+  return {logical_width, logical_height};
+}
+
+uint32_t TranslationTextColor(uint32_t text_color) {
+  return (static_cast<uint32_t>(kTranslationAlpha) << 24) |
+         (text_color & 0x00FFFFFFu);
+}
+
+float ComputeScrollSpeed(float max_scroll, uint32_t duration_ms) {
+  if (max_scroll <= 0.0f) return 0.0f;
+  // Use 90% of the duration so the scroll completes before the next line.
+  const float available_time_ms = duration_ms * 0.9f - kScrollPauseMs;
+  if (available_time_ms > 100) {  // At least 100ms for scrolling
+    return max_scroll / (available_time_ms / 1000.0f);
+  }
+  return max_scroll * 2.0f;  // Fast scroll if very short duration
+}
+
+void ScrollTrack::Reset(uint64_t now_ms) {
+  offset_ = 0.0f;
+  speed_ = 0.0f;
+  needs_scroll_ = false;
+  paused_ = true;
+  pause_start_ms_ = now_ms;
+}
+
+void ScrollTrack::Update(float text_width, int view_width,
+                         uint32_t duration_ms, uint64_t now_ms,
+                         uint64_t elapsed_ms) {
+  needs_scroll_ = text_width > (view_width - kScrollPadding);
+  if (!needs_scroll_) return;
+
+  const float max_scroll = text_width - view_width + kScrollPadding;
+  if (speed_ <= 0.0f) {
+    speed_ = ComputeScrollSpeed(max_scroll, duration_ms);
+  }
+
+  if (paused_) {
+    if (now_ms - pause_start_ms_ >= static_cast<uint64_t>(kScrollPauseMs)) {
+      paused_ = false;  // End pause, start scrolling
+    }
+  } else if (offset_ < max_scroll) {
+    // Scroll from left to right, only once, and stop at the end.
+    offset_ += speed_ * elapsed_ms / 1000.0f;
+    if (offset_ > max_scroll) offset_ = max_scroll;
+  }
+}
+
+bool ScrollTrack::IsAnimating(float text_width, int view_width) const {
+  if (!needs_scroll_) return false;
+  return paused_ || offset_ < text_width - view_width + kScrollPadding;
+}
+
+float ScrollTrack::LineX(float text_width, int view_width) const {
+  if (needs_scroll_) return kScrollPadding / 2 - offset_;
+  return (view_width - text_width) / 2;
+}
+
+ControlPanelLayout ComputeControlPanelLayout(int width, int font_size,
+                                             bool has_lyric,
+                                             bool has_translation,
+                                             bool has_cover) {
+  ControlPanelLayout layout;
+
+  // Close button in the top-right corner.
+  layout.close = MakeRect(width - kPanelCloseSize - 10, 10, kPanelCloseSize,
+                          kPanelCloseSize);
+  // Cover art, vertically centred in the header, pushes the song info right.
+  int info_x = 20;
+  if (has_cover) {
+    layout.cover = MakeRect(20, (kPanelHeaderHeight - kPanelCoverSize) / 2,
+                            kPanelCoverSize, kPanelCoverSize);
+    info_x = layout.cover.right + 10;
+  }
+  layout.title = MakeRect(info_x, 15, width - 60 - info_x, 25);
+  layout.artist = MakeRect(info_x, 45, width - 60 - info_x, 20);
+
+  int y = kPanelHeaderHeight;
+  if (has_lyric) {
+    const int lyric_area_height = font_size + 10;
+    layout.lyric = MakeRect(20, y, width - 40, lyric_area_height);
+    y += lyric_area_height;
+  }
+  if (has_translation) {
+    const int trans_height =
+        static_cast<int>(font_size * kPanelTranslationScale) + 5;
+    layout.translation = MakeRect(20, y, width - 40, trans_height);
+    y += trans_height;
+  }
+
+  // Playback row.
+  const int button_y = y + 15;
+  const int center_x = width / 2;
+  const int half = kPanelButtonSize / 2;
+  layout.previous = MakeRect(center_x - kPanelButtonSpacing - half, button_y,
+                             kPanelButtonSize, kPanelButtonSize);
+  layout.play_pause =
+      MakeRect(center_x - half, button_y, kPanelButtonSize, kPanelButtonSize);
+  layout.next = MakeRect(center_x + kPanelButtonSpacing - half, button_y,
+                         kPanelButtonSize, kPanelButtonSize);
+
+  // Settings row: A-, A+, colour, translation, vertical.
+  const int row2_y = button_y + kPanelButtonSize + 10;
+  const int small = kPanelSmallButtonSize;
+  const int small_half = small / 2;
+  auto row2_x = [&](float slot) {
+    return center_x + static_cast<int>(kPanelRow2Spacing * slot) - small_half;
+  };
+  layout.font_size_down = MakeRect(row2_x(-1.5f), row2_y, small, small);
+  layout.font_size_up = MakeRect(row2_x(-0.5f), row2_y, small, small);
+  layout.color_picker = MakeRect(row2_x(0.5f), row2_y, small, small);
+  layout.translation_toggle = MakeRect(row2_x(1.5f), row2_y, small, small);
+  layout.vertical_toggle = MakeRect(row2_x(2.5f), row2_y, small, small);
+  return layout;
+}
+
+std::string HitTestControlPanel(const ControlPanelLayout& layout, int x, int y) {
+  // Edges are inclusive, as the original Win32 hit test was.
+  auto hit = [x, y](const PixelRect& rect) {
+    return !rect.empty() && x >= rect.left && x <= rect.right &&
+           y >= rect.top && y <= rect.bottom;
+  };
+  if (hit(layout.previous)) return "previous";
+  if (hit(layout.play_pause)) return "play_pause";
+  if (hit(layout.next)) return "next";
+  if (hit(layout.font_size_up)) return "font_size_up";
+  if (hit(layout.font_size_down)) return "font_size_down";
+  if (hit(layout.color_picker)) return "color_picker";
+  if (hit(layout.translation_toggle)) return "toggle_translation";
+  if (hit(layout.vertical_toggle)) return "toggle_vertical";
+  if (hit(layout.close)) return "close";
+  return std::string();
+}
+
+}  // namespace lyric_layout
+
+bool IsCJKCodepoint(char32_t cp) {
+  // CJK Unified Ideographs
+  if (cp >= 0x4E00 && cp <= 0x9FFF) return true;
+  // CJK Unified Ideographs Extension A
+  if (cp >= 0x3400 && cp <= 0x4DBF) return true;
+  // Hiragana
+  if (cp >= 0x3040 && cp <= 0x309F) return true;
+  // Katakana
+  if (cp >= 0x30A0 && cp <= 0x30FF) return true;
+  // Full-width characters
+  if (cp >= 0xFF00 && cp <= 0xFFEF) return true;
+  // CJK Symbols and Punctuation
+  if (cp >= 0x3000 && cp <= 0x303F) return true;
+  // Hangul (Korean)
+  if (cp >= 0xAC00 && cp <= 0xD7AF) return true;
+  // CJK Compatibility Ideographs
+  if (cp >= 0xF900 && cp <= 0xFAFF) return true;
+  // CJK Unified Ideographs Extension B and beyond (outside the BMP)
+  if (cp >= 0x20000 && cp <= 0x3134F) return true;
+  return false;
+}
+
+char32_t DecodeUtf8(const std::string& text, size_t* pos) {
+  const size_t size = text.size();
+  const unsigned char lead = static_cast<unsigned char>(text[*pos]);
+  int extra = 0;
+  char32_t cp = 0;
+  if (lead < 0x80) {
+    ++*pos;
+    return lead;
+  } else if ((lead & 0xE0) == 0xC0) {
+    extra = 1;
+    cp = lead & 0x1F;
+  } else if ((lead & 0xF0) == 0xE0) {
+    extra = 2;
+    cp = lead & 0x0F;
+  } else if ((lead & 0xF8) == 0xF0) {
+    extra = 3;
+    cp = lead & 0x07;
+  } else {
+    ++*pos;
+    return 0xFFFD;
+  }
+  if (*pos + extra >= size) {
+    ++*pos;
+    return 0xFFFD;
+  }
+  for (int i = 1; i <= extra; ++i) {
+    const unsigned char next = static_cast<unsigned char>(text[*pos + i]);
+    if ((next & 0xC0) != 0x80) {
+      ++*pos;
+      return 0xFFFD;
+    }
+    cp = (cp << 6) | (next & 0x3F);
+  }
+  *pos += extra + 1;
+  return cp;
+}
+
+void AppendUtf8(char32_t cp, std::string* out) {
+  if (cp < 0x80) {
+    out->push_back(static_cast<char>(cp));
+  } else if (cp < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (cp >> 6)));
+    out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else if (cp < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (cp >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (cp >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+  }
+}
+
+std::vector<TextRun> SegmentForVertical(const std::string& utf8) {
+  std::vector<TextRun> runs;
+  size_t pos = 0;
+  while (pos < utf8.size()) {
+    const size_t begin = pos;
+    const char32_t cp = DecodeUtf8(utf8, &pos);
+    if (IsCJKCodepoint(cp)) {
+      runs.push_back({begin, pos - begin, true});
+      continue;
+    }
+    // Collect consecutive non-CJK characters into one run.
+    size_t end = pos;
+    while (end < utf8.size()) {
+      size_t next = end;
+      if (IsCJKCodepoint(DecodeUtf8(utf8, &next))) break;
+      end = next;
+    }
+    runs.push_back({begin, end - begin, false});
+    pos = end;
+  }
+  return runs;
+}
+
+}  // namespace cyrene_music
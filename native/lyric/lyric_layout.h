@@ -0,0 +1,145 @@
+#ifndef NATIVE_LYRIC_LYRIC_LAYOUT_H_
+#define NATIVE_LYRIC_LYRIC_LAYOUT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "lyric/argb_surface.h"
+
+namespace cyrene_music {
+
+// Platform-neutral geometry and animation rules for the desktop lyric
+// overlay. Everything here works in "logical horizontal" coordinates; the
+// vertical mode is the same layout rotated 90 degrees clockwise.
+namespace lyric_layout {
+
+constexpr int kWindowWidth = 800;
+constexpr int kWindowHeight = 100;
+constexpr int kScrollPauseMs = 500;     // brief pause at start before scrolling
+constexpr float kScrollPadding = 40.0f; // horizontal slack before scrolling
+constexpr float kTranslationScale = 0.6f;
+constexpr float kTranslationStrokeScale = 0.7f;
+constexpr uint8_t kTranslationAlpha = 200;
+constexpr int kPanelCoverSize = 50;  // album cover in the control panel
+
+// Vertical extents of the lyric and translation rows.
+struct RowMetrics {
+  int lyric_height = 0;
+  int translation_height = 0;  // 0 when no translation is shown
+  float translation_font_size = 0.0f;
+  float translation_stroke_width = 0.0f;
+
+  int total_height() const { return lyric_height + translation_height; }
+};
+
+RowMetrics ComputeRowMetrics(int font_size, int stroke_width,
+                             bool has_translation);
+
+// Logical height of the lyric-only window.
+int NormalWindowHeight(int font_size, bool has_translation);
+
+// Logical height of the hover control panel, which grows with the font.
+int ControlPanelHeight(int font_size, bool has_translation);
+
+struct WindowSize {
+  int width = 0;
+  int height = 0;
+};
+
+// Physical window size for a logical layout, swapping axes in vertical mode.
+WindowSize PhysicalWindowSize(int logical_width, int logical_height,
+                              bool vertical);
+
+// Translation colour: the text colour with a fixed, slightly lower alpha.
+uint32_t TranslationTextColor(uint32_t text_color);
+
+// Scroll speed in px/s so |max_scroll| pixels finish within 90% of the line
+// duration after the initial pause.
+float ComputeScrollSpeed(float max_scroll, uint32_t duration_ms);
+
+// One-shot left-to-right marquee for a line that is wider than its row.
+class ScrollTrack {
+ public:
+  // Starts a new line at |now_ms|; the scroll holds for kScrollPauseMs.
+  void Reset(uint64_t now_ms);
+
+  // Advances the animation. |text_width| is the measured line width and
+  // |view_width| the row width; |elapsed_ms| is the time since the previous
+  // frame.
+  void Update(float text_width, int view_width, uint32_t duration_ms,
+              uint64_t now_ms, uint64_t elapsed_ms);
+
+  bool needs_scroll() const { return needs_scroll_; }
+  float offset() const { return offset_; }
+  float speed() const { return speed_; }
+
+  // True while the pause or the scroll itself is still running.
+  bool IsAnimating(float text_width, int view_width) const;
+
+  // X position of the line's left edge inside a row of |view_width|.
+  float LineX(float text_width, int view_width) const;
+
+ private:
+  float offset_ = 0.0f;
+  float speed_ = 0.0f;
+  bool needs_scroll_ = false;
+  bool paused_ = false;
+  uint64_t pause_start_ms_ = 0;
+};
+
+// Button hit areas and content rows of the hover control panel.
+struct ControlPanelLayout {
+  PixelRect close;
+  PixelRect previous;
+  PixelRect play_pause;
+  PixelRect next;
+  PixelRect font_size_down;
+  PixelRect font_size_up;
+  PixelRect color_picker;
+  PixelRect translation_toggle;
+  PixelRect vertical_toggle;
+  PixelRect cover;  // empty when there is no cover art
+  PixelRect title;
+  PixelRect artist;
+  PixelRect lyric;        // empty when there is no lyric
+  PixelRect translation;  // empty when no translation is shown
+};
+
+// With |has_cover| the title and artist make room for the cover on the left.
+ControlPanelLayout ComputeControlPanelLayout(int width, int font_size,
+                                             bool has_lyric,
+                                             bool has_translation,
+                                             bool has_cover = false);
+
+// Returns the hit-test action for |x|, |y| ("previous", "play_pause", ...),
+// or an empty string when no button is under the point.
+std::string HitTestControlPanel(const ControlPanelLayout& layout, int x, int y);
+
+}  // namespace lyric_layout
+
+// Whether |cp| is a CJK ideograph, kana, hangul or full-width form; those
+// are drawn upright (pre-rotated) in vertical mode.
+bool IsCJKCodepoint(char32_t cp);
+
+// Decodes the UTF-8 sequence at |*pos| and advances |*pos|. Malformed input
+// yields U+FFFD and skips one byte.
+char32_t DecodeUtf8(const std::string& text, size_t* pos);
+
+// Appends |cp| to |out| as UTF-8.
+void AppendUtf8(char32_t cp, std::string* out);
+
+// A run of text for vertical mode: either a single CJK codepoint that is
+// rotated upright, or a span of other characters drawn as one string.
+struct TextRun {
+  size_t begin = 0;   // byte offset into the UTF-8 source
+  size_t length = 0;  // byte length
+  bool rotate = false;
+};
+
+std::vector<TextRun> SegmentForVertical(const std::string& utf8);
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_LYRIC_LAYOUT_H_
@@ -0,0 +1,294 @@
+#include "lyric/lyric_renderer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+size_t LineBytes(const LineBitmap& line) { return line.surface.byte_size(); }
+
+// Spectrum strip: bars rise instantly and fall at this rate (full height per
+// second), drawn in the text colour at this alpha so they stay behind it.
+constexpr float kSpectrumFallPerMs = 1.0f / 1000.0f;
+constexpr uint32_t kSpectrumAlpha = 0x50;
+constexpr int kSpectrumBarGap = 4;
+
+// Longest step one frame may advance the marquee and the spectrum decay: a
+// little over the overlay's 30 ms scroll cadence, so timer jitter is kept
+// but a stall (hidden window, suspended timer) does not jump the line.
+constexpr uint64_t kMaxFrameStepMs = 50;
+
+template <typename T>
+void AppendBytes(const T& value, std::string* out) {
+  char buffer[sizeof(T)];
+  std::memcpy(buffer, &value, sizeof(T));
+  out->append(buffer, sizeof(T));
+}
+
+}  // namespace
+
+LineBitmapCache::LineBitmapCache(size_t budget_bytes)
+    : budget_bytes_(budget_bytes) {}
+
+// static
+std::string LineBitmapCache::MakeKey(const std::string& text,
+                                     const TextStyle& style, int row_height) {
+  std::string key;
+  key.reserve(text.size() + 24);
+  AppendBytes(style.font_size, &key);
+  AppendBytes(style.stroke_width, &key);
+  AppendBytes(style.fill_color, &key);
+  AppendBytes(style.stroke_color, &key);
+  AppendBytes(row_height, &key);
+  key.push_back(static_cast<char>((style.bold ? 1 : 0) |
+                                  (style.upright_cjk ? 2 : 0)));
+  key.append(text);
+  return key;
+}
+
+std::shared_ptr<const LineBitmap> LineBitmapCache::Find(const std::string& key) {
+  auto it = index_.find(key);
+  if (it == index_.end()) return nullptr;
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->line;
+}
+
+void LineBitmapCache::Insert(const std::string& key,
+                             std::shared_ptr<const LineBitmap> line) {
+  auto existing = index_.find(key);
+  if (existing != index_.end()) {
+    bytes_ -= LineBytes(*existing->second->line);
+    entries_.erase(existing->second);
+    index_.erase(existing);
+  }
+  bytes_ += LineBytes(*line);
+  entries_.push_front({key, std::move(line)});
+  index_[key] = entries_.begin();
+  EvictToBudget();
+}
+
+void LineBitmapCache::Clear() {
+  entries_.clear();
+  index_.clear();
+  bytes_ = 0;
+}
+
+void LineBitmapCache::SetBudget(size_t budget_bytes) {
+  budget_bytes_ = budget_bytes;
+  EvictToBudget();
+}
+
+void LineBitmapCache::EvictToBudget() {
+  // Always keep the most recent entry, even if it alone exceeds the budget;
+  // callers hold a shared_ptr to it for the frame being drawn anyway.
+  while (bytes_ > budget_bytes_ && entries_.size() > 1) {
+    const Entry& victim = entries_.back();
+    bytes_ -= LineBytes(*victim.line);
+    index_.erase(victim.key);
+    entries_.pop_back();
+  }
+}
+
+LyricRenderer::LyricRenderer(TextRasterizer* rasterizer,
+                             size_t cache_budget_bytes)
+    : rasterizer_(rasterizer), cache_(cache_budget_bytes) {}
+
+bool LyricRenderer::SetLyric(std::string text, uint64_t now_ms) {
+  if (text == lyric_) return false;
+  lyric_ = std::move(text);
+  lyric_scroll_.Reset(now_ms);
+  return true;
+}
+
+bool LyricRenderer::SetTranslation(std::string text, uint64_t now_ms) {
+  if (text == translation_) return false;
+  translation_ = std::move(text);
+  translation_scroll_.Reset(now_ms);
+  return true;
+}
+
+void LyricRenderer::SetStyle(const LyricStyle& style) { style_ = style; }
+
+void LyricRenderer::SetLineDuration(uint32_t duration_ms) {
+  line_duration_ms_ = duration_ms > 0 ? duration_ms : 3000;
+}
+
+void LyricRenderer::SetSpectrumSource(const SpectrumSlot* source) {
+  spectrum_source_ = source;
+  spectrum_levels_.fill(0.0f);
+}
+
+lyric_layout::WindowSize LyricRenderer::FrameSize() const {
+  return lyric_layout::PhysicalWindowSize(
+      lyric_layout::kWindowWidth,
+      lyric_layout::NormalWindowHeight(style_.font_size, has_translation()),
+      vertical_);
+}
+
+TextStyle LyricRenderer::LyricTextStyle() const {
+  TextStyle text_style;
+  text_style.font_size = static_cast<float>(style_.font_size);
+  text_style.stroke_width = static_cast<float>(style_.stroke_width);
+  text_style.fill_color = style_.text_color;
+  text_style.stroke_color = style_.stroke_color;
+  text_style.bold = true;
+  text_style.upright_cjk = vertical_;
+  return text_style;
+}
+
+TextStyle LyricRenderer::TranslationTextStyle(
+    const lyric_layout::RowMetrics& metrics) const {
+  TextStyle text_style;
+  text_style.font_size = metrics.translation_font_size;
+  text_style.stroke_width = metrics.translation_stroke_width;
+  text_style.fill_color = lyric_layout::TranslationTextColor(style_.text_color);
+  text_style.stroke_color = style_.stroke_color;
+  text_style.bold = false;
+  text_style.upright_cjk = vertical_;
+  return text_style;
+}
+
+std::shared_ptr<const LineBitmap> LyricRenderer::GetLine(
+    const std::string& text, const TextStyle& style, int row_height,
+    RenderStats::ScopedPhase* phase, RenderStats* stats) {
+  const std::string key = LineBitmapCache::MakeKey(text, style, row_height);
+  if (auto cached = cache_.Find(key)) {
+    stats->RecordCacheHit();
+    return cached;
+  }
+  stats->RecordCacheMiss();
+
+  auto line = std::make_shared<LineBitmap>();
+  line->text_width = rasterizer_->MeasureText(text, style);
+  line->margin = static_cast<int>(std::ceil(style.stroke_width)) + 2;
+
+  phase->Switch(RenderStats::Phase::kRasterise);
+  const int width =
+      static_cast<int>(std::ceil(line->text_width)) + line->margin * 2;
+  line->surface = ArgbSurface(width, row_height);
+  rasterizer_->DrawText(&line->surface, text, style,
+                        static_cast<float>(line->margin), 0.0f,
+                        static_cast<float>(row_height));
+  phase->Switch(RenderStats::Phase::kLayout);
+
+  cache_.Insert(key, line);
+  return line;
+}
+
+bool LyricRenderer::DrawSpectrum(ArgbSurface* frame, uint64_t elapsed_ms) {
+  // A failed read keeps the previous frame; the next tick will catch up.
+  spectrum_source_->Read(&spectrum_frame_);
+  const bool live = spectrum_source_->publishing();
+
+  const float fall = kSpectrumFallPerMs * static_cast<float>(elapsed_ms);
+  bool falling = false;
+  for (int i = 0; i < kSpectrumBands; ++i) {
+    const float target = live ? std::clamp(spectrum_frame_.bands[i], 0.0f, 1.0f)
+                              : 0.0f;
+    spectrum_levels_[i] = std::max(target, spectrum_levels_[i] - fall);
+    falling |= spectrum_levels_[i] > 0.0f;
+  }
+
+  const int width = frame->width();
+  const int height = frame->height();
+  const uint32_t color = (kSpectrumAlpha << 24) | (style_.text_color & 0x00FFFFFF);
+  for (int i = 0; i < kSpectrumBands; ++i) {
+    const int bar_height =
+        static_cast<int>(std::lround(spectrum_levels_[i] * height));
+    if (bar_height <= 0) continue;
+    const int left = width * i / kSpectrumBands;
+    const int right = width * (i + 1) / kSpectrumBands - kSpectrumBarGap;
+    frame->FillRect({left, height - bar_height, right, height}, color);
+  }
+  return live || falling;
+}
+
+bool LyricRenderer::RenderFrame(uint64_t now_ms, ArgbSurface* target,
+                                RenderStats* stats) {
+  RenderStats::ScopedPhase phase(stats, RenderStats::Phase::kLayout);
+
+  // Layout happens in logical horizontal space; vertical frames are composed
+  // there and rotated clockwise into the target at the end.
+  const int draw_width = vertical_ ? target->height() : target->width();
+  const int draw_height = vertical_ ? target->width() : target->height();
+  PlaybackSnapshot playback;
+  const bool paused = playback_clock_ != nullptr &&
+                      playback_clock_->Read(&playback) &&
+                      playback.state == PlaybackState::kPaused;
+  // No frames are drawn while paused, so the first one after resuming
+  // starts from zero instead of counting the whole pause.
+  const bool resumed = was_paused_ && !paused;
+  was_paused_ = paused;
+  const uint64_t elapsed_ms =
+      last_frame_ms_ == 0 || now_ms < last_frame_ms_ || resumed
+          ? 0
+          : std::min(now_ms - last_frame_ms_, kMaxFrameStepMs);
+  last_frame_ms_ = now_ms;
+  const uint64_t scroll_elapsed_ms = paused ? 0 : elapsed_ms;
+
+  const bool with_translation = has_translation();
+  const lyric_layout::RowMetrics metrics = lyric_layout::ComputeRowMetrics(
+      style_.font_size, style_.stroke_width, with_translation);
+  const int start_y = (draw_height - metrics.total_height()) / 2;
+
+  std::shared_ptr<const LineBitmap> lyric_line;
+  std::shared_ptr<const LineBitmap> translation_line;
+  if (!lyric_.empty()) {
+    lyric_line = GetLine(lyric_, LyricTextStyle(), metrics.lyric_height,
+                         &phase, stats);
+    lyric_scroll_.Update(lyric_line->text_width, draw_width,
+                         line_duration_ms_, now_ms, scroll_elapsed_ms);
+    if (with_translation) {
+      translation_line =
+          GetLine(translation_, TranslationTextStyle(metrics),
+                  metrics.translation_height, &phase, stats);
+      translation_scroll_.Update(translation_line->text_width, draw_width,
+                                 line_duration_ms_, now_ms, scroll_elapsed_ms);
+    }
+  }
+
+  phase.Switch(RenderStats::Phase::kRasterise);
+
+  ArgbSurface* frame = target;
+  if (vertical_) {
+    if (logical_frame_.width() != draw_width ||
+        logical_frame_.height() != draw_height) {
+      logical_frame_ = ArgbSurface(draw_width, draw_height);
+    }
+    frame = &logical_frame_;
+  }
+  frame->Clear();
+
+  bool animating = false;
+  if (spectrum_source_) {
+    animating = DrawSpectrum(frame, elapsed_ms);
+  }
+  auto compose_row = [&](const LineBitmap& line,
+                         const lyric_layout::ScrollTrack& track, int row_y,
+                         int row_height) {
+    const float x = track.LineX(line.text_width, draw_width);
+    const PixelRect clip{0, row_y, draw_width, row_y + row_height};
+    frame->Composite(line.surface,
+                     static_cast<int>(std::lround(x)) - line.margin, row_y,
+                     clip);
+    animating |= !paused && track.IsAnimating(line.text_width, draw_width);
+  };
+  if (lyric_line) {
+    compose_row(*lyric_line, lyric_scroll_, start_y, metrics.lyric_height);
+  }
+  if (translation_line) {
+    compose_row(*translation_line, translation_scroll_,
+                start_y + metrics.lyric_height, metrics.translation_height);
+  }
+
+  if (vertical_) {
+    target->CopyRotatedClockwise(logical_frame_);
+  }
+  return animating;
+}
+
+}  // namespace cyrene_music
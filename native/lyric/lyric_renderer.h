@@ -0,0 +1,161 @@
+#ifndef NATIVE_LYRIC_LYRIC_RENDERER_H_
+#define NATIVE_LYRIC_LYRIC_RENDERER_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+#include "audio/spectrum_slot.h"
+#include "lyric/argb_surface.h"
+#include "lyric/lyric_layout.h"
+#include "lyric/render_stats.h"
+#include "lyric/text_rasterizer.h"
+#include "playback/playback_clock.h"
+
+namespace cyrene_music {
+
+// A lyric line rendered once into its own bitmap. The text starts |margin|
+// pixels in from the left so strokes are not clipped.
+struct LineBitmap {
+  ArgbSurface surface;
+  float text_width = 0.0f;
+  int margin = 0;
+};
+
+// LRU cache of rendered lines bounded by total pixel bytes.
+class LineBitmapCache {
+ public:
+  static constexpr size_t kDefaultBudgetBytes = 8 * 1024 * 1024;
+
+  explicit LineBitmapCache(size_t budget_bytes = kDefaultBudgetBytes);
+
+  static std::string MakeKey(const std::string& text, const TextStyle& style,
+                             int row_height);
+
+  // Returns the cached line and marks it most recently used, or nullptr.
+  std::shared_ptr<const LineBitmap> Find(const std::string& key);
+
+  void Insert(const std::string& key, std::shared_ptr<const LineBitmap> line);
+
+  void Clear();
+  void SetBudget(size_t budget_bytes);
+
+  size_t bytes() const { return bytes_; }
+  size_t size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const LineBitmap> line;
+  };
+
+  void EvictToBudget();
+
+  size_t budget_bytes_;
+  size_t bytes_ = 0;
+  std::list<Entry> entries_;  // front = most recently used
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+
+// Colours and sizes shared by the lyric and translation rows.
+struct LyricStyle {
+  int font_size = 32;
+  int stroke_width = 2;
+  uint32_t text_color = 0xFFFFFFFF;
+  uint32_t stroke_color = 0xFF000000;
+};
+
+// Lays out and composes desktop lyric frames. Each distinct line is drawn
+// once through the TextRasterizer into a cached bitmap; scrolling frames are
+// then just clipped composites of that bitmap, rotated for vertical mode.
+class LyricRenderer {
+ public:
+  explicit LyricRenderer(TextRasterizer* rasterizer,
+                         size_t cache_budget_bytes =
+                             LineBitmapCache::kDefaultBudgetBytes);
+
+  // Returns true when the text actually changed (and the scroll restarted).
+  // The UTF-8 text is taken by value so callers can move it in.
+  bool SetLyric(std::string text, uint64_t now_ms);
+  bool SetTranslation(std::string text, uint64_t now_ms);
+
+  void SetStyle(const LyricStyle& style);
+  void SetShowTranslation(bool show) { show_translation_ = show; }
+  void SetVertical(bool vertical) { vertical_ = vertical; }
+  void SetLineDuration(uint32_t duration_ms);
+
+  // Draws a low-alpha spectrum strip behind the text from |source|'s latest
+  // frame, or none when nullptr. Frames keep animating while the source
+  // has a live writer or the bars are still falling.
+  void SetSpectrumSource(const SpectrumSlot* source);
+  bool show_spectrum() const { return spectrum_source_ != nullptr; }
+
+  // While |clock| reports playback paused the marquee holds still and stops
+  // asking for frames. nullptr (or a clock nobody writes) scrolls on time
+  // alone.
+  void SetPlaybackClock(const PlaybackClock* clock) { playback_clock_ = clock; }
+
+  const std::string& lyric() const { return lyric_; }
+  const std::string& translation() const { return translation_; }
+  const LyricStyle& style() const { return style_; }
+  bool vertical() const { return vertical_; }
+  bool show_translation() const { return show_translation_; }
+  bool has_translation() const {
+    return show_translation_ && !translation_.empty();
+  }
+
+  // Physical size of the lyric-only window for the current state.
+  lyric_layout::WindowSize FrameSize() const;
+
+  // Renders one frame into |target|, which must be FrameSize() (or any size;
+  // the layout centres in whatever it is given). Returns true while a
+  // scroll animation still needs further frames.
+  // A frame advances the scroll by at most ~50 ms however long ago the last
+  // one was, and by nothing on the first frame after a pause.
+  bool RenderFrame(uint64_t now_ms, ArgbSurface* target, RenderStats* stats);
+
+  LineBitmapCache& cache() { return cache_; }
+  // How far the lyric row has scrolled, in pixels.
+  float lyric_scroll_offset() const { return lyric_scroll_.offset(); }
+
+ private:
+  std::shared_ptr<const LineBitmap> GetLine(const std::string& text,
+                                            const TextStyle& style,
+                                            int row_height,
+                                            RenderStats::ScopedPhase* phase,
+                                            RenderStats* stats);
+  // Updates |spectrum_levels_| from the source and draws the strip.
+  // Returns true while it needs further frames.
+  bool DrawSpectrum(ArgbSurface* frame, uint64_t elapsed_ms);
+  TextStyle LyricTextStyle() const;
+  TextStyle TranslationTextStyle(const lyric_layout::RowMetrics& metrics) const;
+
+  TextRasterizer* rasterizer_;
+  LineBitmapCache cache_;
+  ArgbSurface logical_frame_;  // scratch for vertical mode
+
+  std::string lyric_;
+  std::string translation_;
+  LyricStyle style_;
+  bool show_translation_ = true;
+  bool vertical_ = false;
+  uint32_t line_duration_ms_ = 3000;
+
+  const PlaybackClock* playback_clock_ = nullptr;
+  const SpectrumSlot* spectrum_source_ = nullptr;
+  SpectrumFrame spectrum_frame_;
+  std::array<float, kSpectrumBands> spectrum_levels_{};
+
+  lyric_layout::ScrollTrack lyric_scroll_;
+  lyric_layout::ScrollTrack translation_scroll_;
+  uint64_t last_frame_ms_ = 0;
+  bool was_paused_ = false;  // as of the last frame
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_LYRIC_RENDERER_H_
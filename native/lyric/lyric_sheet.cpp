@@ -0,0 +1,63 @@
+#include "lyric/lyric_sheet.h"
+
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+// Only used while loading; the deque keeps the viewed strings in place.
+using InternIndex = std::unordered_map<std::string_view, uint32_t>;
+
+}  // namespace
+
+LyricSheet::LyricSheet() { strings_.emplace_back(); }
+
+void LyricSheet::Load(std::vector<std::string> lyrics,
+                      std::vector<std::string> translations,
+                      const std::vector<int64_t>& start_times_ms) {
+  Clear();
+  lines_.resize(lyrics.size());
+
+  InternIndex index;
+  index.reserve(lyrics.size() + translations.size());
+  index.emplace(std::string_view(strings_.front()), 0);
+  auto intern = [this, &index](std::string text) -> uint32_t {
+    auto it = index.find(std::string_view(text));
+    if (it != index.end()) return it->second;
+    const uint32_t id = static_cast<uint32_t>(strings_.size());
+    strings_.push_back(std::move(text));
+    index.emplace(std::string_view(strings_.back()), id);
+    return id;
+  };
+
+  for (size_t i = 0; i < lyrics.size(); ++i) {
+    Entry& entry = lines_[i];
+    entry.text = intern(std::move(lyrics[i]));
+    if (i < translations.size()) {
+      entry.translation = intern(std::move(translations[i]));
+    }
+    if (i + 1 < start_times_ms.size()) {
+      const int64_t duration = start_times_ms[i + 1] - start_times_ms[i];
+      if (duration > 0) entry.duration_ms = static_cast<uint32_t>(duration);
+    }
+  }
+}
+
+void LyricSheet::Clear() {
+  lines_.clear();
+  strings_.resize(1);
+}
+
+bool LyricSheet::GetLine(size_t index, Line* out) const {
+  if (index >= lines_.size()) return false;
+  const Entry& entry = lines_[index];
+  out->text = &strings_[entry.text];
+  out->translation = &strings_[entry.translation];
+  out->duration_ms = entry.duration_ms;
+  return true;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,59 @@
+#ifndef NATIVE_LYRIC_LYRIC_SHEET_H_
+#define NATIVE_LYRIC_LYRIC_SHEET_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace cyrene_music {
+
+// A track's whole lyric sheet, uploaded once when the lyrics load so line
+// changes only send an index. Text stays UTF-8 and is interned: a chorus
+// that repeats shares one string, so the renderer's line cache and the
+// platform rasterizer see each unique line exactly once.
+class LyricSheet {
+ public:
+  // Matches the fallback the Dart player uses for the last line.
+  static constexpr uint32_t kLastLineDurationMs = 3000;
+
+  struct Line {
+    const std::string* text = nullptr;
+    const std::string* translation = nullptr;
+    uint32_t duration_ms = kLastLineDurationMs;
+  };
+
+  LyricSheet();
+
+  // Replaces the sheet. |translations| and |start_times_ms| may be shorter
+  // than |lyrics| (missing entries are empty / use the fallback duration).
+  // Strings are moved in, not copied.
+  void Load(std::vector<std::string> lyrics,
+            std::vector<std::string> translations,
+            const std::vector<int64_t>& start_times_ms);
+  void Clear();
+
+  // False when |index| is out of range.
+  bool GetLine(size_t index, Line* out) const;
+
+  size_t size() const { return lines_.size(); }
+  bool empty() const { return lines_.empty(); }
+  // Distinct strings, the empty string included.
+  size_t unique_count() const { return strings_.size(); }
+
+ private:
+  struct Entry {
+    uint32_t text = 0;
+    uint32_t translation = 0;
+    uint32_t duration_ms = kLastLineDurationMs;
+  };
+
+  // A deque so interned strings never move once added.
+  std::deque<std::string> strings_;
+  std::vector<Entry> lines_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_LYRIC_SHEET_H_
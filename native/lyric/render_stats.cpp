@@ -0,0 +1,139 @@
+#include "lyric/render_stats.h"
+
+#include <algorithm>
+
+namespace cyrene_music {
+
+namespace {
+// Gaps longer than this between timer-driven frames are treated as the
+// animation having been idle, not as dropped frames.
+constexpr int64_t kMaxSkipGapMs = 1000;
+}  // namespace
+
+void DurationHistogram::Record(int64_t micros) {
+  if (micros < 0) micros = 0;
+  int index = 0;
+  int64_t bound = kBaseUs;
+  while (index < kBucketCount - 1 && micros >= bound) {
+    bound <<= 1;
+    ++index;
+  }
+  ++buckets_[index];
+  ++count_;
+  total_us_ += micros;
+  max_us_ = std::max(max_us_, micros);
+}
+
+void DurationHistogram::Reset() {
+  buckets_.fill(0);
+  count_ = 0;
+  total_us_ = 0;
+  max_us_ = 0;
+}
+
+// static
+int64_t DurationHistogram::BucketUpperBoundUs(int index) {
+  if (index < 0 || index >= kBucketCount - 1) return -1;
+  return kBaseUs << index;
+}
+
+int64_t DurationHistogram::PercentileUs(double percentile) const {
+  if (count_ == 0) return 0;
+  const double target = std::clamp(percentile, 0.0, 100.0) / 100.0 * count_;
+  uint64_t seen = 0;
+  for (int i = 0; i < kBucketCount; ++i) {
+    seen += buckets_[i];
+    if (seen >= target && buckets_[i] > 0) {
+      const int64_t bound = BucketUpperBoundUs(i);
+      // The open bucket has no upper bound; the max is the best estimate.
+      return bound < 0 ? max_us_ : std::min(bound, max_us_);
+    }
+  }
+  return max_us_;
+}
+
+RenderStats::RenderStats() {
+  frame_phase_time_.fill(Clock::duration::zero());
+}
+
+void RenderStats::BeginFrame(int expected_interval_ms) {
+  const Clock::time_point now = Clock::now();
+
+  if (has_last_frame_ && expected_interval_ms > 0 && expected_interval_ms_ > 0) {
+    const int64_t gap_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        now - last_frame_start_).count();
+    if (gap_ms <= kMaxSkipGapMs) {
+      // A tick that lands one and a half intervals late means at least one
+      // refresh never made it to the screen.
+      const int64_t late = gap_ms * 2 / expected_interval_ms;
+      if (late >= 3) {
+        skipped_frames_ += static_cast<uint64_t>((late + 1) / 2 - 1);
+      }
+    }
+  }
+
+  frame_phase_time_.fill(Clock::duration::zero());
+  frame_start_ = now;
+  last_frame_start_ = now;
+  has_last_frame_ = true;
+  expected_interval_ms_ = expected_interval_ms;
+  in_frame_ = true;
+}
+
+void RenderStats::EndFrame() {
+  if (!in_frame_) return;
+  in_frame_ = false;
+
+  for (int i = 0; i < kPhaseCount; ++i) {
+    phases_[i].Record(std::chrono::duration_cast<std::chrono::microseconds>(
+        frame_phase_time_[i]).count());
+  }
+  frame_total_.Record(std::chrono::duration_cast<std::chrono::microseconds>(
+      Clock::now() - frame_start_).count());
+
+  ++frames_;
+  if (line_open_) ++current_line_frames_;
+}
+
+void RenderStats::BeginLine() {
+  FinishLine();
+  line_open_ = true;
+  current_line_frames_ = 0;
+}
+
+void RenderStats::FinishLine() {
+  if (!line_open_ || current_line_frames_ == 0) return;
+  ++lines_;
+  line_frames_total_ += current_line_frames_;
+  max_frames_per_line_ = std::max(max_frames_per_line_, current_line_frames_);
+}
+
+void RenderStats::AddPhaseTime(Phase phase, Clock::duration elapsed) {
+  if (!in_frame_) return;
+  frame_phase_time_[static_cast<int>(phase)] += elapsed;
+}
+
+double RenderStats::mean_frames_per_line() const {
+  return lines_ == 0 ? 0.0
+                     : static_cast<double>(line_frames_total_) / lines_;
+}
+
+void RenderStats::Reset() {
+  for (auto& histogram : phases_) histogram.Reset();
+  frame_total_.Reset();
+  frame_phase_time_.fill(Clock::duration::zero());
+  in_frame_ = false;
+  has_last_frame_ = false;
+  expected_interval_ms_ = 0;
+  frames_ = 0;
+  skipped_frames_ = 0;
+  cache_hits_ = 0;
+  cache_misses_ = 0;
+  lines_ = 0;
+  line_frames_total_ = 0;
+  max_frames_per_line_ = 0;
+  current_line_frames_ = 0;
+  line_open_ = false;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,141 @@
+#ifndef NATIVE_LYRIC_RENDER_STATS_H_
+#define NATIVE_LYRIC_RENDER_STATS_H_
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+namespace cyrene_music {
+
+// Fixed-size log2 histogram of durations in microseconds.
+// Bucket i counts samples in [2^(i-1) * kBaseUs, 2^i * kBaseUs), bucket 0
+// counts everything below kBaseUs and the last bucket is open ended.
+class DurationHistogram {
+ public:
+  static constexpr int kBucketCount = 16;
+  static constexpr int64_t kBaseUs = 64;
+
+  void Record(int64_t micros);
+  void Reset();
+
+  // Upper bound of bucket |index| in microseconds (-1 for the open bucket).
+  static int64_t BucketUpperBoundUs(int index);
+
+  // Approximate percentile (0..100), reported as the bucket upper bound.
+  int64_t PercentileUs(double percentile) const;
+
+  uint64_t count() const { return count_; }
+  int64_t total_us() const { return total_us_; }
+  int64_t max_us() const { return max_us_; }
+  double mean_us() const {
+    return count_ == 0 ? 0.0 : static_cast<double>(total_us_) / count_;
+  }
+  const std::array<uint64_t, kBucketCount>& buckets() const { return buckets_; }
+
+ private:
+  std::array<uint64_t, kBucketCount> buckets_{};
+  uint64_t count_ = 0;
+  int64_t total_us_ = 0;
+  int64_t max_us_ = 0;
+};
+
+// Per-frame render timing for the desktop lyric overlay.
+//
+// A frame is split into three phases: layout (measuring text and computing
+// scroll state), rasterise (drawing into the offscreen bitmap) and present
+// (handing the bitmap to the compositor). Phases may be entered several times
+// per frame; their durations are summed and recorded once in EndFrame().
+// Not thread-safe: all calls are expected on the window's thread.
+class RenderStats {
+ public:
+  enum class Phase { kLayout = 0, kRasterise, kPresent, kCount };
+
+  using Clock = std::chrono::steady_clock;
+
+  RenderStats();
+
+  // Frame boundaries. |expected_interval_ms| is the refresh interval the
+  // caller scheduled the frame for (0 for on-demand frames); ticks that
+  // arrive later than that are counted as skipped frames.
+  void BeginFrame(int expected_interval_ms);
+  void EndFrame();
+
+  // Marks the start of a new lyric line so frames-per-line can be tracked.
+  void BeginLine();
+
+  void RecordCacheHit() { ++cache_hits_; }
+  void RecordCacheMiss() { ++cache_misses_; }
+
+  void AddPhaseTime(Phase phase, Clock::duration elapsed);
+
+  void Reset();
+
+  const DurationHistogram& phase(Phase phase) const {
+    return phases_[static_cast<int>(phase)];
+  }
+  const DurationHistogram& frame_total() const { return frame_total_; }
+  uint64_t frames() const { return frames_; }
+  uint64_t skipped_frames() const { return skipped_frames_; }
+  uint64_t cache_hits() const { return cache_hits_; }
+  uint64_t cache_misses() const { return cache_misses_; }
+  uint64_t lines() const { return lines_; }
+  uint64_t max_frames_per_line() const { return max_frames_per_line_; }
+  double mean_frames_per_line() const;
+
+  // RAII helper that attributes the enclosing scope to a phase. Switch()
+  // closes the current phase and continues timing under another one, for
+  // code paths that interleave measuring and drawing.
+  class ScopedPhase {
+   public:
+    ScopedPhase(RenderStats* stats, Phase phase)
+        : stats_(stats), phase_(phase), start_(Clock::now()) {}
+    ~ScopedPhase() { stats_->AddPhaseTime(phase_, Clock::now() - start_); }
+
+    void Switch(Phase next) {
+      const Clock::time_point now = Clock::now();
+      stats_->AddPhaseTime(phase_, now - start_);
+      phase_ = next;
+      start_ = now;
+    }
+
+    ScopedPhase(const ScopedPhase&) = delete;
+    ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+   private:
+    RenderStats* stats_;
+    Phase phase_;
+    Clock::time_point start_;
+  };
+
+ private:
+  void FinishLine();
+
+  static constexpr int kPhaseCount = static_cast<int>(Phase::kCount);
+
+  std::array<DurationHistogram, kPhaseCount> phases_;
+  DurationHistogram frame_total_;
+
+  // Accumulators for the frame in flight.
+  std::array<Clock::duration, kPhaseCount> frame_phase_time_{};
+  Clock::time_point frame_start_;
+  Clock::time_point last_frame_start_;
+  bool in_frame_ = false;
+  bool has_last_frame_ = false;
+  int expected_interval_ms_ = 0;
+
+  uint64_t frames_ = 0;
+  uint64_t skipped_frames_ = 0;
+  uint64_t cache_hits_ = 0;
+  uint64_t cache_misses_ = 0;
+
+  // Frames-per-line bookkeeping (completed lines only).
+  uint64_t lines_ = 0;
+  uint64_t line_frames_total_ = 0;
+  uint64_t max_frames_per_line_ = 0;
+  uint64_t current_line_frames_ = 0;
+  bool line_open_ = false;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_RENDER_STATS_H_
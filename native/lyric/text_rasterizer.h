@@ -0,0 +1,51 @@
+#ifndef NATIVE_LYRIC_TEXT_RASTERIZER_H_
+#define NATIVE_LYRIC_TEXT_RASTERIZER_H_
+
+#include <cstdint>
+#include <string>
+
+#include "lyric/argb_surface.h"
+
+namespace cyrene_music {
+
+// How a single lyric line is drawn.
+struct TextStyle {
+  float font_size = 32.0f;
+  float stroke_width = 2.0f;      // 0 draws plain filled text
+  uint32_t fill_color = 0xFFFFFFFF;   // straight ARGB
+  uint32_t stroke_color = 0xFF000000; // straight ARGB
+  bool bold = true;
+  // Vertical mode: CJK codepoints are drawn rotated -90 degrees so they
+  // read upright once the whole frame is rotated clockwise.
+  bool upright_cjk = false;
+
+  bool operator==(const TextStyle& other) const {
+    return font_size == other.font_size &&
+           stroke_width == other.stroke_width &&
+           fill_color == other.fill_color &&
+           stroke_color == other.stroke_color && bold == other.bold &&
+           upright_cjk == other.upright_cjk;
+  }
+  bool operator!=(const TextStyle& other) const { return !(*this == other); }
+};
+
+// Platform text backend (GDI+ on Windows, cairo on Linux). The portable
+// renderer only asks it to measure a line and to draw that line once into
+// an offscreen bitmap; everything per-frame is plain compositing.
+class TextRasterizer {
+ public:
+  virtual ~TextRasterizer() = default;
+
+  // Advance width in pixels of |utf8| drawn with |style|.
+  virtual float MeasureText(const std::string& utf8, const TextStyle& style) = 0;
+
+  // Draws |utf8| with its left edge at |x|, vertically centred in the band
+  // [y, y + height), source-over onto |target|.
+  virtual void DrawText(ArgbSurface* target, const std::string& utf8,
+                        const TextStyle& style, float x, float y,
+                        float height) = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_LYRIC_TEXT_RASTERIZER_H_
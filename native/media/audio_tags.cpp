@@ -0,0 +1,750 @@
+#include "media/audio_tags.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+// Deeper MP4 nesting than moov/udta/meta/ilst/item/data is not metadata.
+constexpr int kMaxAtomDepth = 8;
+
+uint32_t BigEndian32(const uint8_t* p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+         (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+}
+
+uint32_t BigEndian24(const uint8_t* p) {
+  return (uint32_t{p[0]} << 16) | (uint32_t{p[1]} << 8) | uint32_t{p[2]};
+}
+
+uint64_t BigEndian64(const uint8_t* p) {
+  return (uint64_t{BigEndian32(p)} << 32) | BigEndian32(p + 4);
+}
+
+uint32_t LittleEndian32(const uint8_t* p) {
+  return uint32_t{p[0]} | (uint32_t{p[1]} << 8) | (uint32_t{p[2]} << 16) |
+         (uint32_t{p[3]} << 24);
+}
+
+uint32_t SyncSafe32(const uint8_t* p) {
+  return (uint32_t{p[0] & 0x7Fu} << 21) | (uint32_t{p[1] & 0x7Fu} << 14) |
+         (uint32_t{p[2] & 0x7Fu} << 7) | uint32_t{p[3] & 0x7Fu};
+}
+
+std::string_view View(const uint8_t* data, size_t size) {
+  return std::string_view(reinterpret_cast<const char*>(data), size);
+}
+
+bool StartsWith(const uint8_t* data, size_t size, std::string_view prefix) {
+  return size >= prefix.size() &&
+         std::memcmp(data, prefix.data(), prefix.size()) == 0;
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    char x = a[i];
+    if (x >= 'a' && x <= 'z') x = static_cast<char>(x - 'a' + 'A');
+    if (x != b[i]) return false;
+  }
+  return true;
+}
+
+void AppendUtf8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+std::string Latin1ToUtf8(const uint8_t* data, size_t size) {
+  std::string out;
+  out.reserve(size);
+  for (size_t i = 0; i < size; ++i) AppendUtf8(data[i], &out);
+  return out;
+}
+
+std::string Utf16ToUtf8(const uint8_t* data, size_t size, bool big_endian) {
+  std::string out;
+  out.reserve(size);
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    uint32_t unit = big_endian ? (uint32_t{data[i]} << 8) | data[i + 1]
+                               : (uint32_t{data[i + 1]} << 8) | data[i];
+    if (unit >= 0xD800 && unit < 0xDC00 && i + 3 < size) {
+      const uint32_t low = big_endian
+                               ? (uint32_t{data[i + 2]} << 8) | data[i + 3]
+                               : (uint32_t{data[i + 3]} << 8) | data[i + 2];
+      if (low >= 0xDC00 && low < 0xE000) {
+        unit = 0x10000 + ((unit - 0xD800) << 10) + (low - 0xDC00);
+        i += 2;
+      }
+    }
+    AppendUtf8(unit, &out);
+  }
+  return out;
+}
+
+// ID3 text encodings.
+constexpr uint8_t kLatin1 = 0;
+constexpr uint8_t kUtf16 = 1;    // with BOM
+constexpr uint8_t kUtf16Be = 2;  // ID3v2.4
+constexpr uint8_t kUtf8 = 3;     // ID3v2.4
+
+size_t TerminatorWidth(uint8_t encoding) {
+  return encoding == kUtf16 || encoding == kUtf16Be ? 2 : 1;
+}
+
+// Length of the NUL-terminated string at |data| in |encoding|, or |size|
+// if it is not terminated.
+size_t TerminatedLength(uint8_t encoding, const uint8_t* data, size_t size) {
+  if (TerminatorWidth(encoding) == 1) {
+    const void* nul = std::memchr(data, 0, size);
+    return nul != nullptr ? static_cast<const uint8_t*>(nul) - data : size;
+  }
+  for (size_t i = 0; i + 1 < size; i += 2) {
+    if (data[i] == 0 && data[i + 1] == 0) return i;
+  }
+  return size;
+}
+
+// Decodes one ID3 string; NUL separators between ID3v2.4 values become
+// "/".
+std::string DecodeId3Text(uint8_t encoding, const uint8_t* data, size_t size) {
+  std::string out;
+  while (size > 0) {
+    const size_t length = TerminatedLength(encoding, data, size);
+    std::string value;
+    switch (encoding) {
+      case kLatin1:
+        value = Latin1ToUtf8(data, length);
+        break;
+      case kUtf16: {
+        bool big_endian = false;
+        const uint8_t* text = data;
+        size_t text_size = length;
+        if (text_size >= 2 && text[0] == 0xFE && text[1] == 0xFF) {
+          big_endian = true;
+          text += 2;
+          text_size -= 2;
+        } else if (text_size >= 2 && text[0] == 0xFF && text[1] == 0xFE) {
+          text += 2;
+          text_size -= 2;
+        }
+        value = Utf16ToUtf8(text, text_size, big_endian);
+        break;
+      }
+      case kUtf16Be:
+        value = Utf16ToUtf8(data, length, true);
+        break;
+      default:
+        value.assign(reinterpret_cast<const char*>(data), length);
+        break;
+    }
+    if (!value.empty()) {
+      if (!out.empty()) out += '/';
+      out += value;
+    }
+    const size_t consumed =
+        std::min(size, length + TerminatorWidth(encoding));
+    data += consumed;
+    size -= consumed;
+  }
+  return out;
+}
+
+// Reverses ID3 unsynchronisation: every 0xFF 0x00 becomes 0xFF.
+std::string Resynchronise(const uint8_t* data, size_t size) {
+  std::string out;
+  out.reserve(size);
+  for (size_t i = 0; i < size; ++i) {
+    out.push_back(static_cast<char>(data[i]));
+    if (data[i] == 0xFF && i + 1 < size && data[i + 1] == 0x00) ++i;
+  }
+  return out;
+}
+
+// Size of an ID3v2 tag at |data| (header, body and footer), or 0.
+size_t Id3v2Size(const uint8_t* data, size_t size) {
+  if (size < 10 || !StartsWith(data, size, "ID3") || data[3] == 0xFF ||
+      data[4] == 0xFF) {
+    return 0;
+  }
+  const size_t total = 10 + SyncSafe32(data + 6) + ((data[5] & 0x10) ? 10 : 0);
+  return std::min(total, size);
+}
+
+int Base64Value(uint8_t c) {
+  if (c >= 'A' && c <= 'Z') return c - 'A';
+  if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+  if (c >= '0' && c <= '9') return c - '0' + 52;
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+std::string DecodeBase64(std::string_view text) {
+  std::string out;
+  out.reserve(text.size() / 4 * 3);
+  uint32_t bits = 0;
+  int count = 0;
+  for (const char c : text) {
+    const int value = Base64Value(static_cast<uint8_t>(c));
+    if (value < 0) continue;  // padding, line breaks
+    bits = (bits << 6) | static_cast<uint32_t>(value);
+    count += 6;
+    if (count >= 8) {
+      count -= 8;
+      out.push_back(static_cast<char>((bits >> count) & 0xFF));
+    }
+  }
+  return out;
+}
+
+std::string_view ImageMime(const uint8_t* data, size_t size) {
+  if (StartsWith(data, size, "\x89PNG")) return "image/png";
+  if (StartsWith(data, size, "\xFF\xD8")) return "image/jpeg";
+  if (StartsWith(data, size, "GIF8")) return "image/gif";
+  if (StartsWith(data, size, "BM")) return "image/bmp";
+  if (size >= 12 && std::memcmp(data + 8, "WEBP", 4) == 0) return "image/webp";
+  return "image/jpeg";
+}
+
+}  // namespace
+
+bool AudioTags::Open(const std::string& path) {
+  Reset();
+  file_.Close();
+  if (!file_.Open(path)) return false;
+  return Parse(file_.data(), file_.size());
+}
+
+void AudioTags::Reset() {
+  base_ = nullptr;
+  size_ = 0;
+  format_ = Format::kUnknown;
+  for (std::string_view& value : fields_) value = {};
+  cover_ = Picture();
+  owned_.clear();
+}
+
+bool AudioTags::Parse(const uint8_t* data, size_t size) {
+  Reset();
+  base_ = data;
+  size_ = size;
+  // FLAC may be preceded by an ID3v2 tag.
+  const size_t id3_size = Id3v2Size(data, size);
+  if (StartsWith(data + id3_size, size - id3_size, "fLaC")) {
+    format_ = Format::kFlac;
+    ParseFlac(data + id3_size + 4, size - id3_size - 4);
+  } else if (StartsWith(data, size, "OggS")) {
+    format_ = Format::kOgg;
+    ParseOgg(data, size);
+  } else if (size >= 8 && std::memcmp(data + 4, "ftyp", 4) == 0) {
+    format_ = Format::kM4a;
+    ParseMp4Atoms(data, size, 0, false);
+  } else if (id3_size > 0 ||
+             (size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0)) {
+    format_ = Format::kMp3;
+    ParseMp3(data, size);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void AudioTags::SetField(Field field, std::string_view value) {
+  while (!value.empty() && value.back() == '\0') value.remove_suffix(1);
+  if (fields_[field].empty()) fields_[field] = value;
+}
+
+void AudioTags::SetOwnedField(Field field, std::string value) {
+  if (fields_[field].empty() && !value.empty()) {
+    fields_[field] = Own(std::move(value));
+  }
+}
+
+void AudioTags::AppendField(Field field, std::string_view value) {
+  if (value.empty()) return;
+  if (fields_[field].empty()) {
+    fields_[field] = value;
+    return;
+  }
+  std::string joined(fields_[field]);
+  joined += '/';
+  joined += value;
+  fields_[field] = Own(std::move(joined));
+}
+
+std::string_view AudioTags::Own(std::string value) {
+  owned_.push_back(std::move(value));
+  return owned_.back();
+}
+
+void AudioTags::OfferPicture(const uint8_t* data, size_t size,
+                             std::string_view mime, int type) {
+  if (size == 0) return;
+  // The first picture, unless a front cover turns up later.
+  if (cover_.data != nullptr && (cover_.type == 3 || type != 3)) return;
+  cover_.data = data;
+  cover_.size = size;
+  cover_.type = type;
+  cover_.file_offset = data >= base_ && data < base_ + size_
+                           ? static_cast<int64_t>(data - base_)
+                           : -1;
+  fields_[kCoverMime] = mime.empty() ? ImageMime(data, size) : mime;
+}
+
+void AudioTags::ParseFlac(const uint8_t* data, size_t size) {
+  size_t offset = 0;
+  while (size - offset >= 4) {
+    const uint8_t header = data[offset];
+    const size_t length = BigEndian24(data + offset + 1);
+    const uint8_t* block = data + offset + 4;
+    if (length > size - offset - 4) break;
+    switch (header & 0x7F) {
+      case 4:  // VORBIS_COMMENT
+        ParseVorbisComment(block, length);
+        break;
+      case 6:  // PICTURE
+        ParseFlacPicture(block, length);
+        break;
+      default:
+        break;
+    }
+    if (header & 0x80) break;  // last block
+    offset += 4 + length;
+  }
+}
+
+void AudioTags::ParseFlacPicture(const uint8_t* data, size_t size) {
+  if (size < 8) return;
+  const int type = static_cast<int>(BigEndian32(data));
+  size_t offset = 4;
+  const size_t mime_size = BigEndian32(data + offset);
+  offset += 4;
+  if (mime_size > size - offset) return;
+  const std::string_view mime = View(data + offset, mime_size);
+  offset += mime_size;
+  if (size - offset < 4) return;
+  const size_t description_size = BigEndian32(data + offset);
+  offset += 4;
+  // Description, then width, height, depth, colours and the data length.
+  if (description_size > size - offset ||
+      size - offset - description_size < 20) {
+    return;
+  }
+  offset += description_size + 16;
+  const size_t image_size = BigEndian32(data + offset);
+  offset += 4;
+  if (image_size > size - offset) return;
+  OfferPicture(data + offset, image_size, mime, type);
+}
+
+void AudioTags::ParseVorbisComment(const uint8_t* data, size_t size) {
+  if (size < 8) return;
+  size_t offset = 4 + size_t{LittleEndian32(data)};  // vendor string
+  if (offset > size - 4) return;
+  uint32_t count = LittleEndian32(data + offset);
+  offset += 4;
+  for (; count > 0 && size - offset >= 4; --count) {
+    const size_t length = LittleEndian32(data + offset);
+    offset += 4;
+    if (length > size - offset) return;
+    const std::string_view comment = View(data + offset, length);
+    offset += length;
+    const size_t equals = comment.find('=');
+    if (equals == std::string_view::npos) continue;
+    const std::string_view key = comment.substr(0, equals);
+    const std::string_view value = comment.substr(equals + 1);
+    if (EqualsIgnoreCase(key, "TITLE")) {
+      SetField(kTitle, value);
+    } else if (EqualsIgnoreCase(key, "ARTIST")) {
+      AppendField(kArtist, value);
+    } else if (EqualsIgnoreCase(key, "ALBUM")) {
+      SetField(kAlbum, value);
+    } else if (EqualsIgnoreCase(key, "LYRICS") ||
+               EqualsIgnoreCase(key, "UNSYNCEDLYRICS")) {
+      SetField(kLyrics, value);
+    } else if (EqualsIgnoreCase(key, "METADATA_BLOCK_PICTURE")) {
+      const std::string_view picture = Own(DecodeBase64(value));
+      ParseFlacPicture(reinterpret_cast<const uint8_t*>(picture.data()),
+                       picture.size());
+    }
+  }
+}
+
+void AudioTags::ParseMp3(const uint8_t* data, size_t size) {
+  if (Id3v2Size(data, size) > 0) ParseId3v2(data, size);
+  if (title().empty() && artist().empty() && album().empty()) {
+    ParseId3v1(data, size);
+  }
+}
+
+void AudioTags::ParseId3v2(const uint8_t* data, size_t size) {
+  const int major = data[3];
+  const uint8_t flags = data[5];
+  if (major < 2 || major > 4) return;
+  const uint8_t* tag = data + 10;
+  size_t tag_size = std::min<size_t>(SyncSafe32(data + 6), size - 10);
+  if ((flags & 0x80) && major < 4) {
+    // Whole-tag unsynchronisation (ID3v2.4 does it per frame).
+    const std::string_view resynced = Own(Resynchronise(tag, tag_size));
+    tag = reinterpret_cast<const uint8_t*>(resynced.data());
+    tag_size = resynced.size();
+  }
+
+  size_t offset = 0;
+  if ((flags & 0x40) && major >= 3 && tag_size >= 4) {
+    // Extended header: ID3v2.3 does not count its own size field.
+    offset = major == 3 ? 4 + size_t{BigEndian32(tag)} : SyncSafe32(tag);
+  }
+
+  const size_t header_size = major == 2 ? 6 : 10;
+  while (offset < tag_size && tag_size - offset >= header_size) {
+    const uint8_t* header = tag + offset;
+    if (header[0] == 0) break;  // padding
+    char id[5] = {};
+    size_t frame_size = 0;
+    uint8_t format_flags = 0;
+    if (major == 2) {
+      std::memcpy(id, header, 3);
+      frame_size = BigEndian24(header + 3);
+    } else {
+      std::memcpy(id, header, 4);
+      frame_size =
+          major == 4 ? SyncSafe32(header + 4) : BigEndian32(header + 4);
+      format_flags = header[9];
+    }
+    offset += header_size;
+    if (frame_size > tag_size - offset) break;
+    const uint8_t* frame = tag + offset;
+    offset += frame_size;
+
+    if (major == 3) {
+      if (format_flags & 0xC0) continue;  // compressed or encrypted
+      if (format_flags & 0x20) {          // grouping identity
+        if (frame_size < 1) continue;
+        ++frame;
+        --frame_size;
+      }
+    } else if (major == 4) {
+      if (format_flags & 0x0C) continue;  // compressed or encrypted
+      if (format_flags & 0x40) {          // grouping identity
+        if (frame_size < 1) continue;
+        ++frame;
+        --frame_size;
+      }
+      if (format_flags & 0x01) {  // data length indicator
+        if (frame_size < 4) continue;
+        frame += 4;
+        frame_size -= 4;
+      }
+      if (format_flags & 0x02) {  // unsynchronised
+        const std::string_view resynced = Own(Resynchronise(frame, frame_size));
+        frame = reinterpret_cast<const uint8_t*>(resynced.data());
+        frame_size = resynced.size();
+      }
+    }
+    ParseId3Frame(id, major, frame, frame_size);
+  }
+}
+
+void AudioTags::ParseId3Frame(const char* id, int major, const uint8_t* data,
+                              size_t size) {
+  const std::string_view name(id);
+  Field text_field = kFieldCount;
+  if (name == "TIT2" || name == "TT2") {
+    text_field = kTitle;
+  } else if (name == "TPE1" || name == "TP1") {
+    text_field = kArtist;
+  } else if (name == "TALB" || name == "TAL") {
+    text_field = kAlbum;
+  }
+
+  if (text_field != kFieldCount) {
+    if (size < 1 || !fields_[text_field].empty()) return;
+    const uint8_t encoding = data[0];
+    const uint8_t* text = data + 1;
+    const size_t text_size = size - 1;
+    // UTF-8 (and plain ASCII) with a single value is used in place.
+    const size_t length = TerminatedLength(encoding, text, text_size);
+    const bool single = std::all_of(text + length, text + text_size,
+                                    [](uint8_t c) { return c == 0; });
+    const bool ascii =
+        encoding == kLatin1 &&
+        std::all_of(text, text + length, [](uint8_t c) { return c < 0x80; });
+    if ((encoding == kUtf8 || ascii) && single) {
+      SetField(text_field, View(text, length));
+    } else {
+      SetOwnedField(text_field, DecodeId3Text(encoding, text, text_size));
+    }
+    return;
+  }
+
+  if (name == "USLT" || name == "ULT") {
+    // Encoding, language, content descriptor, lyrics.
+    if (size < 4 || !lyrics().empty()) return;
+    const uint8_t encoding = data[0];
+    const uint8_t* rest = data + 4;
+    size_t rest_size = size - 4;
+    const size_t descriptor =
+        std::min(rest_size, TerminatedLength(encoding, rest, rest_size) +
+                                TerminatorWidth(encoding));
+    rest += descriptor;
+    rest_size -= descriptor;
+    const bool ascii =
+        encoding == kLatin1 &&
+        std::all_of(rest, rest + rest_size, [](uint8_t c) { return c < 0x80; });
+    if (encoding == kUtf8 || ascii) {
+      SetField(kLyrics, View(rest, rest_size));
+    } else {
+      // Multi-line lyrics are one value; decode without splitting on NULs.
+      SetOwnedField(kLyrics,
+                    DecodeId3Text(encoding, rest,
+                                  TerminatedLength(encoding, rest, rest_size)));
+    }
+    return;
+  }
+
+  if (name == "APIC" || name == "PIC") {
+    // Encoding, MIME type (ID3v2.2: three-letter format), picture type,
+    // description, image.
+    if (size < 2) return;
+    const uint8_t encoding = data[0];
+    size_t offset = 1;
+    std::string_view mime;
+    if (major == 2) {
+      if (size < 5) return;
+      const std::string_view format = View(data + 1, 3);
+      mime = format == "PNG" ? "image/png" : "image/jpeg";
+      offset = 4;
+    } else {
+      const size_t mime_size = TerminatedLength(kLatin1, data + 1, size - 1);
+      mime = View(data + 1, mime_size);
+      offset = std::min(size, 1 + mime_size + 1);
+    }
+    if (offset >= size) return;
+    const int type = data[offset++];
+    const size_t description =
+        TerminatedLength(encoding, data + offset, size - offset);
+    offset += std::min(size - offset, description + TerminatorWidth(encoding));
+    if (offset >= size) return;
+    // "image/jpg" and "jpeg" turn up in the wild; trust the bytes instead.
+    if (mime.find('/') == std::string_view::npos) mime = {};
+    OfferPicture(data + offset, size - offset, mime, type);
+  }
+}
+
+void AudioTags::ParseId3v1(const uint8_t* data, size_t size) {
+  if (size < 128) return;
+  const uint8_t* tag = data + size - 128;
+  if (!StartsWith(tag, 128, "TAG")) return;
+  const auto text = [](const uint8_t* field) {
+    size_t length = 30;
+    while (length > 0 && (field[length - 1] == 0 || field[length - 1] == ' ')) {
+      --length;
+    }
+    const void* nul = std::memchr(field, 0, length);
+    if (nul != nullptr) length = static_cast<const uint8_t*>(nul) - field;
+    return Latin1ToUtf8(field, length);
+  };
+  SetOwnedField(kTitle, text(tag + 3));
+  SetOwnedField(kArtist, text(tag + 33));
+  SetOwnedField(kAlbum, text(tag + 63));
+}
+
+void AudioTags::ParseMp4Atoms(const uint8_t* data, size_t size, int depth,
+                              bool item_list) {
+  if (depth > kMaxAtomDepth) return;
+  size_t offset = 0;
+  while (size - offset >= 8) {
+    const uint8_t* atom = data + offset;
+    uint64_t atom_size = BigEndian32(atom);
+    size_t header_size = 8;
+    if (atom_size == 1) {
+      if (size - offset < 16) return;
+      atom_size = BigEndian64(atom + 8);
+      header_size = 16;
+    } else if (atom_size == 0) {
+      atom_size = size - offset;  // to the end of the file
+    }
+    if (atom_size < header_size || atom_size > size - offset) return;
+    const std::string_view name = View(atom + 4, 4);
+    const uint8_t* body = atom + header_size;
+    size_t body_size = static_cast<size_t>(atom_size) - header_size;
+    if (item_list) {
+      ParseMp4Item(name, body, body_size);
+    } else if (name == "moov" || name == "udta") {
+      ParseMp4Atoms(body, body_size, depth + 1, false);
+    } else if (name == "ilst") {
+      ParseMp4Atoms(body, body_size, depth + 1, true);
+    } else if (name == "meta") {
+      // A full box (version and flags first) in MP4, a plain container in
+      // QuickTime files.
+      if (body_size >= 8 && std::memcmp(body + 4, "hdlr", 4) != 0) {
+        body += 4;
+        body_size -= 4;
+      }
+      ParseMp4Atoms(body, body_size, depth + 1, false);
+    }
+    offset += static_cast<size_t>(atom_size);
+  }
+}
+
+void AudioTags::ParseMp4Item(std::string_view name, const uint8_t* data,
+                             size_t size) {
+  // The value is a "data" atom: size, "data", type indicator, locale,
+  // payload.
+  if (size < 16 || std::memcmp(data + 4, "data", 4) != 0) return;
+  const size_t data_size = std::min<size_t>(BigEndian32(data), size);
+  if (data_size < 16) return;
+  const uint32_t indicator = BigEndian32(data + 8) & 0xFFFFFF;
+  const uint8_t* payload = data + 16;
+  const size_t payload_size = data_size - 16;
+  if (name == "covr") {
+    const std::string_view mime = indicator == 14   ? "image/png"
+                                  : indicator == 27 ? "image/bmp"
+                                  : indicator == 13 ? "image/jpeg"
+                                                    : std::string_view();
+    OfferPicture(payload, payload_size, mime, 3);
+    return;
+  }
+  if (indicator != 1) return;  // not UTF-8 text
+  const std::string_view value = View(payload, payload_size);
+  if (name == "\xA9nam") {
+    SetField(kTitle, value);
+  } else if (name == "\xA9" "ART") {
+    SetField(kArtist, value);
+  } else if (name == "\xA9" "alb") {
+    SetField(kAlbum, value);
+  } else if (name == "\xA9lyr") {
+    SetField(kLyrics, value);
+  }
+}
+
+void AudioTags::ParseOgg(const uint8_t* data, size_t size) {
+  // The comment header is the second packet of the first logical stream.
+  // It may span pages (cover art does); a packet inside one page is used in
+  // place, a longer one is joined into an owned buffer.
+  const uint8_t* first = nullptr;
+  size_t length = 0;
+  std::string joined;
+  bool spans = false;
+  int packet = 0;
+  uint32_t serial = 0;
+  bool have_serial = false;
+  size_t offset = 0;
+  while (packet < 2 && size - offset >= 27 &&
+         StartsWith(data + offset, size - offset, "OggS")) {
+    const uint8_t* page = data + offset;
+    const size_t segments = page[26];
+    if (size - offset < 27 + segments) return;
+    const uint8_t* lacing = page + 27;
+    size_t body_size = 0;
+    for (size_t i = 0; i < segments; ++i) body_size += lacing[i];
+    if (size - offset - 27 - segments < body_size) return;
+    const uint8_t* body = lacing + segments;
+    offset += 27 + segments + body_size;
+
+    const uint32_t page_serial = LittleEndian32(page + 14);
+    if (!have_serial) {
+      serial = page_serial;
+      have_serial = true;
+    } else if (page_serial != serial) {
+      continue;  // another multiplexed stream
+    }
+    for (size_t i = 0; i < segments && packet < 2; ++i) {
+      if (packet == 1 && lacing[i] > 0) {
+        if (first == nullptr) {
+          first = body;
+          length = lacing[i];
+        } else if (!spans && first + length == body) {
+          length += lacing[i];
+        } else {
+          if (!spans) {
+            joined.assign(reinterpret_cast<const char*>(first), length);
+            spans = true;
+          }
+          joined.append(reinterpret_cast<const char*>(body), lacing[i]);
+        }
+      }
+      body += lacing[i];
+      if (lacing[i] < 255) ++packet;
+    }
+  }
+  if (packet < 2) return;
+  if (spans) {
+    const std::string_view owned = Own(std::move(joined));
+    first = reinterpret_cast<const uint8_t*>(owned.data());
+    length = owned.size();
+  }
+  if (first == nullptr) return;
+  if (StartsWith(first, length, "\x03vorbis")) {
+    ParseVorbisComment(first + 7, length - 7);
+  } else if (StartsWith(first, length, "OpusTags")) {
+    ParseVorbisComment(first + 8, length - 8);
+  } else if (length >= 4 && (first[0] & 0x7F) == 4) {
+    // Ogg FLAC: a VORBIS_COMMENT metadata block.
+    ParseVorbisComment(first + 4, length - 4);
+  }
+}
+
+}  // namespace cyrene_music
+
+void* cyrene_tags_open(const char* path) {
+  if (path == nullptr) return nullptr;
+  auto tags = std::make_unique<cyrene_music::AudioTags>();
+  if (!tags->Open(path)) return nullptr;
+  return tags.release();
+}
+
+int32_t cyrene_tags_format(void* handle) {
+  if (handle == nullptr) return 0;
+  return static_cast<int32_t>(
+      static_cast<cyrene_music::AudioTags*>(handle)->format());
+}
+
+const uint8_t* cyrene_tags_field(void* handle, int32_t field, int64_t* size) {
+  *size = 0;
+  if (handle == nullptr || field < 0 ||
+      field >= cyrene_music::AudioTags::kFieldCount) {
+    return nullptr;
+  }
+  const std::string_view value =
+      static_cast<cyrene_music::AudioTags*>(handle)->field(
+          static_cast<cyrene_music::AudioTags::Field>(field));
+  if (value.empty()) return nullptr;
+  *size = static_cast<int64_t>(value.size());
+  return reinterpret_cast<const uint8_t*>(value.data());
+}
+
+const uint8_t* cyrene_tags_cover(void* handle, int64_t* size,
+                                 int64_t* file_offset) {
+  *size = 0;
+  *file_offset = -1;
+  if (handle == nullptr) return nullptr;
+  const cyrene_music::AudioTags::Picture& cover =
+      static_cast<cyrene_music::AudioTags*>(handle)->cover();
+  *size = static_cast<int64_t>(cover.size);
+  *file_offset = cover.file_offset;
+  return cover.data;
+}
+
+void cyrene_tags_close(void* handle) {
+  delete static_cast<cyrene_music::AudioTags*>(handle);
+}
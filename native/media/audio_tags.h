@@ -0,0 +1,130 @@
+#ifndef NATIVE_MEDIA_AUDIO_TAGS_H_
+#define NATIVE_MEDIA_AUDIO_TAGS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+
+#include "cache/cyrene_cache_file.h"
+#include "ffi/export.h"
+
+namespace cyrene_music {
+
+// Title, artist, album, embedded lyrics and cover art of a local audio
+// file: FLAC metadata blocks, ID3v2 frames (ID3v1 as a fallback) in MP3,
+// the iTunes item list of M4A and the comment packet of Ogg Vorbis, Opus
+// and FLAC.
+//
+// The file is memory-mapped and only the tag region is walked, so opening
+// a 50 MB FLAC touches the few pages its metadata blocks live on instead
+// of reading the whole file. Values point into the mapping wherever the
+// stored bytes are already UTF-8 (and the cover art always does, unless
+// it is base64 or unsynchronised); anything that needs converting is
+// decoded once and owned by the object. Everything stays valid until the
+// next Open() or destruction.
+class AudioTags {
+ public:
+  // Matches NativeTagFormat in native_tag_reader.dart.
+  enum class Format : int32_t {
+    kUnknown = 0,
+    kFlac = 1,
+    kMp3 = 2,
+    kM4a = 3,
+    kOgg = 4,
+  };
+
+  // Matches the field indices in native_tag_reader.dart.
+  enum Field : int32_t {
+    kTitle = 0,
+    kArtist = 1,
+    kAlbum = 2,
+    kLyrics = 3,
+    kCoverMime = 4,
+    kFieldCount = 5,
+  };
+
+  struct Picture {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    // Where the bytes start in the file, or -1 when they were decoded.
+    int64_t file_offset = -1;
+    // ID3 / FLAC picture type; 3 is the front cover.
+    int type = -1;
+  };
+
+  AudioTags() = default;
+
+  AudioTags(const AudioTags&) = delete;
+  AudioTags& operator=(const AudioTags&) = delete;
+
+  // |path| is UTF-8. False if the file cannot be mapped or is not one of
+  // the supported containers; a supported file without tags succeeds with
+  // empty fields.
+  bool Open(const std::string& path);
+  // Same, over bytes the caller keeps alive.
+  bool Parse(const uint8_t* data, size_t size);
+
+  Format format() const { return format_; }
+  std::string_view field(Field field) const { return fields_[field]; }
+  std::string_view title() const { return fields_[kTitle]; }
+  std::string_view artist() const { return fields_[kArtist]; }
+  std::string_view album() const { return fields_[kAlbum]; }
+  std::string_view lyrics() const { return fields_[kLyrics]; }
+  const Picture& cover() const { return cover_; }
+
+ private:
+  void Reset();
+
+  void ParseFlac(const uint8_t* data, size_t size);
+  void ParseMp3(const uint8_t* data, size_t size);
+  void ParseId3v2(const uint8_t* data, size_t size);
+  void ParseId3Frame(const char* id, int major, const uint8_t* data,
+                     size_t size);
+  void ParseId3v1(const uint8_t* data, size_t size);
+  // |item_list|: the children are ilst items rather than containers.
+  void ParseMp4Atoms(const uint8_t* data, size_t size, int depth,
+                     bool item_list);
+  void ParseMp4Item(std::string_view name, const uint8_t* data, size_t size);
+  void ParseOgg(const uint8_t* data, size_t size);
+  void ParseVorbisComment(const uint8_t* data, size_t size);
+  void ParseFlacPicture(const uint8_t* data, size_t size);
+
+  // Sets |field| unless it already has a value; |value| must outlive this
+  // object (the mapping or owned_).
+  void SetField(Field field, std::string_view value);
+  // Same, taking ownership of a decoded value.
+  void SetOwnedField(Field field, std::string value);
+  // Adds another value to a multi-valued field, "a/b".
+  void AppendField(Field field, std::string_view value);
+  void OfferPicture(const uint8_t* data, size_t size, std::string_view mime,
+                    int type);
+  std::string_view Own(std::string value);
+
+  MappedFile file_;
+  const uint8_t* base_ = nullptr;
+  size_t size_ = 0;
+  Format format_ = Format::kUnknown;
+  std::string_view fields_[kFieldCount];
+  Picture cover_;
+  // Decoded values and reassembled packets; a deque so views into earlier
+  // strings survive later additions.
+  std::deque<std::string> owned_;
+};
+
+}  // namespace cyrene_music
+
+// FFI entry points, see lib/services/native_tag_reader.dart. A handle owns
+// the mapping every returned pointer refers to.
+CYRENE_FFI_EXPORT void* cyrene_tags_open(const char* path);
+CYRENE_FFI_EXPORT int32_t cyrene_tags_format(void* handle);
+// UTF-8 bytes of |field|, or null when absent.
+CYRENE_FFI_EXPORT const uint8_t* cyrene_tags_field(void* handle, int32_t field,
+                                                   int64_t* size);
+// The cover image bytes, or null; |file_offset| as in AudioTags::Picture.
+CYRENE_FFI_EXPORT const uint8_t* cyrene_tags_cover(void* handle, int64_t* size,
+                                                   int64_t* file_offset);
+CYRENE_FFI_EXPORT void cyrene_tags_close(void* handle);
+
+#endif  // NATIVE_MEDIA_AUDIO_TAGS_H_
@@ -0,0 +1,114 @@
+#include "media/mpris_state.h"
+
+#include <cstdlib>
+#include <utility>
+
+#include "playback/playback_clock.h"
+
+namespace cyrene_music {
+
+MprisState::MprisState() = default;
+
+void MprisState::SetMetadata(Metadata metadata) {
+  const bool new_track = metadata.title != metadata_.title ||
+                         metadata.artist != metadata_.artist ||
+                         metadata.album != metadata_.album;
+  if (!new_track && metadata.art_url == metadata_.art_url &&
+      metadata.length_us == metadata_.length_us) {
+    return;
+  }
+  if (new_track) ++track_number_;
+  // Dart sends the length with the timeline, not the metadata.
+  if (metadata.length_us <= 0 && !new_track) {
+    metadata.length_us = metadata_.length_us;
+  }
+  metadata_ = std::move(metadata);
+  changed_ |= kMetadata;
+  // Clients read Position again for a new track.
+  if (new_track) Anchor(PlaybackClock::NowUs());
+}
+
+void MprisState::SetLength(int64_t length_us) {
+  if (length_us <= 0 || length_us == metadata_.length_us) return;
+  metadata_.length_us = length_us;
+  changed_ |= kMetadata;
+}
+
+void MprisState::SetPlaybackStatus(const std::string& smtc_status) {
+  Status status = Status::kStopped;
+  if (smtc_status == "playing") {
+    status = Status::kPlaying;
+  } else if (smtc_status == "paused" || smtc_status == "changing") {
+    // "changing" is a track load; MPRIS has no such state.
+    status = Status::kPaused;
+  }
+  if (status == status_) return;
+  status_ = status;
+  changed_ |= kPlaybackStatus;
+  // Clients read Position again when the status changes.
+  Anchor(PlaybackClock::NowUs());
+}
+
+std::string MprisState::track_id() const {
+  return "/org/cyrene_music/track/" + std::to_string(track_number_);
+}
+
+const char* MprisState::playback_status() const {
+  switch (status_) {
+    case Status::kPlaying:
+      return "Playing";
+    case Status::kPaused:
+      return "Paused";
+    case Status::kStopped:
+      break;
+  }
+  return "Stopped";
+}
+
+int64_t MprisState::PositionUs(int64_t now_us) const {
+  PlaybackSnapshot playback;
+  if (PlaybackClock::Shared().Read(&playback)) {
+    return playback.PositionAt(now_us) * 1000;
+  }
+  return ExtrapolatedUs(now_us);
+}
+
+bool MprisState::CheckSeeked(int64_t now_us, int64_t* position_us) {
+  PlaybackSnapshot playback;
+  if (!PlaybackClock::Shared().Read(&playback)) return false;
+  if (playback.rate > 0.0 && playback.rate != rate_) {
+    rate_ = playback.rate;
+    changed_ |= kRate;
+  }
+  const int64_t actual_us = playback.PositionAt(now_us) * 1000;
+  if (std::llabs(actual_us - ExtrapolatedUs(now_us)) <= kSeekToleranceUs) {
+    return false;
+  }
+  Anchor(now_us);
+  *position_us = actual_us;
+  return true;
+}
+
+uint32_t MprisState::TakeChanged() {
+  const uint32_t changed = changed_;
+  changed_ = 0;
+  return changed;
+}
+
+void MprisState::Anchor(int64_t now_us) {
+  anchor_position_us_ = PositionUs(now_us);
+  anchor_at_us_ = now_us;
+}
+
+int64_t MprisState::ExtrapolatedUs(int64_t now_us) const {
+  int64_t position = anchor_position_us_;
+  if (status_ == Status::kPlaying && now_us > anchor_at_us_) {
+    position += static_cast<int64_t>((now_us - anchor_at_us_) * rate_);
+  }
+  if (metadata_.length_us > 0 && position > metadata_.length_us) {
+    position = metadata_.length_us;
+  }
+  return position;
+}
+
+}  // namespace cyrene_music
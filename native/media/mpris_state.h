@@ -0,0 +1,87 @@
+#ifndef NATIVE_MEDIA_MPRIS_STATE_H_
+#define NATIVE_MEDIA_MPRIS_STATE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace cyrene_music {
+
+// State behind the MPRIS org.mpris.MediaPlayer2.Player interface, free of
+// D-Bus types. Setters record which properties actually changed, so a burst
+// of channel calls is announced in one PropertiesChanged signal.
+//
+// Position is never announced. MPRIS clients extrapolate it from Rate while
+// the status is Playing and read it on demand, and it is answered from the
+// shared PlaybackClock. Only a discontinuity (a seek, a restarted track) is
+// reported, as the Seeked signal.
+class MprisState {
+ public:
+  // PropertiesChanged members, as a bit mask.
+  enum Property : uint32_t {
+    kPlaybackStatus = 1u << 0,
+    kMetadata = 1u << 1,
+    kRate = 1u << 2,
+  };
+
+  // A jump smaller than this is drift, not a seek.
+  static constexpr int64_t kSeekToleranceUs = 1000000;
+
+  struct Metadata {
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string art_url;
+    int64_t length_us = 0;
+  };
+
+  MprisState();
+
+  // Fields are replaced as a whole; a new track gets a new track id.
+  void SetMetadata(Metadata metadata);
+  // Length alone, from a timeline update.
+  void SetLength(int64_t length_us);
+  // Takes the smtc channel's status strings ("playing", "paused",
+  // "stopped", "closed", "changing").
+  void SetPlaybackStatus(const std::string& smtc_status);
+
+  const Metadata& metadata() const { return metadata_; }
+  // Object path identifying the current track (mpris:trackid).
+  std::string track_id() const;
+  // "Playing", "Paused" or "Stopped".
+  const char* playback_status() const;
+  double rate() const { return rate_; }
+
+  // Position at |now_us| (PlaybackClock::NowUs() time base).
+  int64_t PositionUs(int64_t now_us) const;
+
+  // Compares the playback clock with where clients have extrapolated to
+  // since the last anchor. Returns true, with the new position, when they
+  // have drifted apart by more than kSeekToleranceUs; clients are then
+  // re-anchored. Also picks up rate changes (kRate).
+  bool CheckSeeked(int64_t now_us, int64_t* position_us);
+
+  // Changed properties since the last call.
+  uint32_t TakeChanged();
+
+ private:
+  enum class Status { kStopped, kPlaying, kPaused };
+
+  // Where clients believe playback is: |position_us| at |at_us|, advancing
+  // at |rate_| while playing.
+  void Anchor(int64_t now_us);
+  int64_t ExtrapolatedUs(int64_t now_us) const;
+
+  Metadata metadata_;
+  uint64_t track_number_ = 0;
+  Status status_ = Status::kStopped;
+  double rate_ = 1.0;
+
+  int64_t anchor_position_us_ = 0;
+  int64_t anchor_at_us_ = 0;
+
+  uint32_t changed_ = 0;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_MEDIA_MPRIS_STATE_H_
@@ -0,0 +1,319 @@
+#include "net/http_connection.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "net/socket.h"
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr size_t kMaxResponseHead = 64 * 1024;
+constexpr size_t kMaxChunkLine = 8 * 1024;
+constexpr size_t kReadSize = 64 * 1024;
+constexpr int kMaxRedirects = 5;
+
+bool ConnectWithTimeout(SocketHandle s, const addrinfo& address,
+                        int timeout_seconds) {
+  if (!SetBlocking(s, false)) return false;
+  if (connect(s, address.ai_addr, static_cast<socklen_t>(address.ai_addrlen)) !=
+      0) {
+    if (!LastErrorInProgress()) return false;
+    pollfd entry = {};
+    entry.fd = s;
+    entry.events = POLLOUT;
+    if (PollSockets(&entry, 1, timeout_seconds * 1000) <= 0) return false;
+    int result = 0;
+    socklen_t length = sizeof(result);
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>(&result),
+                   &length) != 0 ||
+        result != 0) {
+      return false;
+    }
+  }
+  return SetBlocking(s, true);
+}
+
+// A blocking socket connected to the first address of |host| that
+// answers, or kInvalidSocket with *error set.
+SocketHandle Connect(const std::string& host, uint16_t port,
+                     int timeout_seconds, std::string* error) {
+  if (!InitSockets()) {
+    *error = "Sockets unavailable";
+    return kInvalidSocket;
+  }
+  addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_protocol = IPPROTO_TCP;
+  addrinfo* addresses = nullptr;
+  const std::string service = std::to_string(port);
+  if (getaddrinfo(host.c_str(), service.c_str(), &hints, &addresses) != 0 ||
+      addresses == nullptr) {
+    *error = "Cannot resolve " + host;
+    return kInvalidSocket;
+  }
+
+  SocketHandle connected = kInvalidSocket;
+  for (const addrinfo* address = addresses;
+       address != nullptr && connected == kInvalidSocket;
+       address = address->ai_next) {
+    const SocketHandle s =
+        socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+    if (s == kInvalidSocket) continue;
+    if (ConnectWithTimeout(s, *address, timeout_seconds)) {
+      connected = s;
+    } else {
+      CloseSocket(s);
+    }
+  }
+  freeaddrinfo(addresses);
+
+  if (connected == kInvalidSocket) {
+    *error = "Cannot connect to " + host + ":" + service;
+  } else {
+    SetSocketTimeouts(connected, timeout_seconds);
+    SetNoDelay(connected);
+  }
+  return connected;
+}
+
+bool IsRedirect(int status) {
+  return status == 301 || status == 302 || status == 303 || status == 307 ||
+         status == 308;
+}
+
+}  // namespace
+
+bool HttpConnection::Open(const std::string& method, const std::string& url,
+                          const HttpHeaders& headers, int timeout_seconds,
+                          std::string* error) {
+  url_ = url;
+  std::string current_method = method;
+  for (int redirects = 0;; ++redirects) {
+    Url parsed;
+    if (!Url::Parse(url_, &parsed)) {
+      *error = "Unsupported URL " + url_;
+      return false;
+    }
+    if (!Exchange(current_method, parsed, headers, timeout_seconds, error)) {
+      return false;
+    }
+    const std::string* location = response_.headers.Find("location");
+    if (!IsRedirect(response_.status) || location == nullptr ||
+        location->empty()) {
+      break;
+    }
+    if (redirects == kMaxRedirects) {
+      *error = "Redirect limit exceeded";
+      return false;
+    }
+    url_ = ResolveUrl(url_, *location);
+    if (response_.status == 303 && current_method != "HEAD") {
+      current_method = "GET";
+    }
+  }
+
+  const int status = response_.status;
+  const std::string* transfer_encoding =
+      response_.headers.Find("transfer-encoding");
+  const std::string* content_length = response_.headers.Find("content-length");
+  if (current_method == "HEAD" || status / 100 == 1 || status == 204 ||
+      status == 304) {
+    framing_ = Framing::kNone;
+    body_done_ = true;
+  } else if (transfer_encoding != nullptr &&
+             ToLowerAscii(*transfer_encoding).find("chunked") !=
+                 std::string::npos) {
+    framing_ = Framing::kChunked;
+  } else if (content_length != nullptr && !content_length->empty()) {
+    char* end = nullptr;
+    content_length_ = std::strtoull(content_length->c_str(), &end, 10);
+    if (*end != '\0') {
+      *error = "Malformed Content-Length";
+      return false;
+    }
+    framing_ = Framing::kLength;
+    remaining_ = content_length_;
+    body_done_ = remaining_ == 0;
+  } else {
+    framing_ = Framing::kUntilClose;
+  }
+  return true;
+}
+
+bool HttpConnection::Exchange(const std::string& method, const Url& url,
+                              const HttpHeaders& headers, int timeout_seconds,
+                              std::string* error) {
+  transport_.reset();
+  buffer_.clear();
+  buffer_offset_ = 0;
+  response_ = HttpResponseHead();
+
+  const SocketHandle s = Connect(url.host, url.port, timeout_seconds, error);
+  if (s == kInvalidSocket) return false;
+  if (url.scheme == "https") {
+    TlsConnector* tls = GetTlsConnector();
+    if (tls == nullptr) {
+      CloseSocket(s);
+      *error = "No TLS support for " + url.host;
+      return false;
+    }
+    transport_ = tls->Connect(static_cast<intptr_t>(s), url.host, error);
+    if (!transport_) return false;
+  } else {
+    transport_ = NewPlainTransport(static_cast<intptr_t>(s));
+  }
+
+  std::string head = method + " " + url.target + " HTTP/1.1\r\nHost: " +
+                     url.Authority() + "\r\n";
+  HttpHeaders fields = headers;
+  fields.Remove("host");
+  fields.Remove("connection");
+  fields.AppendTo(&head);
+  head += "Connection: close\r\n\r\n";
+  if (!transport_->Write(head.data(), head.size())) {
+    *error = "Cannot send request to " + url.host;
+    return false;
+  }
+
+  // Interim 1xx responses (100 Continue, 103 Early Hints) are skipped.
+  for (;;) {
+    size_t end;
+    while ((end = buffer_.find("\r\n\r\n", buffer_offset_)) ==
+           std::string::npos) {
+      if (buffer_.size() - buffer_offset_ > kMaxResponseHead || !Fill()) {
+        *error = "No HTTP response from " + url.host;
+        return false;
+      }
+    }
+    HttpResponseHead response;
+    if (!HttpResponseHead::Parse(
+            std::string_view(buffer_).substr(buffer_offset_,
+                                             end - buffer_offset_),
+            &response)) {
+      *error = "Malformed HTTP response from " + url.host;
+      return false;
+    }
+    buffer_offset_ = end + 4;
+    if (response.status / 100 == 1 && response.status != 101) continue;
+    response_ = std::move(response);
+    return true;
+  }
+}
+
+bool HttpConnection::Fill() {
+  if (!transport_ || failed_) return false;
+  if (buffer_offset_ > 0 && buffer_offset_ * 2 >= buffer_.size()) {
+    buffer_.erase(0, buffer_offset_);
+    buffer_offset_ = 0;
+  }
+  const size_t old_size = buffer_.size();
+  buffer_.resize(old_size + kReadSize);
+  const ptrdiff_t n = transport_->Read(&buffer_[old_size], kReadSize);
+  buffer_.resize(old_size + static_cast<size_t>(std::max<ptrdiff_t>(n, 0)));
+  // kWouldBlock on a blocking socket is its timeout.
+  if (n < 0) failed_ = true;
+  return n > 0;
+}
+
+ptrdiff_t HttpConnection::ReadRaw(void* data, size_t size) {
+  if (buffer_offset_ < buffer_.size()) {
+    const size_t n = std::min(size, buffer_.size() - buffer_offset_);
+    std::memcpy(data, buffer_.data() + buffer_offset_, n);
+    buffer_offset_ += n;
+    return static_cast<ptrdiff_t>(n);
+  }
+  if (!transport_) return 0;
+  const ptrdiff_t n = transport_->Read(data, size);
+  return n < 0 ? Transport::kFailed : n;
+}
+
+bool HttpConnection::ReadLine(std::string* line) {
+  size_t end;
+  while ((end = buffer_.find("\r\n", buffer_offset_)) == std::string::npos) {
+    if (buffer_.size() - buffer_offset_ > kMaxChunkLine || !Fill()) {
+      return false;
+    }
+  }
+  line->assign(buffer_, buffer_offset_, end - buffer_offset_);
+  buffer_offset_ = end + 2;
+  return true;
+}
+
+ptrdiff_t HttpConnection::Read(void* data, size_t size) {
+  if (failed_) return Transport::kFailed;
+  if (body_done_ || size == 0) return 0;
+
+  if (framing_ == Framing::kChunked && remaining_ == 0) {
+    std::string line;
+    if (in_chunk_ && (!ReadLine(&line) || !line.empty())) {
+      failed_ = true;
+      return Transport::kFailed;
+    }
+    in_chunk_ = false;
+    char* end = nullptr;
+    if (!ReadLine(&line) || line.empty()) {
+      failed_ = true;
+      return Transport::kFailed;
+    }
+    remaining_ = std::strtoull(line.c_str(), &end, 16);
+    if (end == line.c_str() || (*end != '\0' && *end != ';' && *end != ' ')) {
+      failed_ = true;
+      return Transport::kFailed;
+    }
+    if (remaining_ == 0) {
+      // Trailer fields, up to a blank line.
+      do {
+        if (!ReadLine(&line)) {
+          failed_ = true;
+          return Transport::kFailed;
+        }
+      } while (!line.empty());
+      body_done_ = true;
+      return 0;
+    }
+    in_chunk_ = true;
+  }
+
+  const size_t want =
+      framing_ == Framing::kUntilClose
+          ? size
+          : static_cast<size_t>(std::min<uint64_t>(size, remaining_));
+  const ptrdiff_t n = ReadRaw(data, want);
+  if (n == 0 && framing_ == Framing::kUntilClose) {
+    body_done_ = true;
+    return 0;
+  }
+  if (n <= 0) {
+    failed_ = true;
+    return Transport::kFailed;
+  }
+  if (framing_ != Framing::kUntilClose) {
+    remaining_ -= static_cast<uint64_t>(n);
+    if (framing_ == Framing::kLength && remaining_ == 0) body_done_ = true;
+  }
+  return n;
+}
+
+bool HttpConnection::ReadAll(std::string* body, size_t limit) {
+  body->clear();
+  char chunk[16 * 1024];
+  for (;;) {
+    const ptrdiff_t n = Read(chunk, sizeof(chunk));
+    if (n == 0) return true;
+    if (n < 0 || body->size() + static_cast<size_t>(n) > limit) return false;
+    body->append(chunk, static_cast<size_t>(n));
+  }
+}
+
+std::string HttpConnection::TakeBuffered() {
+  std::string buffered = buffer_.substr(buffer_offset_);
+  buffer_.clear();
+  buffer_offset_ = 0;
+  return buffered;
+}
+
+}  // namespace cyrene_music
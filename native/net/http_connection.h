@@ -0,0 +1,94 @@
+#ifndef NATIVE_NET_HTTP_CONNECTION_H_
+#define NATIVE_NET_HTTP_CONNECTION_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "net/http_message.h"
+#include "net/transport.h"
+
+namespace cyrene_music {
+
+// One HTTP/1.1 request and its response on a fresh connection, with
+// blocking I/O bounded by a timeout: the stream proxy's upstream side and
+// the downloader's segments. Redirects are followed like package:http does
+// (at most five, 303 turning into GET); https:// goes through the
+// installed TlsConnector.
+//
+// Connections are not reused ("Connection: close" is always sent), so a
+// body without a length ends where the server closes.
+class HttpConnection {
+ public:
+  // How the response body is delimited on the wire.
+  enum class Framing { kNone, kLength, kChunked, kUntilClose };
+
+  HttpConnection() = default;
+
+  HttpConnection(const HttpConnection&) = delete;
+  HttpConnection& operator=(const HttpConnection&) = delete;
+
+  // Sends |method| for |url| with |headers| (Host and Connection are
+  // replaced) and reads the response head, after any redirects. false,
+  // with *error set, if no server answered with HTTP. |timeout_seconds|
+  // bounds the connect and every read and write.
+  bool Open(const std::string& method, const std::string& url,
+            const HttpHeaders& headers, int timeout_seconds,
+            std::string* error);
+
+  int status() const { return response_.status; }
+  const HttpHeaders& headers() const { return response_.headers; }
+  // After redirects.
+  const std::string& url() const { return url_; }
+  Framing framing() const { return framing_; }
+  // The Content-Length; meaningful for Framing::kLength only.
+  uint64_t content_length() const { return content_length_; }
+  // The open connection's socket, -1 without one. Shutting it down from
+  // another thread makes a blocked Read() fail at once.
+  intptr_t socket() const { return transport_ ? transport_->socket() : -1; }
+
+  // Decoded body bytes: 0 at its end, Transport::kFailed if the connection
+  // fails or the body is cut short.
+  ptrdiff_t Read(void* data, size_t size);
+  // The whole decoded body; false if reading fails or it exceeds |limit|.
+  bool ReadAll(std::string* body, size_t limit);
+
+  // For relaying the body undecoded: the bytes already read past the head,
+  // then the connection itself.
+  std::string TakeBuffered();
+  std::unique_ptr<Transport> TakeTransport() { return std::move(transport_); }
+
+ private:
+  bool Exchange(const std::string& method, const Url& url,
+                const HttpHeaders& headers, int timeout_seconds,
+                std::string* error);
+  // Reads more of the stream into buffer_; false at its end or on error.
+  bool Fill();
+  // Undecoded bytes, buffered ones first; Read()'s results.
+  ptrdiff_t ReadRaw(void* data, size_t size);
+  // The next line of a chunked body, without its CRLF.
+  bool ReadLine(std::string* line);
+
+  std::unique_ptr<Transport> transport_;
+  HttpResponseHead response_;
+  std::string url_;
+  Framing framing_ = Framing::kNone;
+  uint64_t content_length_ = 0;
+
+  // Received bytes not consumed yet start at buffer_[buffer_offset_].
+  std::string buffer_;
+  size_t buffer_offset_ = 0;
+  // Body bytes left: of the whole body for kLength, of the current chunk
+  // for kChunked.
+  uint64_t remaining_ = 0;
+  // Inside a chunk, whose data is followed by a CRLF.
+  bool in_chunk_ = false;
+  bool body_done_ = false;
+  bool failed_ = false;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_HTTP_CONNECTION_H_
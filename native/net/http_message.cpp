@@ -0,0 +1,394 @@
+#include "net/http_message.h"
+
+namespace cyrene_music {
+
+namespace {
+
+char LowerAscii(char c) {
+  return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+std::string_view Trim(std::string_view text) {
+  while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) {
+    text.remove_prefix(1);
+  }
+  while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) {
+    text.remove_suffix(1);
+  }
+  return text;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// The start line, and the header fields after it into |headers|. Folded
+// (obsolete multi-line) fields are not supported; nobody sends them.
+bool ParseFields(std::string_view head, std::string_view* start_line,
+                 HttpHeaders* headers) {
+  size_t line_end = head.find("\r\n");
+  *start_line = head.substr(0, line_end);
+  while (line_end != std::string_view::npos) {
+    const size_t start = line_end + 2;
+    line_end = head.find("\r\n", start);
+    const std::string_view line = head.substr(
+        start, line_end == std::string_view::npos ? std::string_view::npos
+                                                  : line_end - start);
+    if (line.empty()) continue;
+    const size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0) return false;
+    headers->Add(std::string(line.substr(0, colon)),
+                 std::string(Trim(line.substr(colon + 1))));
+  }
+  return !start_line->empty();
+}
+
+// RFC 3986 section 5.2.4.
+std::string RemoveDotSegments(std::string_view path) {
+  std::string output;
+  while (!path.empty()) {
+    if (path.substr(0, 3) == "../") {
+      path.remove_prefix(3);
+    } else if (path.substr(0, 2) == "./") {
+      path.remove_prefix(2);
+    } else if (path.substr(0, 3) == "/./") {
+      path.remove_prefix(2);
+    } else if (path == "/.") {
+      path = "/";
+    } else if (path.substr(0, 4) == "/../" || path == "/..") {
+      path = path.size() == 3 ? "/" : path.substr(3);
+      const size_t slash = output.rfind('/');
+      output.erase(slash == std::string::npos ? 0 : slash);
+    } else if (path == "." || path == "..") {
+      path = std::string_view();
+    } else {
+      const size_t next = path.find('/', 1);
+      output.append(path.substr(0, next));
+      path = next == std::string_view::npos ? std::string_view()
+                                            : path.substr(next);
+    }
+  }
+  return output;
+}
+
+// Length of the "scheme:" prefix of |text|, or 0 if it has none.
+size_t SchemeLength(std::string_view text) {
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == ':') return i == 0 ? 0 : i + 1;
+    const bool letter = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    const bool other = (c >= '0' && c <= '9') || c == '+' || c == '-' ||
+                       c == '.';
+    if (!letter && (i == 0 || !other)) return 0;
+  }
+  return 0;
+}
+
+}  // namespace
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (LowerAscii(a[i]) != LowerAscii(b[i])) return false;
+  }
+  return true;
+}
+
+std::string ToLowerAscii(std::string_view text) {
+  std::string lower(text);
+  for (char& c : lower) c = LowerAscii(c);
+  return lower;
+}
+
+// static
+bool Url::Parse(const std::string& text, Url* url) {
+  const size_t scheme_end = text.find("://");
+  if (scheme_end == std::string::npos) return false;
+  url->scheme = ToLowerAscii(std::string_view(text).substr(0, scheme_end));
+  if (url->scheme != "http" && url->scheme != "https") return false;
+
+  const size_t authority_start = scheme_end + 3;
+  size_t authority_end = text.find_first_of("/?#", authority_start);
+  if (authority_end == std::string::npos) authority_end = text.size();
+  std::string_view authority = std::string_view(text).substr(
+      authority_start, authority_end - authority_start);
+  const size_t at = authority.rfind('@');
+  if (at != std::string_view::npos) authority.remove_prefix(at + 1);
+
+  std::string_view port;
+  if (!authority.empty() && authority.front() == '[') {
+    const size_t bracket = authority.find(']');
+    if (bracket == std::string_view::npos) return false;
+    url->host = std::string(authority.substr(1, bracket - 1));
+    if (bracket + 1 < authority.size()) {
+      if (authority[bracket + 1] != ':') return false;
+      port = authority.substr(bracket + 2);
+    }
+  } else {
+    const size_t colon = authority.rfind(':');
+    url->host = std::string(authority.substr(0, colon));
+    if (colon != std::string_view::npos) port = authority.substr(colon + 1);
+  }
+  if (url->host.empty()) return false;
+
+  url->port = url->scheme == "https" ? 443 : 80;
+  if (!port.empty()) {
+    unsigned long value = 0;
+    for (char c : port) {
+      if (c < '0' || c > '9') return false;
+      value = value * 10 + static_cast<unsigned long>(c - '0');
+      if (value > 65535) return false;
+    }
+    if (value == 0) return false;
+    url->port = static_cast<uint16_t>(value);
+  }
+
+  const size_t fragment = text.find('#', authority_end);
+  url->target = text.substr(authority_end, fragment == std::string::npos
+                                               ? std::string::npos
+                                               : fragment - authority_end);
+  if (url->target.empty() || url->target.front() != '/') {
+    url->target.insert(0, "/");
+  }
+  return true;
+}
+
+std::string Url::Authority() const {
+  std::string authority =
+      host.find(':') == std::string::npos ? host : "[" + host + "]";
+  if (port != (scheme == "https" ? 443 : 80)) {
+    authority += ':' + std::to_string(port);
+  }
+  return authority;
+}
+
+std::string Url::Path() const { return target.substr(0, target.find('?')); }
+
+std::string ResolveUrl(const std::string& base, const std::string& reference) {
+  const std::string_view ref(reference);
+  if (SchemeLength(ref) != 0) return reference;
+
+  const size_t base_scheme = SchemeLength(base);
+  const std::string_view scheme = std::string_view(base).substr(0, base_scheme);
+  if (ref.substr(0, 2) == "//") return std::string(scheme) + reference;
+
+  // The base split into scheme + authority and path; its query only
+  // survives a "?..." reference, its fragment never does.
+  const std::string_view without_fragment =
+      std::string_view(base).substr(0, base.find('#'));
+  size_t path_start = base_scheme;
+  if (without_fragment.substr(base_scheme, 2) == "//") {
+    path_start = without_fragment.find_first_of("/?", base_scheme + 2);
+    if (path_start == std::string_view::npos) {
+      path_start = without_fragment.size();
+    }
+  }
+  const std::string_view prefix = without_fragment.substr(0, path_start);
+  const size_t query_start = without_fragment.find('?', path_start);
+  const std::string_view base_path = without_fragment.substr(
+      path_start, query_start == std::string_view::npos
+                      ? std::string_view::npos
+                      : query_start - path_start);
+
+  if (ref.empty()) return std::string(without_fragment);
+  if (ref.front() == '#') return std::string(without_fragment) + reference;
+  if (ref.front() == '?') {
+    return std::string(prefix) + std::string(base_path) + reference;
+  }
+
+  const size_t ref_path_end = ref.find_first_of("?#");
+  const std::string_view ref_path = ref.substr(0, ref_path_end);
+  const std::string_view ref_rest =
+      ref_path_end == std::string_view::npos ? std::string_view()
+                                             : ref.substr(ref_path_end);
+  std::string merged;
+  if (ref_path.front() == '/') {
+    merged = std::string(ref_path);
+  } else {
+    const size_t slash = base_path.rfind('/');
+    merged = slash == std::string_view::npos
+                 ? "/" + std::string(ref_path)
+                 : std::string(base_path.substr(0, slash + 1)) +
+                       std::string(ref_path);
+  }
+  return std::string(prefix) + RemoveDotSegments(merged) +
+         std::string(ref_rest);
+}
+
+std::string PercentDecode(std::string_view text, bool plus_is_space) {
+  std::string decoded;
+  decoded.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '%' && i + 2 < text.size()) {
+      const int high = HexValue(text[i + 1]);
+      const int low = HexValue(text[i + 2]);
+      if (high >= 0 && low >= 0) {
+        decoded += static_cast<char>(high * 16 + low);
+        i += 2;
+        continue;
+      }
+    }
+    decoded += plus_is_space && c == '+' ? ' ' : c;
+  }
+  return decoded;
+}
+
+std::string EncodeUriComponent(std::string_view text) {
+  static const char kHex[] = "0123456789ABCDEF";
+  std::string encoded;
+  encoded.reserve(text.size() * 3);
+  for (char c : text) {
+    const unsigned char byte = static_cast<unsigned char>(c);
+    const bool unreserved =
+        (byte >= 'A' && byte <= 'Z') || (byte >= 'a' && byte <= 'z') ||
+        (byte >= '0' && byte <= '9') || byte == '-' || byte == '_' ||
+        byte == '.' || byte == '!' || byte == '~' || byte == '*' ||
+        byte == '\'' || byte == '(' || byte == ')';
+    if (unreserved) {
+      encoded += c;
+    } else {
+      encoded += '%';
+      encoded += kHex[byte >> 4];
+      encoded += kHex[byte & 15];
+    }
+  }
+  return encoded;
+}
+
+bool FindQueryParameter(std::string_view target, std::string_view name,
+                        std::string* value) {
+  const size_t question = target.find('?');
+  if (question == std::string_view::npos) return false;
+  std::string_view query = target.substr(question + 1);
+  query = query.substr(0, query.find('#'));
+
+  // As with Dart's Uri.queryParameters, the last occurrence wins.
+  bool found = false;
+  while (!query.empty()) {
+    const size_t amp = query.find('&');
+    const std::string_view pair = query.substr(0, amp);
+    query = amp == std::string_view::npos ? std::string_view()
+                                          : query.substr(amp + 1);
+    const size_t equals = pair.find('=');
+    if (PercentDecode(pair.substr(0, equals), true) != name) continue;
+    *value = equals == std::string_view::npos
+                 ? std::string()
+                 : PercentDecode(pair.substr(equals + 1), true);
+    found = true;
+  }
+  return found;
+}
+
+const std::string* HttpHeaders::Find(std::string_view name) const {
+  for (const Field& field : fields_) {
+    if (EqualsIgnoreCase(field.first, name)) return &field.second;
+  }
+  return nullptr;
+}
+
+void HttpHeaders::Set(std::string_view name, std::string value) {
+  bool replaced = false;
+  for (auto it = fields_.begin(); it != fields_.end();) {
+    if (!EqualsIgnoreCase(it->first, name)) {
+      ++it;
+    } else if (!replaced) {
+      it->first = std::string(name);
+      it->second = std::move(value);
+      replaced = true;
+      ++it;
+    } else {
+      it = fields_.erase(it);
+    }
+  }
+  if (!replaced) fields_.emplace_back(std::string(name), std::move(value));
+}
+
+void HttpHeaders::Add(std::string name, std::string value) {
+  fields_.emplace_back(std::move(name), std::move(value));
+}
+
+void HttpHeaders::Remove(std::string_view name) {
+  for (auto it = fields_.begin(); it != fields_.end();) {
+    it = EqualsIgnoreCase(it->first, name) ? fields_.erase(it) : it + 1;
+  }
+}
+
+void HttpHeaders::AppendTo(std::string* head) const {
+  for (const Field& field : fields_) {
+    *head += field.first;
+    *head += ": ";
+    *head += field.second;
+    *head += "\r\n";
+  }
+}
+
+// static
+bool HttpRequestHead::Parse(std::string_view head, HttpRequestHead* request) {
+  std::string_view line;
+  if (!ParseFields(head, &line, &request->headers)) return false;
+  const size_t first_space = line.find(' ');
+  const size_t second_space = line.find(' ', first_space + 1);
+  if (first_space == std::string_view::npos ||
+      second_space == std::string_view::npos) {
+    return false;
+  }
+  request->method = std::string(line.substr(0, first_space));
+  request->target = std::string(
+      line.substr(first_space + 1, second_space - first_space - 1));
+  const std::string_view version = line.substr(second_space + 1);
+  if (version.substr(0, 5) != "HTTP/") return false;
+  request->keep_alive = version == "HTTP/1.1";
+  if (const std::string* connection = request->headers.Find("connection")) {
+    const std::string tokens = ToLowerAscii(*connection);
+    if (tokens.find("close") != std::string::npos) {
+      request->keep_alive = false;
+    } else if (tokens.find("keep-alive") != std::string::npos) {
+      request->keep_alive = true;
+    }
+  }
+  return true;
+}
+
+// static
+bool HttpResponseHead::Parse(std::string_view head,
+                             HttpResponseHead* response) {
+  std::string_view line;
+  if (!ParseFields(head, &line, &response->headers)) return false;
+  // "HTTP/1.1 206 Partial Content"; the reason phrase may be empty.
+  if (line.substr(0, 5) != "HTTP/" || line.size() < 12 || line[8] != ' ') {
+    return false;
+  }
+  int status = 0;
+  for (size_t i = 9; i < 12; ++i) {
+    if (line[i] < '0' || line[i] > '9') return false;
+    status = status * 10 + (line[i] - '0');
+  }
+  response->status = status;
+  return true;
+}
+
+const char* ReasonPhrase(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 206: return "Partial Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 416: return "Range Not Satisfiable";
+    case 500: return "Internal Server Error";
+    case 502: return "Bad Gateway";
+    case 503: return "Service Unavailable";
+    case 504: return "Gateway Timeout";
+    default: return "Unknown";
+  }
+}
+
+}  // namespace cyrene_music
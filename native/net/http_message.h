@@ -0,0 +1,90 @@
+#ifndef NATIVE_NET_HTTP_MESSAGE_H_
+#define NATIVE_NET_HTTP_MESSAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cyrene_music {
+
+// ASCII case-insensitive comparison, as for header names and schemes.
+bool EqualsIgnoreCase(std::string_view a, std::string_view b);
+std::string ToLowerAscii(std::string_view text);
+
+// An absolute http:// or https:// URL, split for a request.
+struct Url {
+  std::string scheme;  // "http" or "https"
+  std::string host;    // without the brackets of an IPv6 literal
+  uint16_t port = 0;
+  std::string target;  // path and query, at least "/"
+
+  static bool Parse(const std::string& text, Url* url);
+
+  // The Host header: the port only when it is not the scheme's default.
+  std::string Authority() const;
+  // |target| without the query.
+  std::string Path() const;
+};
+
+// |reference| resolved against the absolute |base| (RFC 3986 section 5.2,
+// what Dart's Uri.resolve does), e.g. a redirect's Location or a playlist
+// entry.
+std::string ResolveUrl(const std::string& base, const std::string& reference);
+
+// %XX escapes undone; with |plus_is_space|, '+' too, as in query values.
+std::string PercentDecode(std::string_view text, bool plus_is_space);
+// Everything but A-Z a-z 0-9 - _ . ! ~ * ' ( ) escaped as UTF-8 %XX, like
+// Dart's Uri.encodeComponent.
+std::string EncodeUriComponent(std::string_view text);
+// The decoded value of |name| in the query of |target|; false if absent.
+bool FindQueryParameter(std::string_view target, std::string_view name,
+                        std::string* value);
+
+// Header fields in arrival order. Names compare case-insensitively.
+class HttpHeaders {
+ public:
+  using Field = std::pair<std::string, std::string>;
+
+  // nullptr if there is no field named |name|.
+  const std::string* Find(std::string_view name) const;
+  // Replaces every field named |name| with one holding |value|, in the
+  // place of the first.
+  void Set(std::string_view name, std::string value);
+  void Add(std::string name, std::string value);
+  void Remove(std::string_view name);
+
+  const std::vector<Field>& fields() const { return fields_; }
+  // "Name: value\r\n" per field.
+  void AppendTo(std::string* head) const;
+
+ private:
+  std::vector<Field> fields_;
+};
+
+// A request head up to (not including) the blank line.
+struct HttpRequestHead {
+  std::string method;
+  std::string target;
+  HttpHeaders headers;
+  // HTTP/1.1 unless "Connection: close", HTTP/1.0 only with keep-alive.
+  bool keep_alive = true;
+
+  static bool Parse(std::string_view head, HttpRequestHead* request);
+};
+
+// A response head up to (not including) the blank line.
+struct HttpResponseHead {
+  int status = 0;
+  HttpHeaders headers;
+
+  static bool Parse(std::string_view head, HttpResponseHead* response);
+};
+
+// The standard reason phrase for |status|, or "Unknown".
+const char* ReasonPhrase(int status);
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_HTTP_MESSAGE_H_
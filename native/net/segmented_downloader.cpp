@@ -0,0 +1,793 @@
+#include "net/segmented_downloader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+
+#include "cache/random_access_file.h"
+#include "net/http_connection.h"
+#include "net/socket.h"
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Per read and write; a segment is never split closer than this to where
+// its connection is writing.
+constexpr size_t kReadSize = 256 * 1024;
+constexpr uint32_t kStateMagic = 0x4C445943;  // "CYDL"
+constexpr uint32_t kStateVersion = 1;
+// Bounds the state file and how finely the tail is split.
+constexpr size_t kMaxSegments = 256;
+constexpr std::chrono::milliseconds kRetryDelay(500);
+
+std::string PartPath(const std::string& path) { return path + ".part"; }
+std::string StatePath(const std::string& path) { return path + ".part.state"; }
+
+struct Segment {
+  uint64_t start = 0;
+  // Exclusive; lowered when the segment is split.
+  uint64_t end = 0;
+  // [start, written) is in the file.
+  uint64_t written = 0;
+  // A connection is fetching it.
+  bool active = false;
+};
+
+struct SavedState {
+  uint64_t total = 0;
+  std::string validator;
+  std::vector<Segment> segments;
+};
+
+uint32_t Fnv1a(const uint8_t* data, size_t size) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < size; ++i) {
+    hash = (hash ^ data[i]) * 16777619u;
+  }
+  return hash;
+}
+
+template <typename T>
+void Append(std::vector<uint8_t>* out, T value) {
+  uint8_t bytes[sizeof(T)];
+  std::memcpy(bytes, &value, sizeof(T));
+  out->insert(out->end(), bytes, bytes + sizeof(T));
+}
+
+// Reads a T at *offset, advancing it; false past the end.
+template <typename T>
+bool Take(const std::vector<uint8_t>& in, size_t* offset, T* value) {
+  if (in.size() - *offset < sizeof(T)) return false;
+  std::memcpy(value, in.data() + *offset, sizeof(T));
+  *offset += sizeof(T);
+  return true;
+}
+
+// Written next to the data and renamed into place, so a crash leaves
+// either the old state or the new one. Native byte order: it never leaves
+// the machine.
+bool SaveState(const std::string& path, const SavedState& state) {
+  std::vector<uint8_t> out;
+  Append(&out, kStateMagic);
+  Append(&out, kStateVersion);
+  Append(&out, state.total);
+  Append(&out, static_cast<uint32_t>(state.validator.size()));
+  out.insert(out.end(), state.validator.begin(), state.validator.end());
+  Append(&out, static_cast<uint32_t>(state.segments.size()));
+  for (const Segment& segment : state.segments) {
+    Append(&out, segment.start);
+    Append(&out, segment.end);
+    Append(&out, segment.written);
+  }
+  Append(&out, Fnv1a(out.data(), out.size()));
+
+  const std::string temporary = path + ".tmp";
+  RandomAccessFile file;
+  if (!file.Open(temporary, RandomAccessFile::Mode::kCreate) ||
+      !file.WriteAt(0, out.data(), out.size())) {
+    return false;
+  }
+  file.Close();
+  return RandomAccessFile::Rename(temporary, path);
+}
+
+// false if there is no state or it is damaged or inconsistent.
+bool LoadState(const std::string& path, SavedState* state) {
+  RandomAccessFile file;
+  if (!file.Open(path, RandomAccessFile::Mode::kOpen)) return false;
+  const uint64_t size = file.Size();
+  if (size < 4 || size > 64 * 1024) return false;
+  std::vector<uint8_t> in(static_cast<size_t>(size));
+  if (!file.ReadAt(0, in.data(), in.size())) return false;
+  uint32_t checksum;
+  std::memcpy(&checksum, in.data() + in.size() - 4, 4);
+  if (Fnv1a(in.data(), in.size() - 4) != checksum) return false;
+  in.resize(in.size() - 4);
+
+  size_t offset = 0;
+  uint32_t magic = 0;
+  uint32_t version = 0;
+  uint32_t validator_size = 0;
+  uint32_t count = 0;
+  if (!Take(in, &offset, &magic) || magic != kStateMagic ||
+      !Take(in, &offset, &version) || version != kStateVersion ||
+      !Take(in, &offset, &state->total) ||
+      !Take(in, &offset, &validator_size) ||
+      in.size() - offset < validator_size) {
+    return false;
+  }
+  state->validator.assign(reinterpret_cast<const char*>(in.data() + offset),
+                          validator_size);
+  offset += validator_size;
+  if (!Take(in, &offset, &count) || count == 0 || count > kMaxSegments) {
+    return false;
+  }
+
+  // The segments must tile [0, total) in order.
+  state->segments.clear();
+  uint64_t next = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    Segment segment;
+    if (!Take(in, &offset, &segment.start) ||
+        !Take(in, &offset, &segment.end) ||
+        !Take(in, &offset, &segment.written) || segment.start != next ||
+        segment.end <= segment.start || segment.written < segment.start ||
+        segment.written > segment.end) {
+      return false;
+    }
+    next = segment.end;
+    state->segments.push_back(segment);
+  }
+  return next == state->total && offset == in.size();
+}
+
+// "bytes <first>-<last>/<total>"; false for anything else, including an
+// unknown total.
+bool ParseContentRange(const std::string& value, uint64_t* first,
+                       uint64_t* total) {
+  const char* text = value.c_str();
+  if (std::strncmp(text, "bytes ", 6) != 0) return false;
+  char* end = nullptr;
+  *first = std::strtoull(text + 6, &end, 10);
+  if (*end != '-') return false;
+  std::strtoull(end + 1, &end, 10);
+  if (*end != '/') return false;
+  const char* total_text = end + 1;
+  *total = std::strtoull(total_text, &end, 10);
+  return end != total_text && *end == '\0' && *total > 0;
+}
+
+// What identifies this version of the file: a strong ETag, else
+// Last-Modified, else nothing (then only the size has to match). Weak
+// ETags promise equivalent content, not the same bytes.
+std::string Validator(const HttpHeaders& headers) {
+  const std::string* etag = headers.Find("etag");
+  if (etag != nullptr && !etag->empty() && etag->compare(0, 2, "W/") != 0) {
+    return *etag;
+  }
+  const std::string* modified = headers.Find("last-modified");
+  return modified != nullptr ? *modified : std::string();
+}
+
+}  // namespace
+
+class SegmentedDownloader::Job {
+ public:
+  Job(SegmentedDownloader* owner, int64_t id, DownloadOptions options)
+      : owner_(owner), id_(id), options_(std::move(options)) {
+    // Never more segments than a state file loads back.
+    options_.connections =
+        std::clamp<size_t>(options_.connections, 1, kMaxSegments);
+    // A split must land past the block its connection is writing.
+    options_.min_segment_size =
+        std::max<uint64_t>(options_.min_segment_size, kReadSize);
+    options_.headers.Set("Accept-Encoding", "identity");
+    thread_ = std::thread(&Job::Run, this);
+  }
+
+  ~Job() {
+    Cancel();
+    Join();
+  }
+
+  Job(const Job&) = delete;
+  Job& operator=(const Job&) = delete;
+
+  void Cancel() {
+    cancelled_.store(true);
+    Stop();
+  }
+
+  void Join() {
+    if (thread_.joinable()) thread_.join();
+  }
+
+  bool finished() const { return finished_.load(); }
+
+ private:
+  void Run() {
+    ScopedThreadRole role(ThreadRole::kBackground);
+    std::string error = Download();
+    // Whatever broke after a cancel was the cancel; a download that
+    // completed anyway stays complete.
+    if (!error.empty() && cancelled_.load()) error = "Cancelled";
+
+    DownloadEvent event;
+    event.id = id_;
+    event.received = received_.load();
+    event.total = total_;
+    event.done = true;
+    event.error = std::move(error);
+    event.resumed = resumed_;
+    event.connections = connections_;
+    // Before the post, so a download started in response is accepted.
+    finished_.store(true);
+    owner_->Post(std::move(event));
+  }
+
+  // Empty on success.
+  std::string Download() {
+    const std::string state_path = StatePath(options_.path);
+    SavedState saved;
+    bool resuming = LoadState(state_path, &saved) &&
+                    file_.Open(PartPath(options_.path),
+                               RandomAccessFile::Mode::kOpen) &&
+                    file_.Size() == saved.total;
+
+    uint64_t probe_from = 0;
+    if (resuming) {
+      const auto pending = std::find_if(
+          saved.segments.begin(), saved.segments.end(),
+          [](const Segment& segment) { return segment.written < segment.end; });
+      // Everything arrived but the rename did not happen.
+      if (pending == saved.segments.end()) {
+        total_ = saved.total;
+        received_.store(total_);
+        resumed_ = total_;
+        return Finish();
+      }
+      probe_from = pending->written;
+    }
+
+    // The probe asks for everything from the first missing byte, and its
+    // response carries the first segment.
+    std::string error;
+    auto probe = std::make_unique<HttpConnection>();
+    if (!OpenRange(probe.get(), options_.url, probe_from, 0, &error)) {
+      return error;
+    }
+    url_ = probe->url();
+
+    uint64_t first = 0;
+    const std::string* content_range = probe->headers().Find("content-range");
+    const bool ranged =
+        probe->status() == 206 && content_range != nullptr &&
+        ParseContentRange(*content_range, &first, &total_) &&
+        first == probe_from;
+    if (!ranged) {
+      if (probe->status() != 200 && probe->status() != 206) {
+        return "HTTP " + std::to_string(probe->status());
+      }
+      if (probe_from != 0) {
+        // A resume the server answered with something else: start over.
+        Release(&probe);
+        file_.Close();
+        Discard(options_.path);
+        return Download();
+      }
+      return DownloadSingle(std::move(probe));
+    }
+
+    const std::string validator = Validator(probe->headers());
+    if (resuming &&
+        (saved.total != total_ || saved.validator != validator)) {
+      // The file changed since the last run.
+      Release(&probe);
+      file_.Close();
+      Discard(options_.path);
+      return Download();
+    }
+    validator_ = validator;
+
+    if (resuming) {
+      segments_ = std::move(saved.segments);
+    } else {
+      if (!file_.Open(PartPath(options_.path),
+                      RandomAccessFile::Mode::kCreate) ||
+          !file_.Allocate(total_)) {
+        return "Cannot create " + PartPath(options_.path);
+      }
+      const uint64_t count = std::clamp<uint64_t>(
+          total_ / options_.min_segment_size, 1,
+          std::min<uint64_t>(options_.connections, kMaxSegments));
+      for (uint64_t i = 0; i < count; ++i) {
+        Segment segment;
+        segment.start = total_ * i / count;
+        segment.end = total_ * (i + 1) / count;
+        segment.written = segment.start;
+        segments_.push_back(segment);
+      }
+    }
+    for (const Segment& segment : segments_) {
+      resumed_ += segment.written - segment.start;
+    }
+    received_.store(resumed_);
+    if (!SaveState(state_path, Snapshot())) {
+      return "Cannot write " + state_path;
+    }
+
+    // The probe's segment: the first one still missing bytes.
+    Segment& probe_segment = *std::find_if(
+        segments_.begin(), segments_.end(),
+        [probe_from](const Segment& segment) {
+          return segment.written == probe_from && segment.end > probe_from;
+        });
+    probe_segment.active = true;
+
+    const uint64_t left = total_ - resumed_;
+    connections_ = static_cast<uint32_t>(std::clamp<uint64_t>(
+        left / options_.min_segment_size, 1, options_.connections));
+    std::vector<std::thread> workers;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      active_workers_ = connections_;
+    }
+    workers.emplace_back(&Job::Work, this, std::move(probe), true,
+                         probe_segment.start);
+    for (uint32_t i = 1; i < connections_; ++i) {
+      workers.emplace_back(&Job::Work, this, nullptr, false, 0);
+    }
+
+    Clock::time_point reported = Clock::now();
+    Clock::time_point saved_at = reported;
+    uint64_t last_reported = received_.load();
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      while (active_workers_ > 0) {
+        wake_.wait_for(lock, options_.progress_interval);
+        lock.unlock();
+        const Clock::time_point now = Clock::now();
+        if (now - reported >= options_.progress_interval &&
+            received_.load() != last_reported) {
+          last_reported = received_.load();
+          reported = now;
+          PostProgress();
+        }
+        if (now - saved_at >= options_.state_interval) {
+          saved_at = now;
+          Persist();
+        }
+        lock.lock();
+      }
+    }
+    for (std::thread& worker : workers) worker.join();
+
+    std::string failure;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      failure = error_;
+    }
+    if (!failure.empty() || cancelled_.load()) {
+      Persist();
+      return failure.empty() ? "Cancelled" : failure;
+    }
+    return Finish();
+  }
+
+  // A server without ranges: one plain GET into the file, nothing kept for
+  // resuming.
+  std::string DownloadSingle(std::unique_ptr<HttpConnection> connection) {
+    connections_ = 1;
+    RandomAccessFile::Remove(StatePath(options_.path));
+    total_ = connection->framing() == HttpConnection::Framing::kLength
+                 ? connection->content_length()
+                 : 0;
+    if (!file_.Open(PartPath(options_.path), RandomAccessFile::Mode::kCreate) ||
+        (total_ > 0 && !file_.Allocate(total_))) {
+      Release(&connection);
+      return "Cannot create " + PartPath(options_.path);
+    }
+
+    std::vector<uint8_t> buffer(kReadSize);
+    uint64_t written = 0;
+    Clock::time_point reported = Clock::now();
+    std::string error;
+    for (;;) {
+      const ptrdiff_t n = connection->Read(buffer.data(), buffer.size());
+      if (n == 0) break;
+      if (n < 0 || stop_.load()) {
+        if (!cancelled_.load()) error = "Connection failed";
+        break;
+      }
+      if (!file_.WriteAt(written, buffer.data(), static_cast<size_t>(n))) {
+        error = "Cannot write " + PartPath(options_.path);
+        break;
+      }
+      written += static_cast<uint64_t>(n);
+      received_.store(written);
+      const Clock::time_point now = Clock::now();
+      if (now - reported >= options_.progress_interval) {
+        reported = now;
+        PostProgress();
+      }
+    }
+    Release(&connection);
+    if (!error.empty() || cancelled_.load()) {
+      file_.Close();
+      RandomAccessFile::Remove(PartPath(options_.path));
+      return error.empty() ? "Cancelled" : error;
+    }
+    if (total_ == 0) {
+      total_ = written;
+      file_.Truncate(written);
+    }
+    return Finish();
+  }
+
+  // Flushes the data and moves it into place.
+  std::string Finish() {
+    file_.Sync();
+    file_.Close();
+    if (!RandomAccessFile::Rename(PartPath(options_.path), options_.path)) {
+      return "Cannot rename to " + options_.path;
+    }
+    RandomAccessFile::Remove(StatePath(options_.path));
+    return std::string();
+  }
+
+  // One connection: fetches segments (splitting others once its own are
+  // done) until none is left or the download stops. Starts on the segment
+  // at |start| if |assigned|.
+  void Work(std::unique_ptr<HttpConnection> connection, bool assigned,
+            uint64_t start) {
+    ScopedThreadRole role(ThreadRole::kBackground);
+    std::vector<uint8_t> buffer(kReadSize);
+    while (assigned || NextSegment(&start)) {
+      assigned = false;
+      std::string error;
+      if (!FetchSegment(start, &connection, &buffer, &error)) {
+        Fail(error);
+        break;
+      }
+    }
+    Release(&connection);
+    std::lock_guard<std::mutex> lock(mutex_);
+    --active_workers_;
+    wake_.notify_all();
+  }
+
+  // Claims a segment nobody is fetching, or else splits the active one
+  // with the most left and claims its upper half; false if there is
+  // neither. Segments are known by their start, which never changes.
+  bool NextSegment(uint64_t* start) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (stop_.load()) return false;
+    for (Segment& segment : segments_) {
+      if (!segment.active && segment.written < segment.end) {
+        segment.active = true;
+        *start = segment.start;
+        return true;
+      }
+    }
+
+    int busiest = -1;
+    uint64_t most_left = 0;
+    for (size_t i = 0; i < segments_.size(); ++i) {
+      const Segment& segment = segments_[i];
+      const uint64_t left = segment.end - segment.written;
+      if (segment.active && left > most_left) {
+        busiest = static_cast<int>(i);
+        most_left = left;
+      }
+    }
+    if (busiest < 0 || most_left < 2 * options_.min_segment_size ||
+        segments_.size() >= kMaxSegments) {
+      return false;
+    }
+    Segment& victim = segments_[static_cast<size_t>(busiest)];
+    Segment split;
+    split.start = victim.written + most_left / 2;
+    split.end = victim.end;
+    split.written = split.start;
+    split.active = true;
+    victim.end = split.start;
+    // Kept in file order, which Find() and the state file expect.
+    segments_.insert(segments_.begin() + busiest + 1, split);
+    *start = split.start;
+    return true;
+  }
+
+  // Fills the segment at |start|, reconnecting after dropped connections.
+  // false, with *error set, once it gives up; true when the segment is
+  // complete or the download stops.
+  bool FetchSegment(uint64_t start, std::unique_ptr<HttpConnection>* connection,
+                    std::vector<uint8_t>* buffer, std::string* error) {
+    int failures = 0;
+    for (;;) {
+      if (stop_.load()) return true;
+      uint64_t from;
+      uint64_t end;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Segment& segment = Find(start);
+        from = segment.written;
+        end = segment.end;
+        if (from >= end) {
+          segment.active = false;
+          return true;
+        }
+      }
+
+      if (!*connection) {
+        *connection = std::make_unique<HttpConnection>();
+        if (!OpenRange(connection->get(), url_, from, end, error)) {
+          Release(connection);
+          if (stop_.load()) return true;
+          if (++failures > options_.retries) return false;
+          std::unique_lock<std::mutex> lock(mutex_);
+          wake_.wait_for(lock, kRetryDelay * failures,
+                         [this] { return stop_.load(); });
+          continue;
+        }
+      }
+
+      const uint64_t before = from;
+      const bool complete = Pump(start, connection->get(), buffer, error);
+      Release(connection);
+      if (complete) continue;
+      if (stop_.load()) return true;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        // A connection that made progress before dropping starts the
+        // count again.
+        if (Find(start).written > before) failures = 0;
+      }
+      if (++failures > options_.retries) return false;
+    }
+  }
+
+  // Copies the response body into the segment starting at |start| until
+  // its end; false, with *error set, if the connection ends first.
+  bool Pump(uint64_t start, HttpConnection* connection,
+            std::vector<uint8_t>* buffer, std::string* error) {
+    for (;;) {
+      if (stop_.load()) return false;
+      uint64_t at;
+      uint64_t end;
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        const Segment& segment = Find(start);
+        at = segment.written;
+        end = segment.end;
+      }
+      if (at >= end) return true;
+      // The end only moves down to a split at least kReadSize past |at|.
+      const size_t want =
+          static_cast<size_t>(std::min<uint64_t>(buffer->size(), end - at));
+      const ptrdiff_t n = connection->Read(buffer->data(), want);
+      if (n <= 0) {
+        *error = n == 0 ? "Connection closed early" : "Connection failed";
+        return false;
+      }
+      if (!file_.WriteAt(at, buffer->data(), static_cast<size_t>(n))) {
+        // Not worth retrying.
+        *error = "Cannot write " + PartPath(options_.path);
+        Fail(*error);
+        return false;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Find(start).written += static_cast<uint64_t>(n);
+      }
+      received_.fetch_add(static_cast<uint64_t>(n));
+    }
+  }
+
+  // The segment starting at |start|. Under mutex_ once workers run.
+  Segment& Find(uint64_t start) {
+    return *std::lower_bound(
+        segments_.begin(), segments_.end(), start,
+        [](const Segment& segment, uint64_t value) {
+          return segment.start < value;
+        });
+  }
+
+  // GETs [from, end) of |url| (to the end of the file if |end| is 0) and
+  // checks the server sent that range of the same file.
+  bool OpenRange(HttpConnection* connection, const std::string& url,
+                 uint64_t from, uint64_t end, std::string* error) {
+    HttpHeaders headers = options_.headers;
+    std::string range = "bytes=" + std::to_string(from) + "-";
+    if (end > 0) range += std::to_string(end - 1);
+    headers.Set("Range", std::move(range));
+    if (!connection->Open("GET", url, headers, options_.timeout_seconds,
+                          error)) {
+      return false;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (stop_.load()) {
+        *error = "Cancelled";
+        return false;
+      }
+      sockets_.push_back(connection->socket());
+    }
+    // The probe (end 0) is checked by the caller.
+    if (end == 0) return true;
+    uint64_t first = 0;
+    uint64_t total = 0;
+    const std::string* content_range =
+        connection->headers().Find("content-range");
+    if (connection->status() != 206 || content_range == nullptr ||
+        !ParseContentRange(*content_range, &first, &total) || first != from ||
+        total != total_ || Validator(connection->headers()) != validator_) {
+      *error = "Range not honoured (HTTP " +
+               std::to_string(connection->status()) + ")";
+      return false;
+    }
+    return true;
+  }
+
+  // Closes |connection| and forgets its socket.
+  void Release(std::unique_ptr<HttpConnection>* connection) {
+    if (!*connection) return;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const intptr_t socket = (*connection)->socket();
+      sockets_.erase(std::remove(sockets_.begin(), sockets_.end(), socket),
+                     sockets_.end());
+    }
+    connection->reset();
+  }
+
+  // Stops every connection; the first error is the download's.
+  void Fail(const std::string& error) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error_.empty()) error_ = error;
+    }
+    Stop();
+  }
+
+  void Stop() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_.store(true);
+    // Blocked reads fail at once instead of running into the timeout.
+    for (const intptr_t socket : sockets_) ShutdownSocket(ToHandle(socket));
+    wake_.notify_all();
+  }
+
+  SavedState Snapshot() {
+    SavedState state;
+    state.total = total_;
+    state.validator = validator_;
+    std::lock_guard<std::mutex> lock(mutex_);
+    state.segments = segments_;
+    return state;
+  }
+
+  // The progress so far, made durable: the data is flushed after the
+  // snapshot is taken, so the state never claims bytes the file lacks.
+  void Persist() {
+    const SavedState state = Snapshot();
+    if (file_.is_open()) file_.Sync();
+    SaveState(StatePath(options_.path), state);
+  }
+
+  void PostProgress() {
+    DownloadEvent event;
+    event.id = id_;
+    event.received = received_.load();
+    event.total = total_;
+    event.resumed = resumed_;
+    event.connections = connections_;
+    owner_->Post(std::move(event));
+  }
+
+  SegmentedDownloader* const owner_;
+  const int64_t id_;
+  DownloadOptions options_;
+  std::thread thread_;
+  std::atomic<bool> cancelled_{false};
+  // Cancelled or failed: connections stop and no segment is started.
+  std::atomic<bool> stop_{false};
+  std::atomic<bool> finished_{false};
+
+  // Set before the workers start.
+  RandomAccessFile file_;
+  std::string url_;
+  uint64_t total_ = 0;
+  std::string validator_;
+  uint64_t resumed_ = 0;
+  uint32_t connections_ = 0;
+  std::atomic<uint64_t> received_{0};
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  // In file order.
+  std::vector<Segment> segments_;
+  std::vector<intptr_t> sockets_;
+  std::string error_;
+  uint32_t active_workers_ = 0;
+};
+
+SegmentedDownloader::SegmentedDownloader() { InitSockets(); }
+
+SegmentedDownloader::~SegmentedDownloader() {
+  std::lock_guard<std::mutex> lock(jobs_mutex_);
+  for (auto& [id, job] : jobs_) job->Cancel();
+  jobs_.clear();
+}
+
+bool SegmentedDownloader::Start(int64_t id, DownloadOptions options) {
+  std::lock_guard<std::mutex> lock(jobs_mutex_);
+  for (auto it = jobs_.begin(); it != jobs_.end();) {
+    if (it->second->finished()) {
+      it = jobs_.erase(it);
+    } else if (it->first == id) {
+      return false;
+    } else {
+      ++it;
+    }
+  }
+  jobs_.emplace(id, std::make_unique<Job>(this, id, std::move(options)));
+  return true;
+}
+
+void SegmentedDownloader::Cancel(int64_t id) {
+  std::lock_guard<std::mutex> lock(jobs_mutex_);
+  const auto it = jobs_.find(id);
+  if (it != jobs_.end()) it->second->Cancel();
+}
+
+void SegmentedDownloader::Wait(int64_t id) {
+  std::lock_guard<std::mutex> lock(jobs_mutex_);
+  const auto it = jobs_.find(id);
+  if (it != jobs_.end()) it->second->Join();
+}
+
+void SegmentedDownloader::SetNotify(std::function<void()> notify) {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  notify_ = std::move(notify);
+}
+
+std::vector<DownloadEvent> SegmentedDownloader::TakeEvents() {
+  std::lock_guard<std::mutex> lock(pending_mutex_);
+  std::vector<DownloadEvent> pending;
+  pending.swap(pending_);
+  return pending;
+}
+
+// static
+void SegmentedDownloader::Discard(const std::string& path) {
+  RandomAccessFile::Remove(PartPath(path));
+  RandomAccessFile::Remove(StatePath(path));
+}
+
+void SegmentedDownloader::Post(DownloadEvent event) {
+  std::function<void()> notify;
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex_);
+    const auto stale = std::find_if(
+        pending_.begin(), pending_.end(), [&event](const DownloadEvent& e) {
+          return e.id == event.id && !e.done;
+        });
+    if (stale != pending_.end() && !event.done) {
+      *stale = std::move(event);
+    } else {
+      pending_.push_back(std::move(event));
+    }
+    notify = notify_;
+  }
+  if (notify) notify();
+}
+
+}  // namespace cyrene_music
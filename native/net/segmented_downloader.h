@@ -0,0 +1,117 @@
+#ifndef NATIVE_NET_SEGMENTED_DOWNLOADER_H_
+#define NATIVE_NET_SEGMENTED_DOWNLOADER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "net/http_message.h"
+
+namespace cyrene_music {
+
+struct DownloadOptions {
+  std::string url;
+  // The finished file, UTF-8. Until it is complete the data lives in
+  // "<path>.part" and the segment progress in "<path>.part.state".
+  std::string path;
+  // Sent with every request; Host, Connection and Range are replaced.
+  HttpHeaders headers;
+  // Range requests in flight at most.
+  size_t connections = 4;
+  // Files smaller than two of these are fetched on one connection, and a
+  // segment is only split for an idle connection while it has at least two
+  // of these left.
+  uint64_t min_segment_size = 1024 * 1024;
+  // Progress events for a download are at least this far apart.
+  std::chrono::milliseconds progress_interval{200};
+  // How often the segment progress is made durable for resuming.
+  std::chrono::milliseconds state_interval{1000};
+  int timeout_seconds = 20;
+  // Attempts per segment after a dropped or failed connection.
+  int retries = 3;
+};
+
+struct DownloadEvent {
+  int64_t id = 0;
+  // Bytes in the file so far, including any resumed from an earlier run.
+  uint64_t received = 0;
+  // 0 while the size is unknown.
+  uint64_t total = 0;
+  // Set on the last event of a download; |error| is empty on success.
+  bool done = false;
+  std::string error;
+  // Bytes that were already on disk when this run started.
+  uint64_t resumed = 0;
+  // Connections the file was split across (1 without range support).
+  uint32_t connections = 0;
+};
+
+// Downloads files as concurrent Range segments written straight into a
+// preallocated "<path>.part", for DownloadService. The first request both
+// probes the server (size, range support, ETag/Last-Modified) and carries
+// the first segment, so a small file costs one round trip.
+//
+// Every connection owns one segment at a time; one that finishes early
+// splits the segment with the most left and takes its upper half, so a
+// slow connection never holds up the tail. Segment progress is written to
+// "<path>.part.state" (after the data it describes is flushed) every
+// state_interval, on failure and on Cancel(); starting the same path again
+// resumes from it as long as the server still reports the same size and
+// validator, otherwise the file starts over. A server without range
+// support gets a single plain GET and nothing is resumed.
+//
+// Each download runs on its own threads. Events are queued for the runner
+// to take on its own thread with TakeEvents(), at most one progress event
+// per download per progress_interval; the notify callback (run on a
+// download thread) tells it when to look.
+class SegmentedDownloader {
+ public:
+  SegmentedDownloader();
+  // Cancels every download and waits for them.
+  ~SegmentedDownloader();
+
+  SegmentedDownloader(const SegmentedDownloader&) = delete;
+  SegmentedDownloader& operator=(const SegmentedDownloader&) = delete;
+
+  // False if a download with |id| is still running.
+  bool Start(int64_t id, DownloadOptions options);
+  // Stops the download, keeping what it has for a later Start(); it still
+  // ends with a done event. Connections being opened finish their connect
+  // timeout first.
+  void Cancel(int64_t id);
+  // Blocks until download |id|, if running, has posted its last event.
+  void Wait(int64_t id);
+
+  // Runs after events have been queued; nullptr to stop notifying. Must
+  // not block.
+  void SetNotify(std::function<void()> notify);
+  // Everything queued so far, oldest first.
+  std::vector<DownloadEvent> TakeEvents();
+
+  // Deletes what an interrupted download of |path| left behind.
+  static void Discard(const std::string& path);
+
+ private:
+  class Job;
+
+  // Posts |event|, replacing a progress event of the same download that
+  // has not been taken yet.
+  void Post(DownloadEvent event);
+
+  std::mutex jobs_mutex_;
+  std::map<int64_t, std::unique_ptr<Job>> jobs_;
+
+  std::mutex pending_mutex_;
+  std::vector<DownloadEvent> pending_;
+  std::function<void()> notify_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_SEGMENTED_DOWNLOADER_H_
@@ -0,0 +1,107 @@
+#ifndef NATIVE_NET_SOCKET_H_
+#define NATIVE_NET_SOCKET_H_
+
+#include <cerrno>
+#include <cstdint>
+
+#if defined(_WIN32)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace cyrene_music {
+
+// The few BSD socket calls that differ between Winsock and POSIX, for the
+// HTTP client and the stream proxy. Sockets cross module boundaries as
+// intptr_t so headers need not include the platform's socket headers.
+#if defined(_WIN32)
+using SocketHandle = SOCKET;
+constexpr SocketHandle kInvalidSocket = INVALID_SOCKET;
+inline void CloseSocket(SocketHandle s) { closesocket(s); }
+inline void ShutdownSocket(SocketHandle s) { shutdown(s, SD_BOTH); }
+inline bool LastErrorWouldBlock() {
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+inline bool LastErrorInProgress() {
+  return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+inline bool SetBlocking(SocketHandle s, bool blocking) {
+  u_long non_blocking = blocking ? 0 : 1;
+  return ioctlsocket(s, FIONBIO, &non_blocking) == 0;
+}
+constexpr int kSendFlags = 0;
+#else
+using SocketHandle = int;
+constexpr SocketHandle kInvalidSocket = -1;
+inline void CloseSocket(SocketHandle s) { close(s); }
+inline void ShutdownSocket(SocketHandle s) { shutdown(s, SHUT_RDWR); }
+inline bool LastErrorWouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+inline bool LastErrorInProgress() { return errno == EINPROGRESS; }
+inline bool SetBlocking(SocketHandle s, bool blocking) {
+  const int flags = fcntl(s, F_GETFL, 0);
+  return flags >= 0 &&
+         fcntl(s, F_SETFL,
+               blocking ? flags & ~O_NONBLOCK : flags | O_NONBLOCK) == 0;
+}
+// A peer that has gone away must not kill the process with SIGPIPE.
+constexpr int kSendFlags = MSG_NOSIGNAL;
+#endif
+
+// poll() over sockets; WSAPoll on Windows.
+inline int PollSockets(pollfd* fds, size_t count, int timeout_ms) {
+#if defined(_WIN32)
+  return WSAPoll(fds, static_cast<ULONG>(count), timeout_ms);
+#else
+  return poll(fds, static_cast<nfds_t>(count), timeout_ms);
+#endif
+}
+
+inline SocketHandle ToHandle(intptr_t s) { return static_cast<SocketHandle>(s); }
+
+// Once per process on Windows; false if Winsock cannot be used.
+inline bool InitSockets() {
+#if defined(_WIN32)
+  static const bool ready = [] {
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+  }();
+  return ready;
+#else
+  return true;
+#endif
+}
+
+// Bounds every blocking recv()/send() on |s|; 0 removes the bound.
+inline void SetSocketTimeouts(SocketHandle s, int seconds) {
+#if defined(_WIN32)
+  const DWORD timeout = static_cast<DWORD>(seconds) * 1000;
+#else
+  timeval timeout = {};
+  timeout.tv_sec = seconds;
+#endif
+  setsockopt(s, SOL_SOCKET, SO_RCVTIMEO,
+             reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+  setsockopt(s, SOL_SOCKET, SO_SNDTIMEO,
+             reinterpret_cast<const char*>(&timeout), sizeof(timeout));
+}
+
+inline void SetNoDelay(SocketHandle s) {
+  const int no_delay = 1;
+  setsockopt(s, IPPROTO_TCP, TCP_NODELAY,
+             reinterpret_cast<const char*>(&no_delay), sizeof(no_delay));
+}
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_SOCKET_H_
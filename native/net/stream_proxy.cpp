@@ -0,0 +1,985 @@
+#include "net/stream_proxy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "net/http_connection.h"
+#include "net/socket.h"
+#include "net/transport.h"
+#include "thread/thread_role.h"
+
+#if !defined(_WIN32)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace cyrene_music {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kMaxRequestHead = 16 * 1024;
+constexpr size_t kMaxPlaylist = 4 * 1024 * 1024;
+// Per relay step; also the most a Linux pipe holds by default.
+constexpr size_t kRelayBlock = 64 * 1024;
+// Relay steps one connection gets before the others have their turn.
+constexpr int kRelayRounds = 16;
+constexpr int kUpstreamTimeoutSeconds = 30;
+// A player that has buffered enough may sit on a keep-alive connection
+// for a while before its next range request.
+constexpr auto kIdleTimeout = std::chrono::seconds(60);
+// A response that moves no byte either way for this long is dropped: the
+// upstream stalled, or the player stopped reading without closing. A
+// paused player that comes back asks again with a range request.
+constexpr auto kStallTimeout = std::chrono::seconds(60);
+constexpr int kSweepIntervalMs = 5000;
+// Body length for a response that ends when the upstream closes.
+constexpr uint64_t kUntilClose = UINT64_MAX;
+
+const char kQqUserAgent[] =
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/114.0.0.0 Safari/537.36 lx-music-desktop/2.12.0";
+const char kChromeUserAgent[] =
+    "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, "
+    "like Gecko) Chrome/121.0.0.0 Safari/537.36";
+const char kSafariUserAgent[] =
+    "Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 "
+    "(KHTML, like Gecko) Version/17.5 Safari/605.1.15";
+
+// Readiness of one socket, from Poller::Wait().
+struct PollEvent {
+  SocketHandle socket;
+  bool readable;
+  bool writable;
+  // Error, reset, or the peer has closed its side.
+  bool hangup;
+};
+
+// Level-triggered readiness for the loop's sockets. Watch() with neither
+// direction still reports a hang-up; Forget() stops all reports.
+#if defined(_WIN32)
+
+class Poller {
+ public:
+  bool Init() { return true; }
+
+  void Watch(SocketHandle s, bool read, bool write) {
+    const SHORT events = static_cast<SHORT>((read ? POLLRDNORM : 0) |
+                                            (write ? POLLWRNORM : 0));
+    const auto it = index_.find(s);
+    if (it != index_.end()) {
+      fds_[it->second].events = events;
+      return;
+    }
+    index_[s] = fds_.size();
+    WSAPOLLFD entry = {};
+    entry.fd = s;
+    entry.events = events;
+    fds_.push_back(entry);
+  }
+
+  void Forget(SocketHandle s) {
+    const auto it = index_.find(s);
+    if (it == index_.end()) return;
+    const size_t i = it->second;
+    index_.erase(it);
+    if (i + 1 != fds_.size()) {
+      fds_[i] = fds_.back();
+      index_[fds_[i].fd] = i;
+    }
+    fds_.pop_back();
+  }
+
+  void Wait(int timeout_ms, std::vector<PollEvent>* events) {
+    events->clear();
+    if (WSAPoll(fds_.data(), static_cast<ULONG>(fds_.size()), timeout_ms) <=
+        0) {
+      return;
+    }
+    for (const WSAPOLLFD& fd : fds_) {
+      if (fd.revents == 0) continue;
+      events->push_back({fd.fd, (fd.revents & POLLRDNORM) != 0,
+                         (fd.revents & POLLWRNORM) != 0,
+                         (fd.revents & (POLLERR | POLLHUP | POLLNVAL)) != 0});
+    }
+  }
+
+ private:
+  std::vector<WSAPOLLFD> fds_;
+  std::unordered_map<SocketHandle, size_t> index_;
+};
+
+#else
+
+class Poller {
+ public:
+  ~Poller() {
+    if (epoll_ >= 0) close(epoll_);
+  }
+
+  bool Init() {
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    return epoll_ >= 0;
+  }
+
+  void Watch(int s, bool read, bool write) {
+    epoll_event event = {};
+    event.events = EPOLLRDHUP | (read ? EPOLLIN : 0u) | (write ? EPOLLOUT : 0u);
+    event.data.fd = s;
+    if (epoll_ctl(epoll_, EPOLL_CTL_MOD, s, &event) != 0 && errno == ENOENT) {
+      epoll_ctl(epoll_, EPOLL_CTL_ADD, s, &event);
+    }
+  }
+
+  void Forget(int s) { epoll_ctl(epoll_, EPOLL_CTL_DEL, s, nullptr); }
+
+  void Wait(int timeout_ms, std::vector<PollEvent>* events) {
+    epoll_event ready[64];
+    const int n = epoll_wait(epoll_, ready, 64, timeout_ms);
+    events->clear();
+    for (int i = 0; i < n; ++i) {
+      const uint32_t bits = ready[i].events;
+      events->push_back({ready[i].data.fd, (bits & EPOLLIN) != 0,
+                         (bits & EPOLLOUT) != 0,
+                         (bits & (EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0});
+    }
+  }
+
+ private:
+  int epoll_ = -1;
+};
+
+#endif
+
+// What an upstream request produced, for the loop to send.
+struct DialResult {
+  uint64_t connection = 0;
+  // The response head and the first body bytes (the part read along with
+  // the upstream head, a rewritten playlist or an error text).
+  std::string out;
+  // The rest of the body, relayed undecoded; null if |out| is everything.
+  std::unique_ptr<Transport> upstream;
+  uint64_t remaining = 0;
+  bool keep_alive = true;
+};
+
+// Finished upstream requests, shared with the threads making them, which
+// may outlive a stopped proxy; its wake-up handle lives as long.
+class DialQueue {
+ public:
+  ~DialQueue() {
+    if (wake_ != kInvalidSocket) CloseSocket(wake_);
+  }
+
+  bool Init() {
+#if defined(_WIN32)
+    // A datagram socket connected to itself: WSAPoll only takes sockets.
+    wake_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wake_ == kInvalidSocket) return false;
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int length = sizeof(address);
+    return bind(wake_, reinterpret_cast<const sockaddr*>(&address),
+                sizeof(address)) == 0 &&
+           getsockname(wake_, reinterpret_cast<sockaddr*>(&address),
+                       &length) == 0 &&
+           connect(wake_, reinterpret_cast<const sockaddr*>(&address),
+                   sizeof(address)) == 0 &&
+           SetBlocking(wake_, false);
+#else
+    wake_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    return wake_ >= 0;
+#endif
+  }
+
+  SocketHandle wake_socket() const { return wake_; }
+
+  void Wake() {
+#if defined(_WIN32)
+    send(wake_, "w", 1, 0);
+#else
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t n = write(wake_, &one, sizeof(one));
+#endif
+  }
+
+  // From any thread; dropped once the proxy has stopped.
+  void Post(DialResult result) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (closed_) return;
+      done_.push_back(std::move(result));
+    }
+    Wake();
+  }
+
+  std::vector<DialResult> Take() {
+#if defined(_WIN32)
+    char drain[64];
+    while (recv(wake_, drain, sizeof(drain), 0) > 0) {
+    }
+#else
+    uint64_t count = 0;
+    [[maybe_unused]] const ssize_t n = read(wake_, &count, sizeof(count));
+#endif
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::vector<DialResult> done;
+    done.swap(done_);
+    return done;
+  }
+
+  void Close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    done_.clear();
+  }
+
+ private:
+  SocketHandle wake_ = kInvalidSocket;
+  std::mutex mutex_;
+  std::vector<DialResult> done_;
+  bool closed_ = false;
+};
+
+struct Connection {
+  enum class State {
+    kReadingRequest,
+    kDialing,
+    kSending,   // |out|
+    kRelaying,  // the upstream body
+  };
+
+  uint64_t id = 0;
+  SocketHandle client = kInvalidSocket;
+  State state = State::kReadingRequest;
+  Clock::time_point idle_since;
+  // Last byte sent or relayed while in kSending / kRelaying.
+  Clock::time_point last_progress;
+  std::string in;
+  std::string out;
+  size_t out_offset = 0;
+  bool keep_alive = true;
+
+  std::unique_ptr<Transport> upstream;
+  uint64_t remaining = 0;
+  // Relayed bytes read but not yet sent: buffer[buffer_offset, +buffered),
+  // or |piped| bytes in the pipe when splicing.
+  std::vector<char> buffer;
+  size_t buffer_offset = 0;
+  size_t buffered = 0;
+#if !defined(_WIN32)
+  bool splice = false;
+  int pipe[2] = {-1, -1};
+  size_t piped = 0;
+#endif
+
+  ~Connection() {
+#if !defined(_WIN32)
+    if (pipe[0] >= 0) close(pipe[0]);
+    if (pipe[1] >= 0) close(pipe[1]);
+#endif
+  }
+};
+
+std::string Trim(const std::string& text) {
+  const size_t first = text.find_first_not_of(" \t\r\n");
+  if (first == std::string::npos) return std::string();
+  return text.substr(first, text.find_last_not_of(" \t\r\n") - first + 1);
+}
+
+bool EndsWith(const std::string& text, const char* suffix) {
+  const size_t length = std::char_traits<char>::length(suffix);
+  return text.size() >= length &&
+         text.compare(text.size() - length, length, suffix) == 0;
+}
+
+std::string ResponseHead(int status, const HttpHeaders& fields,
+                         bool keep_alive) {
+  std::string head = "HTTP/1.1 " + std::to_string(status) + " " +
+                     ReasonPhrase(status) + "\r\n";
+  fields.AppendTo(&head);
+  head += keep_alive ? "Connection: keep-alive\r\n\r\n"
+                     : "Connection: close\r\n\r\n";
+  return head;
+}
+
+std::string TextResponse(int status, const std::string& text,
+                         bool keep_alive) {
+  HttpHeaders fields;
+  fields.Add("Content-Type", "text/plain; charset=utf-8");
+  fields.Add("Content-Length", std::to_string(text.size()));
+  return ResponseHead(status, fields, keep_alive) + text;
+}
+
+// The player's request forwarded upstream, answered the way ProxyService's
+// handler did. Blocking; runs on a dial thread.
+DialResult Forward(const HttpRequestHead& request, const std::string& url,
+                   const std::string& platform, uint16_t port) {
+  DialResult result;
+  result.keep_alive = request.keep_alive;
+
+  HttpConnection upstream;
+  std::string error;
+  if (!upstream.Open(request.method,
+                     url, StreamProxy::UpstreamHeaders(request.headers,
+                                                       platform),
+                     kUpstreamTimeoutSeconds, &error)) {
+    result.out = TextResponse(500, "Proxy error: " + error, result.keep_alive);
+    return result;
+  }
+
+  const int status = upstream.status();
+  const HttpHeaders& headers = upstream.headers();
+  const std::string* content_type = headers.Find("content-type");
+  const std::string* content_length = headers.Find("content-length");
+  const std::string* content_range = headers.Find("content-range");
+  HttpHeaders fields;
+
+  if (request.method == "HEAD") {
+    if (content_type != nullptr) fields.Add("Content-Type", *content_type);
+    const std::string* accept_ranges = headers.Find("accept-ranges");
+    fields.Add("Accept-Ranges",
+               accept_ranges != nullptr ? *accept_ranges : "bytes");
+    fields.Add("Cache-Control", "no-cache");
+    if (content_length != nullptr) {
+      fields.Add("Content-Length", *content_length);
+    }
+    if (content_range != nullptr) fields.Add("Content-Range", *content_range);
+    result.out = ResponseHead(status, fields, result.keep_alive);
+    return result;
+  }
+
+  if (status != 200 && status != 206) {
+    result.out = TextResponse(
+        status, "Upstream server error: " + std::to_string(status),
+        result.keep_alive);
+    return result;
+  }
+
+  Url parsed;
+  const std::string type =
+      content_type != nullptr ? ToLowerAscii(*content_type) : std::string();
+  const bool playlist =
+      (Url::Parse(url, &parsed) &&
+       EndsWith(ToLowerAscii(parsed.Path()), ".m3u8")) ||
+      type.find("mpegurl") != std::string::npos;
+  if (playlist) {
+    // Segment and key URLs must come through the proxy too, or the CDN's
+    // header checks fail on them.
+    std::string body;
+    if (!upstream.ReadAll(&body, kMaxPlaylist)) {
+      result.out = TextResponse(500, "Proxy error: cannot read playlist",
+                                result.keep_alive);
+      return result;
+    }
+    const std::string rewritten = StreamProxy::RewritePlaylist(
+        body, upstream.url(), platform, port);
+    fields.Add("Content-Type", content_type != nullptr
+                                   ? *content_type
+                                   : "application/vnd.apple.mpegurl");
+    fields.Add("Cache-Control", "no-cache");
+    fields.Add("Content-Length", std::to_string(rewritten.size()));
+    result.out = ResponseHead(200, fields, result.keep_alive) + rewritten;
+    return result;
+  }
+
+  fields.Add("Content-Type",
+             content_type != nullptr ? *content_type : "audio/mpeg");
+  fields.Add("Accept-Ranges", "bytes");
+  fields.Add("Cache-Control", "no-cache");
+  if (content_length != nullptr) fields.Add("Content-Length", *content_length);
+  if (status == 206 && content_range != nullptr) {
+    fields.Add("Content-Range", *content_range);
+  }
+  std::string buffered = upstream.TakeBuffered();
+  switch (upstream.framing()) {
+    case HttpConnection::Framing::kLength:
+      buffered.resize(static_cast<size_t>(
+          std::min<uint64_t>(buffered.size(), upstream.content_length())));
+      result.remaining = upstream.content_length() - buffered.size();
+      break;
+    case HttpConnection::Framing::kChunked:
+      // Passed through as is; the upstream closes after the last chunk.
+      fields.Add("Transfer-Encoding", "chunked");
+      result.remaining = kUntilClose;
+      result.keep_alive = false;
+      break;
+    case HttpConnection::Framing::kUntilClose:
+      result.remaining = kUntilClose;
+      result.keep_alive = false;
+      break;
+    case HttpConnection::Framing::kNone:
+      break;
+  }
+  result.out = ResponseHead(status, fields, result.keep_alive) + buffered;
+  if (result.remaining != 0) result.upstream = upstream.TakeTransport();
+  return result;
+}
+
+void Dial(std::shared_ptr<DialQueue> queue, uint64_t connection,
+          HttpRequestHead request, std::string url, std::string platform,
+          uint16_t port) {
+  DialResult result = Forward(request, url, platform, port);
+  result.connection = connection;
+  queue->Post(std::move(result));
+}
+
+}  // namespace
+
+struct StreamProxy::Loop {
+  Poller poller;
+  SocketHandle listener = kInvalidSocket;
+  uint16_t port = 0;
+  std::shared_ptr<DialQueue> dials = std::make_shared<DialQueue>();
+  std::unordered_map<uint64_t, std::unique_ptr<Connection>> connections;
+  // Every socket of a connection: the connection, and whether it is the
+  // upstream side.
+  std::unordered_map<SocketHandle, std::pair<Connection*, bool>> sockets;
+  // Relaying connections that ran out of rounds, to continue without
+  // waiting for readiness.
+  std::vector<uint64_t> ready;
+  uint64_t next_id = 1;
+
+  ~Loop();
+
+  void Accept();
+  void OnClient(Connection* c, const PollEvent& event);
+  void ReadRequest(Connection* c);
+  void Dispatch(Connection* c);
+  void Deliver(DialResult result);
+  void Send(Connection* c, std::string out);
+  void Flush(Connection* c);
+  void Pump(Connection* c);
+  // Relay steps: bytes moved, 0 (end of stream, for reads only),
+  // Transport::kWouldBlock or Transport::kFailed.
+  ptrdiff_t SendRelayed(Connection* c);
+  ptrdiff_t ReadUpstream(Connection* c);
+  void Finish(Connection* c);
+  void Close(Connection* c);
+  void Sweep(Clock::time_point now);
+};
+
+StreamProxy::Loop::~Loop() {
+  for (auto& entry : connections) {
+    CloseSocket(entry.second->client);
+  }
+  connections.clear();
+  if (listener != kInvalidSocket) CloseSocket(listener);
+  dials->Close();
+}
+
+void StreamProxy::Loop::Accept() {
+  for (;;) {
+    const SocketHandle s = accept(listener, nullptr, nullptr);
+    if (s == kInvalidSocket) return;
+    if (!SetBlocking(s, false)) {
+      CloseSocket(s);
+      continue;
+    }
+    SetNoDelay(s);
+    auto connection = std::make_unique<Connection>();
+    connection->id = next_id++;
+    connection->client = s;
+    connection->idle_since = Clock::now();
+    sockets[s] = {connection.get(), false};
+    poller.Watch(s, true, false);
+    connections[connection->id] = std::move(connection);
+  }
+}
+
+void StreamProxy::Loop::OnClient(Connection* c, const PollEvent& event) {
+  if (event.hangup) {
+    Close(c);
+    return;
+  }
+  switch (c->state) {
+    case Connection::State::kReadingRequest:
+      if (event.readable) ReadRequest(c);
+      break;
+    case Connection::State::kSending:
+      if (event.writable) Flush(c);
+      break;
+    case Connection::State::kRelaying:
+      if (event.writable) Pump(c);
+      break;
+    case Connection::State::kDialing:
+      break;
+  }
+}
+
+void StreamProxy::Loop::ReadRequest(Connection* c) {
+  char chunk[4096];
+  for (;;) {
+    const auto n = recv(c->client, chunk, sizeof(chunk), 0);
+    if (n > 0) {
+      c->in.append(chunk, static_cast<size_t>(n));
+      if (c->in.size() > kMaxRequestHead) break;
+      continue;
+    }
+    if (n < 0 && LastErrorWouldBlock()) break;
+    Close(c);
+    return;
+  }
+  if (c->in.find("\r\n\r\n") != std::string::npos) {
+    Dispatch(c);
+  } else if (c->in.size() > kMaxRequestHead) {
+    Close(c);
+  }
+}
+
+void StreamProxy::Loop::Dispatch(Connection* c) {
+  const size_t head_end = c->in.find("\r\n\r\n");
+  HttpRequestHead request;
+  const bool parsed = HttpRequestHead::Parse(
+      std::string_view(c->in).substr(0, head_end), &request);
+  c->in.erase(0, head_end + 4);
+  if (!parsed) {
+    c->keep_alive = false;
+    Send(c, TextResponse(400, "Bad Request", false));
+    return;
+  }
+  c->keep_alive = request.keep_alive;
+  for (char& ch : request.method) {
+    if (ch >= 'a' && ch <= 'z') ch = static_cast<char>(ch - 'a' + 'A');
+  }
+  if (request.method != "GET" && request.method != "HEAD") {
+    Send(c, TextResponse(405, "Method Not Allowed", c->keep_alive));
+    return;
+  }
+  std::string url;
+  FindQueryParameter(request.target, "url", &url);
+  url = Trim(url);
+  if (url.empty()) {
+    Send(c, TextResponse(400, "Missing url parameter", c->keep_alive));
+    return;
+  }
+  std::string platform;
+  if (!FindQueryParameter(request.target, "platform", &platform)) {
+    platform = "qq";
+  }
+
+  c->state = Connection::State::kDialing;
+  poller.Watch(c->client, false, false);
+  std::thread(Dial, dials, c->id, std::move(request), std::move(url),
+              std::move(platform), port)
+      .detach();
+}
+
+void StreamProxy::Loop::Deliver(DialResult result) {
+  const auto it = connections.find(result.connection);
+  // The player gave up while the upstream was being asked.
+  if (it == connections.end()) return;
+  Connection* c = it->second.get();
+  c->keep_alive = result.keep_alive;
+  c->remaining = result.remaining;
+  c->upstream = std::move(result.upstream);
+  if (c->upstream) {
+    const SocketHandle s = ToHandle(c->upstream->socket());
+    SetBlocking(s, false);
+    sockets[s] = {c, true};
+#if !defined(_WIN32)
+    c->splice = c->upstream->plain() &&
+                (c->pipe[0] >= 0 || pipe2(c->pipe, O_NONBLOCK | O_CLOEXEC) == 0);
+#endif
+  }
+  Send(c, std::move(result.out));
+}
+
+void StreamProxy::Loop::Send(Connection* c, std::string out) {
+  c->state = Connection::State::kSending;
+  c->out = std::move(out);
+  c->out_offset = 0;
+  c->last_progress = Clock::now();
+  Flush(c);
+}
+
+void StreamProxy::Loop::Flush(Connection* c) {
+  while (c->out_offset < c->out.size()) {
+    const int chunk =
+        static_cast<int>(std::min<size_t>(c->out.size() - c->out_offset,
+                                          1 << 20));
+    const auto n =
+        send(c->client, c->out.data() + c->out_offset, chunk, kSendFlags);
+    if (n > 0) {
+      c->out_offset += static_cast<size_t>(n);
+      c->last_progress = Clock::now();
+      continue;
+    }
+    if (n < 0 && LastErrorWouldBlock()) {
+      poller.Watch(c->client, false, true);
+      return;
+    }
+    Close(c);
+    return;
+  }
+  c->out.clear();
+  c->out_offset = 0;
+  if (c->upstream) {
+    c->state = Connection::State::kRelaying;
+    Pump(c);
+  } else {
+    Finish(c);
+  }
+}
+
+ptrdiff_t StreamProxy::Loop::SendRelayed(Connection* c) {
+#if !defined(_WIN32)
+  if (c->splice) {
+    const ssize_t n = splice(c->pipe[0], nullptr, c->client, nullptr, c->piped,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n > 0) {
+      c->piped -= static_cast<size_t>(n);
+      return n;
+    }
+    return n < 0 && errno == EAGAIN ? Transport::kWouldBlock
+                                    : Transport::kFailed;
+  }
+#endif
+  const auto n = send(c->client, c->buffer.data() + c->buffer_offset,
+                      static_cast<int>(c->buffered), kSendFlags);
+  if (n > 0) {
+    c->buffer_offset += static_cast<size_t>(n);
+    c->buffered -= static_cast<size_t>(n);
+    return n;
+  }
+  return n < 0 && LastErrorWouldBlock() ? Transport::kWouldBlock
+                                        : Transport::kFailed;
+}
+
+ptrdiff_t StreamProxy::Loop::ReadUpstream(Connection* c) {
+  const size_t want =
+      static_cast<size_t>(std::min<uint64_t>(kRelayBlock, c->remaining));
+#if !defined(_WIN32)
+  if (c->splice) {
+    const ssize_t n =
+        splice(static_cast<int>(c->upstream->socket()), nullptr, c->pipe[1],
+               nullptr, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n >= 0) {
+      c->piped = static_cast<size_t>(n);
+      return n;
+    }
+    return errno == EAGAIN ? Transport::kWouldBlock : Transport::kFailed;
+  }
+#endif
+  if (c->buffer.empty()) c->buffer.resize(kRelayBlock);
+  const ptrdiff_t n = c->upstream->Read(c->buffer.data(), want);
+  if (n > 0) {
+    c->buffer_offset = 0;
+    c->buffered = static_cast<size_t>(n);
+  }
+  return n;
+}
+
+void StreamProxy::Loop::Pump(Connection* c) {
+  const SocketHandle up = ToHandle(c->upstream->socket());
+  for (int round = 0; round < kRelayRounds; ++round) {
+#if !defined(_WIN32)
+    const bool pending = c->buffered > 0 || c->piped > 0;
+#else
+    const bool pending = c->buffered > 0;
+#endif
+    if (pending) {
+      const ptrdiff_t sent = SendRelayed(c);
+      if (sent == Transport::kWouldBlock) {
+        // Player backpressure: stop reading until it drains.
+        poller.Forget(up);
+        poller.Watch(c->client, false, true);
+        return;
+      }
+      if (sent < 0) {
+        Close(c);
+        return;
+      }
+      c->last_progress = Clock::now();
+      continue;
+    }
+    if (c->remaining == 0) {
+      Finish(c);
+      return;
+    }
+    const ptrdiff_t got = ReadUpstream(c);
+    if (got == Transport::kWouldBlock) {
+      poller.Watch(up, true, false);
+      poller.Watch(c->client, false, false);
+      return;
+    }
+    if (got == 0 && c->remaining == kUntilClose) {
+      c->remaining = 0;
+      continue;
+    }
+    // Failed, or closed before the promised length.
+    if (got <= 0) {
+      Close(c);
+      return;
+    }
+    if (c->remaining != kUntilClose) {
+      c->remaining -= static_cast<uint64_t>(got);
+    }
+    c->last_progress = Clock::now();
+  }
+  ready.push_back(c->id);
+}
+
+void StreamProxy::Loop::Finish(Connection* c) {
+  if (c->upstream) {
+    const SocketHandle up = ToHandle(c->upstream->socket());
+    poller.Forget(up);
+    sockets.erase(up);
+    c->upstream.reset();
+  }
+  if (!c->keep_alive) {
+    Close(c);
+    return;
+  }
+  c->state = Connection::State::kReadingRequest;
+  c->idle_since = Clock::now();
+  poller.Watch(c->client, true, false);
+  if (c->in.find("\r\n\r\n") != std::string::npos) Dispatch(c);
+}
+
+void StreamProxy::Loop::Close(Connection* c) {
+  if (c->upstream) {
+    const SocketHandle up = ToHandle(c->upstream->socket());
+    poller.Forget(up);
+    sockets.erase(up);
+  }
+  poller.Forget(c->client);
+  sockets.erase(c->client);
+  CloseSocket(c->client);
+  // Destroys the connection, closing the upstream and any pipe.
+  connections.erase(c->id);
+}
+
+void StreamProxy::Loop::Sweep(Clock::time_point now) {
+  std::vector<Connection*> expired;
+  for (const auto& entry : connections) {
+    Connection* c = entry.second.get();
+    if (c->state == Connection::State::kReadingRequest &&
+        now - c->idle_since > kIdleTimeout) {
+      expired.push_back(c);
+    } else if ((c->state == Connection::State::kSending ||
+                c->state == Connection::State::kRelaying) &&
+               now - c->last_progress > kStallTimeout) {
+      expired.push_back(c);
+    }
+  }
+  for (Connection* c : expired) Close(c);
+}
+
+// static
+StreamProxy& StreamProxy::Shared() {
+  static StreamProxy proxy;
+  return proxy;
+}
+
+StreamProxy::StreamProxy() = default;
+
+StreamProxy::~StreamProxy() { Stop(); }
+
+uint16_t StreamProxy::Start(uint16_t first_port, uint16_t last_port) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (running_) return port_;
+  if (!InitSockets()) return 0;
+  auto loop = std::make_unique<Loop>();
+  if (!loop->poller.Init() || !loop->dials->Init()) return 0;
+
+  for (uint32_t port = first_port; port <= last_port; ++port) {
+    const SocketHandle s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (s == kInvalidSocket) return 0;
+#if !defined(_WIN32)
+    // Lets a restarted app take its port back from TIME_WAIT connections.
+    const int reuse = 1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+#endif
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(s, reinterpret_cast<const sockaddr*>(&address),
+             sizeof(address)) == 0 &&
+        listen(s, 64) == 0 && SetBlocking(s, false)) {
+      loop->listener = s;
+      loop->port = static_cast<uint16_t>(port);
+      break;
+    }
+    CloseSocket(s);
+  }
+  if (loop->listener == kInvalidSocket) return 0;
+
+  loop->poller.Watch(loop->listener, true, false);
+  loop->poller.Watch(loop->dials->wake_socket(), true, false);
+  port_ = loop->port;
+  loop_ = std::move(loop);
+  running_ = true;
+  thread_ = std::thread(&StreamProxy::Run, this);
+  return port_;
+}
+
+void StreamProxy::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!running_.exchange(false)) return;
+  loop_->dials->Wake();
+  thread_.join();
+  loop_.reset();
+  port_ = 0;
+}
+
+void StreamProxy::Run() {
+  // Started from the platform thread, which may hold kRender right now.
+  ResetThreadScheduling();
+  Loop& loop = *loop_;
+  std::vector<PollEvent> events;
+  Clock::time_point next_sweep =
+      Clock::now() + std::chrono::milliseconds(kSweepIntervalMs);
+  while (running_) {
+    loop.poller.Wait(loop.ready.empty() ? kSweepIntervalMs : 0, &events);
+    for (const PollEvent& event : events) {
+      if (event.socket == loop.listener) {
+        loop.Accept();
+        continue;
+      }
+      if (event.socket == loop.dials->wake_socket()) {
+        for (DialResult& result : loop.dials->Take()) {
+          loop.Deliver(std::move(result));
+        }
+        continue;
+      }
+      // Looked up per event: an earlier one may have closed it.
+      const auto it = loop.sockets.find(event.socket);
+      if (it == loop.sockets.end()) continue;
+      Connection* c = it->second.first;
+      if (!it->second.second) {
+        loop.OnClient(c, event);
+      } else if (c->state == Connection::State::kRelaying &&
+                 (event.readable || event.hangup)) {
+        // A closed upstream still has its last bytes to read.
+        loop.Pump(c);
+      }
+    }
+
+    std::vector<uint64_t> ready;
+    ready.swap(loop.ready);
+    for (uint64_t id : ready) {
+      const auto it = loop.connections.find(id);
+      if (it != loop.connections.end() &&
+          it->second->state == Connection::State::kRelaying) {
+        loop.Pump(it->second.get());
+      }
+    }
+
+    const Clock::time_point now = Clock::now();
+    if (now >= next_sweep) {
+      loop.Sweep(now);
+      next_sweep = now + std::chrono::milliseconds(kSweepIntervalMs);
+    }
+  }
+}
+
+// static
+HttpHeaders StreamProxy::UpstreamHeaders(const HttpHeaders& player_headers,
+                                         const std::string& platform) {
+  HttpHeaders headers;
+  for (const HttpHeaders::Field& field : player_headers.fields()) {
+    const std::string name = ToLowerAscii(field.first);
+    if (name != "host" && name != "connection" && name != "user-agent" &&
+        name != "referer" && name != "accept-encoding") {
+      headers.Add(field.first, field.second);
+    }
+  }
+  // Compressed audio would break the player's stream parsing.
+  headers.Set("Accept-Encoding", "identity");
+
+  if (platform == "qq") {
+    // QQ Music checks Origin and Referer strictly; this is the UA of
+    // lx-music-desktop, which it accepts.
+    headers.Set("User-Agent", kQqUserAgent);
+    headers.Set("Referer", "https://y.qq.com");
+    headers.Set("Origin", "https://y.qq.com");
+    headers.Set("Accept", "audio/*,*/*;q=0.9");
+    headers.Set("Accept-Language", "zh-CN,zh;q=0.9");
+  } else if (platform == "kugou") {
+    headers.Set("User-Agent", kChromeUserAgent);
+    headers.Set("Referer", "https://www.kugou.com");
+    headers.Set("Accept", "*/*");
+  } else if (platform == "apple") {
+    const std::string* language = player_headers.Find("accept-language");
+    headers.Set("User-Agent", kSafariUserAgent);
+    headers.Set("Referer", "https://music.apple.com");
+    headers.Set("Origin", "https://music.apple.com");
+    headers.Set("Accept", "audio/*,*/*;q=0.9");
+    headers.Set("Accept-Language",
+                language != nullptr
+                    ? *language
+                    : "zh-CN,zh;q=0.9,en;q=0.8,en-GB;q=0.7,en-US;q=0.6");
+    // ProxyService also asked for keep-alive; connections are one request
+    // each here, so HttpConnection sends "Connection: close" instead.
+    headers.Set("Cache-Control", "no-cache");
+    headers.Set("Pragma", "no-cache");
+  } else {
+    headers.Set("User-Agent", kChromeUserAgent);
+    headers.Set("Accept", "*/*");
+  }
+  return headers;
+}
+
+// static
+std::string StreamProxy::RewritePlaylist(const std::string& playlist,
+                                         const std::string& playlist_url,
+                                         const std::string& platform,
+                                         uint16_t port) {
+  std::string rewritten;
+  rewritten.reserve(playlist.size() * 2);
+  size_t start = 0;
+  for (bool first = true; start <= playlist.size(); first = false) {
+    size_t end = playlist.find('\n', start);
+    if (end == std::string::npos) end = playlist.size();
+    std::string line = playlist.substr(start, end - start);
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    start = end + 1;
+    if (!first) rewritten += '\n';
+
+    const std::string trimmed = Trim(line);
+    if (trimmed.empty()) {
+      rewritten += line;
+    } else if (trimmed.front() != '#') {
+      rewritten += ProxyUrl(ResolveUrl(playlist_url, trimmed), platform, port);
+    } else {
+      // Tags carry URIs as URI="..." (keys, maps, media renditions).
+      size_t from = 0;
+      size_t attribute;
+      while ((attribute = line.find("URI=\"", from)) != std::string::npos) {
+        const size_t value_start = attribute + 5;
+        const size_t value_end = line.find('"', value_start);
+        if (value_end == std::string::npos || value_end == value_start) {
+          break;
+        }
+        const std::string value =
+            line.substr(value_start, value_end - value_start);
+        if (value.rfind("skd://", 0) == 0) {
+          from = value_end + 1;
+          continue;
+        }
+        const std::string proxied =
+            ProxyUrl(ResolveUrl(playlist_url, value), platform, port);
+        line.replace(value_start, value.size(), proxied);
+        from = value_start + proxied.size() + 1;
+      }
+      rewritten += line;
+    }
+  }
+  return rewritten;
+}
+
+// static
+std::string StreamProxy::ProxyUrl(const std::string& url,
+                                  const std::string& platform, uint16_t port) {
+  return "http://localhost:" + std::to_string(port) +
+         "/proxy?url=" + EncodeUriComponent(url) + "&platform=" + platform;
+}
+
+}  // namespace cyrene_music
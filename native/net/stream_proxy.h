@@ -0,0 +1,85 @@
+#ifndef NATIVE_NET_STREAM_PROXY_H_
+#define NATIVE_NET_STREAM_PROXY_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "net/http_message.h"
+
+namespace cyrene_music {
+
+// Loopback reverse proxy for audio streams whose servers check request
+// headers (QQ Music, Kugou, Apple Music), standing in for ProxyService's
+// shelf server with the same contract: the player asks for
+// http://localhost:<port>/proxy?url=<encoded>&platform=<platform> and gets
+// the upstream response, fetched with that platform's User-Agent, Referer
+// and Origin. Range requests pass through; HLS playlists are rewritten so
+// their segments and keys come through the proxy too.
+//
+// One event-loop thread (epoll on Linux, WSAPoll on Windows) owns every
+// player connection: it reads requests and relays response bodies, spliced
+// through a pipe without a user-space copy on Linux when the upstream is
+// plain http. The blocking part of each request (resolving, connecting,
+// the TLS handshake, waiting for the upstream head) runs on a short-lived
+// thread of its own, so a slow CDN never holds up another stream. None of
+// it touches the Dart isolate.
+class StreamProxy {
+ public:
+  static StreamProxy& Shared();
+
+  StreamProxy();
+  ~StreamProxy();
+
+  StreamProxy(const StreamProxy&) = delete;
+  StreamProxy& operator=(const StreamProxy&) = delete;
+
+  // Listens on 127.0.0.1 at the first free port in [first_port,
+  // last_port] (ProxyService's range by default) and returns it; the
+  // current port if already running, 0 if no port is free.
+  uint16_t Start(uint16_t first_port = 8888, uint16_t last_port = 8897);
+
+  // Closes every player connection. Upstream requests still in flight
+  // finish on their own threads and are dropped.
+  void Stop();
+
+  uint16_t port() const { return port_; }
+
+  // ProxyService's rewriting rules: the player's headers minus Host,
+  // Connection, User-Agent, Referer and Accept-Encoding, an identity
+  // Accept-Encoding so audio is never compressed, then the headers
+  // |platform| ("qq", "kugou", "apple", anything else) expects.
+  static HttpHeaders UpstreamHeaders(const HttpHeaders& player_headers,
+                                     const std::string& platform);
+
+  // |playlist| (an m3u8 fetched from |playlist_url|) with every segment
+  // line and URI="..." attribute resolved and pointed at the proxy on
+  // |port|; skd:// key URIs are left alone.
+  static std::string RewritePlaylist(const std::string& playlist,
+                                     const std::string& playlist_url,
+                                     const std::string& platform,
+                                     uint16_t port);
+
+  // The proxy URL ProxyService.getProxyUrl builds for |url|.
+  static std::string ProxyUrl(const std::string& url,
+                              const std::string& platform, uint16_t port);
+
+ private:
+  struct Loop;
+
+  void Run();
+
+  std::mutex mutex_;  // Start() and Stop()
+  std::atomic<bool> running_{false};
+  uint16_t port_ = 0;
+  // The loop thread's state: listener, poller and connections.
+  std::unique_ptr<Loop> loop_;
+  std::thread thread_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_STREAM_PROXY_H_
@@ -0,0 +1,59 @@
+#include "net/transport.h"
+
+#include <algorithm>
+#include <atomic>
+
+#include "net/socket.h"
+
+namespace cyrene_music {
+
+namespace {
+
+std::atomic<TlsConnector*> g_tls_connector{nullptr};
+
+class PlainTransport : public Transport {
+ public:
+  explicit PlainTransport(SocketHandle s) : socket_(s) {}
+  ~PlainTransport() override { CloseSocket(socket_); }
+
+  ptrdiff_t Read(void* data, size_t size) override {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const auto n = recv(socket_, static_cast<char*>(data), chunk, 0);
+    if (n >= 0) return static_cast<ptrdiff_t>(n);
+    return LastErrorWouldBlock() ? kWouldBlock : kFailed;
+  }
+
+  bool Write(const void* data, size_t size) override {
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+      const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+      const auto n = send(socket_, bytes, chunk, kSendFlags);
+      if (n <= 0) return false;
+      bytes += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  intptr_t socket() const override { return static_cast<intptr_t>(socket_); }
+  bool plain() const override { return true; }
+
+ private:
+  const SocketHandle socket_;
+};
+
+}  // namespace
+
+std::unique_ptr<Transport> NewPlainTransport(intptr_t socket) {
+  return std::make_unique<PlainTransport>(ToHandle(socket));
+}
+
+void SetTlsConnector(TlsConnector* connector) {
+  g_tls_connector.store(connector, std::memory_order_release);
+}
+
+TlsConnector* GetTlsConnector() {
+  return g_tls_connector.load(std::memory_order_acquire);
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,64 @@
+#ifndef NATIVE_NET_TRANSPORT_H_
+#define NATIVE_NET_TRANSPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace cyrene_music {
+
+// A connected byte stream to an HTTP server: the socket itself for http://,
+// a TLS session over it for https://. Owns the socket.
+//
+// Whether calls block is the socket's mode: the HTTP client uses it
+// blocking (with timeouts), the stream proxy's event loop switches it to
+// non-blocking once the response head has been read. Only reads happen in
+// non-blocking mode.
+class Transport {
+ public:
+  // Read() results besides a byte count; 0 is the end of the stream.
+  static constexpr ptrdiff_t kWouldBlock = -1;
+  static constexpr ptrdiff_t kFailed = -2;
+
+  virtual ~Transport() = default;
+
+  virtual ptrdiff_t Read(void* data, size_t size) = 0;
+  // Writes all of |data|; false if the connection failed.
+  virtual bool Write(const void* data, size_t size) = 0;
+
+  // The socket underneath, to poll for readiness. A TLS transport may hold
+  // decrypted bytes the socket no longer signals, so read until
+  // kWouldBlock before waiting.
+  virtual intptr_t socket() const = 0;
+
+  // True if the socket carries the payload as is, so it can be spliced.
+  virtual bool plain() const { return false; }
+};
+
+// Takes ownership of a connected socket.
+std::unique_ptr<Transport> NewPlainTransport(intptr_t socket);
+
+// TLS for https:// URLs. The portable core has no TLS library of its own;
+// the runner installs its platform's (OpenSSL on Linux, Schannel on
+// Windows) with SetTlsConnector().
+class TlsConnector {
+ public:
+  virtual ~TlsConnector() = default;
+
+  // Runs the client handshake for |host| (SNI and certificate name) over
+  // the connected, blocking |socket|, taking ownership of it. nullptr, with
+  // the socket closed and *error set, if the handshake or verification
+  // fails. Called from any thread.
+  virtual std::unique_ptr<Transport> Connect(intptr_t socket,
+                                             const std::string& host,
+                                             std::string* error) = 0;
+};
+
+// |connector| must outlive every connection; nullptr makes https:// fail.
+void SetTlsConnector(TlsConnector* connector);
+TlsConnector* GetTlsConnector();
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_NET_TRANSPORT_H_
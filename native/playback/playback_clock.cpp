@@ -0,0 +1,104 @@
+#include "playback/playback_clock.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr int kMaxReadAttempts = 4;
+
+}  // namespace
+
+int64_t PlaybackSnapshot::PositionAt(int64_t now_us) const {
+  int64_t position = position_ms;
+  if (state == PlaybackState::kPlaying && now_us > anchor_us) {
+    position += static_cast<int64_t>(
+        std::llround((now_us - anchor_us) / 1000.0 * rate));
+  }
+  if (duration_ms > 0) position = std::min(position, duration_ms);
+  return std::max<int64_t>(position, 0);
+}
+
+// static
+PlaybackClock& PlaybackClock::Shared() {
+  static PlaybackClock clock;
+  return clock;
+}
+
+// static
+int64_t PlaybackClock::NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+PlaybackClock::PlaybackClock()
+    : sequence_(0),
+      position_ms_(0),
+      duration_ms_(0),
+      rate_(1.0),
+      state_(static_cast<int32_t>(PlaybackState::kStopped)),
+      anchor_us_(0) {}
+
+void PlaybackClock::Update(int64_t position_ms, int64_t duration_ms,
+                           double rate, PlaybackState state) {
+  const int64_t anchor_us = NowUs();
+  const uint64_t start = sequence_.load(std::memory_order_relaxed);
+  sequence_.store(start + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  position_ms_.store(position_ms, std::memory_order_relaxed);
+  duration_ms_.store(duration_ms, std::memory_order_relaxed);
+  rate_.store(rate > 0.0 ? rate : 1.0, std::memory_order_relaxed);
+  state_.store(static_cast<int32_t>(state), std::memory_order_relaxed);
+  anchor_us_.store(anchor_us, std::memory_order_relaxed);
+  sequence_.store(start + 2, std::memory_order_release);
+}
+
+bool PlaybackClock::Read(PlaybackSnapshot* out) const {
+  for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt) {
+    const uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before == 0) return false;
+    if (before & 1) continue;
+    out->position_ms = position_ms_.load(std::memory_order_relaxed);
+    out->duration_ms = duration_ms_.load(std::memory_order_relaxed);
+    out->rate = rate_.load(std::memory_order_relaxed);
+    out->state =
+        static_cast<PlaybackState>(state_.load(std::memory_order_relaxed));
+    out->anchor_us = anchor_us_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (sequence_.load(std::memory_order_relaxed) == before) {
+      out->sequence = before / 2;
+      return true;
+    }
+  }
+  return false;
+}
+
+int64_t PlaybackClock::PositionMs() const {
+  PlaybackSnapshot snapshot;
+  if (!Read(&snapshot)) return 0;
+  return snapshot.PositionAt(NowUs());
+}
+
+uint64_t PlaybackClock::sequence() const {
+  return sequence_.load(std::memory_order_acquire) / 2;
+}
+
+}  // namespace cyrene_music
+
+void cyrene_playback_clock_update(int64_t position_ms, int64_t duration_ms,
+                                  double rate, int32_t state) {
+  if (state < 0 || state > static_cast<int32_t>(cyrene_music::PlaybackState::kPaused)) {
+    state = static_cast<int32_t>(cyrene_music::PlaybackState::kStopped);
+  }
+  cyrene_music::PlaybackClock::Shared().Update(
+      position_ms, duration_ms, rate,
+      static_cast<cyrene_music::PlaybackState>(state));
+}
+
+int64_t cyrene_playback_clock_position_ms() {
+  return cyrene_music::PlaybackClock::Shared().PositionMs();
+}
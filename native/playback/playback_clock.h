@@ -0,0 +1,82 @@
+#ifndef NATIVE_PLAYBACK_PLAYBACK_CLOCK_H_
+#define NATIVE_PLAYBACK_PLAYBACK_CLOCK_H_
+
+#include <atomic>
+#include <cstdint>
+
+#include "ffi/export.h"
+
+namespace cyrene_music {
+
+// Matches the order of NativePlaybackState in native_playback_clock.dart.
+enum class PlaybackState : int32_t {
+  kStopped = 0,
+  kPlaying = 1,
+  kPaused = 2,
+};
+
+// One consistent reading of the clock.
+struct PlaybackSnapshot {
+  uint64_t sequence = 0;  // 0 until the player has written anything
+  int64_t position_ms = 0;
+  int64_t duration_ms = 0;
+  double rate = 1.0;
+  PlaybackState state = PlaybackState::kStopped;
+  int64_t anchor_us = 0;  // PlaybackClock::NowUs() when position_ms was taken
+
+  bool playing() const { return state == PlaybackState::kPlaying; }
+
+  // Position at |now_us|, advanced from the anchor while playing and
+  // clamped to the duration when it is known.
+  int64_t PositionAt(int64_t now_us) const;
+};
+
+// Playback position shared by the Dart player and native components (SMTC,
+// the desktop lyric overlay, the rhythm analyser), so they can extrapolate
+// the position locally instead of waiting for channel messages.
+//
+// The player writes it through the cyrene_playback_clock_update FFI leaf
+// call, which stamps the sample with the native monotonic clock, so readers
+// never compare Dart and native time bases. Single writer (the platform
+// thread), any number of readers on any thread: a seqlock over atomics.
+class PlaybackClock {
+ public:
+  static PlaybackClock& Shared();
+
+  // Monotonic microseconds, the time base of every anchor.
+  static int64_t NowUs();
+
+  PlaybackClock();
+
+  PlaybackClock(const PlaybackClock&) = delete;
+  PlaybackClock& operator=(const PlaybackClock&) = delete;
+
+  void Update(int64_t position_ms, int64_t duration_ms, double rate,
+              PlaybackState state);
+
+  // False if nothing has been written yet or every attempt raced a write.
+  bool Read(PlaybackSnapshot* out) const;
+
+  // Convenience: extrapolated position now, or 0 when unknown.
+  int64_t PositionMs() const;
+
+  uint64_t sequence() const;
+
+ private:
+  std::atomic<uint64_t> sequence_;
+  std::atomic<int64_t> position_ms_;
+  std::atomic<int64_t> duration_ms_;
+  std::atomic<double> rate_;
+  std::atomic<int32_t> state_;
+  std::atomic<int64_t> anchor_us_;
+};
+
+}  // namespace cyrene_music
+
+// FFI entry points, see lib/services/native_playback_clock.dart.
+CYRENE_FFI_EXPORT void cyrene_playback_clock_update(int64_t position_ms,
+                                                    int64_t duration_ms,
+                                                    double rate, int32_t state);
+CYRENE_FFI_EXPORT int64_t cyrene_playback_clock_position_ms();
+
+#endif  // NATIVE_PLAYBACK_PLAYBACK_CLOCK_H_
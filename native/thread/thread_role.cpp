@@ -0,0 +1,255 @@
+#include "thread/thread_role.h"
+
+#include <mutex>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <avrt.h>
+#include <timeapi.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#endif
+
+namespace cyrene_music {
+
+namespace {
+
+// Process-wide count of scopes that want fine-grained timers.
+std::mutex g_fine_timer_mutex;
+int g_fine_timer_holders = 0;
+
+bool WantsFineTimer(ThreadRole role) {
+  return role == ThreadRole::kRender || role == ThreadRole::kAudioCapture;
+}
+
+void AcquireFineTimer() {
+  std::lock_guard<std::mutex> lock(g_fine_timer_mutex);
+#if defined(_WIN32)
+  if (g_fine_timer_holders == 0) timeBeginPeriod(1);
+#endif
+  ++g_fine_timer_holders;
+}
+
+void ReleaseFineTimer() {
+  std::lock_guard<std::mutex> lock(g_fine_timer_mutex);
+  --g_fine_timer_holders;
+#if defined(_WIN32)
+  if (g_fine_timer_holders == 0) timeEndPeriod(1);
+#endif
+}
+
+#if !defined(_WIN32)
+
+// Nice values per role; lower runs first.
+constexpr int kRenderNice = -4;
+constexpr int kAudioCaptureNice = -11;
+constexpr int kBackgroundNice = 10;
+
+// SCHED_FIFO priority for capture, low in the range so the sound server's
+// own real-time threads still preempt it.
+constexpr int kAudioCaptureRtPriority = 10;
+
+// Timer slack while a fine-timer role is active (the default is 50 us).
+constexpr int64_t kFineTimerSlackNs = 1000;
+
+// nice is per thread on Linux, addressed by the kernel thread id.
+id_t CurrentTid() { return static_cast<id_t>(syscall(SYS_gettid)); }
+
+bool SetPolicy(int policy, int priority) {
+  sched_param param{};
+  param.sched_priority = priority;
+  return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
+bool SetNice(int nice) {
+  return setpriority(PRIO_PROCESS, CurrentTid(), nice) == 0;
+}
+
+int CurrentNice() {
+  errno = 0;
+  const int nice = getpriority(PRIO_PROCESS, CurrentTid());
+  return errno == 0 ? nice : 0;
+}
+
+struct Schedule {
+  int policy = SCHED_OTHER;
+  int rt_priority = 0;
+  int nice = 0;
+  int64_t timer_slack_ns = -1;
+};
+
+Schedule CurrentSchedule() {
+  Schedule schedule;
+  sched_param param{};
+  if (pthread_getschedparam(pthread_self(), &schedule.policy, &param) == 0) {
+    schedule.rt_priority = param.sched_priority;
+  } else {
+    schedule.policy = SCHED_OTHER;
+  }
+  schedule.nice = CurrentNice();
+  schedule.timer_slack_ns = prctl(PR_GET_TIMERSLACK, 0, 0, 0, 0);
+  return schedule;
+}
+
+// Taken during static initialisation, on the main thread and before any
+// role: what the process was started with (including a `nice -n` from the
+// user), and what a thread without a role should run at.
+const Schedule g_default_schedule = CurrentSchedule();
+
+void SetTimerSlack(int64_t slack_ns) {
+  if (slack_ns > 0) {
+    prctl(PR_SET_TIMERSLACK, static_cast<unsigned long>(slack_ns), 0, 0, 0);
+  }
+}
+
+#endif
+
+}  // namespace
+
+const char* ThreadRoleName(ThreadRole role) {
+  switch (role) {
+    case ThreadRole::kUi:
+      return "ui";
+    case ThreadRole::kRender:
+      return "render";
+    case ThreadRole::kAudioCapture:
+      return "audio-capture";
+    case ThreadRole::kBackground:
+      return "background";
+  }
+  return "unknown";
+}
+
+#if defined(_WIN32)
+
+ScopedThreadRole::ScopedThreadRole(ThreadRole role) : role_(role) {
+  HANDLE thread = GetCurrentThread();
+  saved_priority_ = GetThreadPriority(thread);
+  switch (role) {
+    case ThreadRole::kUi:
+      // Never lowers a thread that already runs above normal.
+      applied_ = saved_priority_ >= THREAD_PRIORITY_NORMAL ||
+                 SetThreadPriority(thread, THREAD_PRIORITY_NORMAL) != 0;
+      break;
+    case ThreadRole::kRender:
+      applied_ = SetThreadPriority(thread, THREAD_PRIORITY_ABOVE_NORMAL) != 0;
+      break;
+    case ThreadRole::kAudioCapture: {
+      // MMCSS boosts the thread for as long as it is registered, without
+      // needing the whole process at high priority.
+      DWORD task_index = 0;
+      mmcss_handle_ = AvSetMmThreadCharacteristicsW(L"Audio", &task_index);
+      applied_ = mmcss_handle_ != nullptr ||
+                 SetThreadPriority(thread, THREAD_PRIORITY_HIGHEST) != 0;
+      break;
+    }
+    case ThreadRole::kBackground:
+      background_mode_ =
+          SetThreadPriority(thread, THREAD_MODE_BACKGROUND_BEGIN) != 0;
+      applied_ = background_mode_;
+      break;
+  }
+  fine_timer_ = WantsFineTimer(role);
+  if (fine_timer_) AcquireFineTimer();
+}
+
+ScopedThreadRole::~ScopedThreadRole() {
+  if (fine_timer_) ReleaseFineTimer();
+  HANDLE thread = GetCurrentThread();
+  if (mmcss_handle_ != nullptr) AvRevertMmThreadCharacteristics(mmcss_handle_);
+  if (background_mode_) SetThreadPriority(thread, THREAD_MODE_BACKGROUND_END);
+  if (saved_priority_ != THREAD_PRIORITY_ERROR_RETURN) {
+    SetThreadPriority(thread, saved_priority_);
+  }
+}
+
+void ResetThreadScheduling() {
+  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+}
+
+#else
+
+ScopedThreadRole::ScopedThreadRole(ThreadRole role) : role_(role) {
+  const Schedule saved = CurrentSchedule();
+  saved_policy_ = saved.policy;
+  saved_rt_priority_ = saved.rt_priority;
+  saved_nice_ = saved.nice;
+
+  switch (role) {
+    case ThreadRole::kUi: {
+      // Only ever raised back to the default. Inside kRender, or started
+      // with a lower nice, the thread keeps what it has.
+      const Schedule& target = g_default_schedule;
+      bool ok = true;
+      if (saved_policy_ == SCHED_BATCH || saved_policy_ == SCHED_IDLE) {
+        ok = SetPolicy(target.policy, target.rt_priority);
+      }
+      if (saved_nice_ > target.nice) ok = SetNice(target.nice) && ok;
+      applied_ = ok;
+      break;
+    }
+    case ThreadRole::kRender:
+      applied_ = SetNice(kRenderNice);
+      break;
+    case ThreadRole::kAudioCapture: {
+      const int priority = std::clamp(kAudioCaptureRtPriority,
+                                      sched_get_priority_min(SCHED_FIFO),
+                                      sched_get_priority_max(SCHED_FIFO));
+      applied_ = SetPolicy(SCHED_FIFO, priority) || SetNice(kAudioCaptureNice);
+      break;
+    }
+    case ThreadRole::kBackground:
+      // Lowering is always allowed, so both normally succeed.
+      applied_ = SetPolicy(SCHED_BATCH, 0) && SetNice(kBackgroundNice);
+      break;
+  }
+
+  fine_timer_ = WantsFineTimer(role);
+  if (fine_timer_) {
+    saved_timer_slack_ns_ = saved.timer_slack_ns;
+    SetTimerSlack(kFineTimerSlackNs);
+    AcquireFineTimer();
+  }
+}
+
+ScopedThreadRole::~ScopedThreadRole() {
+  if (fine_timer_) {
+    ReleaseFineTimer();
+    SetTimerSlack(saved_timer_slack_ns_);
+  }
+  SetPolicy(saved_policy_, saved_rt_priority_);
+  SetNice(saved_nice_);
+}
+
+void ResetThreadScheduling() {
+  const Schedule& target = g_default_schedule;
+  const Schedule current = CurrentSchedule();
+  if (current.policy != target.policy ||
+      current.rt_priority != target.rt_priority) {
+    SetPolicy(target.policy, target.rt_priority);
+  }
+  // Best effort, like restoring in a scope: going back up from a lowered
+  // nice needs RLIMIT_NICE headroom.
+  if (current.nice != target.nice) SetNice(target.nice);
+  if (current.timer_slack_ns != target.timer_slack_ns) {
+    SetTimerSlack(target.timer_slack_ns);
+  }
+}
+
+#endif
+
+// static
+int ScopedThreadRole::fine_timer_holders() {
+  std::lock_guard<std::mutex> lock(g_fine_timer_mutex);
+  return g_fine_timer_holders;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,87 @@
+#ifndef NATIVE_THREAD_THREAD_ROLE_H_
+#define NATIVE_THREAD_THREAD_ROLE_H_
+
+#include <cstdint>
+
+namespace cyrene_music {
+
+// What a native thread is doing, which decides how the OS should schedule
+// it. Replaces raising the whole process to high priority: only threads
+// with time-critical work ask for more, and only while they are doing it.
+enum class ThreadRole {
+  // The platform thread: brought back to the process's default scheduling
+  // if it was lowered; a thread already running above it keeps that.
+  kUi,
+  // Frame-paced animation (the desktop lyric scroll): slightly raised
+  // priority and fine-grained timers.
+  kRender,
+  // Audio capture and analysis: real-time scheduling where the OS allows
+  // it, otherwise the highest normal priority, and fine-grained timers.
+  kAudioCapture,
+  // Decoding, file I/O and workers feeding slow OS APIs: yields to
+  // everything else.
+  kBackground,
+};
+
+const char* ThreadRoleName(ThreadRole role);
+
+// Puts the calling thread back on the scheduling the process started with
+// (policy, nice and timer slack of the main thread at load). Linux threads
+// inherit all three from whoever created them, so a thread started while
+// its creator held kRender would run boosted for its whole life; long-lived
+// thread entry points without a role of their own call this first. Windows
+// threads always start at normal priority; there it only resets that.
+void ResetThreadScheduling();
+
+// Puts the calling thread into |role| for the lifetime of the object and
+// restores its previous scheduling afterwards. Must be destroyed on the
+// thread that created it; scopes may nest.
+//
+// Windows: thread priority, MMCSS "Audio" for capture, background mode
+// (lower CPU, I/O and memory priority) for kBackground, and the 1 ms system
+// timer (timeBeginPeriod) held only while a kRender or kAudioCapture scope
+// is alive anywhere in the process.
+//
+// Linux: SCHED_FIFO for capture when permitted (RLIMIT_RTPRIO or
+// CAP_SYS_NICE), per-thread nice values, SCHED_BATCH for kBackground and a
+// 1 us timer slack for the fine-timer roles. Raising priority needs
+// RLIMIT_NICE headroom and, like restoring a lowered nice value, is best
+// effort: without it the thread simply keeps its current scheduling.
+class ScopedThreadRole {
+ public:
+  explicit ScopedThreadRole(ThreadRole role);
+  ~ScopedThreadRole();
+
+  ScopedThreadRole(const ScopedThreadRole&) = delete;
+  ScopedThreadRole& operator=(const ScopedThreadRole&) = delete;
+
+  ThreadRole role() const { return role_; }
+
+  // Whether the OS accepted the role's priority (the fine timer is
+  // requested regardless).
+  bool applied() const { return applied_; }
+
+  // Number of live scopes holding the fine system timer, process-wide.
+  static int fine_timer_holders();
+
+ private:
+  ThreadRole role_;
+  bool applied_ = false;
+  bool fine_timer_ = false;
+
+  // Scheduling to restore.
+#if defined(_WIN32)
+  int saved_priority_ = 0;
+  void* mmcss_handle_ = nullptr;
+  bool background_mode_ = false;
+#else
+  int saved_policy_ = 0;
+  int saved_rt_priority_ = 0;
+  int saved_nice_ = 0;
+  int64_t saved_timer_slack_ns_ = -1;
+#endif
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_THREAD_THREAD_ROLE_H_
@@ -0,0 +1,121 @@
+#include "thread/work_stealing_pool.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "thread/thread_role.h"
+
+namespace cyrene_music {
+
+namespace {
+
+// The pool and queue of the calling thread, when it is a pool thread.
+thread_local const WorkStealingPool* current_pool = nullptr;
+thread_local size_t current_queue = 0;
+
+}  // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  queues_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    queues_.push_back(std::make_unique<Queue>());
+  }
+  threads_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    threads_.emplace_back(&WorkStealingPool::Run, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) thread.join();
+}
+
+void WorkStealingPool::Submit(Task task) {
+  unfinished_.fetch_add(1);
+  const size_t index = current_pool == this
+                           ? current_queue
+                           : next_queue_.fetch_add(1) % queues_.size();
+  {
+    Queue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  queued_.fetch_add(1);
+  // A thread about to sleep registers before it checks queued_, so either
+  // it sees the task or this sees it and wakes it.
+  if (sleepers_.load() > 0) {
+    { std::lock_guard<std::mutex> lock(mutex_); }
+    wake_.notify_one();
+  }
+}
+
+void WorkStealingPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return unfinished_.load() == 0; });
+}
+
+bool WorkStealingPool::WaitFor(std::chrono::milliseconds timeout) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return idle_.wait_for(lock, timeout,
+                        [this] { return unfinished_.load() == 0; });
+}
+
+void WorkStealingPool::Run(size_t index) {
+  ScopedThreadRole role(ThreadRole::kBackground);
+  current_pool = this;
+  current_queue = index;
+
+  Task task;
+  for (;;) {
+    if (TakeTask(index, &task)) {
+      task();
+      task = nullptr;
+      if (unfinished_.fetch_sub(1) == 1) {
+        { std::lock_guard<std::mutex> lock(mutex_); }
+        idle_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleepers_.fetch_add(1);
+    wake_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+    sleepers_.fetch_sub(1);
+    // Whatever is still queued runs before the pool goes away.
+    if (stopping_ && queued_.load() == 0) return;
+  }
+}
+
+bool WorkStealingPool::TakeTask(size_t index, Task* task) {
+  {
+    Queue& own = *queues_[index];
+    std::lock_guard<std::mutex> lock(own.mutex);
+    if (!own.tasks.empty()) {
+      *task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued_.fetch_sub(1);
+      return true;
+    }
+  }
+  for (size_t k = 1; k < queues_.size(); ++k) {
+    Queue& other = *queues_[(index + k) % queues_.size()];
+    std::lock_guard<std::mutex> lock(other.mutex);
+    if (!other.tasks.empty()) {
+      *task = std::move(other.tasks.front());
+      other.tasks.pop_front();
+      queued_.fetch_sub(1);
+      steals_.fetch_add(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,83 @@
+#ifndef NATIVE_THREAD_WORK_STEALING_POOL_H_
+#define NATIVE_THREAD_WORK_STEALING_POOL_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cyrene_music {
+
+// Fixed set of background threads for fan-out work whose size is not known
+// up front, such as a directory walk where every directory task spawns more
+// directory and file tasks.
+//
+// Each thread has its own queue. A task submitted from a pool thread goes
+// to the back of that thread's queue and is taken from the back again, so
+// a thread keeps working through the subtree it just opened while its
+// files are still in the page cache. A thread whose queue is empty steals
+// from the front of another's, which is where the oldest and usually
+// largest pieces of work sit. Tasks submitted from outside the pool are
+// spread round-robin.
+//
+// The threads run in the background role and live as long as the pool.
+class WorkStealingPool {
+ public:
+  using Task = std::function<void()>;
+
+  // 0 threads means one per hardware thread.
+  explicit WorkStealingPool(size_t threads = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool&) = delete;
+  WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+  void Submit(Task task);
+
+  // Blocks until every task submitted so far, and every task those submit,
+  // has finished. Not from a pool thread.
+  void Wait();
+  // Wait() for at most |timeout|; true once the pool is idle.
+  bool WaitFor(std::chrono::milliseconds timeout);
+
+  size_t thread_count() const { return threads_.size(); }
+  // Tasks a thread took from another thread's queue, since construction.
+  uint64_t steals() const { return steals_.load(std::memory_order_relaxed); }
+
+ private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void Run(size_t index);
+  // Own queue first (newest), then the others (oldest).
+  bool TakeTask(size_t index, Task* task);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  // Tasks sitting in a queue, and tasks submitted but not yet finished.
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> unfinished_{0};
+  std::atomic<size_t> sleepers_{0};
+  std::atomic<size_t> next_queue_{0};
+  std::atomic<uint64_t> steals_{0};
+  bool stopping_ = false;
+
+  // Last, so everything above exists before the threads start.
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_THREAD_WORK_STEALING_POOL_H_
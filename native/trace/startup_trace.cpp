@@ -0,0 +1,159 @@
+#include "trace/startup_trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <utility>
+
+namespace cyrene_music {
+
+namespace {
+
+const char kFlag[] = "--trace-startup";
+
+// Reserved up front so recording never reallocates mid-startup.
+constexpr size_t kExpectedEvents = 128;
+
+int64_t MonotonicUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void AppendJsonString(const char* text, std::string* out) {
+  out->push_back('"');
+  for (const char* p = text; *p != '\0'; ++p) {
+    const unsigned char c = static_cast<unsigned char>(*p);
+    if (c == '"' || c == '\\') {
+      out->push_back('\\');
+      out->push_back(static_cast<char>(c));
+    } else if (c < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      out->append(escaped);
+    } else {
+      out->push_back(static_cast<char>(c));
+    }
+  }
+  out->push_back('"');
+}
+
+}  // namespace
+
+// static
+StartupTrace& StartupTrace::Shared() {
+  static StartupTrace trace;
+  return trace;
+}
+
+// static
+bool StartupTrace::ParseFlag(const std::string& arg, std::string* path) {
+  const size_t flag_length = sizeof(kFlag) - 1;
+  if (arg.compare(0, flag_length, kFlag) != 0) return false;
+  if (arg.size() == flag_length) {
+    *path = DefaultPath();
+    return true;
+  }
+  if (arg[flag_length] != '=') return false;
+  *path = arg.substr(flag_length + 1);
+  if (path->empty()) *path = DefaultPath();
+  return true;
+}
+
+// static
+std::string StartupTrace::DefaultPath() {
+  std::error_code error;
+  std::filesystem::path directory =
+      std::filesystem::temp_directory_path(error);
+  if (error) directory.clear();
+  return (directory / "cyrene_music_startup_trace.json").u8string();
+}
+
+// static
+uint32_t StartupTrace::ThreadIndex() {
+  static std::atomic<uint32_t> next_index{1};
+  thread_local const uint32_t index =
+      next_index.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+StartupTrace::StartupTrace() : enabled_(false), origin_us_(0) {}
+
+void StartupTrace::Enable(std::string path) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (enabled()) return;
+  ThreadIndex();  // the enabling thread shows up as "main"
+  path_ = std::move(path);
+  events_.clear();
+  events_.reserve(kExpectedEvents);
+  origin_us_.store(MonotonicUs(), std::memory_order_relaxed);
+  enabled_.store(true, std::memory_order_release);
+}
+
+int64_t StartupTrace::NowUs() const {
+  return MonotonicUs() - origin_us_.load(std::memory_order_relaxed);
+}
+
+void StartupTrace::Instant(const char* name) {
+  if (!enabled()) return;
+  const int64_t now_us = NowUs();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (enabled()) events_.push_back({name, 'i', ThreadIndex(), now_us, 0});
+}
+
+void StartupTrace::Complete(const char* name, int64_t start_us,
+                            int64_t end_us) {
+  if (!enabled()) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (enabled()) {
+    events_.push_back({name, 'X', ThreadIndex(), start_us, end_us - start_us});
+  }
+}
+
+bool StartupTrace::Finish() {
+  std::vector<Event> events;
+  std::string path;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!enabled()) return false;
+    enabled_.store(false, std::memory_order_release);
+    events.swap(events_);
+    path.swap(path_);
+  }
+
+  std::string json =
+      "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+      "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+      "\"args\":{\"name\":\"cyrene_music\"}},\n"
+      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+      "\"args\":{\"name\":\"main\"}}";
+  char fields[128];
+  for (const Event& event : events) {
+    json.append(",\n{\"name\":");
+    AppendJsonString(event.name, &json);
+    std::snprintf(fields, sizeof(fields),
+                  ",\"cat\":\"startup\",\"ph\":\"%c\",\"pid\":1,\"tid\":%u,"
+                  "\"ts\":%lld",
+                  event.phase, event.thread,
+                  static_cast<long long>(event.ts_us));
+    json.append(fields);
+    if (event.phase == 'X') {
+      std::snprintf(fields, sizeof(fields), ",\"dur\":%lld",
+                    static_cast<long long>(event.dur_us));
+      json.append(fields);
+    } else {
+      json.append(",\"s\":\"p\"");
+    }
+    json.push_back('}');
+  }
+  json.append("\n]}\n");
+
+  std::ofstream file(std::filesystem::u8path(path),
+                     std::ios::binary | std::ios::trunc);
+  if (!file) return false;
+  file.write(json.data(), static_cast<std::streamsize>(json.size()));
+  return static_cast<bool>(file.flush());
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,91 @@
+#ifndef NATIVE_TRACE_STARTUP_TRACE_H_
+#define NATIVE_TRACE_STARTUP_TRACE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace cyrene_music {
+
+// Records where cold-start time goes, from the runner's entry point to the
+// first Flutter frame, and writes it as Chrome trace JSON (load it in
+// chrome://tracing or https://ui.perfetto.dev).
+//
+// Off unless the runner is started with --trace-startup[=<file>]; while off
+// every call is a single atomic load. Timestamps are monotonic microseconds
+// since Enable(). Event names must be string literals, they are stored by
+// pointer. Thread-safe, but meant for a few dozen events, not hot loops.
+class StartupTrace {
+ public:
+  static StartupTrace& Shared();
+
+  // True if |arg| is the trace flag; |path| receives the file it names, or
+  // DefaultPath() when it names none.
+  static bool ParseFlag(const std::string& arg, std::string* path);
+
+  // cyrene_music_startup_trace.json in the temp directory.
+  static std::string DefaultPath();
+
+  StartupTrace();
+
+  StartupTrace(const StartupTrace&) = delete;
+  StartupTrace& operator=(const StartupTrace&) = delete;
+
+  // Starts recording; |path| is where Finish() writes the trace.
+  void Enable(std::string path);
+  bool enabled() const { return enabled_.load(std::memory_order_acquire); }
+
+  // A point in time, e.g. "first frame".
+  void Instant(const char* name);
+
+  // A span on the calling thread; see Scope.
+  void Complete(const char* name, int64_t start_us, int64_t end_us);
+
+  // Microseconds since Enable().
+  int64_t NowUs() const;
+
+  // Stops recording and writes the trace. Only the first call writes;
+  // false if tracing was off or the file could not be written.
+  bool Finish();
+
+  // Records the enclosing scope as a span.
+  class Scope {
+   public:
+    explicit Scope(const char* name)
+        : name_(name),
+          start_us_(Shared().enabled() ? Shared().NowUs() : -1) {}
+    ~Scope() {
+      if (start_us_ >= 0) Shared().Complete(name_, start_us_, Shared().NowUs());
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    const char* name_;
+    int64_t start_us_;
+  };
+
+ private:
+  struct Event {
+    const char* name;
+    char phase;  // 'X' complete, 'i' instant
+    uint32_t thread;
+    int64_t ts_us;
+    int64_t dur_us;
+  };
+
+  static uint32_t ThreadIndex();
+
+  std::atomic<bool> enabled_;
+  std::atomic<int64_t> origin_us_;
+  std::mutex mutex_;
+  std::string path_;
+  std::vector<Event> events_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // NATIVE_TRACE_STARTUP_TRACE_H_
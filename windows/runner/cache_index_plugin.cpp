@@ -0,0 +1,243 @@
+#include "cache_index_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "channel/method_dispatch.h"
+
+namespace cyrene_music {
+
+namespace {
+
+int64_t NowMs() {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+flutter::EncodableList ToList(const std::vector<std::string>& keys) {
+  return flutter::EncodableList(keys.begin(), keys.end());
+}
+
+}  // namespace
+
+void CacheIndexPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  auto plugin = std::make_unique<CacheIndexPlugin>(registrar->messenger());
+  registrar->AddPlugin(std::move(plugin));
+}
+
+CacheIndexPlugin::CacheIndexPlugin(flutter::BinaryMessenger* messenger) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      messenger, "com.cyrene.music/cache_index",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+}
+
+CacheIndexPlugin::~CacheIndexPlugin() = default;
+
+void CacheIndexPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableList;
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(CacheIndexPlugin* plugin,
+                           const EncodableMap* args, MethodResult* result);
+
+  static const MethodTable<Handler> methods{
+      {"open",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string path;
+         const ArgError error = DecodeArgs(args, Required("path", &path));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         if (!plugin->index_.Open(path)) {
+           result->Error("OPEN_FAILED", "Cannot open " + path);
+           return;
+         }
+         EncodableList keys;
+         std::vector<int64_t> sizes;
+         keys.reserve(plugin->index_.entries().size());
+         sizes.reserve(plugin->index_.entries().size());
+         for (const auto& [key, entry] : plugin->index_.entries()) {
+           keys.emplace_back(key);
+           sizes.push_back(static_cast<int64_t>(entry.file_size));
+         }
+         result->Success(EncodableValue(EncodableMap{
+             {EncodableValue("keys"), EncodableValue(std::move(keys))},
+             {EncodableValue("sizes"), EncodableValue(std::move(sizes))},
+         }));
+       }},
+      {"get",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string key;
+         const ArgError error = DecodeArgs(args, Required("key", &key));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         std::string metadata;
+         if (!plugin->index_.ReadMetadata(key, &metadata)) {
+           result->Success();
+           return;
+         }
+         result->Success(EncodableValue(std::move(metadata)));
+       }},
+      {"put",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string key;
+         int64_t size = 0;
+         std::string metadata;
+         const ArgError error =
+             DecodeArgs(args, Required("key", &key), Required("size", &size),
+                        Required("metadata", &metadata));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         const int64_t now = NowMs();
+         if (!plugin->index_.Put(key, static_cast<uint64_t>(size), metadata,
+                                 now)) {
+           result->Error("WRITE_FAILED", "Cannot update the cache index");
+           return;
+         }
+         // The new song may push the cache over its budget.
+         result->Success(EncodableValue(
+             ToList(plugin->evictor_.Enforce(&plugin->index_, now))));
+       }},
+      {"putAll",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::vector<std::string> keys;
+         std::vector<int64_t> sizes;
+         std::vector<std::string> metadata;
+         const ArgError error =
+             DecodeArgs(args, Required("keys", &keys), Required("sizes", &sizes),
+                        Required("metadata", &metadata));
+         if (!error.ok() || sizes.size() != keys.size() ||
+             metadata.size() != keys.size()) {
+           result->Error("INVALID_ARGUMENT", error.ok()
+                                                 ? "Mismatched list lengths"
+                                                 : error.Message());
+           return;
+         }
+         const int64_t now = NowMs();
+         for (size_t i = 0; i < keys.size(); ++i) {
+           if (!plugin->index_.Put(keys[i], static_cast<uint64_t>(sizes[i]),
+                           metadata[i], now)) {
+             result->Error("WRITE_FAILED", "Cannot update the cache index");
+             return;
+           }
+         }
+         result->Success(EncodableValue(true));
+       }},
+      {"remove",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string key;
+         const ArgError error = DecodeArgs(args, Required("key", &key));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         if (!plugin->index_.Remove(key)) {
+           result->Error("WRITE_FAILED", "Cannot update the cache index");
+           return;
+         }
+         result->Success(EncodableValue(true));
+       }},
+      {"touch",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string key;
+         const ArgError error = DecodeArgs(args, Required("key", &key));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         const bool hit = plugin->index_.Touch(key, NowMs());
+         if (hit) plugin->evictor_.RecordHit();
+         result->Success(EncodableValue(hit));
+       }},
+      {"clear",
+       [](CacheIndexPlugin* plugin, const EncodableMap*,
+          MethodResult* result) {
+         if (!plugin->index_.Clear()) {
+           result->Error("WRITE_FAILED", "Cannot clear the cache index");
+           return;
+         }
+         result->Success(EncodableValue(true));
+       }},
+      {"configure",
+       [](CacheIndexPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string directory;
+         int64_t budget = 0;
+         std::string policy;
+         const ArgError error = DecodeArgs(
+             args, Required("directory", &directory),
+             Required("budget", &budget), Required("policy", &policy));
+         if (!error.ok() || budget < 0 ||
+             (policy != "lru" && policy != "lfu")) {
+           result->Error("INVALID_ARGUMENT",
+                         error.ok() ? "Invalid 'budget' or 'policy'"
+                                    : error.Message());
+           return;
+         }
+         plugin->evictor_.Configure(directory, static_cast<uint64_t>(budget),
+                                    policy == "lfu"
+                                        ? CacheEvictor::Policy::kLfu
+                                        : CacheEvictor::Policy::kLru);
+         result->Success(EncodableValue(
+             ToList(plugin->evictor_.Enforce(&plugin->index_, NowMs()))));
+       }},
+      {"miss",
+       [](CacheIndexPlugin* plugin, const EncodableMap*,
+          MethodResult* result) {
+         plugin->evictor_.RecordMiss();
+         result->Success(EncodableValue(true));
+       }},
+      {"metrics",
+       [](CacheIndexPlugin* plugin, const EncodableMap*,
+          MethodResult* result) {
+         const CacheEvictor::Metrics& metrics = plugin->evictor_.metrics();
+         const auto value = [](uint64_t n) {
+           return EncodableValue(static_cast<int64_t>(n));
+         };
+         result->Success(EncodableValue(EncodableMap{
+             {EncodableValue("hits"), value(metrics.hits)},
+             {EncodableValue("misses"), value(metrics.misses)},
+             {EncodableValue("evictions"), value(metrics.evictions)},
+             {EncodableValue("evictedBytes"), value(metrics.evicted_bytes)},
+             {EncodableValue("budget"), value(plugin->evictor_.budget_bytes())},
+         }));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(this, std::get_if<EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,45 @@
+#ifndef RUNNER_CACHE_INDEX_PLUGIN_H_
+#define RUNNER_CACHE_INDEX_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+
+#include <memory>
+
+#include "cache/cache_evictor.h"
+#include "cache/cache_index.h"
+
+namespace cyrene_music {
+
+// Serves CacheService's song index from a native CacheIndex, so adding,
+// removing or playing a cached song appends one record instead of
+// rewriting the whole index. "open" {path} loads the log and returns the
+// keys and sizes; metadata is fetched per key with "get".
+//
+// A CacheEvictor keeps the cache within the budget set by "configure"
+// {directory, budget, policy}: "put" and "configure" return the keys they
+// evicted. "touch" on a cached song counts a hit, "miss" a song played
+// without one; "metrics" returns the counts.
+class CacheIndexPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit CacheIndexPlugin(flutter::BinaryMessenger* messenger);
+  ~CacheIndexPlugin() override;
+
+  CacheIndexPlugin(const CacheIndexPlugin&) = delete;
+  CacheIndexPlugin& operator=(const CacheIndexPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  CacheIndex index_;
+  CacheEvictor evictor_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_CACHE_INDEX_PLUGIN_H_
@@ -0,0 +1,200 @@
+#include "cache_stream_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cache/cache_stream_server.h"
+#include "channel/method_dispatch.h"
+
+namespace cyrene_music {
+
+void CacheStreamPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  auto plugin = std::make_unique<CacheStreamPlugin>(registrar->messenger());
+  registrar->AddPlugin(std::move(plugin));
+}
+
+CacheStreamPlugin::CacheStreamPlugin(flutter::BinaryMessenger* messenger) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      messenger, "com.cyrene.music/cache_stream",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+}
+
+// Streams still being read by the player end with the engine, not with
+// static destruction. Unfinished writers delete their partial files.
+CacheStreamPlugin::~CacheStreamPlugin() { CacheStreamServer::Shared().Stop(); }
+
+void CacheStreamPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(CacheStreamPlugin* plugin, const EncodableMap* args,
+                           MethodResult* result);
+
+  // The writer named by "id", or nullptr after reporting the error.
+  static constexpr auto FindWriter =
+      [](CacheStreamPlugin* plugin, int64_t id,
+         MethodResult* result) -> CyreneCacheWriter* {
+    const auto it = plugin->writers_.find(id);
+    if (it == plugin->writers_.end()) {
+      result->Error("INVALID_ARGUMENT", "Unknown writer");
+      return nullptr;
+    }
+    return it->second.get();
+  };
+
+  static const MethodTable<Handler> methods{
+      {"open",
+       [](CacheStreamPlugin*, const EncodableMap* args, MethodResult* result) {
+         std::string path;
+         std::string extension;
+         const ArgError error = DecodeArgs(args, Required("path", &path),
+                                           Required("extension", &extension));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         const std::string url =
+             CacheStreamServer::Shared().Open(path, extension);
+         if (url.empty()) {
+           result->Error("OPEN_FAILED", "Cannot stream " + path);
+           return;
+         }
+         result->Success(EncodableValue(url));
+       }},
+      {"close",
+       [](CacheStreamPlugin*, const EncodableMap* args, MethodResult* result) {
+         std::string url;
+         const ArgError error = DecodeArgs(args, Required("url", &url));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         CacheStreamServer::Shared().Close(url);
+         result->Success(EncodableValue(true));
+       }},
+      {"beginWrite",
+       [](CacheStreamPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string path;
+         int64_t reserve = 0;
+         const ArgError error = DecodeArgs(args, Required("path", &path),
+                                           Required("reserve", &reserve));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         if (reserve < 0) {
+           result->Error("INVALID_ARGUMENT", "Negative 'reserve'");
+           return;
+         }
+         auto writer = std::make_unique<CyreneCacheWriter>();
+         if (!writer->Begin(path, static_cast<size_t>(reserve))) {
+           result->Error("WRITE_FAILED", "Cannot create " + path);
+           return;
+         }
+         const int64_t id = plugin->next_writer_id_++;
+         plugin->writers_.emplace(id, std::move(writer));
+         result->Success(EncodableValue(id));
+       }},
+      {"write",
+       [](CacheStreamPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         const ArgError error = DecodeArgs(args, Required("id", &id));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         // Read in place rather than decoded into a copy.
+         const auto it = args->find(EncodableValue("bytes"));
+         const auto* bytes = it != args->end()
+                                 ? std::get_if<std::vector<uint8_t>>(&it->second)
+                                 : nullptr;
+         if (bytes == nullptr) {
+           result->Error("INVALID_ARGUMENT", "Invalid 'bytes' argument");
+           return;
+         }
+         CyreneCacheWriter* writer = FindWriter(plugin, id, result);
+         if (writer == nullptr) return;
+         if (!writer->Write(bytes->data(), bytes->size())) {
+           result->Error("WRITE_FAILED", "Cache write failed");
+           return;
+         }
+         result->Success(EncodableValue(true));
+       }},
+      {"digest",
+       [](CacheStreamPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         const ArgError error = DecodeArgs(args, Required("id", &id));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         CyreneCacheWriter* writer = FindWriter(plugin, id, result);
+         if (writer == nullptr) return;
+         result->Success(EncodableValue(EncodableMap{
+             {EncodableValue("size"),
+              EncodableValue(static_cast<int64_t>(writer->audio_size()))},
+             {EncodableValue("checksum"), EncodableValue(writer->Digest())},
+         }));
+       }},
+      {"commit",
+       [](CacheStreamPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         std::string metadata;
+         const ArgError error = DecodeArgs(args, Required("id", &id),
+                                           Required("metadata", &metadata));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         CyreneCacheWriter* writer = FindWriter(plugin, id, result);
+         if (writer == nullptr) return;
+         const bool committed = writer->Commit(metadata);
+         plugin->writers_.erase(id);
+         if (!committed) {
+           result->Error("WRITE_FAILED", "Cache commit failed");
+           return;
+         }
+         result->Success(EncodableValue(true));
+       }},
+      {"abort",
+       [](CacheStreamPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         const ArgError error = DecodeArgs(args, Required("id", &id));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         // Destroying the writer deletes its partial file.
+         plugin->writers_.erase(id);
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(this, std::get_if<EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+}  // namespace cyrene_music
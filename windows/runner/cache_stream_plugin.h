@@ -0,0 +1,44 @@
+#ifndef RUNNER_CACHE_STREAM_PLUGIN_H_
+#define RUNNER_CACHE_STREAM_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "cache/cyrene_cache_writer.h"
+
+namespace cyrene_music {
+
+// Moves cached .cyrene songs in and out of the cache without holding them
+// in Dart. "open" {path, extension} returns a CacheStreamServer URL the
+// player reads from, and "close" {url} forgets it. Downloads are written
+// through a CyreneCacheWriter: "beginWrite" {path, reserve} returns an id,
+// then "write" {id, bytes} per chunk, "digest" {id} for the size and
+// checksum the metadata needs, and "commit" {id, metadata} or "abort" {id}.
+class CacheStreamPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit CacheStreamPlugin(flutter::BinaryMessenger* messenger);
+  ~CacheStreamPlugin() override;
+
+  CacheStreamPlugin(const CacheStreamPlugin&) = delete;
+  CacheStreamPlugin& operator=(const CacheStreamPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+
+  std::unordered_map<int64_t, std::unique_ptr<CyreneCacheWriter>> writers_;
+  int64_t next_writer_id_ = 1;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_CACHE_STREAM_PLUGIN_H_
@@ -0,0 +1,127 @@
+#include "cover_art_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+#include <objbase.h>
+
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "channel/method_dispatch.h"
+
+namespace cyrene_music {
+
+void CoverArtPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  auto plugin = std::make_unique<CoverArtPlugin>(registrar->messenger());
+  registrar->AddPlugin(std::move(plugin));
+}
+
+CoverArtPlugin::CoverArtPlugin(flutter::BinaryMessenger* messenger) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      messenger, "com.cyrene.music/cover_art",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+
+  // Covers are decoded in arrival order as soon as they come in; the
+  // worker exists to keep WIC off the platform thread, not to rate-limit.
+  worker_ = std::make_unique<CoalescingWorker<CoverArtJobs>>(
+      std::chrono::milliseconds(0),
+      [this](CoverArtJobs& jobs) { Apply(jobs); },
+      [this] {
+        CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+        decoder_ = std::make_unique<WicImageDecoder>();
+        CoverArtCache::Shared().Configure(decoder_.get(), options_);
+      },
+      [this] {
+        // Detach the decoder before it is released with the apartment.
+        CoverArtCache::Shared().Configure(nullptr, CoverArtCacheOptions());
+        decoder_.reset();
+        CoUninitialize();
+      });
+}
+
+CoverArtPlugin::~CoverArtPlugin() { worker_.reset(); }
+
+void CoverArtPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(CoverArtPlugin* plugin, const EncodableMap* args,
+                           MethodResult* result);
+
+  static const MethodTable<Handler> methods{
+      {"configure",
+       [](CoverArtPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string directory;
+         const ArgError error =
+             DecodeArgs(args, Required("directory", &directory));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         CoverArtJobs jobs;
+         jobs.disk_directory = std::move(directory);
+         plugin->worker_->Post(std::move(jobs));
+         result->Success(EncodableValue(true));
+       }},
+      {"contains",
+       [](CoverArtPlugin*, const EncodableMap* args, MethodResult* result) {
+         std::string url;
+         const ArgError error = DecodeArgs(args, Required("url", &url));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         // A disk hit also warms the memory cache for the consumers.
+         result->Success(
+             EncodableValue(CoverArtCache::Shared().Find(url) != nullptr));
+       }},
+      {"put",
+       [](CoverArtPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         CoverArtJobs::Cover cover;
+         const ArgError error = DecodeArgs(args, Required("url", &cover.key),
+                                           Required("bytes", &cover.data));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         CoverArtJobs jobs;
+         jobs.covers.push_back(std::move(cover));
+         plugin->worker_->Post(std::move(jobs));
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(this, std::get_if<EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+void CoverArtPlugin::Apply(CoverArtJobs& jobs) {
+  CoverArtCache& cache = CoverArtCache::Shared();
+  if (jobs.disk_directory) {
+    options_.disk_directory = std::move(*jobs.disk_directory);
+    cache.Configure(decoder_.get(), options_);
+  }
+  for (const CoverArtJobs::Cover& cover : jobs.covers) {
+    cache.Put(cover.key, cover.data.data(), cover.data.size());
+  }
+}
+
+}  // namespace cyrene_music
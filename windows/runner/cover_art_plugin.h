@@ -0,0 +1,48 @@
+#ifndef RUNNER_COVER_ART_PLUGIN_H_
+#define RUNNER_COVER_ART_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+
+#include <memory>
+
+#include "channel/coalescing_worker.h"
+#include "cover/cover_art_cache.h"
+#include "wic_image_decoder.h"
+
+namespace cyrene_music {
+
+// Feeds the process-wide CoverArtCache. Dart downloads a cover once and
+// hands over the bytes; a worker thread decodes them with WIC so SMTC and
+// the desktop lyric panel read ready-made bitmaps.
+class CoverArtPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit CoverArtPlugin(flutter::BinaryMessenger* messenger);
+  ~CoverArtPlugin() override;
+
+  CoverArtPlugin(const CoverArtPlugin&) = delete;
+  CoverArtPlugin& operator=(const CoverArtPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Worker thread only.
+  void Apply(CoverArtJobs& jobs);
+
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+
+  // Created and used on the worker thread, inside its COM apartment.
+  std::unique_ptr<WicImageDecoder> decoder_;
+  CoverArtCacheOptions options_;
+
+  // Last, so it stops before the decoder goes away.
+  std::unique_ptr<CoalescingWorker<CoverArtJobs>> worker_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_COVER_ART_PLUGIN_H_
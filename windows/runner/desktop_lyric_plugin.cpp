@@ -2,67 +2,327 @@
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
-#include <map>
 #include <memory>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include "channel/method_dispatch.h"
+#include "lazy_plugin.h"
 
 namespace {
 
-std::string WStringToString(const std::wstring& wstr) {
-  if (wstr.empty()) return std::string();
-  int size_needed = WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), 
-                                        NULL, 0, NULL, NULL);
-  std::string strTo(size_needed, 0);
-  WideCharToMultiByte(CP_UTF8, 0, &wstr[0], (int)wstr.size(), 
-                      &strTo[0], size_needed, NULL, NULL);
-  return strTo;
+flutter::EncodableValue HistogramToEncodable(
+    const cyrene_music::DurationHistogram& histogram) {
+  using cyrene_music::DurationHistogram;
+  flutter::EncodableList buckets;
+  flutter::EncodableList bounds;
+  for (int i = 0; i < DurationHistogram::kBucketCount; ++i) {
+    buckets.push_back(flutter::EncodableValue(
+        static_cast<int64_t>(histogram.buckets()[i])));
+    bounds.push_back(flutter::EncodableValue(
+        DurationHistogram::BucketUpperBoundUs(i)));
+  }
+
+  flutter::EncodableMap map;
+  map[flutter::EncodableValue("count")] =
+      flutter::EncodableValue(static_cast<int64_t>(histogram.count()));
+  map[flutter::EncodableValue("meanUs")] =
+      flutter::EncodableValue(histogram.mean_us());
+  map[flutter::EncodableValue("maxUs")] =
+      flutter::EncodableValue(histogram.max_us());
+  map[flutter::EncodableValue("p50Us")] =
+      flutter::EncodableValue(histogram.PercentileUs(50.0));
+  map[flutter::EncodableValue("p95Us")] =
+      flutter::EncodableValue(histogram.PercentileUs(95.0));
+  map[flutter::EncodableValue("p99Us")] =
+      flutter::EncodableValue(histogram.PercentileUs(99.0));
+  map[flutter::EncodableValue("buckets")] = flutter::EncodableValue(buckets);
+  map[flutter::EncodableValue("bucketUpperBoundsUs")] =
+      flutter::EncodableValue(bounds);
+  return flutter::EncodableValue(map);
+}
+
+flutter::EncodableValue RenderStatsToEncodable(
+    const cyrene_music::RenderStats& stats) {
+  using Phase = cyrene_music::RenderStats::Phase;
+  flutter::EncodableMap map;
+  map[flutter::EncodableValue("frames")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.frames()));
+  map[flutter::EncodableValue("skippedFrames")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.skipped_frames()));
+  map[flutter::EncodableValue("cacheHits")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.cache_hits()));
+  map[flutter::EncodableValue("cacheMisses")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.cache_misses()));
+  map[flutter::EncodableValue("lines")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.lines()));
+  map[flutter::EncodableValue("meanFramesPerLine")] =
+      flutter::EncodableValue(stats.mean_frames_per_line());
+  map[flutter::EncodableValue("maxFramesPerLine")] =
+      flutter::EncodableValue(static_cast<int64_t>(stats.max_frames_per_line()));
+  map[flutter::EncodableValue("layout")] =
+      HistogramToEncodable(stats.phase(Phase::kLayout));
+  map[flutter::EncodableValue("rasterise")] =
+      HistogramToEncodable(stats.phase(Phase::kRasterise));
+  map[flutter::EncodableValue("present")] =
+      HistogramToEncodable(stats.phase(Phase::kPresent));
+  map[flutter::EncodableValue("frame")] =
+      HistogramToEncodable(stats.frame_total());
+  return flutter::EncodableValue(map);
+}
+
+
+using flutter::EncodableMap;
+using flutter::EncodableValue;
+using MethodResult = flutter::MethodResult<EncodableValue>;
+using cyrene_music::DecodeArgs;
+using cyrene_music::Optional;
+using cyrene_music::Required;
+
+// Handlers get the window, the argument map (nullptr if the call had none)
+// and the pending result.
+using MethodHandler = void (*)(DesktopLyricWindow* window,
+                               const EncodableMap* args, MethodResult* result);
+
+// Replies INVALID_ARGUMENT when decoding failed.
+bool ArgsOk(const cyrene_music::ArgError& error, MethodResult* result) {
+  if (error.ok()) return true;
+  result->Error("INVALID_ARGUMENT", error.Message());
+  return false;
 }
 
-std::wstring StringToWString(const std::string& str) {
-  if (str.empty()) return std::wstring();
-  int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), 
-                                        NULL, 0);
-  std::wstring wstrTo(size_needed, 0);
-  MultiByteToWideChar(CP_UTF8, 0, &str[0], (int)str.size(), 
-                      &wstrTo[0], size_needed);
-  return wstrTo;
+const cyrene_music::MethodTable<MethodHandler>& Methods() {
+  static const cyrene_music::MethodTable<MethodHandler> methods{
+      {"create",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         result->Success(EncodableValue(window->Create()));
+       }},
+      {"destroy",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         window->Destroy();
+         result->Success(EncodableValue(true));
+       }},
+      {"show",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         window->Show();
+         result->Success(EncodableValue(true));
+       }},
+      {"hide",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         window->Hide();
+         result->Success(EncodableValue(true));
+       }},
+      {"isVisible",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         result->Success(EncodableValue(window->IsVisible()));
+       }},
+      {"setLyricText",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         std::string text;
+         if (!ArgsOk(DecodeArgs(args, Required("text", &text)), result)) return;
+         window->SetLyricText(std::move(text));
+         result->Success(EncodableValue(true));
+       }},
+      {"setLyricSheet",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         // Whole sheet once per track; lines are then shown by index
+         std::vector<std::string> lyrics, translations;
+         std::vector<int64_t> start_times;
+         if (!ArgsOk(DecodeArgs(args, Required("lyrics", &lyrics),
+                                Optional("translations", &translations),
+                                Optional("startTimes", &start_times)),
+                     result)) {
+           return;
+         }
+         window->SetLyricSheet(std::move(lyrics), std::move(translations),
+                               start_times);
+         result->Success(EncodableValue(true));
+       }},
+      {"showLyricLine",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         int64_t index = -1;
+         if (!ArgsOk(DecodeArgs(args, Required("index", &index)), result)) return;
+         result->Success(EncodableValue(
+             index >= 0 && window->ShowLyricLine(static_cast<size_t>(index))));
+       }},
+      {"setPosition",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         int x = 0;
+         int y = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("x", &x), Required("y", &y)),
+                     result)) {
+           return;
+         }
+         window->SetPosition(x, y);
+         result->Success(EncodableValue(true));
+       }},
+      {"getPosition",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         int x = 0;
+         int y = 0;
+         window->GetPosition(&x, &y);
+         EncodableMap position;
+         position[EncodableValue("x")] = EncodableValue(x);
+         position[EncodableValue("y")] = EncodableValue(y);
+         result->Success(EncodableValue(position));
+       }},
+      {"setFontSize",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         int size = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("size", &size)), result)) return;
+         window->SetFontSize(size);
+         result->Success(EncodableValue(true));
+       }},
+      {"setLyricDuration",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         // Duration for the scroll speed calculation
+         DWORD duration = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("duration", &duration)), result)) {
+           return;
+         }
+         window->SetLyricDuration(duration);
+         result->Success(EncodableValue(true));
+       }},
+      {"setTextColor",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         DWORD color = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("color", &color)), result)) return;
+         window->SetTextColor(color);
+         result->Success(EncodableValue(true));
+       }},
+      {"setStrokeColor",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         DWORD color = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("color", &color)), result)) return;
+         window->SetStrokeColor(color);
+         result->Success(EncodableValue(true));
+       }},
+      {"setStrokeWidth",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         int width = 0;
+         if (!ArgsOk(DecodeArgs(args, Required("width", &width)), result)) return;
+         window->SetStrokeWidth(width);
+         result->Success(EncodableValue(true));
+       }},
+      {"setDraggable",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool draggable = false;
+         if (!ArgsOk(DecodeArgs(args, Required("draggable", &draggable)), result)) {
+           return;
+         }
+         window->SetDraggable(draggable);
+         result->Success(EncodableValue(true));
+       }},
+      {"setMouseTransparent",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool transparent = false;
+         if (!ArgsOk(DecodeArgs(args, Required("transparent", &transparent)),
+                     result)) {
+           return;
+         }
+         window->SetMouseTransparent(transparent);
+         result->Success(EncodableValue(true));
+       }},
+      {"setSongInfo",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         // Title, artist and album cover are each optional
+         std::string title, artist, album_cover;
+         if (!ArgsOk(DecodeArgs(args, Optional("title", &title),
+                                Optional("artist", &artist),
+                                Optional("albumCover", &album_cover)),
+                     result)) {
+           return;
+         }
+         window->SetSongInfo(title, artist, std::move(album_cover));
+         result->Success(EncodableValue(true));
+       }},
+      {"setPlayingState",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool is_playing = false;
+         if (!ArgsOk(DecodeArgs(args, Required("isPlaying", &is_playing)), result)) {
+           return;
+         }
+         window->SetPlayingState(is_playing);
+         result->Success(EncodableValue(true));
+       }},
+      {"setTranslationText",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         std::string text;
+         if (!ArgsOk(DecodeArgs(args, Required("text", &text)), result)) return;
+         window->SetTranslationText(std::move(text));
+         result->Success(EncodableValue(true));
+       }},
+      {"setShowTranslation",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool show = false;
+         if (!ArgsOk(DecodeArgs(args, Required("show", &show)), result)) return;
+         window->SetShowTranslation(show);
+         result->Success(EncodableValue(true));
+       }},
+      {"getShowTranslation",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         result->Success(EncodableValue(window->GetShowTranslation()));
+       }},
+      {"setVertical",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool vertical = false;
+         if (!ArgsOk(DecodeArgs(args, Required("vertical", &vertical)), result)) {
+           return;
+         }
+         window->SetVertical(vertical);
+         result->Success(EncodableValue(true));
+       }},
+      {"getVertical",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         result->Success(EncodableValue(window->GetVertical()));
+       }},
+      {"setShowSpectrum",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         bool show = false;
+         if (!ArgsOk(DecodeArgs(args, Required("show", &show)), result)) return;
+         window->SetShowSpectrum(show);
+         result->Success(EncodableValue(true));
+       }},
+      {"getShowSpectrum",
+       [](DesktopLyricWindow* window, const EncodableMap*, MethodResult* result) {
+         result->Success(EncodableValue(window->GetShowSpectrum()));
+       }},
+      {"getRenderStats",
+       [](DesktopLyricWindow* window, const EncodableMap* args, MethodResult* result) {
+         // Render timing statistics, optionally reset after reading
+         bool reset = false;
+         if (args != nullptr) DecodeArgs(args, Optional("reset", &reset));
+         result->Success(RenderStatsToEncodable(window->GetRenderStats()));
+         if (reset) window->ResetRenderStats();
+       }},
+  };
+  return methods;
 }
 
 }  // namespace
 
 // static
 void DesktopLyricPlugin::RegisterWithRegistrar(
-    FlutterDesktopPluginRegistrarRef registrar_ref) {
+    FlutterDesktopPluginRegistrarRef registrar_ref,
+    std::chrono::milliseconds idle_release) {
   // Wrap registrar in PluginRegistrarWindows
   auto registrar = 
       flutter::PluginRegistrarManager::GetInstance()
           ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
-      
-  auto channel = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-      registrar->messenger(), "desktop_lyric",
-      &flutter::StandardMethodCodec::GetInstance());
-
-  auto plugin = std::make_unique<DesktopLyricPlugin>();
-  
-  // Store channel pointer in plugin for callbacks
-  plugin->method_channel_ = channel.get();
-
-  channel->SetMethodCallHandler(
-      [plugin_pointer = plugin.get()](const auto& call, auto result) {
-        plugin_pointer->HandleMethodCall(call, std::move(result));
-      });
 
-  // Keep plugin and channel alive - store in static maps
-  static std::map<FlutterDesktopPluginRegistrarRef, std::unique_ptr<DesktopLyricPlugin>> plugins;
-  static std::map<FlutterDesktopPluginRegistrarRef, std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>>> channels;
-  
-  plugins[registrar_ref] = std::move(plugin);
-  channels[registrar_ref] = std::move(channel);
+  registrar->AddPlugin(
+      std::make_unique<cyrene_music::LazyPlugin<DesktopLyricPlugin>>(
+          registrar->messenger(), "desktop_lyric", idle_release,
+          [](flutter::MethodChannel<flutter::EncodableValue>* channel) {
+            return std::make_unique<DesktopLyricPlugin>(channel);
+          }));
 }
 
-DesktopLyricPlugin::DesktopLyricPlugin()
+DesktopLyricPlugin::DesktopLyricPlugin(
+    flutter::MethodChannel<flutter::EncodableValue>* channel)
     : lyric_window_(std::make_unique<DesktopLyricWindow>()),
-      method_channel_(nullptr) {
+      method_channel_(channel) {
   // Set playback control callback
   lyric_window_->SetPlaybackControlCallback(
       [this](const std::string& action) {
@@ -76,265 +336,18 @@ DesktopLyricPlugin::~DesktopLyricPlugin() {
 void DesktopLyricPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue>& method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  const auto& method_name = method_call.method_name();
-
-  if (method_name == "create") {
-    // Create desktop lyric window
-    bool success = lyric_window_->Create();
-    result->Success(flutter::EncodableValue(success));
-    
-  } else if (method_name == "destroy") {
-    // Destroy window
-    lyric_window_->Destroy();
-    result->Success(flutter::EncodableValue(true));
-    
-  } else if (method_name == "show") {
-    // Show window
-    lyric_window_->Show();
-    result->Success(flutter::EncodableValue(true));
-    
-  } else if (method_name == "hide") {
-    // Hide window
-    lyric_window_->Hide();
-    result->Success(flutter::EncodableValue(true));
-    
-  } else if (method_name == "isVisible") {
-    // Check if window is visible
-    bool visible = lyric_window_->IsVisible();
-    result->Success(flutter::EncodableValue(visible));
-    
-  } else if (method_name == "setLyricText") {
-    // Set lyric text
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto text_it = arguments->find(flutter::EncodableValue("text"));
-      if (text_it != arguments->end()) {
-        std::string text = std::get<std::string>(text_it->second);
-        lyric_window_->SetLyricText(StringToWString(text));
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'text' argument");
-    
-  } else if (method_name == "setPosition") {
-    // Set window position
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto x_it = arguments->find(flutter::EncodableValue("x"));
-      auto y_it = arguments->find(flutter::EncodableValue("y"));
-      
-      if (x_it != arguments->end() && y_it != arguments->end()) {
-        int x = std::get<int>(x_it->second);
-        int y = std::get<int>(y_it->second);
-        lyric_window_->SetPosition(x, y);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'x' or 'y' argument");
-    
-  } else if (method_name == "getPosition") {
-    // Get window position
-    int x, y;
-    lyric_window_->GetPosition(&x, &y);
-    flutter::EncodableMap position;
-    position[flutter::EncodableValue("x")] = flutter::EncodableValue(x);
-    position[flutter::EncodableValue("y")] = flutter::EncodableValue(y);
-    result->Success(flutter::EncodableValue(position));
-    
-  } else if (method_name == "setFontSize") {
-    // Set font size
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto size_it = arguments->find(flutter::EncodableValue("size"));
-      if (size_it != arguments->end()) {
-        int size = std::get<int>(size_it->second);
-        lyric_window_->SetFontSize(size);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'size' argument");
-    
-  } else if (method_name == "setLyricDuration") {
-    // Set lyric duration for scroll speed calculation
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto duration_it = arguments->find(flutter::EncodableValue("duration"));
-      if (duration_it != arguments->end()) {
-        int duration = std::get<int>(duration_it->second);
-        lyric_window_->SetLyricDuration(static_cast<DWORD>(duration));
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'duration' argument");
-    
-  } else if (method_name == "setTextColor") {
-    // Set text color
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto color_it = arguments->find(flutter::EncodableValue("color"));
-      if (color_it != arguments->end()) {
-        int64_t color = std::get<int64_t>(color_it->second);
-        lyric_window_->SetTextColor(static_cast<DWORD>(color));
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'color' argument");
-    
-  } else if (method_name == "setStrokeColor") {
-    // Set stroke color
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto color_it = arguments->find(flutter::EncodableValue("color"));
-      if (color_it != arguments->end()) {
-        int64_t color = std::get<int64_t>(color_it->second);
-        lyric_window_->SetStrokeColor(static_cast<DWORD>(color));
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'color' argument");
-    
-  } else if (method_name == "setStrokeWidth") {
-    // Set stroke width
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto width_it = arguments->find(flutter::EncodableValue("width"));
-      if (width_it != arguments->end()) {
-        int width = std::get<int>(width_it->second);
-        lyric_window_->SetStrokeWidth(width);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'width' argument");
-    
-  } else if (method_name == "setDraggable") {
-    // Set draggable
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto draggable_it = arguments->find(flutter::EncodableValue("draggable"));
-      if (draggable_it != arguments->end()) {
-        bool draggable = std::get<bool>(draggable_it->second);
-        lyric_window_->SetDraggable(draggable);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'draggable' argument");
-    
-  } else if (method_name == "setMouseTransparent") {
-    // Set mouse transparent
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto transparent_it = arguments->find(flutter::EncodableValue("transparent"));
-      if (transparent_it != arguments->end()) {
-        bool transparent = std::get<bool>(transparent_it->second);
-        lyric_window_->SetMouseTransparent(transparent);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'transparent' argument");
-    
-  } else if (method_name == "setSongInfo") {
-    // Set song info (title, artist, album cover)
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto title_it = arguments->find(flutter::EncodableValue("title"));
-      auto artist_it = arguments->find(flutter::EncodableValue("artist"));
-      auto album_cover_it = arguments->find(flutter::EncodableValue("albumCover"));
-      
-      std::wstring title, artist, album_cover;
-      if (title_it != arguments->end()) {
-        title = StringToWString(std::get<std::string>(title_it->second));
-      }
-      if (artist_it != arguments->end()) {
-        artist = StringToWString(std::get<std::string>(artist_it->second));
-      }
-      if (album_cover_it != arguments->end()) {
-        album_cover = StringToWString(std::get<std::string>(album_cover_it->second));
-      }
-      
-      lyric_window_->SetSongInfo(title, artist, album_cover);
-      result->Success(flutter::EncodableValue(true));
-      return;
-    }
-    result->Error("INVALID_ARGUMENT", "Missing song info arguments");
-    
-  } else if (method_name == "setPlayingState") {
-    // Set playing state (for play/pause button icon)
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto playing_it = arguments->find(flutter::EncodableValue("isPlaying"));
-      if (playing_it != arguments->end()) {
-        bool is_playing = std::get<bool>(playing_it->second);
-        lyric_window_->SetPlayingState(is_playing);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'isPlaying' argument");
-    
-  } else if (method_name == "setTranslationText") {
-    // Set translation text
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto text_it = arguments->find(flutter::EncodableValue("text"));
-      if (text_it != arguments->end()) {
-        std::string text = std::get<std::string>(text_it->second);
-        lyric_window_->SetTranslationText(StringToWString(text));
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'text' argument");
-    
-  } else if (method_name == "setShowTranslation") {
-    // Set show translation state
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto show_it = arguments->find(flutter::EncodableValue("show"));
-      if (show_it != arguments->end()) {
-        bool show = std::get<bool>(show_it->second);
-        lyric_window_->SetShowTranslation(show);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'show' argument");
-    
-  } else if (method_name == "getShowTranslation") {
-    // Get show translation state
-    bool show = lyric_window_->GetShowTranslation();
-    result->Success(flutter::EncodableValue(show));
-    
-  } else if (method_name == "setVertical") {
-    // Set vertical layout mode
-    const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-    if (arguments) {
-      auto vertical_it = arguments->find(flutter::EncodableValue("vertical"));
-      if (vertical_it != arguments->end()) {
-        bool vertical = std::get<bool>(vertical_it->second);
-        lyric_window_->SetVertical(vertical);
-        result->Success(flutter::EncodableValue(true));
-        return;
-      }
-    }
-    result->Error("INVALID_ARGUMENT", "Missing 'vertical' argument");
-    
-  } else if (method_name == "getVertical") {
-    // Get vertical layout mode
-    bool vertical = lyric_window_->GetVertical();
-    result->Success(flutter::EncodableValue(vertical));
-    
-  } else {
+  const MethodHandler* handler = Methods().Find(method_call.method_name());
+  if (handler == nullptr) {
     result->NotImplemented();
+    return;
   }
+  (*handler)(lyric_window_.get(),
+             std::get_if<flutter::EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+bool DesktopLyricPlugin::CanRelease() const {
+  return !lyric_window_->IsCreated();
 }
 
 void DesktopLyricPlugin::OnPlaybackControl(const std::string& action) {
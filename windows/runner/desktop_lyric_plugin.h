@@ -4,24 +4,33 @@
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
+#include <chrono>
 #include <memory>
 
 #include "desktop_lyric_window.h"
 
-// Desktop lyric plugin for Flutter
+// Desktop lyric plugin for Flutter. Registered as a channel stub: the lyric
+// window (and GDI+) only come up on the first call, and go away again once
+// the window has been destroyed and the channel has been idle for
+// |idle_release|.
 class DesktopLyricPlugin {
  public:
-  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar,
+                                    std::chrono::milliseconds idle_release);
 
-  DesktopLyricPlugin();
+  explicit DesktopLyricPlugin(
+      flutter::MethodChannel<flutter::EncodableValue>* channel);
   virtual ~DesktopLyricPlugin();
 
- private:
   // Handle method calls from Dart
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue>& method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
-  
+
+  // True while no lyric window exists.
+  bool CanRelease() const;
+
+ private:
   // Playback control callback
   void OnPlaybackControl(const std::string& action);
 
@@ -3,6 +3,10 @@
 #include <gdiplus.h>
 #include <windowsx.h>
 #include <algorithm>
+#include <utility>
+
+#include "gdiplus_text_rasterizer.h"
+#include "utils.h"
 
 #pragma comment(lib, "dwmapi.lib")
 #pragma comment(lib, "gdiplus.lib")
@@ -13,10 +17,13 @@ const int kDefaultFontSize = 32;
 const DWORD kDefaultTextColor = 0xFFFFFFFF;  // White
 const DWORD kDefaultStrokeColor = 0xFF000000;  // Black
 const int kDefaultStrokeWidth = 2;
-const int kWindowWidth = 800;
-const int kWindowHeight = 100;
-const int kControlPanelHeight = 180;  // Height when showing controls
 const int kHoverDelay = 300;  // ms to wait before showing controls
+const int kScrollFrameIntervalMs = 30;  // ~33fps refresh for smooth scrolling
+
+using cyrene_music::ArgbSurface;
+using cyrene_music::LyricStyle;
+using cyrene_music::RenderStats;
+namespace lyric_layout = cyrene_music::lyric_layout;
 
 // GDI+ initialization
 ULONG_PTR gdiplusToken = 0;
@@ -35,181 +42,6 @@ void ShutdownGdiPlus() {
   }
 }
 
-// Check if a character is CJK (Chinese, Japanese, Korean)
-bool IsCJKCharacter(wchar_t ch) {
-  // CJK Unified Ideographs
-  if (ch >= 0x4E00 && ch <= 0x9FFF) return true;
-  // CJK Unified Ideographs Extension A
-  if (ch >= 0x3400 && ch <= 0x4DBF) return true;
-  // Hiragana
-  if (ch >= 0x3040 && ch <= 0x309F) return true;
-  // Katakana
-  if (ch >= 0x30A0 && ch <= 0x30FF) return true;
-  // Full-width characters
-  if (ch >= 0xFF00 && ch <= 0xFFEF) return true;
-  // CJK Symbols and Punctuation
-  if (ch >= 0x3000 && ch <= 0x303F) return true;
-  // Hangul (Korean)
-  if (ch >= 0xAC00 && ch <= 0xD7AF) return true;
-  // CJK Compatibility Ideographs
-  if (ch >= 0xF900 && ch <= 0xFAFF) return true;
-  return false;
-}
-
-// Draw a single character with optional rotation (for CJK in vertical mode)
-void DrawCharWithRotation(Gdiplus::Graphics& graphics, wchar_t ch, 
-                          Gdiplus::FontFamily* fontFamily, int fontSize, int strokeWidth,
-                          DWORD textColor, DWORD strokeColor,
-                          float x, float y, float charWidth, float charHeight,
-                          bool rotateCJK) {
-  wchar_t str[2] = { ch, 0 };
-  
-  bool isCJK = IsCJKCharacter(ch);
-  bool needRotate = rotateCJK && isCJK;
-  
-  Gdiplus::GraphicsState state = graphics.Save();
-  
-  if (needRotate) {
-    // Rotate CJK character -90° (counter-clockwise) around its center
-    // This makes CJK characters appear upright in vertical mode
-    float centerX = x + charWidth / 2;
-    float centerY = y + charHeight / 2;
-    graphics.TranslateTransform(centerX, centerY);
-    graphics.RotateTransform(-90.0f);
-    graphics.TranslateTransform(-centerX, -centerY);
-  }
-  
-  Gdiplus::StringFormat format;
-  format.SetAlignment(Gdiplus::StringAlignmentCenter);
-  format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
-  
-  Gdiplus::RectF charRect(x, y, charWidth, charHeight);
-  
-  if (strokeWidth > 0) {
-    Gdiplus::GraphicsPath path;
-    path.AddString(str, -1, fontFamily, Gdiplus::FontStyleBold, 
-                   static_cast<Gdiplus::REAL>(fontSize), charRect, &format);
-    
-    Gdiplus::Pen strokePen(Gdiplus::Color(
-        (strokeColor >> 24) & 0xFF, (strokeColor >> 16) & 0xFF,
-        (strokeColor >> 8) & 0xFF, strokeColor & 0xFF
-    ), static_cast<Gdiplus::REAL>(strokeWidth));
-    strokePen.SetLineJoin(Gdiplus::LineJoinRound);
-    graphics.DrawPath(&strokePen, &path);
-    
-    Gdiplus::SolidBrush fillBrush(Gdiplus::Color(
-        (textColor >> 24) & 0xFF, (textColor >> 16) & 0xFF,
-        (textColor >> 8) & 0xFF, textColor & 0xFF
-    ));
-    graphics.FillPath(&fillBrush, &path);
-  } else {
-    Gdiplus::Font font(fontFamily, static_cast<Gdiplus::REAL>(fontSize), 
-                       Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
-    Gdiplus::SolidBrush textBrush(Gdiplus::Color(
-        (textColor >> 24) & 0xFF, (textColor >> 16) & 0xFF,
-        (textColor >> 8) & 0xFF, textColor & 0xFF
-    ));
-    graphics.DrawString(str, -1, &font, charRect, &format, &textBrush);
-  }
-  
-  graphics.Restore(state);
-}
-
-// Draw a segment of non-CJK text (Latin characters) as a continuous string
-void DrawLatinSegment(Gdiplus::Graphics& graphics, const std::wstring& segment,
-                      Gdiplus::FontFamily* fontFamily, int fontSize, int strokeWidth,
-                      DWORD textColor, DWORD strokeColor,
-                      float x, float y, float height) {
-  Gdiplus::Font font(fontFamily, static_cast<Gdiplus::REAL>(fontSize), 
-                     Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
-  
-  // Measure segment width
-  Gdiplus::RectF measureRect(0, 0, 10000, height);
-  Gdiplus::RectF bounds;
-  Gdiplus::StringFormat measureFormat;
-  graphics.MeasureString(segment.c_str(), -1, &font, measureRect, &measureFormat, &bounds);
-  
-  Gdiplus::StringFormat format;
-  format.SetAlignment(Gdiplus::StringAlignmentNear);
-  format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
-  
-  Gdiplus::RectF textRect(x, y, bounds.Width, height);
-  
-  if (strokeWidth > 0) {
-    Gdiplus::GraphicsPath path;
-    path.AddString(segment.c_str(), -1, fontFamily, Gdiplus::FontStyleBold,
-                   static_cast<Gdiplus::REAL>(fontSize), textRect, &format);
-    
-    Gdiplus::Pen strokePen(Gdiplus::Color(
-        (strokeColor >> 24) & 0xFF, (strokeColor >> 16) & 0xFF,
-        (strokeColor >> 8) & 0xFF, strokeColor & 0xFF
-    ), static_cast<Gdiplus::REAL>(strokeWidth));
-    strokePen.SetLineJoin(Gdiplus::LineJoinRound);
-    graphics.DrawPath(&strokePen, &path);
-    
-    Gdiplus::SolidBrush fillBrush(Gdiplus::Color(
-        (textColor >> 24) & 0xFF, (textColor >> 16) & 0xFF,
-        (textColor >> 8) & 0xFF, textColor & 0xFF
-    ));
-    graphics.FillPath(&fillBrush, &path);
-  } else {
-    Gdiplus::SolidBrush textBrush(Gdiplus::Color(
-        (textColor >> 24) & 0xFF, (textColor >> 16) & 0xFF,
-        (textColor >> 8) & 0xFF, textColor & 0xFF
-    ));
-    graphics.DrawString(segment.c_str(), -1, &font, textRect, &format, &textBrush);
-  }
-}
-
-// Draw text with per-character rotation for CJK in vertical mode
-// Latin characters are drawn as continuous strings to preserve proper spacing
-void DrawVerticalModeText(Gdiplus::Graphics& graphics, const std::wstring& text,
-                          Gdiplus::FontFamily* fontFamily, int fontSize, int strokeWidth,
-                          DWORD textColor, DWORD strokeColor,
-                          float startX, float y, float height, float scrollOffset = 0.0f) {
-  Gdiplus::Font measureFont(fontFamily, static_cast<Gdiplus::REAL>(fontSize), 
-                            Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
-  Gdiplus::RectF measureRect(0, 0, 10000, static_cast<Gdiplus::REAL>(height));
-  Gdiplus::StringFormat measureFormat;
-  
-  float x = startX - scrollOffset;
-  size_t i = 0;
-  
-  while (i < text.length()) {
-    wchar_t ch = text[i];
-    
-    if (IsCJKCharacter(ch)) {
-      // Draw CJK character with rotation
-      wchar_t str[2] = { ch, 0 };
-      Gdiplus::RectF charBounds;
-      graphics.MeasureString(str, -1, &measureFont, measureRect, &measureFormat, &charBounds);
-      float charWidth = charBounds.Width > 0 ? charBounds.Width : fontSize * 1.0f;
-      
-      DrawCharWithRotation(graphics, ch, fontFamily, fontSize, strokeWidth,
-                           textColor, strokeColor, x, y, charWidth, height, true);
-      x += charWidth;
-      i++;
-    } else {
-      // Collect consecutive non-CJK characters
-      std::wstring latinSegment;
-      while (i < text.length() && !IsCJKCharacter(text[i])) {
-        latinSegment += text[i];
-        i++;
-      }
-      
-      // Measure the segment width
-      Gdiplus::RectF segmentBounds;
-      graphics.MeasureString(latinSegment.c_str(), -1, &measureFont, measureRect, &measureFormat, &segmentBounds);
-      
-      // Draw the Latin segment as a continuous string (no rotation)
-      DrawLatinSegment(graphics, latinSegment, fontFamily, fontSize, strokeWidth,
-                       textColor, strokeColor, x, y, height);
-      
-      x += segmentBounds.Width;
-    }
-  }
-}
-
 // Helper to apply -90° rotation around a point for button icons in vertical mode
 // Returns the saved graphics state for later restoration
 Gdiplus::GraphicsState ApplyButtonRotation(Gdiplus::Graphics& graphics, bool isVertical, 
@@ -227,10 +59,6 @@ Gdiplus::GraphicsState ApplyButtonRotation(Gdiplus::Graphics& graphics, bool isV
 
 DesktopLyricWindow::DesktopLyricWindow()
     : hwnd_(nullptr),
-      lyric_text_(L""),
-      song_title_(L""),
-      song_artist_(L""),
-      album_cover_url_(L""),
       font_size_(kDefaultFontSize),
       text_color_(kDefaultTextColor),
       stroke_color_(kDefaultStrokeColor),
@@ -243,37 +71,32 @@ DesktopLyricWindow::DesktopLyricWindow()
       hover_start_time_(0),
       is_playing_(false),
       show_translation_(true),
-      translation_text_(L""),
-      lyric_scroll_offset_(0.0f),
-      trans_scroll_offset_(0.0f),
-      lyric_needs_scroll_(false),
-      trans_needs_scroll_(false),
-      lyric_text_width_(0.0f),
-      trans_text_width_(0.0f),
-      last_scroll_time_(0),
-      lyric_scroll_pause_start_(0),
-      trans_scroll_pause_start_(0),
-      lyric_duration_ms_(3000),  // Default 3 seconds
-      lyric_scroll_speed_(0.0f),
-      trans_scroll_speed_(0.0f),
+      panel_text_stale_(false),
+      scroll_animating_(false),
       playback_callback_(nullptr),
       is_vertical_(false) {
   InitGdiPlus();
   
-  // Initialize button rects
-  memset(&play_pause_button_rect_, 0, sizeof(RECT));
-  memset(&prev_button_rect_, 0, sizeof(RECT));
-  memset(&next_button_rect_, 0, sizeof(RECT));
-  memset(&font_size_up_rect_, 0, sizeof(RECT));
-  memset(&font_size_down_rect_, 0, sizeof(RECT));
-  memset(&color_picker_rect_, 0, sizeof(RECT));
-  memset(&translation_toggle_rect_, 0, sizeof(RECT));
-  memset(&close_button_rect_, 0, sizeof(RECT));
-  memset(&vertical_toggle_rect_, 0, sizeof(RECT));
+  // The rasterizer holds GDI+ objects, so it lives strictly inside the
+  // GDI+ startup/shutdown pair.
+  text_rasterizer_ = std::make_unique<cyrene_music::GdiplusTextRasterizer>();
+  glyph_atlas_ = std::make_unique<cyrene_music::GlyphAtlasRasterizer>(text_rasterizer_.get());
+  lyric_renderer_ = std::make_unique<cyrene_music::LyricRenderer>(glyph_atlas_.get());
+  lyric_renderer_->SetPlaybackClock(&cyrene_music::PlaybackClock::Shared());
+  LyricStyle style;
+  style.font_size = font_size_;
+  style.stroke_width = stroke_width_;
+  style.text_color = text_color_;
+  style.stroke_color = stroke_color_;
+  lyric_renderer_->SetStyle(style);
 }
 
 DesktopLyricWindow::~DesktopLyricWindow() {
+  SetShowSpectrum(false);
   Destroy();
+  lyric_renderer_.reset();
+  glyph_atlas_.reset();
+  text_rasterizer_.reset();
   ShutdownGdiPlus();
 }
 
@@ -300,8 +123,8 @@ bool DesktopLyricWindow::Create() {
   int screen_height = GetSystemMetrics(SM_CYSCREEN);
   
   // Default position: center bottom
-  int x = (screen_width - kWindowWidth) / 2;
-  int y = screen_height - kWindowHeight - 100;
+  int x = (screen_width - lyric_layout::kWindowWidth) / 2;
+  int y = screen_height - lyric_layout::kWindowHeight - 100;
 
   // Create layered window
   hwnd_ = CreateWindowEx(
@@ -309,7 +132,7 @@ bool DesktopLyricWindow::Create() {
       kWindowClassName,
       L"Desktop Lyric",
       WS_POPUP,
-      x, y, kWindowWidth, kWindowHeight,
+      x, y, lyric_layout::kWindowWidth, lyric_layout::kWindowHeight,
       nullptr,
       nullptr,
       GetModuleHandle(nullptr),
@@ -333,6 +156,7 @@ bool DesktopLyricWindow::Create() {
 }
 
 void DesktopLyricWindow::Destroy() {
+  SetScrollTimer(false);
   if (hwnd_ != nullptr) {
     DestroyWindow(hwnd_);
     hwnd_ = nullptr;
@@ -361,23 +185,37 @@ bool DesktopLyricWindow::IsVisible() const {
   return hwnd_ != nullptr && IsWindowVisible(hwnd_);
 }
 
-void DesktopLyricWindow::SetLyricText(const std::wstring& text) {
-  // Reset scroll state when lyric changes
-  if (lyric_text_ != text) {
-    lyric_scroll_offset_ = 0.0f;
-    lyric_needs_scroll_ = false;
-    lyric_text_width_ = 0.0f;
-    lyric_scroll_pause_start_ = GetTickCount();
-    lyric_scroll_speed_ = 0.0f;  // Will be calculated in DrawLyric
+void DesktopLyricWindow::SetLyricText(std::string text) {
+  // The renderer keeps the UTF-8 text and resets the scroll on a change
+  if (lyric_renderer_->SetLyric(std::move(text), GetTickCount64())) {
+    render_stats_.BeginLine();
+    panel_text_stale_ = true;
   }
-  lyric_text_ = text;
   if (IsVisible()) {
     UpdateWindow();
   }
 }
 
+void DesktopLyricWindow::SetLyricSheet(std::vector<std::string> lyrics,
+                                       std::vector<std::string> translations,
+                                       const std::vector<int64_t>& start_times_ms) {
+  lyric_sheet_.Load(std::move(lyrics), std::move(translations), start_times_ms);
+}
+
+bool DesktopLyricWindow::ShowLyricLine(size_t index) {
+  cyrene_music::LyricSheet::Line line;
+  if (!lyric_sheet_.GetLine(index, &line)) return false;
+  // Set text first so the window is only redrawn once for both rows
+  if (lyric_renderer_->SetTranslation(*line.translation, GetTickCount64())) {
+    panel_text_stale_ = true;
+  }
+  SetLyricDuration(line.duration_ms);
+  SetLyricText(*line.text);
+  return true;
+}
+
 void DesktopLyricWindow::SetLyricDuration(DWORD duration_ms) {
-  lyric_duration_ms_ = duration_ms > 0 ? duration_ms : 3000;
+  lyric_renderer_->SetLineDuration(duration_ms);
 }
 
 void DesktopLyricWindow::SetPosition(int x, int y) {
@@ -399,6 +237,11 @@ void DesktopLyricWindow::GetPosition(int* x, int* y) {
 void DesktopLyricWindow::SetFontSize(int size) {
   font_size_ = size;
   
+  // Line bitmaps are keyed by style, so old sizes simply age out of the cache
+  LyricStyle style = lyric_renderer_->style();
+  style.font_size = size;
+  lyric_renderer_->SetStyle(style);
+  
   // Recreate font
   if (font_ != nullptr) {
     DeleteObject(font_);
@@ -417,6 +260,9 @@ void DesktopLyricWindow::SetFontSize(int size) {
 
 void DesktopLyricWindow::SetTextColor(DWORD color) {
   text_color_ = color;
+  LyricStyle style = lyric_renderer_->style();
+  style.text_color = color;
+  lyric_renderer_->SetStyle(style);
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -424,6 +270,9 @@ void DesktopLyricWindow::SetTextColor(DWORD color) {
 
 void DesktopLyricWindow::SetStrokeColor(DWORD color) {
   stroke_color_ = color;
+  LyricStyle style = lyric_renderer_->style();
+  style.stroke_color = color;
+  lyric_renderer_->SetStyle(style);
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -431,6 +280,9 @@ void DesktopLyricWindow::SetStrokeColor(DWORD color) {
 
 void DesktopLyricWindow::SetStrokeWidth(int width) {
   stroke_width_ = width;
+  LyricStyle style = lyric_renderer_->style();
+  style.stroke_width = width;
+  lyric_renderer_->SetStyle(style);
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -452,10 +304,14 @@ void DesktopLyricWindow::SetMouseTransparent(bool transparent) {
   SetWindowLong(hwnd_, GWL_EXSTYLE, exStyle);
 }
 
-void DesktopLyricWindow::SetSongInfo(const std::wstring& title, const std::wstring& artist, const std::wstring& album_cover) {
-  song_title_ = title;
-  song_artist_ = artist;
-  album_cover_url_ = album_cover;
+void DesktopLyricWindow::SetSongInfo(const std::string& title, const std::string& artist, std::string album_cover) {
+  // Once per track, and only for the hover panel
+  song_title_ = Utf16FromUtf8(title.data(), title.size());
+  song_artist_ = Utf16FromUtf8(artist.data(), artist.size());
+  if (album_cover != album_cover_url_) {
+    album_cover_url_ = std::move(album_cover);
+    panel_cover_.reset();
+  }
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -467,393 +323,112 @@ void DesktopLyricWindow::SetPlaybackControlCallback(PlaybackControlCallback call
 
 void DesktopLyricWindow::SetPlayingState(bool is_playing) {
   is_playing_ = is_playing;
-  if (IsVisible() && show_controls_) {
-    UpdateWindow();  // Refresh to show updated button icon
+  if (IsVisible()) {
+    // Refresh the button icon, and restart the marquee timer on resume; the
+    // renderer holds the scroll while the playback clock says paused.
+    UpdateWindow();
   }
 }
 
+bool DesktopLyricWindow::HasTranslation() const {
+  return lyric_renderer_->has_translation();
+}
+
 int DesktopLyricWindow::GetControlPanelHeight() const {
-  // Calculate height based on font size:
-  // - Header area (song title + artist): ~70px
-  // - Lyric area: font_size_ + padding (~10px)
-  // - Translation area (if enabled): font_size_ * 0.7 + 5
-  // - Button row 1: ~46px (36 button + 10 spacing)
-  // - Button row 2: ~38px (28 button + 10 spacing)
-  // - Bottom padding: ~15px
-  int height = 70 + font_size_ + 10;
-  if (show_translation_ && !translation_text_.empty()) {
-    height += static_cast<int>(font_size_ * 0.7f) + 5;
-  }
-  height += 15 + 36 + 10 + 28 + 15;  // spacing + row1 + gap + row2 + bottom
-  return height;
+  return lyric_layout::ControlPanelHeight(font_size_, HasTranslation());
 }
 
-void DesktopLyricWindow::UpdateWindow() {
+int DesktopLyricWindow::GetNormalHeight() const {
+  return lyric_layout::NormalWindowHeight(font_size_, HasTranslation());
+}
+
+void DesktopLyricWindow::UpdateWindow(int expected_interval_ms) {
   if (hwnd_ == nullptr) return;
 
-  int current_width, current_height;
-  
-  // Calculate "logical" horizontal dimensions first
-  int logical_width = kWindowWidth;
-  int logical_height;
-  
-  if (show_controls_) {
-    logical_height = GetControlPanelHeight();
-  } else {
-    // Normal mode: adjust height based on whether translation is shown
-    bool hasTranslation = show_translation_ && !translation_text_.empty();
-    if (hasTranslation) {
-      logical_height = kWindowHeight + static_cast<int>(font_size_ * 0.6f) + 10;
-    } else {
-      logical_height = kWindowHeight;
-    }
-  }
-  
-  if (is_vertical_) {
-    // Vertical mode: swap width and height (rotate 90°)
-    current_width = logical_height;
-    current_height = logical_width;
-  } else {
-    // Horizontal mode: use logical dimensions directly
-    current_width = logical_width;
-    current_height = logical_height;
-  }
+  render_stats_.BeginFrame(expected_interval_ms);
+
+  // Calculate "logical" horizontal dimensions first; vertical mode swaps them
+  const int logical_width = lyric_layout::kWindowWidth;
+  const int logical_height =
+      show_controls_ ? GetControlPanelHeight() : GetNormalHeight();
+  const lyric_layout::WindowSize size = lyric_layout::PhysicalWindowSize(
+      logical_width, logical_height, is_vertical_);
 
   // Create memory DC
   HDC hdc_screen = GetDC(nullptr);
   HDC hdc_mem = CreateCompatibleDC(hdc_screen);
-  
-  // Create 32-bit bitmap with dynamic size
-  BITMAPINFO bmi = {};
-  bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
-  bmi.bmiHeader.biWidth = current_width;
-  bmi.bmiHeader.biHeight = -current_height;  // Negative means top-down
-  bmi.bmiHeader.biPlanes = 1;
-  bmi.bmiHeader.biBitCount = 32;
-  bmi.bmiHeader.biCompression = BI_RGB;
-  
+  HBITMAP hbm = nullptr;
+  HBITMAP hbm_old = nullptr;
   void* bits = nullptr;
-  HBITMAP hbm = CreateDIBSection(hdc_mem, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
-  HBITMAP hbm_old = (HBITMAP)SelectObject(hdc_mem, hbm);
-  
-  // Draw lyric with dynamic size
-  DrawLyric(hdc_mem, current_width, current_height);
   
-  // Update layered window with dynamic size
-  POINT pt_src = {0, 0};
-  SIZE size = {current_width, current_height};
-  BLENDFUNCTION blend = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
-  
-  UpdateLayeredWindow(hwnd_, hdc_screen, nullptr, &size, hdc_mem, &pt_src,
-                      0, &blend, ULW_ALPHA);
-  
-  // Cleanup
-  SelectObject(hdc_mem, hbm_old);
-  DeleteObject(hbm);
-  DeleteDC(hdc_mem);
-  ReleaseDC(nullptr, hdc_screen);
-}
-
-void DesktopLyricWindow::DrawLyric(HDC hdc, int width, int height) {
-  // Use GDI+ to draw text (better anti-aliasing and stroke)
-  Gdiplus::Graphics graphics(hdc);
-  graphics.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias);
-  graphics.SetTextRenderingHint(Gdiplus::TextRenderingHintAntiAlias);
-  
-  // Clear background (transparent)
-  graphics.Clear(Gdiplus::Color(0, 0, 0, 0));
-  
-  // In vertical mode, apply 90° clockwise rotation
-  // This rotates the horizontal layout to become vertical
-  int draw_width = width;
-  int draw_height = height;
-  if (is_vertical_) {
-    // Rotate 90° clockwise: (x,y) -> (height-y, x)
-    // We'll draw in "logical horizontal" space with swapped dimensions
-    draw_width = height;
-    draw_height = width;
+  {
+    RenderStats::ScopedPhase phase(&render_stats_, RenderStats::Phase::kRasterise);
     
-    // Apply rotation transform
-    graphics.TranslateTransform(static_cast<Gdiplus::REAL>(width) / 2.0f, 
-                                 static_cast<Gdiplus::REAL>(height) / 2.0f);
-    graphics.RotateTransform(90.0f);
-    graphics.TranslateTransform(-static_cast<Gdiplus::REAL>(height) / 2.0f, 
-                                 -static_cast<Gdiplus::REAL>(width) / 2.0f);
+    // Create 32-bit bitmap with dynamic size
+    BITMAPINFO bmi = {};
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = size.width;
+    bmi.bmiHeader.biHeight = -size.height;  // Negative means top-down
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+    
+    hbm = CreateDIBSection(hdc_mem, &bmi, DIB_RGB_COLORS, &bits, nullptr, 0);
+    hbm_old = (HBITMAP)SelectObject(hdc_mem, hbm);
   }
   
-  // Show control panel on hover (works in both horizontal and vertical modes)
   if (show_controls_) {
-    DrawControlPanel(hdc, draw_width, draw_height);
-    return;
+    // Show control panel on hover (works in both horizontal and vertical modes)
+    RenderStats::ScopedPhase phase(&render_stats_, RenderStats::Phase::kRasterise);
+    DrawControlPanel(hdc_mem, logical_width, logical_height);
+    scroll_animating_ = false;
+  } else if (bits != nullptr) {
+    // The DIB is top-down premultiplied BGRA, which is the renderer's native
+    // format, so frames are composed straight into it.
+    ArgbSurface surface(static_cast<uint32_t*>(bits), size.width, size.height,
+                        size.width * 4);
+    scroll_animating_ =
+        lyric_renderer_->RenderFrame(GetTickCount64(), &surface, &render_stats_);
   }
   
-  if (lyric_text_.empty()) {
-    return;
-  }
-  
-  // Create font
-  Gdiplus::FontFamily fontFamily(L"Microsoft YaHei");
-  Gdiplus::Font font(&fontFamily, static_cast<Gdiplus::REAL>(font_size_), 
-                     Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
-  
-  // Calculate layout based on whether translation is shown
-  bool hasTranslation = show_translation_ && !translation_text_.empty();
-  int lyric_height = font_size_ + 10;
-  int trans_height = hasTranslation ? static_cast<int>(font_size_ * 0.6f) + 5 : 0;
-  int total_content_height = lyric_height + trans_height;
-  int start_y = (draw_height - total_content_height) / 2;
-  
-  // Measure lyric text width
-  Gdiplus::RectF measureRect(0, 0, 10000, static_cast<Gdiplus::REAL>(lyric_height));
-  Gdiplus::RectF lyricBounds;
-  Gdiplus::StringFormat measureFormat;
-  measureFormat.SetAlignment(Gdiplus::StringAlignmentNear);
-  measureFormat.SetLineAlignment(Gdiplus::StringAlignmentCenter);
-  graphics.MeasureString(lyric_text_.c_str(), -1, &font, measureRect, &measureFormat, &lyricBounds);
-  lyric_text_width_ = lyricBounds.Width;
-  
-  // Check if lyric needs scrolling (with some padding)
-  const float padding = 40.0f;
-  lyric_needs_scroll_ = lyric_text_width_ > (draw_width - padding);
-  
-  // Calculate scroll offset for lyric
-  DWORD currentTime = GetTickCount();
-  float lyric_x_offset = 0.0f;
-  
-  if (lyric_needs_scroll_) {
-    float maxScroll = lyric_text_width_ - draw_width + padding;
+  {
+    RenderStats::ScopedPhase phase(&render_stats_, RenderStats::Phase::kPresent);
     
-    // Calculate scroll speed if not yet calculated
-    // Speed = distance / (available_time - pause_time)
-    // Use 90% of duration to ensure completion before next lyric
-    if (lyric_scroll_speed_ <= 0.0f && maxScroll > 0) {
-      float available_time_ms = lyric_duration_ms_ * 0.9f - kScrollPauseMs;
-      if (available_time_ms > 100) {  // At least 100ms for scrolling
-        lyric_scroll_speed_ = maxScroll / (available_time_ms / 1000.0f);
-      } else {
-        lyric_scroll_speed_ = maxScroll * 2.0f;  // Fast scroll if very short duration
-      }
-    }
+    // Update layered window with dynamic size
+    POINT pt_src = {0, 0};
+    SIZE window_size = {size.width, size.height};
+    BLENDFUNCTION blend = {AC_SRC_OVER, 0, 255, AC_SRC_ALPHA};
     
-    // Initial pause before scrolling starts
-    if (lyric_scroll_pause_start_ > 0) {
-      if (currentTime - lyric_scroll_pause_start_ >= kScrollPauseMs) {
-        lyric_scroll_pause_start_ = 0;  // End pause, start scrolling
-      }
-    } else if (lyric_scroll_offset_ < maxScroll) {
-      // Scroll from left to right (only once)
-      float scrollDelta = lyric_scroll_speed_ * (currentTime - last_scroll_time_) / 1000.0f;
-      lyric_scroll_offset_ += scrollDelta;
-      if (lyric_scroll_offset_ > maxScroll) {
-        lyric_scroll_offset_ = maxScroll;  // Stop at the end
-      }
-    }
-    lyric_x_offset = -lyric_scroll_offset_;
+    UpdateLayeredWindow(hwnd_, hdc_screen, nullptr, &window_size, hdc_mem,
+                        &pt_src, 0, &blend, ULW_ALPHA);
   }
   
-  // Layout rect for main lyric (with scroll offset)
-  Gdiplus::StringFormat format;
-  format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
-  
-  if (lyric_needs_scroll_) {
-    format.SetAlignment(Gdiplus::StringAlignmentNear);
-  } else {
-    format.SetAlignment(Gdiplus::StringAlignmentCenter);
-  }
-  
-  Gdiplus::RectF lyricRect(
-    lyric_needs_scroll_ ? lyric_x_offset + padding / 2 : 0,
-    static_cast<Gdiplus::REAL>(start_y), 
-    lyric_needs_scroll_ ? lyric_text_width_ + padding : static_cast<Gdiplus::REAL>(draw_width), 
-    static_cast<Gdiplus::REAL>(lyric_height)
-  );
-  
-  // Set clipping region to prevent text from drawing outside window
-  graphics.SetClip(Gdiplus::RectF(0, static_cast<Gdiplus::REAL>(start_y), 
-                                   static_cast<Gdiplus::REAL>(draw_width), 
-                                   static_cast<Gdiplus::REAL>(lyric_height)));
-  
-  // Draw main lyric
-  if (is_vertical_) {
-    // In vertical mode, draw character by character with CJK rotation
-    Gdiplus::FontFamily lyricFontFamily(L"Microsoft YaHei");
-    float startX = lyric_needs_scroll_ ? padding / 2 : (draw_width - lyric_text_width_) / 2;
-    DrawVerticalModeText(graphics, lyric_text_, &lyricFontFamily, font_size_, stroke_width_,
-                         text_color_, stroke_color_, startX, 
-                         static_cast<float>(start_y), static_cast<float>(lyric_height),
-                         lyric_scroll_offset_);
-  } else {
-    // Horizontal mode: draw as before
-    if (stroke_width_ > 0) {
-      Gdiplus::GraphicsPath path;
-      Gdiplus::FontFamily fontFamilyPath(L"Microsoft YaHei");
-      path.AddString(lyric_text_.c_str(), -1, &fontFamilyPath, 
-                     Gdiplus::FontStyleBold, static_cast<Gdiplus::REAL>(font_size_),
-                     lyricRect, &format);
-      
-      Gdiplus::Pen stroke_pen(Gdiplus::Color(
-          (stroke_color_ >> 24) & 0xFF,
-          (stroke_color_ >> 16) & 0xFF,
-          (stroke_color_ >> 8) & 0xFF,
-          stroke_color_ & 0xFF
-      ), static_cast<Gdiplus::REAL>(stroke_width_));
-      
-      stroke_pen.SetLineJoin(Gdiplus::LineJoinRound);
-      graphics.DrawPath(&stroke_pen, &path);
-      
-      Gdiplus::SolidBrush text_brush(Gdiplus::Color(
-          (text_color_ >> 24) & 0xFF,
-          (text_color_ >> 16) & 0xFF,
-          (text_color_ >> 8) & 0xFF,
-          text_color_ & 0xFF
-      ));
-      graphics.FillPath(&text_brush, &path);
-    } else {
-      Gdiplus::SolidBrush text_brush(Gdiplus::Color(
-          (text_color_ >> 24) & 0xFF,
-          (text_color_ >> 16) & 0xFF,
-          (text_color_ >> 8) & 0xFF,
-          text_color_ & 0xFF
-      ));
-      graphics.DrawString(lyric_text_.c_str(), -1, &font, lyricRect, &format, &text_brush);
-    }
-  }
+  // Cleanup
+  SelectObject(hdc_mem, hbm_old);
+  DeleteObject(hbm);
+  DeleteDC(hdc_mem);
+  ReleaseDC(nullptr, hdc_screen);
   
-  // Reset clipping
-  graphics.ResetClip();
+  render_stats_.EndFrame();
   
-  // Draw translation if enabled and available
-  if (hasTranslation) {
-    Gdiplus::Font trans_font(&fontFamily, static_cast<Gdiplus::REAL>(font_size_ * 0.6f), 
-                              Gdiplus::FontStyleRegular, Gdiplus::UnitPixel);
-    
-    // Measure translation text width
-    Gdiplus::RectF transMeasureRect(0, 0, 10000, static_cast<Gdiplus::REAL>(trans_height));
-    Gdiplus::RectF transBounds;
-    graphics.MeasureString(translation_text_.c_str(), -1, &trans_font, transMeasureRect, &measureFormat, &transBounds);
-    trans_text_width_ = transBounds.Width;
-    
-    // Check if translation needs scrolling
-    trans_needs_scroll_ = trans_text_width_ > (draw_width - padding);
-    
-    // Calculate scroll offset for translation
-    float trans_x_offset = 0.0f;
-    
-    if (trans_needs_scroll_) {
-      float maxTransScroll = trans_text_width_ - draw_width + padding;
-      
-      // Calculate scroll speed for translation (same timing as lyric)
-      if (trans_scroll_speed_ <= 0.0f && maxTransScroll > 0) {
-        float available_time_ms = lyric_duration_ms_ * 0.9f - kScrollPauseMs;
-        if (available_time_ms > 100) {
-          trans_scroll_speed_ = maxTransScroll / (available_time_ms / 1000.0f);
-        } else {
-          trans_scroll_speed_ = maxTransScroll * 2.0f;
-        }
-      }
-      
-      // Initial pause before scrolling starts
-      if (trans_scroll_pause_start_ > 0) {
-        if (currentTime - trans_scroll_pause_start_ >= kScrollPauseMs) {
-          trans_scroll_pause_start_ = 0;  // End pause, start scrolling
-        }
-      } else if (trans_scroll_offset_ < maxTransScroll) {
-        // Scroll from left to right (only once)
-        float scrollDelta = trans_scroll_speed_ * (currentTime - last_scroll_time_) / 1000.0f;
-        trans_scroll_offset_ += scrollDelta;
-        if (trans_scroll_offset_ > maxTransScroll) {
-          trans_scroll_offset_ = maxTransScroll;  // Stop at the end
-        }
-      }
-      trans_x_offset = -trans_scroll_offset_;
-    }
-    
-    Gdiplus::StringFormat transFormat;
-    transFormat.SetLineAlignment(Gdiplus::StringAlignmentCenter);
-    if (trans_needs_scroll_) {
-      transFormat.SetAlignment(Gdiplus::StringAlignmentNear);
-    } else {
-      transFormat.SetAlignment(Gdiplus::StringAlignmentCenter);
-    }
-    
-    Gdiplus::RectF transRect(
-      trans_needs_scroll_ ? trans_x_offset + padding / 2 : 0,
-      static_cast<Gdiplus::REAL>(start_y + lyric_height), 
-      trans_needs_scroll_ ? trans_text_width_ + padding : static_cast<Gdiplus::REAL>(draw_width), 
-      static_cast<Gdiplus::REAL>(trans_height)
-    );
-    
-    // Set clipping for translation
-    graphics.SetClip(Gdiplus::RectF(0, static_cast<Gdiplus::REAL>(start_y + lyric_height), 
-                                     static_cast<Gdiplus::REAL>(draw_width), 
-                                     static_cast<Gdiplus::REAL>(trans_height)));
-    
-    // Translation text color (slightly transparent)
-    DWORD trans_text_color = (200 << 24) | ((text_color_ >> 16) & 0xFF) << 16 | 
-                             ((text_color_ >> 8) & 0xFF) << 8 | (text_color_ & 0xFF);
-    
-    if (is_vertical_) {
-      // In vertical mode, draw character by character with CJK rotation
-      Gdiplus::FontFamily transFontFamily(L"Microsoft YaHei");
-      int trans_font_size = static_cast<int>(font_size_ * 0.6f);
-      int trans_stroke = static_cast<int>(stroke_width_ * 0.7f);
-      float transStartX = trans_needs_scroll_ ? padding / 2 : (draw_width - trans_text_width_) / 2;
-      DrawVerticalModeText(graphics, translation_text_, &transFontFamily, trans_font_size, trans_stroke,
-                           trans_text_color, stroke_color_, transStartX,
-                           static_cast<float>(start_y + lyric_height), static_cast<float>(trans_height),
-                           trans_scroll_offset_);
-    } else {
-      // Horizontal mode: draw as before
-      if (stroke_width_ > 0) {
-        Gdiplus::GraphicsPath trans_path;
-        trans_path.AddString(translation_text_.c_str(), -1, &fontFamily, 
-                             Gdiplus::FontStyleRegular, static_cast<Gdiplus::REAL>(font_size_ * 0.6f),
-                             transRect, &transFormat);
-        
-        Gdiplus::Pen trans_stroke_pen(Gdiplus::Color(
-            (stroke_color_ >> 24) & 0xFF,
-            (stroke_color_ >> 16) & 0xFF,
-            (stroke_color_ >> 8) & 0xFF,
-            stroke_color_ & 0xFF
-        ), static_cast<Gdiplus::REAL>(stroke_width_ * 0.7f));
-        trans_stroke_pen.SetLineJoin(Gdiplus::LineJoinRound);
-        graphics.DrawPath(&trans_stroke_pen, &trans_path);
-        
-        Gdiplus::SolidBrush trans_brush(Gdiplus::Color(
-            200,
-            (text_color_ >> 16) & 0xFF,
-            (text_color_ >> 8) & 0xFF,
-            text_color_ & 0xFF
-        ));
-        graphics.FillPath(&trans_brush, &trans_path);
-      } else {
-        Gdiplus::SolidBrush trans_brush(Gdiplus::Color(
-            200,
-            (text_color_ >> 16) & 0xFF,
-            (text_color_ >> 8) & 0xFF,
-            text_color_ & 0xFF
-        ));
-        graphics.DrawString(translation_text_.c_str(), -1, &trans_font, transRect, &transFormat, &trans_brush);
-      }
+  // If scrolling is in progress, keep a timer running to refresh
+  SetScrollTimer(scroll_animating_);
+}
+
+void DesktopLyricWindow::SetScrollTimer(bool running) {
+  if (running) {
+    SetTimer(hwnd_, 2, kScrollFrameIntervalMs, nullptr);
+    // The marquee is the only steady frame source; it gets the render
+    // priority (and the fine system timer) only while it runs.
+    if (!render_role_) {
+      render_role_ = std::make_unique<cyrene_music::ScopedThreadRole>(
+          cyrene_music::ThreadRole::kRender);
     }
-    
-    graphics.ResetClip();
-  }
-  
-  // Update last scroll time
-  last_scroll_time_ = currentTime;
-  
-  // Check if scrolling is still in progress
-  bool lyric_still_scrolling = lyric_needs_scroll_ && 
-      (lyric_scroll_pause_start_ > 0 || lyric_scroll_offset_ < lyric_text_width_ - draw_width + padding);
-  bool trans_still_scrolling = trans_needs_scroll_ && 
-      (trans_scroll_pause_start_ > 0 || trans_scroll_offset_ < trans_text_width_ - draw_width + padding);
-  
-  // If scrolling is in progress, set a timer to refresh
-  if ((lyric_still_scrolling || trans_still_scrolling) && hwnd_ != nullptr && !show_controls_) {
-    SetTimer(hwnd_, 2, 30, nullptr);  // ~33fps refresh for smooth scrolling
   } else {
-    KillTimer(hwnd_, 2);
+    if (hwnd_ != nullptr) {
+      KillTimer(hwnd_, 2);
+    }
+    render_role_.reset();
   }
 }
 
@@ -985,20 +560,12 @@ LRESULT CALLBACK DesktopLyricWindow::WndProc(HWND hwnd, UINT message,
       RECT rect;
       GetWindowRect(hwnd, &rect);
       
-      // Calculate logical horizontal dimensions
-      bool hasTranslation = window->show_translation_ && !window->translation_text_.empty();
-      int logical_width = kWindowWidth;
-      int logical_height = hasTranslation 
-          ? kWindowHeight + static_cast<int>(window->font_size_ * 0.6f) + 10
-          : kWindowHeight;
-      
-      // For vertical mode, swap dimensions
-      int new_width = window->is_vertical_ ? logical_height : logical_width;
-      int new_height = window->is_vertical_ ? logical_width : logical_height;
-      
       // Resize window back to lyric-only size (keep position)
+      const lyric_layout::WindowSize size = lyric_layout::PhysicalWindowSize(
+          lyric_layout::kWindowWidth, window->GetNormalHeight(),
+          window->is_vertical_);
       SetWindowPos(hwnd, HWND_TOPMOST, rect.left, rect.top, 
-                   new_width, new_height,
+                   size.width, size.height,
                    SWP_NOACTIVATE);
       window->UpdateWindow();
       return 0;
@@ -1016,25 +583,20 @@ LRESULT CALLBACK DesktopLyricWindow::WndProc(HWND hwnd, UINT message,
         RECT rect;
         GetWindowRect(hwnd, &rect);
         
-        // Calculate logical dimensions for control panel
-        int logical_width = kWindowWidth;
-        int logical_height = window->GetControlPanelHeight();
-        
-        // For vertical mode, swap dimensions
-        int new_width = window->is_vertical_ ? logical_height : logical_width;
-        int new_height = window->is_vertical_ ? logical_width : logical_height;
-        
         // Resize window to show control panel
+        const lyric_layout::WindowSize size = lyric_layout::PhysicalWindowSize(
+            lyric_layout::kWindowWidth, window->GetControlPanelHeight(),
+            window->is_vertical_);
         SetWindowPos(hwnd, HWND_TOPMOST, rect.left, rect.top, 
-                     new_width, new_height,
+                     size.width, size.height,
                      SWP_NOACTIVATE);
         window->UpdateWindow();
       } else if (wparam == 2) {
         // Timer 2: Scroll animation refresh
-        if (!window->show_controls_ && (window->lyric_needs_scroll_ || window->trans_needs_scroll_)) {
-          window->UpdateWindow();
+        if (!window->show_controls_ && window->scroll_animating_) {
+          window->UpdateWindow(kScrollFrameIntervalMs);
         } else {
-          KillTimer(hwnd, 2);
+          window->SetScrollTimer(false);
         }
       }
       return 0;
@@ -1049,74 +611,27 @@ LRESULT CALLBACK DesktopLyricWindow::WndProc(HWND hwnd, UINT message,
   return DefWindowProc(hwnd, message, wparam, lparam);
 }
 
-// Helper method implementations
-bool DesktopLyricWindow::IsPointInRect(const POINT& pt, const RECT& rect) const {
-  return pt.x >= rect.left && pt.x <= rect.right && 
-         pt.y >= rect.top && pt.y <= rect.bottom;
-}
-
 bool DesktopLyricWindow::HandleButtonClick(const POINT& pt) {
-  // Debug: output button rects
-  wchar_t dbg[512];
-  swprintf_s(dbg, L"[DesktopLyric] HandleButtonClick pt(%d,%d), play_rect(%d,%d,%d,%d), prev_rect(%d,%d,%d,%d)\n",
-             pt.x, pt.y,
-             play_pause_button_rect_.left, play_pause_button_rect_.top,
-             play_pause_button_rect_.right, play_pause_button_rect_.bottom,
-             prev_button_rect_.left, prev_button_rect_.top,
-             prev_button_rect_.right, prev_button_rect_.bottom);
+  const std::string action =
+      lyric_layout::HitTestControlPanel(control_panel_layout_, pt.x, pt.y);
+  
+  wchar_t dbg[256];
+  swprintf_s(dbg, L"[DesktopLyric] HandleButtonClick pt(%d,%d) -> %hs\n",
+             pt.x, pt.y, action.empty() ? "none" : action.c_str());
   OutputDebugStringW(dbg);
   
-  if (IsPointInRect(pt, prev_button_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Previous button clicked\n");
-    if (playback_callback_) playback_callback_("previous");
-    return true;
-  } else if (IsPointInRect(pt, play_pause_button_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Play/Pause button clicked\n");
-    if (playback_callback_) playback_callback_("play_pause");
-    return true;
-  } else if (IsPointInRect(pt, next_button_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Next button clicked\n");
-    if (playback_callback_) playback_callback_("next");
-    return true;
-  } else if (IsPointInRect(pt, font_size_up_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Font size up clicked\n");
-    if (playback_callback_) playback_callback_("font_size_up");
-    return true;
-  } else if (IsPointInRect(pt, font_size_down_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Font size down clicked\n");
-    if (playback_callback_) playback_callback_("font_size_down");
-    return true;
-  } else if (IsPointInRect(pt, color_picker_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Color picker clicked\n");
-    if (playback_callback_) playback_callback_("color_picker");
-    return true;
-  } else if (IsPointInRect(pt, translation_toggle_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Translation toggle clicked\n");
-    if (playback_callback_) playback_callback_("toggle_translation");
-    return true;
-  } else if (IsPointInRect(pt, vertical_toggle_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Vertical toggle clicked\n");
-    if (playback_callback_) playback_callback_("toggle_vertical");
-    return true;
-  } else if (IsPointInRect(pt, close_button_rect_)) {
-    OutputDebugStringW(L"[DesktopLyric] Close button clicked\n");
-    if (playback_callback_) playback_callback_("close");
-    return true;
+  if (action.empty()) {
+    return false;  // No button was clicked
   }
-  OutputDebugStringW(L"[DesktopLyric] No button matched\n");
-  return false;  // No button was clicked
+  if (playback_callback_) playback_callback_(action);
+  return true;
 }
 
-void DesktopLyricWindow::SetTranslationText(const std::wstring& text) {
-  // Reset scroll state when translation changes
-  if (translation_text_ != text) {
-    trans_scroll_offset_ = 0.0f;
-    trans_needs_scroll_ = false;
-    trans_text_width_ = 0.0f;
-    trans_scroll_pause_start_ = GetTickCount();
-    trans_scroll_speed_ = 0.0f;  // Will be calculated in DrawLyric
+void DesktopLyricWindow::SetTranslationText(std::string text) {
+  // The renderer keeps the UTF-8 text and resets the scroll on a change
+  if (lyric_renderer_->SetTranslation(std::move(text), GetTickCount64())) {
+    panel_text_stale_ = true;
   }
-  translation_text_ = text;
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -1124,6 +639,7 @@ void DesktopLyricWindow::SetTranslationText(const std::wstring& text) {
 
 void DesktopLyricWindow::SetShowTranslation(bool show) {
   show_translation_ = show;
+  lyric_renderer_->SetShowTranslation(show);
   if (IsVisible()) {
     UpdateWindow();
   }
@@ -1132,25 +648,17 @@ void DesktopLyricWindow::SetShowTranslation(bool show) {
 void DesktopLyricWindow::SetVertical(bool vertical) {
   if (is_vertical_ != vertical) {
     is_vertical_ = vertical;
+    lyric_renderer_->SetVertical(vertical);
     
     // Update window size based on orientation (swap dimensions)
     if (hwnd_ != nullptr) {
       RECT rect;
       GetWindowRect(hwnd_, &rect);
       
-      // Calculate logical horizontal dimensions
-      bool hasTranslation = show_translation_ && !translation_text_.empty();
-      int logical_width = kWindowWidth;
-      int logical_height = hasTranslation 
-          ? kWindowHeight + static_cast<int>(font_size_ * 0.6f) + 10
-          : kWindowHeight;
-      
-      // For vertical mode, swap width and height
-      int new_width = vertical ? logical_height : logical_width;
-      int new_height = vertical ? logical_width : logical_height;
-      
+      const lyric_layout::WindowSize size = lyric_layout::PhysicalWindowSize(
+          lyric_layout::kWindowWidth, GetNormalHeight(), vertical);
       SetWindowPos(hwnd_, HWND_TOPMOST, rect.left, rect.top, 
-                   new_width, new_height, SWP_NOACTIVATE);
+                   size.width, size.height, SWP_NOACTIVATE);
     }
     
     if (IsVisible()) {
@@ -1159,6 +667,23 @@ void DesktopLyricWindow::SetVertical(bool vertical) {
   }
 }
 
+void DesktopLyricWindow::SetShowSpectrum(bool show) {
+  if (lyric_renderer_->show_spectrum() == show) return;
+
+  // Registering as a reader starts audio capture if Dart has not already
+  auto& slot = cyrene_music::SpectrumSlot::Shared();
+  if (show) {
+    slot.AddReader();
+    lyric_renderer_->SetSpectrumSource(&slot);
+  } else {
+    lyric_renderer_->SetSpectrumSource(nullptr);
+    slot.RemoveReader();
+  }
+  if (IsVisible()) {
+    UpdateWindow();
+  }
+}
+
 void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   OutputDebugStringW(L"[DesktopLyric] Drawing control panel\n");
   
@@ -1179,6 +704,28 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
                                  -static_cast<Gdiplus::REAL>(actual_width) / 2.0f);
   }
   
+  // GDI+ wants UTF-16; convert the current lines once after they change
+  if (panel_text_stale_) {
+    const std::string& lyric = lyric_renderer_->lyric();
+    const std::string& translation = lyric_renderer_->translation();
+    panel_lyric_text_ = Utf16FromUtf8(lyric.data(), lyric.size());
+    panel_translation_text_ = Utf16FromUtf8(translation.data(), translation.size());
+    panel_text_stale_ = false;
+  }
+
+  // The cover is decoded by the cover-art worker once Dart hands it over,
+  // so keep looking until it is there
+  if (!panel_cover_ && !album_cover_url_.empty()) {
+    panel_cover_ = cyrene_music::CoverArtCache::Shared().Find(album_cover_url_);
+  }
+  const bool has_cover = panel_cover_ && !panel_cover_->panel.empty();
+
+  // Button and row positions are shared with HandleButtonClick
+  control_panel_layout_ = lyric_layout::ComputeControlPanelLayout(
+      width, font_size_, !panel_lyric_text_.empty(), HasTranslation(),
+      has_cover);
+  const lyric_layout::ControlPanelLayout& layout = control_panel_layout_;
+  
   // Draw semi-transparent background
   Gdiplus::SolidBrush bg_brush(Gdiplus::Color(200, 30, 30, 30));  // Semi-transparent dark gray
   Gdiplus::RectF bg_rect(0, 0, static_cast<Gdiplus::REAL>(width), static_cast<Gdiplus::REAL>(height));
@@ -1197,13 +744,9 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   graphics.DrawPath(&border_pen, &path);
   
   // Draw close button (top-right corner)
-  int close_btn_size = 24;
-  int close_x = width - close_btn_size - 10;
-  int close_y = 10;
-  close_button_rect_.left = close_x;
-  close_button_rect_.top = close_y;
-  close_button_rect_.right = close_x + close_btn_size;
-  close_button_rect_.bottom = close_y + close_btn_size;
+  int close_btn_size = layout.close.width();
+  int close_x = layout.close.left;
+  int close_y = layout.close.top;
   
   Gdiplus::SolidBrush close_bg_brush(Gdiplus::Color(150, 200, 60, 60));
   graphics.FillEllipse(&close_bg_brush, static_cast<Gdiplus::REAL>(close_x), 
@@ -1225,6 +768,17 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
     graphics.Restore(closeState);
   }
   
+  // Album cover: the cache already holds it premultiplied at panel size
+  if (has_cover) {
+    const cyrene_music::ArgbSurface& cover = panel_cover_->panel;
+    Gdiplus::Bitmap cover_bitmap(
+        cover.width(), cover.height(), cover.stride_bytes(),
+        PixelFormat32bppPARGB,
+        reinterpret_cast<BYTE*>(const_cast<uint32_t*>(cover.data())));
+    graphics.DrawImage(&cover_bitmap, layout.cover.left, layout.cover.top,
+                       layout.cover.width(), layout.cover.height());
+  }
+
   // Draw song info
   Gdiplus::FontFamily fontFamily(L"Microsoft YaHei");
   Gdiplus::Font title_font(&fontFamily, 18, Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
@@ -1233,7 +787,10 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   
   // Song title
   if (!song_title_.empty()) {
-    Gdiplus::RectF title_rect(20, 15, static_cast<Gdiplus::REAL>(width - 80), 25);
+    Gdiplus::RectF title_rect(static_cast<Gdiplus::REAL>(layout.title.left),
+                              static_cast<Gdiplus::REAL>(layout.title.top),
+                              static_cast<Gdiplus::REAL>(layout.title.width()),
+                              static_cast<Gdiplus::REAL>(layout.title.height()));
     Gdiplus::StringFormat format;
     format.SetAlignment(Gdiplus::StringAlignmentCenter);
     graphics.DrawString(song_title_.c_str(), -1, &title_font, title_rect, &format, &text_brush);
@@ -1241,24 +798,26 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   
   // Artist name
   if (!song_artist_.empty()) {
-    Gdiplus::RectF artist_rect(20, 45, static_cast<Gdiplus::REAL>(width - 80), 20);
+    Gdiplus::RectF artist_rect(static_cast<Gdiplus::REAL>(layout.artist.left),
+                               static_cast<Gdiplus::REAL>(layout.artist.top),
+                               static_cast<Gdiplus::REAL>(layout.artist.width()),
+                               static_cast<Gdiplus::REAL>(layout.artist.height()));
     Gdiplus::StringFormat format;
     format.SetAlignment(Gdiplus::StringAlignmentCenter);
     Gdiplus::SolidBrush artist_brush(Gdiplus::Color(200, 255, 255, 255));
     graphics.DrawString(song_artist_.c_str(), -1, &artist_font, artist_rect, &format, &artist_brush);
   }
   
-  // Draw lyric text with original style (same as DrawLyric)
-  int lyric_y = 70;
-  if (!lyric_text_.empty()) {
+  // Draw lyric text with the same style as the lyric-only window
+  if (!layout.lyric.empty()) {
     // Use user-configured font size and style
     Gdiplus::FontFamily lyricFontFamily(L"Microsoft YaHei");
     Gdiplus::Font lyric_font(&lyricFontFamily, static_cast<Gdiplus::REAL>(font_size_), 
                              Gdiplus::FontStyleBold, Gdiplus::UnitPixel);
-    // Dynamic lyric area height based on font size
-    int lyric_area_height = font_size_ + 10;
-    Gdiplus::RectF lyric_rect(20, static_cast<Gdiplus::REAL>(lyric_y), static_cast<Gdiplus::REAL>(width - 40), 
-                               static_cast<Gdiplus::REAL>(lyric_area_height));
+    Gdiplus::RectF lyric_rect(static_cast<Gdiplus::REAL>(layout.lyric.left),
+                              static_cast<Gdiplus::REAL>(layout.lyric.top),
+                              static_cast<Gdiplus::REAL>(layout.lyric.width()),
+                              static_cast<Gdiplus::REAL>(layout.lyric.height()));
     Gdiplus::StringFormat format;
     format.SetAlignment(Gdiplus::StringAlignmentCenter);
     format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
@@ -1266,7 +825,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
     // Draw with stroke effect (same as original lyric)
     if (stroke_width_ > 0) {
       Gdiplus::GraphicsPath lyric_path;
-      lyric_path.AddString(lyric_text_.c_str(), -1, &lyricFontFamily, 
+      lyric_path.AddString(panel_lyric_text_.c_str(), -1, &lyricFontFamily, 
                            Gdiplus::FontStyleBold, static_cast<Gdiplus::REAL>(font_size_),
                            lyric_rect, &format);
       
@@ -1296,44 +855,36 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
           (text_color_ >> 8) & 0xFF,
           text_color_ & 0xFF
       ));
-      graphics.DrawString(lyric_text_.c_str(), -1, &lyric_font, lyric_rect, &format, &lyric_text_brush);
+      graphics.DrawString(panel_lyric_text_.c_str(), -1, &lyric_font, lyric_rect, &format, &lyric_text_brush);
     }
-    lyric_y += lyric_area_height;
   }
   
   // Draw translation if enabled and available
-  if (show_translation_ && !translation_text_.empty()) {
+  if (!layout.translation.empty()) {
     Gdiplus::Font trans_font(&fontFamily, static_cast<Gdiplus::REAL>(font_size_ * 0.7f), 
                               Gdiplus::FontStyleRegular, Gdiplus::UnitPixel);
-    int trans_height = static_cast<int>(font_size_ * 0.7f) + 5;
-    Gdiplus::RectF trans_rect(20, static_cast<Gdiplus::REAL>(lyric_y), 
-                               static_cast<Gdiplus::REAL>(width - 40), 
-                               static_cast<Gdiplus::REAL>(trans_height));
+    Gdiplus::RectF trans_rect(static_cast<Gdiplus::REAL>(layout.translation.left),
+                              static_cast<Gdiplus::REAL>(layout.translation.top),
+                              static_cast<Gdiplus::REAL>(layout.translation.width()),
+                              static_cast<Gdiplus::REAL>(layout.translation.height()));
     Gdiplus::StringFormat format;
     format.SetAlignment(Gdiplus::StringAlignmentCenter);
     format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
     Gdiplus::SolidBrush trans_brush(Gdiplus::Color(180, 255, 255, 255));
-    graphics.DrawString(translation_text_.c_str(), -1, &trans_font, trans_rect, &format, &trans_brush);
-    lyric_y += trans_height;
+    graphics.DrawString(panel_translation_text_.c_str(), -1, &trans_font, trans_rect, &format, &trans_brush);
   }
   
   // Draw control buttons (position based on font size)
-  int button_y = lyric_y + 15;
-  int button_size = 36;
-  int small_btn_size = 28;
-  int button_spacing = 50;
-  int center_x = width / 2;
+  int button_y = layout.play_pause.top;
+  int button_size = layout.play_pause.width();
+  int small_btn_size = layout.font_size_down.width();
   
   Gdiplus::SolidBrush button_brush(Gdiplus::Color(180, 255, 255, 255));
   Gdiplus::SolidBrush icon_brush(Gdiplus::Color(255, 30, 30, 30));
   Gdiplus::Pen button_pen(Gdiplus::Color(255, 255, 255, 255), 2.0f);
   
   // Previous button
-  int prev_x = center_x - button_spacing - button_size / 2;
-  prev_button_rect_.left = prev_x;
-  prev_button_rect_.top = button_y;
-  prev_button_rect_.right = prev_x + button_size;
-  prev_button_rect_.bottom = button_y + button_size;
+  int prev_x = layout.previous.left;
   
   // Draw previous button (◀)
   graphics.FillEllipse(&button_brush, static_cast<Gdiplus::REAL>(prev_x), 
@@ -1357,11 +908,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Play/Pause button
-  int play_x = center_x - button_size / 2;
-  play_pause_button_rect_.left = play_x;
-  play_pause_button_rect_.top = button_y;
-  play_pause_button_rect_.right = play_x + button_size;
-  play_pause_button_rect_.bottom = button_y + button_size;
+  int play_x = layout.play_pause.left;
   
   graphics.FillEllipse(&button_brush, static_cast<Gdiplus::REAL>(play_x), 
                        static_cast<Gdiplus::REAL>(button_y), 
@@ -1407,11 +954,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Next button
-  int next_x = center_x + button_spacing - button_size / 2;
-  next_button_rect_.left = next_x;
-  next_button_rect_.top = button_y;
-  next_button_rect_.right = next_x + button_size;
-  next_button_rect_.bottom = button_y + button_size;
+  int next_x = layout.next.left;
   
   graphics.FillEllipse(&button_brush, static_cast<Gdiplus::REAL>(next_x), 
                        static_cast<Gdiplus::REAL>(button_y), 
@@ -1435,15 +978,10 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Second row of buttons (font size, color, translation toggle)
-  int row2_y = button_y + button_size + 10;
-  int row2_spacing = 55;
+  int row2_y = layout.font_size_down.top;
   
   // Font size down button (A-)
-  int font_down_x = center_x - static_cast<int>(row2_spacing * 1.5f) - small_btn_size / 2;
-  font_size_down_rect_.left = font_down_x;
-  font_size_down_rect_.top = row2_y;
-  font_size_down_rect_.right = font_down_x + small_btn_size;
-  font_size_down_rect_.bottom = row2_y + small_btn_size;
+  int font_down_x = layout.font_size_down.left;
   
   Gdiplus::SolidBrush small_btn_brush(Gdiplus::Color(150, 255, 255, 255));
   graphics.FillEllipse(&small_btn_brush, static_cast<Gdiplus::REAL>(font_down_x), 
@@ -1467,11 +1005,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Font size up button (A+)
-  int font_up_x = center_x - static_cast<int>(row2_spacing * 0.5f) - small_btn_size / 2;
-  font_size_up_rect_.left = font_up_x;
-  font_size_up_rect_.top = row2_y;
-  font_size_up_rect_.right = font_up_x + small_btn_size;
-  font_size_up_rect_.bottom = row2_y + small_btn_size;
+  int font_up_x = layout.font_size_up.left;
   
   graphics.FillEllipse(&small_btn_brush, static_cast<Gdiplus::REAL>(font_up_x), 
                        static_cast<Gdiplus::REAL>(row2_y), 
@@ -1490,11 +1024,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Color picker button (palette icon - using colored circle)
-  int color_x = center_x + static_cast<int>(row2_spacing * 0.5f) - small_btn_size / 2;
-  color_picker_rect_.left = color_x;
-  color_picker_rect_.top = row2_y;
-  color_picker_rect_.right = color_x + small_btn_size;
-  color_picker_rect_.bottom = row2_y + small_btn_size;
+  int color_x = layout.color_picker.left;
   
   // Draw with current text color to show what color is selected
   Gdiplus::SolidBrush color_btn_brush(Gdiplus::Color(
@@ -1514,11 +1044,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
                        static_cast<Gdiplus::REAL>(small_btn_size));
   
   // Translation toggle button (译)
-  int trans_x = center_x + static_cast<int>(row2_spacing * 1.5f) - small_btn_size / 2;
-  translation_toggle_rect_.left = trans_x;
-  translation_toggle_rect_.top = row2_y;
-  translation_toggle_rect_.right = trans_x + small_btn_size;
-  translation_toggle_rect_.bottom = row2_y + small_btn_size;
+  int trans_x = layout.translation_toggle.left;
   
   // Use different color based on translation state
   Gdiplus::SolidBrush trans_btn_brush(show_translation_ 
@@ -1542,11 +1068,7 @@ void DesktopLyricWindow::DrawControlPanel(HDC hdc, int width, int height) {
   }
   
   // Vertical toggle button (竖/横)
-  int vert_x = center_x + static_cast<int>(row2_spacing * 2.5f) - small_btn_size / 2;
-  vertical_toggle_rect_.left = vert_x;
-  vertical_toggle_rect_.top = row2_y;
-  vertical_toggle_rect_.right = vert_x + small_btn_size;
-  vertical_toggle_rect_.bottom = row2_y + small_btn_size;
+  int vert_x = layout.vertical_toggle.left;
   
   // Use different color based on vertical state
   Gdiplus::SolidBrush vert_btn_brush(is_vertical_ 
@@ -5,6 +5,16 @@
 #include <string>
 #include <memory>
 #include <functional>
+#include <vector>
+
+#include "cover/cover_art_cache.h"
+#include "lyric/glyph_atlas.h"
+#include "lyric/lyric_layout.h"
+#include "lyric/lyric_renderer.h"
+#include "lyric/lyric_sheet.h"
+#include "lyric/render_stats.h"
+#include "lyric/text_rasterizer.h"
+#include "thread/thread_role.h"
 
 // Desktop lyric window class
 class DesktopLyricWindow {
@@ -22,9 +32,16 @@ class DesktopLyricWindow {
   void Show();
   void Hide();
   bool IsVisible() const;
+  bool IsCreated() const { return hwnd_ != nullptr; }
   
-  // Set lyric text
-  void SetLyricText(const std::wstring& text);
+  // Set lyric text (UTF-8, moved into the renderer)
+  void SetLyricText(std::string text);
+
+  // Upload the whole lyric sheet once per track, then switch lines by index
+  void SetLyricSheet(std::vector<std::string> lyrics,
+                     std::vector<std::string> translations,
+                     const std::vector<int64_t>& start_times_ms);
+  bool ShowLyricLine(size_t index);
   
   // Set window position
   void SetPosition(int x, int y);
@@ -51,7 +68,7 @@ class DesktopLyricWindow {
   void SetMouseTransparent(bool transparent);
   
   // Set song info (title, artist, album cover URL)
-  void SetSongInfo(const std::wstring& title, const std::wstring& artist, const std::wstring& album_cover);
+  void SetSongInfo(const std::string& title, const std::string& artist, std::string album_cover);
   
   // Set playback control callback
   using PlaybackControlCallback = std::function<void(const std::string& action)>;
@@ -62,21 +79,25 @@ class DesktopLyricWindow {
   
   // Get window handle
   HWND GetHandle() const { return hwnd_; }
+  
+  // Render timing statistics
+  const cyrene_music::RenderStats& GetRenderStats() const { return render_stats_; }
+  void ResetRenderStats() { render_stats_.Reset(); }
 
  private:
   static LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam);
   
-  // Update window display
-  void UpdateWindow();
-  
-  // Draw lyric to memory DC (handles both horizontal and vertical modes)
-  void DrawLyric(HDC hdc, int width, int height);
+  // Update window display. |expected_interval_ms| is the refresh interval of
+  // the timer driving this frame, or 0 for on-demand redraws.
+  void UpdateWindow(int expected_interval_ms = 0);
   
   HWND hwnd_;
-  std::wstring lyric_text_;
+  // Only the hover panel draws the song info, so it is kept as UTF-16
   std::wstring song_title_;
   std::wstring song_artist_;
-  std::wstring album_cover_url_;
+  std::string album_cover_url_;
+  // Decoded cover for the hover panel; shared with the cache, never copied
+  std::shared_ptr<const cyrene_music::CoverArt> panel_cover_;
   int font_size_;
   DWORD text_color_;
   DWORD stroke_color_;
@@ -92,47 +113,47 @@ class DesktopLyricWindow {
   DWORD hover_start_time_;
   bool is_playing_;  // Current playback state
   
-  // Button hit test areas
-  RECT play_pause_button_rect_;
-  RECT prev_button_rect_;
-  RECT next_button_rect_;
-  RECT font_size_up_rect_;
-  RECT font_size_down_rect_;
-  RECT color_picker_rect_;
-  RECT translation_toggle_rect_;
-  RECT close_button_rect_;
+  // Button hit test areas, refreshed each time the panel is drawn
+  cyrene_music::lyric_layout::ControlPanelLayout control_panel_layout_;
   
   // Translation display state
   bool show_translation_;
-  std::wstring translation_text_;
-  
-  // Scrolling state for long text
-  float lyric_scroll_offset_;
-  float trans_scroll_offset_;
-  bool lyric_needs_scroll_;
-  bool trans_needs_scroll_;
-  float lyric_text_width_;
-  float trans_text_width_;
-  DWORD last_scroll_time_;
-  static const int kScrollPauseMs = 500;  // brief pause at start before scrolling
-  DWORD lyric_scroll_pause_start_;
-  DWORD trans_scroll_pause_start_;
-  DWORD lyric_duration_ms_;  // Duration this lyric line will be displayed
-  float lyric_scroll_speed_;  // Calculated scroll speed for current lyric
-  float trans_scroll_speed_;  // Calculated scroll speed for translation
+
+  // Lines of the current track; the text itself lives in the renderer
+  cyrene_music::LyricSheet lyric_sheet_;
+
+  // UTF-16 copies of the current lines for the hover panel, converted when
+  // the panel is drawn after a line change rather than on every line
+  std::wstring panel_lyric_text_;
+  std::wstring panel_translation_text_;
+  bool panel_text_stale_;
+  
+  // Lyric layout and cached line bitmaps; scrolling frames only composite.
+  // CJK glyphs are drawn once into the atlas and new lines composed from it.
+  std::unique_ptr<cyrene_music::TextRasterizer> text_rasterizer_;
+  std::unique_ptr<cyrene_music::GlyphAtlasRasterizer> glyph_atlas_;
+  std::unique_ptr<cyrene_music::LyricRenderer> lyric_renderer_;
+  bool scroll_animating_;  // the last frame still had a marquee running
+  // Held on the UI thread while the scroll timer runs
+  std::unique_ptr<cyrene_music::ScopedThreadRole> render_role_;
   
   // Playback control callback
   PlaybackControlCallback playback_callback_;
   
+  // Per-frame timing and counters, queried via getRenderStats
+  cyrene_music::RenderStats render_stats_;
+  
   // Helper methods
-  bool IsPointInRect(const POINT& pt, const RECT& rect) const;
   void DrawControlPanel(HDC hdc, int width, int height);
   bool HandleButtonClick(const POINT& pt);  // Returns true if a button was clicked
   int GetControlPanelHeight() const;  // Dynamic height based on font size
+  int GetNormalHeight() const;  // Lyric-only height, grows with translation
+  bool HasTranslation() const;
+  void SetScrollTimer(bool running);  // timer 2, with the render role
   
  public:
-  // Set translation text
-  void SetTranslationText(const std::wstring& text);
+  // Set translation text (UTF-8, moved into the renderer)
+  void SetTranslationText(std::string text);
   
   // Set show translation state
   void SetShowTranslation(bool show);
@@ -148,13 +169,16 @@ class DesktopLyricWindow {
   
   // Get vertical layout mode
   bool GetVertical() const { return is_vertical_; }
+  
+  // Spectrum strip behind the lyric, fed in-process by the rhythm analyser
+  void SetShowSpectrum(bool show);
+  
+  // Get spectrum strip state
+  bool GetShowSpectrum() const { return lyric_renderer_->show_spectrum(); }
 
  private:
   // Vertical layout mode
   bool is_vertical_;
-  
-  // Vertical mode button rect
-  RECT vertical_toggle_rect_;
 };
 
 #endif  // RUNNER_DESKTOP_LYRIC_WINDOW_H_
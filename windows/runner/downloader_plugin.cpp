@@ -0,0 +1,164 @@
+#include "downloader_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "channel/method_dispatch.h"
+
+namespace cyrene_music {
+
+namespace {
+
+// Connections one download may open; a larger request is cut down to it.
+constexpr int64_t kMaxConnections = 16;
+
+flutter::EncodableValue ToEncodable(DownloadEvent&& event) {
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+
+  const auto value = [](uint64_t n) {
+    return EncodableValue(static_cast<int64_t>(n));
+  };
+  EncodableMap encoded{
+      {EncodableValue("id"), EncodableValue(event.id)},
+      {EncodableValue("received"), value(event.received)},
+      {EncodableValue("total"), value(event.total)},
+  };
+  if (event.done) {
+    encoded[EncodableValue("ok")] = EncodableValue(event.error.empty());
+    encoded[EncodableValue("error")] =
+        EncodableValue(std::move(event.error));
+    encoded[EncodableValue("resumed")] = value(event.resumed);
+    encoded[EncodableValue("connections")] =
+        EncodableValue(static_cast<int32_t>(event.connections));
+  }
+  return EncodableValue(std::move(encoded));
+}
+
+}  // namespace
+
+void DownloaderPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  registrar->AddPlugin(std::make_unique<DownloaderPlugin>(registrar));
+}
+
+DownloaderPlugin::DownloaderPlugin(flutter::PluginRegistrarWindows* registrar)
+    : registrar_(registrar),
+      wake_message_(RegisterWindowMessageW(L"CyreneMusicDownloader")) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      registrar->messenger(), "com.cyrene.music/downloader",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+
+  window_proc_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+      [this](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+        return HandleWindowProc(hwnd, message, wparam, lparam);
+      });
+
+  HWND window = GetAncestor(registrar->GetView()->GetNativeWindow(), GA_ROOT);
+  UINT wake_message = wake_message_;
+  downloader_.SetNotify([window, wake_message] {
+    PostMessageW(window, wake_message, 0, 0);
+  });
+}
+
+DownloaderPlugin::~DownloaderPlugin() {
+  downloader_.SetNotify(nullptr);
+  registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+}
+
+void DownloaderPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(DownloaderPlugin* plugin, const EncodableMap* args,
+                           MethodResult* result);
+
+  static const MethodTable<Handler> methods{
+      {"start",
+       [](DownloaderPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         DownloadOptions options;
+         int64_t connections = static_cast<int64_t>(options.connections);
+         const ArgError error = DecodeArgs(
+             args, Required("id", &id), Required("url", &options.url),
+             Required("path", &options.path),
+             Optional("connections", &connections));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         if (connections < 1) {
+           result->Error("INVALID_ARGUMENT", "Invalid 'connections' argument");
+           return;
+         }
+         options.connections =
+             static_cast<size_t>(std::min(connections, kMaxConnections));
+         result->Success(EncodableValue(
+             plugin->downloader_.Start(id, std::move(options))));
+       }},
+      {"cancel",
+       [](DownloaderPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         int64_t id = 0;
+         const ArgError error = DecodeArgs(args, Required("id", &id));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         plugin->downloader_.Cancel(id);
+         result->Success(EncodableValue(true));
+       }},
+      {"discard",
+       [](DownloaderPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string path;
+         const ArgError error = DecodeArgs(args, Required("path", &path));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         SegmentedDownloader::Discard(path);
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(this, std::get_if<EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+std::optional<LRESULT> DownloaderPlugin::HandleWindowProc(HWND hwnd,
+                                                          UINT message,
+                                                          WPARAM wparam,
+                                                          LPARAM lparam) {
+  if (message != wake_message_) return std::nullopt;
+  DeliverEvents();
+  return 0;
+}
+
+void DownloaderPlugin::DeliverEvents() {
+  for (DownloadEvent& event : downloader_.TakeEvents()) {
+    const char* method = event.done ? "onDone" : "onProgress";
+    channel_->InvokeMethod(method, std::make_unique<flutter::EncodableValue>(
+                                       ToEncodable(std::move(event))));
+  }
+}
+
+}  // namespace cyrene_music
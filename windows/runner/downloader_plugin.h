@@ -0,0 +1,53 @@
+#ifndef RUNNER_DOWNLOADER_PLUGIN_H_
+#define RUNNER_DOWNLOADER_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+#include <windows.h>
+
+#include <memory>
+#include <optional>
+
+#include "net/segmented_downloader.h"
+
+namespace cyrene_music {
+
+// Downloads songs for DownloadService on a native SegmentedDownloader.
+// "start" {id, url, path, connections} returns whether download |id|
+// started; its progress then reaches Dart as "onProgress" {id, received,
+// total} calls on "com.cyrene.music/downloader" and its end as one "onDone"
+// {id, ok, error, total, resumed, connections}. "cancel" {id} stops it and
+// keeps what it has for the next "start" of the same path, "discard"
+// {path} throws that away.
+class DownloaderPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit DownloaderPlugin(flutter::PluginRegistrarWindows* registrar);
+  ~DownloaderPlugin() override;
+
+  DownloaderPlugin(const DownloaderPlugin&) = delete;
+  DownloaderPlugin& operator=(const DownloaderPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Platform thread; download threads post |wake_message_| to get here.
+  std::optional<LRESULT> HandleWindowProc(HWND hwnd, UINT message,
+                                          WPARAM wparam, LPARAM lparam);
+  void DeliverEvents();
+
+  flutter::PluginRegistrarWindows* registrar_;
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  UINT wake_message_;
+  int window_proc_id_;
+  // Last, so downloads still running are cancelled and joined before the
+  // channel goes away.
+  SegmentedDownloader downloader_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_DOWNLOADER_PLUGIN_H_
@@ -1,15 +1,36 @@
 #include "flutter_window.h"
 
+#include <chrono>
 #include <optional>
 
 #include "flutter/generated_plugin_registrant.h"
 #include "system_color_helper.h"
+#include "cache_index_plugin.h"
+#include "cache_stream_plugin.h"
+#include "cover_art_plugin.h"
 #include "desktop_lyric_plugin.h"
+#include "downloader_plugin.h"
+#include "instance_plugin.h"
+#include "library_scanner_plugin.h"
+#include "schannel_tls_connector.h"
 #include "smtc_plugin.h"
 #include "rhythm_plugin.h"
+#include "stream_proxy_plugin.h"
+#include "trace/startup_trace.h"
 #include <flutter/method_channel.h>
 #include <flutter/standard_method_codec.h>
 
+namespace {
+
+// The desktop lyric, SMTC and rhythm plugins are registered as channel
+// stubs that build the real plugin on first use; this is how long each may
+// then sit idle (and releasable) before it is torn down again.
+constexpr std::chrono::minutes kDesktopLyricIdleRelease(1);
+constexpr std::chrono::minutes kSmtcIdleRelease(5);
+constexpr std::chrono::seconds kRhythmIdleRelease(30);
+
+}  // namespace
+
 FlutterWindow::FlutterWindow(const flutter::DartProject& project)
     : project_(project) {}
 
@@ -20,30 +41,102 @@ bool FlutterWindow::OnCreate() {
     return false;
   }
 
+  using cyrene_music::StartupTrace;
+
   RECT frame = GetClientArea();
 
   // The size here must match the window dimensions to avoid unnecessary surface
   // creation / destruction in the startup path.
-  flutter_controller_ = std::make_unique<flutter::FlutterViewController>(
-      frame.right - frame.left, frame.bottom - frame.top, project_);
+  {
+    StartupTrace::Scope trace("FlutterViewController");
+    flutter_controller_ = std::make_unique<flutter::FlutterViewController>(
+        frame.right - frame.left, frame.bottom - frame.top, project_);
+  }
   // Ensure that basic setup of the controller was successful.
   if (!flutter_controller_->engine() || !flutter_controller_->view()) {
     return false;
   }
-  RegisterPlugins(flutter_controller_->engine());
+  {
+    StartupTrace::Scope trace("RegisterPlugins");
+    RegisterPlugins(flutter_controller_->engine());
+  }
   SetChildContent(flutter_controller_->view()->GetNativeWindow());
   
+  // Register cover art plugin before its consumers (SMTC, desktop lyric)
+  {
+    StartupTrace::Scope trace("CoverArtPlugin");
+    cyrene_music::CoverArtPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("CoverArtPlugin"));
+  }
+
+  // Index of cached songs
+  {
+    StartupTrace::Scope trace("CacheIndexPlugin");
+    cyrene_music::CacheIndexPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("CacheIndexPlugin"));
+  }
+
+  // Cached songs are streamed to the player from here
+  {
+    StartupTrace::Scope trace("CacheStreamPlugin");
+    cyrene_music::CacheStreamPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("CacheStreamPlugin"));
+  }
+
+  // Header-rewriting proxy for protected streams; Schannel carries its
+  // https:// upstreams and only acquires credentials on first use
+  cyrene_music::SchannelTlsConnector::Install();
+  {
+    StartupTrace::Scope trace("StreamProxyPlugin");
+    cyrene_music::StreamProxyPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("StreamProxyPlugin"));
+  }
+
+  // Segmented song downloads over the same HTTP client
+  {
+    StartupTrace::Scope trace("DownloaderPlugin");
+    cyrene_music::DownloaderPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("DownloaderPlugin"));
+  }
+
+  // Local library scans; the scanner threads start with the first scan
+  {
+    StartupTrace::Scope trace("LibraryScannerPlugin");
+    cyrene_music::LibraryScannerPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("LibraryScannerPlugin"));
+  }
+
+  // Arguments from later launches; registered eagerly since the handoff
+  // may already have queued some
+  {
+    StartupTrace::Scope trace("InstancePlugin");
+    cyrene_music::InstancePlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("InstancePlugin"));
+  }
+
   // Register desktop lyric plugin
-  DesktopLyricPlugin::RegisterWithRegistrar(
-      flutter_controller_->engine()->GetRegistrarForPlugin("DesktopLyricPlugin"));
+  {
+    StartupTrace::Scope trace("DesktopLyricPlugin");
+    DesktopLyricPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("DesktopLyricPlugin"),
+        kDesktopLyricIdleRelease);
+  }
   
   // Register SMTC plugin
-  cyrene_music::SmtcPlugin::RegisterWithRegistrar(
-      flutter_controller_->engine()->GetRegistrarForPlugin("SmtcPlugin"));
+  {
+    StartupTrace::Scope trace("SmtcPlugin");
+    cyrene_music::SmtcPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("SmtcPlugin"),
+        kSmtcIdleRelease);
+  }
 
   // Register Rhythm plugin
-  cyrene_music::RhythmPlugin::RegisterWithRegistrar(
-      flutter_controller_->engine()->GetRegistrarForPlugin("RhythmPlugin"));
+  {
+    StartupTrace::Scope trace("RhythmPlugin");
+    cyrene_music::RhythmPlugin::RegisterWithRegistrar(
+        flutter_controller_->engine()->GetRegistrarForPlugin("RhythmPlugin"),
+        kRhythmIdleRelease);
+  }
 
   // Register system color platform channel
   const std::string channel_name = "com.cyrene.music/system_color";
@@ -65,7 +158,9 @@ bool FlutterWindow::OnCreate() {
       });
 
   flutter_controller_->engine()->SetNextFrameCallback([&]() {
+    StartupTrace::Shared().Instant("first frame");
     this->Show();
+    StartupTrace::Shared().Finish();
   });
 
   // Flutter can complete the first frame before the "show window" callback is
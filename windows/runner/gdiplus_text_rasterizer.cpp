@@ -0,0 +1,138 @@
+#include "gdiplus_text_rasterizer.h"
+
+#include "lyric/lyric_layout.h"
+#include "utils.h"
+
+namespace cyrene_music {
+
+namespace {
+
+const wchar_t kFontFamilyName[] = L"Microsoft YaHei";
+
+Gdiplus::FontStyle FontStyleFor(const TextStyle& style) {
+  return style.bold ? Gdiplus::FontStyleBold : Gdiplus::FontStyleRegular;
+}
+
+// Strokes and fills |text| laid out in |rect| with |format|, or draws it
+// plainly when there is no stroke.
+void DrawStyledString(Gdiplus::Graphics& graphics, const std::wstring& text,
+                      Gdiplus::FontFamily* font_family, const TextStyle& style,
+                      const Gdiplus::RectF& rect,
+                      const Gdiplus::StringFormat& format) {
+  Gdiplus::SolidBrush fill_brush(
+      Gdiplus::Color(static_cast<Gdiplus::ARGB>(style.fill_color)));
+  if (style.stroke_width > 0.0f) {
+    Gdiplus::GraphicsPath path;
+    path.AddString(text.c_str(), -1, font_family, FontStyleFor(style),
+                   style.font_size, rect, &format);
+    Gdiplus::Pen stroke_pen(
+        Gdiplus::Color(static_cast<Gdiplus::ARGB>(style.stroke_color)),
+        style.stroke_width);
+    stroke_pen.SetLineJoin(Gdiplus::LineJoinRound);
+    graphics.DrawPath(&stroke_pen, &path);
+    graphics.FillPath(&fill_brush, &path);
+  } else {
+    Gdiplus::Font font(font_family, style.font_size, FontStyleFor(style),
+                       Gdiplus::UnitPixel);
+    graphics.DrawString(text.c_str(), -1, &font, rect, &format, &fill_brush);
+  }
+}
+
+}  // namespace
+
+GdiplusTextRasterizer::GdiplusTextRasterizer()
+    : font_family_(kFontFamilyName),
+      measure_bitmap_(
+          std::make_unique<Gdiplus::Bitmap>(1, 1, PixelFormat32bppPARGB)),
+      measure_graphics_(
+          std::make_unique<Gdiplus::Graphics>(measure_bitmap_.get())) {
+  measure_graphics_->SetTextRenderingHint(Gdiplus::TextRenderingHintAntiAlias);
+}
+
+GdiplusTextRasterizer::~GdiplusTextRasterizer() = default;
+
+float GdiplusTextRasterizer::MeasureWide(const std::wstring& text,
+                                         const TextStyle& style) {
+  if (text.empty()) return 0.0f;
+  Gdiplus::Font font(&font_family_, style.font_size, FontStyleFor(style),
+                     Gdiplus::UnitPixel);
+  Gdiplus::RectF layout(0, 0, 10000, style.font_size * 2);
+  Gdiplus::StringFormat format;
+  Gdiplus::RectF bounds;
+  measure_graphics_->MeasureString(text.c_str(), -1, &font, layout, &format,
+                                   &bounds);
+  return bounds.Width;
+}
+
+float GdiplusTextRasterizer::MeasureText(const std::string& utf8,
+                                         const TextStyle& style) {
+  if (!style.upright_cjk) {
+    return MeasureWide(Utf16FromUtf8(utf8.data(), utf8.size()), style);
+  }
+  // Vertical mode advances run by run, so measure the same way it draws.
+  float width = 0.0f;
+  for (const TextRun& run : SegmentForVertical(utf8)) {
+    const float run_width = MeasureWide(
+        Utf16FromUtf8(utf8.data() + run.begin, run.length), style);
+    width += run.rotate && run_width <= 0.0f ? style.font_size : run_width;
+  }
+  return width;
+}
+
+void GdiplusTextRasterizer::DrawText(ArgbSurface* target,
+                                     const std::string& utf8,
+                                     const TextStyle& style, float x, float y,
+                                     float height) {
+  if (utf8.empty() || target->empty()) return;
+
+  // Draw straight into the surface's memory; both sides are 32bpp PARGB.
+  Gdiplus::Bitmap bitmap(target->width(), target->height(),
+                         target->stride_bytes(), PixelFormat32bppPARGB,
+                         reinterpret_cast<BYTE*>(target->data()));
+  Gdiplus::Graphics graphics(&bitmap);
+  graphics.SetSmoothingMode(Gdiplus::SmoothingModeAntiAlias);
+  graphics.SetTextRenderingHint(Gdiplus::TextRenderingHintAntiAlias);
+
+  Gdiplus::StringFormat format;
+  format.SetAlignment(Gdiplus::StringAlignmentNear);
+  format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
+
+  if (!style.upright_cjk) {
+    const std::wstring text = Utf16FromUtf8(utf8.data(), utf8.size());
+    const Gdiplus::RectF rect(x, y, MeasureWide(text, style), height);
+    DrawStyledString(graphics, text, &font_family_, style, rect, format);
+    return;
+  }
+
+  // Vertical mode: CJK characters are drawn one at a time rotated -90
+  // degrees about their centre so they read upright once the frame is
+  // rotated clockwise; other runs are drawn as continuous strings to keep
+  // their spacing.
+  Gdiplus::StringFormat char_format;
+  char_format.SetAlignment(Gdiplus::StringAlignmentCenter);
+  char_format.SetLineAlignment(Gdiplus::StringAlignmentCenter);
+
+  for (const TextRun& run : SegmentForVertical(utf8)) {
+    const std::wstring text =
+        Utf16FromUtf8(utf8.data() + run.begin, run.length);
+    float run_width = MeasureWide(text, style);
+    if (run.rotate) {
+      if (run_width <= 0.0f) run_width = style.font_size;
+      const Gdiplus::GraphicsState state = graphics.Save();
+      const float center_x = x + run_width / 2;
+      const float center_y = y + height / 2;
+      graphics.TranslateTransform(center_x, center_y);
+      graphics.RotateTransform(-90.0f);
+      graphics.TranslateTransform(-center_x, -center_y);
+      DrawStyledString(graphics, text, &font_family_, style,
+                       Gdiplus::RectF(x, y, run_width, height), char_format);
+      graphics.Restore(state);
+    } else {
+      DrawStyledString(graphics, text, &font_family_, style,
+                       Gdiplus::RectF(x, y, run_width, height), format);
+    }
+    x += run_width;
+  }
+}
+
+}  // namespace cyrene_music
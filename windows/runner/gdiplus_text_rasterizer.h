@@ -0,0 +1,37 @@
+#ifndef RUNNER_GDIPLUS_TEXT_RASTERIZER_H_
+#define RUNNER_GDIPLUS_TEXT_RASTERIZER_H_
+
+#include <windows.h>
+#include <gdiplus.h>
+
+#include <memory>
+#include <string>
+
+#include "lyric/text_rasterizer.h"
+
+namespace cyrene_music {
+
+// TextRasterizer backed by GDI+ path stroking with "Microsoft YaHei".
+// GDI+ must be started before construction and outlive this object.
+class GdiplusTextRasterizer : public TextRasterizer {
+ public:
+  GdiplusTextRasterizer();
+  ~GdiplusTextRasterizer() override;
+
+  float MeasureText(const std::string& utf8, const TextStyle& style) override;
+  void DrawText(ArgbSurface* target, const std::string& utf8,
+                const TextStyle& style, float x, float y,
+                float height) override;
+
+ private:
+  float MeasureWide(const std::wstring& text, const TextStyle& style);
+
+  Gdiplus::FontFamily font_family_;
+  // 1x1 surface used only for MeasureString.
+  std::unique_ptr<Gdiplus::Bitmap> measure_bitmap_;
+  std::unique_ptr<Gdiplus::Graphics> measure_graphics_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_GDIPLUS_TEXT_RASTERIZER_H_
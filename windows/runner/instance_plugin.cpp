@@ -0,0 +1,121 @@
+#include "instance_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "instance/instance_handoff.h"
+
+namespace cyrene_music {
+
+namespace {
+
+flutter::EncodableValue ToEncodable(
+    const std::vector<InstanceHandoff::ArgumentList>& lists) {
+  flutter::EncodableList encoded;
+  encoded.reserve(lists.size());
+  for (const InstanceHandoff::ArgumentList& arguments : lists) {
+    flutter::EncodableList list;
+    list.reserve(arguments.size());
+    for (const std::string& argument : arguments) {
+      list.emplace_back(argument);
+    }
+    encoded.emplace_back(std::move(list));
+  }
+  return flutter::EncodableValue(std::move(encoded));
+}
+
+}  // namespace
+
+void InstancePlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  registrar->AddPlugin(std::make_unique<InstancePlugin>(registrar));
+}
+
+InstancePlugin::InstancePlugin(flutter::PluginRegistrarWindows* registrar)
+    : registrar_(registrar),
+      window_(GetAncestor(registrar->GetView()->GetNativeWindow(), GA_ROOT)),
+      wake_message_(RegisterWindowMessageW(L"CyreneMusicInstanceHandoff")) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      registrar->messenger(), "com.cyrene.music/instance",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+
+  window_proc_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+      [this](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+        return HandleWindowProc(hwnd, message, wparam, lparam);
+      });
+
+  // Lists may already be queued: the handoff listens from wWinMain on.
+  HWND window = window_;
+  UINT wake_message = wake_message_;
+  InstanceHandoff::Shared().SetNotify([window, wake_message] {
+    PostMessageW(window, wake_message, 0, 0);
+  });
+}
+
+InstancePlugin::~InstancePlugin() {
+  InstanceHandoff::Shared().SetNotify(nullptr);
+  registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+}
+
+void InstancePlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  if (method_call.method_name() == "ready") {
+    // Everything queued so far, launch arguments first; later lists come
+    // as "onArguments".
+    dart_ready_ = true;
+    result->Success(ToEncodable(InstanceHandoff::Shared().TakePending()));
+  } else {
+    result->NotImplemented();
+  }
+}
+
+std::optional<LRESULT> InstancePlugin::HandleWindowProc(HWND hwnd,
+                                                        UINT message,
+                                                        WPARAM wparam,
+                                                        LPARAM lparam) {
+  if (message != wake_message_) return std::nullopt;
+  RaiseWindow();
+  DeliverPending();
+  return 0;
+}
+
+void InstancePlugin::DeliverPending() {
+  if (!dart_ready_) return;
+  std::vector<InstanceHandoff::ArgumentList> pending =
+      InstanceHandoff::Shared().TakePending();
+  for (InstanceHandoff::ArgumentList& arguments : pending) {
+    flutter::EncodableList list;
+    list.reserve(arguments.size());
+    for (std::string& argument : arguments) {
+      list.emplace_back(std::move(argument));
+    }
+    channel_->InvokeMethod(
+        "onArguments",
+        std::make_unique<flutter::EncodableValue>(std::move(list)));
+  }
+}
+
+void InstancePlugin::RaiseWindow() {
+  // Hidden when minimized to the tray.
+  if (!IsWindowVisible(window_)) {
+    ShowWindow(window_, SW_SHOW);
+  }
+  if (IsIconic(window_)) {
+    ShowWindow(window_, SW_RESTORE);
+  }
+  // Allowed because the launching process passed its foreground right on.
+  SetForegroundWindow(window_);
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,49 @@
+#ifndef RUNNER_INSTANCE_PLUGIN_H_
+#define RUNNER_INSTANCE_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+#include <windows.h>
+
+#include <memory>
+#include <optional>
+
+namespace cyrene_music {
+
+// Receives the command lines that later launches hand to this process
+// through InstanceHandoff. Each one raises the main window and reaches Dart
+// as an "onArguments" call on "com.cyrene.music/instance"; lists that
+// arrive before Dart has called "ready" (including this process's own
+// launch arguments) are returned from that call instead.
+class InstancePlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit InstancePlugin(flutter::PluginRegistrarWindows* registrar);
+  ~InstancePlugin() override;
+
+  InstancePlugin(const InstancePlugin&) = delete;
+  InstancePlugin& operator=(const InstancePlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Platform thread; the listener thread posts |wake_message_| to get here.
+  std::optional<LRESULT> HandleWindowProc(HWND hwnd, UINT message,
+                                          WPARAM wparam, LPARAM lparam);
+  void DeliverPending();
+  void RaiseWindow();
+
+  flutter::PluginRegistrarWindows* registrar_;
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  HWND window_;
+  UINT wake_message_;
+  int window_proc_id_;
+  bool dart_ready_ = false;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_INSTANCE_PLUGIN_H_
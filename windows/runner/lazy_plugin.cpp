@@ -0,0 +1,56 @@
+#include "lazy_plugin.h"
+
+#include <map>
+
+namespace cyrene_music {
+
+namespace {
+
+// Thread timers carry no user data; map their ids back to the owner.
+// Platform thread only.
+std::map<UINT_PTR, ThreadTimer*>& Timers() {
+  static std::map<UINT_PTR, ThreadTimer*> timers;
+  return timers;
+}
+
+}  // namespace
+
+ThreadTimer::ThreadTimer(std::function<void()> callback)
+    : callback_(std::move(callback)) {}
+
+ThreadTimer::~ThreadTimer() { Stop(); }
+
+void ThreadTimer::Start(std::chrono::milliseconds delay) {
+  const UINT elapse = static_cast<UINT>(
+      delay.count() < USER_TIMER_MINIMUM ? USER_TIMER_MINIMUM : delay.count());
+  // Passing the current id re-arms the existing timer.
+  const UINT_PTR id = ::SetTimer(nullptr, id_, elapse, &ThreadTimer::OnTimer);
+  if (id == 0) return;
+  if (id != id_) {
+    Stop();
+    id_ = id;
+    Timers()[id_] = this;
+  }
+}
+
+void ThreadTimer::Stop() {
+  if (id_ == 0) return;
+  ::KillTimer(nullptr, id_);
+  Timers().erase(id_);
+  id_ = 0;
+}
+
+// static
+void CALLBACK ThreadTimer::OnTimer(HWND hwnd, UINT message, UINT_PTR id,
+                                   DWORD time) {
+  auto it = Timers().find(id);
+  if (it == Timers().end()) {
+    ::KillTimer(nullptr, id);
+    return;
+  }
+  ThreadTimer* timer = it->second;
+  timer->Stop();  // one-shot; the callback may start it again
+  timer->callback_();
+}
+
+}  // namespace cyrene_music
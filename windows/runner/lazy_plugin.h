@@ -0,0 +1,122 @@
+#ifndef RUNNER_LAZY_PLUGIN_H_
+#define RUNNER_LAZY_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+#include <flutter/standard_method_codec.h>
+#include <windows.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace cyrene_music {
+
+// One-shot timer serviced by the calling thread's message loop, so the
+// callback runs on the platform thread like every channel handler.
+class ThreadTimer {
+ public:
+  explicit ThreadTimer(std::function<void()> callback);
+  ~ThreadTimer();
+
+  ThreadTimer(const ThreadTimer&) = delete;
+  ThreadTimer& operator=(const ThreadTimer&) = delete;
+
+  // (Re)arms the timer.
+  void Start(std::chrono::milliseconds delay);
+  void Stop();
+
+ private:
+  static void CALLBACK OnTimer(HWND hwnd, UINT message, UINT_PTR id,
+                               DWORD time);
+
+  std::function<void()> callback_;
+  UINT_PTR id_ = 0;
+};
+
+// Channel stub for a runner plugin with heavy resources (windows, GDI+,
+// COM apartments, worker threads). Only the channel exists at startup; the
+// first method call builds |Plugin| and hands the call on, and once the
+// channel has been quiet for |idle_timeout| and the plugin says it holds no
+// state Dart relies on, the plugin is destroyed again.
+//
+// |Plugin| must provide
+//   void HandleMethodCall(const flutter::MethodCall<EncodableValue>&,
+//                         std::unique_ptr<flutter::MethodResult<...>>);
+//   bool CanRelease() const;
+// The channel belongs to the stub and outlives every plugin instance, so
+// plugins may keep the pointer the factory receives for calls into Dart.
+template <typename Plugin>
+class LazyPlugin : public flutter::Plugin {
+ public:
+  using Channel = flutter::MethodChannel<flutter::EncodableValue>;
+  using Factory = std::function<std::unique_ptr<Plugin>(Channel* channel)>;
+
+  LazyPlugin(flutter::BinaryMessenger* messenger,
+             const std::string& channel_name,
+             std::chrono::milliseconds idle_timeout, Factory factory)
+      : channel_(std::make_unique<Channel>(
+            messenger, channel_name,
+            &flutter::StandardMethodCodec::GetInstance())),
+        idle_timeout_(idle_timeout),
+        factory_(std::move(factory)),
+        idle_timer_([this] { OnIdleTimer(); }) {
+    channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+      Get()->HandleMethodCall(call, std::move(result));
+    });
+  }
+
+  ~LazyPlugin() override {
+    idle_timer_.Stop();
+    plugin_.reset();
+    channel_->SetMethodCallHandler(nullptr);
+  }
+
+  LazyPlugin(const LazyPlugin&) = delete;
+  LazyPlugin& operator=(const LazyPlugin&) = delete;
+
+  // The plugin, built on demand; counts as use for the idle timeout.
+  Plugin* Get() {
+    last_used_ = Clock::now();
+    if (!plugin_) {
+      plugin_ = factory_(channel_.get());
+      idle_timer_.Start(idle_timeout_);
+    }
+    return plugin_.get();
+  }
+
+  // The plugin if it currently exists, without building it.
+  Plugin* instance() const { return plugin_.get(); }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void OnIdleTimer() {
+    const Clock::duration idle = Clock::now() - last_used_;
+    if (idle < idle_timeout_) {
+      idle_timer_.Start(std::chrono::duration_cast<std::chrono::milliseconds>(
+          idle_timeout_ - idle));
+      return;
+    }
+    if (!plugin_->CanRelease()) {
+      // Still in use without talking to Dart (a visible window, a running
+      // capture); look again later.
+      idle_timer_.Start(idle_timeout_);
+      return;
+    }
+    plugin_.reset();
+  }
+
+  std::unique_ptr<Channel> channel_;
+  std::chrono::milliseconds idle_timeout_;
+  Factory factory_;
+  std::unique_ptr<Plugin> plugin_;
+  Clock::time_point last_used_;
+  ThreadTimer idle_timer_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_LAZY_PLUGIN_H_
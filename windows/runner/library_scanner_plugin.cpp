@@ -0,0 +1,174 @@
+#include "library_scanner_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "channel/method_dispatch.h"
+
+namespace cyrene_music {
+
+namespace {
+
+flutter::EncodableValue ToEncodable(LibraryScanBatch&& batch) {
+  using flutter::EncodableList;
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+
+  EncodableList tracks;
+  tracks.reserve(batch.tracks.size());
+  for (LibraryTrack& track : batch.tracks) {
+    tracks.emplace_back(EncodableMap{
+        {EncodableValue("path"), EncodableValue(std::move(track.path))},
+        {EncodableValue("format"), EncodableValue(track.format)},
+        {EncodableValue("title"), EncodableValue(std::move(track.title))},
+        {EncodableValue("artist"), EncodableValue(std::move(track.artist))},
+        {EncodableValue("album"), EncodableValue(std::move(track.album))},
+        {EncodableValue("lyric"), EncodableValue(std::move(track.lyric))},
+        {EncodableValue("cover"), EncodableValue(std::move(track.cover_path))},
+    });
+  }
+  EncodableMap encoded{
+      {EncodableValue("tracks"), EncodableValue(std::move(tracks))},
+      {EncodableValue("done"), EncodableValue(batch.done)},
+  };
+  if (batch.done) {
+    const LibraryScanStats& stats = batch.stats;
+    const auto value = [](uint64_t n) {
+      return EncodableValue(static_cast<int64_t>(n));
+    };
+    encoded[EncodableValue("removed")] = EncodableValue(
+        EncodableList(batch.removed.begin(), batch.removed.end()));
+    encoded[EncodableValue("cancelled")] = EncodableValue(batch.cancelled);
+    encoded[EncodableValue("stats")] = EncodableValue(EncodableMap{
+        {EncodableValue("directories"), value(stats.directories)},
+        {EncodableValue("files"), value(stats.files)},
+        {EncodableValue("changed"), value(stats.changed)},
+        {EncodableValue("unchanged"), value(stats.unchanged)},
+        {EncodableValue("removed"), value(stats.removed)},
+        {EncodableValue("elapsedMs"), EncodableValue(stats.elapsed_ms)},
+    });
+  }
+  return EncodableValue(std::move(encoded));
+}
+
+}  // namespace
+
+void LibraryScannerPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  registrar->AddPlugin(std::make_unique<LibraryScannerPlugin>(registrar));
+}
+
+LibraryScannerPlugin::LibraryScannerPlugin(
+    flutter::PluginRegistrarWindows* registrar)
+    : registrar_(registrar),
+      wake_message_(RegisterWindowMessageW(L"CyreneMusicLibraryScan")) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      registrar->messenger(), "com.cyrene.music/library_scanner",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+
+  window_proc_id_ = registrar_->RegisterTopLevelWindowProcDelegate(
+      [this](HWND hwnd, UINT message, WPARAM wparam, LPARAM lparam) {
+        return HandleWindowProc(hwnd, message, wparam, lparam);
+      });
+
+  HWND window = GetAncestor(registrar->GetView()->GetNativeWindow(), GA_ROOT);
+  UINT wake_message = wake_message_;
+  scanner_.SetNotify([window, wake_message] {
+    PostMessageW(window, wake_message, 0, 0);
+  });
+}
+
+LibraryScannerPlugin::~LibraryScannerPlugin() {
+  scanner_.SetNotify(nullptr);
+  registrar_->UnregisterTopLevelWindowProcDelegate(window_proc_id_);
+}
+
+void LibraryScannerPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(LibraryScannerPlugin* plugin,
+                           const EncodableMap* args, MethodResult* result);
+
+  static const MethodTable<Handler> methods{
+      {"scan",
+       [](LibraryScannerPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         LibraryScanOptions options;
+         const ArgError error = DecodeArgs(
+             args, Required("roots", &options.roots),
+             Required("extensions", &options.extensions),
+             Optional("indexPath", &options.index_path),
+             Optional("saveIndexPath", &options.save_path),
+             Optional("coverDirectory", &options.cover_directory),
+             Optional("full", &options.full));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         result->Success(
+             EncodableValue(plugin->scanner_.Start(std::move(options))));
+       }},
+      {"cancel",
+       [](LibraryScannerPlugin* plugin, const EncodableMap*,
+          MethodResult* result) {
+         plugin->scanner_.Cancel();
+         result->Success(EncodableValue(true));
+       }},
+      {"resetIndex",
+       [](LibraryScannerPlugin* plugin, const EncodableMap* args,
+          MethodResult* result) {
+         std::string index_path;
+         const ArgError error =
+             DecodeArgs(args, Required("indexPath", &index_path));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         if (plugin->scanner_.running()) {
+           result->Error("BUSY", "A scan is running");
+           return;
+         }
+         LibraryScanner::ResetIndex(index_path);
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(this, std::get_if<EncodableMap>(method_call.arguments()),
+             result.get());
+}
+
+std::optional<LRESULT> LibraryScannerPlugin::HandleWindowProc(HWND hwnd,
+                                                              UINT message,
+                                                              WPARAM wparam,
+                                                              LPARAM lparam) {
+  if (message != wake_message_) return std::nullopt;
+  DeliverBatches();
+  return 0;
+}
+
+void LibraryScannerPlugin::DeliverBatches() {
+  for (LibraryScanBatch& batch : scanner_.TakeBatches()) {
+    channel_->InvokeMethod("onBatch", std::make_unique<flutter::EncodableValue>(
+                                          ToEncodable(std::move(batch))));
+  }
+}
+
+}  // namespace cyrene_music
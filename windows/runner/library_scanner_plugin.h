@@ -0,0 +1,52 @@
+#ifndef RUNNER_LIBRARY_SCANNER_PLUGIN_H_
+#define RUNNER_LIBRARY_SCANNER_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+#include <windows.h>
+
+#include <memory>
+#include <optional>
+
+#include "library/library_scanner.h"
+
+namespace cyrene_music {
+
+// Scans local music folders for LocalLibraryService on a native
+// LibraryScanner. "scan" {roots, extensions, indexPath, coverDirectory,
+// full} returns whether the scan started; the tracks then reach Dart as
+// "onBatch" calls on "com.cyrene.music/library_scanner", the last one with
+// "done" set, the removed paths and the totals. "cancel" stops a running
+// scan, "resetIndex" {indexPath} forgets what earlier scans saw.
+class LibraryScannerPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit LibraryScannerPlugin(flutter::PluginRegistrarWindows* registrar);
+  ~LibraryScannerPlugin() override;
+
+  LibraryScannerPlugin(const LibraryScannerPlugin&) = delete;
+  LibraryScannerPlugin& operator=(const LibraryScannerPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  // Platform thread; scanning threads post |wake_message_| to get here.
+  std::optional<LRESULT> HandleWindowProc(HWND hwnd, UINT message,
+                                          WPARAM wparam, LPARAM lparam);
+  void DeliverBatches();
+
+  flutter::PluginRegistrarWindows* registrar_;
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  UINT wake_message_;
+  int window_proc_id_;
+  // Last, so a scan still running is cancelled and joined before the
+  // channel goes away.
+  LibraryScanner scanner_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_LIBRARY_SCANNER_PLUGIN_H_
@@ -1,50 +1,87 @@
 #include <flutter/dart_project.h>
 #include <flutter/flutter_view_controller.h>
 #include <windows.h>
-#include <timeapi.h>
 #include <shobjidl.h>
 
-#pragma comment(lib, "winmm.lib")
-
 #include <propkey.h>
 #include <propvarutil.h>
+#include <chrono>
 #include <cstdlib>
 
 #include "flutter_window.h"
+#include "instance/instance_handoff.h"
+#include "thread/thread_role.h"
+#include "trace/startup_trace.h"
 #include "utils.h"
 
 #include <bitsdojo_window_windows/bitsdojo_window_plugin.h>
 auto bdw = bitsdojo_window_configure(BDW_CUSTOM_FRAME | BDW_HIDE_ON_STARTUP);
 
+namespace {
+
+// How long a second launch waits for the running instance to take its
+// arguments; it normally answers within a millisecond.
+constexpr std::chrono::milliseconds kHandoffTimeout(3000);
+
+// Fallback when the running instance does not answer the handoff.
+void RaiseExistingWindow() {
+  HWND existing_window = FindWindow(L"FLUTTER_RUNNER_WIN32_WINDOW", nullptr);
+  if (!existing_window) {
+    return;
+  }
+  // If the window is hidden (e.g., minimized to tray), show it first
+  if (!IsWindowVisible(existing_window)) {
+    ShowWindow(existing_window, SW_SHOW);
+  }
+  // If minimized, restore it
+  if (IsIconic(existing_window)) {
+    ShowWindow(existing_window, SW_RESTORE);
+  }
+  // Bring to foreground
+  SetForegroundWindow(existing_window);
+}
+
+}  // namespace
+
 int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
                       _In_ wchar_t *command_line, _In_ int show_command) {
-  // 提升系统计时器精度到 1ms，确保高刷新率下的 VSync 同步精准
-  timeBeginPeriod(1);
-  
-  // 设置进程为高优先级，确保渲染线程获得稳定调度
-  SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
-  // Ensure only one instance is running
-  const wchar_t kUniqueMutexName[] = L"Local\\CyreneMusicInstanceMutex";
-  HANDLE mutex = CreateMutex(nullptr, TRUE, kUniqueMutexName);
-  (void)mutex;
-  if (GetLastError() == ERROR_ALREADY_EXISTS) {
-    HWND existing_window = FindWindow(L"FLUTTER_RUNNER_WIN32_WINDOW", nullptr);
-    if (existing_window) {
-      // If the window is hidden (e.g., minimized to tray), show it first
-      if (!IsWindowVisible(existing_window)) {
-        ShowWindow(existing_window, SW_SHOW);
-      }
-      
-      // If minimized, restore it
-      if (IsIconic(existing_window)) {
-        ShowWindow(existing_window, SW_RESTORE);
-      }
-      
-      // Bring to foreground
-      SetForegroundWindow(existing_window);
+  // --trace-startup[=<file>]：记录从入口到首帧的启动耗时（Chrome trace JSON）
+  std::vector<std::string> command_line_arguments =
+      GetCommandLineArguments();
+  std::string trace_path;
+  for (auto it = command_line_arguments.begin();
+       it != command_line_arguments.end(); ++it) {
+    if (cyrene_music::StartupTrace::ParseFlag(*it, &trace_path)) {
+      cyrene_music::StartupTrace::Shared().Enable(trace_path);
+      command_line_arguments.erase(it);
+      break;
+    }
+  }
+
+  // 单实例：后启动的进程把命令行参数交给已运行的实例后立即退出，
+  // 不再经历第二次冷启动（例如从资源管理器打开音乐文件）
+  auto& handoff = cyrene_music::InstanceHandoff::Shared();
+  if (!handoff.ClaimPrimary("CyreneMusic")) {
+    // 相对路径按本进程的工作目录展开，已运行的实例不在同一目录
+    if (!handoff.Forward(
+            cyrene_music::InstanceHandoff::WithAbsolutePaths(
+                command_line_arguments),
+            kHandoffTimeout)) {
+      // 旧实例没有应答，至少把它的窗口带到前台
+      RaiseExistingWindow();
     }
     return EXIT_SUCCESS;
   }
+  // 尽早监听，冷启动期间再次打开的文件也能排队交给 Dart
+  handoff.Listen();
+  if (!command_line_arguments.empty()) {
+    handoff.Post(command_line_arguments);
+  }
+
+  // 平台线程按普通优先级调度。不再提升整个进程的优先级和系统计时器精度：
+  // 需要的线程（歌词滚动、音频捕获）在工作期间通过 ScopedThreadRole 申请，
+  // Flutter 引擎自行提升光栅线程的优先级
+  cyrene_music::ScopedThreadRole ui_role(cyrene_music::ThreadRole::kUi);
 
   // Attach to console when present (e.g., 'flutter run') or create a
   // new console when running with a debugger.
@@ -54,7 +91,10 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
 
   // Initialize COM, so that it is available for use in the library and/or
   // plugins.
-  ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  {
+    cyrene_music::StartupTrace::Scope trace("CoInitializeEx");
+    ::CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+  }
 
   // 设置 AppUserModelID，确保 SMTC 可以正确识别应用
   // 格式: 公司名.应用名.子产品.版本号
@@ -65,18 +105,16 @@ int APIENTRY wWinMain(_In_ HINSTANCE instance, _In_opt_ HINSTANCE prev,
 
   flutter::DartProject project(L"data");
 
-  // 获取命令行参数
-
-  std::vector<std::string> command_line_arguments =
-      GetCommandLineArguments();
-
   project.set_dart_entrypoint_arguments(std::move(command_line_arguments));
 
   FlutterWindow window(project);
   Win32Window::Point origin(10, 10);
   Win32Window::Size size(1280, 720);
-  if (!window.Create(L"cyrene_music", origin, size)) {
-    return EXIT_FAILURE;
+  {
+    cyrene_music::StartupTrace::Scope trace("FlutterWindow::Create");
+    if (!window.Create(L"cyrene_music", origin, size)) {
+      return EXIT_FAILURE;
+    }
   }
   window.SetQuitOnClose(true);
 
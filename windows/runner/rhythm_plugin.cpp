@@ -9,6 +9,11 @@
 #include <algorithm>
 #include <complex>
 
+#include "audio/spectrum_slot.h"
+#include "lazy_plugin.h"
+#include "playback/playback_clock.h"
+#include "thread/thread_role.h"
+
 #pragma comment(lib, "Ole32.lib")
 
 namespace cyrene_music {
@@ -43,30 +48,50 @@ namespace {
     }
 }
 
+namespace {
+
+// The stub also owns the SpectrumSlot demand hook, so in-process readers
+// (the desktop lyric spectrum strip) can bring the plugin up and start
+// capture without going through Dart.
+class LazyRhythmPlugin : public LazyPlugin<RhythmPlugin> {
+ public:
+  LazyRhythmPlugin(flutter::BinaryMessenger* messenger,
+                   std::chrono::milliseconds idle_release)
+      : LazyPlugin<RhythmPlugin>(
+            messenger, "com.cyrene.music/rhythm_method", idle_release,
+            [messenger](flutter::MethodChannel<flutter::EncodableValue>*) {
+              return std::make_unique<RhythmPlugin>(messenger);
+            }) {
+    SpectrumSlot::Shared().SetDemandCallback([this]() {
+      RhythmPlugin* plugin =
+          SpectrumSlot::Shared().readers() > 0 ? Get() : instance();
+      if (plugin != nullptr) plugin->UpdateCaptureState();
+    });
+  }
+
+  ~LazyRhythmPlugin() override {
+    SpectrumSlot::Shared().SetDemandCallback(nullptr);
+  }
+};
+
+}  // namespace
+
 void RhythmPlugin::RegisterWithRegistrar(
-    FlutterDesktopPluginRegistrarRef registrar_ref) {
+    FlutterDesktopPluginRegistrarRef registrar_ref,
+    std::chrono::milliseconds idle_release) {
   auto registrar =
       flutter::PluginRegistrarManager::GetInstance()
           ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
 
-  auto plugin = std::make_unique<RhythmPlugin>(registrar->messenger());
-  registrar->AddPlugin(std::move(plugin));
+  registrar->AddPlugin(
+      std::make_unique<LazyRhythmPlugin>(registrar->messenger(), idle_release));
 }
 
 RhythmPlugin::RhythmPlugin(flutter::BinaryMessenger* messenger) {
-  method_channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-      messenger, "com.cyrene.music/rhythm_method",
-      &flutter::StandardMethodCodec::GetInstance());
-  
   event_channel_ = std::make_unique<flutter::EventChannel<flutter::EncodableValue>>(
       messenger, "com.cyrene.music/rhythm_event",
       &flutter::StandardMethodCodec::GetInstance());
 
-  method_channel_->SetMethodCallHandler(
-      [this](const auto &call, auto result) {
-        HandleMethodCall(call, std::move(result));
-      });
-
   auto handler = std::make_unique<RhythmStreamHandler>(this);
   event_channel_->SetStreamHandler(std::move(handler));
 
@@ -75,25 +100,37 @@ RhythmPlugin::RhythmPlugin(flutter::BinaryMessenger* messenger) {
 
 RhythmPlugin::~RhythmPlugin() {
   StopCapture();
+  event_channel_->SetStreamHandler(nullptr);
 }
 
 void RhythmPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue> &method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
   if (method_call.method_name() == "start") {
-    StartCapture();
+    dart_requested_ = true;
+    UpdateCaptureState();
     result->Success(flutter::EncodableValue(true));
   } else if (method_call.method_name() == "stop") {
-    StopCapture();
+    dart_requested_ = false;
+    UpdateCaptureState();
     result->Success(flutter::EncodableValue(true));
   } else {
     result->NotImplemented();
   }
 }
 
+void RhythmPlugin::UpdateCaptureState() {
+  if (dart_requested_ || SpectrumSlot::Shared().readers() > 0) {
+    StartCapture();
+  } else {
+    StopCapture();
+  }
+}
+
 void RhythmPlugin::StartCapture() {
   if (is_capturing_) return;
   is_capturing_ = true;
+  SpectrumSlot::Shared().SetPublishing(true);
   capture_thread_ = std::thread(&RhythmPlugin::CaptureThread, this);
 }
 
@@ -105,6 +142,14 @@ void RhythmPlugin::StopCapture() {
 }
 
 void RhythmPlugin::CaptureThread() {
+    // Raised priority (MMCSS) and the 1 ms timer only while capturing.
+    ScopedThreadRole role(ThreadRole::kAudioCapture);
+
+    // Whatever path the thread leaves by, readers stop waiting for frames.
+    struct PublishingGuard {
+        ~PublishingGuard() { SpectrumSlot::Shared().SetPublishing(false); }
+    } publishing_guard;
+
     HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
     if (FAILED(hr)) return;
 
@@ -138,6 +183,16 @@ void RhythmPlugin::CaptureThread() {
     pcm_buffer.reserve(FFT_SIZE);
 
     while (is_capturing_) {
+        // Loopback hears every app; while our own player is paused there is
+        // nothing worth analysing, so skip the FFT and let the bands drop.
+        PlaybackSnapshot playback;
+        const bool player_paused =
+            PlaybackClock::Shared().Read(&playback) && !playback.playing();
+        if (player_paused) {
+            std::lock_guard<std::mutex> lock(magnitude_mutex_);
+            std::fill(fft_magnitudes_.begin(), fft_magnitudes_.end(), 0.0f);
+        }
+
         UINT32 nextPacketSize = 0;
         hr = captureClient->GetNextPacketSize(&nextPacketSize);
         if (FAILED(hr)) break;
@@ -163,7 +218,9 @@ void RhythmPlugin::CaptureThread() {
                     pcm_buffer.push_back(sample);
 
                     if (pcm_buffer.size() >= FFT_SIZE) {
-                        ProcessAudioData(pcm_buffer.data(), FFT_SIZE, 1);
+                        if (!player_paused) {
+                            ProcessAudioData(pcm_buffer.data(), FFT_SIZE, 1);
+                        }
                         pcm_buffer.clear();
                     }
                 }
@@ -180,6 +237,13 @@ void RhythmPlugin::CaptureThread() {
             if (FAILED(hr)) break;
         }
 
+        {
+            // Latest frame for in-process readers; never blocks on them
+            std::lock_guard<std::mutex> lock(magnitude_mutex_);
+            SpectrumSlot::Shared().Publish(fft_magnitudes_.data(),
+                                           static_cast<int>(fft_magnitudes_.size()));
+        }
+
         // Send data to Flutter
         if (event_sink_) {
             std::lock_guard<std::mutex> lock(magnitude_mutex_);
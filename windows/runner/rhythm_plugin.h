@@ -4,6 +4,7 @@
 #include <flutter/method_channel.h>
 #include <flutter/event_channel.h>
 #include <flutter/plugin_registrar_windows.h>
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <thread>
@@ -15,20 +16,31 @@
 
 namespace cyrene_music {
 
-class RhythmPlugin : public flutter::Plugin {
+// Registered as a channel stub: the plugin (and its event channel) exists
+// only while Dart or the desktop lyric spectrum strip wants capture, plus
+// |idle_release| after that.
+class RhythmPlugin {
  public:
-  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar,
+                                    std::chrono::milliseconds idle_release);
 
-  RhythmPlugin(flutter::BinaryMessenger* messenger);
+  explicit RhythmPlugin(flutter::BinaryMessenger* messenger);
   virtual ~RhythmPlugin();
 
   friend class RhythmStreamHandler;
 
- private:
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue> &method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
+  // Runs capture while Dart or an in-process reader of the shared
+  // SpectrumSlot wants it.
+  void UpdateCaptureState();
+
+  // True once capture has stopped and Dart has stopped listening.
+  bool CanRelease() const { return !is_capturing_ && !event_sink_; }
+
+ private:
   void StartCapture();
   void StopCapture();
   void CaptureThread();
@@ -36,12 +48,12 @@ class RhythmPlugin : public flutter::Plugin {
   // Audio Capture Implementation
   void ProcessAudioData(float* buffer, uint32_t frames, uint32_t channels);
 
-  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> method_channel_;
   std::unique_ptr<flutter::EventChannel<flutter::EncodableValue>> event_channel_;
   std::unique_ptr<flutter::EventSink<flutter::EncodableValue>> event_sink_;
 
   std::thread capture_thread_;
   std::atomic<bool> is_capturing_{false};
+  bool dart_requested_ = false;
   
   // FFT state
   std::vector<float> fft_magnitudes_;
@@ -0,0 +1,356 @@
+#include "schannel_tls_connector.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "net/socket.h"
+
+// After Winsock, which must come before <windows.h>.
+#define SECURITY_WIN32
+#include <security.h>
+#include <schannel.h>
+
+namespace cyrene_music {
+
+namespace {
+
+constexpr DWORD kContextFlags =
+    ISC_REQ_SEQUENCE_DETECT | ISC_REQ_REPLAY_DETECT | ISC_REQ_CONFIDENTIALITY |
+    ISC_REQ_ALLOCATE_MEMORY | ISC_REQ_STREAM | ISC_REQ_EXTENDED_ERROR;
+
+// One TLS record (16 KB) and its overhead.
+constexpr size_t kReadSize = 16 * 1024 + 512;
+
+SecBuffer MakeBuffer(unsigned long type, void* data, size_t size) {
+  SecBuffer buffer;
+  buffer.cbBuffer = static_cast<unsigned long>(size);
+  buffer.BufferType = type;
+  buffer.pvBuffer = data;
+  return buffer;
+}
+
+std::string StatusText(SECURITY_STATUS status) {
+  switch (status) {
+    case SEC_E_UNTRUSTED_ROOT:
+      return "untrusted certificate";
+    case SEC_E_WRONG_PRINCIPAL:
+      return "certificate name mismatch";
+    case SEC_E_CERT_EXPIRED:
+      return "certificate expired";
+    case SEC_I_INCOMPLETE_CREDENTIALS:
+      return "client certificate requested";
+    default:
+      break;
+  }
+  char text[32];
+  std::snprintf(text, sizeof(text), "status 0x%08lX",
+                static_cast<unsigned long>(status));
+  return text;
+}
+
+bool SendAll(SocketHandle s, const char* data, size_t size) {
+  while (size > 0) {
+    const int chunk = static_cast<int>(std::min<size_t>(size, 1 << 20));
+    const int n = send(s, data, chunk, 0);
+    if (n <= 0) return false;
+    data += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Sends a token InitializeSecurityContext allocated, then frees it.
+bool SendToken(SocketHandle s, SecBuffer* token) {
+  bool sent = true;
+  if (token->pvBuffer != nullptr) {
+    sent = SendAll(s, static_cast<const char*>(token->pvBuffer),
+                   token->cbBuffer);
+    FreeContextBuffer(token->pvBuffer);
+    token->pvBuffer = nullptr;
+    token->cbBuffer = 0;
+  }
+  return sent;
+}
+
+// What an input buffer InitializeSecurityContext or DecryptMessage left
+// unconsumed: the start of the next message, which stays in |data|.
+void KeepExtra(const SecBuffer& extra, std::string* data) {
+  if (extra.BufferType == SECBUFFER_EXTRA && extra.cbBuffer > 0) {
+    data->erase(0, data->size() - extra.cbBuffer);
+  } else {
+    data->clear();
+  }
+}
+
+class SchannelTransport : public Transport {
+ public:
+  SchannelTransport(SocketHandle s, CredHandle* credentials,
+                    const CtxtHandle& context,
+                    const SecPkgContext_StreamSizes& sizes, std::string host,
+                    std::string received)
+      : socket_(s),
+        credentials_(credentials),
+        context_(context),
+        sizes_(sizes),
+        host_(std::move(host)),
+        encrypted_(std::move(received)) {}
+
+  ~SchannelTransport() override {
+    DeleteSecurityContext(&context_);
+    CloseSocket(socket_);
+  }
+
+  ptrdiff_t Read(void* data, size_t size) override {
+    for (;;) {
+      if (plain_offset_ < plain_.size()) {
+        const size_t n = std::min(size, plain_.size() - plain_offset_);
+        std::memcpy(data, plain_.data() + plain_offset_, n);
+        plain_offset_ += n;
+        return static_cast<ptrdiff_t>(n);
+      }
+      if (closed_) return 0;
+      if (!encrypted_.empty()) {
+        const SECURITY_STATUS status =
+            renegotiating_ ? Renegotiate() : Decrypt();
+        if (status != SEC_E_INCOMPLETE_MESSAGE) {
+          if (status != SEC_E_OK) return kFailed;
+          continue;
+        }
+      }
+      char chunk[kReadSize];
+      const int n = recv(socket_, chunk, static_cast<int>(sizeof(chunk)), 0);
+      if (n < 0) return LastErrorWouldBlock() ? kWouldBlock : kFailed;
+      // A close without close_notify ends the stream, like it does with
+      // OpenSSL; a truncated length is still caught by the HTTP framing.
+      if (n == 0) return encrypted_.empty() ? 0 : kFailed;
+      encrypted_.append(chunk, static_cast<size_t>(n));
+    }
+  }
+
+  bool Write(const void* data, size_t size) override {
+    const char* bytes = static_cast<const char*>(data);
+    std::string message;
+    while (size > 0) {
+      const size_t n = std::min<size_t>(size, sizes_.cbMaximumMessage);
+      message.assign(sizes_.cbHeader + n + sizes_.cbTrailer, '\0');
+      std::memcpy(&message[sizes_.cbHeader], bytes, n);
+      SecBuffer buffers[4] = {
+          MakeBuffer(SECBUFFER_STREAM_HEADER, &message[0], sizes_.cbHeader),
+          MakeBuffer(SECBUFFER_DATA, &message[sizes_.cbHeader], n),
+          MakeBuffer(SECBUFFER_STREAM_TRAILER, &message[sizes_.cbHeader + n],
+                     sizes_.cbTrailer),
+          MakeBuffer(SECBUFFER_EMPTY, nullptr, 0)};
+      SecBufferDesc description = {SECBUFFER_VERSION, 4, buffers};
+      if (EncryptMessage(&context_, 0, &description, 0) != SEC_E_OK) {
+        return false;
+      }
+      // The trailer can come out shorter than its maximum.
+      const size_t length =
+          buffers[0].cbBuffer + buffers[1].cbBuffer + buffers[2].cbBuffer;
+      if (!SendAll(socket_, message.data(), length)) return false;
+      bytes += n;
+      size -= n;
+    }
+    return true;
+  }
+
+  intptr_t socket() const override { return static_cast<intptr_t>(socket_); }
+
+ private:
+  // Decrypts the next record in encrypted_ into plain_. SEC_E_OK if one
+  // was consumed (it may carry no data), SEC_E_INCOMPLETE_MESSAGE if more
+  // bytes are needed, anything else on failure.
+  SECURITY_STATUS Decrypt() {
+    SecBuffer buffers[4] = {
+        MakeBuffer(SECBUFFER_DATA, &encrypted_[0], encrypted_.size()),
+        MakeBuffer(SECBUFFER_EMPTY, nullptr, 0),
+        MakeBuffer(SECBUFFER_EMPTY, nullptr, 0),
+        MakeBuffer(SECBUFFER_EMPTY, nullptr, 0)};
+    SecBufferDesc description = {SECBUFFER_VERSION, 4, buffers};
+    const SECURITY_STATUS status =
+        DecryptMessage(&context_, &description, 0, nullptr);
+    if (status == SEC_E_INCOMPLETE_MESSAGE) return status;
+    if (status != SEC_E_OK && status != SEC_I_RENEGOTIATE &&
+        status != SEC_I_CONTEXT_EXPIRED) {
+      return status;
+    }
+
+    // The decrypted data and the leftover bytes both point into
+    // encrypted_, so copy the data out before trimming it.
+    plain_.clear();
+    plain_offset_ = 0;
+    SecBuffer extra = MakeBuffer(SECBUFFER_EMPTY, nullptr, 0);
+    for (const SecBuffer& buffer : buffers) {
+      if (buffer.BufferType == SECBUFFER_DATA) {
+        plain_.assign(static_cast<const char*>(buffer.pvBuffer),
+                      buffer.cbBuffer);
+      } else if (buffer.BufferType == SECBUFFER_EXTRA) {
+        extra = buffer;
+      }
+    }
+    KeepExtra(extra, &encrypted_);
+
+    if (status == SEC_I_CONTEXT_EXPIRED) {
+      closed_ = true;
+    } else if (status == SEC_I_RENEGOTIATE) {
+      return Renegotiate();
+    }
+    return SEC_E_OK;
+  }
+
+  // Post-handshake messages (session tickets, key updates) come back from
+  // DecryptMessage as SEC_I_RENEGOTIATE and go through
+  // InitializeSecurityContext with whatever followed them.
+  SECURITY_STATUS Renegotiate() {
+    SecBuffer in[2] = {MakeBuffer(SECBUFFER_TOKEN, &encrypted_[0],
+                                  encrypted_.size()),
+                       MakeBuffer(SECBUFFER_EMPTY, nullptr, 0)};
+    SecBuffer out[1] = {MakeBuffer(SECBUFFER_TOKEN, nullptr, 0)};
+    SecBufferDesc in_description = {SECBUFFER_VERSION, 2, in};
+    SecBufferDesc out_description = {SECBUFFER_VERSION, 1, out};
+    unsigned long attributes = 0;
+    const SECURITY_STATUS status = InitializeSecurityContextA(
+        credentials_, &context_, &host_[0], kContextFlags, 0, 0,
+        &in_description, 0, nullptr, &out_description, &attributes, nullptr);
+    // The rest of the message is still to come; retried on the next read.
+    renegotiating_ = status == SEC_E_INCOMPLETE_MESSAGE;
+    if (renegotiating_) return status;
+    const bool sent = SendToken(socket_, &out[0]);
+    if (FAILED(status)) return status;
+    if (!sent) return SEC_E_INTERNAL_ERROR;
+    KeepExtra(in[1], &encrypted_);
+    return SEC_E_OK;
+  }
+
+  const SocketHandle socket_;
+  CredHandle* const credentials_;
+  CtxtHandle context_;
+  const SecPkgContext_StreamSizes sizes_;
+  std::string host_;
+
+  // Received bytes not decrypted yet, and decrypted ones not read yet.
+  std::string encrypted_;
+  std::string plain_;
+  size_t plain_offset_ = 0;
+  bool renegotiating_ = false;
+  bool closed_ = false;
+};
+
+}  // namespace
+
+// static
+void SchannelTlsConnector::Install() {
+  static SchannelTlsConnector* connector = new SchannelTlsConnector();
+  SetTlsConnector(connector);
+}
+
+struct SchannelTlsConnector::Credentials {
+  CredHandle handle = {};
+};
+
+SchannelTlsConnector::SchannelTlsConnector() = default;
+
+SchannelTlsConnector::~SchannelTlsConnector() {
+  if (credentials_) FreeCredentialsHandle(&credentials_->handle);
+}
+
+SchannelTlsConnector::Credentials* SchannelTlsConnector::AcquireCredentials() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!credentials_) {
+    // Certificates are checked against the store and the target name
+    // automatically; the protocol versions are the system's defaults.
+    SCHANNEL_CRED settings = {};
+    settings.dwVersion = SCHANNEL_CRED_VERSION;
+    settings.dwFlags = SCH_USE_STRONG_CRYPTO | SCH_CRED_AUTO_CRED_VALIDATION |
+                       SCH_CRED_NO_DEFAULT_CREDS;
+    auto credentials = std::make_unique<Credentials>();
+    TimeStamp expiry;
+    if (AcquireCredentialsHandleA(nullptr, const_cast<char*>(UNISP_NAME_A),
+                                  SECPKG_CRED_OUTBOUND, nullptr, &settings,
+                                  nullptr, nullptr, &credentials->handle,
+                                  &expiry) == SEC_E_OK) {
+      credentials_ = std::move(credentials);
+    }
+  }
+  return credentials_.get();
+}
+
+std::unique_ptr<Transport> SchannelTlsConnector::Connect(
+    intptr_t socket, const std::string& host, std::string* error) {
+  const SocketHandle s = ToHandle(socket);
+  Credentials* acquired = AcquireCredentials();
+  if (acquired == nullptr) {
+    CloseSocket(s);
+    *error = "TLS unavailable";
+    return nullptr;
+  }
+
+  CredHandle* credentials = &acquired->handle;
+  // The target name is both the SNI and the name the certificate must
+  // carry.
+  std::string target = host;
+  CtxtHandle context;
+  bool have_context = false;
+  std::string received;
+  bool need_read = false;
+  SECURITY_STATUS status = SEC_E_OK;
+  for (;;) {
+    if (need_read) {
+      char chunk[kReadSize];
+      const int n = recv(s, chunk, static_cast<int>(sizeof(chunk)), 0);
+      if (n <= 0) {
+        status = SEC_E_INTERNAL_ERROR;
+        break;
+      }
+      received.append(chunk, static_cast<size_t>(n));
+    }
+
+    SecBuffer in[2] = {
+        MakeBuffer(SECBUFFER_TOKEN, &received[0], received.size()),
+        MakeBuffer(SECBUFFER_EMPTY, nullptr, 0)};
+    SecBuffer out[1] = {MakeBuffer(SECBUFFER_TOKEN, nullptr, 0)};
+    SecBufferDesc in_description = {SECBUFFER_VERSION, 2, in};
+    SecBufferDesc out_description = {SECBUFFER_VERSION, 1, out};
+    unsigned long attributes = 0;
+    status = InitializeSecurityContextA(
+        credentials, have_context ? &context : nullptr, &target[0],
+        kContextFlags, 0, 0, have_context ? &in_description : nullptr, 0,
+        have_context ? nullptr : &context, &out_description, &attributes,
+        nullptr);
+    if (status == SEC_E_INCOMPLETE_MESSAGE) {
+      need_read = true;
+      continue;
+    }
+    // With ISC_REQ_EXTENDED_ERROR a failure can carry an alert to send.
+    const bool sent = SendToken(s, &out[0]);
+    if (FAILED(status)) break;
+    have_context = true;
+    if (!sent) {
+      status = SEC_E_INTERNAL_ERROR;
+      break;
+    }
+    KeepExtra(in[1], &received);
+    if (status != SEC_I_CONTINUE_NEEDED) break;
+    need_read = received.empty();
+  }
+
+  SecPkgContext_StreamSizes sizes = {};
+  if (status == SEC_E_OK &&
+      QueryContextAttributesA(&context, SECPKG_ATTR_STREAM_SIZES, &sizes) !=
+          SEC_E_OK) {
+    status = SEC_E_INTERNAL_ERROR;
+  }
+  if (status != SEC_E_OK) {
+    if (have_context) DeleteSecurityContext(&context);
+    CloseSocket(s);
+    *error = "TLS handshake with " + host + " failed: " + StatusText(status);
+    return nullptr;
+  }
+  // Bytes past the handshake are the first application records.
+  return std::make_unique<SchannelTransport>(s, credentials, context, sizes,
+                                             host, std::move(received));
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,45 @@
+#ifndef RUNNER_SCHANNEL_TLS_CONNECTOR_H_
+#define RUNNER_SCHANNEL_TLS_CONNECTOR_H_
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "net/transport.h"
+
+namespace cyrene_music {
+
+// https:// for the native HTTP client (stream proxy, downloads) through
+// Schannel, which verifies servers against the Windows certificate store
+// and the host name. Connect() is safe from any thread; the credentials
+// handle is acquired with the first connection. The SSPI types stay in the
+// .cpp so this header does not drag in Winsock.
+class SchannelTlsConnector : public TlsConnector {
+ public:
+  // Installs a process-lifetime connector with SetTlsConnector(). Upstream
+  // threads may still be finishing a handshake at exit, so it is never
+  // destroyed.
+  static void Install();
+
+  SchannelTlsConnector();
+  ~SchannelTlsConnector() override;
+
+  SchannelTlsConnector(const SchannelTlsConnector&) = delete;
+  SchannelTlsConnector& operator=(const SchannelTlsConnector&) = delete;
+
+  std::unique_ptr<Transport> Connect(intptr_t socket, const std::string& host,
+                                     std::string* error) override;
+
+ private:
+  struct Credentials;
+
+  // The shared client credentials, or nullptr if Schannel refused them.
+  Credentials* AcquireCredentials();
+
+  std::mutex mutex_;
+  std::unique_ptr<Credentials> credentials_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_SCHANNEL_TLS_CONNECTOR_H_
@@ -3,12 +3,20 @@
 #include <flutter/event_channel.h>
 #include <flutter/event_stream_handler_functions.h>
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
+#include <utility>
+#include <vector>
 
 // Windows Runtime
 #include <winrt/Windows.Foundation.Collections.h>
 
+#include "channel/method_dispatch.h"
+#include "cover/cover_art_cache.h"
+#include "lazy_plugin.h"
+#include "playback/playback_clock.h"
+
 using namespace winrt;
 using namespace winrt::Windows::Foundation;
 using namespace winrt::Windows::Media;
@@ -16,39 +24,70 @@ using namespace winrt::Windows::Storage::Streams;
 
 namespace cyrene_music {
 
-// 单例实例
-static SmtcPlugin* g_smtc_plugin = nullptr;
-
-// 注册插件
-void SmtcPlugin::RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar) {
+void SmtcPlugin::RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar,
+                                       std::chrono::milliseconds idle_release) {
   // 从C API转换为C++ API
   auto registrar_cpp = flutter::PluginRegistrarManager::GetInstance()
                            ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar);
-  
-  auto channel = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
-      registrar_cpp->messenger(), "com.cyrene.music/smtc",
-      &flutter::StandardMethodCodec::GetInstance());
 
-  auto plugin = std::make_unique<SmtcPlugin>();
-  g_smtc_plugin = plugin.get();
-  
-  // 保存channel指针到plugin中
-  plugin->channel_ = std::move(channel);
+  registrar_cpp->AddPlugin(std::make_unique<LazyPlugin<SmtcPlugin>>(
+      registrar_cpp->messenger(), "com.cyrene.music/smtc", idle_release,
+      [](flutter::MethodChannel<flutter::EncodableValue>* channel) {
+        return std::make_unique<SmtcPlugin>(channel);
+      }));
+}
 
-  plugin->channel_->SetMethodCallHandler(
-      [plugin_pointer = plugin.get()](const auto& call, auto result) {
-        plugin_pointer->HandleMethodCall(call, std::move(result));
-      });
+namespace {
+
+// SMTC 更新的最小间隔：快速切歌时只应用最终状态
+constexpr std::chrono::milliseconds kMinApplyInterval(100);
+
+// 把缓存的缩略图封装为内存中的 BMP 流（工作线程，MTA 中可以同步等待）
+InMemoryRandomAccessStream ThumbnailStream(const ArgbSurface& thumbnail) {
+  const std::vector<uint8_t> bmp = EncodeBmp(thumbnail);
+  InMemoryRandomAccessStream stream;
+  DataWriter writer(stream);
+  writer.WriteBytes(winrt::array_view<const uint8_t>(bmp));
+  writer.StoreAsync().get();
+  writer.DetachStream();
+  stream.Seek(0);
+  return stream;
+}
 
-  // 不要释放plugin，保持其生命周期
-  plugin.release();
+}  // namespace
+
+void SmtcUpdate::Merge(SmtcUpdate&& newer) {
+  initialize = initialize || newer.initialize;
+  if (newer.enable) enable = newer.enable;
+  if (newer.metadata) metadata = std::move(newer.metadata);
+  if (newer.status) status = std::move(newer.status);
+  if (newer.timeline) timeline = newer.timeline;
+}
+
+bool SmtcUpdate::empty() const {
+  return !initialize && !enable && !metadata && !status && !timeline;
 }
 
-SmtcPlugin::SmtcPlugin() {
+SmtcPlugin::SmtcPlugin(flutter::MethodChannel<flutter::EncodableValue>* channel)
+    : channel_(channel) {
+  worker_ = std::make_unique<CoalescingWorker<SmtcUpdate>>(
+      kMinApplyInterval, [this](SmtcUpdate& update) { Apply(update); },
+      [] { winrt::init_apartment(winrt::apartment_type::multi_threaded); },
+      [this] {
+        Shutdown();
+        winrt::uninit_apartment();
+      });
   std::cout << "[SMTC] 插件已创建" << std::endl;
 }
 
 SmtcPlugin::~SmtcPlugin() {
+  // 应用剩余更新，并在工作线程的套间内释放 WinRT 对象
+  worker_.reset();
+  std::cout << "[SMTC] 插件已销毁" << std::endl;
+}
+
+// 释放 WinRT 对象（工作线程）
+void SmtcPlugin::Shutdown() {
   if (enabled_ && smtc_) {
     try {
       smtc_.ButtonPressed(button_pressed_token_);
@@ -62,72 +101,134 @@ SmtcPlugin::~SmtcPlugin() {
   if (media_player_) {
     try {
       media_player_.Close();
-      media_player_ = nullptr;
     } catch (...) {
       // 忽略清理错误
     }
   }
-  
-  std::cout << "[SMTC] 插件已销毁" << std::endl;
+  updater_ = nullptr;
+  smtc_ = nullptr;
+  media_player_ = nullptr;
+  initialized_ = false;
+  enabled_ = false;
+}
+
+// 按固定顺序应用一次合并后的更新（工作线程）
+void SmtcPlugin::Apply(SmtcUpdate& update) {
+  // 释放后重建的实例不会再收到 initialize，启用时补上
+  if (update.initialize || (update.enable && *update.enable && !initialized_)) {
+    Initialize();
+  }
+  if (update.enable) {
+    if (*update.enable) {
+      EnableSmtc();
+    } else {
+      DisableSmtc();
+    }
+  }
+  if (update.metadata) UpdateMetadata(*update.metadata);
+  if (update.status) UpdatePlaybackStatus(*update.status);
+  if (update.timeline) {
+    UpdateTimeline(*update.timeline);
+  } else if (update.status) {
+    // 暂停/恢复时位置可能已跳变，直接按共享时钟校准
+    SyncTimelineFromClock();
+  }
 }
 
 // 处理Method Channel调用
 void SmtcPlugin::HandleMethodCall(
     const flutter::MethodCall<flutter::EncodableValue>& method_call,
     std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
-  
-  const std::string& method_name = method_call.method_name();
-  
-  try {
-    if (method_name == "initialize") {
-      Initialize();
-      result->Success(flutter::EncodableValue(true));
-    } 
-    else if (method_name == "enable") {
-      EnableSmtc();
-      result->Success(flutter::EncodableValue(true));
-    } 
-    else if (method_name == "disable") {
-      DisableSmtc();
-      result->Success(flutter::EncodableValue(true));
-    } 
-    else if (method_name == "updateMetadata") {
-      const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-      if (arguments) {
-        UpdateMetadata(*arguments);
-        result->Success(flutter::EncodableValue(true));
-      } else {
-        result->Error("INVALID_ARGUMENT", "Expected map argument");
-      }
-    } 
-    else if (method_name == "updatePlaybackStatus") {
-      const auto* status = std::get_if<std::string>(method_call.arguments());
-      if (status) {
-        UpdatePlaybackStatus(*status);
-        result->Success(flutter::EncodableValue(true));
-      } else {
-        result->Error("INVALID_ARGUMENT", "Expected string argument");
-      }
-    } 
-    else if (method_name == "updateTimeline") {
-      const auto* arguments = std::get_if<flutter::EncodableMap>(method_call.arguments());
-      if (arguments) {
-        UpdateTimeline(*arguments);
-        result->Success(flutter::EncodableValue(true));
-      } else {
-        result->Error("INVALID_ARGUMENT", "Expected map argument");
-      }
-    } 
-    else {
-      result->NotImplemented();
-    }
-  } catch (const std::exception& e) {
-    std::string error_message = "SMTC Error: ";
-    error_message += e.what();
-    result->Error("SMTC_ERROR", error_message);
-  } catch (...) {
-    result->Error("SMTC_ERROR", "Unknown error occurred");
+  using flutter::EncodableMap;
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(SmtcPlugin* plugin, const EncodableValue* arguments,
+                           MethodResult* result);
+
+  // 方法表：一次哈希查找，参数按类型解码，不依赖异常。
+  // 更新只在平台线程上解码并投递，WinRT 调用全部由工作线程完成
+  static const MethodTable<Handler> methods{
+      {"initialize",
+       [](SmtcPlugin* plugin, const EncodableValue*, MethodResult* result) {
+         SmtcUpdate update;
+         update.initialize = true;
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+      {"enable",
+       [](SmtcPlugin* plugin, const EncodableValue*, MethodResult* result) {
+         plugin->enable_requested_ = true;
+         SmtcUpdate update;
+         update.enable = true;
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+      {"disable",
+       [](SmtcPlugin* plugin, const EncodableValue*, MethodResult* result) {
+         plugin->enable_requested_ = false;
+         SmtcUpdate update;
+         update.enable = false;
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+      {"updateMetadata",
+       [](SmtcPlugin* plugin, const EncodableValue* arguments,
+          MethodResult* result) {
+         SmtcUpdate::Metadata metadata;
+         const ArgError error = DecodeArgs(
+             std::get_if<EncodableMap>(arguments),
+             Optional("title", &metadata.title),
+             Optional("artist", &metadata.artist),
+             Optional("album", &metadata.album),
+             Optional("thumbnail", &metadata.thumbnail));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         SmtcUpdate update;
+         update.metadata = std::move(metadata);
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+      {"updatePlaybackStatus",
+       [](SmtcPlugin* plugin, const EncodableValue* arguments,
+          MethodResult* result) {
+         const auto* status = std::get_if<std::string>(arguments);
+         if (status == nullptr) {
+           result->Error("INVALID_ARGUMENT", "Expected string argument");
+           return;
+         }
+         SmtcUpdate update;
+         update.status = *status;
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+      {"updateTimeline",
+       [](SmtcPlugin* plugin, const EncodableValue* arguments,
+          MethodResult* result) {
+         // positionMs / endTimeMs 缺省时从共享播放时钟推算
+         SmtcUpdate::Timeline timeline;
+         const ArgError error =
+             DecodeArgs(std::get_if<EncodableMap>(arguments),
+                        Optional("positionMs", &timeline.position_ms),
+                        Optional("endTimeMs", &timeline.duration_ms));
+         if (!error.ok()) {
+           result->Error("INVALID_ARGUMENT", error.Message());
+           return;
+         }
+         SmtcUpdate update;
+         update.timeline = timeline;
+         plugin->worker_->Post(std::move(update));
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
   }
+  (*handler)(this, method_call.arguments(), result.get());
 }
 
 // 初始化SMTC
@@ -191,13 +292,10 @@ void SmtcPlugin::Initialize() {
   } catch (const winrt::hresult_error& e) {
     std::wcerr << L"[SMTC] ❌ 初始化失败: " << e.message().c_str() << std::endl;
     std::wcout << L"[SMTC] HRESULT: 0x" << std::hex << e.code() << std::dec << std::endl;
-    throw;
   } catch (const std::exception& e) {
     std::cerr << "[SMTC] ❌ 标准异常: " << e.what() << std::endl;
-    throw;
   } catch (...) {
     std::cerr << "[SMTC] ❌ 未知异常" << std::endl;
-    throw;
   }
 }
 
@@ -205,6 +303,7 @@ void SmtcPlugin::Initialize() {
 void SmtcPlugin::EnableSmtc() {
   if (!initialized_) {
     Initialize();
+    if (!initialized_) return;
   }
 
   try {
@@ -230,7 +329,7 @@ void SmtcPlugin::DisableSmtc() {
 }
 
 // 更新元数据
-void SmtcPlugin::UpdateMetadata(const flutter::EncodableMap& metadata) {
+void SmtcPlugin::UpdateMetadata(const SmtcUpdate::Metadata& metadata) {
   if (!initialized_) {
     std::cout << "[SMTC] ⚠️ 未初始化，无法更新元数据" << std::endl;
     return;
@@ -238,47 +337,29 @@ void SmtcPlugin::UpdateMetadata(const flutter::EncodableMap& metadata) {
 
   try {
     auto music_properties = updater_.MusicProperties();
-
-    // 获取标题
-    auto title_it = metadata.find(flutter::EncodableValue("title"));
-    if (title_it != metadata.end()) {
-      const auto* title = std::get_if<std::string>(&title_it->second);
-      if (title && !title->empty()) {
-        music_properties.Title(winrt::to_hstring(*title));
-      }
+    if (!metadata.title.empty()) {
+      music_properties.Title(winrt::to_hstring(metadata.title));
     }
-
-    // 获取艺术家
-    auto artist_it = metadata.find(flutter::EncodableValue("artist"));
-    if (artist_it != metadata.end()) {
-      const auto* artist = std::get_if<std::string>(&artist_it->second);
-      if (artist && !artist->empty()) {
-        music_properties.Artist(winrt::to_hstring(*artist));
-      }
+    if (!metadata.artist.empty()) {
+      music_properties.Artist(winrt::to_hstring(metadata.artist));
     }
-
-    // 获取专辑
-    auto album_it = metadata.find(flutter::EncodableValue("album"));
-    if (album_it != metadata.end()) {
-      const auto* album = std::get_if<std::string>(&album_it->second);
-      if (album && !album->empty()) {
-        music_properties.AlbumTitle(winrt::to_hstring(*album));
-      }
+    if (!metadata.album.empty()) {
+      music_properties.AlbumTitle(winrt::to_hstring(metadata.album));
     }
 
-    // 获取封面URL
-    auto thumbnail_it = metadata.find(flutter::EncodableValue("thumbnail"));
-    if (thumbnail_it != metadata.end()) {
-      const auto* thumbnail = std::get_if<std::string>(&thumbnail_it->second);
-      if (thumbnail && !thumbnail->empty()) {
-        try {
-          // 从URL加载缩略图
-          Uri thumbnail_uri{winrt::to_hstring(*thumbnail)};
+    // 缩略图：优先使用原生封面缓存中已解码的位图，未命中时才交给 SMTC 从 URL 加载
+    if (!metadata.thumbnail.empty()) {
+      try {
+        if (auto cover = CoverArtCache::Shared().Find(metadata.thumbnail)) {
+          updater_.Thumbnail(RandomAccessStreamReference::CreateFromStream(
+              ThumbnailStream(cover->thumbnail)));
+        } else {
+          Uri thumbnail_uri{winrt::to_hstring(metadata.thumbnail)};
           updater_.Thumbnail(
               RandomAccessStreamReference::CreateFromUri(thumbnail_uri));
-        } catch (...) {
-          std::cout << "[SMTC] ⚠️ 加载封面失败" << std::endl;
         }
+      } catch (...) {
+        std::cout << "[SMTC] ⚠️ 加载封面失败" << std::endl;
       }
     }
 
@@ -318,28 +399,38 @@ void SmtcPlugin::UpdatePlaybackStatus(const std::string& status) {
 }
 
 // 更新时间线（进度）
-void SmtcPlugin::UpdateTimeline(const flutter::EncodableMap& timeline) {
+// 未提供的字段从共享播放时钟推算，取应用时刻而非投递时刻的位置
+void SmtcPlugin::UpdateTimeline(const SmtcUpdate::Timeline& timeline) {
   if (!initialized_) {
     std::cout << "[SMTC] ⚠️ 未初始化，无法更新时间线" << std::endl;
     return;
   }
 
-  try {
-    // 获取时间参数（毫秒）
-    auto get_int64 = [&timeline](const char* key) -> int64_t {
-      auto it = timeline.find(flutter::EncodableValue(key));
-      if (it != timeline.end()) {
-        const auto* value = std::get_if<int64_t>(&it->second);
-        if (value) return *value;
-        const auto* int_value = std::get_if<int32_t>(&it->second);
-        if (int_value) return static_cast<int64_t>(*int_value);
-      }
-      return 0;
-    };
+  int64_t position_ms = timeline.position_ms;
+  int64_t duration_ms = timeline.duration_ms;
+  PlaybackSnapshot playback;
+  const bool has_clock = PlaybackClock::Shared().Read(&playback);
+  if (position_ms < 0) {
+    position_ms = has_clock ? playback.PositionAt(PlaybackClock::NowUs()) : 0;
+  }
+  if (duration_ms < 0) {
+    duration_ms = has_clock ? playback.duration_ms : 0;
+  }
 
-    int64_t position_ms = get_int64("positionMs");
-    int64_t duration_ms = get_int64("endTimeMs");
+  PushTimeline(position_ms, duration_ms);
+}
+
+// 从共享播放时钟刷新时间线，无需 Dart 发送 updateTimeline
+void SmtcPlugin::SyncTimelineFromClock() {
+  PlaybackSnapshot playback;
+  if (!PlaybackClock::Shared().Read(&playback) || playback.duration_ms <= 0) {
+    return;
+  }
+  PushTimeline(playback.PositionAt(PlaybackClock::NowUs()), playback.duration_ms);
+}
 
+void SmtcPlugin::PushTimeline(int64_t position_ms, int64_t duration_ms) {
+  try {
     // 创建时间线属性
     SystemMediaTransportControlsTimelineProperties timeline_props;
     timeline_props.StartTime(TimeSpan{0});
@@ -5,7 +5,10 @@
 #include <flutter/plugin_registrar_windows.h>
 #include <flutter/standard_method_codec.h>
 
+#include <chrono>
+#include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 
 // Windows Runtime headers (需要Windows 10 SDK)
@@ -14,32 +17,70 @@
 #include <winrt/Windows.Media.Playback.h>
 #include <winrt/Windows.Storage.Streams.h>
 
+#include "channel/coalescing_worker.h"
+
 namespace cyrene_music {
 
+// 待应用到 SMTC 的状态。多次调用在队列中合并，新值覆盖旧值
+struct SmtcUpdate {
+  struct Metadata {
+    std::string title;
+    std::string artist;
+    std::string album;
+    std::string thumbnail;
+  };
+  // -1 表示未提供，应用时从共享播放时钟推算
+  struct Timeline {
+    int64_t position_ms = -1;
+    int64_t duration_ms = -1;
+  };
+
+  bool initialize = false;
+  std::optional<bool> enable;
+  std::optional<Metadata> metadata;
+  std::optional<std::string> status;
+  std::optional<Timeline> timeline;
+
+  void Merge(SmtcUpdate&& newer);
+  bool empty() const;
+};
+
 // SMTC (System Media Transport Controls) 插件
 // 提供Windows原生媒体控件功能
+//
+// 以通道桩注册：首次调用时才创建工作线程和 WinRT 对象，
+// SMTC 处于禁用状态且通道空闲 |idle_release| 后整体释放
 class SmtcPlugin {
  public:
-  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar,
+                                    std::chrono::milliseconds idle_release);
 
-  SmtcPlugin();
+  explicit SmtcPlugin(flutter::MethodChannel<flutter::EncodableValue>* channel);
   virtual ~SmtcPlugin();
 
   // 禁用拷贝和赋值
   SmtcPlugin(const SmtcPlugin&) = delete;
   SmtcPlugin& operator=(const SmtcPlugin&) = delete;
 
- private:
   // 处理Method Channel调用
   void HandleMethodCall(
       const flutter::MethodCall<flutter::EncodableValue>& method_call,
       std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
 
-  // SMTC 功能方法
+  // SMTC 未启用时可以释放（平台线程）
+  bool CanRelease() const { return !enable_requested_; }
+
+ private:
+  // 以下 SMTC 方法只在工作线程（独立的 MTA 套间）上运行，
+  // 平台线程只负责投递更新，从不等待 WinRT 调用
+  void Apply(SmtcUpdate& update);
   void Initialize();
-  void UpdateMetadata(const flutter::EncodableMap& metadata);
+  void Shutdown();
+  void UpdateMetadata(const SmtcUpdate::Metadata& metadata);
   void UpdatePlaybackStatus(const std::string& status);
-  void UpdateTimeline(const flutter::EncodableMap& timeline);
+  void UpdateTimeline(const SmtcUpdate::Timeline& timeline);
+  void SyncTimelineFromClock();
+  void PushTimeline(int64_t position_ms, int64_t duration_ms);
   void EnableSmtc();
   void DisableSmtc();
 
@@ -48,8 +89,8 @@ class SmtcPlugin {
       winrt::Windows::Media::SystemMediaTransportControls const& sender,
       winrt::Windows::Media::SystemMediaTransportControlsButtonPressedEventArgs const& args);
 
-  // Method Channel
-  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+  // Method Channel（归通道桩所有，比插件实例活得久）
+  flutter::MethodChannel<flutter::EncodableValue>* channel_;
   
   // MediaPlayer 实例（用于桌面应用访问 SMTC）
   winrt::Windows::Media::Playback::MediaPlayer media_player_{nullptr};
@@ -61,9 +102,15 @@ class SmtcPlugin {
   // 事件令牌
   winrt::event_token button_pressed_token_;
   
-  // 状态标志
+  // Dart 最后请求的启用状态（仅平台线程访问）
+  bool enable_requested_ = false;
+
+  // 状态标志（仅工作线程访问）
   bool initialized_ = false;
   bool enabled_ = false;
+
+  // 合并更新并限速应用的工作线程；最后声明，最先销毁
+  std::unique_ptr<CoalescingWorker<SmtcUpdate>> worker_;
 };
 
 }  // namespace cyrene_music
@@ -0,0 +1,68 @@
+#include "stream_proxy_plugin.h"
+
+#include <flutter/standard_method_codec.h>
+
+#include <cstdint>
+#include <utility>
+
+#include "channel/method_dispatch.h"
+#include "net/stream_proxy.h"
+
+namespace cyrene_music {
+
+void StreamProxyPlugin::RegisterWithRegistrar(
+    FlutterDesktopPluginRegistrarRef registrar_ref) {
+  auto registrar =
+      flutter::PluginRegistrarManager::GetInstance()
+          ->GetRegistrar<flutter::PluginRegistrarWindows>(registrar_ref);
+
+  auto plugin = std::make_unique<StreamProxyPlugin>(registrar->messenger());
+  registrar->AddPlugin(std::move(plugin));
+}
+
+StreamProxyPlugin::StreamProxyPlugin(flutter::BinaryMessenger* messenger) {
+  channel_ = std::make_unique<flutter::MethodChannel<flutter::EncodableValue>>(
+      messenger, "com.cyrene.music/stream_proxy",
+      &flutter::StandardMethodCodec::GetInstance());
+  channel_->SetMethodCallHandler([this](const auto& call, auto result) {
+    HandleMethodCall(call, std::move(result));
+  });
+}
+
+// Streams still being relayed end with the engine, not with static
+// destruction.
+StreamProxyPlugin::~StreamProxyPlugin() { StreamProxy::Shared().Stop(); }
+
+void StreamProxyPlugin::HandleMethodCall(
+    const flutter::MethodCall<flutter::EncodableValue>& method_call,
+    std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result) {
+  using flutter::EncodableValue;
+  using MethodResult = flutter::MethodResult<EncodableValue>;
+  using Handler = void (*)(MethodResult* result);
+
+  static const MethodTable<Handler> methods{
+      {"start",
+       [](MethodResult* result) {
+         const uint16_t port = StreamProxy::Shared().Start();
+         if (port == 0) {
+           result->Error("START_FAILED", "No free proxy port");
+           return;
+         }
+         result->Success(EncodableValue(static_cast<int32_t>(port)));
+       }},
+      {"stop",
+       [](MethodResult* result) {
+         StreamProxy::Shared().Stop();
+         result->Success(EncodableValue(true));
+       }},
+  };
+
+  const Handler* handler = methods.Find(method_call.method_name());
+  if (handler == nullptr) {
+    result->NotImplemented();
+    return;
+  }
+  (*handler)(result.get());
+}
+
+}  // namespace cyrene_music
@@ -0,0 +1,34 @@
+#ifndef RUNNER_STREAM_PROXY_PLUGIN_H_
+#define RUNNER_STREAM_PROXY_PLUGIN_H_
+
+#include <flutter/method_channel.h>
+#include <flutter/plugin_registrar_windows.h>
+
+#include <memory>
+
+namespace cyrene_music {
+
+// Runs the native StreamProxy for ProxyService: "start" listens (if it is
+// not already) and returns the port, "stop" closes it and every stream it
+// is relaying.
+class StreamProxyPlugin : public flutter::Plugin {
+ public:
+  static void RegisterWithRegistrar(FlutterDesktopPluginRegistrarRef registrar);
+
+  explicit StreamProxyPlugin(flutter::BinaryMessenger* messenger);
+  ~StreamProxyPlugin() override;
+
+  StreamProxyPlugin(const StreamProxyPlugin&) = delete;
+  StreamProxyPlugin& operator=(const StreamProxyPlugin&) = delete;
+
+ private:
+  void HandleMethodCall(
+      const flutter::MethodCall<flutter::EncodableValue>& method_call,
+      std::unique_ptr<flutter::MethodResult<flutter::EncodableValue>> result);
+
+  std::unique_ptr<flutter::MethodChannel<flutter::EncodableValue>> channel_;
+};
+
+}  // namespace cyrene_music
+
+#endif  // RUNNER_STREAM_PROXY_PLUGIN_H_
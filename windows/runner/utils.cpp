@@ -63,3 +63,18 @@ std::string Utf8FromUtf16(const wchar_t* utf16_string) {
   }
   return utf8_string;
 }
+
+std::wstring Utf16FromUtf8(const char* utf8_string, size_t length) {
+  if (utf8_string == nullptr || length == 0) {
+    return std::wstring();
+  }
+  const int target_length = ::MultiByteToWideChar(
+      CP_UTF8, 0, utf8_string, static_cast<int>(length), nullptr, 0);
+  if (target_length <= 0) {
+    return std::wstring();
+  }
+  std::wstring utf16_string(target_length, L'\0');
+  ::MultiByteToWideChar(CP_UTF8, 0, utf8_string, static_cast<int>(length),
+                        utf16_string.data(), target_length);
+  return utf16_string;
+}
@@ -0,0 +1,63 @@
+#include "wic_image_decoder.h"
+
+#include <utility>
+
+using Microsoft::WRL::ComPtr;
+
+namespace {
+
+// Larger images are refused rather than allocated; covers are far smaller.
+constexpr UINT kMaxDimension = 8192;
+
+}  // namespace
+
+WicImageDecoder::WicImageDecoder() {
+  CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER,
+                   IID_PPV_ARGS(&factory_));
+}
+
+WicImageDecoder::~WicImageDecoder() = default;
+
+bool WicImageDecoder::Decode(const uint8_t* data, size_t size,
+                             cyrene_music::ArgbSurface* out) {
+  if (!factory_ || size > MAXDWORD) return false;
+
+  ComPtr<IWICStream> stream;
+  if (FAILED(factory_->CreateStream(&stream)) ||
+      FAILED(stream->InitializeFromMemory(const_cast<BYTE*>(data),
+                                          static_cast<DWORD>(size)))) {
+    return false;
+  }
+  ComPtr<IWICBitmapDecoder> decoder;
+  if (FAILED(factory_->CreateDecoderFromStream(
+          stream.Get(), nullptr, WICDecodeMetadataCacheOnDemand, &decoder))) {
+    return false;
+  }
+  ComPtr<IWICBitmapFrameDecode> frame;
+  if (FAILED(decoder->GetFrame(0, &frame))) return false;
+
+  ComPtr<IWICFormatConverter> converter;
+  if (FAILED(factory_->CreateFormatConverter(&converter)) ||
+      FAILED(converter->Initialize(frame.Get(), GUID_WICPixelFormat32bppPBGRA,
+                                   WICBitmapDitherTypeNone, nullptr, 0.0,
+                                   WICBitmapPaletteTypeCustom))) {
+    return false;
+  }
+  UINT width = 0;
+  UINT height = 0;
+  if (FAILED(converter->GetSize(&width, &height)) || width == 0 ||
+      height == 0 || width > kMaxDimension || height > kMaxDimension) {
+    return false;
+  }
+
+  cyrene_music::ArgbSurface surface(static_cast<int>(width),
+                                    static_cast<int>(height));
+  if (FAILED(converter->CopyPixels(
+          nullptr, static_cast<UINT>(surface.stride_bytes()),
+          static_cast<UINT>(surface.byte_size()),
+          reinterpret_cast<BYTE*>(surface.data())))) {
+    return false;
+  }
+  *out = std::move(surface);
+  return true;
+}
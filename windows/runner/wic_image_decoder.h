@@ -0,0 +1,24 @@
+#ifndef RUNNER_WIC_IMAGE_DECODER_H_
+#define RUNNER_WIC_IMAGE_DECODER_H_
+
+#include <windows.h>
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#include "cover/cover_art_cache.h"
+
+// Decodes cover art with WIC into premultiplied BGRA, the layout
+// ArgbSurface uses. Create and use it on one thread that has entered COM.
+class WicImageDecoder : public cyrene_music::ImageDecoder {
+ public:
+  WicImageDecoder();
+  ~WicImageDecoder() override;
+
+  bool Decode(const uint8_t* data, size_t size,
+              cyrene_music::ArgbSurface* out) override;
+
+ private:
+  Microsoft::WRL::ComPtr<IWICImagingFactory> factory_;
+};
+
+#endif  // RUNNER_WIC_IMAGE_DECODER_H_